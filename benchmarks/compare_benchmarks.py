@@ -0,0 +1,94 @@
+#!/usr/bin/env python3
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+
+"""Compares celix_benchmarks JSON results against a stored baseline.
+
+Exits with 1 when a benchmark is slower than the baseline by more than the
+threshold, or when a benchmark failed. Benchmarks that only exist in one of
+the files are reported but do not fail the comparison.
+"""
+
+import argparse
+import json
+import sys
+
+TIME_UNITS = {"ns": 1.0, "us": 1e3, "ms": 1e6, "s": 1e9}
+
+
+def load(path):
+    with open(path) as f:
+        results = json.load(f)
+    benchmarks = {}
+    for benchmark in results.get("benchmarks", []):
+        # google benchmark adds mean/median/stddev aggregates, only compare the iterations
+        if benchmark.get("run_type", "iteration") != "iteration":
+            continue
+        benchmarks[benchmark["name"]] = benchmark
+    return benchmarks
+
+
+def time_ns(benchmark, metric):
+    return benchmark[metric] * TIME_UNITS[benchmark.get("time_unit", "ns")]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Flags celix_benchmarks regressions against a baseline")
+    parser.add_argument("baseline", help="JSON results of the baseline run")
+    parser.add_argument("results", help="JSON results of the new run")
+    parser.add_argument("--threshold", type=float, default=10.0,
+                        help="allowed slowdown in percent (default 10)")
+    parser.add_argument("--metric", choices=["real_time", "cpu_time"], default="cpu_time",
+                        help="time to compare (default cpu_time)")
+    args = parser.parse_args()
+
+    baseline = load(args.baseline)
+    results = load(args.results)
+    regressions = 0
+    failures = 0
+
+    print("%-48s %14s %14s %9s" % ("Benchmark", "Baseline", "Current", "Change"))
+    for name, result in results.items():
+        if result.get("error_occurred"):
+            print("%-48s FAILED: %s" % (name, result.get("error_message", "")))
+            failures += 1
+            continue
+        if name not in baseline or baseline[name].get("error_occurred"):
+            print("%-48s %14s %11.1f ns %9s" % (name, "-", time_ns(result, args.metric), "new"))
+            continue
+
+        old = time_ns(baseline[name], args.metric)
+        new = time_ns(result, args.metric)
+        change = (new - old) / old * 100.0 if old > 0 else 0.0
+        flag = ""
+        if change > args.threshold:
+            flag = "  REGRESSION"
+            regressions += 1
+        print("%-48s %11.1f ns %11.1f ns %+8.1f%%%s" % (name, old, new, change, flag))
+
+    for name in baseline:
+        if name not in results:
+            print("%-48s missing in results" % name)
+
+    if regressions > 0 or failures > 0:
+        print("%i regression(s) above %.1f%%, %i failed benchmark(s)" % (regressions, args.threshold, failures))
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
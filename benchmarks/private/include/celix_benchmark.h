@@ -0,0 +1,72 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+/*
+ * celix_benchmark.h
+ *
+ * Minimal micro benchmark harness modelled after google benchmark. A benchmark runs its body state->iterations
+ * times, the harness grows the number of iterations until a run takes at least the minimal time and reports the
+ * time per iteration. Setup and teardown run outside of the measured time and may store state in state->data.
+ * Every suite is a NULL terminated array of benchmarks, one benchmark is run for every argument in args (or once
+ * without argument when args is NULL). The results are written to the console and optionally as JSON in the google
+ * benchmark format.
+ *
+ *  \author    	<a href="mailto:dev@celix.apache.org">Apache Celix Project Team</a>
+ *  \copyright	Apache License, Version 2.0
+ */
+
+#ifndef CELIX_BENCHMARK_H_
+#define CELIX_BENCHMARK_H_
+
+#include <stdint.h>
+
+#include "celixbool.h"
+
+#define CELIX_BENCHMARK_ARGS_END -1
+
+typedef struct celix_benchmark_state {
+    long arg; //the argument of this run, -1 without argument
+    uint64_t iterations;
+    void *data;
+    uint64_t itemsProcessed; //optional, reported as items_per_second
+    uint64_t bytesProcessed; //optional, reported as bytes_per_second
+    bool error;
+} celix_benchmark_state_t;
+
+typedef struct celix_benchmark {
+    const char *name; //"<module>/<benchmark>", the argument is appended as "/<arg>"
+    const long *args; //terminated by CELIX_BENCHMARK_ARGS_END, or NULL
+    void (*setup)(celix_benchmark_state_t *state);
+    void (*run)(celix_benchmark_state_t *state);
+    void (*teardown)(celix_benchmark_state_t *state);
+} celix_benchmark_t;
+
+extern const celix_benchmark_t utilsBenchmarks[];
+extern const celix_benchmark_t frameworkBenchmarks[];
+extern const celix_benchmark_t dfiBenchmarks[];
+extern const celix_benchmark_t pubsubBenchmarks[];
+
+/* Marks the run as failed, e.g. when setup could not create the benchmark state */
+void celixBenchmark_fail(celix_benchmark_state_t *state, const char *reason);
+
+/* Keeps the compiler from optimizing away a result */
+static inline void celixBenchmark_doNotOptimize(const void *value) {
+    __asm__ __volatile__("" : : "r"(value) : "memory");
+}
+
+#endif /* CELIX_BENCHMARK_H_ */
@@ -0,0 +1,344 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+/*
+ * celix_benchmark.c
+ *
+ * Runner of the celix_benchmarks target. Accepts the common google benchmark options:
+ *   --benchmark_filter=<regex>        only run the benchmarks whose name matches
+ *   --benchmark_min_time=<seconds>    minimal measured time of a run (default 0.5)
+ *   --benchmark_repetitions=<n>       repeat every benchmark and report the median (default 1)
+ *   --benchmark_out=<file>            write the results as JSON
+ *   --benchmark_list_tests            only print the benchmark names
+ *
+ *  \author    	<a href="mailto:dev@celix.apache.org">Apache Celix Project Team</a>
+ *  \copyright	Apache License, Version 2.0
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <regex.h>
+#include <unistd.h>
+
+#include "celix_benchmark.h"
+
+#define MAX_NAME_LEN 128
+#define MAX_REPETITIONS 100
+#define MAX_ITERATIONS 1000000000ULL
+
+struct benchmark_options {
+    const char *filter;
+    double minTime;
+    int repetitions;
+    const char *out;
+    bool list;
+};
+
+struct benchmark_result {
+    char name[MAX_NAME_LEN];
+    uint64_t iterations;
+    int repetitions;
+    double realTime; //ns per iteration
+    double cpuTime;
+    double itemsPerSecond;
+    double bytesPerSecond;
+    const char *error;
+};
+
+struct benchmark_run {
+    double realNs;
+    double cpuNs;
+    uint64_t items;
+    uint64_t bytes;
+};
+
+static const celix_benchmark_t *benchmarkSuites[] = { utilsBenchmarks, frameworkBenchmarks, dfiBenchmarks, pubsubBenchmarks };
+
+static const char *benchmark_error = NULL;
+
+static int celixBenchmark_parseOptions(int argc, char **argv, struct benchmark_options *options);
+static void celixBenchmark_run(const celix_benchmark_t *benchmark, long arg, struct benchmark_options *options, struct benchmark_result *result);
+static void celixBenchmark_runOnce(const celix_benchmark_t *benchmark, celix_benchmark_state_t *state, uint64_t iterations, struct benchmark_run *run);
+static double celixBenchmark_now(clockid_t clock);
+static int celixBenchmark_compareDouble(const void *a, const void *b);
+static void celixBenchmark_printResult(struct benchmark_result *result);
+static int celixBenchmark_writeJson(const char *file, const char *executable, struct benchmark_result *results, int nrOfResults);
+
+void celixBenchmark_fail(celix_benchmark_state_t *state, const char *reason) {
+    state->error = true;
+    benchmark_error = reason;
+}
+
+int main(int argc, char **argv) {
+    struct benchmark_options options;
+    struct benchmark_result *results = NULL;
+    int nrOfResults = 0;
+    int failures = 0;
+    regex_t filter;
+    unsigned int i;
+
+    if (celixBenchmark_parseOptions(argc, argv, &options) != 0) {
+        return EXIT_FAILURE;
+    }
+    if (regcomp(&filter, options.filter, REG_EXTENDED | REG_NOSUB) != 0) {
+        fprintf(stderr, "Invalid benchmark filter '%s'\n", options.filter);
+        return EXIT_FAILURE;
+    }
+
+    if (!options.list) {
+        printf("%-48s %14s %14s %12s\n", "Benchmark", "Time", "CPU", "Iterations");
+    }
+    for (i = 0; i < sizeof(benchmarkSuites) / sizeof(benchmarkSuites[0]); i++) {
+        const celix_benchmark_t *benchmark;
+        for (benchmark = benchmarkSuites[i]; benchmark->name != NULL; benchmark++) {
+            const long *arg = benchmark->args;
+            do {
+                struct benchmark_result result;
+                long value = arg != NULL ? *arg : -1;
+
+                memset(&result, 0, sizeof(result));
+                if (value >= 0) {
+                    snprintf(result.name, sizeof(result.name), "%s/%li", benchmark->name, value);
+                } else {
+                    snprintf(result.name, sizeof(result.name), "%s", benchmark->name);
+                }
+
+                if (regexec(&filter, result.name, 0, NULL, 0) == 0) {
+                    if (options.list) {
+                        printf("%s\n", result.name);
+                    } else {
+                        celixBenchmark_run(benchmark, value, &options, &result);
+                        celixBenchmark_printResult(&result);
+                        failures += result.error != NULL ? 1 : 0;
+
+                        struct benchmark_result *grown = realloc(results, (nrOfResults + 1) * sizeof(*results));
+                        if (grown != NULL) {
+                            results = grown;
+                            results[nrOfResults++] = result;
+                        }
+                    }
+                }
+                if (arg != NULL) {
+                    arg++;
+                }
+            } while (arg != NULL && *arg != CELIX_BENCHMARK_ARGS_END);
+        }
+    }
+    regfree(&filter);
+
+    if (options.out != NULL && !options.list && celixBenchmark_writeJson(options.out, argv[0], results, nrOfResults) != 0) {
+        fprintf(stderr, "Cannot write benchmark results to '%s'\n", options.out);
+        failures++;
+    }
+    free(results);
+
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static int celixBenchmark_parseOptions(int argc, char **argv, struct benchmark_options *options) {
+    int i;
+
+    options->filter = ".";
+    options->minTime = 0.5;
+    options->repetitions = 1;
+    options->out = NULL;
+    options->list = false;
+
+    for (i = 1; i < argc; i++) {
+        char *value = strchr(argv[i], '=');
+        value = value != NULL ? value + 1 : NULL;
+
+        if (strncmp(argv[i], "--benchmark_filter=", 19) == 0) {
+            options->filter = value;
+        } else if (strncmp(argv[i], "--benchmark_min_time=", 21) == 0) {
+            options->minTime = atof(value);
+        } else if (strncmp(argv[i], "--benchmark_repetitions=", 24) == 0) {
+            options->repetitions = atoi(value);
+        } else if (strncmp(argv[i], "--benchmark_out=", 16) == 0) {
+            options->out = value;
+        } else if (strcmp(argv[i], "--benchmark_list_tests") == 0 || strcmp(argv[i], "--benchmark_list_tests=true") == 0) {
+            options->list = true;
+        } else if (strncmp(argv[i], "--benchmark_out_format=", 23) == 0 && strcmp(value, "json") == 0) {
+            //json is the only supported format
+        } else {
+            fprintf(stderr, "Unknown option '%s'\n"
+                    "Usage: %s [--benchmark_filter=<regex>] [--benchmark_min_time=<seconds>] [--benchmark_repetitions=<n>]\n"
+                    "          [--benchmark_out=<file>] [--benchmark_list_tests]\n", argv[i], argv[0]);
+            return 1;
+        }
+    }
+
+    if (options->minTime <= 0.0 || options->repetitions < 1 || options->repetitions > MAX_REPETITIONS) {
+        fprintf(stderr, "Invalid benchmark min time or repetitions\n");
+        return 1;
+    }
+    return 0;
+}
+
+static void celixBenchmark_run(const celix_benchmark_t *benchmark, long arg, struct benchmark_options *options, struct benchmark_result *result) {
+    celix_benchmark_state_t state;
+    struct benchmark_run runs[MAX_REPETITIONS];
+    double realTimes[MAX_REPETITIONS];
+    double cpuTimes[MAX_REPETITIONS];
+    uint64_t iterations = 1;
+    int i;
+
+    memset(&state, 0, sizeof(state));
+    state.arg = arg;
+    benchmark_error = NULL;
+    if (benchmark->setup != NULL) {
+        benchmark->setup(&state);
+    }
+
+    // grow the iterations until a run takes the min time, like google benchmark
+    while (!state.error) {
+        celixBenchmark_runOnce(benchmark, &state, iterations, &runs[0]);
+        double seconds = runs[0].realNs / 1e9;
+        if (seconds >= options->minTime || iterations >= MAX_ITERATIONS) {
+            break;
+        }
+        double multiplier = seconds / options->minTime > 0.1 ? options->minTime * 1.4 / seconds : 10.0;
+        multiplier = multiplier > 10.0 ? 10.0 : multiplier;
+        uint64_t next = (uint64_t) (iterations * multiplier);
+        iterations = next > iterations ? next : iterations + 1;
+        iterations = iterations > MAX_ITERATIONS ? MAX_ITERATIONS : iterations;
+    }
+
+    for (i = 1; i < options->repetitions && !state.error; i++) {
+        celixBenchmark_runOnce(benchmark, &state, iterations, &runs[i]);
+    }
+
+    if (benchmark->teardown != NULL) {
+        benchmark->teardown(&state);
+    }
+
+    result->iterations = iterations;
+    result->repetitions = options->repetitions;
+    if (state.error) {
+        result->error = benchmark_error != NULL ? benchmark_error : "benchmark failed";
+        return;
+    }
+
+    for (i = 0; i < options->repetitions; i++) {
+        realTimes[i] = runs[i].realNs / iterations;
+        cpuTimes[i] = runs[i].cpuNs / iterations;
+    }
+    qsort(realTimes, options->repetitions, sizeof(double), celixBenchmark_compareDouble);
+    qsort(cpuTimes, options->repetitions, sizeof(double), celixBenchmark_compareDouble);
+    result->realTime = realTimes[options->repetitions / 2];
+    result->cpuTime = cpuTimes[options->repetitions / 2];
+    if (runs[0].items > 0) {
+        result->itemsPerSecond = runs[0].items / (runs[0].realNs / 1e9);
+    }
+    if (runs[0].bytes > 0) {
+        result->bytesPerSecond = runs[0].bytes / (runs[0].realNs / 1e9);
+    }
+}
+
+static void celixBenchmark_runOnce(const celix_benchmark_t *benchmark, celix_benchmark_state_t *state, uint64_t iterations, struct benchmark_run *run) {
+    state->iterations = iterations;
+    state->itemsProcessed = 0;
+    state->bytesProcessed = 0;
+
+    double realStart = celixBenchmark_now(CLOCK_MONOTONIC);
+    double cpuStart = celixBenchmark_now(CLOCK_PROCESS_CPUTIME_ID);
+    benchmark->run(state);
+    run->cpuNs = celixBenchmark_now(CLOCK_PROCESS_CPUTIME_ID) - cpuStart;
+    run->realNs = celixBenchmark_now(CLOCK_MONOTONIC) - realStart;
+    run->items = state->itemsProcessed;
+    run->bytes = state->bytesProcessed;
+}
+
+static double celixBenchmark_now(clockid_t clock) {
+    struct timespec now;
+    clock_gettime(clock, &now);
+    return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+static int celixBenchmark_compareDouble(const void *a, const void *b) {
+    double left = *(const double *) a;
+    double right = *(const double *) b;
+    return left < right ? -1 : left > right ? 1 : 0;
+}
+
+static void celixBenchmark_printResult(struct benchmark_result *result) {
+    if (result->error != NULL) {
+        printf("%-48s ERROR: %s\n", result->name, result->error);
+        return;
+    }
+
+    printf("%-48s %11.1f ns %11.1f ns %12llu", result->name, result->realTime, result->cpuTime, (unsigned long long) result->iterations);
+    if (result->itemsPerSecond > 0.0) {
+        printf(" items/s=%.4g", result->itemsPerSecond);
+    }
+    if (result->bytesPerSecond > 0.0) {
+        printf(" bytes/s=%.4g", result->bytesPerSecond);
+    }
+    printf("\n");
+    fflush(stdout);
+}
+
+static int celixBenchmark_writeJson(const char *file, const char *executable, struct benchmark_result *results, int nrOfResults) {
+    char date[64];
+    char host[256];
+    time_t now = time(NULL);
+    FILE *out;
+    int i;
+
+    out = fopen(file, "w");
+    if (out == NULL) {
+        return 1;
+    }
+
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", localtime(&now));
+    if (gethostname(host, sizeof(host)) != 0) {
+        strcpy(host, "unknown");
+    }
+    host[sizeof(host) - 1] = '\0';
+
+    // the names only contain [a-z0-9_/], no escaping is needed
+    fprintf(out, "{\n  \"context\": {\n    \"date\": \"%s\",\n    \"host_name\": \"%s\",\n    \"executable\": \"%s\",\n", date, host, executable);
+    fprintf(out, "    \"num_cpus\": %li,\n", sysconf(_SC_NPROCESSORS_ONLN));
+#ifdef NDEBUG
+    fprintf(out, "    \"library_build_type\": \"release\"\n  },\n");
+#else
+    fprintf(out, "    \"library_build_type\": \"debug\"\n  },\n");
+#endif
+    fprintf(out, "  \"benchmarks\": [");
+    for (i = 0; i < nrOfResults; i++) {
+        struct benchmark_result *result = &results[i];
+        fprintf(out, "%s\n    {\n      \"name\": \"%s\",\n      \"run_name\": \"%s\",\n      \"run_type\": \"iteration\",\n",
+                i > 0 ? "," : "", result->name, result->name);
+        fprintf(out, "      \"repetitions\": %i,\n      \"iterations\": %llu,\n", result->repetitions, (unsigned long long) result->iterations);
+        if (result->error != NULL) {
+            fprintf(out, "      \"error_occurred\": true,\n      \"error_message\": \"%s\",\n", result->error);
+        }
+        fprintf(out, "      \"real_time\": %.3f,\n      \"cpu_time\": %.3f,\n      \"time_unit\": \"ns\"", result->realTime, result->cpuTime);
+        if (result->itemsPerSecond > 0.0) {
+            fprintf(out, ",\n      \"items_per_second\": %.3f", result->itemsPerSecond);
+        }
+        if (result->bytesPerSecond > 0.0) {
+            fprintf(out, ",\n      \"bytes_per_second\": %.3f", result->bytesPerSecond);
+        }
+        fprintf(out, "\n    }");
+    }
+    fprintf(out, "\n  ]\n}\n");
+
+    return fclose(out) != 0 ? 1 : 0;
+}
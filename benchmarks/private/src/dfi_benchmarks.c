@@ -0,0 +1,226 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+/*
+ * dfi_benchmarks.c
+ *
+ * JSON serialization of a struct with a sequence of 10 and 1000 doubles, and the json rpc request and call used by
+ * the remote service admin.
+ *
+ *  \author    	<a href="mailto:dev@celix.apache.org">Apache Celix Project Team</a>
+ *  \copyright	Apache License, Version 2.0
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "dyn_type.h"
+#include "dyn_interface.h"
+#include "json_serializer.h"
+#include "json_rpc.h"
+
+#include "celix_benchmark.h"
+
+#define SAMPLES_DESCRIPTOR "{D[Dt ts values name}"
+
+#define CALCULATOR_DESCRIPTOR ":header\n" \
+        "type=interface\n" \
+        "name=calculator\n" \
+        "version=1.0.0\n" \
+        ":annotations\n" \
+        ":types\n" \
+        ":methods\n" \
+        "add(DD)D=add(#am=handle;PDD#am=pre;*D)N\n"
+
+#define ADD_REQUEST "{\"m\":\"add(DD)D\", \"a\": [1.0,2.0]}"
+
+struct samples {
+    double ts;
+    struct {
+        uint32_t cap;
+        uint32_t len;
+        double *buf;
+    } values;
+    char *name;
+};
+
+struct samples_data {
+    dyn_type *type;
+    struct samples *samples;
+    char *json;
+};
+
+struct calculator {
+    void *handle;
+    int (*add)(void *handle, double a, double b, double *result);
+};
+
+struct rpc_data {
+    dyn_interface_type *intf;
+    dyn_function_type *add;
+    struct calculator calculator;
+};
+
+static const long sampleSizes[] = { 10, 1000, CELIX_BENCHMARK_ARGS_END };
+
+static void dfiBenchmark_setupSamples(celix_benchmark_state_t *state) {
+    struct samples_data *data = calloc(1, sizeof(*data));
+    long i;
+
+    state->data = data;
+    if (dynType_parseWithStr(SAMPLES_DESCRIPTOR, "samples", NULL, &data->type) != 0) {
+        celixBenchmark_fail(state, "cannot parse samples descriptor");
+        return;
+    }
+
+    data->samples = calloc(1, sizeof(*data->samples));
+    data->samples->ts = 1500000000.123;
+    data->samples->name = strdup("benchmark.samples");
+    data->samples->values.cap = (uint32_t) state->arg;
+    data->samples->values.len = (uint32_t) state->arg;
+    data->samples->values.buf = calloc(state->arg, sizeof(double));
+    for (i = 0; i < state->arg; i++) {
+        data->samples->values.buf[i] = i * 1.25;
+    }
+
+    if (jsonSerializer_serialize(data->type, data->samples, &data->json) != 0) {
+        celixBenchmark_fail(state, "cannot serialize samples");
+    }
+}
+
+static void dfiBenchmark_teardownSamples(celix_benchmark_state_t *state) {
+    struct samples_data *data = state->data;
+
+    if (data->samples != NULL) {
+        free(data->samples->values.buf);
+        free(data->samples->name);
+        free(data->samples);
+    }
+    free(data->json);
+    if (data->type != NULL) {
+        dynType_destroy(data->type);
+    }
+    free(data);
+}
+
+static void dfiBenchmark_jsonSerialize(celix_benchmark_state_t *state) {
+    struct samples_data *data = state->data;
+    uint64_t i;
+
+    for (i = 0; i < state->iterations; i++) {
+        char *json = NULL;
+        if (jsonSerializer_serialize(data->type, data->samples, &json) != 0) {
+            celixBenchmark_fail(state, "cannot serialize samples");
+            break;
+        }
+        state->bytesProcessed += strlen(json);
+        free(json);
+    }
+    state->itemsProcessed = state->iterations;
+}
+
+static void dfiBenchmark_jsonDeserialize(celix_benchmark_state_t *state) {
+    struct samples_data *data = state->data;
+    size_t len = strlen(data->json);
+    uint64_t i;
+
+    for (i = 0; i < state->iterations; i++) {
+        void *samples = NULL;
+        if (jsonSerializer_deserialize(data->type, data->json, &samples) != 0) {
+            celixBenchmark_fail(state, "cannot deserialize samples");
+            break;
+        }
+        dynType_free(data->type, samples);
+    }
+    state->itemsProcessed = state->iterations;
+    state->bytesProcessed = state->iterations * len;
+}
+
+static int dfiBenchmark_add(void *handle, double a, double b, double *result) {
+    *result = a + b;
+    return 0;
+}
+
+static void dfiBenchmark_setupRpc(celix_benchmark_state_t *state) {
+    struct rpc_data *data = calloc(1, sizeof(*data));
+    struct methods_head *methods = NULL;
+    FILE *descriptor = fmemopen(CALCULATOR_DESCRIPTOR, strlen(CALCULATOR_DESCRIPTOR), "r");
+
+    state->data = data;
+    data->calculator.add = dfiBenchmark_add;
+    if (descriptor == NULL || dynInterface_parse(descriptor, &data->intf) != 0) {
+        celixBenchmark_fail(state, "cannot parse calculator descriptor");
+    } else {
+        dynInterface_methods(data->intf, &methods);
+        data->add = TAILQ_FIRST(methods)->dynFunc;
+    }
+    if (descriptor != NULL) {
+        fclose(descriptor);
+    }
+}
+
+static void dfiBenchmark_teardownRpc(celix_benchmark_state_t *state) {
+    struct rpc_data *data = state->data;
+
+    if (data->intf != NULL) {
+        dynInterface_destroy(data->intf);
+    }
+    free(data);
+}
+
+static void dfiBenchmark_jsonRpcPrepare(celix_benchmark_state_t *state) {
+    struct rpc_data *data = state->data;
+    void *handle = NULL;
+    double a = 1.0;
+    double b = 2.0;
+    void *args[3] = { &handle, &a, &b };
+    uint64_t i;
+
+    for (i = 0; i < state->iterations; i++) {
+        char *request = NULL;
+        if (jsonRpc_prepareInvokeRequest(data->add, "add(DD)D", args, &request) != 0) {
+            celixBenchmark_fail(state, "cannot prepare request");
+            break;
+        }
+        free(request);
+    }
+    state->itemsProcessed = state->iterations;
+}
+
+static void dfiBenchmark_jsonRpcCall(celix_benchmark_state_t *state) {
+    struct rpc_data *data = state->data;
+    uint64_t i;
+
+    for (i = 0; i < state->iterations; i++) {
+        char *reply = NULL;
+        if (jsonRpc_call(data->intf, &data->calculator, ADD_REQUEST, &reply) != 0) {
+            celixBenchmark_fail(state, "cannot call service");
+            break;
+        }
+        free(reply);
+    }
+    state->itemsProcessed = state->iterations;
+}
+
+const celix_benchmark_t dfiBenchmarks[] = {
+    { "dfi/json_serialize", sampleSizes, dfiBenchmark_setupSamples, dfiBenchmark_jsonSerialize, dfiBenchmark_teardownSamples },
+    { "dfi/json_deserialize", sampleSizes, dfiBenchmark_setupSamples, dfiBenchmark_jsonDeserialize, dfiBenchmark_teardownSamples },
+    { "dfi/json_rpc_prepare", NULL, dfiBenchmark_setupRpc, dfiBenchmark_jsonRpcPrepare, dfiBenchmark_teardownRpc },
+    { "dfi/json_rpc_call", NULL, dfiBenchmark_setupRpc, dfiBenchmark_jsonRpcCall, dfiBenchmark_teardownRpc },
+    { NULL, NULL, NULL, NULL, NULL }
+};
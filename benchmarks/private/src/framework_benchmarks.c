@@ -0,0 +1,236 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+/*
+ * framework_benchmarks.c
+ *
+ * Filter parsing and matching, and service registry lookups in a running framework with 100 and 1000 registered
+ * services.
+ *
+ *  \author    	<a href="mailto:dev@celix.apache.org">Apache Celix Project Team</a>
+ *  \copyright	Apache License, Version 2.0
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "celix_launcher.h"
+#include "constants.h"
+#include "bundle.h"
+#include "bundle_context.h"
+#include "filter.h"
+#include "service_registration.h"
+#include "array_list.h"
+
+#include "celix_benchmark.h"
+
+#define BENCHMARK_SERVICE_NAME "celix_benchmark_service"
+#define BENCHMARK_GROUPS 10
+#define FILTER_LEN 64
+
+#define SIMPLE_FILTER "(service.id=42)"
+#define COMPLEX_FILTER "(&(objectClass=log_service)(|(service.ranking>=10)(service.vendor=apache))(!(service.pid=test*)))"
+
+struct filter_data {
+    filter_pt filter;
+    properties_pt properties;
+};
+
+struct registry_data {
+    framework_pt framework;
+    bundle_context_pt context;
+    service_registration_pt *registrations;
+    long size;
+    int services[BENCHMARK_GROUPS];
+    service_reference_pt reference;
+};
+
+static const long registrySizes[] = { 100, 1000, CELIX_BENCHMARK_ARGS_END };
+
+static void frameworkBenchmark_filterCreate(celix_benchmark_state_t *state) {
+    uint64_t i;
+
+    for (i = 0; i < state->iterations; i++) {
+        filter_pt filter = filter_create(COMPLEX_FILTER);
+        celixBenchmark_doNotOptimize(filter);
+        filter_destroy(filter);
+    }
+    state->itemsProcessed = state->iterations;
+}
+
+static void frameworkBenchmark_setupFilter(celix_benchmark_state_t *state, const char *filterString) {
+    struct filter_data *data = calloc(1, sizeof(*data));
+
+    data->filter = filter_create(filterString);
+    data->properties = properties_create();
+    properties_set(data->properties, "objectClass", "log_service");
+    properties_set(data->properties, "service.id", "42");
+    properties_set(data->properties, "service.ranking", "5");
+    properties_set(data->properties, "service.vendor", "apache");
+    properties_set(data->properties, "service.pid", "org.apache.celix.log");
+    properties_set(data->properties, "service.bundleid", "3");
+    state->data = data;
+    if (data->filter == NULL) {
+        celixBenchmark_fail(state, "cannot create filter");
+    }
+}
+
+static void frameworkBenchmark_setupSimpleFilter(celix_benchmark_state_t *state) {
+    frameworkBenchmark_setupFilter(state, SIMPLE_FILTER);
+}
+
+static void frameworkBenchmark_setupComplexFilter(celix_benchmark_state_t *state) {
+    frameworkBenchmark_setupFilter(state, COMPLEX_FILTER);
+}
+
+static void frameworkBenchmark_teardownFilter(celix_benchmark_state_t *state) {
+    struct filter_data *data = state->data;
+
+    if (data->filter != NULL) {
+        filter_destroy(data->filter);
+    }
+    properties_destroy(data->properties);
+    free(data);
+}
+
+static void frameworkBenchmark_filterMatch(celix_benchmark_state_t *state) {
+    struct filter_data *data = state->data;
+    bool match = false;
+    uint64_t i;
+
+    for (i = 0; i < state->iterations; i++) {
+        filter_match(data->filter, data->properties, &match);
+        celixBenchmark_doNotOptimize(&match);
+    }
+    if (!match) {
+        celixBenchmark_fail(state, "filter does not match");
+    }
+    state->itemsProcessed = state->iterations;
+}
+
+static void frameworkBenchmark_setupRegistry(celix_benchmark_state_t *state) {
+    struct registry_data *data = calloc(1, sizeof(*data));
+    properties_pt config = properties_create();
+    bundle_pt bundle = NULL;
+    array_list_pt references = NULL;
+    char value[FILTER_LEN];
+    long i;
+
+    state->data = data;
+    data->size = state->arg;
+    data->registrations = calloc(data->size, sizeof(*data->registrations));
+
+    // no bundles are installed, the cache of a previous run can be reused
+    properties_set(config, OSGI_FRAMEWORK_FRAMEWORK_STORAGE, ".cache_benchmarks");
+    if (celixLauncher_launchWithProperties(config, &data->framework) != CELIX_SUCCESS) {
+        data->framework = NULL;
+        celixBenchmark_fail(state, "cannot launch framework");
+        return;
+    }
+    framework_getFrameworkBundle(data->framework, &bundle);
+    bundle_getContext(bundle, &data->context);
+
+    for (i = 0; i < data->size; i++) {
+        properties_pt properties = properties_create();
+        snprintf(value, sizeof(value), "%li", i);
+        properties_set(properties, "benchmark.index", value);
+        snprintf(value, sizeof(value), "%li", i % BENCHMARK_GROUPS);
+        properties_set(properties, "benchmark.group", value);
+        properties_set(properties, "service.vendor", "apache");
+        bundleContext_registerService(data->context, BENCHMARK_SERVICE_NAME, &data->services[i % BENCHMARK_GROUPS], properties, &data->registrations[i]);
+    }
+
+    snprintf(value, sizeof(value), "(benchmark.index=%li)", data->size / 2);
+    if (bundleContext_getServiceReferences(data->context, BENCHMARK_SERVICE_NAME, value, &references) != CELIX_SUCCESS
+            || references == NULL || arrayList_size(references) != 1) {
+        celixBenchmark_fail(state, "cannot find registered service");
+    } else {
+        data->reference = arrayList_get(references, 0);
+    }
+    if (references != NULL) {
+        arrayList_destroy(references);
+    }
+}
+
+static void frameworkBenchmark_teardownRegistry(celix_benchmark_state_t *state) {
+    struct registry_data *data = state->data;
+    long i;
+
+    if (data->reference != NULL) {
+        bundleContext_ungetServiceReference(data->context, data->reference);
+    }
+    for (i = 0; i < data->size; i++) {
+        if (data->registrations[i] != NULL) {
+            serviceRegistration_unregister(data->registrations[i]);
+        }
+    }
+    if (data->framework != NULL) {
+        celixLauncher_stop(data->framework);
+        celixLauncher_waitForShutdown(data->framework);
+        celixLauncher_destroy(data->framework);
+    }
+    free(data->registrations);
+    free(data);
+}
+
+static void frameworkBenchmark_getServiceReferences(celix_benchmark_state_t *state) {
+    struct registry_data *data = state->data;
+    char filter[FILTER_LEN];
+    uint64_t i;
+    int j;
+
+    // a service tracker like lookup: a filtered query, followed by releasing all returned references
+    for (i = 0; i < state->iterations && !state->error; i++) {
+        array_list_pt references = NULL;
+
+        snprintf(filter, sizeof(filter), "(&(benchmark.group=%i)(service.vendor=apache))", (int) (i % BENCHMARK_GROUPS));
+        if (bundleContext_getServiceReferences(data->context, BENCHMARK_SERVICE_NAME, filter, &references) != CELIX_SUCCESS) {
+            celixBenchmark_fail(state, "cannot get service references");
+            break;
+        }
+        for (j = 0; j < arrayList_size(references); j++) {
+            bundleContext_ungetServiceReference(data->context, arrayList_get(references, j));
+        }
+        arrayList_destroy(references);
+    }
+    state->itemsProcessed = state->iterations;
+}
+
+static void frameworkBenchmark_getService(celix_benchmark_state_t *state) {
+    struct registry_data *data = state->data;
+    uint64_t i;
+
+    for (i = 0; i < state->iterations; i++) {
+        void *service = NULL;
+        bool result = false;
+
+        bundleContext_getService(data->context, data->reference, &service);
+        celixBenchmark_doNotOptimize(service);
+        bundleContext_ungetService(data->context, data->reference, &result);
+    }
+    state->itemsProcessed = state->iterations;
+}
+
+const celix_benchmark_t frameworkBenchmarks[] = {
+    { "framework/filter_create", NULL, NULL, frameworkBenchmark_filterCreate, NULL },
+    { "framework/filter_match_simple", NULL, frameworkBenchmark_setupSimpleFilter, frameworkBenchmark_filterMatch, frameworkBenchmark_teardownFilter },
+    { "framework/filter_match_complex", NULL, frameworkBenchmark_setupComplexFilter, frameworkBenchmark_filterMatch, frameworkBenchmark_teardownFilter },
+    { "framework/registry_get_service_references", registrySizes, frameworkBenchmark_setupRegistry, frameworkBenchmark_getServiceReferences, frameworkBenchmark_teardownRegistry },
+    { "framework/registry_get_service", registrySizes, frameworkBenchmark_setupRegistry, frameworkBenchmark_getService, frameworkBenchmark_teardownRegistry },
+    { NULL, NULL, NULL, NULL, NULL }
+};
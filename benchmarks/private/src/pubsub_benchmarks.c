@@ -0,0 +1,420 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+/*
+ * pubsub_benchmarks.c
+ *
+ * The in-process part of a pubsub send and receive with the json serializer: looking up the msg serializer, creating
+ * the msg, handing it to the send thread and (de)serializing a message with 10 and 1000 doubles. send_prepare is the
+ * send without the serialization, the per msg overhead of the admin. json_send_threads sends from 1, 2 and 4 threads
+ * to one send thread, the time is per msg. The socket itself is not part of the benchmark, the pubsub end-to-end
+ * benchmarks measure that. udp_wire and udp_wire_legacy send a msg with a 16 and 64 bytes payload with the compact
+ * and with the legacy header over a loopback UDP socket and decode the received header, bytes_per_second is the
+ * wire bandwidth.
+ *
+ *  \author    	<a href="mailto:dev@celix.apache.org">Apache Celix Project Team</a>
+ *  \copyright	Apache License, Version 2.0
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "celix_threads.h"
+#include "hash_map.h"
+#include "celix_trace.h"
+
+#include "pubsub_common.h"
+#include "pubsub_send_descriptor.h"
+#include "pubsub_wire_header.h"
+#include "pubsub_mpsc_queue.h"
+#include "pubsub_serializer_impl.h"
+
+#include "celix_benchmark.h"
+
+#define BENCHMARK_TOPIC "benchmark_topic"
+#define BENCHMARK_MSG_ID 42
+
+#define SAMPLES_MSG_DESCRIPTOR ":header\n" \
+        "type=message\n" \
+        "name=benchmark_samples\n" \
+        "version=1.2.0\n" \
+        ":annotations\n" \
+        ":types\n" \
+        ":message\n" \
+        "{D[Dt ts values name}\n"
+
+struct samples {
+    double ts;
+    struct {
+        uint32_t cap;
+        uint32_t len;
+        double *buf;
+    } values;
+    char *name;
+};
+
+// same layout as the pubsub_msg of the zmq admin
+struct benchmark_msg {
+    pubsub_mpsc_queue_node_t node;
+    struct benchmark_msg *nextPart;
+    unsigned int type;
+    unsigned char header[PUBSUB_WIRE_HEADER_MAX_SIZE];
+    size_t headerSize;
+    char *payload;
+    int payloadSize;
+};
+
+struct pubsub_data {
+    pubsub_mpsc_queue_t sendQueue;
+    volatile unsigned int seqNr;
+    hash_map_pt msgTypes;
+    pubsub_send_descriptors_pt sendDescriptors;
+    unsigned int msgTypeId;
+    pubsub_msg_serializer_t msgSerializer;
+    dyn_message_type *msgType;
+    struct samples samples;
+    void *serialized;
+    size_t serializedLen;
+    int txSocket;
+    int rxSocket;
+    char *payload; //of the udp_wire benchmarks
+};
+
+struct send_thread_data {
+    celix_thread_t thread;
+    struct pubsub_data *data;
+    uint64_t count;
+};
+
+static const long payloadSizes[] = { 10, 1000, CELIX_BENCHMARK_ARGS_END };
+static const long sendThreads[] = { 1, 2, 4, CELIX_BENCHMARK_ARGS_END };
+static const long smallPayloadSizes[] = { 16, 64, CELIX_BENCHMARK_ARGS_END };
+
+static void pubsubBenchmark_init(celix_benchmark_state_t *state, long count) {
+    struct pubsub_data *data = calloc(1, sizeof(*data));
+    FILE *descriptor = fmemopen(SAMPLES_MSG_DESCRIPTOR, strlen(SAMPLES_MSG_DESCRIPTOR), "r");
+    char *name = NULL;
+    long i;
+
+    state->data = data;
+    pubsubMpscQueue_init(&data->sendQueue);
+    data->msgTypes = hashMap_create(NULL, NULL, NULL, NULL);
+    data->txSocket = -1;
+    data->rxSocket = -1;
+
+    if (descriptor == NULL || dynMessage_parse(descriptor, &data->msgType) != 0) {
+        if (descriptor != NULL) {
+            fclose(descriptor);
+        }
+        celixBenchmark_fail(state, "cannot parse message descriptor");
+        return;
+    }
+    fclose(descriptor);
+
+    // filled like pubsubSerializer_addMsgSerializerFromBundle does
+    dynMessage_getName(data->msgType, &name);
+    dynMessage_getVersion(data->msgType, &data->msgSerializer.msgVersion);
+    data->msgSerializer.handle = data->msgType;
+    data->msgSerializer.msgId = BENCHMARK_MSG_ID;
+    data->msgSerializer.msgName = name;
+    data->msgSerializer.serialize = (void *) pubsubMsgSerializer_serialize;
+    data->msgSerializer.deserialize = (void *) pubsubMsgSerializer_deserialize;
+    data->msgSerializer.freeMsg = (void *) pubsubMsgSerializer_freeMsg;
+    hashMap_put(data->msgTypes, (void *) (uintptr_t) BENCHMARK_MSG_ID, &data->msgSerializer);
+
+    // as the publication does when a bundle gets the publisher service
+    if (pubsubSendDescriptors_create(BENCHMARK_TOPIC, data->msgTypes, &data->sendDescriptors) != CELIX_SUCCESS ||
+            pubsubSendDescriptors_localMsgTypeId(data->sendDescriptors, name, &data->msgTypeId) != 0) {
+        celixBenchmark_fail(state, "cannot create send descriptors");
+        return;
+    }
+
+    data->samples.ts = 1500000000.123;
+    data->samples.name = "benchmark.samples";
+    data->samples.values.cap = (uint32_t) count;
+    data->samples.values.len = (uint32_t) count;
+    data->samples.values.buf = calloc(count > 0 ? count : 1, sizeof(double));
+    for (i = 0; i < count; i++) {
+        data->samples.values.buf[i] = i * 1.25;
+    }
+
+    if (data->msgSerializer.serialize(&data->msgSerializer, &data->samples, &data->serialized, &data->serializedLen) != CELIX_SUCCESS) {
+        celixBenchmark_fail(state, "cannot serialize message");
+    }
+}
+
+static void pubsubBenchmark_setup(celix_benchmark_state_t *state) {
+    pubsubBenchmark_init(state, state->arg > 0 ? state->arg : 0);
+}
+
+static void pubsubBenchmark_setupThreads(celix_benchmark_state_t *state) {
+    pubsubBenchmark_init(state, 10);
+}
+
+static void pubsubBenchmark_setupWire(celix_benchmark_state_t *state) {
+    struct pubsub_data *data;
+    struct sockaddr_in addr;
+    socklen_t addrLen = sizeof(addr);
+    int bufSize = 4 * 1024 * 1024;
+
+    pubsubBenchmark_init(state, 0);
+    data = state->data;
+    data->payload = calloc(1, state->arg);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    data->rxSocket = socket(AF_INET, SOCK_DGRAM, 0);
+    data->txSocket = socket(AF_INET, SOCK_DGRAM, 0);
+    if (data->rxSocket < 0 || data->txSocket < 0 ||
+            bind(data->rxSocket, (struct sockaddr *) &addr, sizeof(addr)) != 0 ||
+            getsockname(data->rxSocket, (struct sockaddr *) &addr, &addrLen) != 0 ||
+            connect(data->txSocket, (struct sockaddr *) &addr, sizeof(addr)) != 0) {
+        celixBenchmark_fail(state, "cannot create loopback udp sockets");
+        return;
+    }
+    setsockopt(data->rxSocket, SOL_SOCKET, SO_RCVBUF, &bufSize, sizeof(bufSize));
+}
+
+static void pubsubBenchmark_teardown(celix_benchmark_state_t *state) {
+    struct pubsub_data *data = state->data;
+
+    if (data->txSocket >= 0) {
+        close(data->txSocket);
+    }
+    if (data->rxSocket >= 0) {
+        close(data->rxSocket);
+    }
+    free(data->payload);
+    free(data->serialized);
+    free(data->samples.values.buf);
+    pubsubSendDescriptors_destroy(data->sendDescriptors);
+    if (data->msgType != NULL) {
+        dynMessage_destroy(data->msgType);
+    }
+    hashMap_destroy(data->msgTypes, false, false);
+    free(data);
+}
+
+// mirrors pubsub_createMsg of the zmq admin, the send descriptors do not need a lock
+static struct benchmark_msg *pubsubBenchmark_createMsg(struct pubsub_data *data, bool serialize) {
+    celix_trace_context_t traceContext;
+    pubsub_send_descriptor_t *desc = pubsubSendDescriptors_get(data->sendDescriptors, data->msgTypeId);
+    struct pubsub_msg_header header;
+    struct benchmark_msg *msg;
+    size_t payloadSize = 0;
+
+    if (desc == NULL) {
+        return NULL;
+    }
+    msg = malloc(sizeof(*msg));
+    celixTrace_currentContext(&traceContext);
+    header = desc->header;
+    header.seqNr = __sync_fetch_and_add(&data->seqNr, 1);
+    header.traceId = traceContext.traceId;
+    header.spanId = traceContext.spanId;
+    msg->nextPart = NULL;
+    msg->type = header.type;
+    msg->headerSize = pubsubWireHeader_encode(&header, msg->header);
+    msg->payload = NULL;
+    if (serialize) {
+        desc->msgSer->serialize(desc->msgSer, &data->samples, (void **) &msg->payload, &payloadSize);
+    }
+    msg->payloadSize = (int) payloadSize;
+    return msg;
+}
+
+static void pubsubBenchmark_destroyMsg(struct benchmark_msg *msg) {
+    celixBenchmark_doNotOptimize(msg);
+    free(msg->payload);
+    free(msg);
+}
+
+static void pubsubBenchmark_send(celix_benchmark_state_t *state) {
+    struct pubsub_data *data = state->data;
+    uint64_t i;
+
+    // mirrors pubsub_topicPublicationSendMultipart of the zmq admin, the send thread part (pop) is inlined
+    for (i = 0; i < state->iterations; i++) {
+        celix_trace_span_t span;
+        struct benchmark_msg *msg;
+
+        celixTrace_beginSpan("pubsub.send", BENCHMARK_TOPIC, &span);
+        msg = pubsubBenchmark_createMsg(data, true);
+        if (msg == NULL) {
+            celixTrace_endSpan(&span);
+            celixBenchmark_fail(state, "no send descriptor");
+            break;
+        }
+        state->bytesProcessed += msg->payloadSize;
+        pubsubMpscQueue_push(&data->sendQueue, &msg->node);
+        celixTrace_endSpan(&span);
+
+        pubsubBenchmark_destroyMsg((struct benchmark_msg *) pubsubMpscQueue_pop(&data->sendQueue));
+    }
+    state->itemsProcessed = state->iterations;
+}
+
+static void pubsubBenchmark_sendPrepare(celix_benchmark_state_t *state) {
+    struct pubsub_data *data = state->data;
+    uint64_t i;
+
+    for (i = 0; i < state->iterations; i++) {
+        struct benchmark_msg *msg = pubsubBenchmark_createMsg(data, false);
+        if (msg == NULL) {
+            celixBenchmark_fail(state, "no send descriptor");
+            break;
+        }
+        pubsubMpscQueue_push(&data->sendQueue, &msg->node);
+        pubsubBenchmark_destroyMsg((struct benchmark_msg *) pubsubMpscQueue_pop(&data->sendQueue));
+    }
+    state->itemsProcessed = state->iterations;
+}
+
+static void *pubsubBenchmark_sender(void *handle) {
+    struct send_thread_data *sender = handle;
+    uint64_t i;
+
+    for (i = 0; i < sender->count; i++) {
+        struct benchmark_msg *msg = pubsubBenchmark_createMsg(sender->data, true);
+        pubsubMpscQueue_push(&sender->data->sendQueue, &msg->node);
+    }
+    return NULL;
+}
+
+static void pubsubBenchmark_sendThreads(celix_benchmark_state_t *state) {
+    struct pubsub_data *data = state->data;
+    struct send_thread_data senders[state->arg];
+    uint64_t received = 0;
+    long i;
+
+    for (i = 0; i < state->arg; i++) {
+        senders[i].data = data;
+        senders[i].count = state->iterations / state->arg + (i == 0 ? state->iterations % state->arg : 0);
+        celixThread_create(&senders[i].thread, NULL, pubsubBenchmark_sender, &senders[i]);
+    }
+
+    // this thread is the send thread of the publication
+    while (received < state->iterations) {
+        struct benchmark_msg *msg = (struct benchmark_msg *) pubsubMpscQueue_pop(&data->sendQueue);
+        if (msg != NULL) {
+            state->bytesProcessed += msg->payloadSize;
+            pubsubBenchmark_destroyMsg(msg);
+            received++;
+        } else {
+            sched_yield();
+        }
+    }
+
+    for (i = 0; i < state->arg; i++) {
+        celixThread_join(senders[i].thread, NULL);
+    }
+    state->itemsProcessed = state->iterations;
+}
+
+// sends a msg like the udp_mc admin and decodes the header like its subscription, legacy sends the old header
+static void pubsubBenchmark_udpWire(celix_benchmark_state_t *state, bool legacy) {
+    struct pubsub_data *data = state->data;
+    pubsub_send_descriptor_t *desc = pubsubSendDescriptors_get(data->sendDescriptors, data->msgTypeId);
+    unsigned int payloadSize = (unsigned int) state->arg;
+    char buf[PUBSUB_WIRE_HEADER_MAX_SIZE + sizeof(struct pubsub_legacy_msg_header) + 1024];
+    uint64_t i;
+
+    for (i = 0; i < state->iterations; i++) {
+        struct pubsub_msg_header header = desc->header;
+        struct pubsub_legacy_msg_header legacyHeader;
+        unsigned char encoded[PUBSUB_WIRE_HEADER_MAX_SIZE];
+        struct iovec iov[3];
+        int iovLen = 0;
+        size_t headerSize = 0;
+        ssize_t received;
+
+        header.seqNr = (unsigned int) i;
+        if (legacy) {
+            memset(&legacyHeader, 0, sizeof(legacyHeader));
+            strncpy(legacyHeader.topic, BENCHMARK_TOPIC, MAX_TOPIC_LEN - 1);
+            legacyHeader.type = header.type;
+            legacyHeader.major = header.major;
+            legacyHeader.minor = header.minor;
+            iov[iovLen].iov_base = &legacyHeader;
+            iov[iovLen++].iov_len = sizeof(legacyHeader);
+            iov[iovLen].iov_base = &payloadSize;
+            iov[iovLen++].iov_len = sizeof(payloadSize);
+        } else {
+            iov[iovLen].iov_base = encoded;
+            iov[iovLen++].iov_len = pubsubWireHeader_encode(&header, encoded);
+        }
+        iov[iovLen].iov_base = data->payload;
+        iov[iovLen++].iov_len = payloadSize;
+
+        if (writev(data->txSocket, iov, iovLen) < 0) {
+            celixBenchmark_fail(state, "cannot send udp msg");
+            break;
+        }
+        received = recv(data->rxSocket, buf, sizeof(buf), 0);
+        if (received < 0 || pubsubWireHeader_decode(buf, (size_t) received, &header, &headerSize) != 0 ||
+                header.type != desc->header.type) {
+            celixBenchmark_fail(state, "cannot receive udp msg");
+            break;
+        }
+        state->bytesProcessed += received;
+    }
+    state->itemsProcessed = state->iterations;
+}
+
+static void pubsubBenchmark_udpWireCompact(celix_benchmark_state_t *state) {
+    pubsubBenchmark_udpWire(state, false);
+}
+
+static void pubsubBenchmark_udpWireLegacy(celix_benchmark_state_t *state) {
+    pubsubBenchmark_udpWire(state, true);
+}
+
+static void pubsubBenchmark_receive(celix_benchmark_state_t *state) {
+    struct pubsub_data *data = state->data;
+    uint64_t i;
+
+    for (i = 0; i < state->iterations; i++) {
+        void *msg = NULL;
+        pubsub_msg_serializer_t *msgSer = hashMap_get(data->msgTypes, (void *) (uintptr_t) BENCHMARK_MSG_ID);
+
+        if (msgSer->deserialize(msgSer, data->serialized, data->serializedLen, &msg) != CELIX_SUCCESS) {
+            celixBenchmark_fail(state, "cannot deserialize message");
+            break;
+        }
+        msgSer->freeMsg(msgSer, msg);
+    }
+    state->itemsProcessed = state->iterations;
+    state->bytesProcessed = state->iterations * data->serializedLen;
+}
+
+const celix_benchmark_t pubsubBenchmarks[] = {
+    { "pubsub/send_prepare", NULL, pubsubBenchmark_setup, pubsubBenchmark_sendPrepare, pubsubBenchmark_teardown },
+    { "pubsub/json_send", payloadSizes, pubsubBenchmark_setup, pubsubBenchmark_send, pubsubBenchmark_teardown },
+    { "pubsub/json_send_threads", sendThreads, pubsubBenchmark_setupThreads, pubsubBenchmark_sendThreads, pubsubBenchmark_teardown },
+    { "pubsub/json_receive", payloadSizes, pubsubBenchmark_setup, pubsubBenchmark_receive, pubsubBenchmark_teardown },
+    { "pubsub/udp_wire", smallPayloadSizes, pubsubBenchmark_setupWire, pubsubBenchmark_udpWireCompact, pubsubBenchmark_teardown },
+    { "pubsub/udp_wire_legacy", smallPayloadSizes, pubsubBenchmark_setupWire, pubsubBenchmark_udpWireLegacy, pubsubBenchmark_teardown },
+    { NULL, NULL, NULL, NULL, NULL }
+};
@@ -0,0 +1,162 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+/*
+ * utils_benchmarks.c
+ *
+ * Hash map and properties lookups, the sizes match typical service properties (10) up to large registries (10000).
+ *
+ *  \author    	<a href="mailto:dev@celix.apache.org">Apache Celix Project Team</a>
+ *  \copyright	Apache License, Version 2.0
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "hash_map.h"
+#include "properties.h"
+#include "utils.h"
+
+#include "celix_benchmark.h"
+
+#define KEY_LEN 32
+
+struct string_map_data {
+    hash_map_pt map;
+    char **keys;
+    long size;
+};
+
+static const long mapSizes[] = { 100, 10000, CELIX_BENCHMARK_ARGS_END };
+static const long propertiesSizes[] = { 10, 100, CELIX_BENCHMARK_ARGS_END };
+
+static char **utilsBenchmark_createKeys(long size, const char *prefix) {
+    char **keys = calloc(size, sizeof(*keys));
+    long i;
+
+    for (i = 0; keys != NULL && i < size; i++) {
+        keys[i] = malloc(KEY_LEN);
+        snprintf(keys[i], KEY_LEN, "%s.%li", prefix, i);
+    }
+    return keys;
+}
+
+static void utilsBenchmark_destroyKeys(char **keys, long size) {
+    long i;
+
+    for (i = 0; keys != NULL && i < size; i++) {
+        free(keys[i]);
+    }
+    free(keys);
+}
+
+static void utilsBenchmark_setupStringMap(celix_benchmark_state_t *state) {
+    struct string_map_data *data = calloc(1, sizeof(*data));
+    long i;
+
+    data->size = state->arg;
+    data->keys = utilsBenchmark_createKeys(data->size, "service.key");
+    data->map = hashMap_create(utils_stringHash, NULL, utils_stringEquals, NULL);
+    for (i = 0; i < data->size; i++) {
+        hashMap_put(data->map, data->keys[i], data->keys[i]);
+    }
+    state->data = data;
+}
+
+static void utilsBenchmark_teardownStringMap(celix_benchmark_state_t *state) {
+    struct string_map_data *data = state->data;
+
+    hashMap_destroy(data->map, false, false);
+    utilsBenchmark_destroyKeys(data->keys, data->size);
+    free(data);
+}
+
+static void utilsBenchmark_hashMapGet(celix_benchmark_state_t *state) {
+    struct string_map_data *data = state->data;
+    uint64_t i;
+
+    for (i = 0; i < state->iterations; i++) {
+        void *value = hashMap_get(data->map, data->keys[i % data->size]);
+        celixBenchmark_doNotOptimize(value);
+    }
+    state->itemsProcessed = state->iterations;
+}
+
+static void utilsBenchmark_hashMapPutRemove(celix_benchmark_state_t *state) {
+    struct string_map_data *data = state->data;
+    uint64_t i;
+
+    // remove and re-insert an existing entry, the map keeps its size
+    for (i = 0; i < state->iterations; i++) {
+        char *key = data->keys[i % data->size];
+        hashMap_remove(data->map, key);
+        hashMap_put(data->map, key, key);
+    }
+    state->itemsProcessed = state->iterations;
+}
+
+static void utilsBenchmark_setupProperties(celix_benchmark_state_t *state) {
+    struct string_map_data *data = calloc(1, sizeof(*data));
+    long i;
+
+    data->size = state->arg;
+    data->keys = utilsBenchmark_createKeys(data->size, "service.property");
+    data->map = properties_create();
+    for (i = 0; i < data->size; i++) {
+        properties_set(data->map, data->keys[i], "value");
+    }
+    state->data = data;
+}
+
+static void utilsBenchmark_teardownProperties(celix_benchmark_state_t *state) {
+    struct string_map_data *data = state->data;
+
+    properties_destroy(data->map);
+    utilsBenchmark_destroyKeys(data->keys, data->size);
+    free(data);
+}
+
+static void utilsBenchmark_propertiesGet(celix_benchmark_state_t *state) {
+    struct string_map_data *data = state->data;
+    uint64_t i;
+
+    for (i = 0; i < state->iterations; i++) {
+        const char *value = properties_get(data->map, data->keys[i % data->size]);
+        celixBenchmark_doNotOptimize(value);
+    }
+    state->itemsProcessed = state->iterations;
+}
+
+static void utilsBenchmark_propertiesSet(celix_benchmark_state_t *state) {
+    struct string_map_data *data = state->data;
+    uint64_t i;
+
+    // overwrites an existing key, which frees and duplicates the key and value
+    for (i = 0; i < state->iterations; i++) {
+        properties_set(data->map, data->keys[i % data->size], "other value");
+    }
+    state->itemsProcessed = state->iterations;
+}
+
+const celix_benchmark_t utilsBenchmarks[] = {
+    { "utils/hash_map_get", mapSizes, utilsBenchmark_setupStringMap, utilsBenchmark_hashMapGet, utilsBenchmark_teardownStringMap },
+    { "utils/hash_map_put_remove", mapSizes, utilsBenchmark_setupStringMap, utilsBenchmark_hashMapPutRemove, utilsBenchmark_teardownStringMap },
+    { "utils/properties_get", propertiesSizes, utilsBenchmark_setupProperties, utilsBenchmark_propertiesGet, utilsBenchmark_teardownProperties },
+    { "utils/properties_set", propertiesSizes, utilsBenchmark_setupProperties, utilsBenchmark_propertiesSet, utilsBenchmark_teardownProperties },
+    { NULL, NULL, NULL, NULL, NULL }
+};
@@ -35,6 +35,14 @@
 
 typedef struct updated_thread_pool *updated_thread_pool_pt;
 
+struct updated_thread_pool_statistics {
+	unsigned long pushed;
+	unsigned long delivered;
+	unsigned long coalesced;	// updates replaced by a later update before they were delivered
+	unsigned int pending;	// PIDs with an update waiting to be delivered
+	unsigned int running;	// updates being delivered
+};
+
 /* celix.framework.public */
 #include "bundle_context.h"
 #include "celix_errno.h"
@@ -46,7 +54,9 @@ typedef struct updated_thread_pool *updated_thread_pool_pt;
 
 celix_status_t updatedThreadPool_create( bundle_context_pt context, int maxTreads, updated_thread_pool_pt *updatedThreadPool);
 celix_status_t updatedThreadPool_destroy(updated_thread_pool_pt pool);
-celix_status_t updatedThreadPool_push(updated_thread_pool_pt updatedThreadPool, managed_service_service_pt service, properties_pt properties);
+celix_status_t updatedThreadPool_push(updated_thread_pool_pt updatedThreadPool, char *pid, managed_service_service_pt service, properties_pt properties);
+celix_status_t updatedThreadPool_remove(updated_thread_pool_pt updatedThreadPool, char *pid);
+celix_status_t updatedThreadPool_getStatistics(updated_thread_pool_pt updatedThreadPool, struct updated_thread_pool_statistics *statistics);
 
 
 #endif /* UPDATED_THREAD_POOL_H_ */
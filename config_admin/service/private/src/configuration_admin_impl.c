@@ -192,7 +192,27 @@ celix_status_t configurationAdmin_getConfiguration2(configuration_admin_pt confi
 }
 
 celix_status_t configurationAdmin_listConfigurations(configuration_admin_pt configAdmin, char *filter, array_list_pt *configurations){
-	return CELIX_SUCCESS;
+
+	celix_status_t status;
+	filter_pt configFilter = NULL;
+
+	// (1) filter.create
+	if ( filter != NULL ){
+		configFilter = filter_create(filter);
+		if ( configFilter == NULL ){
+			printf("[ ERROR ]: ConfigAdmin - invalid filter %s \n", filter);
+			*configurations = NULL;
+			return CELIX_ILLEGAL_ARGUMENT;
+		}
+	}
+
+	// (2) configurationStore.listConfigurations
+	status = configurationStore_listConfigurations(configAdmin->configurationStore, configFilter, configurations);
+
+	if ( configFilter != NULL ){
+		filter_destroy(configFilter);
+	}
+	return status;
 }
 
 /* ---------- private ---------- */
@@ -500,6 +500,20 @@ celix_status_t configuration_getBundleLocation2(configuration_impl_pt configurat
 }
 
 static celix_status_t configuration_getFactoryPid2(configuration_impl_pt configuration, bool checkDeleted, char **factoryPid){
+
+	configuration_lock(configuration);
+
+	if ( checkDeleted ){
+		if ( configuration_checkDeleted(configuration) != CELIX_SUCCESS ){
+			configuration_unlock(configuration);
+			return CELIX_ILLEGAL_STATE;
+		}
+	}
+
+	*factoryPid = configuration->factoryPid;
+
+	configuration_unlock(configuration);
+
 	return CELIX_SUCCESS;
 }
 
@@ -25,9 +25,11 @@
  */
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
@@ -40,9 +42,14 @@
 
 /* celix.utils */
 #include "hash_map.h"
+#include "celix_threads.h"
 /* celix.framework */
 #include "properties.h"
 #include "utils.h"
+#include "constants.h"
+#include "filter_private.h"
+/* celix.config_admin.public*/
+#include "configuration_admin.h"
 /* celix.config_admin.private*/
 #include "configuration_admin_factory.h"
 #include "configuration.h"
@@ -52,6 +59,19 @@
 #define PID_EXT ".pid"
 #define MAX_CONFIG_PROPERTY_LEN		128
 
+/*
+ * All configurations are kept in one append-only log. Every save appends a record with all properties of the
+ * configuration and a removal appends a remove record, so the last record of a pid is the one that counts. When
+ * most of the log consists of overwritten records, the live records are copied to a new log which replaces the old one.
+ */
+#define LOG_FILE STORE_DIR "/configurations.log"
+#define LOG_COMPACT_FILE STORE_DIR "/configurations.log.compact"
+#define LOG_RECORD_MAGIC 0x31474643 /* "CFG1" */
+#define LOG_RECORD_PUT 1
+#define LOG_RECORD_REMOVE 2
+#define LOG_COMPACTION_MIN_SIZE (64 * 1024)
+#define LOG_COMPACTION_RATIO 2
+
 
 struct configuration_store {
 
@@ -62,16 +82,52 @@ struct configuration_store {
     configuration_admin_factory_pt configurationAdminFactory;
 
     hash_map_pt configurations;
+    hash_map_pt factoryConfigurations; // factoryPid -> array_list_pt of configuration_pt
 // int createdPidCount;
 
+    int log;
+    hash_map_pt records; // pid -> configuration_store_record_pt, the last put record of every stored pid
+    size_t logSize;
+    size_t liveSize; // total size of the records in the records map, the rest of the log is garbage
+};
+
+/* Record layout: header followed by the pid and the key and value of every property, all '\0' terminated */
+struct configuration_store_record_header {
+    uint32_t magic;
+    uint32_t type;
+    uint32_t length; // of the data following the header
+    uint32_t checksum; // crc32 of type, length and data
+};
+
+struct configuration_store_record {
+    char *pid;
+    off_t offset;
+    size_t size;
 };
 
+typedef struct configuration_store_record *configuration_store_record_pt;
+
+static celix_thread_once_t crcTableInit = CELIX_THREAD_ONCE_INIT;
+static uint32_t crcTable[256];
+
 static celix_status_t configurationStore_createCache(configuration_store_pt store);
-static celix_status_t configurationStore_getConfigurationFile(char *pid, char* storePath, int *file);
-static celix_status_t configurationStore_writeConfigurationFile(int fd, properties_pt properties);
 static celix_status_t configurationStore_readCache(configuration_store_pt store);
+static celix_status_t configurationStore_readLog(configuration_store_pt store, hash_map_pt dictionaries);
+static celix_status_t configurationStore_replayRecord(configuration_store_pt store, hash_map_pt dictionaries, struct configuration_store_record_header *header, const char *data, off_t offset);
+static celix_status_t configurationStore_readLegacyFiles(configuration_store_pt store, hash_map_pt dictionaries);
 static celix_status_t configurationStore_readConfigurationFile(const char *name, int size, properties_pt *dictionary);
 static celix_status_t configurationStore_parseDataConfigurationFile(char *data, properties_pt *dictionary);
+static celix_status_t configurationStore_appendRecord(configuration_store_pt store, uint32_t type, const char *pid, properties_pt properties);
+static void configurationStore_updateRecord(configuration_store_pt store, uint32_t type, const char *pid, off_t offset, size_t size);
+static celix_status_t configurationStore_compactIfNeeded(configuration_store_pt store);
+static celix_status_t configurationStore_compact(configuration_store_pt store);
+static celix_status_t configurationStore_writeFully(int fd, const char *data, size_t size);
+static void configurationStore_indexConfiguration(configuration_store_pt store, configuration_pt configuration);
+static void configurationStore_unindexConfiguration(configuration_store_pt store, const char *pid);
+static void configurationStore_getIndexedValues(filter_pt filter, const char **pid, const char **factoryPid);
+static void configurationStore_addIfMatches(filter_pt filter, configuration_pt configuration, array_list_pt configurations);
+static void configurationStore_initCrcTable(void);
+static uint32_t configurationStore_checksum(struct configuration_store_record_header *header, const char *data);
 
 /* ========== CONSTRUCTOR ========== */
 
@@ -89,14 +145,24 @@ celix_status_t configurationStore_create(bundle_context_pt context, configuratio
     (*store)->configurationAdminFactory = factory;
 
     (*store)->configurations = hashMap_create(utils_stringHash, NULL, utils_stringEquals, NULL);
+    (*store)->factoryConfigurations = hashMap_create(utils_stringHash, NULL, utils_stringEquals, NULL);
+    (*store)->records = hashMap_create(utils_stringHash, NULL, utils_stringEquals, NULL);
+    (*store)->log = -1;
 //	(*store)->createdPidCount = 0;
 
+    celixThread_once(&crcTableInit, configurationStore_initCrcTable);
+
     if (configurationStore_createCache((*store)) != CELIX_SUCCESS) {
         printf("[ ERROR ]: ConfigStore - Not initialized (CACHE) \n");
         return CELIX_ILLEGAL_ARGUMENT;
     }
 
-    celix_status_t mutexStatus = celixThreadMutex_create(&(*store)->mutex, NULL);
+    // recursive, the managed service tracker holds the store lock while it creates and saves configurations
+    celix_thread_mutexattr_t mutexAttr;
+    celixThreadMutexAttr_create(&mutexAttr);
+    celixThreadMutexAttr_settype(&mutexAttr, CELIX_THREAD_MUTEX_RECURSIVE);
+    celix_status_t mutexStatus = celixThreadMutex_create(&(*store)->mutex, &mutexAttr);
+    celixThreadMutexAttr_destroy(&mutexAttr);
     if (mutexStatus != CELIX_SUCCESS) {
         printf("[ ERROR ]: ConfigStore - Not initialized (MUTEX) \n");
         return CELIX_ILLEGAL_ARGUMENT;
@@ -108,6 +174,30 @@ celix_status_t configurationStore_create(bundle_context_pt context, configuratio
 }
 
 celix_status_t configurationStore_destroy(configuration_store_pt store) {
+    hash_map_iterator_pt iterator = NULL;
+
+    if (store->log >= 0) {
+        close(store->log);
+    }
+
+    iterator = hashMapIterator_create(store->records);
+    while (hashMapIterator_hasNext(iterator)) {
+        configuration_store_record_pt record = hashMapIterator_nextValue(iterator);
+        free(record->pid);
+        free(record);
+    }
+    hashMapIterator_destroy(iterator);
+    hashMap_destroy(store->records, false, false);
+
+    iterator = hashMapIterator_create(store->factoryConfigurations);
+    while (hashMapIterator_hasNext(iterator)) {
+        hash_map_entry_pt entry = hashMapIterator_nextEntry(iterator);
+        free(hashMapEntry_getKey(entry));
+        arrayList_destroy(hashMapEntry_getValue(entry));
+    }
+    hashMapIterator_destroy(iterator);
+    hashMap_destroy(store->factoryConfigurations, false, false);
+
     celixThreadMutex_destroy(&store->mutex);
     hashMap_destroy(store->configurations, false, true);
     free(store);
@@ -135,35 +225,53 @@ celix_status_t configurationStore_saveConfiguration(configuration_store_pt store
 
     //(1) config.checkLocked
 
-    //(2) configurationStore.getFile
-    int configFile;
-    status = configurationStore_getConfigurationFile(pid, (char *) STORE_DIR, &configFile);
-    if (status != CELIX_SUCCESS) {
-        return status;
-    }
-
-    //(4) configProperties = config.getAllProperties
+    //(2) configProperties = config.getAllProperties
 
+    properties_pt dictionary = NULL;
     properties_pt configProperties = NULL;
+    configuration_getProperties(configuration->handle, &dictionary);
     status = configuration_getAllProperties(configuration->handle, &configProperties);
     if (status != CELIX_SUCCESS) {
         printf("[ ERROR ]: ConfigStore - config{PID=%s}.getAllProperties \n", pid);
         return status;
     }
 
+    if (configProperties == NULL) { // deleted
+        return CELIX_SUCCESS;
+    }
 
-    //(5) configStore.writeFile(file,properties)
-    status = configurationStore_writeConfigurationFile(configFile, configProperties);
+    //(3) configStore.appendRecord(pid,properties)
+    configurationStore_lock(store);
+    status = configurationStore_appendRecord(store, LOG_RECORD_PUT, pid, configProperties);
+    if (status == CELIX_SUCCESS) {
+        configurationStore_indexConfiguration(store, configuration);
+        configurationStore_compactIfNeeded(store);
+    }
+    configurationStore_unlock(store);
 
-    if (status != CELIX_SUCCESS) {
-        return status;
+    if (dictionary == NULL) {
+        // a configuration without properties hands out a new dictionary with only the automatic properties
+        properties_destroy(configProperties);
     }
 
-    return CELIX_SUCCESS;
+    return status;
 }
 
 celix_status_t configurationStore_removeConfiguration(configuration_store_pt store, char *pid) {
-    return CELIX_SUCCESS;
+
+    celix_status_t status = CELIX_SUCCESS;
+
+    configurationStore_lock(store);
+    if (hashMap_get(store->records, pid) != NULL) {
+        status = configurationStore_appendRecord(store, LOG_RECORD_REMOVE, pid, NULL);
+    }
+    if (status == CELIX_SUCCESS) {
+        configurationStore_unindexConfiguration(store, pid);
+        configurationStore_compactIfNeeded(store);
+    }
+    configurationStore_unlock(store);
+
+    return status;
 }
 
 celix_status_t configurationStore_getConfiguration(configuration_store_pt store, char *pid, char *location, configuration_pt *configuration) {
@@ -171,18 +279,21 @@ celix_status_t configurationStore_getConfiguration(configuration_store_pt store,
     celix_status_t status;
 
     configuration_pt config;
+    configurationStore_lock(store);
     config = hashMap_get(store->configurations, pid);
 
     if (config == NULL) {
 
         status = configuration_create(store->configurationAdminFactory, store, NULL, pid, location, &config);
         if (status != CELIX_SUCCESS) {
+            configurationStore_unlock(store);
             printf("[ ERROR ]: ConfigStore - getConfig(PID=%s) (unable to create) \n", pid);
             return status;
         }
 
-        hashMap_put(store->configurations, pid, config);
+        configurationStore_indexConfiguration(store, config);
     }
+    configurationStore_unlock(store);
 
     *configuration = config;
     return CELIX_SUCCESS;
@@ -194,7 +305,9 @@ celix_status_t configurationStore_createFactoryConfiguration(configuration_store
 
 celix_status_t configurationStore_findConfiguration(configuration_store_pt store, char *pid, configuration_pt *configuration) {
 
+    configurationStore_lock(store);
     *configuration = hashMap_get(store->configurations, pid);
+    configurationStore_unlock(store);
     return CELIX_SUCCESS;
 
 }
@@ -204,6 +317,42 @@ celix_status_t configurationStore_getFactoryConfigurations(configuration_store_p
 }
 
 celix_status_t configurationStore_listConfigurations(configuration_store_pt store, filter_pt filter, array_list_pt *configurations) {
+
+    celix_status_t status;
+    array_list_pt result = NULL;
+    const char *pid = NULL;
+    const char *factoryPid = NULL;
+
+    status = arrayList_create(&result);
+    if (status != CELIX_SUCCESS) {
+        return status;
+    }
+
+    // a filter requiring a pid or factory pid only has to be matched against the configurations indexed on it
+    configurationStore_getIndexedValues(filter, &pid, &factoryPid);
+
+    configurationStore_lock(store);
+    if (pid != NULL) {
+        configuration_pt configuration = hashMap_get(store->configurations, pid);
+        if (configuration != NULL) {
+            configurationStore_addIfMatches(filter, configuration, result);
+        }
+    } else if (factoryPid != NULL) {
+        array_list_pt factoryConfigurations = hashMap_get(store->factoryConfigurations, factoryPid);
+        unsigned int i;
+        for (i = 0; factoryConfigurations != NULL && i < arrayList_size(factoryConfigurations); i++) {
+            configurationStore_addIfMatches(filter, arrayList_get(factoryConfigurations, i), result);
+        }
+    } else {
+        hash_map_iterator_pt iterator = hashMapIterator_create(store->configurations);
+        while (hashMapIterator_hasNext(iterator)) {
+            configurationStore_addIfMatches(filter, hashMapIterator_nextValue(iterator), result);
+        }
+        hashMapIterator_destroy(iterator);
+    }
+    configurationStore_unlock(store);
+
+    *configurations = result;
     return CELIX_SUCCESS;
 }
 
@@ -226,65 +375,145 @@ celix_status_t configurationStore_createCache(configuration_store_pt store) {
 
 }
 
-celix_status_t configurationStore_getConfigurationFile(char *pid, char* storePath, int *file) {
+celix_status_t configurationStore_readCache(configuration_store_pt store) {
 
-    // (1) The full path to the file
-    char fname[PATH_MAX];
-    strcpy(fname, storePath);
-    strcat(fname, "/");
-    strcat(fname, (const char *) pid);
-    strcat(fname, (const char *) PID_EXT);
+    celix_status_t status;
 
-    // (2) configuration.getPool
-    // (3) file.open
-    if ((*file = open((const char*) fname, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR)) < 0) {
-        printf("[ ERROR ]: ConfigStore - getFile(IO_EXCEPTION) \n");
-        return CELIX_FILE_IO_EXCEPTION;
+    hash_map_pt dictionaries = hashMap_create(utils_stringHash, NULL, utils_stringEquals, NULL); // pid -> properties_pt
+
+    // (1) left over of an interrupted compaction, the log itself is still complete
+    unlink(LOG_COMPACT_FILE);
+
+    // (2) log.replay & legacy files.import
+    status = configurationStore_readLog(store, dictionaries);
+    status = CELIX_DO_IF(status, configurationStore_readLegacyFiles(store, dictionaries));
+
+    // (3) new configurations
+    hash_map_iterator_pt iterator = hashMapIterator_create(dictionaries);
+    while (hashMapIterator_hasNext(iterator)) {
+        hash_map_entry_pt entry = hashMapIterator_nextEntry(iterator);
+        properties_pt properties = hashMapEntry_getValue(entry);
+        configuration_pt configuration = NULL;
+
+        if (status == CELIX_SUCCESS) {
+            status = configuration_create2(store->configurationAdminFactory, store, properties, &configuration);
+            if (status == CELIX_SUCCESS) {
+                configurationStore_indexConfiguration(store, configuration);
+            }
+        } else {
+            properties_destroy(properties);
+        }
+        free(hashMapEntry_getKey(entry));
     }
-    return CELIX_SUCCESS;
+    hashMapIterator_destroy(iterator);
+    hashMap_destroy(dictionaries, false, false);
+
+    return CELIX_DO_IF(status, configurationStore_compactIfNeeded(store));
 }
 
-celix_status_t configurationStore_writeConfigurationFile(int file, properties_pt properties) {
+celix_status_t configurationStore_readLog(configuration_store_pt store, hash_map_pt dictionaries) {
+
+    celix_status_t status = CELIX_SUCCESS;
+    struct stat st;
+    char *data = NULL;
+    size_t offset = 0;
 
-    if (properties == NULL || hashMap_size(properties) <= 0) {
+    store->log = open(LOG_FILE, O_CREAT | O_RDWR | O_APPEND, S_IRUSR | S_IWUSR);
+    if (store->log < 0 || fstat(store->log, &st) != 0) {
+        printf("[ ERROR ]: ConfigStore - open Log{%s} (IO_EXCEPTION) \n", LOG_FILE);
+        return CELIX_FILE_IO_EXCEPTION;
+    }
+
+    if (st.st_size == 0) {
         return CELIX_SUCCESS;
     }
-    // size >0
 
-    char buffer[256];
+    data = malloc(st.st_size);
+    if (data == NULL) {
+        return CELIX_ENOMEM;
+    }
 
-    hash_map_iterator_pt iterator = hashMapIterator_create(properties);
-    while (hashMapIterator_hasNext(iterator)) {
+    if (pread(store->log, data, st.st_size, 0) != st.st_size) {
+        printf("[ ERROR ]: ConfigStore - reading Log{%s} \n", LOG_FILE);
+        free(data);
+        return CELIX_FILE_IO_EXCEPTION;
+    }
 
-        hash_map_entry_pt entry = hashMapIterator_nextEntry(iterator);
+    while (offset + sizeof(struct configuration_store_record_header) <= (size_t) st.st_size) {
+        struct configuration_store_record_header header;
+        const char *recordData = data + offset + sizeof(header);
 
-        char* key = hashMapEntry_getKey(entry);
-        char* val = hashMapEntry_getValue(entry);
+        memcpy(&header, data + offset, sizeof(header));
+        if (header.magic != LOG_RECORD_MAGIC || header.length > st.st_size - offset - sizeof(header)
+                || header.checksum != configurationStore_checksum(&header, recordData)
+                || configurationStore_replayRecord(store, dictionaries, &header, recordData, offset) != CELIX_SUCCESS) {
+            break;
+        }
+        offset += sizeof(header) + header.length;
+    }
 
-        snprintf(buffer, 256, "%s=%s\n", key, val);
+    // a record which is not complete or corrupt can only be the result of an interrupted write, drop it
+    if (offset < (size_t) st.st_size) {
+        printf("[ WARNING ]: ConfigStore - dropping %zu bytes of invalid records at the end of Log{%s} \n", (size_t) st.st_size - offset, LOG_FILE);
+        if (ftruncate(store->log, offset) != 0) {
+            status = CELIX_FILE_IO_EXCEPTION;
+        }
+    }
+    store->logSize = offset;
 
-        int buffLength = strlen((const char *) buffer);
+    free(data);
+    return status;
+}
 
-    	if (write(file, (const void *) buffer, buffLength) != buffLength) {
-            printf("[ ERROR ]: ConfigStore - writing in Cache incomplete \n");
-            return CELIX_FILE_IO_EXCEPTION;
+celix_status_t configurationStore_replayRecord(configuration_store_pt store, hash_map_pt dictionaries, struct configuration_store_record_header *header, const char *data, off_t offset) {
+
+    const char *end = data + header->length;
+    const char *pid = data;
+    properties_pt properties = NULL;
+
+    if (header->length == 0 || end[-1] != '\0') {
+        return CELIX_ILLEGAL_ARGUMENT;
+    }
+
+    if (header->type == LOG_RECORD_PUT) {
+        const char *key = pid + strlen(pid) + 1;
+
+        properties = properties_create();
+        while (key < end) {
+            const char *value = key + strlen(key) + 1;
+            if (value >= end) {
+                properties_destroy(properties);
+                return CELIX_ILLEGAL_ARGUMENT;
+            }
+            properties_set(properties, key, value);
+            key = value + strlen(value) + 1;
         }
+    } else if (header->type != LOG_RECORD_REMOVE) {
+        return CELIX_ILLEGAL_ARGUMENT;
     }
-    hashMapIterator_destroy(iterator);
-    return CELIX_SUCCESS;
 
+    // the last record of a pid replaces the earlier ones
+    hash_map_entry_pt entry = hashMap_getEntry(dictionaries, pid);
+    if (entry != NULL) {
+        char *previousPid = hashMapEntry_getKey(entry);
+        properties_destroy(hashMap_remove(dictionaries, pid));
+        free(previousPid);
+    }
+    if (properties != NULL) {
+        hashMap_put(dictionaries, strdup(pid), properties);
+    }
+
+    configurationStore_updateRecord(store, header->type, pid, offset, sizeof(*header) + header->length);
+    return CELIX_SUCCESS;
 }
 
-celix_status_t configurationStore_readCache(configuration_store_pt store) {
+/* Imports the configuration files written per pid by earlier versions into the log */
+celix_status_t configurationStore_readLegacyFiles(configuration_store_pt store, hash_map_pt dictionaries) {
 
-    celix_status_t status;
+    celix_status_t status = CELIX_SUCCESS;
 
     DIR *cache;	// directory handle
 
-    properties_pt properties = NULL;
-    configuration_pt configuration = NULL;
-    char *pid;
-
     // (1) cache.open
     cache = opendir((const char*) STORE_DIR);
     if (cache == NULL) {
@@ -294,45 +523,46 @@ celix_status_t configurationStore_readCache(configuration_store_pt store) {
 
     // (2) directory.read
     struct dirent *dp;
-    int res;
     struct stat st;
-    union {
-        struct dirent d;
-        char b[offsetof (struct dirent, d_name) + NAME_MAX + 1];
-    } u;
-    res = readdir_r(cache, (struct dirent*) &u, &dp);
-    while ((res == 0) && (dp != NULL)) {
-
-        if ((strcmp((dp->d_name), ".") != 0) && (strcmp((dp->d_name), "..") != 0) && (strpbrk(dp->d_name, "~") == NULL)) {
-	    char storeRoot[512];
-            snprintf(storeRoot, sizeof(storeRoot), "%s/%s", STORE_DIR, dp->d_name);
-            // (2.1) file.readData
-            if (stat(storeRoot, &st) == 0) {
-                status = configurationStore_readConfigurationFile(dp->d_name, st.st_size, &properties);
-                if (status != CELIX_SUCCESS) {
-                    closedir(cache);
-                    return status;
-                }
-            }
-            else
-                perror("stat");
-            // (2.2) new configuration
-            status = configuration_create2(store->configurationAdminFactory, store, properties, &configuration);
-            if (status != CELIX_SUCCESS) {
-                closedir(cache);
-                return status;
+    while (status == CELIX_SUCCESS && (dp = readdir(cache)) != NULL) {
+
+        size_t nameLen = strlen(dp->d_name);
+        if (nameLen <= strlen(PID_EXT) || strcmp(dp->d_name + nameLen - strlen(PID_EXT), PID_EXT) != 0 || strpbrk(dp->d_name, "~") != NULL) {
+            continue;
+        }
+
+        char storeRoot[512];
+        properties_pt properties = NULL;
+        snprintf(storeRoot, sizeof(storeRoot), "%s/%s", STORE_DIR, dp->d_name);
+
+        // (2.1) file.readData
+        if (stat(storeRoot, &st) != 0 || configurationStore_readConfigurationFile(dp->d_name, st.st_size, &properties) != CELIX_SUCCESS) {
+            printf("[ ERROR ]: ConfigStore - skipping File{%s} \n", dp->d_name);
+            continue;
+        }
+
+        // (2.2) log.append, unless the log already has a newer version
+        const char *pid = properties_get(properties, (char *) OSGI_FRAMEWORK_SERVICE_PID);
+        if (pid == NULL || hashMap_containsKey(dictionaries, pid)) {
+            properties_destroy(properties);
+        } else {
+            status = configurationStore_appendRecord(store, LOG_RECORD_PUT, pid, properties);
+            if (status == CELIX_SUCCESS) {
+                hashMap_put(dictionaries, strdup(pid), properties);
+            } else {
+                properties_destroy(properties);
             }
+        }
 
-            // (2.3) configurations.put
-            configuration_getPid(configuration->handle, &pid);
-            hashMap_put(store->configurations, pid, configuration);
+        // (2.3) file.remove
+        if (status == CELIX_SUCCESS) {
+            unlink(storeRoot);
         }
-        res = readdir_r(cache, (struct dirent*) &u, &dp);
     }
 
     closedir(cache);
 
-    return CELIX_SUCCESS;
+    return status;
 }
 
 celix_status_t configurationStore_readConfigurationFile(const char *name, int size, properties_pt *dictionary) {
@@ -386,8 +616,7 @@ celix_status_t configurationStore_parseDataConfigurationFile(char *data, propert
 
 
     char *token;
-    char *key;
-    char *value;
+    char *key = NULL;
     char *saveptr;
 
     bool isKey = true;
@@ -396,12 +625,11 @@ celix_status_t configurationStore_parseDataConfigurationFile(char *data, propert
     while (token != NULL) {
 
         if (isKey) {
-            key = strdup(token);
+            key = token;
             isKey = false;
 
         } else { // isValue
-            value = strdup(token);
-            properties_set(properties, key, value);
+            properties_set(properties, key, token);
             isKey = true;
         }
 
@@ -409,9 +637,324 @@ celix_status_t configurationStore_parseDataConfigurationFile(char *data, propert
     }
 
     if (hashMap_isEmpty(properties)) {
+        properties_destroy(properties);
         return CELIX_ILLEGAL_ARGUMENT;
     }
 
     *dictionary = properties;
     return CELIX_SUCCESS;
 }
+
+/* Caller must hold the store lock */
+celix_status_t configurationStore_appendRecord(configuration_store_pt store, uint32_t type, const char *pid, properties_pt properties) {
+
+    celix_status_t status;
+    struct configuration_store_record_header header;
+    hash_map_iterator_pt iterator = NULL;
+    size_t length = strlen(pid) + 1;
+    char *record = NULL;
+    char *pos = NULL;
+
+    // (1) record.size
+    if (properties != NULL) {
+        iterator = hashMapIterator_create(properties);
+        while (hashMapIterator_hasNext(iterator)) {
+            hash_map_entry_pt entry = hashMapIterator_nextEntry(iterator);
+            length += strlen(hashMapEntry_getKey(entry)) + 1 + strlen(hashMapEntry_getValue(entry)) + 1;
+        }
+        hashMapIterator_destroy(iterator);
+    }
+
+    record = malloc(sizeof(header) + length);
+    if (record == NULL) {
+        return CELIX_ENOMEM;
+    }
+
+    // (2) record.data
+    pos = record + sizeof(header);
+    strcpy(pos, pid);
+    pos += strlen(pid) + 1;
+    if (properties != NULL) {
+        iterator = hashMapIterator_create(properties);
+        while (hashMapIterator_hasNext(iterator)) {
+            hash_map_entry_pt entry = hashMapIterator_nextEntry(iterator);
+            char *key = hashMapEntry_getKey(entry);
+            char *value = hashMapEntry_getValue(entry);
+
+            strcpy(pos, key);
+            pos += strlen(key) + 1;
+            strcpy(pos, value);
+            pos += strlen(value) + 1;
+        }
+        hashMapIterator_destroy(iterator);
+    }
+
+    header.magic = LOG_RECORD_MAGIC;
+    header.type = type;
+    header.length = length;
+    header.checksum = configurationStore_checksum(&header, record + sizeof(header));
+    memcpy(record, &header, sizeof(header));
+
+    // (3) log.append
+    status = configurationStore_writeFully(store->log, record, sizeof(header) + length);
+    free(record);
+
+    if (status != CELIX_SUCCESS) {
+        printf("[ ERROR ]: ConfigStore - writing record{PID=%s} in Log incomplete \n", pid);
+        if (ftruncate(store->log, store->logSize) != 0) {
+            printf("[ ERROR ]: ConfigStore - cannot drop incomplete record{PID=%s} \n", pid);
+        }
+        return status;
+    }
+
+    configurationStore_updateRecord(store, type, pid, store->logSize, sizeof(header) + length);
+    store->logSize += sizeof(header) + length;
+
+    return CELIX_SUCCESS;
+}
+
+void configurationStore_updateRecord(configuration_store_pt store, uint32_t type, const char *pid, off_t offset, size_t size) {
+
+    configuration_store_record_pt record = hashMap_get(store->records, pid);
+
+    if (record != NULL) {
+        store->liveSize -= record->size;
+    }
+
+    if (type == LOG_RECORD_PUT) {
+        if (record == NULL) {
+            record = calloc(1, sizeof(*record));
+            record->pid = strdup(pid);
+            hashMap_put(store->records, record->pid, record);
+        }
+        record->offset = offset;
+        record->size = size;
+        store->liveSize += size;
+    } else if (record != NULL) {
+        hashMap_remove(store->records, pid);
+        free(record->pid);
+        free(record);
+    }
+}
+
+celix_status_t configurationStore_compactIfNeeded(configuration_store_pt store) {
+
+    if (store->logSize < LOG_COMPACTION_MIN_SIZE || store->logSize <= LOG_COMPACTION_RATIO * store->liveSize) {
+        return CELIX_SUCCESS;
+    }
+
+    return configurationStore_compact(store);
+}
+
+/* Copies the live records to a new log, which atomically replaces the current one. Caller must hold the store lock */
+celix_status_t configurationStore_compact(configuration_store_pt store) {
+
+    celix_status_t status = CELIX_SUCCESS;
+    unsigned int size = hashMap_size(store->records);
+    configuration_store_record_pt *records = calloc(size + 1, sizeof(*records));
+    off_t *offsets = calloc(size + 1, sizeof(*offsets));
+    char *buffer = NULL;
+    size_t bufferSize = 0;
+    off_t offset = 0;
+    unsigned int i = 0;
+    int compacted = -1;
+
+    if (records == NULL || offsets == NULL) {
+        free(records);
+        free(offsets);
+        return CELIX_ENOMEM;
+    }
+
+    compacted = open(LOG_COMPACT_FILE, O_CREAT | O_TRUNC | O_RDWR | O_APPEND, S_IRUSR | S_IWUSR);
+    if (compacted < 0) {
+        status = CELIX_FILE_IO_EXCEPTION;
+    }
+
+    hash_map_iterator_pt iterator = hashMapIterator_create(store->records);
+    while (status == CELIX_SUCCESS && hashMapIterator_hasNext(iterator)) {
+        configuration_store_record_pt record = hashMapIterator_nextValue(iterator);
+
+        if (record->size > bufferSize) {
+            char *newBuffer = realloc(buffer, record->size);
+            if (newBuffer == NULL) {
+                status = CELIX_ENOMEM;
+                break;
+            }
+            buffer = newBuffer;
+            bufferSize = record->size;
+        }
+
+        if (pread(store->log, buffer, record->size, record->offset) != (ssize_t) record->size) {
+            status = CELIX_FILE_IO_EXCEPTION;
+        }
+        status = CELIX_DO_IF(status, configurationStore_writeFully(compacted, buffer, record->size));
+
+        records[i] = record;
+        offsets[i] = offset;
+        offset += record->size;
+        i++;
+    }
+    hashMapIterator_destroy(iterator);
+
+    if (status == CELIX_SUCCESS && (fdatasync(compacted) != 0 || rename(LOG_COMPACT_FILE, LOG_FILE) != 0)) {
+        status = CELIX_FILE_IO_EXCEPTION;
+    }
+
+    if (status == CELIX_SUCCESS) {
+        close(store->log);
+        store->log = compacted;
+        for (i = 0; i < size; i++) {
+            records[i]->offset = offsets[i];
+        }
+        store->logSize = offset;
+        store->liveSize = offset;
+    } else {
+        printf("[ ERROR ]: ConfigStore - compacting Log{%s} failed, continuing with the current log \n", LOG_FILE);
+        if (compacted >= 0) {
+            close(compacted);
+            unlink(LOG_COMPACT_FILE);
+        }
+    }
+
+    free(buffer);
+    free(offsets);
+    free(records);
+    return status;
+}
+
+celix_status_t configurationStore_writeFully(int fd, const char *data, size_t size) {
+
+    while (size > 0) {
+        ssize_t written = write(fd, data, size);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        } else if (written <= 0) {
+            return CELIX_FILE_IO_EXCEPTION;
+        }
+        data += written;
+        size -= written;
+    }
+
+    return CELIX_SUCCESS;
+}
+
+/* Caller must hold the store lock */
+void configurationStore_indexConfiguration(configuration_store_pt store, configuration_pt configuration) {
+
+    char *pid = NULL;
+    char *factoryPid = NULL;
+
+    configuration_getPid(configuration->handle, &pid);
+    if (pid == NULL || hashMap_containsKey(store->configurations, pid)) {
+        return;
+    }
+    hashMap_put(store->configurations, pid, configuration);
+
+    configuration->configuration_getFactoryPid(configuration->handle, &factoryPid);
+    if (factoryPid != NULL) {
+        array_list_pt factoryConfigurations = hashMap_get(store->factoryConfigurations, factoryPid);
+        if (factoryConfigurations == NULL) {
+            arrayList_create(&factoryConfigurations);
+            hashMap_put(store->factoryConfigurations, strdup(factoryPid), factoryConfigurations);
+        }
+        arrayList_add(factoryConfigurations, configuration);
+    }
+}
+
+/* Caller must hold the store lock */
+void configurationStore_unindexConfiguration(configuration_store_pt store, const char *pid) {
+
+    char *factoryPid = NULL;
+    configuration_pt configuration = hashMap_remove(store->configurations, pid);
+
+    if (configuration == NULL) {
+        return;
+    }
+
+    configuration->configuration_getFactoryPid(configuration->handle, &factoryPid);
+    if (factoryPid != NULL) {
+        hash_map_entry_pt entry = hashMap_getEntry(store->factoryConfigurations, factoryPid);
+        if (entry != NULL) {
+            char *key = hashMapEntry_getKey(entry);
+            array_list_pt factoryConfigurations = hashMapEntry_getValue(entry);
+
+            arrayList_removeElement(factoryConfigurations, configuration);
+            if (arrayList_isEmpty(factoryConfigurations)) {
+                hashMap_remove(store->factoryConfigurations, factoryPid);
+                arrayList_destroy(factoryConfigurations);
+                free(key);
+            }
+        }
+    }
+}
+
+/* Finds the service.pid or service.factoryPid a filter requires to be equal to a value */
+void configurationStore_getIndexedValues(filter_pt filter, const char **pid, const char **factoryPid) {
+
+    if (filter == NULL) {
+        return;
+    }
+
+    if (filter->operand == EQUAL) {
+        if (strcmp(filter->attribute, OSGI_FRAMEWORK_SERVICE_PID) == 0) {
+            *pid = filter->value;
+        } else if (strcmp(filter->attribute, SERVICE_FACTORYPID) == 0) {
+            *factoryPid = filter->value;
+        }
+    } else if (filter->operand == AND) {
+        array_list_pt operands = filter->value;
+        unsigned int i;
+        for (i = 0; i < arrayList_size(operands); i++) {
+            configurationStore_getIndexedValues(arrayList_get(operands, i), pid, factoryPid);
+        }
+    }
+}
+
+void configurationStore_addIfMatches(filter_pt filter, configuration_pt configuration, array_list_pt configurations) {
+
+    properties_pt properties = NULL;
+    bool matches = true;
+
+    // configurations without properties are not listed
+    if (configuration_getProperties(configuration->handle, &properties) != CELIX_SUCCESS || properties == NULL) {
+        return;
+    }
+
+    if (filter != NULL) {
+        filter_match(filter, properties, &matches);
+    }
+    if (matches) {
+        arrayList_add(configurations, configuration);
+    }
+}
+
+void configurationStore_initCrcTable(void) {
+
+    uint32_t i;
+    int bit;
+
+    for (i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (bit = 0; bit < 8; bit++) {
+            crc = (crc & 1) ? 0xEDB88320 ^ (crc >> 1) : crc >> 1;
+        }
+        crcTable[i] = crc;
+    }
+}
+
+uint32_t configurationStore_checksum(struct configuration_store_record_header *header, const char *data) {
+
+    const unsigned char *bytes[3] = { (const unsigned char *) &header->type, (const unsigned char *) &header->length, (const unsigned char *) data };
+    size_t lengths[3] = { sizeof(header->type), sizeof(header->length), header->length };
+    uint32_t crc = 0xFFFFFFFF;
+    int i;
+
+    for (i = 0; i < 3; i++) {
+        size_t j;
+        for (j = 0; j < lengths[i]; j++) {
+            crc = crcTable[(crc ^ bytes[i][j]) & 0xFF] ^ (crc >> 8);
+        }
+    }
+
+    return ~crc;
+}
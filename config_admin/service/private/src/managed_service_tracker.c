@@ -72,7 +72,7 @@ static celix_status_t managedServiceTracker_untrackManagedService(managed_servic
 static celix_status_t managedServiceTracker_getManagedService(managed_service_tracker_pt tracker, char *pid, managed_service_service_pt *service);
 static celix_status_t managedServiceTracker_getManagedServiceReference(managed_service_tracker_pt tracker, char *pid, service_reference_pt *reference);
 //static celix_status_t managedServiceTracker_getPidForManagedService(managed_service_service_pt *service, char **pid);
-celix_status_t managedServiceTracker_asynchUpdated(managed_service_tracker_pt trackerHandle, managed_service_service_pt service, properties_pt properties);
+celix_status_t managedServiceTracker_asynchUpdated(managed_service_tracker_pt trackerHandle, char *pid, managed_service_service_pt service, properties_pt properties);
 
 static celix_status_t managedServiceTracker_getBundleContext(managed_service_tracker_pt trackerHandle, bundle_context_pt *context);
 
@@ -347,7 +347,7 @@ celix_status_t managedServiceTracker_add(managed_service_tracker_pt tracker, ser
 
             // TODO: It must be considered in case of fail if untrack the ManagedService
 
-            return managedServiceTracker_asynchUpdated(tracker, service, NULL);
+            return managedServiceTracker_asynchUpdated(tracker, pid, service, NULL);
 
         } else {
             return CELIX_ILLEGAL_ARGUMENT; // the service was already tracked
@@ -380,7 +380,7 @@ celix_status_t managedServiceTracker_add(managed_service_tracker_pt tracker, ser
                     return CELIX_ILLEGAL_ARGUMENT;
                 }
 
-                status = managedServiceTracker_asynchUpdated(tracker, service, properties);
+                status = managedServiceTracker_asynchUpdated(tracker, pid, service, properties);
 
                 configuration_unlock(configuration->handle);
 
@@ -437,6 +437,9 @@ celix_status_t managedServiceTracker_untrackManagedService(managed_service_track
 	hashMap_remove(tracker->managedServices, pid);
     }
     managedServiceTracker_unlockManagedServicesReferences(tracker);
+
+    // pending updates are dropped, a running update is finished before the service goes away
+    updatedThreadPool_remove(tracker->updatedThreadPool, pid);
     return CELIX_SUCCESS;
 
 }
@@ -487,9 +490,9 @@ celix_status_t managedServiceTracker_getManagedServiceReference(managed_service_
  }
  */
 
-celix_status_t managedServiceTracker_asynchUpdated(managed_service_tracker_pt trackerHandle, managed_service_service_pt service, properties_pt properties) {
+celix_status_t managedServiceTracker_asynchUpdated(managed_service_tracker_pt trackerHandle, char *pid, managed_service_service_pt service, properties_pt properties) {
 
-    return updatedThreadPool_push(trackerHandle->updatedThreadPool, service, properties);
+    return updatedThreadPool_push(trackerHandle->updatedThreadPool, pid, service, properties);
 
 }
 
@@ -562,9 +565,9 @@ celix_status_t managedServiceTracker_notifyUpdated(managed_service_tracker_pt tr
 
     // (5.4) asynchUpdate(service,properties)
     if ((properties == NULL) || (properties != NULL && hashMap_size(properties) == 0)) {
-        return managedServiceTracker_asynchUpdated(tracker, service, NULL);
+        return managedServiceTracker_asynchUpdated(tracker, pid, service, NULL);
     } else {
-        return managedServiceTracker_asynchUpdated(tracker, service, properties);
+        return managedServiceTracker_asynchUpdated(tracker, pid, service, properties);
     }
     return CELIX_ILLEGAL_ARGUMENT;
 }
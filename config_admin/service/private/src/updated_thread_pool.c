@@ -33,32 +33,50 @@
 /* celix.config_admin.UpdatedThreadPool */
 #include "thpool.h"
 #include "updated_thread_pool.h"
+/* celix.utils */
+#include "hash_map.h"
+#include "utils.h"
+#include "celix_threads.h"
 
 
-
+/*
+ * Updates are queued per PID, like the "SerializableTaskQueue" of org.equinox. A PID has at most one job on the
+ * thread pool, so its updates are delivered in order and one at a time. An update pushed while an older one is
+ * still pending replaces it, only the latest properties are delivered.
+ */
 struct updated_thread_pool{
 
 	bundle_context_pt 	context;
 
 	int maxTreads;
 
-	//	apr_thread_mutex_t *mutex;
+	celix_thread_mutex_t mutex;
+	celix_thread_cond_t idle;	// signalled when a PID job is done
 	threadpool threadPool;	//protected by mutex
 
+	hash_map_pt queues;	// pid -> updated_queue_pt, protected by mutex
+	struct updated_thread_pool_statistics statistics;	// protected by mutex
+
 };
 
-typedef struct data_callback *data_callback_t;
+typedef struct updated_queue *updated_queue_pt;
+
+struct updated_queue{
 
-struct data_callback{
+	updated_thread_pool_pt updatedThreadPool;
+	char *pid;
 
 	managed_service_service_pt managedServiceService;
 	properties_pt properties;
 
+	bool pending;	// an update waits to be delivered
+	bool scheduled;	// a job for this PID is on the thread pool or running
+
 };
 
 
 static void *updateThreadPool_updatedCallback(void *data);
-static celix_status_t updatedThreadPool_wrapDataCallback(managed_service_service_pt service, properties_pt properties, data_callback_t *data);
+static celix_status_t updatedThreadPool_schedule(updated_thread_pool_pt updatedThreadPool, updated_queue_pt queue);
 
 
 /* ========== CONSTRUCTOR ========== */
@@ -81,6 +99,14 @@ celix_status_t updatedThreadPool_create(bundle_context_pt context, int maxThread
 	}
 
 	(*updatedThreadPool)->context = context;
+	(*updatedThreadPool)->maxTreads = maxThreads;
+	(*updatedThreadPool)->queues = hashMap_create(utils_stringHash, NULL, utils_stringEquals, NULL);
+
+	if (celixThreadMutex_create(&(*updatedThreadPool)->mutex, NULL) != CELIX_SUCCESS
+			|| celixThreadCondition_init(&(*updatedThreadPool)->idle, NULL) != CELIX_SUCCESS) {
+		printf("[ ERROR ]: UpdatedThreadPool - Not initialized (MUTEX) \n");
+		return CELIX_ILLEGAL_ARGUMENT;
+	}
 
 	printf("[ SUCCESS ]: UpdatedThreadPool - initialized \n");
 	return CELIX_SUCCESS;
@@ -89,6 +115,18 @@ celix_status_t updatedThreadPool_create(bundle_context_pt context, int maxThread
 
 celix_status_t updatedThreadPool_destroy(updated_thread_pool_pt pool) {
 	thpool_destroy(pool->threadPool);
+
+	hash_map_iterator_pt iterator = hashMapIterator_create(pool->queues);
+	while (hashMapIterator_hasNext(iterator)) {
+		updated_queue_pt queue = hashMapIterator_nextValue(iterator);
+		free(queue->pid);
+		free(queue);
+	}
+	hashMapIterator_destroy(iterator);
+	hashMap_destroy(pool->queues, false, false);
+
+	celixThreadCondition_destroy(&pool->idle);
+	celixThreadMutex_destroy(&pool->mutex);
 	free(pool);
 	return CELIX_SUCCESS;
 }
@@ -96,51 +134,139 @@ celix_status_t updatedThreadPool_destroy(updated_thread_pool_pt pool) {
 
 /* ---------- public ---------- */
 
-celix_status_t updatedThreadPool_push(updated_thread_pool_pt updatedThreadPool, managed_service_service_pt service, properties_pt properties){
+celix_status_t updatedThreadPool_push(updated_thread_pool_pt updatedThreadPool, char *pid, managed_service_service_pt service, properties_pt properties){
+
+	celix_status_t status = CELIX_SUCCESS;
+	updated_queue_pt queue = NULL;
+
+	celixThreadMutex_lock(&updatedThreadPool->mutex);
+
+	// (1) queue.get
+	queue = hashMap_get(updatedThreadPool->queues, pid);
+	if (queue == NULL) {
+		queue = calloc(1, sizeof(*queue));
+		if (!queue) {
+			celixThreadMutex_unlock(&updatedThreadPool->mutex);
+			printf("[ ERROR ]: UpdatedThreadPool - push (Queue not initialized) \n");
+			return CELIX_ENOMEM;
+		}
+		queue->updatedThreadPool = updatedThreadPool;
+		queue->pid = strdup(pid);
+		hashMap_put(updatedThreadPool->queues, queue->pid, queue);
+	}
 
-	data_callback_t data = NULL;
+	// (2) queue.replacePending
+	if (queue->pending) {
+		updatedThreadPool->statistics.coalesced++;
+	} else {
+		updatedThreadPool->statistics.pending++;
+	}
+	updatedThreadPool->statistics.pushed++;
 
-	if ( updatedThreadPool_wrapDataCallback(service, properties, &data) != CELIX_SUCCESS ){
-		return CELIX_ILLEGAL_ARGUMENT;
+	queue->managedServiceService = service;
+	queue->properties = properties;
+	queue->pending = true;
+
+	// (3) queue.schedule, unless the job of this PID still has to pick it up
+	if (!queue->scheduled) {
+		status = updatedThreadPool_schedule(updatedThreadPool, queue);
 	}
 
-	if (thpool_add_work(updatedThreadPool->threadPool, updateThreadPool_updatedCallback, data) != 0) {
-		printf("[ ERROR ]: UpdatedThreadPool - add_work \n ");
-		return CELIX_ILLEGAL_STATE;
+	celixThreadMutex_unlock(&updatedThreadPool->mutex);
+
+	return status;
+}
+
+celix_status_t updatedThreadPool_remove(updated_thread_pool_pt updatedThreadPool, char *pid){
+
+	celixThreadMutex_lock(&updatedThreadPool->mutex);
+
+	updated_queue_pt queue = hashMap_remove(updatedThreadPool->queues, pid);
+	if (queue != NULL) {
+		// drop a pending update and wait for a running one, the service may be gone afterwards
+		if (queue->pending) {
+			queue->pending = false;
+			updatedThreadPool->statistics.pending--;
+		}
+		while (queue->scheduled) {
+			celixThreadCondition_wait(&updatedThreadPool->idle, &updatedThreadPool->mutex);
+		}
+		free(queue->pid);
+		free(queue);
 	}
 
+	celixThreadMutex_unlock(&updatedThreadPool->mutex);
+
 	return CELIX_SUCCESS;
 }
 
-/* ---------- private ---------- */
+celix_status_t updatedThreadPool_getStatistics(updated_thread_pool_pt updatedThreadPool, struct updated_thread_pool_statistics *statistics){
 
-void *updateThreadPool_updatedCallback(void *data) {
+	celixThreadMutex_lock(&updatedThreadPool->mutex);
+	*statistics = updatedThreadPool->statistics;
+	celixThreadMutex_unlock(&updatedThreadPool->mutex);
 
-	data_callback_t params = data;
+	return CELIX_SUCCESS;
+}
 
-	managed_service_service_pt managedServiceService = params->managedServiceService;
-	properties_pt properties = params->properties;
+/* ---------- private ---------- */
 
-	(*managedServiceService->updated)(managedServiceService->managedService, properties);
+/* Caller must hold the mutex */
+celix_status_t updatedThreadPool_schedule(updated_thread_pool_pt updatedThreadPool, updated_queue_pt queue){
 
-	free(data);
+	queue->scheduled = true;
 
-	return NULL;
+	if (thpool_add_work(updatedThreadPool->threadPool, updateThreadPool_updatedCallback, queue) != 0) {
+		printf("[ ERROR ]: UpdatedThreadPool - add_work \n ");
+		queue->scheduled = false;
+		queue->pending = false;
+		updatedThreadPool->statistics.pending--;
+		celixThreadCondition_broadcast(&updatedThreadPool->idle);
+		return CELIX_ILLEGAL_STATE;
+	}
 
+	return CELIX_SUCCESS;
 }
 
-celix_status_t updatedThreadPool_wrapDataCallback(managed_service_service_pt service, properties_pt properties, data_callback_t *data){
+void *updateThreadPool_updatedCallback(void *data) {
 
-	*data = calloc(1, sizeof(**data));
+	updated_queue_pt queue = data;
+	updated_thread_pool_pt updatedThreadPool = queue->updatedThreadPool;
+	managed_service_service_pt managedServiceService = NULL;
+	properties_pt properties = NULL;
+	bool deliver = false;
+
+	// (1) queue.takePending
+	celixThreadMutex_lock(&updatedThreadPool->mutex);
+	if (queue->pending) {
+		managedServiceService = queue->managedServiceService;
+		properties = queue->properties;
+		queue->pending = false;
+		deliver = true;
+		updatedThreadPool->statistics.pending--;
+		updatedThreadPool->statistics.running++;
+	}
+	celixThreadMutex_unlock(&updatedThreadPool->mutex);
 
-	if (!*data){
-		printf("[ ERROR ]: UpdatedThreadPool - WrapDataCallback (Data not initialized) \n");
-		return CELIX_ENOMEM;
+	// (2) managedService.updated
+	if (deliver) {
+		(*managedServiceService->updated)(managedServiceService->managedService, properties);
+	}
+
+	// (3) queue.reschedule, at the end of the thread pool so other PIDs get their turn
+	celixThreadMutex_lock(&updatedThreadPool->mutex);
+	if (deliver) {
+		updatedThreadPool->statistics.running--;
+		updatedThreadPool->statistics.delivered++;
+	}
+	if (queue->pending) {
+		updatedThreadPool_schedule(updatedThreadPool, queue);
+	} else {
+		queue->scheduled = false;
+		celixThreadCondition_broadcast(&updatedThreadPool->idle);
 	}
+	celixThreadMutex_unlock(&updatedThreadPool->mutex);
 
-	(*data)->managedServiceService = service;
-	(*data)->properties = properties;
+	return NULL;
 
-	return CELIX_SUCCESS;
 }
-
@@ -0,0 +1,194 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+/*
+ * configuration_store_benchmark.c
+ *
+ * Configuration store benchmark. Saves NR_OF_CONFIGURATIONS factory configurations spread over NR_OF_FACTORIES
+ * factory pids, updates all of them UPDATE_ROUNDS times and loads the store again from a log with a torn record at
+ * the end. Finally lists configurations by factory pid, by pid and with a filter which has to be matched against
+ * every configuration.
+ *
+ *  \author    	<a href="mailto:dev@celix.apache.org">Apache Celix Project Team</a>
+ *  \copyright	Apache License, Version 2.0
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "constants.h"
+#include "filter.h"
+#include "configuration_admin.h"
+#include "configuration_impl.h"
+#include "configuration_store.h"
+
+#define NR_OF_CONFIGURATIONS 10000
+#define NR_OF_FACTORIES 100
+#define UPDATE_ROUNDS 2
+#define NR_OF_LISTINGS 1000
+
+static double storeBenchmark_elapsedMs(struct timespec *begin, struct timespec *end) {
+    return (end->tv_sec - begin->tv_sec) * 1000.0 + (end->tv_nsec - begin->tv_nsec) / 1000000.0;
+}
+
+static long storeBenchmark_logSize(void) {
+    struct stat st;
+    return stat("store/configurations.log", &st) == 0 ? (long) st.st_size : -1;
+}
+
+static int storeBenchmark_save(configuration_store_pt store, int round) {
+    int failures = 0;
+    int i;
+
+    for (i = 0; i < NR_OF_CONFIGURATIONS; ++i) {
+        char value[64];
+        char pid[64];
+        configuration_pt configuration = NULL;
+
+        snprintf(pid, sizeof(pid), "bench.pid.%i", i);
+        configurationStore_findConfiguration(store, pid, &configuration);
+        if (configuration == NULL) {
+            properties_pt properties = properties_create();
+            properties_set(properties, (char *) OSGI_FRAMEWORK_SERVICE_PID, pid);
+            snprintf(value, sizeof(value), "bench.factory.%i", i % NR_OF_FACTORIES);
+            properties_set(properties, SERVICE_FACTORYPID, value);
+            configuration_create2(NULL, store, properties, &configuration);
+        }
+
+        properties_pt dictionary = NULL;
+        configuration_getProperties(configuration->handle, &dictionary);
+        snprintf(value, sizeof(value), "%i", i);
+        properties_set(dictionary, "bench.index", value);
+        snprintf(value, sizeof(value), "%i", i % 7);
+        properties_set(dictionary, "bench.group", value);
+        snprintf(value, sizeof(value), "%i", round);
+        properties_set(dictionary, "bench.round", value);
+        properties_set(dictionary, "bench.description", "a configuration used by the configuration store benchmark");
+
+        if (configurationStore_saveConfiguration(store, pid, configuration) != CELIX_SUCCESS) {
+            failures++;
+        }
+    }
+
+    return failures;
+}
+
+static int storeBenchmark_list(configuration_store_pt store, const char *format, int modulo, int count, int expected) {
+    int failures = 0;
+    int i;
+
+    for (i = 0; i < count; ++i) {
+        char filterStr[128];
+        array_list_pt configurations = NULL;
+
+        snprintf(filterStr, sizeof(filterStr), format, i % modulo);
+        filter_pt filter = filter_create(filterStr);
+        configurationStore_listConfigurations(store, filter, &configurations);
+        if (configurations == NULL || arrayList_size(configurations) != expected) {
+            failures++;
+        }
+        if (configurations != NULL) {
+            arrayList_destroy(configurations);
+        }
+        filter_destroy(filter);
+    }
+
+    return failures;
+}
+
+int main(int argc, char **argv) {
+    configuration_store_pt store = NULL;
+    array_list_pt all = NULL;
+    struct timespec begin;
+    struct timespec end;
+    char dir[] = "/tmp/configuration_store_benchmark_XXXXXX";
+    int failures = 0;
+    int round;
+    int fd;
+
+    if (mkdtemp(dir) == NULL || chdir(dir) != 0) {
+        return EXIT_FAILURE;
+    }
+
+    configurationStore_create(NULL, NULL, &store);
+
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    failures += storeBenchmark_save(store, 0);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("Saved %i configurations in %.3f ms, log is %ld bytes\n", NR_OF_CONFIGURATIONS, storeBenchmark_elapsedMs(&begin, &end), storeBenchmark_logSize());
+
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    for (round = 1; round <= UPDATE_ROUNDS; ++round) {
+        failures += storeBenchmark_save(store, round);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("Updated %i configurations %i times in %.3f ms, log is %ld bytes\n", NR_OF_CONFIGURATIONS, UPDATE_ROUNDS, storeBenchmark_elapsedMs(&begin, &end), storeBenchmark_logSize());
+
+    configurationStore_destroy(store);
+
+    // an interrupted write leaves a partial record behind, which must be dropped when loading
+    fd = open("store/configurations.log", O_WRONLY | O_APPEND);
+    if (fd < 0 || write(fd, "CFG1\x01", 5) != 5) {
+        failures++;
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    configurationStore_create(NULL, NULL, &store);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    configurationStore_listConfigurations(store, NULL, &all);
+    printf("Loaded %i configurations in %.3f ms\n", all != NULL ? arrayList_size(all) : 0, storeBenchmark_elapsedMs(&begin, &end));
+    if (all == NULL || arrayList_size(all) != NR_OF_CONFIGURATIONS) {
+        failures++;
+    }
+    if (all != NULL) {
+        arrayList_destroy(all);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    failures += storeBenchmark_list(store, "(service.factoryPid=bench.factory.%i)", NR_OF_FACTORIES, NR_OF_LISTINGS, NR_OF_CONFIGURATIONS / NR_OF_FACTORIES);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("Listed %i times by factory pid in %.3f ms\n", NR_OF_LISTINGS, storeBenchmark_elapsedMs(&begin, &end));
+
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    failures += storeBenchmark_list(store, "(&(service.pid=bench.pid.%i)(bench.round=2))", NR_OF_CONFIGURATIONS, NR_OF_LISTINGS, 1);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("Listed %i times by pid in %.3f ms\n", NR_OF_LISTINGS, storeBenchmark_elapsedMs(&begin, &end));
+
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    failures += storeBenchmark_list(store, "(bench.index=%i)", NR_OF_CONFIGURATIONS, NR_OF_LISTINGS / 10, 1);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("Listed %i times by a property which is not indexed in %.3f ms\n", NR_OF_LISTINGS / 10, storeBenchmark_elapsedMs(&begin, &end));
+
+    configurationStore_destroy(store);
+
+    unlink("store/configurations.log");
+    rmdir("store");
+    if (chdir("/") == 0) {
+        rmdir(dir);
+    }
+
+    printf("%i failures\n", failures);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
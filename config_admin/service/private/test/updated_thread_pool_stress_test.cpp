@@ -0,0 +1,195 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+/*
+ * updated_thread_pool_stress_test.cpp
+ *
+ * Stress test of the updated thread pool. NR_OF_PRODUCERS threads push NR_OF_UPDATES updates to NR_OF_PIDS managed
+ * services, every producer owns a part of the PIDs. Checks that updates of a PID are never delivered concurrently or
+ * out of order, that the last update of every PID is delivered and that every update is either delivered or coalesced.
+ * Every test runs the stress on its own pool.
+ *
+ *  \author    	<a href="mailto:dev@celix.apache.org">Apache Celix Project Team</a>
+ *  \copyright	Apache License, Version 2.0
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/TestHarness_c.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+extern "C"
+{
+#include "celix_threads.h"
+#include "updated_thread_pool.h"
+}
+
+int main(int argc, char** argv) {
+	return RUN_ALL_TESTS(argc, argv);
+}
+
+#define NR_OF_PIDS 100
+#define NR_OF_UPDATES 100000
+#define UPDATES_PER_PID (NR_OF_UPDATES / NR_OF_PIDS)
+#define NR_OF_PRODUCERS 4
+#define STRESS_TIMEOUT_MS 60000
+
+struct managed_service {
+    char pid[32];
+    properties_pt updates[UPDATES_PER_PID];
+    struct managed_service_service service;
+    int running;
+    int lastSeq;
+    int failures;
+};
+
+struct producer {
+    updated_thread_pool_pt pool;
+    struct managed_service *services;
+    int index;
+};
+
+static double stressTest_elapsedMs(struct timespec *begin, struct timespec *end) {
+    return (end->tv_sec - begin->tv_sec) * 1000.0 + (end->tv_nsec - begin->tv_nsec) / 1000000.0;
+}
+
+static celix_status_t stressTest_updated(managed_service_pt managedService, properties_pt properties) {
+    int seq = atoi(properties_get(properties, "seq"));
+
+    if (__sync_lock_test_and_set(&managedService->running, 1) != 0) {
+        managedService->failures++; // concurrent update of the same PID
+    }
+    if (seq <= managedService->lastSeq) {
+        managedService->failures++; // out of order or delivered twice
+    }
+    managedService->lastSeq = seq;
+    if (seq % 10 == 0) {
+        usleep(50); // let updates pile up
+    }
+    __sync_lock_release(&managedService->running);
+
+    return CELIX_SUCCESS;
+}
+
+static void *stressTest_produce(void *data) {
+    struct producer *producer = (struct producer *) data;
+    int seq;
+    int i;
+
+    for (seq = 0; seq < UPDATES_PER_PID; seq++) {
+        for (i = producer->index; i < NR_OF_PIDS; i += NR_OF_PRODUCERS) {
+            struct managed_service *service = &producer->services[i];
+            updatedThreadPool_push(producer->pool, service->pid, &service->service, service->updates[seq]);
+        }
+    }
+
+    return NULL;
+}
+
+TEST_GROUP(updated_thread_pool_stress) {
+    updated_thread_pool_pt pool;
+    struct managed_service *services;
+    struct updated_thread_pool_statistics statistics;
+
+    void setup() {
+        struct producer producers[NR_OF_PRODUCERS];
+        celix_thread_t threads[NR_OF_PRODUCERS];
+        struct timespec begin;
+        struct timespec end;
+        int waited = 0;
+
+        services = (struct managed_service *) calloc(NR_OF_PIDS, sizeof(*services));
+        for (int i = 0; i < NR_OF_PIDS; i++) {
+            snprintf(services[i].pid, sizeof(services[i].pid), "stress.pid.%i", i);
+            services[i].service.managedService = &services[i];
+            services[i].service.updated = stressTest_updated;
+            services[i].lastSeq = -1;
+            for (int j = 0; j < UPDATES_PER_PID; j++) {
+                char seq[16];
+                snprintf(seq, sizeof(seq), "%i", j);
+                services[i].updates[j] = properties_create();
+                properties_set(services[i].updates[j], "seq", seq);
+            }
+        }
+
+        pool = NULL;
+        updatedThreadPool_create(NULL, MAX_THREADS, &pool);
+
+        clock_gettime(CLOCK_MONOTONIC, &begin);
+        for (int i = 0; i < NR_OF_PRODUCERS; i++) {
+            producers[i].pool = pool;
+            producers[i].services = services;
+            producers[i].index = i;
+            celixThread_create(&threads[i], NULL, stressTest_produce, &producers[i]);
+        }
+        for (int i = 0; i < NR_OF_PRODUCERS; i++) {
+            celixThread_join(threads[i], NULL);
+        }
+
+        updatedThreadPool_getStatistics(pool, &statistics);
+        while ((statistics.pending > 0 || statistics.running > 0) && waited < STRESS_TIMEOUT_MS) {
+            usleep(1000);
+            waited++;
+            updatedThreadPool_getStatistics(pool, &statistics);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        printf("Pushed %lu updates for %i PIDs in %.3f ms, %lu delivered, %lu coalesced, %u pending\n", statistics.pushed, NR_OF_PIDS,
+                stressTest_elapsedMs(&begin, &end), statistics.delivered, statistics.coalesced, statistics.pending);
+    }
+
+    void teardown() {
+        for (int i = 0; i < NR_OF_PIDS; i++) {
+            updatedThreadPool_remove(pool, services[i].pid);
+        }
+        updatedThreadPool_destroy(pool);
+
+        for (int i = 0; i < NR_OF_PIDS; i++) {
+            for (int j = 0; j < UPDATES_PER_PID; j++) {
+                properties_destroy(services[i].updates[j]);
+            }
+        }
+        free(services);
+    }
+};
+
+TEST(updated_thread_pool_stress, updatesOfAPidAreDeliveredInOrderAndOneAtATime) {
+    int failures = 0;
+    for (int i = 0; i < NR_OF_PIDS; i++) {
+        failures += services[i].failures;
+    }
+    LONGS_EQUAL(0, failures);
+}
+
+TEST(updated_thread_pool_stress, lastUpdateOfEveryPidIsDelivered) {
+    int missed = 0;
+    for (int i = 0; i < NR_OF_PIDS; i++) {
+        missed += services[i].lastSeq != UPDATES_PER_PID - 1 ? 1 : 0;
+    }
+    LONGS_EQUAL(0, missed);
+}
+
+TEST(updated_thread_pool_stress, everyUpdateIsDeliveredOrCoalesced) {
+    LONGS_EQUAL(NR_OF_UPDATES, statistics.pushed);
+    LONGS_EQUAL(statistics.pushed, statistics.delivered + statistics.coalesced);
+    LONGS_EQUAL(0, statistics.pending);
+}
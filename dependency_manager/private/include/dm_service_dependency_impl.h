@@ -72,6 +72,8 @@ struct dm_service_dependency {
 
 	service_tracker_pt tracker;
 	service_tracker_customizer_pt tracker_customizer;
+
+	size_t nrOfCallbackInvocations; //only accessed atomically
 };
 
 celix_status_t serviceDependency_start(dm_service_dependency_pt dependency);
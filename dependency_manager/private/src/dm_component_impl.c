@@ -26,6 +26,7 @@
 
 #include <stdarg.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 
 #include "constants.h"
@@ -57,9 +58,18 @@ struct dm_component_struct {
 
     bool setCLanguageProperty;
 
-    hash_map_pt dependencyEvents; //protected by mutex
+    hash_map_pt dependencyEvents; //dependency -> dm_dependency_events_pt, protected by mutex
 
     dm_executor_pt executor;
+
+    bool handleChangeDeferred; //only accessed from the executor thread
+    bool handleChangePending; //only accessed from the executor thread
+
+    //the counters are updated by the executor thread and read by dm info requests, only accessed atomically
+    size_t nrOfTransitions;
+    size_t nrOfCallbackInvocations;
+    size_t nrOfHandledEvents;
+    size_t nrOfCoalescedEvents;
 };
 
 typedef struct dm_interface_struct {
@@ -70,6 +80,7 @@ typedef struct dm_interface_struct {
 } dm_interface_t;
 
 struct dm_executor_struct {
+    dm_component_pt component;
     pthread_t runningThread;
     bool runningThreadSet;
     linked_list_pt workQueue;
@@ -82,6 +93,16 @@ typedef struct dm_executor_task_struct {
     void *data;
 } dm_executor_task_t;
 
+/*
+ * The ordered array is a binary search plus a memmove of at most one pointer per event on add and remove, see the
+ * ranked providers in dm_benchmark for the cost at 1000 providers. It keeps the in order iteration and the first
+ * (highest ranking) event as cheap as an array access, which a tree would not.
+ */
+typedef struct dm_dependency_events_struct {
+    array_list_pt ordered; //events ordered on service ranking, highest ranking first
+    hash_map_pt byServiceId; //service id -> event
+} *dm_dependency_events_pt;
+
 typedef struct dm_handle_event_type_struct {
 	dm_service_dependency_pt dependency;
 	dm_event_pt event;
@@ -89,12 +110,21 @@ typedef struct dm_handle_event_type_struct {
 } *dm_handle_event_type_pt;
 
 static celix_status_t executor_runTasks(dm_executor_pt executor, pthread_t  currentThread __attribute__((unused)));
+static void executor_coalesceTasks(array_list_pt tasks, size_t *coalesced);
 static celix_status_t executor_execute(dm_executor_pt executor);
 static celix_status_t executor_executeTask(dm_executor_pt executor, dm_component_pt component, void (*command), void *data);
 static celix_status_t executor_schedule(dm_executor_pt executor, dm_component_pt component, void (*command), void *data);
-static celix_status_t executor_create(dm_component_pt component __attribute__((unused)), dm_executor_pt *executor);
+static celix_status_t executor_create(dm_component_pt component, dm_executor_pt *executor);
 static void executor_destroy(dm_executor_pt executor);
 
+static dm_dependency_events_pt dependencyEvents_create(void);
+static void dependencyEvents_destroy(dm_dependency_events_pt events, bool destroyEvents);
+static void dependencyEvents_add(dm_dependency_events_pt events, dm_event_pt event);
+static dm_event_pt dependencyEvents_remove(dm_dependency_events_pt events, unsigned long serviceId);
+static bool dependencyEvents_contains(dm_dependency_events_pt events, unsigned long serviceId);
+static unsigned int dependencyEvents_size(dm_dependency_events_pt events);
+static dm_event_pt dependencyEvents_get(dm_dependency_events_pt events, unsigned int index);
+
 static celix_status_t component_invokeRemoveRequiredDependencies(dm_component_pt component);
 static celix_status_t component_invokeRemoveInstanceBoundDependencies(dm_component_pt component);
 static celix_status_t component_invokeRemoveOptionalDependencies(dm_component_pt component);
@@ -111,6 +141,7 @@ static celix_status_t component_allRequiredAvailable(dm_component_pt component,
 static celix_status_t component_performTransition(dm_component_pt component, dm_component_state_t oldState, dm_component_state_t newState, bool *transition);
 static celix_status_t component_calculateNewState(dm_component_pt component, dm_component_state_t currentState, dm_component_state_t *newState);
 static celix_status_t component_handleChange(dm_component_pt component);
+static celix_status_t component_handlePendingChange(dm_component_pt component);
 static celix_status_t component_startDependencies(dm_component_pt component __attribute__((unused)), array_list_pt dependencies);
 static celix_status_t component_getDependencyEvent(dm_component_pt component, dm_service_dependency_pt dependency, dm_event_pt *event_pptr);
 static celix_status_t component_updateInstance(dm_component_pt component, dm_service_dependency_pt dependency, dm_event_pt event, bool update, bool add);
@@ -159,6 +190,14 @@ celix_status_t component_create(bundle_context_pt context, const char *name, dm_
 
         component->setCLanguageProperty = false;
 
+        component->handleChangeDeferred = false;
+        component->handleChangePending = false;
+
+        component->nrOfTransitions = 0;
+        component->nrOfCallbackInvocations = 0;
+        component->nrOfHandledEvents = 0;
+        component->nrOfCoalescedEvents = 0;
+
         component->dependencyEvents = hashMap_create(NULL, NULL, NULL, NULL);
 
         component->executor = NULL;
@@ -193,9 +232,9 @@ void component_destroy(dm_component_pt component) {
 		while(hashMapIterator_hasNext(iter)){
 			hash_map_entry_pt entry = hashMapIterator_nextEntry(iter);
 			dm_service_dependency_pt sdep = (dm_service_dependency_pt)hashMapEntry_getKey(entry);
-			array_list_pt eventList = (array_list_pt)hashMapEntry_getValue(entry);
+			dm_dependency_events_pt events = (dm_dependency_events_pt)hashMapEntry_getValue(entry);
 			serviceDependency_destroy(&sdep);
-			arrayList_destroy(eventList);
+			dependencyEvents_destroy(events, false);
 		}
 		hashMapIterator_destroy(iter);
 
@@ -223,8 +262,7 @@ static celix_status_t component_addTask(dm_component_pt component, dm_service_de
     array_list_pt bounds = NULL;
     arrayList_create(&bounds);
 
-    array_list_pt events = NULL;
-    arrayList_createWithEquals(event_equals, &events);
+    dm_dependency_events_pt events = dependencyEvents_create();
 
     pthread_mutex_lock(&component->mutex);
     hashMap_put(component->dependencyEvents, dep, events);
@@ -277,16 +315,12 @@ celix_status_t component_removeTask(dm_component_pt component, dm_service_depend
     }
 
     pthread_mutex_lock(&component->mutex);
-    array_list_pt events = hashMap_remove(component->dependencyEvents, dependency);
+    dm_dependency_events_pt events = hashMap_remove(component->dependencyEvents, dependency);
     pthread_mutex_unlock(&component->mutex);
 
 	serviceDependency_destroy(&dependency);
 
-    while (!arrayList_isEmpty(events)) {
-    	dm_event_pt event = arrayList_remove(events, 0);
-    	event_destroy(&event);
-    }
-    arrayList_destroy(events);
+    dependencyEvents_destroy(events, true);
 
     component_handleChange(component);
 
@@ -414,6 +448,8 @@ celix_status_t component_handleEvent(dm_component_pt component, dm_service_depen
 celix_status_t component_handleEventTask(dm_component_pt component, dm_handle_event_type_pt data) {
 	celix_status_t status = CELIX_SUCCESS;
 
+	__sync_add_and_fetch(&component->nrOfHandledEvents, 1);
+
 	switch (data->event->event_type) {
 		case DM_EVENT_ADDED:
 			component_handleAdded(component,data->dependency, data->event);
@@ -442,6 +478,7 @@ static celix_status_t component_suspend(dm_component_pt component, dm_service_de
 	dm_service_dependency_strategy_t strategy;
 	serviceDependency_getStrategy(dependency, &strategy);
 	if (strategy == DM_SERVICE_DEPENDENCY_STRATEGY_SUSPEND &&  component->callbackStop != NULL) {
+		__sync_add_and_fetch(&component->nrOfCallbackInvocations, 1);
 		status = component->callbackStop(component->implementation);
 	}
 
@@ -454,6 +491,7 @@ static celix_status_t component_resume(dm_component_pt component, dm_service_dep
 	dm_service_dependency_strategy_t strategy;
 	serviceDependency_getStrategy(dependency, &strategy);
 	if (strategy == DM_SERVICE_DEPENDENCY_STRATEGY_SUSPEND &&  component->callbackStop != NULL) {
+		__sync_add_and_fetch(&component->nrOfCallbackInvocations, 1);
 		status = component->callbackStart(component->implementation);
 	}
 
@@ -464,10 +502,15 @@ celix_status_t component_handleAdded(dm_component_pt component, dm_service_depen
     celix_status_t status = CELIX_SUCCESS;
 
     pthread_mutex_lock(&component->mutex);
-    array_list_pt events = hashMap_get(component->dependencyEvents, dependency);
-    arrayList_add(events, event);
+    dm_dependency_events_pt events = hashMap_get(component->dependencyEvents, dependency);
+    dm_event_pt old = dependencyEvents_remove(events, event->serviceId);
+    dependencyEvents_add(events, event);
     pthread_mutex_unlock(&component->mutex);
 
+    if (old != NULL) {
+        event_destroy(&old);
+    }
+
     serviceDependency_setAvailable(dependency, true);
 
     switch (component->state) {
@@ -520,14 +563,13 @@ celix_status_t component_handleChanged(dm_component_pt component, dm_service_dep
     celix_status_t status = CELIX_SUCCESS;
 
     pthread_mutex_lock(&component->mutex);
-    array_list_pt events = hashMap_get(component->dependencyEvents, dependency);
-    int index = arrayList_indexOf(events, event);
-    if (index < 0) {
+    dm_dependency_events_pt events = hashMap_get(component->dependencyEvents, dependency);
+    dm_event_pt old = dependencyEvents_remove(events, event->serviceId);
+    if (old == NULL) {
 	pthread_mutex_unlock(&component->mutex);
         status = CELIX_BUNDLE_EXCEPTION;
     } else {
-        dm_event_pt old = arrayList_remove(events, (unsigned int) index);
-        arrayList_add(events, event);
+        dependencyEvents_add(events, event);
         pthread_mutex_unlock(&component->mutex);
 
         serviceDependency_invokeSet(dependency, event);
@@ -565,9 +607,9 @@ celix_status_t component_handleRemoved(dm_component_pt component, dm_service_dep
     celix_status_t status = CELIX_SUCCESS;
 
     pthread_mutex_lock(&component->mutex);
-    array_list_pt events = hashMap_get(component->dependencyEvents, dependency);
-    int size = arrayList_size(events);
-    if (arrayList_contains(events, event)) {
+    dm_dependency_events_pt events = hashMap_get(component->dependencyEvents, dependency);
+    int size = dependencyEvents_size(events);
+    if (dependencyEvents_contains(events, event->serviceId)) {
         size--;
     }
     pthread_mutex_unlock(&component->mutex);
@@ -575,12 +617,11 @@ celix_status_t component_handleRemoved(dm_component_pt component, dm_service_dep
     component_handleChange(component);
 
     pthread_mutex_lock(&component->mutex);
-    int index = arrayList_indexOf(events, event);
-    if (index < 0) {
+    dm_event_pt old = dependencyEvents_remove(events, event->serviceId);
+    if (old == NULL) {
 	pthread_mutex_unlock(&component->mutex);
         status = CELIX_BUNDLE_EXCEPTION;
     } else {
-        dm_event_pt old = arrayList_remove(events, (unsigned int) index);
         pthread_mutex_unlock(&component->mutex);
 
 
@@ -627,14 +668,13 @@ celix_status_t component_handleSwapped(dm_component_pt component, dm_service_dep
     celix_status_t status = CELIX_SUCCESS;
 
     pthread_mutex_lock(&component->mutex);
-    array_list_pt events = hashMap_get(component->dependencyEvents, dependency);
-    int index = arrayList_indexOf(events, event);
-    if (index < 0) {
+    dm_dependency_events_pt events = hashMap_get(component->dependencyEvents, dependency);
+    dm_event_pt old = dependencyEvents_remove(events, event->serviceId);
+    if (old == NULL) {
 	pthread_mutex_unlock(&component->mutex);
         status = CELIX_BUNDLE_EXCEPTION;
     } else {
-        dm_event_pt old = arrayList_remove(events, (unsigned int) index);
-        arrayList_add(events, newEvent);
+        dependencyEvents_add(events, newEvent);
         pthread_mutex_unlock(&component->mutex);
 
         serviceDependency_invokeSet(dependency, event);
@@ -744,6 +784,13 @@ celix_status_t component_handleChange(dm_component_pt component) {
     dm_component_state_t newState;
 
     bool transition = false;
+
+    if (component->handleChangeDeferred) {
+        // A batch of dependency events is being applied, the new state is calculated once for the whole batch
+        component->handleChangePending = true;
+        return status;
+    }
+
     do {
         oldState = component->state;
         status = component_calculateNewState(component, oldState, &newState);
@@ -760,6 +807,18 @@ celix_status_t component_handleChange(dm_component_pt component) {
     return status;
 }
 
+static celix_status_t component_handlePendingChange(dm_component_pt component) {
+    celix_status_t status = CELIX_SUCCESS;
+
+    component->handleChangeDeferred = false;
+    if (component->handleChangePending) {
+        component->handleChangePending = false;
+        status = component_handleChange(component);
+    }
+
+    return status;
+}
+
 celix_status_t component_calculateNewState(dm_component_pt component, dm_component_state_t currentState, dm_component_state_t *newState) {
     celix_status_t status = CELIX_SUCCESS;
 
@@ -827,6 +886,10 @@ celix_status_t component_performTransition(dm_component_pt component, dm_compone
     celix_status_t status = CELIX_SUCCESS;
     //printf("performing transition for %s in thread %i from %i to %i\n", component->name, (int) pthread_self(), oldState, newState);
 
+    if (oldState != newState) {
+        __sync_add_and_fetch(&component->nrOfTransitions, 1);
+    }
+
     if (oldState == newState) {
         *transition = false;
     } else if (oldState == DM_CMP_STATE_INACTIVE && newState == DM_CMP_STATE_WAITING_FOR_REQUIRED) {
@@ -836,6 +899,7 @@ celix_status_t component_performTransition(dm_component_pt component, dm_compone
         component_invokeAddRequiredDependencies(component);
         component_invokeAutoConfigDependencies(component);
         if (component->callbackInit) {
+        	__sync_add_and_fetch(&component->nrOfCallbackInvocations, 1);
         	status = component->callbackInit(component->implementation);
         }
         *transition = true;
@@ -844,6 +908,7 @@ celix_status_t component_performTransition(dm_component_pt component, dm_compone
         component_invokeAutoConfigInstanceBoundDependencies(component);
 		component_invokeAddOptionalDependencies(component);
         if (component->callbackStart) {
+        	__sync_add_and_fetch(&component->nrOfCallbackInvocations, 1);
         	status = component->callbackStart(component->implementation);
         }
         component_registerServices(component);
@@ -851,6 +916,7 @@ celix_status_t component_performTransition(dm_component_pt component, dm_compone
     } else if (oldState == DM_CMP_STATE_TRACKING_OPTIONAL && newState == DM_CMP_STATE_INSTANTIATED_AND_WAITING_FOR_REQUIRED) {
         component_unregisterServices(component);
         if (component->callbackStop) {
+        	__sync_add_and_fetch(&component->nrOfCallbackInvocations, 1);
         	status = component->callbackStop(component->implementation);
         }
 		component_invokeRemoveOptionalDependencies(component);
@@ -858,6 +924,7 @@ celix_status_t component_performTransition(dm_component_pt component, dm_compone
         *transition = true;
     } else if (oldState == DM_CMP_STATE_INSTANTIATED_AND_WAITING_FOR_REQUIRED && newState == DM_CMP_STATE_WAITING_FOR_REQUIRED) {
     	if (component->callbackDeinit) {
+    		__sync_add_and_fetch(&component->nrOfCallbackInvocations, 1);
     		status = component->callbackDeinit(component->implementation);
     	}
         component_invokeRemoveRequiredDependencies(component);
@@ -938,10 +1005,10 @@ celix_status_t component_invokeAddRequiredDependencies(dm_component_pt component
         serviceDependency_isInstanceBound(dependency, &instanceBound);
 
         if (required && !instanceBound) {
-            array_list_pt events = hashMap_get(component->dependencyEvents, dependency);
+            dm_dependency_events_pt events = hashMap_get(component->dependencyEvents, dependency);
             if (events) {
-				for (unsigned int j = 0; j < arrayList_size(events); j++) {
-					dm_event_pt event = arrayList_get(events, j);
+				for (unsigned int j = 0; j < dependencyEvents_size(events); j++) {
+					dm_event_pt event = dependencyEvents_get(events, j);
 					serviceDependency_invokeAdd(dependency, event);
 				}
             }
@@ -1010,10 +1077,10 @@ celix_status_t component_invokeAddRequiredInstanceBoundDependencies(dm_component
         serviceDependency_isInstanceBound(dependency, &instanceBound);
 
         if (instanceBound && required) {
-            array_list_pt events = hashMap_get(component->dependencyEvents, dependency);
+            dm_dependency_events_pt events = hashMap_get(component->dependencyEvents, dependency);
             if (events) {
-				for (unsigned int j = 0; j < arrayList_size(events); j++) {
-					dm_event_pt event = arrayList_get(events, j);
+				for (unsigned int j = 0; j < dependencyEvents_size(events); j++) {
+					dm_event_pt event = dependencyEvents_get(events, j);
 					serviceDependency_invokeAdd(dependency, event);
 				}
             }
@@ -1036,10 +1103,10 @@ celix_status_t component_invokeAddOptionalDependencies(dm_component_pt component
         serviceDependency_isRequired(dependency, &required);
 
         if (!required) {
-            array_list_pt events = hashMap_get(component->dependencyEvents, dependency);
+            dm_dependency_events_pt events = hashMap_get(component->dependencyEvents, dependency);
             if (events) {
-				for (unsigned int j = 0; j < arrayList_size(events); j++) {
-					dm_event_pt event = arrayList_get(events, j);
+				for (unsigned int j = 0; j < dependencyEvents_size(events); j++) {
+					dm_event_pt event = dependencyEvents_get(events, j);
 					serviceDependency_invokeAdd(dependency, event);
 				}
             }
@@ -1062,10 +1129,10 @@ celix_status_t component_invokeRemoveOptionalDependencies(dm_component_pt compon
         serviceDependency_isRequired(dependency, &required);
 
         if (!required) {
-            array_list_pt events = hashMap_get(component->dependencyEvents, dependency);
+            dm_dependency_events_pt events = hashMap_get(component->dependencyEvents, dependency);
             if (events) {
-				for (unsigned int j = 0; j < arrayList_size(events); j++) {
-					dm_event_pt event = arrayList_get(events, j);
+				for (unsigned int j = 0; j < dependencyEvents_size(events); j++) {
+					dm_event_pt event = dependencyEvents_get(events, j);
 					serviceDependency_invokeRemove(dependency, event);
 				}
             }
@@ -1088,10 +1155,10 @@ celix_status_t component_invokeRemoveInstanceBoundDependencies(dm_component_pt c
         serviceDependency_isInstanceBound(dependency, &instanceBound);
 
         if (instanceBound) {
-            array_list_pt events = hashMap_get(component->dependencyEvents, dependency);
+            dm_dependency_events_pt events = hashMap_get(component->dependencyEvents, dependency);
             if (events) {
-				for (unsigned int j = 0; j < arrayList_size(events); j++) {
-					dm_event_pt event = arrayList_get(events, j);
+				for (unsigned int j = 0; j < dependencyEvents_size(events); j++) {
+					dm_event_pt event = dependencyEvents_get(events, j);
 					serviceDependency_invokeRemove(dependency, event);
 				}
             }
@@ -1116,10 +1183,10 @@ celix_status_t component_invokeRemoveRequiredDependencies(dm_component_pt compon
         serviceDependency_isInstanceBound(dependency, &instanceBound);
 
         if (!instanceBound && required) {
-            array_list_pt events = hashMap_get(component->dependencyEvents, dependency);
+            dm_dependency_events_pt events = hashMap_get(component->dependencyEvents, dependency);
             if (events) {
-				for (unsigned int j = 0; j < arrayList_size(events); j++) {
-					dm_event_pt event = arrayList_get(events, j);
+				for (unsigned int j = 0; j < dependencyEvents_size(events); j++) {
+					dm_event_pt event = dependencyEvents_get(events, j);
 					serviceDependency_invokeRemove(dependency, event);
 				}
             }
@@ -1130,25 +1197,87 @@ celix_status_t component_invokeRemoveRequiredDependencies(dm_component_pt compon
     return status;
 }
 
+static dm_dependency_events_pt dependencyEvents_create(void) {
+    dm_dependency_events_pt events = calloc(1, sizeof(*events));
+    if (events != NULL) {
+        arrayList_create(&events->ordered);
+        events->byServiceId = hashMap_create(NULL, NULL, NULL, NULL);
+    }
+    return events;
+}
+
+static void dependencyEvents_destroy(dm_dependency_events_pt events, bool destroyEvents) {
+    if (events != NULL) {
+        if (destroyEvents) {
+            for (unsigned int i = 0; i < arrayList_size(events->ordered); i++) {
+                dm_event_pt event = arrayList_get(events->ordered, i);
+                event_destroy(&event);
+            }
+        }
+        arrayList_destroy(events->ordered);
+        hashMap_destroy(events->byServiceId, false, false);
+        free(events);
+    }
+}
+
+/**
+ * Returns the index of the first event which ranks lower than or equal to the provided event.
+ */
+static unsigned int dependencyEvents_search(dm_dependency_events_pt events, dm_event_pt event) {
+    unsigned int low = 0;
+    unsigned int high = arrayList_size(events->ordered);
+    while (low < high) {
+        unsigned int mid = low + (high - low) / 2;
+        int compare = 0;
+        event_compareTo(arrayList_get(events->ordered, mid), event, &compare);
+        if (compare > 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+static void dependencyEvents_add(dm_dependency_events_pt events, dm_event_pt event) {
+    arrayList_addIndex(events->ordered, dependencyEvents_search(events, event), event);
+    hashMap_put(events->byServiceId, (void*)(uintptr_t)event->serviceId, event);
+}
+
+static dm_event_pt dependencyEvents_remove(dm_dependency_events_pt events, unsigned long serviceId) {
+    dm_event_pt event = hashMap_remove(events->byServiceId, (void*)(uintptr_t)serviceId);
+    if (event != NULL) {
+        unsigned int index = dependencyEvents_search(events, event);
+        if (index < arrayList_size(events->ordered) && arrayList_get(events->ordered, index) == event) {
+            arrayList_remove(events->ordered, index);
+        } else {
+            arrayList_removeElement(events->ordered, event);
+        }
+    }
+    return event;
+}
+
+static bool dependencyEvents_contains(dm_dependency_events_pt events, unsigned long serviceId) {
+    return hashMap_containsKey(events->byServiceId, (void*)(uintptr_t)serviceId);
+}
+
+static unsigned int dependencyEvents_size(dm_dependency_events_pt events) {
+    return arrayList_size(events->ordered);
+}
+
+static dm_event_pt dependencyEvents_get(dm_dependency_events_pt events, unsigned int index) {
+    return arrayList_get(events->ordered, index);
+}
+
 celix_status_t component_getDependencyEvent(dm_component_pt component, dm_service_dependency_pt dependency, dm_event_pt *event_pptr) {
     celix_status_t status = CELIX_SUCCESS;
 
-    array_list_pt events = hashMap_get(component->dependencyEvents, dependency);
+    dm_dependency_events_pt events = hashMap_get(component->dependencyEvents, dependency);
     *event_pptr = NULL;
 
-    if (events) {
-        for (unsigned int j = 0; j < arrayList_size(events); j++) {
-            dm_event_pt event_ptr = arrayList_get(events, j);
-            if (*event_pptr != NULL) {
-                int compare = 0;
-                event_compareTo(event_ptr, *event_pptr, &compare);
-                if (compare > 0) {
-                    *event_pptr = event_ptr;
-                }
-            } else {
-                *event_pptr = event_ptr;
-            }
-        }
+    if (events && dependencyEvents_size(events) > 0) {
+        //events are ordered on ranking, the first event is the highest ranking event
+        *event_pptr = dependencyEvents_get(events, 0);
     }
 
     return status;
@@ -1159,7 +1288,7 @@ celix_status_t component_configureImplementation(dm_component_pt component, dm_s
 
     const void **field = NULL;
 
-    array_list_pt events = hashMap_get(component->dependencyEvents, dependency);
+    dm_dependency_events_pt events = hashMap_get(component->dependencyEvents, dependency);
     if (events) {
         const void *service = NULL;
         dm_event_pt event = NULL;
@@ -1250,13 +1379,14 @@ celix_status_t component_getBundleContext(dm_component_pt component, bundle_cont
 }
 
 
-static celix_status_t executor_create(dm_component_pt component __attribute__((unused)), dm_executor_pt *executor) {
+static celix_status_t executor_create(dm_component_pt component, dm_executor_pt *executor) {
     celix_status_t status = CELIX_SUCCESS;
 
     *executor = malloc(sizeof(**executor));
     if (!*executor) {
         status = CELIX_ENOMEM;
     } else {
+        (*executor)->component = component;
         linkedList_create(&(*executor)->workQueue);
         pthread_mutex_init(&(*executor)->mutex, NULL);
         (*executor)->runningThreadSet = false;
@@ -1333,32 +1463,145 @@ static celix_status_t executor_execute(dm_executor_pt executor) {
     return status;
 }
 
+static bool executor_isEventTask(dm_executor_task_t *task) {
+    return task != NULL && (void *) task->command == (void *) component_handleEventTask;
+}
+
+static bool executor_isDeferrableTask(dm_executor_task_t *task) {
+    bool deferrable = false;
+    if (executor_isEventTask(task)) {
+        dm_handle_event_type_pt data = task->data;
+        // Removals are never deferred, the component must leave its state before the service is gone
+        deferrable = data->event->event_type == DM_EVENT_ADDED || data->event->event_type == DM_EVENT_CHANGED;
+    }
+    return deferrable;
+}
+
+static void executor_destroyEventTask(dm_executor_task_t *task) {
+    dm_handle_event_type_pt data = task->data;
+    event_destroy(&data->event);
+    free(data);
+    free(task);
+}
+
+/**
+ * Coalesces the dependency events queued for a component. Events of a service which is added and removed
+ * again in the same batch cancel each other out and only the last change event of a service is kept.
+ * Non event tasks (start, stop, adding/removing dependencies) are never reordered or coalesced across.
+ */
+static void executor_coalesceTasks(array_list_pt tasks, size_t *coalesced) {
+    unsigned int i = 0;
+
+    while (i < arrayList_size(tasks)) {
+        dm_executor_task_t *task = arrayList_get(tasks, i);
+        dm_handle_event_type_pt data = NULL;
+        int match = -1;
+        int j;
+
+        if (!executor_isEventTask(task)) {
+            i++;
+            continue;
+        }
+        data = task->data;
+        if (data->event->event_type != DM_EVENT_REMOVED && data->event->event_type != DM_EVENT_CHANGED) {
+            i++;
+            continue;
+        }
+
+        //search backwards for an earlier event of the same service, up to the first non event task
+        for (j = (int) i - 1; j >= 0; --j) {
+            dm_executor_task_t *prev = arrayList_get(tasks, (unsigned int) j);
+            dm_handle_event_type_pt prevData = NULL;
+            if (!executor_isEventTask(prev)) {
+                break;
+            }
+            prevData = prev->data;
+            if (prevData->dependency == data->dependency && prevData->event->serviceId == data->event->serviceId) {
+                if (prevData->event->event_type == DM_EVENT_ADDED || prevData->event->event_type == DM_EVENT_CHANGED) {
+                    match = j;
+                }
+                break;
+            }
+        }
+
+        if (match < 0) {
+            i++;
+            continue;
+        }
+
+        dm_executor_task_t *matchTask = arrayList_get(tasks, (unsigned int) match);
+        dm_handle_event_type_pt matchData = matchTask->data;
+        if (data->event->event_type == DM_EVENT_CHANGED) {
+            //only the last change of a service has to be applied, an add followed by a change stays an add
+            dm_event_pt old = matchData->event;
+            data->event->event_type = old->event_type;
+            matchData->event = data->event;
+            data->event = old;
+            arrayList_remove(tasks, i);
+            executor_destroyEventTask(task);
+            *coalesced += 1;
+        } else if (matchData->event->event_type == DM_EVENT_ADDED) {
+            //added and removed in the same batch, the component does not have to know
+            arrayList_remove(tasks, i);
+            arrayList_remove(tasks, (unsigned int) match);
+            executor_destroyEventTask(task);
+            executor_destroyEventTask(matchTask);
+            *coalesced += 2;
+            i--;
+        } else {
+            //a change followed by a removal, only the removal has to be applied
+            arrayList_remove(tasks, (unsigned int) match);
+            executor_destroyEventTask(matchTask);
+            *coalesced += 1;
+        }
+    }
+}
+
 static celix_status_t executor_runTasks(dm_executor_pt executor, pthread_t currentThread __attribute__((unused))) {
     celix_status_t status = CELIX_SUCCESS;
-//    bool execute = false;
+    dm_component_pt component = executor->component;
+    bool done = false;
 
     do {
         dm_executor_task_t *entry = NULL;
+        array_list_pt batch = NULL;
+        unsigned int i;
+        size_t coalesced = 0;
+
+        //take all queued tasks at once, so that the dependency events can be applied as one batch
+        arrayList_create(&batch);
         pthread_mutex_lock(&executor->mutex);
         while ((entry = linkedList_removeFirst(executor->workQueue)) != NULL) {
-            pthread_mutex_unlock(&executor->mutex);
+            arrayList_add(batch, entry);
+        }
+        pthread_mutex_unlock(&executor->mutex);
 
-            entry->command(entry->component, entry->data);
+        executor_coalesceTasks(batch, &coalesced);
+        __sync_add_and_fetch(&component->nrOfCoalescedEvents, coalesced);
 
-            pthread_mutex_lock(&executor->mutex);
+        for (i = 0; i < arrayList_size(batch); i++) {
+            entry = arrayList_get(batch, i);
+
+            if (executor_isDeferrableTask(entry)) {
+                component->handleChangeDeferred = true;
+            } else {
+                component_handlePendingChange(component);
+            }
+
+            entry->command(entry->component, entry->data);
 
             free(entry);
         }
-        executor->runningThreadSet = false;
-        pthread_mutex_unlock(&executor->mutex);
+        component_handlePendingChange(component);
+        arrayList_destroy(batch);
 
-//        pthread_mutex_lock(&executor->mutex);
-//        if (executor->runningThread == NULL) {
-//            executor->runningThread = currentThread;
-//            execute = true;
-//        }
-//        pthread_mutex_unlock(&executor->mutex);
-    } while (!linkedList_isEmpty(executor->workQueue)); // && execute
+        pthread_mutex_lock(&executor->mutex);
+        if (linkedList_isEmpty(executor->workQueue)) {
+            executor->runningThreadSet = false;
+            done = true;
+        }
+        pthread_mutex_unlock(&executor->mutex);
+    } while (!done);
 
     return status;
 }
@@ -1399,6 +1642,11 @@ celix_status_t component_getComponentInfo(dm_component_pt component, dm_componen
             break;
     }
 
+    info->nrOfTransitions = __sync_add_and_fetch(&component->nrOfTransitions, 0);
+    info->nrOfCallbackInvocations = __sync_add_and_fetch(&component->nrOfCallbackInvocations, 0);
+    info->nrOfHandledEvents = __sync_add_and_fetch(&component->nrOfHandledEvents, 0);
+    info->nrOfCoalescedEvents = __sync_add_and_fetch(&component->nrOfCoalescedEvents, 0);
+
     celixThreadMutex_lock(&component->mutex);
     size = arrayList_size(component->dependencies);
     for (i = 0; i < size; i += 1) {
@@ -1406,6 +1654,7 @@ celix_status_t component_getComponentInfo(dm_component_pt component, dm_componen
         dm_service_dependency_info_pt depInfo = NULL;
         status = serviceDependency_getServiceDependencyInfo(dep, &depInfo);
         if (status == CELIX_SUCCESS) {
+            info->nrOfCallbackInvocations += depInfo->nrOfCallbackInvocations;
             arrayList_add(info->dependency_list, depInfo);
         } else {
             break;
@@ -79,6 +79,8 @@ celix_status_t serviceDependency_create(dm_service_dependency_pt *dependency_ptr
 
 		(*dependency_ptr)->tracker = NULL;
 		(*dependency_ptr)->tracker_customizer = NULL;
+
+		(*dependency_ptr)->nrOfCallbackInvocations = 0;
 	}
 
 	return status;
@@ -496,9 +498,11 @@ celix_status_t serviceDependency_invokeSet(dm_service_dependency_pt dependency,
 		}
 
 		if (dependency->set) {
+			__sync_add_and_fetch(&dependency->nrOfCallbackInvocations, 1);
 			dependency->set(serviceDependency_getCallbackHandle(dependency), service);
 		}
 		if (dependency->set_with_ref) {
+			__sync_add_and_fetch(&dependency->nrOfCallbackInvocations, 1);
 			dependency->set_with_ref(serviceDependency_getCallbackHandle(dependency), curServRef, service);
 		}
 
@@ -519,9 +523,11 @@ celix_status_t serviceDependency_invokeAdd(dm_service_dependency_pt dependency,
 
 	if (status == CELIX_SUCCESS) {
 		if (dependency->add) {
+			__sync_add_and_fetch(&dependency->nrOfCallbackInvocations, 1);
 			dependency->add(serviceDependency_getCallbackHandle(dependency), event->service);
 		}
 		if (dependency->add_with_ref) {
+			__sync_add_and_fetch(&dependency->nrOfCallbackInvocations, 1);
 			dependency->add_with_ref(serviceDependency_getCallbackHandle(dependency), event->reference, event->service);
 		}
 	}
@@ -538,9 +544,11 @@ celix_status_t serviceDependency_invokeChange(dm_service_dependency_pt dependenc
 
 	if (status == CELIX_SUCCESS) {
 		if (dependency->change) {
+			__sync_add_and_fetch(&dependency->nrOfCallbackInvocations, 1);
 			dependency->change(serviceDependency_getCallbackHandle(dependency), event->service);
 		}
 		if (dependency->change_with_ref) {
+			__sync_add_and_fetch(&dependency->nrOfCallbackInvocations, 1);
 			dependency->change_with_ref(serviceDependency_getCallbackHandle(dependency), event->reference, event->service);
 		}
 	}
@@ -557,9 +565,11 @@ celix_status_t serviceDependency_invokeRemove(dm_service_dependency_pt dependenc
 
 	if (status == CELIX_SUCCESS) {
 		if (dependency->remove) {
+			__sync_add_and_fetch(&dependency->nrOfCallbackInvocations, 1);
 			dependency->remove(serviceDependency_getCallbackHandle(dependency), event->service);
 		}
 		if (dependency->remove_with_ref) {
+			__sync_add_and_fetch(&dependency->nrOfCallbackInvocations, 1);
 			dependency->remove_with_ref(serviceDependency_getCallbackHandle(dependency), event->reference, event->service);
 		}
 	}
@@ -576,9 +586,11 @@ celix_status_t serviceDependency_invokeSwap(dm_service_dependency_pt dependency,
 
 	if (status == CELIX_SUCCESS) {
 		if (dependency->swap) {
+			__sync_add_and_fetch(&dependency->nrOfCallbackInvocations, 1);
 			dependency->swap(serviceDependency_getCallbackHandle(dependency), event->service, newEvent->service);
 		}
 		if (dependency->swap_with_ref) {
+			__sync_add_and_fetch(&dependency->nrOfCallbackInvocations, 1);
 			dependency->swap_with_ref(serviceDependency_getCallbackHandle(dependency), event->reference, event->service, newEvent->reference, newEvent->service);
 		}
 	}
@@ -775,6 +787,7 @@ celix_status_t serviceDependency_getServiceDependencyInfo(dm_service_dependency_
 			info->filter = dep->tracked_service != NULL ? strdup(dep->tracked_service) : NULL;
 		}
 		info->required = dep->required;
+		info->nrOfCallbackInvocations = __sync_add_and_fetch(&dep->nrOfCallbackInvocations, 0);
 
 		array_list_pt refs = serviceTracker_getServiceReferences(dep->tracker);
 		if (refs != NULL) {
@@ -71,6 +71,7 @@ void dmListCommand_execute(dm_command_handle_t* handle, char * line, FILE *out,
                 endColors = END_COLOR;
             }
             fprintf(out, "Component: Name=%s\n|- ID=%s, %sActive=%s%s, State=%s\n", compInfo->name, compInfo->id, startColors, compInfo->active ?  "true " : "false", endColors, compInfo->state);
+            fprintf(out, "|- Transitions=%zu, Callbacks=%zu, Events=%zu, Coalesced events=%zu\n", compInfo->nrOfTransitions, compInfo->nrOfCallbackInvocations, compInfo->nrOfHandledEvents, compInfo->nrOfCoalescedEvents);
 
             int interfCnt;
             fprintf(out, "|- Interfaces (%d):\n", arrayList_size(compInfo->interfaces));
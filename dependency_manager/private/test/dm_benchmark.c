@@ -0,0 +1,311 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+/*
+ * dm_benchmark.c
+ *
+ * Dependency manager benchmark. Boots NR_OF_COMPONENTS components which require the providers registered by
+ * NR_OF_THREADS threads at the same time, like bundles started in parallel. Every provider is changed once and half
+ * of them is unregistered again during the boot. Reports the time until all components are active and the
+ * transitions, callbacks, handled and coalesced events of the components, and checks that every component ends up
+ * with the providers which are still registered.
+ *
+ * A second run registers NR_OF_RANKED_PROVIDERS providers for a single component in ascending ranking, inverts the
+ * rankings and unregisters them highest ranking first. Every event then lands at the front of the ranking ordered
+ * dependency events, which is the worst case for keeping them ordered. Reports the time per event for each phase and
+ * checks that the component is set with the highest ranking provider after every phase.
+ *
+ *  \author    	<a href="mailto:dev@celix.apache.org">Apache Celix Project Team</a>
+ *  \copyright	Apache License, Version 2.0
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "celix_launcher.h"
+#include "framework.h"
+#include "constants.h"
+#include "properties.h"
+#include "celix_threads.h"
+#include "service_registration.h"
+#include "dm_dependency_manager.h"
+#include "dm_component.h"
+#include "dm_service_dependency.h"
+#include "dm_info.h"
+
+#define PROVIDER_SERVICE "dm_bench_provider"
+#define NR_OF_COMPONENTS 100
+#define NR_OF_THREADS 4
+#define PROVIDERS_PER_THREAD 50
+#define RANKED_SERVICE "dm_bench_ranked"
+#define NR_OF_RANKED_PROVIDERS 1000
+
+struct bench_component {
+	int providers; //only changed from the callbacks, which the component executor serializes
+	int started;
+};
+
+struct bench_ranked_component {
+	bundle_context_pt context;
+	const void *selected;
+	int providers[NR_OF_RANKED_PROVIDERS];
+	service_registration_pt registrations[NR_OF_RANKED_PROVIDERS];
+};
+
+struct bench_thread {
+	bundle_context_pt context;
+	int index;
+	int providers[PROVIDERS_PER_THREAD];
+	service_registration_pt registrations[PROVIDERS_PER_THREAD];
+};
+
+static double dmBenchmark_elapsedMs(struct timespec *begin, struct timespec *end) {
+	return (end->tv_sec - begin->tv_sec) * 1000.0 + (end->tv_nsec - begin->tv_nsec) / 1000000.0;
+}
+
+static int dmBenchmark_start(void *handle) {
+	struct bench_component *cmp = handle;
+	cmp->started++;
+	return CELIX_SUCCESS;
+}
+
+static int dmBenchmark_providerAdded(void *handle, const void *svc) {
+	struct bench_component *cmp = handle;
+	cmp->providers++;
+	return CELIX_SUCCESS;
+}
+
+static int dmBenchmark_providerRemoved(void *handle, const void *svc) {
+	struct bench_component *cmp = handle;
+	cmp->providers--;
+	return CELIX_SUCCESS;
+}
+
+static int dmBenchmark_rankedSet(void *handle, const void *svc) {
+	struct bench_ranked_component *cmp = handle;
+	cmp->selected = svc;
+	return CELIX_SUCCESS;
+}
+
+static void *dmBenchmark_registerProviders(void *data) {
+	struct bench_thread *thread = data;
+	char value[32];
+	int i;
+
+	for (i = 0; i < PROVIDERS_PER_THREAD; ++i) {
+		properties_pt props = properties_create();
+		snprintf(value, sizeof(value), "%i.%i", thread->index, i);
+		properties_set(props, "provider", value);
+		bundleContext_registerService(thread->context, PROVIDER_SERVICE, &thread->providers[i], props, &thread->registrations[i]);
+
+		props = properties_create();
+		properties_set(props, "provider", value);
+		properties_set(props, "configured", "true");
+		serviceRegistration_setProperties(thread->registrations[i], props);
+
+		if (i % 2 == 1) {
+			serviceRegistration_unregister(thread->registrations[i]);
+			thread->registrations[i] = NULL;
+		}
+	}
+
+	return NULL;
+}
+
+static int dmBenchmark_boot(bundle_context_pt context) {
+	dm_dependency_manager_pt manager = NULL;
+	dm_dependency_manager_info_pt info = NULL;
+	struct bench_component components[NR_OF_COMPONENTS];
+	struct bench_thread threads[NR_OF_THREADS];
+	celix_thread_t threadIds[NR_OF_THREADS];
+	struct timespec begin;
+	struct timespec end;
+	size_t transitions = 0;
+	size_t callbacks = 0;
+	size_t events = 0;
+	size_t coalesced = 0;
+	int registered = NR_OF_THREADS * (PROVIDERS_PER_THREAD - PROVIDERS_PER_THREAD / 2);
+	int failures = 0;
+	int i;
+	int j;
+
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	dependencyManager_create(context, &manager);
+	for (i = 0; i < NR_OF_COMPONENTS; ++i) {
+		dm_component_pt component = NULL;
+		dm_service_dependency_pt dependency = NULL;
+		char name[32];
+
+		memset(&components[i], 0, sizeof(components[i]));
+		snprintf(name, sizeof(name), "bench_component_%i", i);
+		component_create(context, name, &component);
+		component_setImplementation(component, &components[i]);
+		component_setCallbacks(component, NULL, dmBenchmark_start, NULL, NULL);
+
+		serviceDependency_create(&dependency);
+		serviceDependency_setService(dependency, PROVIDER_SERVICE, NULL, NULL);
+		serviceDependency_setRequired(dependency, true);
+		serviceDependency_setStrategy(dependency, DM_SERVICE_DEPENDENCY_STRATEGY_LOCKING);
+		serviceDependency_setCallbacks(dependency, NULL, dmBenchmark_providerAdded, NULL, dmBenchmark_providerRemoved, NULL);
+		component_addServiceDependency(component, dependency);
+		dependencyManager_add(manager, component);
+	}
+
+	for (i = 0; i < NR_OF_THREADS; ++i) {
+		memset(&threads[i], 0, sizeof(threads[i]));
+		threads[i].context = context;
+		threads[i].index = i;
+		celixThread_create(&threadIds[i], NULL, dmBenchmark_registerProviders, &threads[i]);
+	}
+	for (i = 0; i < NR_OF_THREADS; ++i) {
+		celixThread_join(threadIds[i], NULL);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	dependencyManager_getInfo(manager, &info);
+	for (i = 0; i < arrayList_size(info->components); ++i) {
+		dm_component_info_pt cmpInfo = arrayList_get(info->components, i);
+		transitions += cmpInfo->nrOfTransitions;
+		callbacks += cmpInfo->nrOfCallbackInvocations;
+		events += cmpInfo->nrOfHandledEvents;
+		coalesced += cmpInfo->nrOfCoalescedEvents;
+		if (!cmpInfo->active) {
+			failures++;
+		}
+	}
+	dependencyManager_destroyInfo(manager, info);
+
+	for (i = 0; i < NR_OF_COMPONENTS; ++i) {
+		if (components[i].providers != registered || components[i].started != 1) {
+			failures++;
+		}
+	}
+
+	printf("Booted %i components with %i providers from %i threads in %.3f ms: %zu transitions, %zu callbacks, %zu events handled, %zu coalesced\n",
+			NR_OF_COMPONENTS, NR_OF_THREADS * PROVIDERS_PER_THREAD, NR_OF_THREADS, dmBenchmark_elapsedMs(&begin, &end),
+			transitions, callbacks, events, coalesced);
+
+	dependencyManager_removeAllComponents(manager);
+	dependencyManager_destroy(manager);
+	for (i = 0; i < NR_OF_THREADS; ++i) {
+		for (j = 0; j < PROVIDERS_PER_THREAD; ++j) {
+			if (threads[i].registrations[j] != NULL) {
+				serviceRegistration_unregister(threads[i].registrations[j]);
+			}
+		}
+	}
+
+	return failures;
+}
+
+static void dmBenchmark_setRanking(struct bench_ranked_component *cmp, int index, int ranking, bool registration) {
+	char value[32];
+	properties_pt props = properties_create();
+	snprintf(value, sizeof(value), "%i", ranking);
+	properties_set(props, (char *) OSGI_FRAMEWORK_SERVICE_RANKING, value);
+	if (registration) {
+		bundleContext_registerService(cmp->context, RANKED_SERVICE, &cmp->providers[index], props, &cmp->registrations[index]);
+	} else {
+		serviceRegistration_setProperties(cmp->registrations[index], props);
+	}
+}
+
+static int dmBenchmark_checkSelected(const char *phase, struct timespec *begin, struct bench_ranked_component *cmp, const void *expected) {
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	printf("%s %i ranked providers in %.3f ms, %.3f us per provider\n", phase, NR_OF_RANKED_PROVIDERS,
+			dmBenchmark_elapsedMs(begin, &end), dmBenchmark_elapsedMs(begin, &end) * 1000.0 / NR_OF_RANKED_PROVIDERS);
+	if (cmp->selected != expected) {
+		printf("%s: FAILED, the component is not set with the highest ranking provider\n", phase);
+		return 1;
+	}
+	return 0;
+}
+
+static int dmBenchmark_ranking(bundle_context_pt context) {
+	dm_dependency_manager_pt manager = NULL;
+	dm_component_pt component = NULL;
+	dm_service_dependency_pt dependency = NULL;
+	struct bench_ranked_component *cmp = calloc(1, sizeof(*cmp));
+	struct timespec begin;
+	int failures = 0;
+	int i;
+
+	cmp->context = context;
+
+	dependencyManager_create(context, &manager);
+	component_create(context, "bench_ranked_component", &component);
+	component_setImplementation(component, cmp);
+	serviceDependency_create(&dependency);
+	serviceDependency_setService(dependency, RANKED_SERVICE, NULL, NULL);
+	serviceDependency_setRequired(dependency, false);
+	serviceDependency_setStrategy(dependency, DM_SERVICE_DEPENDENCY_STRATEGY_LOCKING);
+	serviceDependency_setCallbacks(dependency, dmBenchmark_rankedSet, NULL, NULL, NULL, NULL);
+	component_addServiceDependency(component, dependency);
+	dependencyManager_add(manager, component);
+
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	for (i = 0; i < NR_OF_RANKED_PROVIDERS; ++i) {
+		dmBenchmark_setRanking(cmp, i, i, true);
+	}
+	failures += dmBenchmark_checkSelected("Registered", &begin, cmp, &cmp->providers[NR_OF_RANKED_PROVIDERS - 1]);
+
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	for (i = 0; i < NR_OF_RANKED_PROVIDERS; ++i) {
+		dmBenchmark_setRanking(cmp, i, NR_OF_RANKED_PROVIDERS - i, false);
+	}
+	failures += dmBenchmark_checkSelected("Changed", &begin, cmp, &cmp->providers[0]);
+
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	for (i = 0; i < NR_OF_RANKED_PROVIDERS; ++i) {
+		serviceRegistration_unregister(cmp->registrations[i]);
+	}
+	failures += dmBenchmark_checkSelected("Unregistered", &begin, cmp, NULL);
+
+	dependencyManager_removeAllComponents(manager);
+	dependencyManager_destroy(manager);
+	free(cmp);
+
+	return failures;
+}
+
+int main(int argc, char **argv) {
+	framework_pt framework = NULL;
+	bundle_pt bundle = NULL;
+	bundle_context_pt context = NULL;
+	int failures = 0;
+
+	properties_pt config = properties_create();
+	properties_set(config, (char *) OSGI_FRAMEWORK_FRAMEWORK_STORAGE_CLEAN, (char *) OSGI_FRAMEWORK_FRAMEWORK_STORAGE_CLEAN_ONFIRSTINIT);
+	if (celixLauncher_launchWithProperties(config, &framework) != CELIX_SUCCESS) {
+		return EXIT_FAILURE;
+	}
+	framework_getFrameworkBundle(framework, &bundle);
+	bundle_getContext(bundle, &context);
+
+	failures += dmBenchmark_boot(context);
+	failures += dmBenchmark_ranking(context);
+
+	celixLauncher_stop(framework);
+	celixLauncher_waitForShutdown(framework);
+	celixLauncher_destroy(framework);
+
+	printf("%i failures\n", failures);
+	return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,229 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+/*
+ * dm_component_test.cpp
+ *
+ * Tests the coalescing of the dependency events queued for a dm component. Services registered, changed and
+ * unregistered from a dependency callback are queued while the component executor is running and handled as one
+ * batch afterwards. Every callback is logged as +name (add), ~name (change) or -name (remove), adds and changes
+ * followed by the value property, and the log is compared with the expected callbacks.
+ *
+ *  \author    	<a href="mailto:dev@celix.apache.org">Apache Celix Project Team</a>
+ *  \copyright	Apache License, Version 2.0
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/TestHarness_c.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+extern "C"
+{
+#include "celix_launcher.h"
+#include "framework.h"
+#include "constants.h"
+#include "properties.h"
+#include "service_registration.h"
+#include "dm_dependency_manager.h"
+#include "dm_component.h"
+#include "dm_service_dependency.h"
+#include "dm_info.h"
+}
+
+int main(int argc, char** argv) {
+	return RUN_ALL_TESTS(argc, argv);
+}
+
+#define TEST_SERVICE "dm_test_service"
+#define NR_OF_REGISTRATIONS 8
+
+struct test_component {
+	bundle_context_pt context;
+	char log[512];
+	service_registration_pt registrations[NR_OF_REGISTRATIONS];
+	char names[NR_OF_REGISTRATIONS][8]; //the removal of a service can be handled after its properties are gone
+	int services[NR_OF_REGISTRATIONS];
+};
+
+static void dmTest_register(struct test_component *cmp, int index, const char *name, const char *value) {
+	properties_pt props = properties_create();
+	properties_set(props, "name", name);
+	properties_set(props, "value", value);
+	snprintf(cmp->names[index], sizeof(cmp->names[index]), "%s", name);
+	bundleContext_registerService(cmp->context, TEST_SERVICE, &cmp->services[index], props, &cmp->registrations[index]);
+}
+
+static void dmTest_change(struct test_component *cmp, int index, const char *name, const char *value) {
+	properties_pt props = properties_create();
+	properties_set(props, "name", name);
+	properties_set(props, "value", value);
+	serviceRegistration_setProperties(cmp->registrations[index], props);
+}
+
+static void dmTest_unregister(struct test_component *cmp, int index) {
+	serviceRegistration_unregister(cmp->registrations[index]);
+	cmp->registrations[index] = NULL;
+}
+
+static void dmTest_log(struct test_component *cmp, char op, service_reference_pt ref, const void *svc) {
+	const char *value = NULL;
+	size_t len = strlen(cmp->log);
+	int index = (const int *) svc - cmp->services;
+	if (ref != NULL) {
+		serviceReference_getProperty(ref, "value", &value);
+	}
+	snprintf(cmp->log + len, sizeof(cmp->log) - len, "%c%s%s ", op, cmp->names[index], value != NULL ? value : "");
+}
+
+/*
+ * The services registered as trigger start a scenario, everything done here is queued for the component and
+ * coalesced in the next batch.
+ */
+static celix_status_t dmTest_added(void *handle, service_reference_pt ref, const void *svc) {
+	struct test_component *cmp = (struct test_component *) handle;
+	const char *name = NULL;
+
+	dmTest_log(cmp, '+', ref, svc);
+	serviceReference_getProperty(ref, "name", &name);
+	if (name != NULL && strcmp(name, "T1") == 0) {
+		//added and removed in the same batch cancel each other out, the order of the others is kept
+		dmTest_register(cmp, 1, "A", "");
+		dmTest_register(cmp, 2, "B", "");
+		dmTest_register(cmp, 3, "C", "");
+		dmTest_unregister(cmp, 2);
+		dmTest_register(cmp, 4, "D", "");
+	} else if (name != NULL && strcmp(name, "T2") == 0) {
+		//an add followed by changes stays an add, with the last properties
+		dmTest_register(cmp, 5, "E", "1");
+		dmTest_change(cmp, 5, "E", "2");
+		dmTest_change(cmp, 5, "E", "3");
+		//only the last change of an already added service is applied
+		dmTest_change(cmp, 1, "A", "1");
+		dmTest_change(cmp, 1, "A", "2");
+	} else if (name != NULL && strcmp(name, "T3") == 0) {
+		//a change followed by a removal is only a removal
+		dmTest_change(cmp, 3, "C", "1");
+		dmTest_unregister(cmp, 3);
+		//a removal followed by a new registration is not coalesced, it is another service
+		dmTest_unregister(cmp, 4);
+		dmTest_register(cmp, 4, "D", "1");
+	}
+	return CELIX_SUCCESS;
+}
+
+static celix_status_t dmTest_changed(void *handle, service_reference_pt ref, const void *svc) {
+	dmTest_log((struct test_component *) handle, '~', ref, svc);
+	return CELIX_SUCCESS;
+}
+
+static celix_status_t dmTest_removed(void *handle, service_reference_pt ref, const void *svc) {
+	dmTest_log((struct test_component *) handle, '-', NULL, svc);
+	return CELIX_SUCCESS;
+}
+
+TEST_GROUP(dm_component) {
+	framework_pt framework;
+	dm_dependency_manager_pt manager;
+	dm_component_pt component;
+	struct test_component cmp;
+	char callbacks[512];
+
+	void setup() {
+		bundle_pt bundle = NULL;
+		dm_service_dependency_pt dependency = NULL;
+
+		properties_pt config = properties_create();
+		properties_set(config, OSGI_FRAMEWORK_FRAMEWORK_STORAGE_CLEAN, OSGI_FRAMEWORK_FRAMEWORK_STORAGE_CLEAN_ONFIRSTINIT);
+		framework = NULL;
+		LONGS_EQUAL(CELIX_SUCCESS, celixLauncher_launchWithProperties(config, &framework));
+		framework_getFrameworkBundle(framework, &bundle);
+
+		memset(&cmp, 0, sizeof(cmp));
+		bundle_getContext(bundle, &cmp.context);
+
+		manager = NULL;
+		component = NULL;
+		dependencyManager_create(cmp.context, &manager);
+		component_create(cmp.context, "dm_test_component", &component);
+		component_setImplementation(component, &cmp);
+		serviceDependency_create(&dependency);
+		serviceDependency_setService(dependency, TEST_SERVICE, NULL, NULL);
+		serviceDependency_setRequired(dependency, false);
+		serviceDependency_setStrategy(dependency, DM_SERVICE_DEPENDENCY_STRATEGY_LOCKING);
+		serviceDependency_setCallbackHandle(dependency, &cmp);
+		serviceDependency_setCallbacksWithServiceReference(dependency, NULL, dmTest_added, dmTest_changed, dmTest_removed, NULL);
+		component_addServiceDependency(component, dependency);
+		dependencyManager_add(manager, component);
+	}
+
+	void teardown() {
+		dependencyManager_removeAllComponents(manager);
+		dependencyManager_destroy(manager);
+		for (int i = 0; i < NR_OF_REGISTRATIONS; ++i) {
+			if (cmp.registrations[i] != NULL) {
+				serviceRegistration_unregister(cmp.registrations[i]);
+			}
+		}
+
+		celixLauncher_stop(framework);
+		celixLauncher_waitForShutdown(framework);
+		celixLauncher_destroy(framework);
+	}
+
+	size_t coalescedEvents() {
+		dm_component_info_pt info = NULL;
+		size_t coalesced = 0;
+
+		component_getComponentInfo(component, &info);
+		coalesced = info->nrOfCoalescedEvents;
+		component_destroyComponentInfo(info);
+		return coalesced;
+	}
+
+	/* runs the scenario of the trigger, keeps its callbacks and returns the number of events it coalesced */
+	size_t trigger(const char *name) {
+		size_t coalesced = coalescedEvents();
+
+		cmp.log[0] = '\0';
+		dmTest_register(&cmp, 0, name, "");
+		coalesced = coalescedEvents() - coalesced;
+		snprintf(callbacks, sizeof(callbacks), "%s", cmp.log);
+		dmTest_unregister(&cmp, 0);
+		return coalesced;
+	}
+};
+
+TEST(dm_component, addAndRemoveCancelOut) {
+	LONGS_EQUAL(2, trigger("T1"));
+	STRCMP_EQUAL("+T1 +A +C +D ", callbacks);
+}
+
+TEST(dm_component, changesOfAnAddAreFolded) {
+	trigger("T1");
+	LONGS_EQUAL(3, trigger("T2"));
+	STRCMP_EQUAL("+T2 +E3 ~A2 ", callbacks);
+}
+
+TEST(dm_component, changeBeforeRemoveIsDropped) {
+	trigger("T1");
+	LONGS_EQUAL(1, trigger("T3"));
+	STRCMP_EQUAL("+T3 -C -D +D1 ", callbacks);
+}
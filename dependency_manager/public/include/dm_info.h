@@ -48,6 +48,7 @@ typedef struct dm_service_dependency_info_struct {
     bool available;
     bool required;
     size_t count;
+    size_t nrOfCallbackInvocations;
 } * dm_service_dependency_info_pt;
 
 typedef struct dm_component_info_struct {
@@ -57,6 +58,10 @@ typedef struct dm_component_info_struct {
     char * state;
     array_list_pt interfaces;   // type dm_interface_info_pt
     array_list_pt dependency_list;  // type dm_service_dependency_info_pt
+    size_t nrOfTransitions;
+    size_t nrOfCallbackInvocations; // lifecycle and dependency callbacks
+    size_t nrOfHandledEvents;
+    size_t nrOfCoalescedEvents;     // dependency events dropped, because they were superseded in the same batch
 } * dm_component_info_pt;
 
 typedef struct dm_dependency_manager_info_struct {
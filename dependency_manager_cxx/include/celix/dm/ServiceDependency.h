@@ -21,6 +21,7 @@
 #define CELIX_DM_SERVICEDEPENDENCY_H
 
 #include "dm_service_dependency.h"
+#include "celix_log.h"
 #include "celix/dm/types.h"
 
 #include <map>
@@ -28,6 +29,10 @@
 #include <list>
 #include <tuple>
 #include <memory>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <condition_variable>
 #include <iostream>
 #include <functional>
 
@@ -37,19 +42,47 @@ namespace celix { namespace dm {
 
     enum class DependencyUpdateStrategy {
         suspend,
-        locking
+        locking,
+        atomic
+    };
+
+    /**
+     * Release of a service swapped in with the atomic strategy. The shared_ptr handed out for the service releases it
+     * when its last reference is dropped.
+     */
+    class ServiceRelease {
+    public:
+        void release() {
+            std::lock_guard<std::mutex> lck{mutex};
+            released = true;
+            cond.notify_all();
+        }
+
+        bool waitFor(std::chrono::milliseconds timeout) {
+            std::unique_lock<std::mutex> lck{mutex};
+            return cond.wait_for(lck, timeout, [this]{ return released; });
+        }
+    private:
+        std::mutex mutex {};
+        std::condition_variable cond {};
+        bool released {false};
     };
 
     class BaseServiceDependency {
     protected:
         const bool valid;
         dm_service_dependency_pt cServiceDep {nullptr};
+        DependencyUpdateStrategy strategy {DependencyUpdateStrategy::suspend};
+        std::shared_ptr<ServiceRelease> currentRelease {};
+        std::chrono::milliseconds releaseWarningInterval {1000};
 
         void setDepStrategy(DependencyUpdateStrategy strategy) {
             if (!valid) {
                 return;
             }
-            if (strategy == DependencyUpdateStrategy::locking) {
+            this->strategy = strategy;
+            if (strategy == DependencyUpdateStrategy::locking || strategy == DependencyUpdateStrategy::atomic) {
+                //NOTE the atomic strategy does not suspend the component, the service pointer is swapped instead.
                 serviceDependency_setStrategy(this->cServiceDependency(), DM_SERVICE_DEPENDENCY_STRATEGY_LOCKING);
             } else if (strategy == DependencyUpdateStrategy::suspend) {
                 serviceDependency_setStrategy(this->cServiceDependency(), DM_SERVICE_DEPENDENCY_STRATEGY_SUSPEND);
@@ -57,6 +90,33 @@ namespace celix { namespace dm {
                 std::cerr << "Unexpected dependency update strategy. Cannot convert for dm_depdendency\n";
             }
         }
+
+        /**
+         * Swaps service in for the atomic strategy. Called from the set callback on the dm thread, which then waits
+         * until the replaced service is released by its last caller before the dependency manager continues with the
+         * removal of that service. A warning is logged every releaseWarningInterval while the service is still held.
+         */
+        template<typename S>
+        void swapService(std::shared_ptr<S>& current, S* service) {
+            if (std::atomic_load(&current).get() == service) {
+                return; //same service, nothing to swap
+            }
+            std::shared_ptr<ServiceRelease> release {};
+            std::shared_ptr<S> next {};
+            if (service != nullptr) {
+                release = std::make_shared<ServiceRelease>();
+                next = std::shared_ptr<S>{service, [release](S*) { release->release(); /*service not owned*/ }};
+            }
+            std::atomic_exchange(&current, next); //drops the reference to the previous service held by the dependency
+            std::shared_ptr<ServiceRelease> prev = this->currentRelease;
+            this->currentRelease = release;
+            std::chrono::milliseconds waited {0};
+            while (prev && !prev->waitFor(this->releaseWarningInterval)) {
+                waited += this->releaseWarningInterval;
+                fw_log(logger, OSGI_FRAMEWORK_LOG_WARNING, "Replaced service still in use after %lld ms, waiting until it is released before removing it",
+                       (long long) waited.count());
+            }
+        }
     public:
         BaseServiceDependency(bool v)  : valid{v} {
             if (this->valid) {
@@ -80,6 +140,11 @@ namespace celix { namespace dm {
          * Returns the C DM service dependency
          */
         dm_service_dependency_pt cServiceDependency() const { return cServiceDep; }
+
+        /**
+         * Returns the configured dependency update strategy
+         */
+        DependencyUpdateStrategy getStrategy() const { return strategy; }
     };
 
     template<class T>
@@ -192,6 +257,16 @@ namespace celix { namespace dm {
          * For C service dependencies 'service.lang=C' will be added.
          */
         CServiceDependency<T,I>& setAddLanguageFilter(bool addLang);
+
+        /**
+         * Returns the current (highest ranking) service when the atomic update strategy is used.
+         * The service pointer is swapped atomically when the dependency changes, so the component is never suspended.
+         * A replaced service is only released to the dependency manager after all returned references are dropped,
+         * which blocks the removal of that service, so only keep the returned reference for the duration of a call.
+         *
+         * @return the current service or an empty shared_ptr if no service is available.
+         */
+        std::shared_ptr<const I> getService() const;
     private:
         std::string name {};
         std::string filter {};
@@ -201,6 +276,8 @@ namespace celix { namespace dm {
         std::function<void(const I* service, Properties&& properties)> addFp{nullptr};
         std::function<void(const I* service, Properties&& properties)> removeFp{nullptr};
 
+        std::shared_ptr<const I> currentService {};
+
         void setupCallbacks();
         int invokeCallback(std::function<void(const I*, Properties&&)> fp, service_reference_pt  ref, const void* service);
 
@@ -303,6 +380,16 @@ namespace celix { namespace dm {
          * Should be called before
          */
         ServiceDependency<T,I>& setAddLanguageFilter(bool addLang);
+
+        /**
+         * Returns the current (highest ranking) service when the atomic update strategy is used.
+         * The service pointer is swapped atomically when the dependency changes, so the component is never suspended.
+         * A replaced service is only released to the dependency manager after all returned references are dropped,
+         * which blocks the removal of that service, so only keep the returned reference for the duration of a call.
+         *
+         * @return the current service or an empty shared_ptr if no service is available.
+         */
+        std::shared_ptr<I> getService() const;
     private:
         bool addCxxLanguageFilter {true};
         std::string name {};
@@ -314,6 +401,8 @@ namespace celix { namespace dm {
         std::function<void(I* service, Properties&& properties)> addFp{nullptr};
         std::function<void(I* service, Properties&& properties)> removeFp{nullptr};
 
+        std::shared_ptr<I> currentService {};
+
         void setupService();
         void setupCallbacks();
         int invokeCallback(std::function<void(I*, Properties&&)> fp, service_reference_pt  ref, const void* service);
@@ -78,9 +78,15 @@ CServiceDependency<T,I>& CServiceDependency<T,I>::setStrategy(DependencyUpdateSt
         return *this;
     }
     this->setDepStrategy(strategy);
+    this->setupCallbacks();
     return *this;
 }
 
+template<class T, typename I>
+std::shared_ptr<const I> CServiceDependency<T,I>::getService() const {
+    return std::atomic_load(&this->currentService);
+}
+
 //set callbacks
 template<class T, typename I>
 CServiceDependency<T,I>& CServiceDependency<T,I>::setCallbacks(void (T::*set)(const I* service)) {
@@ -162,10 +168,13 @@ void CServiceDependency<T,I>::setupCallbacks() {
     int(*cadd)(void*, service_reference_pt, const void*) {nullptr};
     int(*crem)(void*, service_reference_pt, const void*) {nullptr};
 
-    if (setFp != nullptr) {
+    if (setFp != nullptr || this->strategy == DependencyUpdateStrategy::atomic) {
         cset = [](void* handle, service_reference_pt ref, const void* service) -> int {
             auto dep = (CServiceDependency<T,I>*) handle;
-            return dep->invokeCallback(dep->setFp, ref, service);
+            if (dep->strategy == DependencyUpdateStrategy::atomic) {
+                dep->swapService(dep->currentService, (const I*) service);
+            }
+            return dep->setFp != nullptr ? dep->invokeCallback(dep->setFp, ref, service) : 0;
         };
     }
     if (addFp != nullptr) {
@@ -384,9 +393,15 @@ ServiceDependency<T,I>& ServiceDependency<T,I>::setRequired(bool req) {
 template<class T, class I>
 ServiceDependency<T,I>& ServiceDependency<T,I>::setStrategy(DependencyUpdateStrategy strategy) {
     this->setDepStrategy(strategy);
+    this->setupCallbacks();
     return *this;
 };
 
+template<class T, class I>
+std::shared_ptr<I> ServiceDependency<T,I>::getService() const {
+    return std::atomic_load(&this->currentService);
+}
+
 template<class T, class I>
 int ServiceDependency<T,I>::invokeCallback(std::function<void(I*, Properties&&)> fp, service_reference_pt  ref, const void* service) {
     service_registration_pt reg {nullptr};
@@ -423,10 +438,13 @@ void ServiceDependency<T,I>::setupCallbacks() {
     int(*cadd)(void*, service_reference_pt, const void*) {nullptr};
     int(*crem)(void*, service_reference_pt, const void*) {nullptr};
 
-    if (setFp != nullptr) {
+    if (setFp != nullptr || this->strategy == DependencyUpdateStrategy::atomic) {
         cset = [](void* handle, service_reference_pt ref, const void* service) -> int {
             auto dep = (ServiceDependency<T,I>*) handle;
-            return dep->invokeCallback(dep->setFp, ref, service);
+            if (dep->strategy == DependencyUpdateStrategy::atomic) {
+                dep->swapService(dep->currentService, (I*) service);
+            }
+            return dep->setFp != nullptr ? dep->invokeCallback(dep->setFp, ref, service) : 0;
         };
     }
     if (addFp != nullptr) {
@@ -0,0 +1,239 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+/*
+ * dm_churn_benchmark.cc
+ *
+ * Churn benchmark for the atomic and locking dependency update strategies. NR_OF_READERS threads call the current
+ * service of a dependency in a loop while the main thread replaces it NR_OF_SWAPS times: a provider with a higher
+ * ranking is registered and the previous one is unregistered and marked dead. The atomic readers use getService, the
+ * locking readers the service set on the component under its lock. Reports the time per swap and the reader calls per
+ * second of both strategies and fails when a caller ever sees a dead provider, i.e. when a replaced service was
+ * removed while still in use.
+ *
+ * The atomic strategy is then run once with a reader which holds the service for HOLD_MS, longer than the interval
+ * after which the dependency manager warns about a held service. The swap has to wait for that reader and the
+ * provider must stay registered until the reader drops it.
+ *
+ *  \author    	<a href="mailto:dev@celix.apache.org">Apache Celix Project Team</a>
+ *  \copyright	Apache License, Version 2.0
+ */
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <iostream>
+#include <string>
+
+#include "celix/dm/DependencyManager.h"
+
+extern "C" {
+#include "celix_launcher.h"
+#include "framework.h"
+#include "constants.h"
+#include "properties.h"
+#include "service_registration.h"
+}
+
+#define CHURN_SERVICE "dm_churn_service"
+#define NR_OF_READERS 2
+#define NR_OF_SWAPS 2000
+#define HOLD_MS 1500
+
+using namespace celix::dm;
+
+class IChurn {
+public:
+    virtual ~IChurn() = default;
+    virtual bool isAlive() = 0;
+};
+
+class ChurnProvider : public IChurn {
+public:
+    std::atomic<bool> alive {true};
+    service_registration_pt registration {nullptr};
+
+    bool isAlive() override { return alive; }
+};
+
+class ChurnConsumer {
+public:
+    std::mutex mutex {};
+    IChurn* churn {nullptr};
+
+    void setChurn(IChurn* svc) {
+        std::lock_guard<std::mutex> lck{mutex};
+        churn = svc;
+    }
+};
+
+struct ChurnResult {
+    double ms {0};
+    long calls {0};
+    long deadCalls {0};
+};
+
+static void register_provider(bundle_context_pt ctx, ChurnProvider& provider, int ranking) {
+    properties_pt props = properties_create();
+    properties_set(props, (char*) OSGI_FRAMEWORK_SERVICE_RANKING, std::to_string(ranking).c_str());
+    properties_set(props, (char*) CELIX_FRAMEWORK_SERVICE_LANGUAGE, (char*) CELIX_FRAMEWORK_SERVICE_CXX_LANGUAGE);
+    bundleContext_registerService(ctx, CHURN_SERVICE, static_cast<IChurn*>(&provider), props, &provider.registration);
+}
+
+/* registers provider i and unregisters provider i - 1, marking it dead */
+static void swap_provider(bundle_context_pt ctx, std::vector<std::unique_ptr<ChurnProvider>>& providers) {
+    int i = (int) providers.size();
+    providers.emplace_back(new ChurnProvider{});
+    register_provider(ctx, *providers.back(), i);
+    if (i > 0) {
+        ChurnProvider& prev = *providers[i - 1];
+        serviceRegistration_unregister(prev.registration);
+        prev.alive = false;
+    }
+}
+
+static ChurnResult churn(bundle_context_pt ctx, DependencyUpdateStrategy strategy) {
+    std::vector<std::unique_ptr<ChurnProvider>> providers {};
+    std::atomic<bool> running {true};
+    std::atomic<long> calls {0};
+    std::atomic<long> deadCalls {0};
+    ChurnResult result {};
+
+    DependencyManager mng {ctx};
+    Component<ChurnConsumer>& cmp = mng.createComponent<ChurnConsumer>("churn_consumer");
+    ServiceDependency<ChurnConsumer,IChurn>& dep = cmp.createServiceDependency<IChurn>(CHURN_SERVICE)
+            .setRequired(false)
+            .setStrategy(strategy);
+    if (strategy == DependencyUpdateStrategy::locking) {
+        dep.setCallbacks(&ChurnConsumer::setChurn);
+    }
+    ChurnConsumer& consumer = cmp.getInstance();
+    mng.start();
+
+    std::vector<std::thread> readers {};
+    for (int i = 0; i < NR_OF_READERS; ++i) {
+        readers.emplace_back([&] {
+            while (running) {
+                if (strategy == DependencyUpdateStrategy::atomic) {
+                    std::shared_ptr<IChurn> svc = dep.getService();
+                    if (svc) {
+                        calls++;
+                        deadCalls += svc->isAlive() ? 0 : 1;
+                    }
+                } else {
+                    std::lock_guard<std::mutex> lck{consumer.mutex};
+                    if (consumer.churn != nullptr) {
+                        calls++;
+                        deadCalls += consumer.churn->isAlive() ? 0 : 1;
+                    }
+                }
+                std::this_thread::yield();
+            }
+        });
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < NR_OF_SWAPS; ++i) {
+        swap_provider(ctx, providers);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    running = false;
+    for (std::thread& reader : readers) {
+        reader.join();
+    }
+    result.ms = std::chrono::duration<double, std::milli>(end - begin).count();
+    result.calls = calls;
+    result.deadCalls = deadCalls;
+
+    mng.stop();
+    serviceRegistration_unregister(providers.back()->registration);
+    return result;
+}
+
+/* swaps the service once while a reader holds it for HOLD_MS, returns whether the swap waited for that reader */
+static bool churnWithHeldService(bundle_context_pt ctx) {
+    std::vector<std::unique_ptr<ChurnProvider>> providers {};
+    std::atomic<bool> holding {false};
+    std::atomic<bool> aliveWhileHeld {false};
+
+    DependencyManager mng {ctx};
+    Component<ChurnConsumer>& cmp = mng.createComponent<ChurnConsumer>("churn_holder");
+    ServiceDependency<ChurnConsumer,IChurn>& dep = cmp.createServiceDependency<IChurn>(CHURN_SERVICE)
+            .setRequired(false)
+            .setStrategy(DependencyUpdateStrategy::atomic);
+    mng.start();
+    swap_provider(ctx, providers);
+
+    std::thread holder {[&] {
+        std::shared_ptr<IChurn> svc = dep.getService();
+        holding = true;
+        std::this_thread::sleep_for(std::chrono::milliseconds{HOLD_MS});
+        aliveWhileHeld = svc && svc->isAlive();
+    }};
+    while (!holding) {
+        std::this_thread::yield();
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    swap_provider(ctx, providers);
+    auto end = std::chrono::steady_clock::now();
+    holder.join();
+    double ms = std::chrono::duration<double, std::milli>(end - begin).count();
+
+    std::cout << "Swapped a service held for " << HOLD_MS << " ms in " << ms << " ms, held service "
+              << (aliveWhileHeld ? "stayed registered" : "was removed while held") << "\n";
+
+    mng.stop();
+    serviceRegistration_unregister(providers.back()->registration);
+    return aliveWhileHeld && ms >= HOLD_MS * 0.9;
+}
+
+static bool report(const char* name, const ChurnResult& result) {
+    std::cout << name << ": swapped " << NR_OF_SWAPS << " services under " << NR_OF_READERS << " readers in "
+              << result.ms << " ms, " << result.ms * 1000.0 / NR_OF_SWAPS << " us per swap, "
+              << result.calls * 1000.0 / result.ms << " calls/s, " << result.deadCalls << " calls on a removed service\n";
+    return result.deadCalls == 0 && result.calls > 0;
+}
+
+int main(int /*argc*/, char** /*argv*/) {
+    framework_pt framework {nullptr};
+    bundle_pt bundle {nullptr};
+    bundle_context_pt ctx {nullptr};
+    bool ok = true;
+
+    properties_pt config = properties_create();
+    properties_set(config, (char*) OSGI_FRAMEWORK_FRAMEWORK_STORAGE_CLEAN, (char*) OSGI_FRAMEWORK_FRAMEWORK_STORAGE_CLEAN_ONFIRSTINIT);
+    if (celixLauncher_launchWithProperties(config, &framework) != CELIX_SUCCESS) {
+        return EXIT_FAILURE;
+    }
+    framework_getFrameworkBundle(framework, &bundle);
+    bundle_getContext(bundle, &ctx);
+
+    ok &= report("atomic", churn(ctx, DependencyUpdateStrategy::atomic));
+    ok &= report("locking", churn(ctx, DependencyUpdateStrategy::locking));
+    ok &= churnWithHeldService(ctx);
+
+    celixLauncher_stop(framework);
+    celixLauncher_waitForShutdown(framework);
+    celixLauncher_destroy(framework);
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -28,9 +28,26 @@
 #define DEPLOYMENT_ADMIN_H_
 
 #include "bundle_context.h"
+#include "celix_threads.h"
 
 typedef struct deployment_admin *deployment_admin_pt;
 
+/*
+ * Timing of the stages of the last deployment, all times are relative to the start of the download. Bundles are
+ * installed while the package is still being downloaded, so the stages overlap.
+ */
+struct deployment_admin_statistics {
+	unsigned int deployments;
+	unsigned int rollbacks;
+
+	unsigned int bundles;
+	double manifestMs;
+	double downloadMs;
+	double bundlesMs;
+	double resourcesMs;
+	double totalMs;
+};
+
 struct deployment_admin {
 	celix_thread_t poller;
 	bundle_context_pt context;
@@ -43,6 +60,10 @@ struct deployment_admin {
 	char *auditlogUrl;
 	unsigned long long auditlogId;
 	unsigned int aditlogSeqNr;
+
+	int installThreads;
+	celix_thread_mutex_t statisticsLock;
+	struct deployment_admin_statistics statistics;
 };
 
 typedef enum {
@@ -53,5 +74,6 @@ typedef enum {
 
 celix_status_t deploymentAdmin_create(bundle_context_pt context, deployment_admin_pt *admin);
 celix_status_t deploymentAdmin_destroy(deployment_admin_pt admin);
+celix_status_t deploymentAdmin_getStatistics(deployment_admin_pt admin, struct deployment_admin_statistics *statistics);
 
 #endif /* DEPLOYMENT_ADMIN_H_ */
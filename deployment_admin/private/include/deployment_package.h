@@ -58,6 +58,7 @@ struct deployment_package {
 	array_list_pt bundleInfos;
 	array_list_pt resourceInfos;
 	hash_map_pt nameToBundleInfo;
+	hash_map_pt pathToBundleInfo;
 	hash_map_pt pathToEntry;
 };
 
@@ -68,6 +69,7 @@ celix_status_t deploymentPackage_destroy(deployment_package_pt package);
 celix_status_t deploymentPackage_getName(deployment_package_pt package, const char** name);
 celix_status_t deploymentPackage_getBundleInfos(deployment_package_pt package, array_list_pt *infos);
 celix_status_t deploymentPackage_getBundleInfoByName(deployment_package_pt package, const char* name, bundle_info_pt *info);
+celix_status_t deploymentPackage_getBundleInfoByPath(deployment_package_pt package, const char* path, bundle_info_pt *info);
 celix_status_t deploymentPackage_getResourceInfos(deployment_package_pt package, array_list_pt *infos);
 celix_status_t deploymentPackage_getResourceInfoByPath(deployment_package_pt package, const char* path, resource_info_pt *info);
 celix_status_t deploymentPackage_getBundle(deployment_package_pt package, const char* name, bundle_pt *bundle);
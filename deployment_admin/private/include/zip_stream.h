@@ -0,0 +1,53 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+/*
+ * zip_stream.h
+ *
+ * Extracts a zip file while it is being received. The local file headers are parsed in the order the entries are
+ * written, every entry is inflated straight into the destination directory and the entry callback is called as soon
+ * as an entry is complete. The central directory is not needed and is skipped.
+ *
+ *  \author    	<a href="mailto:dev@celix.apache.org">Apache Celix Project Team</a>
+ *  \copyright	Apache License, Version 2.0
+ */
+
+#ifndef ZIP_STREAM_H_
+#define ZIP_STREAM_H_
+
+#include <stddef.h>
+
+#include "celixbool.h"
+#include "celix_errno.h"
+
+typedef struct zip_stream *zip_stream_pt;
+
+/*
+ * Called for every extracted file, name is the name of the entry in the zip file and path the extracted file.
+ * Returning an error aborts the extraction.
+ */
+typedef celix_status_t (*zip_stream_entry_fpt)(void *handle, const char *name, const char *path);
+
+celix_status_t zipStream_create(const char *destination, zip_stream_entry_fpt entryExtracted, void *handle, zip_stream_pt *stream);
+celix_status_t zipStream_destroy(zip_stream_pt stream);
+
+celix_status_t zipStream_write(zip_stream_pt stream, const void *data, size_t size);
+/* Checks that the stream ended after a complete entry */
+celix_status_t zipStream_finish(zip_stream_pt stream);
+
+#endif /* ZIP_STREAM_H_ */
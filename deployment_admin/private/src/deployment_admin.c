@@ -30,6 +30,8 @@
 #include <unistd.h>
 #include <string.h>
 #include <stdint.h>
+#include <errno.h>
+#include <time.h>
 
 #include <dirent.h>
 #include <sys/types.h>
@@ -54,7 +56,7 @@
 #include "log_sync.h"
 
 #include "resource_processor.h"
-#include "miniunz.h"
+#include "zip_stream.h"
 
 #define IDENTIFICATION_ID "deployment_admin_identification"
 #define DEFAULT_IDENTIFICATION_ID "celix"
@@ -62,22 +64,68 @@
 #define ADMIN_URL "deployment_admin_url"
 #define DEFAULT_ADMIN_URL "localhost:8080"
 
-#define DEPLOYMENT_CACHE_DIR "deployment_cache_dir"
 #define DEPLOYMENT_TAGS "deployment_tags"
 // "http://localhost:8080/deployment/"
 
+#define INSTALL_THREADS "deployment_admin_install_threads"
+#define DEFAULT_INSTALL_THREADS 4
+
 #define VERSIONS "/versions"
+#define MANIFEST_ENTRY "META-INF/MANIFEST.MF"
+#define JOURNAL "deployment.journal"
+
+/*
+ * A deployment package being installed. The package is extracted into a staging directory while it is downloaded,
+ * bundles are installed or updated by a pool of workers as soon as they are extracted. Every change to the installed
+ * bundles is written to the journal before it is made, so a failed deployment can be rolled back.
+ */
+struct deployment_install {
+	deployment_admin_pt admin;
+	char *entry;
+	char stagingDir[512];
+	char *packageDir;
+
+	deployment_package_pt source;
+	deployment_package_pt target;
+
+	celix_thread_mutex_t lock;
+	celix_thread_cond_t queued;
+	array_list_pt tasks;
+	bool closed;
+	int nrOfWorkers;
+	celix_thread_t *workers;
+	celix_status_t status;
+	unsigned int bundles;
+
+	FILE *journal;
+
+	struct timespec begin;
+	double manifestMs;
+	double bundlesMs;
+};
+
+typedef struct deployment_install *deployment_install_pt;
+
+struct deployment_install_task {
+	bundle_info_pt info;
+	char *path;
+};
 
 static void* deploymentAdmin_poll(void *deploymentAdmin);
-celix_status_t deploymentAdmin_download(deployment_admin_pt admin, char * url, char **inputFile);
-size_t deploymentAdmin_writeData(void *ptr, size_t size, size_t nmemb, FILE *stream);
+static celix_status_t deploymentAdmin_install(deployment_admin_pt admin, char *url);
+static size_t deploymentAdmin_streamData(void *ptr, size_t size, size_t nmemb, void *userp);
+static celix_status_t deploymentAdmin_entryExtracted(void *handle, const char *name, const char *path);
+static void *deploymentAdmin_installWorker(void *data);
+static celix_status_t deploymentAdmin_installBundle(deployment_install_pt install, bundle_info_pt info, const char *path);
+static celix_status_t deploymentAdmin_journal(deployment_install_pt install, const char *type, const char *argument, const char *previous);
+static celix_status_t deploymentAdmin_rollback(deployment_admin_pt admin, const char *journalPath);
+static double deploymentAdmin_elapsedMs(struct timespec *begin);
 static celix_status_t deploymentAdmin_deleteTree(char * directory);
 celix_status_t deploymentAdmin_readVersions(deployment_admin_pt admin, array_list_pt versions);
 
 celix_status_t deploymentAdmin_stopDeploymentPackageBundles(deployment_admin_pt admin, deployment_package_pt target);
-celix_status_t deploymentAdmin_updateDeploymentPackageBundles(deployment_admin_pt admin, deployment_package_pt source);
 celix_status_t deploymentAdmin_startDeploymentPackageCustomizerBundles(deployment_admin_pt admin, deployment_package_pt source, deployment_package_pt target);
-celix_status_t deploymentAdmin_processDeploymentPackageResources(deployment_admin_pt admin, deployment_package_pt source);
+celix_status_t deploymentAdmin_processDeploymentPackageResources(deployment_admin_pt admin, deployment_package_pt source, const char *directory);
 celix_status_t deploymentAdmin_dropDeploymentPackageResources(deployment_admin_pt admin, deployment_package_pt source, deployment_package_pt target);
 celix_status_t deploymentAdmin_dropDeploymentPackageBundles(deployment_admin_pt admin, deployment_package_pt source, deployment_package_pt target);
 celix_status_t deploymentAdmin_startDeploymentPackageBundles(deployment_admin_pt admin, deployment_package_pt source);
@@ -100,6 +148,14 @@ celix_status_t deploymentAdmin_create(bundle_context_pt context, deployment_admi
 		(*admin)->targetIdentification = NULL;
 		(*admin)->pollUrl = NULL;
 		(*admin)->auditlogUrl = NULL;
+		(*admin)->installThreads = DEFAULT_INSTALL_THREADS;
+		celixThreadMutex_create(&(*admin)->statisticsLock, NULL);
+
+		const char *installThreads = NULL;
+		bundleContext_getProperty(context, INSTALL_THREADS, &installThreads);
+		if (installThreads != NULL && atoi(installThreads) > 0) {
+			(*admin)->installThreads = atoi(installThreads);
+		}
 
         bundleContext_getProperty(context, IDENTIFICATION_ID, (const char**) &(*admin)->targetIdentification);
         if ((*admin)->targetIdentification == NULL) {
@@ -180,11 +236,20 @@ celix_status_t deploymentAdmin_destroy(deployment_admin_pt admin) {
 	free(admin->pollUrl);
 	free(admin->auditlogUrl);
 
+	celixThreadMutex_destroy(&admin->statisticsLock);
+
 	free(admin);
 
 	return status;
 }
 
+celix_status_t deploymentAdmin_getStatistics(deployment_admin_pt admin, struct deployment_admin_statistics *statistics) {
+	celixThreadMutex_lock(&admin->statisticsLock);
+	*statistics = admin->statistics;
+	celixThreadMutex_unlock(&admin->statisticsLock);
+
+	return CELIX_SUCCESS;
+}
 
 static celix_status_t deploymentAdmin_performRequest(deployment_admin_pt admin, char* entry) {
     celix_status_t status = CELIX_SUCCESS;
@@ -262,6 +327,19 @@ static celix_status_t deploymentAdmin_auditEventFrameworkStarted(deployment_admi
 
 static void *deploymentAdmin_poll(void *deploymentAdmin) {
 	deployment_admin_pt admin = deploymentAdmin;
+	bundle_pt bundle = NULL;
+	char *entry = NULL;
+
+	/*a journal left behind means the framework stopped during a deployment, undo its changes first*/
+	bundleContext_getBundle(admin->context, &bundle);
+	bundle_getEntry(bundle, "/", &entry);
+	if (entry != NULL) {
+		int journalLength = strlen(entry) + strlen(JOURNAL) + 6;
+		char journalPath[journalLength];
+		snprintf(journalPath, journalLength, "%srepo/%s", entry, JOURNAL);
+		deploymentAdmin_rollback(admin, journalPath);
+		free(entry);
+	}
 
 	/*first poll send framework started audit event, note this will register the target in Apache ACE*/
     deploymentAdmin_auditEventFrameworkStarted(admin);
@@ -289,78 +367,9 @@ static void *deploymentAdmin_poll(void *deploymentAdmin) {
                 // snprintf(request, length, "%s/%s?current=%s", admin->pollUrl, last, admin->current);
                 snprintf(request, length, "%s/%s", admin->pollUrl, last);
 
-				char *inputFilename = NULL;
-				celix_status_t status = deploymentAdmin_download(admin ,request, &inputFilename);
-				if (status == CELIX_SUCCESS) {
-					bundle_pt bundle = NULL;
-					bundleContext_getBundle(admin->context, &bundle);
-					char *entry = NULL;
-					bundle_getEntry(bundle, "/", &entry);
-
-					// Handle file
-					char tmpDir[256];
-					char uuid[37];
-					uuid_t uid;
-					uuid_generate(uid);
-					uuid_unparse(uid, uuid);
-                    snprintf(tmpDir, 256, "%s%s", entry, uuid);
-                    if( mkdir(tmpDir, S_IRWXU) == -1){
-                        fw_log(logger, OSGI_FRAMEWORK_LOG_ERROR, "Failed creating directory %s",tmpDir);
-                    }
-
-					// TODO: update to use bundle cache DataFile instead of module entries.
-					unzip_extractDeploymentPackage(inputFilename, tmpDir);
-					int length = strlen(tmpDir) + 22;
-					char manifest[length];
-					snprintf(manifest, length, "%s/META-INF/MANIFEST.MF", tmpDir);
-					manifest_pt mf = NULL;
-					manifest_createFromFile(manifest, &mf);
-					deployment_package_pt source = NULL;
-					deploymentPackage_create(admin->context, mf, &source);
-					const char *name = NULL;
-					deploymentPackage_getName(source, &name);
-
-					int repoDirLength = strlen(entry) + 5;
-					char repoDir[repoDirLength];
-					snprintf(repoDir, repoDirLength, "%srepo", entry);
-					if( mkdir(repoDir, S_IRWXU) == -1){
-						fw_log(logger, OSGI_FRAMEWORK_LOG_ERROR, "Failed creating directory %s",repoDir);
-					}
-
-					int repoCacheLength = strlen(entry) + strlen(name) + 6;
-					char repoCache[repoCacheLength];
-					snprintf(repoCache, repoCacheLength, "%srepo/%s", entry, name);
-					deploymentAdmin_deleteTree(repoCache);
-					int stat = rename(tmpDir, repoCache);
-					if (stat != 0) {
-						fw_log(logger, OSGI_FRAMEWORK_LOG_ERROR, "No success");
-					}
-
-					deployment_package_pt target = hashMap_get(admin->packages, name);
-					if (target == NULL) {
-//						target = empty package
-					}
-
-					deploymentAdmin_stopDeploymentPackageBundles(admin, target);
-					deploymentAdmin_updateDeploymentPackageBundles(admin, source);
-					deploymentAdmin_startDeploymentPackageCustomizerBundles(admin, source, target);
-					deploymentAdmin_processDeploymentPackageResources(admin, source);
-					deploymentAdmin_dropDeploymentPackageResources(admin, source, target);
-					deploymentAdmin_dropDeploymentPackageBundles(admin, source, target);
-					deploymentAdmin_startDeploymentPackageBundles(admin, source);
-
-					deploymentAdmin_deleteTree(repoCache);
-					deploymentAdmin_deleteTree(tmpDir);
-					if( remove(inputFilename) == -1){
-						fw_log(logger, OSGI_FRAMEWORK_LOG_ERROR, "Remove of %s failed",inputFilename);
-					}
+				if (deploymentAdmin_install(admin, request) == CELIX_SUCCESS) {
+					free(admin->current);
 					admin->current = strdup(last);
-					hashMap_put(admin->packages, (char*)name, source);
-
-                    free(entry);
-				}
-				if (inputFilename != NULL) {
-					free(inputFilename);
 				}
 			}
 		}
@@ -438,64 +447,453 @@ celix_status_t deploymentAdmin_readVersions(deployment_admin_pt admin, array_lis
 }
 
 
-celix_status_t deploymentAdmin_download(deployment_admin_pt admin, char * url, char **inputFile) {
+static celix_status_t deploymentAdmin_install(deployment_admin_pt admin, char *url) {
 	celix_status_t status = CELIX_SUCCESS;
-	CURL *curl = NULL;
-	CURLcode res = 0;
-	curl = curl_easy_init();
-	if (curl) {
-		const char *dir = NULL;
-		bundleContext_getProperty(admin->context, DEPLOYMENT_CACHE_DIR, &dir);
-		if (dir != NULL) {
-			*inputFile = calloc(1024, sizeof (char));
-			snprintf(*inputFile, 1024, "%s/%s", dir, "updateXXXXXX");
+	struct deployment_install install;
+	bundle_pt bundle = NULL;
+	zip_stream_pt stream = NULL;
+	double downloadMs = 0.0;
+	double resourcesMs = 0.0;
+	int i;
+
+	memset(&install, 0, sizeof(install));
+	install.admin = admin;
+	install.nrOfWorkers = admin->installThreads;
+	clock_gettime(CLOCK_MONOTONIC, &install.begin);
+	celixThreadMutex_create(&install.lock, NULL);
+	celixThreadCondition_init(&install.queued, NULL);
+	arrayList_create(&install.tasks);
+
+	bundleContext_getBundle(admin->context, &bundle);
+	bundle_getEntry(bundle, "/", &install.entry);
+
+	// (1) the package is extracted into a staging directory next to the previously installed packages
+	int repoDirLength = strlen(install.entry) + 5;
+	char repoDir[repoDirLength];
+	snprintf(repoDir, repoDirLength, "%srepo", install.entry);
+	if (mkdir(repoDir, S_IRWXU) == -1 && errno != EEXIST) {
+		fw_log(logger, OSGI_FRAMEWORK_LOG_ERROR, "Failed creating directory %s", repoDir);
+	}
+
+	char uuid[37];
+	uuid_t uid;
+	uuid_generate(uid);
+	uuid_unparse(uid, uuid);
+	snprintf(install.stagingDir, sizeof(install.stagingDir), "%s/%s", repoDir, uuid);
+	if (mkdir(install.stagingDir, S_IRWXU) == -1) {
+		fw_log(logger, OSGI_FRAMEWORK_LOG_ERROR, "Failed creating directory %s", install.stagingDir);
+		status = CELIX_FILE_IO_EXCEPTION;
+	}
+
+	// (2) the journal records the staging directory and every bundle change before it is made
+	int journalLength = repoDirLength + strlen(JOURNAL) + 1;
+	char journalPath[journalLength];
+	snprintf(journalPath, journalLength, "%s/%s", repoDir, JOURNAL);
+	if (status == CELIX_SUCCESS) {
+		install.journal = fopen(journalPath, "w");
+		if (install.journal == NULL) {
+			fw_log(logger, OSGI_FRAMEWORK_LOG_ERROR, "Failed creating deployment journal %s", journalPath);
+			status = CELIX_FILE_IO_EXCEPTION;
+		} else {
+			status = deploymentAdmin_journal(&install, "staging", install.stagingDir, NULL);
 		}
-		else {
-			*inputFile = strdup("updateXXXXXX");
+	}
+
+	// (3) download and extract the package, the workers install bundles as soon as they are extracted
+	if (status == CELIX_SUCCESS) {
+		install.workers = calloc(install.nrOfWorkers, sizeof(*install.workers));
+		for (i = 0; i < install.nrOfWorkers; i++) {
+			celixThread_create(&install.workers[i], NULL, deploymentAdmin_installWorker, &install);
 		}
-		umask(0011);
-        int fd = mkstemp(*inputFile);
-        if (fd != -1) {
-            FILE *fp = fopen(*inputFile, "wb+");
-            if(fp!=NULL){
-            	curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1);
-            	curl_easy_setopt(curl, CURLOPT_URL, url);
-            	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, deploymentAdmin_writeData);
-            	curl_easy_setopt(curl, CURLOPT_WRITEDATA, fp);
-            	curl_easy_setopt(curl, CURLOPT_FAILONERROR, true);
-            	//curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0);
-            	//curl_easy_setopt(curl, CURLOPT_PROGRESSFUNCTION, updateCommand_downloadProgress);
-            	res = curl_easy_perform(curl);
-
-            	/* always cleanup */
-            	curl_easy_cleanup(curl);
-            	fclose(fp);
-            }
-            else{
-            	status = CELIX_FILE_IO_EXCEPTION;
-            }
-        }
-        else{
-        	status = CELIX_FILE_IO_EXCEPTION;
-        }
+		status = zipStream_create(install.stagingDir, deploymentAdmin_entryExtracted, &install, &stream);
 	}
-	else{
-		res = CURLE_FAILED_INIT;
+
+	if (status == CELIX_SUCCESS) {
+		CURL *curl = curl_easy_init();
+		if (curl == NULL) {
+			status = CELIX_BUNDLE_EXCEPTION;
+		} else {
+			curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1);
+			curl_easy_setopt(curl, CURLOPT_URL, url);
+			curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, deploymentAdmin_streamData);
+			curl_easy_setopt(curl, CURLOPT_WRITEDATA, stream);
+			curl_easy_setopt(curl, CURLOPT_FAILONERROR, true);
+			CURLcode res = curl_easy_perform(curl);
+			if (res != CURLE_OK) {
+				fw_log(logger, OSGI_FRAMEWORK_LOG_ERROR, "Error downloading deployment package %s, got curl error code %d", url, res);
+				status = CELIX_BUNDLE_EXCEPTION;
+			}
+			/* always cleanup */
+			curl_easy_cleanup(curl);
+		}
+		status = CELIX_DO_IF(status, zipStream_finish(stream));
+	}
+	if (stream != NULL) {
+		zipStream_destroy(stream);
 	}
+	downloadMs = deploymentAdmin_elapsedMs(&install.begin);
+
+	// (4) wait until the workers installed or updated all bundles
+	celixThreadMutex_lock(&install.lock);
+	install.closed = true;
+	celixThreadCondition_broadcast(&install.queued);
+	celixThreadMutex_unlock(&install.lock);
+	for (i = 0; install.workers != NULL && i < install.nrOfWorkers; i++) {
+		celixThread_join(install.workers[i], NULL);
+	}
+	free(install.workers);
 
-	if (res != CURLE_OK) {
-		*inputFile[0] = '\0';
+	if (status == CELIX_SUCCESS) {
+		status = install.status;
+	}
+	if (status == CELIX_SUCCESS && install.source == NULL) {
+		fw_log(logger, OSGI_FRAMEWORK_LOG_ERROR, "Deployment package %s has no manifest", url);
 		status = CELIX_ILLEGAL_STATE;
 	}
 
+	// (5) customizers and resources are handled once all bundles are in place
+	if (status == CELIX_SUCCESS) {
+		status = CELIX_DO_IF(status, deploymentAdmin_startDeploymentPackageCustomizerBundles(admin, install.source, install.target));
+		status = CELIX_DO_IF(status, deploymentAdmin_processDeploymentPackageResources(admin, install.source, install.stagingDir));
+		status = CELIX_DO_IF(status, deploymentAdmin_dropDeploymentPackageResources(admin, install.source, install.target));
+		status = CELIX_DO_IF(status, deploymentAdmin_dropDeploymentPackageBundles(admin, install.source, install.target));
+		status = CELIX_DO_IF(status, deploymentAdmin_startDeploymentPackageBundles(admin, install.source));
+		resourcesMs = deploymentAdmin_elapsedMs(&install.begin);
+	}
+
+	// (6) commit by moving the previous package aside and the staging directory in its place. Both moves are
+	// journaled and undone by a rollback, the previous package is only deleted once the journal is removed
+	char previousDir[sizeof(install.stagingDir) + 10];
+	previousDir[0] = '\0';
+	if (status == CELIX_SUCCESS) {
+		if (access(install.packageDir, F_OK) == 0) {
+			snprintf(previousDir, sizeof(previousDir), "%s.previous", install.stagingDir);
+		}
+		status = deploymentAdmin_journal(&install, "replaced", install.packageDir, previousDir);
+	}
+	if (status == CELIX_SUCCESS && previousDir[0] != '\0' && rename(install.packageDir, previousDir) != 0) {
+		fw_log(logger, OSGI_FRAMEWORK_LOG_ERROR, "Failed moving %s to %s", install.packageDir, previousDir);
+		status = CELIX_FILE_IO_EXCEPTION;
+	}
+	if (status == CELIX_SUCCESS && rename(install.stagingDir, install.packageDir) != 0) {
+		fw_log(logger, OSGI_FRAMEWORK_LOG_ERROR, "Failed moving %s to %s", install.stagingDir, install.packageDir);
+		status = CELIX_FILE_IO_EXCEPTION;
+	}
+
+	if (install.journal != NULL) {
+		fclose(install.journal);
+	}
+	if (status == CELIX_SUCCESS && remove(journalPath) == -1) {
+		fw_log(logger, OSGI_FRAMEWORK_LOG_ERROR, "Remove of %s failed", journalPath);
+		status = CELIX_FILE_IO_EXCEPTION;
+	}
+
+	if (status == CELIX_SUCCESS) {
+		const char *name = NULL;
+		deploymentPackage_getName(install.source, &name);
+
+		if (previousDir[0] != '\0' && deploymentAdmin_deleteTree(previousDir) != CELIX_SUCCESS) {
+			fw_log(logger, OSGI_FRAMEWORK_LOG_WARNING, "Failed deleting previous package %s", previousDir);
+		}
+
+		if (install.target != NULL) {
+			hashMap_remove(admin->packages, name);
+			deploymentPackage_destroy(install.target);
+		}
+		hashMap_put(admin->packages, (char*)name, install.source);
+	} else {
+		fw_log(logger, OSGI_FRAMEWORK_LOG_ERROR, "Deployment of %s failed, rolling back", url);
+		deploymentAdmin_rollback(admin, journalPath);
+		if (install.target != NULL) {
+			deploymentAdmin_startDeploymentPackageBundles(admin, install.target);
+		}
+		if (install.source != NULL) {
+			deploymentPackage_destroy(install.source);
+		}
+	}
+
+	celixThreadMutex_lock(&admin->statisticsLock);
+	if (status == CELIX_SUCCESS) {
+		admin->statistics.deployments++;
+	} else {
+		admin->statistics.rollbacks++;
+	}
+	admin->statistics.bundles = install.bundles;
+	admin->statistics.manifestMs = install.manifestMs;
+	admin->statistics.downloadMs = downloadMs;
+	admin->statistics.bundlesMs = install.bundlesMs;
+	admin->statistics.resourcesMs = resourcesMs;
+	admin->statistics.totalMs = deploymentAdmin_elapsedMs(&install.begin);
+	celixThreadMutex_unlock(&admin->statisticsLock);
+
+	fw_log(logger, OSGI_FRAMEWORK_LOG_INFO, "Deployment of %s %s after %.3f ms: manifest %.3f ms, download %.3f ms, %u bundles %.3f ms, resources %.3f ms",
+			url, status == CELIX_SUCCESS ? "succeeded" : "rolled back", deploymentAdmin_elapsedMs(&install.begin), install.manifestMs,
+			downloadMs, install.bundles, install.bundlesMs, resourcesMs);
+
+	arrayList_destroy(install.tasks);
+	celixThreadCondition_destroy(&install.queued);
+	celixThreadMutex_destroy(&install.lock);
+	free(install.packageDir);
+	free(install.entry);
+
+	return status;
+}
+
+static size_t deploymentAdmin_streamData(void *ptr, size_t size, size_t nmemb, void *userp) {
+	zip_stream_pt stream = userp;
+	size_t realsize = size * nmemb;
+
+	// returning less than realsize aborts the download
+	return zipStream_write(stream, ptr, realsize) == CELIX_SUCCESS ? realsize : 0;
+}
+
+static celix_status_t deploymentAdmin_entryExtracted(void *handle, const char *name, const char *path) {
+	deployment_install_pt install = handle;
+	celix_status_t status = CELIX_SUCCESS;
+
+	celixThreadMutex_lock(&install->lock);
+	status = install->status;
+	celixThreadMutex_unlock(&install->lock);
+
+	if (status != CELIX_SUCCESS) {
+		// a bundle could not be installed, stop the download
+	} else if (strcmp(name, MANIFEST_ENTRY) == 0) {
+		manifest_pt mf = NULL;
+		const char *packageName = NULL;
+
+		status = manifest_createFromFile((char *) path, &mf);
+		status = CELIX_DO_IF(status, deploymentPackage_create(install->admin->context, mf, &install->source));
+		status = CELIX_DO_IF(status, deploymentPackage_getName(install->source, &packageName));
+		if (status == CELIX_SUCCESS && packageName == NULL) {
+			fw_log(logger, OSGI_FRAMEWORK_LOG_ERROR, "DEPLOYMENT_ADMIN: Deployment package has no symbolic name");
+			status = CELIX_ILLEGAL_ARGUMENT;
+		}
+
+		if (status == CELIX_SUCCESS) {
+			int packageDirLength = strlen(install->entry) + strlen(packageName) + 6;
+			install->packageDir = malloc(packageDirLength);
+			snprintf(install->packageDir, packageDirLength, "%srepo/%s", install->entry, packageName);
+
+			install->target = hashMap_get(install->admin->packages, packageName);
+			deploymentAdmin_stopDeploymentPackageBundles(install->admin, install->target);
+			install->manifestMs = deploymentAdmin_elapsedMs(&install->begin);
+		}
+	} else if (install->source == NULL) {
+		fw_log(logger, OSGI_FRAMEWORK_LOG_ERROR, "DEPLOYMENT_ADMIN: %s must be the first entry of a deployment package, found %s", MANIFEST_ENTRY, name);
+		status = CELIX_ILLEGAL_ARGUMENT;
+	} else {
+		bundle_info_pt info = NULL;
+		deploymentPackage_getBundleInfoByPath(install->source, name, &info);
+		if (info != NULL) {
+			struct deployment_install_task *task = calloc(1, sizeof(*task));
+			task->info = info;
+			task->path = strdup(path);
+
+			celixThreadMutex_lock(&install->lock);
+			arrayList_add(install->tasks, task);
+			celixThreadCondition_signal(&install->queued);
+			celixThreadMutex_unlock(&install->lock);
+		}
+		// resources are processed from the staging directory once all bundles are installed
+	}
+
+	return status;
+}
+
+static void *deploymentAdmin_installWorker(void *data) {
+	deployment_install_pt install = data;
+
+	celixThreadMutex_lock(&install->lock);
+	while (!install->closed || arrayList_size(install->tasks) > 0) {
+		if (arrayList_size(install->tasks) == 0) {
+			celixThreadCondition_wait(&install->queued, &install->lock);
+		} else {
+			struct deployment_install_task *task = arrayList_remove(install->tasks, 0);
+			bool failed = install->status != CELIX_SUCCESS;
+			celix_status_t status = CELIX_SUCCESS;
+			celixThreadMutex_unlock(&install->lock);
+
+			// once a bundle failed the deployment is rolled back, skip the remaining bundles
+			if (!failed) {
+				status = deploymentAdmin_installBundle(install, task->info, task->path);
+			}
+			free(task->path);
+			free(task);
+
+			celixThreadMutex_lock(&install->lock);
+			if (status != CELIX_SUCCESS && install->status == CELIX_SUCCESS) {
+				install->status = status;
+			} else if (status == CELIX_SUCCESS && !failed) {
+				install->bundles++;
+				install->bundlesMs = deploymentAdmin_elapsedMs(&install->begin);
+			}
+		}
+	}
+	celixThreadMutex_unlock(&install->lock);
+
+	return NULL;
+}
+
+static celix_status_t deploymentAdmin_installBundle(deployment_install_pt install, bundle_info_pt info, const char *path) {
+	celix_status_t status = CELIX_SUCCESS;
+	bundle_pt bundle = NULL;
+
+	int locationLength = strlen(info->symbolicName) + 9;
+	char location[locationLength];
+	snprintf(location, locationLength, "osgi-dp:%s", info->symbolicName);
+
+	deploymentPackage_getBundle(install->source, info->symbolicName, &bundle);
+	if (bundle != NULL) {
+		// an update is rolled back by updating the bundle again from the file of the previous package
+		bundle_info_pt targetInfo = NULL;
+		long id = 0;
+		if (install->target != NULL) {
+			deploymentPackage_getBundleInfoByName(install->target, info->symbolicName, &targetInfo);
+		}
+		int previousLength = targetInfo != NULL ? strlen(install->packageDir) + strlen(targetInfo->path) + 2 : 1;
+		char previous[previousLength];
+		previous[0] = '\0';
+		if (targetInfo != NULL) {
+			snprintf(previous, previousLength, "%s/%s", install->packageDir, targetInfo->path);
+		}
+		char idStr[32];
+		bundle_getBundleId(bundle, &id);
+		snprintf(idStr, sizeof(idStr), "%ld", id);
+
+		status = deploymentAdmin_journal(install, "updated", idStr, previous);
+		status = CELIX_DO_IF(status, bundle_update(bundle, path));
+	} else {
+		status = deploymentAdmin_journal(install, "installed", location, NULL);
+		status = CELIX_DO_IF(status, bundleContext_installBundle2(install->admin->context, location, path, &bundle));
+	}
+
+	if (status != CELIX_SUCCESS) {
+		fw_log(logger, OSGI_FRAMEWORK_LOG_ERROR, "DEPLOYMENT_ADMIN: Could not install bundle %s from %s", info->symbolicName, path);
+	}
+
 	return status;
 }
 
-size_t deploymentAdmin_writeData(void *ptr, size_t size, size_t nmemb, FILE *stream) {
-    size_t written = fwrite(ptr, size, nmemb, stream);
-    return written;
+/*
+ * Appends a line to the journal and syncs it, the change it describes may only be made afterwards.
+ */
+static celix_status_t deploymentAdmin_journal(deployment_install_pt install, const char *type, const char *argument, const char *previous) {
+	celix_status_t status = CELIX_SUCCESS;
+
+	celixThreadMutex_lock(&install->lock);
+	if (previous != NULL && previous[0] != '\0') {
+		fprintf(install->journal, "%s %s %s\n", type, argument, previous);
+	} else {
+		fprintf(install->journal, "%s %s\n", type, argument);
+	}
+	if (fflush(install->journal) != 0 || fdatasync(fileno(install->journal)) != 0) {
+		fw_log(logger, OSGI_FRAMEWORK_LOG_ERROR, "DEPLOYMENT_ADMIN: Cannot write deployment journal");
+		status = CELIX_FILE_IO_EXCEPTION;
+	}
+	celixThreadMutex_unlock(&install->lock);
+
+	return status;
 }
 
+/*
+ * Undoes the changes recorded in a journal in reverse order: the previous package directory is put back, installed
+ * bundles are uninstalled, updated bundles are updated again from the previous package and the staging directory is
+ * removed. Finally the journal is removed.
+ */
+static celix_status_t deploymentAdmin_rollback(deployment_admin_pt admin, const char *journalPath) {
+	celix_status_t status = CELIX_SUCCESS;
+	array_list_pt lines = NULL;
+	char line[1024];
+	int i;
+
+	FILE *journal = fopen(journalPath, "r");
+	if (journal == NULL) {
+		return CELIX_SUCCESS;
+	}
+
+	arrayList_create(&lines);
+	while (fgets(line, sizeof(line), journal) != NULL) {
+		arrayList_add(lines, strdup(line));
+	}
+	fclose(journal);
+
+	for (i = arrayList_size(lines) - 1; i >= 0; i--) {
+		char *last = NULL;
+		char *type = strtok_r(arrayList_get(lines, i), " \n", &last);
+		char *argument = strtok_r(NULL, " \n", &last);
+		char *previous = strtok_r(NULL, "\n", &last);
+		bundle_pt bundle = NULL;
+
+		if (type == NULL || argument == NULL) {
+			// the last line can be incomplete if the framework stopped while writing it
+			continue;
+		}
+
+		if (strcmp(type, "replaced") == 0) {
+			// the package directory holds the new package once the staging directory is moved, put the previous
+			// package back if it was moved aside already
+			bool moved = previous == NULL || access(previous, F_OK) == 0;
+			if (moved && access(argument, F_OK) == 0) {
+				deploymentAdmin_deleteTree(argument);
+			}
+			if (previous != NULL && moved && rename(previous, argument) != 0) {
+				fw_log(logger, OSGI_FRAMEWORK_LOG_ERROR, "DEPLOYMENT_ADMIN: Cannot move previous package %s back to %s", previous, argument);
+				status = CELIX_FILE_IO_EXCEPTION;
+			}
+		} else if (strcmp(type, "staging") == 0) {
+			if (access(argument, F_OK) == 0) {
+				deploymentAdmin_deleteTree(argument);
+			}
+		} else if (strcmp(type, "installed") == 0) {
+			array_list_pt bundles = NULL;
+			int j;
+			bundleContext_getBundles(admin->context, &bundles);
+			for (j = 0; bundles != NULL && j < arrayList_size(bundles); j++) {
+				bundle_archive_pt archive = NULL;
+				const char *location = NULL;
+				bundle_getArchive(arrayList_get(bundles, j), &archive);
+				if (archive != NULL && bundleArchive_getLocation(archive, &location) == CELIX_SUCCESS && location != NULL && strcmp(location, argument) == 0) {
+					bundle = arrayList_get(bundles, j);
+				}
+			}
+			if (bundles != NULL) {
+				arrayList_destroy(bundles);
+			}
+			if (bundle != NULL && bundle_uninstall(bundle) != CELIX_SUCCESS) {
+				status = CELIX_BUNDLE_EXCEPTION;
+			}
+		} else if (strcmp(type, "updated") == 0) {
+			bundleContext_getBundleById(admin->context, atol(argument), &bundle);
+			if (bundle == NULL) {
+				status = CELIX_BUNDLE_EXCEPTION;
+			} else if (previous == NULL || access(previous, R_OK) != 0) {
+				fw_log(logger, OSGI_FRAMEWORK_LOG_ERROR, "DEPLOYMENT_ADMIN: Cannot roll back update of bundle %s, previous version is not available", argument);
+				status = CELIX_BUNDLE_EXCEPTION;
+			} else if (bundle_update(bundle, previous) != CELIX_SUCCESS) {
+				status = CELIX_BUNDLE_EXCEPTION;
+			}
+		}
+	}
+
+	for (i = 0; i < arrayList_size(lines); i++) {
+		free(arrayList_get(lines, i));
+	}
+	arrayList_destroy(lines);
+
+	if (remove(journalPath) == -1) {
+		fw_log(logger, OSGI_FRAMEWORK_LOG_ERROR, "Remove of %s failed", journalPath);
+	}
+
+	framework_logIfError(logger, status, NULL, "Failed to roll back deployment");
+
+	return status;
+}
+
+static double deploymentAdmin_elapsedMs(struct timespec *begin) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - begin->tv_sec) * 1000.0 + (now.tv_nsec - begin->tv_nsec) / 1000000.0;
+}
 
 static celix_status_t deploymentAdmin_deleteTree(char * directory) {
 	DIR *dir;
@@ -565,47 +963,6 @@ celix_status_t deploymentAdmin_stopDeploymentPackageBundles(deployment_admin_pt
 	return status;
 }
 
-celix_status_t deploymentAdmin_updateDeploymentPackageBundles(deployment_admin_pt admin, deployment_package_pt source) {
-	celix_status_t status = CELIX_SUCCESS;
-
-	array_list_pt infos = NULL;
-	deploymentPackage_getBundleInfos(source, &infos);
-	int i;
-	for (i = 0; i < arrayList_size(infos); i++) {
-		bundle_pt bundle = NULL;
-		bundle_info_pt info = arrayList_get(infos, i);
-
-		bundleContext_getBundle(admin->context, &bundle);
-		char *entry = NULL;
-		bundle_getEntry(bundle, "/", &entry);
-		const char *name = NULL;
-		deploymentPackage_getName(source, &name);
-
-		int bundlePathLength = strlen(entry) + strlen(name) + strlen(info->path) + 7;
-		int bsnLength = strlen(info->symbolicName) + 9;
-
-		char bundlePath[bundlePathLength];
-		snprintf(bundlePath, bundlePathLength, "%srepo/%s/%s", entry, name, info->path);
-
-		char bsn[bsnLength];
-		snprintf(bsn, bsnLength, "osgi-dp:%s", info->symbolicName);
-
-		bundle_pt updateBundle = NULL;
-		deploymentPackage_getBundle(source, info->symbolicName, &updateBundle);
-		if (updateBundle != NULL) {
-			//printf("Update bundle from: %s\n", bundlePath);
-			bundle_update(updateBundle, bundlePath);
-		} else {
-			//printf("Install bundle from: %s\n", bundlePath);
-			bundleContext_installBundle2(admin->context, bsn, bundlePath, &updateBundle);
-		}
-
-        free(entry);
-	}
-	arrayList_destroy(infos);
-	return status;
-}
-
 celix_status_t deploymentAdmin_startDeploymentPackageCustomizerBundles(deployment_admin_pt admin, deployment_package_pt source, deployment_package_pt target) {
 	celix_status_t status = CELIX_SUCCESS;
 
@@ -654,7 +1011,7 @@ celix_status_t deploymentAdmin_startDeploymentPackageCustomizerBundles(deploymen
 	return status;
 }
 
-celix_status_t deploymentAdmin_processDeploymentPackageResources(deployment_admin_pt admin, deployment_package_pt source) {
+celix_status_t deploymentAdmin_processDeploymentPackageResources(deployment_admin_pt admin, deployment_package_pt source, const char *directory) {
 	celix_status_t status = CELIX_SUCCESS;
 
 	array_list_pt infos = NULL;
@@ -677,25 +1034,16 @@ celix_status_t deploymentAdmin_processDeploymentPackageResources(deployment_admi
 				void *processorP = NULL;
 				status = bundleContext_getService(admin->context, ref, &processorP);
 				if (status == CELIX_SUCCESS) {
-					bundle_pt bundle = NULL;
-					char *entry = NULL;
-					const char *name = NULL;
 					const char *packageName = NULL;
 					resource_processor_service_pt processor = processorP;
 
-					bundleContext_getBundle(admin->context, &bundle);
-					bundle_getEntry(bundle, "/", &entry);
-					deploymentPackage_getName(source, &name);
-
-					int length = strlen(entry) + strlen(name) + strlen(info->path) + 7;
+					int length = strlen(directory) + strlen(info->path) + 2;
 					char resourcePath[length];
-					snprintf(resourcePath, length, "%srepo/%s/%s", entry, name, info->path);
+					snprintf(resourcePath, length, "%s/%s", directory, info->path);
 					deploymentPackage_getName(source, &packageName);
 
 					processor->begin(processor->processor, (char*)packageName);
 					processor->process(processor->processor, info->path, resourcePath);
-
-                    free(entry);
 				}
 			}
 		}
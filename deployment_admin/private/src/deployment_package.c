@@ -54,6 +54,7 @@ celix_status_t deploymentPackage_create(bundle_context_pt context, manifest_pt m
 		(*package)->bundleInfos = NULL;
 		(*package)->resourceInfos = NULL;
 		(*package)->nameToBundleInfo = hashMap_create(utils_stringHash, NULL, utils_stringEquals, NULL);
+		(*package)->pathToBundleInfo = hashMap_create(utils_stringHash, NULL, utils_stringEquals, NULL);
 		(*package)->pathToEntry = hashMap_create(utils_stringHash, NULL, utils_stringEquals, NULL);
 		status = arrayList_create(&(*package)->bundleInfos);
 		if (status == CELIX_SUCCESS) {
@@ -65,6 +66,7 @@ celix_status_t deploymentPackage_create(bundle_context_pt context, manifest_pt m
 					for (i = 0; i < arrayList_size((*package)->bundleInfos); i++) {
 						bundle_info_pt info = arrayList_get((*package)->bundleInfos, i);
 						hashMap_put((*package)->nameToBundleInfo, info->symbolicName, info);
+						hashMap_put((*package)->pathToBundleInfo, info->path, info);
 					}
 					for (i = 0; i < arrayList_size((*package)->resourceInfos); i++) {
 						resource_info_pt info = arrayList_get((*package)->resourceInfos, i);
@@ -86,6 +88,7 @@ celix_status_t deploymentPackage_destroy(deployment_package_pt package) {
     manifest_destroy(package->manifest);
 
 	hashMap_destroy(package->nameToBundleInfo, false, false);
+	hashMap_destroy(package->pathToBundleInfo, false, false);
 	hashMap_destroy(package->pathToEntry, false, false);
 
 
@@ -122,6 +125,11 @@ celix_status_t deploymentPackage_getBundleInfoByName(deployment_package_pt packa
 	return CELIX_SUCCESS;
 }
 
+celix_status_t deploymentPackage_getBundleInfoByPath(deployment_package_pt package, const char *path, bundle_info_pt *info) {
+	*info = hashMap_get(package->pathToBundleInfo, path);
+	return CELIX_SUCCESS;
+}
+
 celix_status_t deploymentPackage_getBundle(deployment_package_pt package, const char *name, bundle_pt *bundle) {
 	if (hashMap_containsKey(package->nameToBundleInfo, name)) {
 		array_list_pt bundles = NULL;
@@ -0,0 +1,493 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+/*
+ * zip_stream.c
+ *
+ *  \author    	<a href="mailto:dev@celix.apache.org">Apache Celix Project Team</a>
+ *  \copyright	Apache License, Version 2.0
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <zlib.h>
+
+#include "celix_log.h"
+#include "zip_stream.h"
+
+#define LOCAL_HEADER_SIGNATURE			0x04034b50
+#define CENTRAL_HEADER_SIGNATURE		0x02014b50
+#define END_OF_CENTRAL_DIR_SIGNATURE	0x06054b50
+#define DATA_DESCRIPTOR_SIGNATURE		0x08074b50
+
+#define LOCAL_HEADER_SIZE		30
+#define DATA_DESCRIPTOR_SIZE	12
+
+#define FLAG_ENCRYPTED			0x0001
+#define FLAG_DATA_DESCRIPTOR	0x0008
+
+#define METHOD_STORED	0
+#define METHOD_DEFLATED	8
+
+#define ZIP64_SIZE		0xFFFFFFFFUL
+
+#define OUTPUT_BUFFER_SIZE	(64 * 1024)
+
+typedef enum {
+	ZIP_STREAM_SIGNATURE,
+	ZIP_STREAM_LOCAL_HEADER,
+	ZIP_STREAM_NAME,
+	ZIP_STREAM_DATA,
+	ZIP_STREAM_DESCRIPTOR,
+	ZIP_STREAM_DONE,
+	ZIP_STREAM_FAILED
+} zip_stream_state_e;
+
+struct zip_stream {
+	char *destination;
+	zip_stream_entry_fpt entryExtracted;
+	void *handle;
+
+	zip_stream_state_e state;
+
+	// header bytes collected over several writes
+	unsigned char *buffer;
+	size_t bufferSize;
+	size_t buffered;
+
+	// the entry being extracted
+	unsigned int flags;
+	unsigned int method;
+	unsigned long crc;
+	unsigned long compressedSize;
+	unsigned long uncompressedSize;
+	unsigned int nameLength;
+	unsigned int extraLength;
+	char *name;
+	char *path;
+	FILE *file;
+	unsigned long remaining;
+	unsigned long actualCrc;
+	unsigned long written;
+
+	z_stream inflater;
+	bool inflating;
+	unsigned char *output;
+};
+
+static bool zipStream_collect(zip_stream_pt stream, const unsigned char **data, size_t *size, size_t needed);
+static celix_status_t zipStream_beginEntry(zip_stream_pt stream);
+static celix_status_t zipStream_writeEntry(zip_stream_pt stream, const unsigned char *data, size_t size);
+static celix_status_t zipStream_inflateEntry(zip_stream_pt stream, const unsigned char **data, size_t *size);
+static celix_status_t zipStream_endEntry(zip_stream_pt stream);
+static void zipStream_closeEntry(zip_stream_pt stream);
+static celix_status_t zipStream_makeDirectories(char *path);
+static bool zipStream_isSafeName(const char *name);
+
+static unsigned int zipStream_readShort(const unsigned char *data) {
+	return data[0] | (data[1] << 8);
+}
+
+static unsigned long zipStream_readInt(const unsigned char *data) {
+	return (unsigned long) data[0] | ((unsigned long) data[1] << 8) | ((unsigned long) data[2] << 16) | ((unsigned long) data[3] << 24);
+}
+
+celix_status_t zipStream_create(const char *destination, zip_stream_entry_fpt entryExtracted, void *handle, zip_stream_pt *stream) {
+	celix_status_t status = CELIX_SUCCESS;
+
+	*stream = calloc(1, sizeof(**stream));
+	if (!*stream) {
+		status = CELIX_ENOMEM;
+	} else {
+		(*stream)->destination = strdup(destination);
+		(*stream)->entryExtracted = entryExtracted;
+		(*stream)->handle = handle;
+		(*stream)->state = ZIP_STREAM_SIGNATURE;
+		(*stream)->bufferSize = LOCAL_HEADER_SIZE;
+		(*stream)->buffer = malloc((*stream)->bufferSize);
+		(*stream)->output = malloc(OUTPUT_BUFFER_SIZE);
+
+		if ((*stream)->destination == NULL || (*stream)->buffer == NULL || (*stream)->output == NULL) {
+			zipStream_destroy(*stream);
+			*stream = NULL;
+			status = CELIX_ENOMEM;
+		}
+	}
+
+	return status;
+}
+
+celix_status_t zipStream_destroy(zip_stream_pt stream) {
+	zipStream_closeEntry(stream);
+
+	free(stream->destination);
+	free(stream->buffer);
+	free(stream->output);
+	free(stream);
+
+	return CELIX_SUCCESS;
+}
+
+celix_status_t zipStream_write(zip_stream_pt stream, const void *data, size_t size) {
+	celix_status_t status = CELIX_SUCCESS;
+	const unsigned char *bytes = data;
+
+	if (stream->state == ZIP_STREAM_FAILED) {
+		return CELIX_ILLEGAL_STATE;
+	}
+
+	while (size > 0 && status == CELIX_SUCCESS && stream->state != ZIP_STREAM_DONE) {
+		switch (stream->state) {
+			case ZIP_STREAM_SIGNATURE:
+				if (zipStream_collect(stream, &bytes, &size, 4)) {
+					unsigned long signature = zipStream_readInt(stream->buffer);
+					if (signature == LOCAL_HEADER_SIGNATURE) {
+						stream->state = ZIP_STREAM_LOCAL_HEADER;
+					} else if (signature == CENTRAL_HEADER_SIGNATURE || signature == END_OF_CENTRAL_DIR_SIGNATURE) {
+						// all entries are extracted, the central directory only repeats the headers
+						stream->state = ZIP_STREAM_DONE;
+					} else {
+						fw_log(logger, OSGI_FRAMEWORK_LOG_ERROR, "DEPLOYMENT_ADMIN: Unexpected zip signature 0x%08lx", signature);
+						status = CELIX_ILLEGAL_STATE;
+					}
+				}
+				break;
+			case ZIP_STREAM_LOCAL_HEADER:
+				if (zipStream_collect(stream, &bytes, &size, LOCAL_HEADER_SIZE)) {
+					stream->flags = zipStream_readShort(stream->buffer + 6);
+					stream->method = zipStream_readShort(stream->buffer + 8);
+					stream->crc = zipStream_readInt(stream->buffer + 14);
+					stream->compressedSize = zipStream_readInt(stream->buffer + 18);
+					stream->uncompressedSize = zipStream_readInt(stream->buffer + 22);
+					stream->nameLength = zipStream_readShort(stream->buffer + 26);
+					stream->extraLength = zipStream_readShort(stream->buffer + 28);
+
+					size_t needed = LOCAL_HEADER_SIZE + stream->nameLength + stream->extraLength;
+					if (needed > stream->bufferSize) {
+						unsigned char *buffer = realloc(stream->buffer, needed);
+						if (buffer == NULL) {
+							status = CELIX_ENOMEM;
+						} else {
+							stream->buffer = buffer;
+							stream->bufferSize = needed;
+						}
+					}
+					stream->state = ZIP_STREAM_NAME;
+				}
+				break;
+			case ZIP_STREAM_NAME:
+				if (zipStream_collect(stream, &bytes, &size, LOCAL_HEADER_SIZE + stream->nameLength + stream->extraLength)) {
+					status = zipStream_beginEntry(stream);
+				}
+				break;
+			case ZIP_STREAM_DATA:
+				if (stream->method == METHOD_STORED) {
+					size_t chunk = size < stream->remaining ? size : stream->remaining;
+					status = zipStream_writeEntry(stream, bytes, chunk);
+					stream->remaining -= chunk;
+					bytes += chunk;
+					size -= chunk;
+					if (status == CELIX_SUCCESS && stream->remaining == 0) {
+						status = zipStream_endEntry(stream);
+					}
+				} else {
+					status = zipStream_inflateEntry(stream, &bytes, &size);
+				}
+				break;
+			case ZIP_STREAM_DESCRIPTOR:
+				// the signature of the data descriptor is optional
+				if (zipStream_collect(stream, &bytes, &size, DATA_DESCRIPTOR_SIZE)) {
+					const unsigned char *descriptor = stream->buffer;
+					bool complete = true;
+					if (zipStream_readInt(descriptor) == DATA_DESCRIPTOR_SIGNATURE) {
+						complete = zipStream_collect(stream, &bytes, &size, DATA_DESCRIPTOR_SIZE + 4);
+						descriptor += 4;
+					}
+					if (complete) {
+						stream->crc = zipStream_readInt(descriptor);
+						stream->compressedSize = zipStream_readInt(descriptor + 4);
+						stream->uncompressedSize = zipStream_readInt(descriptor + 8);
+						status = zipStream_endEntry(stream);
+					}
+				}
+				break;
+			default:
+				status = CELIX_ILLEGAL_STATE;
+				break;
+		}
+	}
+
+	if (status != CELIX_SUCCESS) {
+		stream->state = ZIP_STREAM_FAILED;
+		zipStream_closeEntry(stream);
+	}
+
+	return status;
+}
+
+celix_status_t zipStream_finish(zip_stream_pt stream) {
+	celix_status_t status = CELIX_SUCCESS;
+
+	if (stream->state != ZIP_STREAM_DONE && !(stream->state == ZIP_STREAM_SIGNATURE && stream->buffered == 0)) {
+		fw_log(logger, OSGI_FRAMEWORK_LOG_ERROR, "DEPLOYMENT_ADMIN: Zip stream ended in the middle of an entry");
+		status = CELIX_ILLEGAL_STATE;
+	}
+
+	return status;
+}
+
+/*
+ * Copies bytes to the header buffer until it holds needed bytes, returns true if it does. The buffer is reset when
+ * the state changes, see zipStream_beginEntry and zipStream_endEntry.
+ */
+static bool zipStream_collect(zip_stream_pt stream, const unsigned char **data, size_t *size, size_t needed) {
+	if (stream->buffered < needed) {
+		size_t chunk = needed - stream->buffered;
+		if (chunk > *size) {
+			chunk = *size;
+		}
+		memcpy(stream->buffer + stream->buffered, *data, chunk);
+		stream->buffered += chunk;
+		*data += chunk;
+		*size -= chunk;
+	}
+
+	return stream->buffered == needed;
+}
+
+static celix_status_t zipStream_beginEntry(zip_stream_pt stream) {
+	celix_status_t status = CELIX_SUCCESS;
+
+	stream->name = strndup((char *) stream->buffer + LOCAL_HEADER_SIZE, stream->nameLength);
+	stream->buffered = 0;
+	stream->remaining = stream->compressedSize;
+	stream->actualCrc = crc32(0L, Z_NULL, 0);
+	stream->written = 0;
+
+	if (stream->name == NULL) {
+		status = CELIX_ENOMEM;
+	} else if (!zipStream_isSafeName(stream->name)) {
+		fw_log(logger, OSGI_FRAMEWORK_LOG_ERROR, "DEPLOYMENT_ADMIN: Refusing zip entry %s outside of the destination", stream->name);
+		status = CELIX_ILLEGAL_ARGUMENT;
+	} else if ((stream->flags & FLAG_ENCRYPTED) != 0 || (stream->method != METHOD_STORED && stream->method != METHOD_DEFLATED)) {
+		fw_log(logger, OSGI_FRAMEWORK_LOG_ERROR, "DEPLOYMENT_ADMIN: Zip entry %s is encrypted or uses an unsupported compression method", stream->name);
+		status = CELIX_ILLEGAL_ARGUMENT;
+	} else if (stream->method == METHOD_STORED && (stream->flags & FLAG_DATA_DESCRIPTOR) != 0) {
+		// the end of a stored entry can only be found with the size from the central directory
+		fw_log(logger, OSGI_FRAMEWORK_LOG_ERROR, "DEPLOYMENT_ADMIN: Stored zip entry %s without size cannot be streamed", stream->name);
+		status = CELIX_ILLEGAL_ARGUMENT;
+	} else if ((stream->flags & FLAG_DATA_DESCRIPTOR) == 0 && (stream->compressedSize == ZIP64_SIZE || stream->uncompressedSize == ZIP64_SIZE)) {
+		fw_log(logger, OSGI_FRAMEWORK_LOG_ERROR, "DEPLOYMENT_ADMIN: Zip64 entry %s is not supported", stream->name);
+		status = CELIX_ILLEGAL_ARGUMENT;
+	}
+
+	if (status == CELIX_SUCCESS) {
+		int length = strlen(stream->destination) + strlen(stream->name) + 2;
+		stream->path = malloc(length);
+		if (stream->path == NULL) {
+			status = CELIX_ENOMEM;
+		} else {
+			snprintf(stream->path, length, "%s/%s", stream->destination, stream->name);
+			status = zipStream_makeDirectories(stream->path);
+		}
+	}
+
+	if (status == CELIX_SUCCESS) {
+		if (stream->name[strlen(stream->name) - 1] == '/') {
+			// directory entry, created by zipStream_makeDirectories
+			stream->remaining = 0;
+		} else {
+			stream->file = fopen(stream->path, "wb");
+			if (stream->file == NULL) {
+				fw_log(logger, OSGI_FRAMEWORK_LOG_ERROR, "DEPLOYMENT_ADMIN: Cannot create %s: %s", stream->path, strerror(errno));
+				status = CELIX_FILE_IO_EXCEPTION;
+			}
+		}
+	}
+
+	if (status == CELIX_SUCCESS && stream->method == METHOD_DEFLATED) {
+		memset(&stream->inflater, 0, sizeof(stream->inflater));
+		if (inflateInit2(&stream->inflater, -MAX_WBITS) != Z_OK) {
+			status = CELIX_ENOMEM;
+		} else {
+			stream->inflating = true;
+		}
+	}
+
+	if (status == CELIX_SUCCESS) {
+		stream->state = ZIP_STREAM_DATA;
+		if (stream->method == METHOD_STORED && stream->remaining == 0) {
+			status = zipStream_endEntry(stream);
+		}
+	}
+
+	return status;
+}
+
+static celix_status_t zipStream_writeEntry(zip_stream_pt stream, const unsigned char *data, size_t size) {
+	celix_status_t status = CELIX_SUCCESS;
+
+	if (size > 0) {
+		if (stream->file == NULL || fwrite(data, 1, size, stream->file) != size) {
+			fw_log(logger, OSGI_FRAMEWORK_LOG_ERROR, "DEPLOYMENT_ADMIN: Cannot write %s", stream->path);
+			status = CELIX_FILE_IO_EXCEPTION;
+		} else {
+			stream->actualCrc = crc32(stream->actualCrc, data, size);
+			stream->written += size;
+		}
+	}
+
+	return status;
+}
+
+static celix_status_t zipStream_inflateEntry(zip_stream_pt stream, const unsigned char **data, size_t *size) {
+	celix_status_t status = CELIX_SUCCESS;
+	bool descriptor = (stream->flags & FLAG_DATA_DESCRIPTOR) != 0;
+	size_t available = *size;
+	int result = Z_OK;
+
+	// without data descriptor the compressed size is known, never hand the next header to zlib
+	if (!descriptor && available > stream->remaining) {
+		available = stream->remaining;
+	}
+
+	stream->inflater.next_in = (Bytef *) *data;
+	stream->inflater.avail_in = available;
+	while (status == CELIX_SUCCESS && result == Z_OK && (stream->inflater.avail_in > 0 || stream->inflater.avail_out == 0)) {
+		stream->inflater.next_out = stream->output;
+		stream->inflater.avail_out = OUTPUT_BUFFER_SIZE;
+		result = inflate(&stream->inflater, Z_NO_FLUSH);
+		if (result == Z_OK || result == Z_STREAM_END || result == Z_BUF_ERROR) {
+			status = zipStream_writeEntry(stream, stream->output, OUTPUT_BUFFER_SIZE - stream->inflater.avail_out);
+		} else {
+			fw_log(logger, OSGI_FRAMEWORK_LOG_ERROR, "DEPLOYMENT_ADMIN: Cannot inflate zip entry %s", stream->name);
+			status = CELIX_ILLEGAL_STATE;
+		}
+	}
+
+	size_t consumed = available - stream->inflater.avail_in;
+	*data += consumed;
+	*size -= consumed;
+	if (!descriptor) {
+		stream->remaining -= consumed;
+	}
+
+	if (status == CELIX_SUCCESS) {
+		if (result == Z_STREAM_END) {
+			inflateEnd(&stream->inflater);
+			stream->inflating = false;
+			if (descriptor) {
+				stream->state = ZIP_STREAM_DESCRIPTOR;
+			} else if (stream->remaining != 0) {
+				fw_log(logger, OSGI_FRAMEWORK_LOG_ERROR, "DEPLOYMENT_ADMIN: Compressed size of zip entry %s does not match", stream->name);
+				status = CELIX_ILLEGAL_STATE;
+			} else {
+				status = zipStream_endEntry(stream);
+			}
+		} else if (!descriptor && stream->remaining == 0) {
+			fw_log(logger, OSGI_FRAMEWORK_LOG_ERROR, "DEPLOYMENT_ADMIN: Zip entry %s is truncated", stream->name);
+			status = CELIX_ILLEGAL_STATE;
+		}
+	}
+
+	return status;
+}
+
+static celix_status_t zipStream_endEntry(zip_stream_pt stream) {
+	celix_status_t status = CELIX_SUCCESS;
+	bool isFile = stream->file != NULL;
+
+	if (isFile && fclose(stream->file) != 0) {
+		status = CELIX_FILE_IO_EXCEPTION;
+	}
+	stream->file = NULL;
+
+	if (status == CELIX_SUCCESS && (stream->actualCrc != stream->crc || stream->written != stream->uncompressedSize)) {
+		fw_log(logger, OSGI_FRAMEWORK_LOG_ERROR, "DEPLOYMENT_ADMIN: Checksum or size of zip entry %s does not match", stream->name);
+		status = CELIX_ILLEGAL_STATE;
+	}
+
+	if (status == CELIX_SUCCESS && isFile && stream->entryExtracted != NULL) {
+		status = stream->entryExtracted(stream->handle, stream->name, stream->path);
+	}
+
+	zipStream_closeEntry(stream);
+	stream->buffered = 0;
+	stream->state = ZIP_STREAM_SIGNATURE;
+
+	return status;
+}
+
+static void zipStream_closeEntry(zip_stream_pt stream) {
+	if (stream->inflating) {
+		inflateEnd(&stream->inflater);
+		stream->inflating = false;
+	}
+	if (stream->file != NULL) {
+		fclose(stream->file);
+		stream->file = NULL;
+	}
+	free(stream->name);
+	stream->name = NULL;
+	free(stream->path);
+	stream->path = NULL;
+}
+
+/*
+ * Creates the parent directories of path, and path itself if it ends with a '/'.
+ */
+static celix_status_t zipStream_makeDirectories(char *path) {
+	celix_status_t status = CELIX_SUCCESS;
+	char *separator = strchr(path + 1, '/');
+
+	while (status == CELIX_SUCCESS && separator != NULL) {
+		*separator = '\0';
+		if (mkdir(path, S_IRWXU) != 0 && errno != EEXIST) {
+			fw_log(logger, OSGI_FRAMEWORK_LOG_ERROR, "DEPLOYMENT_ADMIN: Cannot create directory %s: %s", path, strerror(errno));
+			status = CELIX_FILE_IO_EXCEPTION;
+		}
+		*separator = '/';
+		separator = strchr(separator + 1, '/');
+	}
+
+	return status;
+}
+
+static bool zipStream_isSafeName(const char *name) {
+	bool safe = name[0] != '\0' && name[0] != '/';
+	const char *part = name;
+
+	while (safe && part != NULL) {
+		if (strncmp(part, "..", 2) == 0 && (part[2] == '/' || part[2] == '\0')) {
+			safe = false;
+		} else {
+			part = strchr(part, '/');
+			if (part != NULL) {
+				part++;
+			}
+		}
+	}
+
+	return safe;
+}
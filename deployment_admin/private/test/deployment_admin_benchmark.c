@@ -0,0 +1,527 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+/*
+ * deployment_admin_benchmark.c
+ *
+ * Deployment admin benchmark. Serves deployment packages from a local HTTP stand-in of the deployment server and lets
+ * the deployment admin install them:
+ *  1.0.0 installs NR_OF_BUNDLES bundles,
+ *  2.0.0 updates all bundles but contains a corrupt bundle, it has to be rolled back to 1.0.0,
+ *  3.0.0 updates all bundles, drops the first bundle and installs a new one.
+ * The package is sent in chunks with a pause in between, to simulate a network which is slower than the disk.
+ *
+ *  \author    	<a href="mailto:dev@celix.apache.org">Apache Celix Project Team</a>
+ *  \copyright	Apache License, Version 2.0
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include <zlib.h>
+
+#include "celix_launcher.h"
+#include "framework.h"
+#include "constants.h"
+#include "bundle.h"
+#include "bundle_archive.h"
+#include "module.h"
+#include "celix_threads.h"
+#include "deployment_admin.h"
+
+#define NR_OF_BUNDLES 50
+#define PAYLOAD_SIZE (256 * 1024)
+#define CHUNK_SIZE (64 * 1024)
+#define CHUNK_DELAY_US 2000
+#define BENCHMARK_TIMEOUT_S 30
+
+struct zip_buffer {
+	unsigned char *data;
+	size_t size;
+	size_t capacity;
+	unsigned char *central;
+	size_t centralSize;
+	size_t centralCapacity;
+	int entries;
+};
+
+struct http_server {
+	int socket;
+	int port;
+	bool running;
+	celix_thread_t thread;
+	celix_thread_mutex_t lock;
+	char versions[64];
+	struct zip_buffer packages[3];
+};
+
+static void zipBuffer_append(unsigned char **data, size_t *size, size_t *capacity, const void *bytes, size_t length) {
+	if (*size + length > *capacity) {
+		*capacity = (*size + length) * 2;
+		*data = realloc(*data, *capacity);
+	}
+	memcpy(*data + *size, bytes, length);
+	*size += length;
+}
+
+static void zipBuffer_appendShort(unsigned char **data, size_t *size, size_t *capacity, unsigned int value) {
+	unsigned char bytes[2] = { value & 0xff, (value >> 8) & 0xff };
+	zipBuffer_append(data, size, capacity, bytes, sizeof(bytes));
+}
+
+static void zipBuffer_appendInt(unsigned char **data, size_t *size, size_t *capacity, unsigned long value) {
+	unsigned char bytes[4] = { value & 0xff, (value >> 8) & 0xff, (value >> 16) & 0xff, (value >> 24) & 0xff };
+	zipBuffer_append(data, size, capacity, bytes, sizeof(bytes));
+}
+
+/*
+ * Adds an entry, deflated entries are written with a data descriptor the way the jar tool does.
+ */
+static void zipBuffer_add(struct zip_buffer *zip, const char *name, const void *content, size_t length, bool deflated) {
+	unsigned char *compressed = (unsigned char *) content;
+	unsigned long compressedSize = length;
+	unsigned long crc = crc32(0L, content, length);
+	unsigned long offset = zip->size;
+	unsigned int flags = deflated ? 0x0008 : 0;
+
+	if (deflated) {
+		z_stream deflater;
+		memset(&deflater, 0, sizeof(deflater));
+		deflateInit2(&deflater, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+		compressed = malloc(deflateBound(&deflater, length));
+		deflater.next_in = (Bytef *) content;
+		deflater.avail_in = length;
+		deflater.next_out = compressed;
+		deflater.avail_out = deflateBound(&deflater, length);
+		deflate(&deflater, Z_FINISH);
+		compressedSize = deflater.total_out;
+		deflateEnd(&deflater);
+	}
+
+	zipBuffer_appendInt(&zip->data, &zip->size, &zip->capacity, 0x04034b50);
+	zipBuffer_appendShort(&zip->data, &zip->size, &zip->capacity, 20);
+	zipBuffer_appendShort(&zip->data, &zip->size, &zip->capacity, flags);
+	zipBuffer_appendShort(&zip->data, &zip->size, &zip->capacity, deflated ? 8 : 0);
+	zipBuffer_appendShort(&zip->data, &zip->size, &zip->capacity, 0);
+	zipBuffer_appendShort(&zip->data, &zip->size, &zip->capacity, 0x21);
+	zipBuffer_appendInt(&zip->data, &zip->size, &zip->capacity, deflated ? 0 : crc);
+	zipBuffer_appendInt(&zip->data, &zip->size, &zip->capacity, deflated ? 0 : compressedSize);
+	zipBuffer_appendInt(&zip->data, &zip->size, &zip->capacity, deflated ? 0 : length);
+	zipBuffer_appendShort(&zip->data, &zip->size, &zip->capacity, strlen(name));
+	zipBuffer_appendShort(&zip->data, &zip->size, &zip->capacity, 0);
+	zipBuffer_append(&zip->data, &zip->size, &zip->capacity, name, strlen(name));
+	zipBuffer_append(&zip->data, &zip->size, &zip->capacity, compressed, compressedSize);
+	if (deflated) {
+		zipBuffer_appendInt(&zip->data, &zip->size, &zip->capacity, 0x08074b50);
+		zipBuffer_appendInt(&zip->data, &zip->size, &zip->capacity, crc);
+		zipBuffer_appendInt(&zip->data, &zip->size, &zip->capacity, compressedSize);
+		zipBuffer_appendInt(&zip->data, &zip->size, &zip->capacity, length);
+		free(compressed);
+	}
+
+	zipBuffer_appendInt(&zip->central, &zip->centralSize, &zip->centralCapacity, 0x02014b50);
+	zipBuffer_appendShort(&zip->central, &zip->centralSize, &zip->centralCapacity, 20);
+	zipBuffer_appendShort(&zip->central, &zip->centralSize, &zip->centralCapacity, 20);
+	zipBuffer_appendShort(&zip->central, &zip->centralSize, &zip->centralCapacity, flags);
+	zipBuffer_appendShort(&zip->central, &zip->centralSize, &zip->centralCapacity, deflated ? 8 : 0);
+	zipBuffer_appendShort(&zip->central, &zip->centralSize, &zip->centralCapacity, 0);
+	zipBuffer_appendShort(&zip->central, &zip->centralSize, &zip->centralCapacity, 0x21);
+	zipBuffer_appendInt(&zip->central, &zip->centralSize, &zip->centralCapacity, crc);
+	zipBuffer_appendInt(&zip->central, &zip->centralSize, &zip->centralCapacity, compressedSize);
+	zipBuffer_appendInt(&zip->central, &zip->centralSize, &zip->centralCapacity, length);
+	zipBuffer_appendShort(&zip->central, &zip->centralSize, &zip->centralCapacity, strlen(name));
+	zipBuffer_appendShort(&zip->central, &zip->centralSize, &zip->centralCapacity, 0);
+	zipBuffer_appendShort(&zip->central, &zip->centralSize, &zip->centralCapacity, 0);
+	zipBuffer_appendShort(&zip->central, &zip->centralSize, &zip->centralCapacity, 0);
+	zipBuffer_appendShort(&zip->central, &zip->centralSize, &zip->centralCapacity, 0);
+	zipBuffer_appendInt(&zip->central, &zip->centralSize, &zip->centralCapacity, 0);
+	zipBuffer_appendInt(&zip->central, &zip->centralSize, &zip->centralCapacity, offset);
+	zipBuffer_append(&zip->central, &zip->centralSize, &zip->centralCapacity, name, strlen(name));
+
+	zip->entries++;
+}
+
+static void zipBuffer_finish(struct zip_buffer *zip) {
+	unsigned long centralOffset = zip->size;
+
+	zipBuffer_append(&zip->data, &zip->size, &zip->capacity, zip->central, zip->centralSize);
+	zipBuffer_appendInt(&zip->data, &zip->size, &zip->capacity, 0x06054b50);
+	zipBuffer_appendShort(&zip->data, &zip->size, &zip->capacity, 0);
+	zipBuffer_appendShort(&zip->data, &zip->size, &zip->capacity, 0);
+	zipBuffer_appendShort(&zip->data, &zip->size, &zip->capacity, zip->entries);
+	zipBuffer_appendShort(&zip->data, &zip->size, &zip->capacity, zip->entries);
+	zipBuffer_appendInt(&zip->data, &zip->size, &zip->capacity, zip->centralSize);
+	zipBuffer_appendInt(&zip->data, &zip->size, &zip->capacity, centralOffset);
+	zipBuffer_appendShort(&zip->data, &zip->size, &zip->capacity, 0);
+
+	free(zip->central);
+	zip->central = NULL;
+}
+
+static void benchmark_createBundle(struct zip_buffer *bundle, const char *symbolicName, const char *version) {
+	char manifest[256];
+	unsigned char *payload = malloc(PAYLOAD_SIZE);
+	unsigned int seed = 42;
+	int i;
+
+	for (i = 0; i < PAYLOAD_SIZE; i++) {
+		payload[i] = 'a' + (rand_r(&seed) & 0x0f);
+	}
+	snprintf(manifest, sizeof(manifest), "Manifest-Version: 1.0\nBundle-SymbolicName: %s\nBundle-Version: %s\nBundle-Name: %s\n\n", symbolicName, version, symbolicName);
+
+	memset(bundle, 0, sizeof(*bundle));
+	zipBuffer_add(bundle, "META-INF/MANIFEST.MF", manifest, strlen(manifest), true);
+	zipBuffer_add(bundle, "payload.bin", payload, PAYLOAD_SIZE, true);
+	zipBuffer_finish(bundle);
+
+	free(payload);
+}
+
+/*
+ * Creates a deployment package with the bundles first to last, a corrupt bundle and/or a new bundle.
+ */
+static void benchmark_createPackage(struct zip_buffer *package, const char *version, int first, bool corrupt, bool extra) {
+	size_t manifestCapacity = 256 * (NR_OF_BUNDLES + 4);
+	char *manifest = calloc(1, manifestCapacity);
+	struct zip_buffer bundles[NR_OF_BUNDLES + 1];
+	char names[NR_OF_BUNDLES + 1][32];
+	int nrOfBundles = 0;
+	int i;
+
+	snprintf(manifest, manifestCapacity, "Manifest-Version: 1.0\nDeploymentPackage-SymbolicName: bench.package\nDeploymentPackage-Version: %s\n\n", version);
+	for (i = first; i <= NR_OF_BUNDLES; i++) {
+		char symbolicName[32];
+		size_t length = strlen(manifest);
+
+		if (i == NR_OF_BUNDLES && !corrupt && !extra) {
+			break;
+		}
+		snprintf(names[nrOfBundles], sizeof(names[nrOfBundles]), "bundle%i.zip", i);
+		snprintf(symbolicName, sizeof(symbolicName), i < NR_OF_BUNDLES ? "bench.bundle.%i" : "bench.bundle.new", i);
+		snprintf(manifest + length, manifestCapacity - length, "Name: %s\nBundle-SymbolicName: %s\nBundle-Version: %s\n\n", names[nrOfBundles], symbolicName, version);
+
+		if (i == NR_OF_BUNDLES && corrupt) {
+			// not a zip file, the bundle cannot be installed
+			memset(&bundles[nrOfBundles], 0, sizeof(bundles[nrOfBundles]));
+			bundles[nrOfBundles].data = calloc(1, 1024);
+			bundles[nrOfBundles].size = 1024;
+		} else {
+			benchmark_createBundle(&bundles[nrOfBundles], symbolicName, version);
+		}
+		nrOfBundles++;
+	}
+
+	memset(package, 0, sizeof(*package));
+	zipBuffer_add(package, "META-INF/MANIFEST.MF", manifest, strlen(manifest), true);
+	for (i = 0; i < nrOfBundles; i++) {
+		// the corrupt bundle is in the middle, so part of the bundles is already updated when it fails
+		int index = corrupt ? (i + nrOfBundles / 2) % nrOfBundles : i;
+		zipBuffer_add(package, names[index], bundles[index].data, bundles[index].size, index % 2 == 0);
+	}
+	zipBuffer_finish(package);
+
+	for (i = 0; i < nrOfBundles; i++) {
+		free(bundles[i].data);
+	}
+	free(manifest);
+}
+
+static void benchmark_send(int connection, const void *data, size_t size, bool throttle) {
+	const char *bytes = data;
+
+	while (size > 0) {
+		size_t chunk = size < CHUNK_SIZE ? size : CHUNK_SIZE;
+		ssize_t written = send(connection, bytes, chunk, MSG_NOSIGNAL);
+		if (written <= 0) {
+			break;
+		}
+		bytes += written;
+		size -= written;
+		if (throttle && size > 0) {
+			usleep(CHUNK_DELAY_US);
+		}
+	}
+}
+
+static void *benchmark_serve(void *data) {
+	struct http_server *server = data;
+
+	while (server->running) {
+		char request[4096];
+		size_t received = 0;
+		char *headerEnd = NULL;
+		int connection = accept(server->socket, NULL, NULL);
+
+		if (connection < 0) {
+			continue;
+		}
+
+		while (headerEnd == NULL && received < sizeof(request) - 1) {
+			ssize_t bytes = recv(connection, request + received, sizeof(request) - 1 - received, 0);
+			if (bytes <= 0) {
+				break;
+			}
+			received += bytes;
+			request[received] = '\0';
+			headerEnd = strstr(request, "\r\n\r\n");
+		}
+
+		if (headerEnd != NULL) {
+			char method[8];
+			char path[256];
+			char header[128];
+			const void *body = "";
+			size_t bodySize = 0;
+			bool throttle = false;
+			int code = 200;
+
+			sscanf(request, "%7s %255s", method, path);
+			celixThreadMutex_lock(&server->lock);
+			if (strcmp(path, "/deployment/celix/versions") == 0) {
+				body = server->versions;
+				bodySize = strlen(server->versions);
+			} else if (strncmp(path, "/deployment/celix/versions/", 27) == 0) {
+				int major = atoi(path + 27);
+				if (major >= 1 && major <= 3) {
+					body = server->packages[major - 1].data;
+					bodySize = server->packages[major - 1].size;
+					throttle = true;
+				} else {
+					code = 404;
+				}
+			} else if (strcmp(path, "/auditlog/send") != 0) {
+				code = 404;
+			}
+			celixThreadMutex_unlock(&server->lock);
+
+			snprintf(header, sizeof(header), "HTTP/1.1 %i %s\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n", code, code == 200 ? "OK" : "Not Found", code == 200 ? bodySize : 0);
+			benchmark_send(connection, header, strlen(header), false);
+			if (code == 200) {
+				benchmark_send(connection, body, bodySize, throttle);
+			}
+		}
+
+		close(connection);
+	}
+
+	return NULL;
+}
+
+static bool benchmark_waitFor(deployment_admin_pt admin, unsigned int deployments, unsigned int rollbacks, struct deployment_admin_statistics *statistics) {
+	int waited = 0;
+
+	deploymentAdmin_getStatistics(admin, statistics);
+	while ((statistics->deployments < deployments || statistics->rollbacks < rollbacks) && waited < BENCHMARK_TIMEOUT_S * 10) {
+		usleep(100000);
+		waited++;
+		deploymentAdmin_getStatistics(admin, statistics);
+	}
+
+	printf("  manifest after %.3f ms, downloaded after %.3f ms, %u bundles installed after %.3f ms, resources after %.3f ms, total %.3f ms\n",
+			statistics->manifestMs, statistics->downloadMs, statistics->bundles, statistics->bundlesMs, statistics->resourcesMs, statistics->totalMs);
+
+	return statistics->deployments == deployments && statistics->rollbacks == rollbacks;
+}
+
+/*
+ * Counts the active bundles installed by the deployment admin with the given version.
+ */
+static int benchmark_countBundles(bundle_context_pt context, const char *expectedVersion, bool *hasNewBundle) {
+	array_list_pt bundles = NULL;
+	version_pt expected = NULL;
+	int count = 0;
+	int i;
+
+	*hasNewBundle = false;
+	version_createVersionFromString((char *) expectedVersion, &expected);
+	bundleContext_getBundles(context, &bundles);
+	for (i = 0; i < arrayList_size(bundles); i++) {
+		bundle_pt bundle = arrayList_get(bundles, i);
+		bundle_archive_pt archive = NULL;
+		const char *location = NULL;
+		module_pt module = NULL;
+		version_pt version = NULL;
+		bundle_state_e state = OSGI_FRAMEWORK_BUNDLE_UNKNOWN;
+		int cmp = -1;
+
+		bundle_getArchive(bundle, &archive);
+		bundleArchive_getLocation(archive, &location);
+		bundle_getState(bundle, &state);
+		if (location == NULL || strncmp(location, "osgi-dp:", 8) != 0 || state == OSGI_FRAMEWORK_BUNDLE_UNINSTALLED) {
+			continue;
+		}
+		if (strcmp(location, "osgi-dp:bench.bundle.new") == 0) {
+			*hasNewBundle = true;
+		}
+		bundle_getCurrentModule(bundle, &module);
+		version = module_getVersion(module);
+		version_compareTo(version, expected, &cmp);
+		if (cmp == 0 && state == OSGI_FRAMEWORK_BUNDLE_ACTIVE) {
+			count++;
+		}
+	}
+	arrayList_destroy(bundles);
+	version_destroy(expected);
+
+	return count;
+}
+
+static int benchmark_countRepositoryEntries(bundle_pt bundle) {
+	char *entry = NULL;
+	int count = 0;
+
+	bundle_getEntry(bundle, "repo", &entry);
+	DIR *dir = opendir(entry);
+	if (dir != NULL) {
+		struct dirent *dent = NULL;
+		while ((dent = readdir(dir)) != NULL) {
+			if (strcmp(dent->d_name, ".") != 0 && strcmp(dent->d_name, "..") != 0) {
+				count++;
+			}
+		}
+		closedir(dir);
+	}
+	free(entry);
+
+	return count;
+}
+
+int main(int argc, char **argv) {
+	framework_pt framework = NULL;
+	bundle_pt frameworkBundle = NULL;
+	bundle_context_pt frameworkContext = NULL;
+	bundle_pt hostBundle = NULL;
+	bundle_context_pt context = NULL;
+	deployment_admin_pt admin = NULL;
+	struct http_server server;
+	struct deployment_admin_statistics statistics;
+	struct zip_buffer host;
+	struct sockaddr_in address;
+	socklen_t addressLength = sizeof(address);
+	char hostFile[] = "/tmp/deployment_admin_benchmark_XXXXXX";
+	char url[64];
+	bool hasNewBundle = false;
+	int failures = 0;
+	int count;
+	int fd;
+
+	memset(&server, 0, sizeof(server));
+	celixThreadMutex_create(&server.lock, NULL);
+	snprintf(server.versions, sizeof(server.versions), "1.0.0\n");
+	benchmark_createPackage(&server.packages[0], "1.0.0", 0, false, false);
+	benchmark_createPackage(&server.packages[1], "2.0.0", 0, true, false);
+	benchmark_createPackage(&server.packages[2], "3.0.0", 1, false, true);
+
+	server.socket = socket(AF_INET, SOCK_STREAM, 0);
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (bind(server.socket, (struct sockaddr *) &address, sizeof(address)) != 0 || listen(server.socket, 16) != 0
+			|| getsockname(server.socket, (struct sockaddr *) &address, &addressLength) != 0) {
+		return EXIT_FAILURE;
+	}
+	server.port = ntohs(address.sin_port);
+	server.running = true;
+	celixThread_create(&server.thread, NULL, benchmark_serve, &server);
+
+	properties_pt config = properties_create();
+	snprintf(url, sizeof(url), "http://127.0.0.1:%i", server.port);
+	properties_set(config, "deployment_admin_url", url);
+	properties_set(config, "deployment_admin_identification", "celix");
+	properties_set(config, OSGI_FRAMEWORK_FRAMEWORK_STORAGE_CLEAN, OSGI_FRAMEWORK_FRAMEWORK_STORAGE_CLEAN_ONFIRSTINIT);
+	if (celixLauncher_launchWithProperties(config, &framework) != CELIX_SUCCESS) {
+		return EXIT_FAILURE;
+	}
+	framework_getFrameworkBundle(framework, &frameworkBundle);
+	bundle_getContext(frameworkBundle, &frameworkContext);
+
+	// the deployment admin keeps its repository in the cache entry of its bundle, host it in an empty bundle
+	benchmark_createBundle(&host, "bench.deployment.admin", "1.0.0");
+	fd = mkstemp(hostFile);
+	if (fd < 0 || write(fd, host.data, host.size) != (ssize_t) host.size) {
+		return EXIT_FAILURE;
+	}
+	close(fd);
+	bundleContext_installBundle(frameworkContext, hostFile, &hostBundle);
+	bundle_start(hostBundle);
+	bundle_getContext(hostBundle, &context);
+	unlink(hostFile);
+	free(host.data);
+
+	printf("Serving packages of %zu, %zu and %zu bytes\n", server.packages[0].size, server.packages[1].size, server.packages[2].size);
+	deploymentAdmin_create(context, &admin);
+
+	printf("Installing 1.0.0 with %i bundles\n", NR_OF_BUNDLES);
+	if (!benchmark_waitFor(admin, 1, 0, &statistics)) {
+		failures++;
+	}
+	count = benchmark_countBundles(context, "1.0.0", &hasNewBundle);
+	if (count != NR_OF_BUNDLES || hasNewBundle || benchmark_countRepositoryEntries(hostBundle) != 1) {
+		printf("  %i bundles active, expected %i\n", count, NR_OF_BUNDLES);
+		failures++;
+	}
+
+	celixThreadMutex_lock(&server.lock);
+	snprintf(server.versions, sizeof(server.versions), "1.0.0\n2.0.0\n");
+	celixThreadMutex_unlock(&server.lock);
+	printf("Installing 2.0.0 with a corrupt bundle\n");
+	if (!benchmark_waitFor(admin, 1, 1, &statistics)) {
+		failures++;
+	}
+	count = benchmark_countBundles(context, "1.0.0", &hasNewBundle);
+	if (count != NR_OF_BUNDLES || hasNewBundle || benchmark_countRepositoryEntries(hostBundle) != 1) {
+		printf("  %i bundles rolled back, expected %i\n", count, NR_OF_BUNDLES);
+		failures++;
+	}
+
+	celixThreadMutex_lock(&server.lock);
+	snprintf(server.versions, sizeof(server.versions), "1.0.0\n2.0.0\n3.0.0\n");
+	celixThreadMutex_unlock(&server.lock);
+	printf("Installing 3.0.0\n");
+	if (!benchmark_waitFor(admin, 2, 1, &statistics)) {
+		failures++;
+	}
+	count = benchmark_countBundles(context, "3.0.0", &hasNewBundle);
+	if (count != NR_OF_BUNDLES || !hasNewBundle || benchmark_countRepositoryEntries(hostBundle) != 1) {
+		printf("  %i bundles active, expected %i\n", count, NR_OF_BUNDLES);
+		failures++;
+	}
+
+	deploymentAdmin_destroy(admin);
+
+	server.running = false;
+	shutdown(server.socket, SHUT_RDWR);
+	close(server.socket);
+	celixThread_join(server.thread, NULL);
+	free(server.packages[0].data);
+	free(server.packages[1].data);
+	free(server.packages[2].data);
+	celixThreadMutex_destroy(&server.lock);
+
+	celixLauncher_stop(framework);
+	celixLauncher_waitForShutdown(framework);
+	celixLauncher_destroy(framework);
+
+	printf("%i failures\n", failures);
+	return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
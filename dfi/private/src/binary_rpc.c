@@ -0,0 +1,357 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+#include "binary_rpc.h"
+#include "binary_serializer.h"
+#include "dyn_type.h"
+#include "dyn_interface.h"
+#include "celix_trace.h"
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ffi.h>
+
+#define REPLY_RESULT 0
+#define REPLY_ERROR 1
+
+#define TRACE_FLAG 0x8000
+#define MAX_ID_LENGTH 0x7fff
+#define TRACE_CONTEXT_SIZE 16
+
+static int OK = 0;
+static int ERROR = 1;
+
+DFI_SETUP_LOG(binaryRpc);
+
+typedef void (*gen_func_type)(void);
+
+struct generic_service_layout {
+	void *handle;
+	gen_func_type methods[];
+};
+
+static int binaryRpc_writeOutput(dyn_type *argType, enum dyn_function_argument_meta meta, void *arg, FILE *stream);
+static int binaryRpc_readOutput(dyn_type *argType, enum dyn_function_argument_meta meta, const void *reply, size_t replySize, size_t *offset, void *arg);
+static void binaryRpc_writeUint64(uint64_t value, FILE *stream);
+static uint64_t binaryRpc_readUint64(const uint8_t *data);
+
+int binaryRpc_call(dyn_interface_type *intf, void *service, const void *request, size_t requestSize, void **out, size_t *outSize) {
+	int status = OK;
+	const uint8_t *data = request;
+	size_t offset = 2;
+	size_t idLength = 0;
+	bool traced = false;
+	celix_trace_context_t remote = { 0, 0 };
+
+	if (requestSize < 2) {
+		status = ERROR;
+		LOG_ERROR("Request of %zu bytes is too short", requestSize);
+	} else {
+		idLength = data[0] | (data[1] << 8);
+		traced = (idLength & TRACE_FLAG) != 0;
+		idLength &= MAX_ID_LENGTH;
+		if (idLength + (traced ? TRACE_CONTEXT_SIZE : 0) > requestSize - offset) {
+			status = ERROR;
+			LOG_ERROR("Method id of %zu bytes does not fit in the request", idLength);
+		}
+	}
+
+	struct methods_head *methods = NULL;
+	struct method_entry *entry = NULL;
+	struct method_entry *method = NULL;
+	if (status == OK) {
+		dynInterface_methods(intf, &methods);
+		TAILQ_FOREACH(entry, methods, entries) {
+			if (strlen(entry->id) == idLength && strncmp(entry->id, (const char *) data + offset, idLength) == 0) {
+				method = entry;
+				break;
+			}
+		}
+		offset += idLength;
+		if (traced) {
+			remote.traceId = binaryRpc_readUint64(data + offset);
+			remote.spanId = binaryRpc_readUint64(data + offset + 8);
+			offset += TRACE_CONTEXT_SIZE;
+		}
+
+		if (method == NULL) {
+			status = ERROR;
+			LOG_ERROR("Cannot find method with sig '%.*s'", (int) idLength, (const char *) data + 2);
+		} else if (dynType_descriptorType(dynFunction_returnType(method->dynFunc)) != 'N') {
+			//NOTE To be able to handle exception only N as returnType is supported
+			status = ERROR;
+			LOG_ERROR("Only interface methods with a native int are supported. Found type '%c'", (char) dynType_descriptorType(dynFunction_returnType(method->dynFunc)));
+		}
+	}
+
+	void (*fp)(void) = NULL;
+	void *handle = NULL;
+	dyn_function_type *func = NULL;
+	int nrOfArgs = 0;
+	if (status == OK) {
+		struct generic_service_layout *serv = service;
+		handle = serv->handle;
+		fp = serv->methods[method->index];
+		func = method->dynFunc;
+		nrOfArgs = dynFunction_nrOfArguments(func);
+	}
+
+	void *args[nrOfArgs > 0 ? nrOfArgs : 1];
+	void *ptr = NULL;
+	void *ptrToPtr = &ptr;
+	int i;
+
+	memset(args, 0, sizeof(args));
+	for (i = 0; status == OK && i < nrOfArgs; i += 1) {
+		dyn_type *argType = dynFunction_argumentTypeForIndex(func, i);
+		enum dyn_function_argument_meta meta = dynFunction_argumentMetaForIndex(func, i);
+		if (meta == DYN_FUNCTION_ARGUMENT_META__STD) {
+			status = binarySerializer_read(argType, request, requestSize, &offset, &args[i]);
+		} else if (meta == DYN_FUNCTION_ARGUMENT_META__PRE_ALLOCATED_OUTPUT) {
+			status = dynType_alloc(argType, &args[i]);
+		} else if (meta == DYN_FUNCTION_ARGUMENT_META__OUTPUT) {
+			args[i] = &ptrToPtr;
+		} else if (meta == DYN_FUNCTION_ARGUMENT_META__HANDLE) {
+			args[i] = &handle;
+		}
+	}
+
+	ffi_sarg returnVal = 1;
+	if (status == OK) {
+		celix_trace_span_t span;
+		celixTrace_beginRemoteSpan("rsa.invoke", method->id, &remote, &span);
+		status = dynFunction_call(func, fp, (void *) &returnVal, args);
+		celixTrace_endSpan(&span);
+	}
+
+	int funcCallStatus = (int) returnVal;
+	if (status == OK && funcCallStatus != 0) {
+		LOG_WARNING("Error calling remote endpoint function, got error code %i", funcCallStatus);
+	}
+
+	char *response = NULL;
+	size_t responseSize = 0;
+	FILE *stream = NULL;
+	if (status == OK) {
+		stream = open_memstream(&response, &responseSize);
+		if (stream == NULL) {
+			status = ERROR;
+		}
+	}
+	if (status == OK) {
+		if (funcCallStatus == 0) {
+			fputc(REPLY_RESULT, stream);
+			for (i = 0; status == OK && i < nrOfArgs; i += 1) {
+				status = binaryRpc_writeOutput(dynFunction_argumentTypeForIndex(func, i), dynFunction_argumentMetaForIndex(func, i), args[i], stream);
+			}
+		} else {
+			uint32_t code = (uint32_t) funcCallStatus;
+			uint8_t bytes[4] = {code & 0xff, (code >> 8) & 0xff, (code >> 16) & 0xff, code >> 24};
+			fputc(REPLY_ERROR, stream);
+			fwrite(bytes, 1, sizeof(bytes), stream);
+		}
+		fclose(stream);
+	}
+
+	for (i = 0; i < nrOfArgs; i += 1) {
+		dyn_type *argType = dynFunction_argumentTypeForIndex(func, i);
+		enum dyn_function_argument_meta meta = dynFunction_argumentMetaForIndex(func, i);
+		if (meta == DYN_FUNCTION_ARGUMENT_META__STD || meta == DYN_FUNCTION_ARGUMENT_META__PRE_ALLOCATED_OUTPUT) {
+			dynType_free(argType, args[i]);
+		} else if (meta == DYN_FUNCTION_ARGUMENT_META__OUTPUT && ptr != NULL) {
+			dyn_type *typedType = NULL;
+			dynType_typedPointer_getTypedType(argType, &typedType);
+			if (dynType_descriptorType(typedType) == 't') {
+				free(ptr);
+			} else {
+				dyn_type *typedTypedType = NULL;
+				dynType_typedPointer_getTypedType(typedType, &typedTypedType);
+				dynType_free(typedTypedType, ptr);
+			}
+			ptr = NULL;
+		}
+	}
+
+	if (status == OK) {
+		*out = response;
+		*outSize = responseSize;
+	} else {
+		free(response);
+	}
+
+	return status;
+}
+
+static int binaryRpc_writeOutput(dyn_type *argType, enum dyn_function_argument_meta meta, void *arg, FILE *stream) {
+	int status = OK;
+	dyn_type *typedType = NULL;
+
+	if (meta == DYN_FUNCTION_ARGUMENT_META__PRE_ALLOCATED_OUTPUT && dynType_type(argType) != DYN_TYPE_TYPED_POINTER) {
+		status = ERROR;
+		LOG_ERROR("Pre allocated output argument should be a typed pointer, found '%c'", dynType_descriptorType(argType));
+	} else if (meta == DYN_FUNCTION_ARGUMENT_META__PRE_ALLOCATED_OUTPUT) {
+		// written as a typed pointer, which adds the present byte
+		status = binarySerializer_write(argType, arg, stream);
+	} else if (meta == DYN_FUNCTION_ARGUMENT_META__OUTPUT) {
+		void *ptr = **(void ***) arg;
+		status = dynType_typedPointer_getTypedType(argType, &typedType);
+		if (status == OK) {
+			// a char ** output is written as text and a type ** output as the typed pointer *type
+			status = binarySerializer_write(typedType, &ptr, stream);
+		}
+	}
+
+	return status;
+}
+
+int binaryRpc_prepareInvokeRequest(dyn_function_type *func, const char *id, void *args[], void **out, size_t *outSize) {
+	int status = OK;
+	char *request = NULL;
+	size_t requestSize = 0;
+	size_t idLength = strlen(id);
+	FILE *stream = NULL;
+	celix_trace_context_t trace;
+
+	LOG_DEBUG("Calling remote function '%s'\n", id);
+	celixTrace_currentContext(&trace);
+	if (idLength > MAX_ID_LENGTH) {
+		status = ERROR;
+		LOG_ERROR("Method id '%s' is too long", id);
+	} else {
+		stream = open_memstream(&request, &requestSize);
+		if (stream == NULL) {
+			status = ERROR;
+		}
+	}
+
+	if (status == OK) {
+		int i;
+		int nrOfArgs = dynFunction_nrOfArguments(func);
+
+		size_t length = idLength | (trace.traceId != 0 ? TRACE_FLAG : 0);
+
+		fputc(length & 0xff, stream);
+		fputc(length >> 8, stream);
+		fwrite(id, 1, idLength, stream);
+		if (trace.traceId != 0) {
+			binaryRpc_writeUint64(trace.traceId, stream);
+			binaryRpc_writeUint64(trace.spanId, stream);
+		}
+		for (i = 0; status == OK && i < nrOfArgs; i += 1) {
+			if (dynFunction_argumentMetaForIndex(func, i) == DYN_FUNCTION_ARGUMENT_META__STD) {
+				status = binarySerializer_write(dynFunction_argumentTypeForIndex(func, i), args[i], stream);
+			} else {
+				//skip handle / output types
+			}
+		}
+		fclose(stream);
+	}
+
+	if (status == OK) {
+		*out = request;
+		*outSize = requestSize;
+	} else {
+		free(request);
+	}
+
+	return status;
+}
+
+int binaryRpc_handleReply(dyn_function_type *func, const void *reply, size_t replySize, void *args[], int *callStatus) {
+	int status = OK;
+	const uint8_t *data = reply;
+	size_t offset = 1;
+
+	if (replySize < 1) {
+		status = ERROR;
+		LOG_ERROR("Got an empty reply");
+	} else if (data[0] == REPLY_ERROR) {
+		if (replySize < 5) {
+			status = ERROR;
+			LOG_ERROR("Got an incomplete error reply");
+		} else {
+			*callStatus = (int) (uint32_t) (data[1] | (data[2] << 8) | (data[3] << 16) | ((uint32_t) data[4] << 24));
+		}
+	} else if (data[0] == REPLY_RESULT) {
+		int nrOfArgs = dynFunction_nrOfArguments(func);
+		int i;
+
+		*callStatus = 0;
+		for (i = 0; status == OK && i < nrOfArgs; i += 1) {
+			status = binaryRpc_readOutput(dynFunction_argumentTypeForIndex(func, i), dynFunction_argumentMetaForIndex(func, i), reply, replySize, &offset, args[i]);
+		}
+	} else {
+		status = ERROR;
+		LOG_ERROR("Got a reply with unknown status %u", data[0]);
+	}
+
+	return status;
+}
+
+static int binaryRpc_readOutput(dyn_type *argType, enum dyn_function_argument_meta meta, const void *reply, size_t replySize, size_t *offset, void *arg) {
+	int status = OK;
+	dyn_type *typedType = NULL;
+	void *tmp = NULL;
+
+	if (meta == DYN_FUNCTION_ARGUMENT_META__PRE_ALLOCATED_OUTPUT && dynType_type(argType) != DYN_TYPE_TYPED_POINTER) {
+		status = ERROR;
+		LOG_ERROR("Pre allocated output argument should be a typed pointer, found '%c'", dynType_descriptorType(argType));
+	} else if (meta == DYN_FUNCTION_ARGUMENT_META__PRE_ALLOCATED_OUTPUT) {
+		// copied into the memory provided by the caller
+		void **out = (void **) arg;
+		status = binarySerializer_read(argType, reply, replySize, offset, &tmp);
+		if (status == OK && *(void **) tmp != NULL) {
+			dynType_typedPointer_getTypedType(argType, &typedType);
+			memcpy(*out, *(void **) tmp, dynType_size(typedType));
+			// nested pointers are now owned by the caller
+			free(*(void **) tmp);
+			*(void **) tmp = NULL;
+		}
+		dynType_free(argType, tmp);
+	} else if (meta == DYN_FUNCTION_ARGUMENT_META__OUTPUT) {
+		void ***out = (void ***) arg;
+		status = dynType_typedPointer_getTypedType(argType, &typedType);
+		if (status == OK) {
+			status = binarySerializer_read(typedType, reply, replySize, offset, &tmp);
+		}
+		if (status == OK) {
+			// the text or the value pointed to is now owned by the caller
+			**out = *(void **) tmp;
+			free(tmp);
+		}
+	}
+
+	return status;
+}
+
+static void binaryRpc_writeUint64(uint64_t value, FILE *stream) {
+	int i;
+	for (i = 0; i < 8; i += 1) {
+		fputc((value >> (8 * i)) & 0xff, stream);
+	}
+}
+
+static uint64_t binaryRpc_readUint64(const uint8_t *data) {
+	uint64_t value = 0;
+	int i;
+	for (i = 7; i >= 0; i -= 1) {
+		value = (value << 8) | data[i];
+	}
+	return value;
+}
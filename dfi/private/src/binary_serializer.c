@@ -0,0 +1,451 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+#include "binary_serializer.h"
+#include "dyn_type.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NULL_TEXT_LENGTH 0xffffffffU
+
+struct binary_reader {
+    const uint8_t *data;
+    size_t size;
+    size_t offset;
+};
+
+static int binarySerializer_createType(dyn_type *type, struct binary_reader *reader, void **result);
+static int binarySerializer_readAny(dyn_type *type, struct binary_reader *reader, void *loc);
+static int binarySerializer_readComplex(dyn_type *type, struct binary_reader *reader, void *loc);
+static int binarySerializer_readSequence(dyn_type *type, struct binary_reader *reader, void *loc);
+static int binarySerializer_readBytes(struct binary_reader *reader, void *out, size_t size);
+static int binarySerializer_readUInt(struct binary_reader *reader, size_t size, uint64_t *out);
+
+static int binarySerializer_writeAny(dyn_type *type, const void *input, FILE *stream);
+static int binarySerializer_writeComplex(dyn_type *type, const void *input, FILE *stream);
+static int binarySerializer_writeSequence(dyn_type *type, const void *input, FILE *stream);
+static int binarySerializer_writeUInt(FILE *stream, size_t size, uint64_t value);
+
+static int OK = 0;
+static int ERROR = 1;
+
+DFI_SETUP_LOG(binarySerializer);
+
+int binarySerializer_deserialize(dyn_type *type, const void *input, size_t inputSize, void **result) {
+    size_t offset = 0;
+    int status = binarySerializer_read(type, input, inputSize, &offset, result);
+
+    if (status == OK && offset != inputSize) {
+        LOG_WARNING("Ignoring %zu bytes after the value", inputSize - offset);
+    }
+    return status;
+}
+
+int binarySerializer_read(dyn_type *type, const void *input, size_t inputSize, size_t *offset, void **result) {
+    struct binary_reader reader;
+    int status;
+
+    reader.data = input;
+    reader.size = inputSize;
+    reader.offset = *offset;
+
+    status = binarySerializer_createType(type, &reader, result);
+    if (status == OK) {
+        *offset = reader.offset;
+    }
+
+    return status;
+}
+
+static int binarySerializer_createType(dyn_type *type, struct binary_reader *reader, void **result) {
+    int status = OK;
+    void *inst = NULL;
+
+    status = dynType_alloc(type, &inst);
+    if (status == OK) {
+        assert(inst != NULL);
+        status = binarySerializer_readAny(type, reader, inst);
+    }
+
+    if (status == OK) {
+        *result = inst;
+    } else {
+        dynType_free(type, inst);
+    }
+
+    return status;
+}
+
+static int binarySerializer_readAny(dyn_type *type, struct binary_reader *reader, void *loc) {
+    int status = OK;
+    dyn_type *subType = NULL;
+    char c = dynType_descriptorType(type);
+    uint64_t value = 0;
+    uint32_t f;
+    uint8_t present;
+
+    switch (c) {
+        case 'Z' :
+            status = binarySerializer_readUInt(reader, 1, &value);
+            *(bool *) loc = value != 0;
+            break;
+        case 'B' :
+        case 'b' :
+        case 'S' :
+        case 's' :
+        case 'I' :
+        case 'i' :
+        case 'J' :
+        case 'j' :
+            status = binarySerializer_readUInt(reader, dynType_size(type), &value);
+            switch (dynType_size(type)) {
+                case 1 : *(uint8_t *) loc = (uint8_t) value; break;
+                case 2 : *(uint16_t *) loc = (uint16_t) value; break;
+                case 4 : *(uint32_t *) loc = (uint32_t) value; break;
+                default : *(uint64_t *) loc = value; break;
+            }
+            break;
+        case 'N' :
+            status = binarySerializer_readUInt(reader, 4, &value);
+            *(int *) loc = (int32_t) (uint32_t) value;
+            break;
+        case 'F' :
+            status = binarySerializer_readUInt(reader, 4, &value);
+            f = (uint32_t) value;
+            memcpy(loc, &f, sizeof(float));
+            break;
+        case 'D' :
+            status = binarySerializer_readUInt(reader, 8, &value);
+            memcpy(loc, &value, sizeof(double));
+            break;
+        case 't' :
+            status = binarySerializer_readUInt(reader, 4, &value);
+            if (status == OK && value != NULL_TEXT_LENGTH) {
+                if (value > reader->size - reader->offset) {
+                    status = ERROR;
+                    LOG_ERROR("Text of %llu bytes does not fit in the message", (unsigned long long) value);
+                } else {
+                    char *text = malloc(value + 1);
+                    if (text == NULL) {
+                        status = ERROR;
+                    } else {
+                        memcpy(text, reader->data + reader->offset, value);
+                        text[value] = '\0';
+                        reader->offset += value;
+                        *(char **) loc = text;
+                    }
+                }
+            }
+            break;
+        case '[' :
+            status = binarySerializer_readSequence(type, reader, loc);
+            break;
+        case '{' :
+            status = binarySerializer_readComplex(type, reader, loc);
+            break;
+        case '*' :
+            status = binarySerializer_readBytes(reader, &present, 1);
+            if (status == OK) {
+                status = dynType_typedPointer_getTypedType(type, &subType);
+            }
+            if (status == OK) {
+                // allocated by dynType_alloc when the pointer is part of a new instance
+                void *old = *(void **) loc;
+                *(void **) loc = NULL;
+                if (old != NULL) {
+                    dynType_free(subType, old);
+                }
+                if (present) {
+                    status = binarySerializer_createType(subType, reader, (void **) loc);
+                }
+            }
+            break;
+        case 'P' :
+            status = ERROR;
+            LOG_WARNING("Untyped pointer are not supported for serialization");
+            break;
+        default :
+            status = ERROR;
+            LOG_ERROR("Error provided type '%c' not supported for binary serialization\n", c);
+            break;
+    }
+
+    return status;
+}
+
+static int binarySerializer_readComplex(dyn_type *type, struct binary_reader *reader, void *loc) {
+    assert(dynType_type(type) == DYN_TYPE_COMPLEX);
+    int status = OK;
+    struct complex_type_entries_head *entries = NULL;
+    struct complex_type_entry *entry = NULL;
+    int index = 0;
+
+    status = dynType_complex_entries(type, &entries);
+    if (status == OK) {
+        TAILQ_FOREACH(entry, entries, entries) {
+            void *subLoc = NULL;
+            dyn_type *subType = NULL;
+
+            status = dynType_complex_valLocAt(type, index, loc, &subLoc);
+            if (status == OK) {
+                status = dynType_complex_dynTypeAt(type, index, &subType);
+            }
+            if (status == OK) {
+                status = binarySerializer_readAny(subType, reader, subLoc);
+            }
+            if (status != OK) {
+                break;
+            }
+            index += 1;
+        }
+    }
+
+    return status;
+}
+
+static int binarySerializer_readSequence(dyn_type *type, struct binary_reader *reader, void *loc) {
+    assert(dynType_type(type) == DYN_TYPE_SEQUENCE);
+    int status;
+    uint64_t len = 0;
+
+    status = binarySerializer_readUInt(reader, 4, &len);
+    if (status == OK && len > reader->size - reader->offset) {
+        // every item takes at least one byte
+        status = ERROR;
+        LOG_ERROR("Sequence of %llu items does not fit in the message", (unsigned long long) len);
+    }
+    if (status == OK && len > 0) {
+        status = dynType_sequence_alloc(type, loc, (uint32_t) len);
+    }
+
+    if (status == OK) {
+        dyn_type *itemType = dynType_sequence_itemType(type);
+        uint64_t i;
+        for (i = 0; i < len; i += 1) {
+            void *itemLoc = NULL;
+            status = dynType_sequence_increaseLengthAndReturnLastLoc(type, loc, &itemLoc);
+            if (status == OK) {
+                status = binarySerializer_readAny(itemType, reader, itemLoc);
+            }
+            if (status != OK) {
+                break;
+            }
+        }
+    }
+
+    return status;
+}
+
+static int binarySerializer_readBytes(struct binary_reader *reader, void *out, size_t size) {
+    int status = OK;
+
+    if (size > reader->size - reader->offset) {
+        status = ERROR;
+        LOG_ERROR("Unexpected end of message, need %zu bytes at offset %zu of %zu", size, reader->offset, reader->size);
+    } else {
+        memcpy(out, reader->data + reader->offset, size);
+        reader->offset += size;
+    }
+
+    return status;
+}
+
+static int binarySerializer_readUInt(struct binary_reader *reader, size_t size, uint64_t *out) {
+    uint8_t bytes[8];
+    uint64_t value = 0;
+    int status = binarySerializer_readBytes(reader, bytes, size);
+
+    if (status == OK) {
+        size_t i;
+        for (i = size; i > 0; i -= 1) {
+            value = (value << 8) | bytes[i - 1];
+        }
+        *out = value;
+    }
+
+    return status;
+}
+
+int binarySerializer_serialize(dyn_type *type, const void *input, void **output, size_t *outputSize) {
+    int status;
+    char *buf = NULL;
+    size_t size = 0;
+    FILE *stream = open_memstream(&buf, &size);
+
+    if (stream == NULL) {
+        return ERROR;
+    }
+    status = binarySerializer_write(type, input, stream);
+    fclose(stream);
+
+    if (status == OK) {
+        *output = buf;
+        *outputSize = size;
+    } else {
+        free(buf);
+    }
+
+    return status;
+}
+
+int binarySerializer_write(dyn_type *type, const void *input, FILE *stream) {
+    return binarySerializer_writeAny(type, input, stream);
+}
+
+static int binarySerializer_writeAny(dyn_type *type, const void *input, FILE *stream) {
+    int status = OK;
+    dyn_type *subType = NULL;
+    char c = dynType_descriptorType(type);
+    uint64_t d;
+    uint32_t f;
+    const char *text;
+    const void *ptr;
+
+    switch (c) {
+        case 'Z' :
+            status = binarySerializer_writeUInt(stream, 1, *(const bool *) input ? 1 : 0);
+            break;
+        case 'B' :
+        case 'b' :
+            status = binarySerializer_writeUInt(stream, 1, *(const uint8_t *) input);
+            break;
+        case 'S' :
+        case 's' :
+            status = binarySerializer_writeUInt(stream, 2, *(const uint16_t *) input);
+            break;
+        case 'I' :
+        case 'i' :
+            status = binarySerializer_writeUInt(stream, 4, *(const uint32_t *) input);
+            break;
+        case 'J' :
+        case 'j' :
+            status = binarySerializer_writeUInt(stream, 8, *(const uint64_t *) input);
+            break;
+        case 'N' :
+            status = binarySerializer_writeUInt(stream, 4, (uint32_t) (int32_t) *(const int *) input);
+            break;
+        case 'F' :
+            memcpy(&f, input, sizeof(float));
+            status = binarySerializer_writeUInt(stream, 4, f);
+            break;
+        case 'D' :
+            memcpy(&d, input, sizeof(double));
+            status = binarySerializer_writeUInt(stream, 8, d);
+            break;
+        case 't' :
+            text = *(const char **) input;
+            if (text == NULL) {
+                status = binarySerializer_writeUInt(stream, 4, NULL_TEXT_LENGTH);
+            } else {
+                size_t len = strlen(text);
+                status = binarySerializer_writeUInt(stream, 4, len);
+                if (status == OK && fwrite(text, 1, len, stream) != len) {
+                    status = ERROR;
+                }
+            }
+            break;
+        case '*' :
+            ptr = *(void * const *) input;
+            status = binarySerializer_writeUInt(stream, 1, ptr != NULL ? 1 : 0);
+            if (status == OK && ptr != NULL) {
+                status = dynType_typedPointer_getTypedType(type, &subType);
+                if (status == OK) {
+                    status = binarySerializer_writeAny(subType, ptr, stream);
+                }
+            }
+            break;
+        case '{' :
+            status = binarySerializer_writeComplex(type, input, stream);
+            break;
+        case '[' :
+            status = binarySerializer_writeSequence(type, input, stream);
+            break;
+        case 'P' :
+            status = ERROR;
+            LOG_WARNING("Untyped pointer not supported for serialization");
+            break;
+        default :
+            LOG_ERROR("Unsupported descriptor '%c'", c);
+            status = ERROR;
+            break;
+    }
+
+    return status;
+}
+
+static int binarySerializer_writeComplex(dyn_type *type, const void *input, FILE *stream) {
+    assert(dynType_type(type) == DYN_TYPE_COMPLEX);
+    int status = OK;
+    struct complex_type_entries_head *entries = NULL;
+    struct complex_type_entry *entry = NULL;
+    int index = 0;
+
+    status = dynType_complex_entries(type, &entries);
+    if (status == OK) {
+        TAILQ_FOREACH(entry, entries, entries) {
+            void *subLoc = NULL;
+            dyn_type *subType = NULL;
+
+            status = dynType_complex_valLocAt(type, index, (void *) input, &subLoc);
+            if (status == OK) {
+                status = dynType_complex_dynTypeAt(type, index, &subType);
+            }
+            if (status == OK) {
+                status = binarySerializer_writeAny(subType, subLoc, stream);
+            }
+            if (status != OK) {
+                break;
+            }
+            index += 1;
+        }
+    }
+
+    return status;
+}
+
+static int binarySerializer_writeSequence(dyn_type *type, const void *input, FILE *stream) {
+    assert(dynType_type(type) == DYN_TYPE_SEQUENCE);
+    int status;
+    dyn_type *itemType = dynType_sequence_itemType(type);
+    uint32_t len = dynType_sequence_length((void *) input);
+    uint32_t i;
+
+    status = binarySerializer_writeUInt(stream, 4, len);
+    for (i = 0; status == OK && i < len; i += 1) {
+        void *itemLoc = NULL;
+        status = dynType_sequence_locForIndex(type, (void *) input, i, &itemLoc);
+        if (status == OK) {
+            status = binarySerializer_writeAny(itemType, itemLoc, stream);
+        }
+    }
+
+    return status;
+}
+
+static int binarySerializer_writeUInt(FILE *stream, size_t size, uint64_t value) {
+    uint8_t bytes[8];
+    size_t i;
+
+    for (i = 0; i < size; i += 1) {
+        bytes[i] = (uint8_t) (value >> (8 * i));
+    }
+    return fwrite(bytes, 1, size, stream) == size ? OK : ERROR;
+}
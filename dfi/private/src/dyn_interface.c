@@ -45,6 +45,7 @@ static int dynInterface_parseMethods(dyn_interface_type *intf, FILE *stream);
 static int dynInterface_parseHeader(dyn_interface_type *intf, FILE *stream);
 static int dynInterface_parseNameValueSection(dyn_interface_type *intf, FILE *stream, struct namvals_head *head);
 static int dynInterface_checkInterface(dyn_interface_type *intf);
+static int dynInterface_parseOneway(dyn_interface_type *intf);
 static int dynInterface_getEntryForHead(struct namvals_head *head, const char *name, char **value);
 
 int dynInterface_parse(FILE *descriptor, dyn_interface_type **out) {
@@ -76,6 +77,10 @@ int dynInterface_parse(FILE *descriptor, dyn_interface_type **out) {
             status = dynInterface_checkInterface(intf);
         }
 
+        if (status == OK) {
+            status = dynInterface_parseOneway(intf);
+        }
+
         if(status==OK){ /* We are sure that version field is present in the header */
         	char* version=NULL;
             dynInterface_getVersionString(intf,&version);
@@ -138,6 +143,50 @@ static int dynInterface_checkInterface(dyn_interface_type *intf) {
     return status;
 }
 
+static int dynInterface_parseOneway(dyn_interface_type *intf) {
+    int status = OK;
+    char *value = NULL;
+
+    if (dynInterface_getAnnotationEntry(intf, "oneway", &value) != OK) {
+        return OK; //no oneway methods
+    }
+
+    const char *id = value;
+    while (status == OK && *id != '\0') {
+        size_t length = strcspn(id, ",");
+        struct method_entry *mEntry = NULL;
+        TAILQ_FOREACH(mEntry, &intf->methods, entries) {
+            if (strlen(mEntry->id) == length && strncmp(mEntry->id, id, length) == 0) {
+                break;
+            }
+        }
+
+        if (mEntry == NULL) {
+            status = ERROR;
+            LOG_ERROR("Parse Error. Cannot find oneway method '%.*s'", (int) length, id);
+        } else {
+            int i;
+            int nrOfArgs = dynFunction_nrOfArguments(mEntry->dynFunc);
+            for (i = 0; i < nrOfArgs; i += 1) {
+                enum dyn_function_argument_meta meta = dynFunction_argumentMetaForIndex(mEntry->dynFunc, i);
+                if (meta == DYN_FUNCTION_ARGUMENT_META__PRE_ALLOCATED_OUTPUT || meta == DYN_FUNCTION_ARGUMENT_META__OUTPUT) {
+                    status = ERROR;
+                    LOG_ERROR("Parse Error. Oneway method '%s' cannot have output arguments", mEntry->id);
+                    break;
+                }
+            }
+            mEntry->oneway = status == OK;
+        }
+
+        id += length;
+        if (*id == ',') {
+            id += 1;
+        }
+    }
+
+    return status;
+}
+
 static int dynInterface_parseSection(dyn_interface_type *intf, FILE *stream) {
     int status = OK;
     char *sectionName = NULL;
@@ -20,9 +20,12 @@
 #include "json_serializer.h"
 #include "dyn_type.h"
 #include "dyn_interface.h"
+#include "celix_trace.h"
 #include <jansson.h>
 #include <assert.h>
+#include <inttypes.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <string.h>
 #include <ffi.h>
 
@@ -39,48 +42,87 @@ struct generic_service_layout {
 	gen_func_type methods[];
 };
 
+static int jsonRpc_invoke(dyn_interface_type *intf, void *service, json_t *js_request, json_t **out);
+static int jsonRpc_readResult(dyn_function_type *func, json_t *result, void *args[]);
+
 int jsonRpc_call(dyn_interface_type *intf, void *service, const char *request, char **out) {
 	int status = OK;
 
-	dyn_type* returnType = NULL;
-
 	LOG_DEBUG("Parsing data: %s\n", request);
 	json_error_t error;
 	json_t *js_request = json_loads(request, 0, &error);
-	json_t *arguments = NULL;
-	const char *sig;
-	if (js_request) {
-		if (json_unpack(js_request, "{s:s}", "m", &sig) != 0) {
-			LOG_ERROR("Got json error '%s'\n", error.text);
-		} else {
-			arguments = json_object_get(js_request, "a");
-		}
-	} else {
+	if (js_request == NULL) {
 		LOG_ERROR("Got json error '%s' for '%s'\n", error.text, request);
 		return 0;
 	}
 
-	LOG_DEBUG("Looking for method %s\n", sig);
-	struct methods_head *methods = NULL;
-	dynInterface_methods(intf, &methods);
-	struct method_entry *entry = NULL;
-	struct method_entry *method = NULL;
-	TAILQ_FOREACH(entry, methods, entries) {
-		if (strcmp(sig, entry->id) == 0) {
-			method = entry;
-			break;
+	json_t *payload = NULL;
+	if (json_is_array(js_request)) {
+		//a batch, the calls are invoked in order and the reply has a payload for every call
+		size_t i;
+		payload = json_array();
+		for (i = 0; i < json_array_size(js_request); i += 1) {
+			json_t *reply = NULL;
+			if (jsonRpc_invoke(intf, service, json_array_get(js_request, i), &reply) != OK) {
+				reply = json_null();
+			}
+			json_array_append_new(payload, reply);
 		}
+	} else {
+		status = jsonRpc_invoke(intf, service, js_request, &payload);
+	}
+	json_decref(js_request);
+
+	if (status == OK) {
+		char *response = json_dumps(payload, JSON_DECODE_ANY);
+		LOG_DEBUG("response is '%s'\n", response);
+		*out = response;
 	}
+	json_decref(payload);
+
+	return status;
+}
 
-	if (method == NULL) {
+static int jsonRpc_invoke(dyn_interface_type *intf, void *service, json_t *js_request, json_t **out) {
+	int status = OK;
+
+	dyn_type* returnType = NULL;
+
+	json_t *arguments = NULL;
+	const char *sig = NULL;
+	if (json_unpack(js_request, "{s:s}", "m", &sig) != 0) {
 		status = ERROR;
-		LOG_ERROR("Cannot find method with sig '%s'", sig);
+		LOG_ERROR("Got request without a method");
+	} else {
+		arguments = json_object_get(js_request, "a");
 	}
-	else if (status == OK) {
-		LOG_DEBUG("RSA: found method '%s'\n", entry->id);
-		returnType = dynFunction_returnType(method->dynFunc);
+
+	struct method_entry *entry = NULL;
+	struct method_entry *method = NULL;
+	if (status == OK) {
+		LOG_DEBUG("Looking for method %s\n", sig);
+		struct methods_head *methods = NULL;
+		dynInterface_methods(intf, &methods);
+		TAILQ_FOREACH(entry, methods, entries) {
+			if (strcmp(sig, entry->id) == 0) {
+				method = entry;
+				break;
+			}
+		}
+
+		if (method == NULL) {
+			status = ERROR;
+			LOG_ERROR("Cannot find method with sig '%s'", sig);
+		}
 	}
 
+	if (status != OK) {
+		return status;
+	}
+
+	LOG_DEBUG("RSA: found method '%s'\n", entry->id);
+	returnType = dynFunction_returnType(method->dynFunc);
+
 	void (*fp)(void) = NULL;
 	void *handle = NULL;
 	if (status == OK) {
@@ -124,7 +166,6 @@ int jsonRpc_call(dyn_interface_type *intf, void *service, const char *request, c
 			break;
 		}
 	}
-	json_decref(js_request);
 
 	if (status == OK) {
 		if (dynType_descriptorType(returnType) != 'N') {
@@ -137,7 +178,16 @@ int jsonRpc_call(dyn_interface_type *intf, void *service, const char *request, c
 	ffi_sarg returnVal = 1;
 
 	if (status == OK) {
+		//continue the trace of the caller, the "t" entry holds its trace and span id
+		celix_trace_span_t span;
+		celix_trace_context_t remote = { 0, 0 };
+		const char *trace = json_string_value(json_object_get(js_request, "t"));
+		if (trace != NULL && sscanf(trace, "%16" SCNx64 "-%16" SCNx64, &remote.traceId, &remote.spanId) != 2) {
+			remote.traceId = 0;
+		}
+		celixTrace_beginRemoteSpan("rsa.invoke", method->id, &remote, &span);
 		status = dynFunction_call(func, fp, (void *) &returnVal, args);
+		celixTrace_endSpan(&span);
 	}
 
 	int funcCallStatus = (int)returnVal;
@@ -198,7 +248,6 @@ int jsonRpc_call(dyn_interface_type *intf, void *service, const char *request, c
 		}
 	}
 
-	char *response = NULL;
 	if (status == OK) {
 		LOG_DEBUG("creating payload\n");
 		json_t *payload = json_object();
@@ -213,15 +262,7 @@ int jsonRpc_call(dyn_interface_type *intf, void *service, const char *request, c
 			LOG_DEBUG("Setting error payload");
 			json_object_set_new(payload, "e", json_integer(funcCallStatus));
 		}
-		response = json_dumps(payload, JSON_DECODE_ANY);
-		json_decref(payload);
-		LOG_DEBUG("status ptr is %p. response is '%s'\n", status, response);
-	}
-
-	if (status == OK) {
-		*out = response;
-	} else {
-		free(response);
+		*out = payload;
 	}
 
 	return status;
@@ -238,6 +279,14 @@ int jsonRpc_prepareInvokeRequest(dyn_function_type *func, const char *id, void *
 	json_t *arguments = json_array();
 	json_object_set_new(invoke, "a", arguments);
 
+	celix_trace_context_t trace;
+	celixTrace_currentContext(&trace);
+	if (trace.traceId != 0) {
+		char traceStr[34];
+		snprintf(traceStr, sizeof(traceStr), "%016" PRIx64 "-%016" PRIx64, trace.traceId, trace.spanId);
+		json_object_set_new(invoke, "t", json_string(traceStr));
+	}
+
 	int i;
 	int nrOfArgs = dynFunction_nrOfArguments(func);
 	for (i = 0; i < nrOfArgs; i +=1) {
@@ -288,49 +337,67 @@ int jsonRpc_handleReply(dyn_function_type *func, const char *reply, void *args[]
 	}
 
 	if (status == OK) {
-		int nrOfArgs = dynFunction_nrOfArguments(func);
-		int i;
-		for (i = 0; i < nrOfArgs; i += 1) {
-			dyn_type *argType = dynFunction_argumentTypeForIndex(func, i);
-			enum dyn_function_argument_meta meta = dynFunction_argumentMetaForIndex(func, i);
-			if (meta == DYN_FUNCTION_ARGUMENT_META__PRE_ALLOCATED_OUTPUT) {
-				void *tmp = NULL;
-				void **out = (void **) args[i];
+		status = jsonRpc_readResult(func, result, args);
+	}
 
-				size_t size = 0;
+	json_decref(replyJson);
 
-				if (dynType_descriptorType(argType) == 't') {
-					status = jsonSerializer_deserializeJson(argType, result, &tmp);
-					if(tmp!=NULL){
-						size = strnlen(((char *) *(char**) tmp), 1024 * 1024);
-						memcpy(*out, *(void**) tmp, size);
-					}
-				} else {
-					dynType_typedPointer_getTypedType(argType, &argType);
-					status = jsonSerializer_deserializeJson(argType, result, &tmp);
-					if(tmp!=NULL){
-						size = dynType_size(argType);
-						memcpy(*out, tmp, size);
-					}
-				}
+	return status;
+}
 
-				dynType_free(argType, tmp);
-			} else if (meta == DYN_FUNCTION_ARGUMENT_META__OUTPUT) {
-				dyn_type *subType = NULL;
+int jsonRpc_prepareBatchRequest(char *requests[], size_t nrOfRequests, char **out) {
+	int status = OK;
+	char *batch = NULL;
+	size_t batchSize = 0;
+	size_t i;
+
+	FILE *stream = open_memstream(&batch, &batchSize);
+	if (stream == NULL) {
+		status = ERROR;
+		LOG_ERROR("Error creating mem stream for batch");
+	} else {
+		fputc('[', stream);
+		for (i = 0; i < nrOfRequests; i += 1) {
+			if (i > 0) {
+				fputc(',', stream);
+			}
+			fputs(requests[i], stream);
+		}
+		fputc(']', stream);
+		fclose(stream);
+		*out = batch;
+	}
 
-				dynType_typedPointer_getTypedType(argType, &subType);
+	return status;
+}
 
-				if (dynType_descriptorType(subType) == 't') {
-					void ***out = (void ***) args[i];
-					status = jsonSerializer_deserializeJson(subType, result, *out);
-				} else {
-					dyn_type *subSubType = NULL;
-					dynType_typedPointer_getTypedType(subType, &subSubType);
-					void ***out = (void ***) args[i];
-					status = jsonSerializer_deserializeJson(subSubType, result, *out);
-				}
-			} else {
-				//skip
+int jsonRpc_handleBatchReply(dyn_function_type *funcs[], const char *reply, void **args[], int callStatus[], size_t nrOfCalls) {
+	int status = OK;
+
+	json_error_t error;
+	json_t *replyJson = json_loads(reply, 0, &error);
+	if (replyJson == NULL) {
+		status = ERROR;
+		LOG_ERROR("Error parsing json '%s', got error '%s'", reply, error.text);
+	} else if (!json_is_array(replyJson) || json_array_size(replyJson) != nrOfCalls) {
+		status = ERROR;
+		LOG_ERROR("Expected a batch reply with %zu entries, got '%s'", nrOfCalls, reply);
+	}
+
+	size_t i;
+	for (i = 0; status == OK && i < nrOfCalls; i += 1) {
+		json_t *payload = json_array_get(replyJson, i);
+		json_t *result = json_object_get(payload, "r");
+		json_t *errorCode = json_object_get(payload, "e");
+		if (!json_is_object(payload)) {
+			//the remote side could not invoke the call
+			callStatus[i] = -1;
+		} else if (errorCode != NULL) {
+			callStatus[i] = (int) json_integer_value(errorCode);
+		} else {
+			callStatus[i] = 0;
+			if (result != NULL) {
+				status = jsonRpc_readResult(funcs[i], result, args[i]);
 			}
 		}
 	}
@@ -339,3 +406,54 @@ int jsonRpc_handleReply(dyn_function_type *func, const char *reply, void *args[]
 
 	return status;
 }
+
+static int jsonRpc_readResult(dyn_function_type *func, json_t *result, void *args[]) {
+	int status = OK;
+	int nrOfArgs = dynFunction_nrOfArguments(func);
+	int i;
+	for (i = 0; i < nrOfArgs; i += 1) {
+		dyn_type *argType = dynFunction_argumentTypeForIndex(func, i);
+		enum dyn_function_argument_meta meta = dynFunction_argumentMetaForIndex(func, i);
+		if (meta == DYN_FUNCTION_ARGUMENT_META__PRE_ALLOCATED_OUTPUT) {
+			void *tmp = NULL;
+			void **out = (void **) args[i];
+
+			size_t size = 0;
+
+			if (dynType_descriptorType(argType) == 't') {
+				status = jsonSerializer_deserializeJson(argType, result, &tmp);
+				if(tmp!=NULL){
+					size = strnlen(((char *) *(char**) tmp), 1024 * 1024);
+					memcpy(*out, *(void**) tmp, size);
+				}
+			} else {
+				dynType_typedPointer_getTypedType(argType, &argType);
+				status = jsonSerializer_deserializeJson(argType, result, &tmp);
+				if(tmp!=NULL){
+					size = dynType_size(argType);
+					memcpy(*out, tmp, size);
+				}
+			}
+
+			dynType_free(argType, tmp);
+		} else if (meta == DYN_FUNCTION_ARGUMENT_META__OUTPUT) {
+			dyn_type *subType = NULL;
+
+			dynType_typedPointer_getTypedType(argType, &subType);
+
+			if (dynType_descriptorType(subType) == 't') {
+				void ***out = (void ***) args[i];
+				status = jsonSerializer_deserializeJson(subType, result, *out);
+			} else {
+				dyn_type *subSubType = NULL;
+				dynType_typedPointer_getTypedType(subType, &subSubType);
+				void ***out = (void ***) args[i];
+				status = jsonSerializer_deserializeJson(subSubType, result, *out);
+			}
+		} else {
+			//skip
+		}
+	}
+
+	return status;
+}
@@ -0,0 +1,394 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+#include <CppUTest/TestHarness.h>
+#include <float.h>
+#include "CppUTest/CommandLineTestRunner.h"
+
+extern "C" {
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ffi.h>
+
+#include "dyn_common.h"
+#include "dyn_type.h"
+#include "dyn_interface.h"
+#include "binary_serializer.h"
+#include "binary_rpc.h"
+#include "celix_trace.h"
+
+static void stdLog(void*, int level, const char *file, int line, const char *msg, ...) {
+    va_list ap;
+    const char *levels[5] = {"NIL", "ERROR", "WARNING", "INFO", "DEBUG"};
+    fprintf(stderr, "%s: FILE:%s, LINE:%i, MSG:",levels[level], file, line);
+    va_start(ap, msg);
+    vfprintf(stderr, msg, ap);
+    fprintf(stderr, "\n");
+    va_end(ap);
+}
+
+    static int binary_add(void*, double a, double b, double *result) {
+        *result = a + b;
+        return 0;
+    }
+
+    static celix_trace_context_t binary_invokeContext;
+
+    static int binary_tracedAdd(void*, double a, double b, double *result) {
+        celixTrace_currentContext(&binary_invokeContext);
+        *result = a + b;
+        return 0;
+    }
+
+    static int binary_sqrt(void*, double, double *) {
+        return 3;
+    }
+
+    struct binary_seq {
+        uint32_t cap;
+        uint32_t len;
+        double *buf;
+    };
+
+    //StatsResult={DDD[D average min max input}
+    struct binary_StatsResult {
+        double average;
+        double min;
+        double max;
+        struct binary_seq input;
+    };
+
+    static int binary_stats(void*, struct binary_seq input, struct binary_StatsResult **out) {
+        struct binary_StatsResult *result = (struct binary_StatsResult *) calloc(1, sizeof(*result));
+        double total = 0.0;
+        unsigned int i;
+
+        result->min = DBL_MAX;
+        result->max = -DBL_MAX;
+        for (i = 0; i < input.len; i += 1) {
+            total += input.buf[i];
+            result->min = input.buf[i] < result->min ? input.buf[i] : result->min;
+            result->max = input.buf[i] > result->max ? input.buf[i] : result->max;
+        }
+        result->average = input.len > 0 ? total / input.len : 0.0;
+        result->input.buf = (double *) calloc(input.len, sizeof(double));
+        memcpy(result->input.buf, input.buf, input.len * sizeof(double));
+        result->input.len = input.len;
+        result->input.cap = input.len;
+
+        *out = result;
+        return 0;
+    }
+
+    static int binary_getName(void*, char** result) {
+        *result = strdup("allocatedInFunction");
+        return 0;
+    }
+
+    struct binary_serv {
+        void *handle;
+        int (*add)(void *, double, double, double *);
+        int (*sub)(void *, double, double, double *);
+        int (*sqrt)(void *, double, double *);
+        int (*stats)(void *, struct binary_seq, struct binary_StatsResult **);
+    };
+
+    struct binary_serv_example4 {
+        void *handle;
+        int (*getName)(void *, char** name);
+    };
+
+    static dyn_interface_type *binaryRpc_parseInterface(const char *file) {
+        dyn_interface_type *intf = NULL;
+        FILE *desc = fopen(file, "r");
+        CHECK(desc != NULL);
+        int rc = dynInterface_parse(desc, &intf);
+        CHECK_EQUAL(0, rc);
+        fclose(desc);
+        return intf;
+    }
+
+    static struct method_entry *binaryRpc_findMethod(dyn_interface_type *intf, const char *name) {
+        struct methods_head *head = NULL;
+        struct method_entry *entry = NULL;
+        dynInterface_methods(intf, &head);
+        TAILQ_FOREACH(entry, head, entries) {
+            if (strcmp(entry->name, name) == 0) {
+                break;
+            }
+        }
+        CHECK(entry != NULL);
+        return entry;
+    }
+
+    static void binaryCallPre(void) {
+        dyn_interface_type *intf = binaryRpc_parseInterface("descriptors/example1.descriptor");
+        struct method_entry *entry = binaryRpc_findMethod(intf, "add");
+
+        struct binary_serv serv;
+        memset(&serv, 0, sizeof(serv));
+        serv.add = binary_add;
+
+        void *handle = NULL;
+        double arg1 = 1.0;
+        double arg2 = 2.0;
+        double result = -1.0;
+        double *out = &result;
+        void *args[4];
+        args[0] = &handle;
+        args[1] = &arg1;
+        args[2] = &arg2;
+        args[3] = &out;
+
+        void *request = NULL;
+        size_t requestSize = 0;
+        int rc = binaryRpc_prepareInvokeRequest(entry->dynFunc, entry->id, args, &request, &requestSize);
+        CHECK_EQUAL(0, rc);
+        //method id (2 + 7 bytes) and two doubles
+        CHECK_EQUAL(2 + strlen(entry->id) + 16, requestSize);
+
+        void *reply = NULL;
+        size_t replySize = 0;
+        rc = binaryRpc_call(intf, &serv, request, requestSize, &reply, &replySize);
+        CHECK_EQUAL(0, rc);
+
+        int callStatus = -1;
+        rc = binaryRpc_handleReply(entry->dynFunc, reply, replySize, args, &callStatus);
+        CHECK_EQUAL(0, rc);
+        CHECK_EQUAL(0, callStatus);
+        CHECK_EQUAL(3.0, result);
+
+        free(request);
+        free(reply);
+        dynInterface_destroy(intf);
+    }
+
+    static void binaryCallTraced(void) {
+        dyn_interface_type *intf = binaryRpc_parseInterface("descriptors/example1.descriptor");
+        struct method_entry *entry = binaryRpc_findMethod(intf, "add");
+
+        struct binary_serv serv;
+        memset(&serv, 0, sizeof(serv));
+        serv.add = binary_tracedAdd;
+
+        void *handle = NULL;
+        double arg1 = 1.0;
+        double arg2 = 2.0;
+        double result = -1.0;
+        double *out = &result;
+        void *args[4];
+        args[0] = &handle;
+        args[1] = &arg1;
+        args[2] = &arg2;
+        args[3] = &out;
+
+        celixTrace_setSampleRate(1);
+        celix_trace_span_t span;
+        celix_trace_context_t caller;
+        celixTrace_beginSpan("test.call", NULL, &span);
+        celixTrace_currentContext(&caller);
+
+        void *request = NULL;
+        size_t requestSize = 0;
+        int rc = binaryRpc_prepareInvokeRequest(entry->dynFunc, entry->id, args, &request, &requestSize);
+        celixTrace_endSpan(&span);
+        CHECK_EQUAL(0, rc);
+        //method id, trace context (16 bytes) and two doubles
+        CHECK_EQUAL(2 + strlen(entry->id) + 16 + 16, requestSize);
+
+        void *reply = NULL;
+        size_t replySize = 0;
+        memset(&binary_invokeContext, 0, sizeof(binary_invokeContext));
+        rc = binaryRpc_call(intf, &serv, request, requestSize, &reply, &replySize);
+        celixTrace_setSampleRate(0);
+        CHECK_EQUAL(0, rc);
+        //the service is invoked in a child span of the caller
+        CHECK(binary_invokeContext.traceId == caller.traceId);
+        CHECK(binary_invokeContext.spanId != caller.spanId);
+
+        int callStatus = -1;
+        rc = binaryRpc_handleReply(entry->dynFunc, reply, replySize, args, &callStatus);
+        CHECK_EQUAL(0, rc);
+        CHECK_EQUAL(3.0, result);
+
+        free(request);
+        free(reply);
+        dynInterface_destroy(intf);
+    }
+
+    static void binaryCallError(void) {
+        dyn_interface_type *intf = binaryRpc_parseInterface("descriptors/example1.descriptor");
+        struct method_entry *entry = binaryRpc_findMethod(intf, "sqrt");
+
+        struct binary_serv serv;
+        memset(&serv, 0, sizeof(serv));
+        serv.sqrt = binary_sqrt;
+
+        void *handle = NULL;
+        double arg1 = 4.0;
+        double result = -1.0;
+        double *out = &result;
+        void *args[3];
+        args[0] = &handle;
+        args[1] = &arg1;
+        args[2] = &out;
+
+        void *request = NULL;
+        size_t requestSize = 0;
+        int rc = binaryRpc_prepareInvokeRequest(entry->dynFunc, entry->id, args, &request, &requestSize);
+        CHECK_EQUAL(0, rc);
+
+        void *reply = NULL;
+        size_t replySize = 0;
+        rc = binaryRpc_call(intf, &serv, request, requestSize, &reply, &replySize);
+        CHECK_EQUAL(0, rc);
+
+        int callStatus = 0;
+        rc = binaryRpc_handleReply(entry->dynFunc, reply, replySize, args, &callStatus);
+        CHECK_EQUAL(0, rc);
+        CHECK_EQUAL(3, callStatus);
+        CHECK_EQUAL(-1.0, result);
+
+        //an unknown method fails the call
+        const char unknown[] = "\x03\x00" "foo";
+        void *unknownReply = NULL;
+        rc = binaryRpc_call(intf, &serv, unknown, sizeof(unknown) - 1, &unknownReply, &replySize);
+        CHECK_EQUAL(1, rc);
+
+        free(request);
+        free(reply);
+        dynInterface_destroy(intf);
+    }
+
+    static void binaryCallOutput(void) {
+        dyn_interface_type *intf = binaryRpc_parseInterface("descriptors/example1.descriptor");
+        struct method_entry *entry = binaryRpc_findMethod(intf, "stats");
+
+        struct binary_serv serv;
+        memset(&serv, 0, sizeof(serv));
+        serv.stats = binary_stats;
+
+        void *handle = NULL;
+        double values[] = {1.0, 2.0};
+        struct binary_seq input = {2, 2, values};
+        struct binary_StatsResult *result = NULL;
+        void *out = &result;
+        void *args[3];
+        args[0] = &handle;
+        args[1] = &input;
+        args[2] = &out;
+
+        void *request = NULL;
+        size_t requestSize = 0;
+        int rc = binaryRpc_prepareInvokeRequest(entry->dynFunc, entry->id, args, &request, &requestSize);
+        CHECK_EQUAL(0, rc);
+
+        void *reply = NULL;
+        size_t replySize = 0;
+        rc = binaryRpc_call(intf, &serv, request, requestSize, &reply, &replySize);
+        CHECK_EQUAL(0, rc);
+
+        int callStatus = -1;
+        rc = binaryRpc_handleReply(entry->dynFunc, reply, replySize, args, &callStatus);
+        CHECK_EQUAL(0, rc);
+        CHECK_EQUAL(0, callStatus);
+        CHECK(result != NULL);
+        CHECK_EQUAL(1.5, result->average);
+        CHECK_EQUAL(1.0, result->min);
+        CHECK_EQUAL(2.0, result->max);
+        CHECK_EQUAL(2, result->input.len);
+        CHECK_EQUAL(2.0, result->input.buf[1]);
+
+        free(result->input.buf);
+        free(result);
+        free(request);
+        free(reply);
+        dynInterface_destroy(intf);
+    }
+
+    static void binaryCallOutChar(void) {
+        dyn_interface_type *intf = binaryRpc_parseInterface("descriptors/example4.descriptor");
+        struct method_entry *entry = binaryRpc_findMethod(intf, "getName");
+
+        struct binary_serv_example4 serv;
+        serv.handle = NULL;
+        serv.getName = binary_getName;
+
+        void *handle = NULL;
+        char *result = NULL;
+        void *out = &result;
+        void *args[2];
+        args[0] = &handle;
+        args[1] = &out;
+
+        void *request = NULL;
+        size_t requestSize = 0;
+        int rc = binaryRpc_prepareInvokeRequest(entry->dynFunc, entry->id, args, &request, &requestSize);
+        CHECK_EQUAL(0, rc);
+
+        void *reply = NULL;
+        size_t replySize = 0;
+        rc = binaryRpc_call(intf, &serv, request, requestSize, &reply, &replySize);
+        CHECK_EQUAL(0, rc);
+
+        int callStatus = -1;
+        rc = binaryRpc_handleReply(entry->dynFunc, reply, replySize, args, &callStatus);
+        CHECK_EQUAL(0, rc);
+        STRCMP_EQUAL("allocatedInFunction", result);
+
+        free(result);
+        free(request);
+        free(reply);
+        dynInterface_destroy(intf);
+    }
+}
+
+TEST_GROUP(BinaryRpcTests) {
+    void setup() {
+        int lvl = 1;
+        dynCommon_logSetup(stdLog, NULL, lvl);
+        dynType_logSetup(stdLog, NULL,lvl);
+        dynFunction_logSetup(stdLog, NULL,lvl);
+        dynInterface_logSetup(stdLog, NULL,lvl);
+        binarySerializer_logSetup(stdLog, NULL, lvl);
+        binaryRpc_logSetup(stdLog, NULL, lvl);
+    }
+};
+
+TEST(BinaryRpcTests, callPre) {
+    binaryCallPre();
+}
+
+TEST(BinaryRpcTests, callTraced) {
+    binaryCallTraced();
+}
+
+TEST(BinaryRpcTests, callError) {
+    binaryCallError();
+}
+
+TEST(BinaryRpcTests, callOut) {
+    binaryCallOutput();
+}
+
+TEST(BinaryRpcTests, callOutChar) {
+    binaryCallOutChar();
+}
@@ -0,0 +1,263 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+#include <CppUTest/TestHarness.h>
+#include "CppUTest/CommandLineTestRunner.h"
+
+extern "C" {
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ffi.h>
+
+#include "dyn_common.h"
+#include "dyn_type.h"
+#include "binary_serializer.h"
+
+static void stdLog(void*, int level, const char *file, int line, const char *msg, ...) {
+	va_list ap;
+	const char *levels[5] = {"NIL", "ERROR", "WARNING", "INFO", "DEBUG"};
+	fprintf(stderr, "%s: FILE:%s, LINE:%i, MSG:",levels[level], file, line);
+	va_start(ap, msg);
+	vfprintf(stderr, msg, ap);
+	fprintf(stderr, "\n");
+	va_end(ap);
+}
+
+/*********** example 1 ************************/
+/** simple types, written without padding ****/
+const char *example1_descriptor = "{DJISFZb a b c d e f g}";
+
+struct example1 {
+	double a;   //0
+	int64_t b;  //1
+	int32_t c;  //2
+	int16_t d;  //3
+	float e;    //4
+	bool f;     //5
+	uint8_t g;  //6
+};
+
+static void binaryTest1(void) {
+	dyn_type *type = NULL;
+	int rc = dynType_parseWithStr(example1_descriptor, NULL, NULL, &type);
+	CHECK_EQUAL(0, rc);
+
+	struct example1 input;
+	memset(&input, 0, sizeof(input));
+	input.a = 1.5;
+	input.b = -22;
+	input.c = 32;
+	input.d = -42;
+	input.e = 4.4f;
+	input.f = true;
+	input.g = 255;
+
+	void *data = NULL;
+	size_t size = 0;
+	rc = binarySerializer_serialize(type, &input, &data, &size);
+	CHECK_EQUAL(0, rc);
+	CHECK_EQUAL(28, size);
+
+	struct example1 *output = NULL;
+	rc = binarySerializer_deserialize(type, data, size, (void **)&output);
+	CHECK_EQUAL(0, rc);
+	CHECK_EQUAL(1.5, output->a);
+	LONGS_EQUAL(-22, output->b);
+	LONGS_EQUAL(32, output->c);
+	LONGS_EQUAL(-42, output->d);
+	CHECK_EQUAL(4.4f, output->e);
+	CHECK_EQUAL(true, output->f);
+	CHECK_EQUAL(255, output->g);
+
+	//a truncated value is an error
+	void *truncated = NULL;
+	rc = binarySerializer_deserialize(type, data, size - 1, &truncated);
+	CHECK_EQUAL(1, rc);
+
+	dynType_free(type, output);
+	free(data);
+	dynType_destroy(type);
+}
+
+/*********** example 2 ************************/
+/** text and sequences ***********************/
+const char *example2_descriptor = "{tt[t[I name empty tags numbers}";
+
+struct example2 {
+	char *name;
+	char *empty;
+	struct {
+		uint32_t cap;
+		uint32_t len;
+		char **buf;
+	} tags;
+	struct {
+		uint32_t cap;
+		uint32_t len;
+		int32_t *buf;
+	} numbers;
+};
+
+static void binaryTest2(void) {
+	dyn_type *type = NULL;
+	int rc = dynType_parseWithStr(example2_descriptor, NULL, NULL, &type);
+	CHECK_EQUAL(0, rc);
+
+	char tag1[] = "first";
+	char tag2[] = "";
+	char *tags[] = {tag1, tag2};
+	char name[] = "example";
+	struct example2 input;
+	memset(&input, 0, sizeof(input));
+	input.name = name;
+	input.empty = NULL;
+	input.tags.cap = 2;
+	input.tags.len = 2;
+	input.tags.buf = tags;
+
+	void *data = NULL;
+	size_t size = 0;
+	rc = binarySerializer_serialize(type, &input, &data, &size);
+	CHECK_EQUAL(0, rc);
+
+	struct example2 *output = NULL;
+	rc = binarySerializer_deserialize(type, data, size, (void **)&output);
+	CHECK_EQUAL(0, rc);
+	STRCMP_EQUAL("example", output->name);
+	CHECK(output->empty == NULL);
+	CHECK_EQUAL(2, output->tags.len);
+	STRCMP_EQUAL("first", output->tags.buf[0]);
+	STRCMP_EQUAL("", output->tags.buf[1]);
+	CHECK_EQUAL(0, output->numbers.len);
+
+	dynType_free(type, output);
+	free(data);
+	dynType_destroy(type);
+}
+
+/*********** example 3 ************************/
+/** typed pointers ***************************/
+const char *example3_descriptor = "{*{II a b}*{II a b} left right}";
+
+struct ex3_leaf {
+	int32_t a;
+	int32_t b;
+};
+
+struct example3 {
+	struct ex3_leaf *left;
+	struct ex3_leaf *right;
+};
+
+static void binaryTest3(void) {
+	dyn_type *type = NULL;
+	int rc = dynType_parseWithStr(example3_descriptor, NULL, NULL, &type);
+	CHECK_EQUAL(0, rc);
+
+	struct ex3_leaf left = {1, 2};
+	struct example3 input;
+	input.left = &left;
+	input.right = NULL;
+
+	void *data = NULL;
+	size_t size = 0;
+	rc = binarySerializer_serialize(type, &input, &data, &size);
+	CHECK_EQUAL(0, rc);
+
+	struct example3 *output = NULL;
+	rc = binarySerializer_deserialize(type, data, size, (void **)&output);
+	CHECK_EQUAL(0, rc);
+	CHECK(output->left != NULL);
+	CHECK_EQUAL(1, output->left->a);
+	CHECK_EQUAL(2, output->left->b);
+	CHECK(output->right == NULL);
+
+	dynType_free(type, output);
+	free(data);
+	dynType_destroy(type);
+}
+
+/*********** example 4 ************************/
+/** several values in one message ************/
+static void binaryTest4(void) {
+	dyn_type *intType = NULL;
+	dyn_type *textType = NULL;
+	int rc = dynType_parseWithStr("I", NULL, NULL, &intType);
+	CHECK_EQUAL(0, rc);
+	rc = dynType_parseWithStr("t", NULL, NULL, &textType);
+	CHECK_EQUAL(0, rc);
+
+	char *buf = NULL;
+	size_t size = 0;
+	FILE *stream = open_memstream(&buf, &size);
+	int32_t number = 42;
+	char text[] = "text";
+	char *textPtr = text;
+	rc = binarySerializer_write(intType, &number, stream);
+	CHECK_EQUAL(0, rc);
+	rc = binarySerializer_write(textType, &textPtr, stream);
+	CHECK_EQUAL(0, rc);
+	fclose(stream);
+	CHECK_EQUAL(4 + 4 + 4, size);
+
+	size_t offset = 0;
+	int32_t *numberOut = NULL;
+	char **textOut = NULL;
+	rc = binarySerializer_read(intType, buf, size, &offset, (void **)&numberOut);
+	CHECK_EQUAL(0, rc);
+	CHECK_EQUAL(42, *numberOut);
+	rc = binarySerializer_read(textType, buf, size, &offset, (void **)&textOut);
+	CHECK_EQUAL(0, rc);
+	STRCMP_EQUAL("text", *textOut);
+	CHECK_EQUAL(size, offset);
+
+	dynType_free(intType, numberOut);
+	dynType_free(textType, textOut);
+	free(buf);
+	dynType_destroy(intType);
+	dynType_destroy(textType);
+}
+}
+
+TEST_GROUP(BinarySerializerTests) {
+	void setup() {
+		int lvl = 1;
+		dynCommon_logSetup(stdLog, NULL, lvl);
+		dynType_logSetup(stdLog, NULL,lvl);
+		binarySerializer_logSetup(stdLog, NULL, lvl);
+	}
+};
+
+TEST(BinarySerializerTests, SimpleTypes) {
+	binaryTest1();
+}
+
+TEST(BinarySerializerTests, TextAndSequences) {
+	binaryTest2();
+}
+
+TEST(BinarySerializerTests, TypedPointers) {
+	binaryTest3();
+}
+
+TEST(BinarySerializerTests, SeveralValues) {
+	binaryTest4();
+}
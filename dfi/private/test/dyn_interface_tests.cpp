@@ -111,6 +111,28 @@ extern "C" {
         dynInterface_destroy(dynIntf);
     }
 
+    static void testOneway(void) {
+        int status = 0;
+        dyn_interface_type *dynIntf = NULL;
+        FILE *desc = fopen("descriptors/example5.descriptor", "r");
+        assert(desc != NULL);
+        status = dynInterface_parse(desc, &dynIntf);
+        CHECK_EQUAL(0, status);
+        fclose(desc);
+
+        struct methods_head *list = NULL;
+        struct method_entry *entry = NULL;
+        int nrOfOneway = 0;
+        dynInterface_methods(dynIntf, &list);
+        TAILQ_FOREACH(entry, list, entries) {
+            CHECK_EQUAL(strcmp("count", entry->name) != 0, entry->oneway);
+            nrOfOneway += entry->oneway ? 1 : 0;
+        }
+        CHECK_EQUAL(2, nrOfOneway);
+
+        dynInterface_destroy(dynIntf);
+    }
+
     static void testInvalid(void) {
         int status = 0;
 
@@ -180,6 +202,13 @@ extern "C" {
         CHECK_EQUAL(1, status); //Invalid meta type doesn't generate errors, just warnings
         fclose(desc); desc=NULL;
 
+        /* Oneway method with an output argument */
+        desc = fopen("descriptors/invalids/invalidOneway.descriptor", "r");
+        assert(desc != NULL);
+        status = dynInterface_parse(desc, &dynIntf);
+        CHECK_EQUAL(1, status); //Test fails because oneway methods cannot have output arguments
+        fclose(desc); desc=NULL;
+
     }
 }
 
@@ -202,6 +231,10 @@ TEST(DynInterfaceTests, test2) {
     test2();
 }
 
+TEST(DynInterfaceTests, testOneway) {
+    testOneway();
+}
+
 TEST(DynInterfaceTests, testInvalid) {
     testInvalid();
 }
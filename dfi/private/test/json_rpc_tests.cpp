@@ -34,6 +34,7 @@ extern "C" {
 #include "dyn_type.h"
 #include "json_serializer.h"
 #include "json_rpc.h"
+#include "celix_trace.h"
 
 static void stdLog(void*, int level, const char *file, int line, const char *msg, ...) {
     va_list ap;
@@ -97,6 +98,14 @@ static void stdLog(void*, int level, const char *file, int line, const char *msg
         return 0;
     }
 
+    static celix_trace_context_t invokeContext;
+
+    int tracedAdd(void*, double a, double b, double *result) {
+        celixTrace_currentContext(&invokeContext);
+        *result = a + b;
+        return 0;
+    }
+
     int getName_example4(void*, char** result) {
         *result = strdup("allocatedInFunction");
         return 0;
@@ -201,6 +210,63 @@ static void stdLog(void*, int level, const char *file, int line, const char *msg
         dynInterface_destroy(intf);
     }
 
+    void callTestTraced(void) {
+        dyn_interface_type *intf = NULL;
+        FILE *desc = fopen("descriptors/example1.descriptor", "r");
+        CHECK(desc != NULL);
+        int rc = dynInterface_parse(desc, &intf);
+        CHECK_EQUAL(0, rc);
+        fclose(desc);
+
+        struct methods_head *head = NULL;
+        struct method_entry *entry = NULL;
+        dynInterface_methods(intf, &head);
+        TAILQ_FOREACH(entry, head, entries) {
+            if (strcmp(entry->name, "add") == 0) {
+                break;
+            }
+        }
+        CHECK(entry != NULL);
+
+        struct tst_serv serv;
+        serv.handle = NULL;
+        serv.add = tracedAdd;
+
+        void *handle = NULL;
+        double arg1 = 1.0;
+        double arg2 = 2.0;
+        void *args[4];
+        args[0] = &handle;
+        args[1] = &arg1;
+        args[2] = &arg2;
+
+        celixTrace_setSampleRate(1);
+        celix_trace_span_t span;
+        celix_trace_context_t caller;
+        celixTrace_beginSpan("test.call", NULL, &span);
+        celixTrace_currentContext(&caller);
+
+        char *request = NULL;
+        rc = jsonRpc_prepareInvokeRequest(entry->dynFunc, entry->id, args, &request);
+        celixTrace_endSpan(&span);
+        CHECK_EQUAL(0, rc);
+        STRCMP_CONTAINS("\"t\":", request);
+
+        char *result = NULL;
+        memset(&invokeContext, 0, sizeof(invokeContext));
+        rc = jsonRpc_call(intf, &serv, request, &result);
+        celixTrace_setSampleRate(0);
+        CHECK_EQUAL(0, rc);
+        STRCMP_CONTAINS("3.0", result);
+        //the service is invoked in a child span of the caller
+        CHECK(invokeContext.traceId == caller.traceId);
+        CHECK(invokeContext.spanId != caller.spanId);
+
+        free(request);
+        free(result);
+        dynInterface_destroy(intf);
+    }
+
     void callTestOutput(void) {
         dyn_interface_type *intf = NULL;
         FILE *desc = fopen("descriptors/example1.descriptor", "r");
@@ -380,7 +446,154 @@ static void stdLog(void*, int level, const char *file, int line, const char *msg
         dynInterface_destroy(intf);
     }
 
+    struct tst_notifier {
+        int count;
+        int last;
+    };
+
+    int notify(void *handle, int32_t value) {
+        struct tst_notifier *notifier = (struct tst_notifier *) handle;
+        notifier->count += 1;
+        notifier->last = value;
+        return value < 0 ? 2 : 0;
+    }
+
+    void callTestBatch(void) {
+        dyn_interface_type *intf = NULL;
+        FILE *desc = fopen("descriptors/example1.descriptor", "r");
+        CHECK(desc != NULL);
+        int rc = dynInterface_parse(desc, &intf);
+        CHECK_EQUAL(0, rc);
+        fclose(desc);
+
+        char *result = NULL;
+
+        struct tst_serv serv;
+        serv.handle = NULL;
+        serv.add = add;
+        serv.stats = stats;
+
+        rc = jsonRpc_call(intf, &serv, "[{\"m\":\"add(DD)D\", \"a\": [1.0,2.0]}, {\"m\":\"unknown\"}, {\"m\":\"stats([D)LStatsResult;\", \"a\": [[1.0,2.0]]}]", &result);
+        CHECK_EQUAL(0, rc);
+
+        json_error_t error;
+        json_t *reply = json_loads(result, 0, &error);
+        CHECK(json_is_array(reply));
+        CHECK_EQUAL(3, json_array_size(reply));
+        CHECK_EQUAL(3.0, json_real_value(json_object_get(json_array_get(reply, 0), "r")));
+        CHECK(json_is_null(json_array_get(reply, 1)));
+        CHECK_EQUAL(1.5, json_real_value(json_object_get(json_object_get(json_array_get(reply, 2), "r"), "average")));
 
+        json_decref(reply);
+        free(result);
+        dynInterface_destroy(intf);
+    }
+
+    void callTestOnewayBatch(void) {
+        dyn_interface_type *intf = NULL;
+        FILE *desc = fopen("descriptors/example5.descriptor", "r");
+        CHECK(desc != NULL);
+        int rc = dynInterface_parse(desc, &intf);
+        CHECK_EQUAL(0, rc);
+        fclose(desc);
+
+        struct methods_head *head;
+        dynInterface_methods(intf, &head);
+        struct method_entry *entry = TAILQ_FIRST(head);
+        CHECK(entry->oneway);
+
+        struct tst_notifier notifier;
+        notifier.count = 0;
+        notifier.last = 0;
+        void *serv[4] = {&notifier, (void *) notify, NULL, NULL};
+
+        char *requests[3];
+        int32_t values[3] = {1, -1, 3};
+        void *handle = NULL;
+        int i;
+        for (i = 0; i < 3; i += 1) {
+            void *args[2] = {&handle, &values[i]};
+            rc = jsonRpc_prepareInvokeRequest(entry->dynFunc, entry->id, args, &requests[i]);
+            CHECK_EQUAL(0, rc);
+        }
+
+        char *request = NULL;
+        rc = jsonRpc_prepareBatchRequest(requests, 3, &request);
+        CHECK_EQUAL(0, rc);
+
+        char *reply = NULL;
+        rc = jsonRpc_call(intf, serv, request, &reply);
+        CHECK_EQUAL(0, rc);
+        CHECK_EQUAL(3, notifier.count);
+        CHECK_EQUAL(3, notifier.last);
+
+        dyn_function_type *funcs[3] = {entry->dynFunc, entry->dynFunc, entry->dynFunc};
+        void **args[3] = {NULL, NULL, NULL};
+        int callStatus[3] = {-1, -1, -1};
+        rc = jsonRpc_handleBatchReply(funcs, reply, args, callStatus, 3);
+        CHECK_EQUAL(0, rc);
+        CHECK_EQUAL(0, callStatus[0]);
+        CHECK_EQUAL(2, callStatus[1]);
+        CHECK_EQUAL(0, callStatus[2]);
+
+        //a reply for a different nr of calls
+        rc = jsonRpc_handleBatchReply(funcs, reply, args, callStatus, 2);
+        CHECK_EQUAL(1, rc);
+
+        for (i = 0; i < 3; i += 1) {
+            free(requests[i]);
+        }
+        free(request);
+        free(reply);
+        dynInterface_destroy(intf);
+    }
+
+    void handleTestBatch(void) {
+        dyn_interface_type *intf = NULL;
+        FILE *desc = fopen("descriptors/example1.descriptor", "r");
+        CHECK(desc != NULL);
+        int rc = dynInterface_parse(desc, &intf);
+        CHECK_EQUAL(0, rc);
+        fclose(desc);
+
+        struct methods_head *head;
+        dynInterface_methods(intf, &head);
+        dyn_function_type *add = NULL;
+        dyn_function_type *stats = NULL;
+        struct method_entry *entry = NULL;
+        TAILQ_FOREACH(entry, head, entries) {
+            if (strcmp(entry->name, "add") == 0) {
+                add = entry->dynFunc;
+            } else if (strcmp(entry->name, "stats") == 0) {
+                stats = entry->dynFunc;
+            }
+        }
+
+        const char *reply = "[{\"r\":3.0},null,{\"e\":5},{\"r\":{\"input\":[1.0,2.0],\"max\":2.0,\"average\":1.5,\"min\":1.0}}]";
+
+        double sum = 0.0;
+        double *sumOut = &sum;
+        void *addArgs[4] = {NULL, NULL, NULL, &sumOut};
+        struct tst_StatsResult *result = NULL;
+        void *statsOut = &result;
+        void *statsArgs[3] = {NULL, NULL, &statsOut};
+
+        dyn_function_type *funcs[4] = {add, add, add, stats};
+        void **args[4] = {addArgs, addArgs, addArgs, statsArgs};
+        int callStatus[4];
+        rc = jsonRpc_handleBatchReply(funcs, reply, args, callStatus, 4);
+        CHECK_EQUAL(0, rc);
+        CHECK_EQUAL(0, callStatus[0]);
+        CHECK_EQUAL(-1, callStatus[1]);
+        CHECK_EQUAL(5, callStatus[2]);
+        CHECK_EQUAL(0, callStatus[3]);
+        CHECK_EQUAL(3.0, sum);
+        CHECK_EQUAL(1.5, result->average);
+
+        free(result->input.buf);
+        free(result);
+        dynInterface_destroy(intf);
+    }
 }
 
 TEST_GROUP(JsonRpcTests) {
@@ -413,6 +626,10 @@ TEST(JsonRpcTests, callPre) {
     callTestPreAllocated();
 }
 
+TEST(JsonRpcTests, callTraced) {
+    callTestTraced();
+}
+
 TEST(JsonRpcTests, callOut) {
     callTestOutput();
 }
@@ -431,3 +648,15 @@ TEST(JsonRpcTests, handleOutChar) {
     handleTestOutChar();
 }
 
+TEST(JsonRpcTests, callBatch) {
+    callTestBatch();
+}
+
+TEST(JsonRpcTests, callOnewayBatch) {
+    callTestOnewayBatch();
+}
+
+TEST(JsonRpcTests, handleBatch) {
+    handleTestBatch();
+}
+
@@ -0,0 +1,44 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+#ifndef __BINARY_RPC_H_
+#define __BINARY_RPC_H_
+
+#include <stddef.h>
+#include "dfi_log_util.h"
+#include "dyn_type.h"
+#include "dyn_function.h"
+#include "dyn_interface.h"
+
+/*
+ * Remote calls with the binary serializer instead of json. The request is the method id (16 bit length and
+ * characters) followed by the standard arguments. When the caller is traced (celix_trace.h) the high bit of the
+ * length is set and the trace and span id (64 bit each) follow the method id. The reply starts with a status byte,
+ * followed by the output arguments when the call succeeded or by the 32 bit error code of the function.
+ */
+
+//logging
+DFI_SETUP_LOG_HEADER(binaryRpc);
+
+int binaryRpc_call(dyn_interface_type *intf, void *service, const void *request, size_t requestSize, void **out, size_t *outSize);
+
+int binaryRpc_prepareInvokeRequest(dyn_function_type *func, const char *id, void *args[], void **out, size_t *outSize);
+/* callStatus is set to the return value of the remote function */
+int binaryRpc_handleReply(dyn_function_type *func, const void *reply, size_t replySize, void *args[], int *callStatus);
+
+#endif
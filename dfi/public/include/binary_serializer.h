@@ -0,0 +1,44 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+#ifndef __BINARY_SERIALIZER_H_
+#define __BINARY_SERIALIZER_H_
+
+#include <stdio.h>
+#include "dfi_log_util.h"
+#include "dyn_type.h"
+
+/*
+ * Compact binary encoding of dyn_type values. Values are written in the order of the type, without names:
+ * simple types as little endian fixed size values (N as 32 bit), text as a 32 bit length followed by the characters
+ * (0xffffffff for NULL), sequences as a 32 bit length followed by the items, complex types as their members and typed
+ * pointers as a one byte present flag followed by the value. Both sides need the same type to read a value.
+ */
+
+//logging
+DFI_SETUP_LOG_HEADER(binarySerializer);
+
+int binarySerializer_deserialize(dyn_type *type, const void *input, size_t inputSize, void **result);
+int binarySerializer_serialize(dyn_type *type, const void *input, void **output, size_t *outputSize);
+
+/* Reads one value at offset and moves offset past it, to read several values from one message */
+int binarySerializer_read(dyn_type *type, const void *input, size_t inputSize, size_t *offset, void **result);
+/* Appends one value to the stream, to write several values into one message */
+int binarySerializer_write(dyn_type *type, const void *input, FILE *stream);
+
+#endif
@@ -38,6 +38,9 @@ DFI_SETUP_LOG_HEADER(dynInterface);
  * ':types\n' [TypeIdValue]*
  * ':methods\n' [MethodIdValue]
  *
+ * The 'oneway' annotation lists the ids, separated by a ',', of the methods without output arguments that do not
+ * need a reply. Remote callers can queue these calls and send them in batches.
+ *
  */
 typedef struct _dyn_interface_type dyn_interface_type;
 
@@ -47,6 +50,7 @@ struct method_entry {
     char *id;
     char *name;
     dyn_function_type *dynFunc;
+    bool oneway;
 
     TAILQ_ENTRY(method_entry) entries; 
 };
@@ -31,7 +31,19 @@ DFI_SETUP_LOG_HEADER(jsonRpc);
 int jsonRpc_call(dyn_interface_type *intf, void *service, const char *request, char **out);
 
 
+/*
+ * An invoke request is a json object with the method id ("m") and the arguments ("a"). When the caller is traced
+ * (celix_trace.h) the trace and span id are added as "t": "<hex trace id>-<hex span id>".
+ */
 int jsonRpc_prepareInvokeRequest(dyn_function_type *func, const char *id, void *args[], char **out);
 int jsonRpc_handleReply(dyn_function_type *func, const char *reply, void *args[]);
 
+/*
+ * A batch request is a json array of invoke requests, jsonRpc_call replies with an array with the reply of every call.
+ * The calls are invoked in order, a call the service cannot invoke gets a null reply.
+ */
+int jsonRpc_prepareBatchRequest(char *requests[], size_t nrOfRequests, char **out);
+/* callStatus is set to the return value of every remote function, -1 when the call could not be invoked */
+int jsonRpc_handleBatchReply(dyn_function_type *funcs[], const char *reply, void **args[], int callStatus[], size_t nrOfCalls);
+
 #endif
@@ -20,6 +20,7 @@
 #include <stdio.h>
 #include <stdbool.h>
 #include <string.h>
+#include <pthread.h>
 #include <curl/curl.h>
 #include <jansson.h>
 
@@ -37,6 +38,7 @@
 #define MAX_OVERHEAD_LENGTH           64
 #define DEFAULT_CURL_TIMEOUT          10
 #define DEFAULT_CURL_CONECTTIMEOUT    10
+#define MAX_IDLE_CURL_HANDLES         8
 
 typedef enum {
 	GET, PUT, DELETE
@@ -45,6 +47,14 @@ typedef enum {
 static const char* etcd_server;
 static int etcd_port = 0;
 
+/*
+ * Idle curl handles. A curl handle keeps its connection to etcd open after a request,
+ * reusing the handles avoids a new tcp connection for every request.
+ */
+static pthread_mutex_t etcd_handlesLock = PTHREAD_MUTEX_INITIALIZER;
+static CURL* etcd_idleHandles[MAX_IDLE_CURL_HANDLES];
+static int etcd_nrOfIdleHandles = 0;
+
 struct MemoryStruct {
 	char *memory;
 	size_t size;
@@ -55,6 +65,9 @@ struct MemoryStruct {
  * Static function declarations
  */
 static int performRequest(char* url, request_t request, void* callback, void* reqData, void* repData);
+static int etcd_put(const char* key, const char* request);
+static CURL* etcd_takeHandle(void);
+static void etcd_releaseHandle(CURL* curl);
 static size_t WriteMemoryCallback(void *contents, size_t size, size_t nmemb, void *userp);
 /**
  * External function definition
@@ -291,6 +304,88 @@ int etcd_set(const char* key, const char* value, int ttl, bool prevExist) {
 }
 
 
+/**
+ * etcd_refresh
+ */
+int etcd_refresh(const char* key, int ttl) {
+	char request[MAX_OVERHEAD_LENGTH];
+
+	snprintf(request, MAX_OVERHEAD_LENGTH, "ttl=%d&refresh=true&prevExist=true", ttl);
+
+	return etcd_put(key, request);
+}
+
+
+/**
+ * etcd_set_directory
+ */
+int etcd_set_directory(const char* directory, int ttl) {
+	char request[MAX_OVERHEAD_LENGTH];
+
+	if (ttl > 0) {
+		snprintf(request, MAX_OVERHEAD_LENGTH, "dir=true&ttl=%d", ttl);
+	} else {
+		snprintf(request, MAX_OVERHEAD_LENGTH, "dir=true");
+	}
+
+	return etcd_put(directory, request);
+}
+
+
+/**
+ * etcd_refresh_directory
+ */
+int etcd_refresh_directory(const char* directory, int ttl) {
+	char request[MAX_OVERHEAD_LENGTH];
+
+	snprintf(request, MAX_OVERHEAD_LENGTH, "dir=true&ttl=%d&refresh=true&prevExist=true", ttl);
+
+	return etcd_put(directory, request);
+}
+
+
+/*
+ * PUT without a value, succeeds if etcd returns the node
+ */
+static int etcd_put(const char* key, const char* request) {
+	json_error_t error;
+	json_t* js_root = NULL;
+	int retVal = -1;
+	char *url = NULL;
+	int res;
+	struct MemoryStruct reply;
+
+	/* Skip leading '/', etcd cannot handle this. */
+	while(*key == '/') {
+		key++;
+	}
+
+	reply.memory = calloc(1, 1); /* will be grown as needed by the realloc above */
+	reply.size = 0; /* no data at this point */
+
+	asprintf(&url, "http://%s:%d/v2/keys/%s", etcd_server, etcd_port, key);
+	res = performRequest(url, PUT, WriteMemoryCallback, (void*) request, (void*) &reply);
+	free(url);
+
+	if (res == CURLE_OK) {
+		js_root = json_loads(reply.memory, 0, &error);
+
+		if (js_root != NULL) {
+			if (json_object_get(js_root, ETCD_JSON_NODE) != NULL) {
+				retVal = 0;
+			}
+			json_decref(js_root);
+		}
+	}
+
+	if (reply.memory) {
+		free(reply.memory);
+	}
+
+	return retVal;
+}
+
+
 /**
  * etcd_set_with_check
  */
@@ -344,7 +439,10 @@ int etcd_watch(const char* key, long long index, char** action, char** prevValue
 	res = performRequest(url, GET, WriteMemoryCallback, NULL, (void*) &reply);
 	if(url)
 		free(url);
-	if (res == CURLE_OK) {
+	if (res == CURLE_OPERATION_TIMEDOUT) {
+		/* nothing changed within the timeout, not an error */
+		retVal = ETCDLIB_RC_TIMEOUT;
+	} else if (res == CURLE_OK) {
 		js_root = json_loads(reply.memory, 0, &error);
 
 		if (js_root != NULL) {
@@ -461,7 +559,10 @@ static size_t WriteMemoryCallback(void *contents, size_t size, size_t nmemb, voi
 static int performRequest(char* url, request_t request, void* callback, void* reqData, void* repData) {
 	CURL *curl = NULL;
 	CURLcode res = 0;
-	curl = curl_easy_init();
+	curl = etcd_takeHandle();
+	if (curl == NULL) {
+		return CURLE_FAILED_INIT;
+	}
 	curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1);
 	curl_easy_setopt(curl, CURLOPT_TIMEOUT, DEFAULT_CURL_TIMEOUT);
 	curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, DEFAULT_CURL_CONECTTIMEOUT);
@@ -481,7 +582,52 @@ static int performRequest(char* url, request_t request, void* callback, void* re
 	}
 
 	res = curl_easy_perform(curl);
-	curl_easy_cleanup(curl);
+	etcd_releaseHandle(curl);
 
 	return res;
 }
+
+/*
+ * Takes an idle curl handle, the options of the handle are reset but its connection is kept.
+ */
+static CURL* etcd_takeHandle(void) {
+	CURL *curl = NULL;
+
+	pthread_mutex_lock(&etcd_handlesLock);
+	if (etcd_nrOfIdleHandles > 0) {
+		curl = etcd_idleHandles[--etcd_nrOfIdleHandles];
+	}
+	pthread_mutex_unlock(&etcd_handlesLock);
+
+	if (curl != NULL) {
+		curl_easy_reset(curl);
+	} else {
+		curl = curl_easy_init();
+	}
+
+	return curl;
+}
+
+static void etcd_releaseHandle(CURL* curl) {
+	pthread_mutex_lock(&etcd_handlesLock);
+	if (etcd_nrOfIdleHandles < MAX_IDLE_CURL_HANDLES) {
+		etcd_idleHandles[etcd_nrOfIdleHandles++] = curl;
+		curl = NULL;
+	}
+	pthread_mutex_unlock(&etcd_handlesLock);
+
+	if (curl != NULL) {
+		curl_easy_cleanup(curl);
+	}
+}
+
+/**
+ * etcd_cleanup
+ */
+void etcd_cleanup(void) {
+	pthread_mutex_lock(&etcd_handlesLock);
+	while (etcd_nrOfIdleHandles > 0) {
+		curl_easy_cleanup(etcd_idleHandles[--etcd_nrOfIdleHandles]);
+	}
+	pthread_mutex_unlock(&etcd_handlesLock);
+}
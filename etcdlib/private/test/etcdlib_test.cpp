@@ -0,0 +1,525 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+/*
+ * etcdlib_test.cpp
+ *
+ * Tests etcdlib against a fake etcd: a civetweb server which implements the part of the etcd v2 keys api used by
+ * etcdlib. Keys and directories can have a ttl, which is extended by a refresh without notifying the watchers, and
+ * an expired directory is removed with its keys and reported to the watchers as an expire. A watcher thread follows
+ * the root directory while the tests create, refresh and let expire the directory of a framework and a single key,
+ * like the discovery bundles do with their registrations. Every test starts its own fake etcd and watcher.
+ *
+ *  \author    	<a href="mailto:dev@celix.apache.org">Apache Celix Project Team</a>
+ *  \copyright	Apache License, Version 2.0
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/TestHarness_c.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include "civetweb.h"
+extern "C"
+{
+#include "etcd.h"
+}
+
+int main(int argc, char** argv) {
+	return RUN_ALL_TESTS(argc, argv);
+}
+
+#define FAKE_ETCD_PORT "9979"
+#define FAKE_ETCD_MAX_NODES 64
+#define FAKE_ETCD_MAX_EVENTS 256
+#define FAKE_ETCD_MAX_CONNECTIONS 64
+#define FAKE_ETCD_KEYS_PATH "/v2/keys"
+
+#define TEST_TTL 2
+#define TEST_MAX_EVENTS 16
+
+struct fake_node {
+	bool used;
+	bool dir;
+	char key[256];
+	char value[256];
+	long long expires; //monotonic time in ms, 0 when the node has no ttl
+	long long modifiedIndex;
+};
+
+struct fake_event {
+	char action[16];
+	char key[256];
+	char value[256];
+	long long modifiedIndex;
+};
+
+struct fake_etcd {
+	pthread_mutex_t lock;
+	pthread_cond_t changed;
+	struct mg_context *ctx;
+	bool stopping;
+
+	long long index;
+	struct fake_node nodes[FAKE_ETCD_MAX_NODES];
+	struct fake_event events[FAKE_ETCD_MAX_EVENTS];
+	int nrOfEvents;
+
+	int ports[FAKE_ETCD_MAX_CONNECTIONS]; //remote port per connection seen
+	int nrOfConnections;
+	int nrOfRequests;
+};
+
+struct test_watcher {
+	volatile bool running;
+	long long index;
+	pthread_mutex_t lock;
+	char events[TEST_MAX_EVENTS][300];
+	int nrOfEvents;
+};
+
+static long long fakeEtcd_now(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000LL + now.tv_nsec / 1000000;
+}
+
+static bool fakeEtcd_isWithin(const char *key, const char *dir) {
+	size_t len = strlen(dir);
+	return strncmp(key, dir, len) == 0 && (key[len] == '\0' || key[len] == '/');
+}
+
+static struct fake_node *fakeEtcd_find(struct fake_etcd *etcd, const char *key) {
+	for (int i = 0; i < FAKE_ETCD_MAX_NODES; ++i) {
+		if (etcd->nodes[i].used && strcmp(etcd->nodes[i].key, key) == 0) {
+			return &etcd->nodes[i];
+		}
+	}
+	return NULL;
+}
+
+static void fakeEtcd_addEvent(struct fake_etcd *etcd, const char *action, struct fake_node *node) {
+	if (etcd->nrOfEvents < FAKE_ETCD_MAX_EVENTS) {
+		struct fake_event *event = &etcd->events[etcd->nrOfEvents++];
+		snprintf(event->action, sizeof(event->action), "%s", action);
+		snprintf(event->key, sizeof(event->key), "%s", node->key);
+		snprintf(event->value, sizeof(event->value), "%s", node->value);
+		event->modifiedIndex = etcd->index;
+	}
+	pthread_cond_broadcast(&etcd->changed);
+}
+
+/* removes the node and everything below it, should be called with the lock taken */
+static void fakeEtcd_remove(struct fake_etcd *etcd, struct fake_node *node, const char *action) {
+	char key[256];
+
+	snprintf(key, sizeof(key), "%s", node->key);
+	etcd->index++;
+	fakeEtcd_addEvent(etcd, action, node);
+	for (int i = 0; i < FAKE_ETCD_MAX_NODES; ++i) {
+		if (etcd->nodes[i].used && fakeEtcd_isWithin(etcd->nodes[i].key, key)) {
+			etcd->nodes[i].used = false;
+		}
+	}
+}
+
+/* removes the nodes whose ttl has passed, should be called with the lock taken */
+static void fakeEtcd_expire(struct fake_etcd *etcd) {
+	long long now = fakeEtcd_now();
+	for (int i = 0; i < FAKE_ETCD_MAX_NODES; ++i) {
+		if (etcd->nodes[i].used && etcd->nodes[i].expires != 0 && etcd->nodes[i].expires <= now) {
+			fakeEtcd_remove(etcd, &etcd->nodes[i], ETCDLIB_ACTION_EXPIRE);
+		}
+	}
+}
+
+static int fakeEtcd_writeNode(char *buf, size_t size, struct fake_node *node) {
+	if (node->dir) {
+		return snprintf(buf, size, "{\"key\":\"%s\",\"dir\":true,\"modifiedIndex\":%lld}", node->key, node->modifiedIndex);
+	}
+	return snprintf(buf, size, "{\"key\":\"%s\",\"value\":\"%s\",\"modifiedIndex\":%lld}", node->key, node->value, node->modifiedIndex);
+}
+
+/* gets a form or query parameter, etcdlib separates them with '&' or ';' */
+static bool fakeEtcd_getParameter(const char *params, const char *name, char *value, size_t size) {
+	size_t len = strlen(name);
+	const char *p = params;
+
+	while (p != NULL && *p != '\0') {
+		if (strncmp(p, name, len) == 0 && p[len] == '=') {
+			size_t valueLen = strcspn(p + len + 1, "&;");
+			snprintf(value, size, "%.*s", (int) valueLen, p + len + 1);
+			return true;
+		}
+		p += strcspn(p, "&;");
+		if (*p != '\0') {
+			p++;
+		}
+	}
+	return false;
+}
+
+static int fakeEtcd_watch(struct fake_etcd *etcd, const char *key, const char *query, char *reply, size_t size) {
+	char value[32];
+	long long waitIndex = etcd->index + 1;
+
+	if (fakeEtcd_getParameter(query, "waitIndex", value, sizeof(value))) {
+		waitIndex = atoll(value);
+	}
+
+	while (!etcd->stopping) {
+		for (int i = 0; i < etcd->nrOfEvents; ++i) {
+			struct fake_event *event = &etcd->events[i];
+			if (event->modifiedIndex >= waitIndex && fakeEtcd_isWithin(event->key, key)) {
+				snprintf(reply, size, "{\"action\":\"%s\",\"node\":{\"key\":\"%s\",\"value\":\"%s\",\"modifiedIndex\":%lld}}",
+						event->action, event->key, event->value, event->modifiedIndex);
+				return 200;
+			}
+		}
+
+		struct timespec timeout;
+		clock_gettime(CLOCK_REALTIME, &timeout);
+		timeout.tv_nsec += 100000000;
+		if (timeout.tv_nsec >= 1000000000) {
+			timeout.tv_sec++;
+			timeout.tv_nsec -= 1000000000;
+		}
+		pthread_cond_timedwait(&etcd->changed, &etcd->lock, &timeout);
+		fakeEtcd_expire(etcd);
+	}
+
+	reply[0] = '\0';
+	return 503;
+}
+
+static int fakeEtcd_get(struct fake_etcd *etcd, struct fake_node *node, char *reply, size_t size) {
+	int len = snprintf(reply, size, "{\"action\":\"get\",\"node\":");
+
+	if (node->dir) {
+		bool first = true;
+
+		len += snprintf(reply + len, size - len, "{\"key\":\"%s\",\"dir\":true,\"modifiedIndex\":%lld,\"nodes\":[", node->key, node->modifiedIndex);
+		for (int i = 0; i < FAKE_ETCD_MAX_NODES; ++i) {
+			struct fake_node *child = &etcd->nodes[i];
+			if (child->used && child != node && fakeEtcd_isWithin(child->key, node->key)) {
+				len += snprintf(reply + len, size - len, "%s", first ? "" : ",");
+				len += fakeEtcd_writeNode(reply + len, size - len, child);
+				first = false;
+			}
+		}
+		len += snprintf(reply + len, size - len, "]}");
+	} else {
+		len += fakeEtcd_writeNode(reply + len, size - len, node);
+	}
+	snprintf(reply + len, size - len, "}");
+
+	return 200;
+}
+
+static int fakeEtcd_put(struct fake_etcd *etcd, const char *key, const char *form, char *reply, size_t size) {
+	struct fake_node *node = fakeEtcd_find(etcd, key);
+	char value[256] = "";
+	char ttl[16] = "";
+	char flag[16];
+	int len;
+
+	fakeEtcd_getParameter(form, "ttl", ttl, sizeof(ttl));
+	if (fakeEtcd_getParameter(form, "prevExist", flag, sizeof(flag)) && strcmp(flag, "true") == 0 && node == NULL) {
+		snprintf(reply, size, "{\"errorCode\":100,\"message\":\"Key not found\",\"cause\":\"%s\",\"index\":%lld}", key, etcd->index);
+		return 404;
+	}
+
+	if (fakeEtcd_getParameter(form, "refresh", flag, sizeof(flag)) && strcmp(flag, "true") == 0) {
+		// a refresh only extends the ttl, the watchers are not notified
+		node->expires = atoi(ttl) > 0 ? fakeEtcd_now() + atoi(ttl) * 1000LL : 0;
+		len = snprintf(reply, size, "{\"action\":\"update\",\"node\":");
+	} else {
+		if (node == NULL) {
+			for (int i = 0; i < FAKE_ETCD_MAX_NODES && node == NULL; ++i) {
+				if (!etcd->nodes[i].used) {
+					node = &etcd->nodes[i];
+					memset(node, 0, sizeof(*node));
+					node->used = true;
+					snprintf(node->key, sizeof(node->key), "%s", key);
+				}
+			}
+		}
+		node->dir = fakeEtcd_getParameter(form, "dir", flag, sizeof(flag)) && strcmp(flag, "true") == 0;
+		fakeEtcd_getParameter(form, "value", value, sizeof(value));
+		snprintf(node->value, sizeof(node->value), "%s", value);
+		node->expires = atoi(ttl) > 0 ? fakeEtcd_now() + atoi(ttl) * 1000LL : 0;
+		node->modifiedIndex = ++etcd->index;
+		fakeEtcd_addEvent(etcd, ETCDLIB_ACTION_SET, node);
+		len = snprintf(reply, size, "{\"action\":\"set\",\"node\":");
+	}
+
+	len += fakeEtcd_writeNode(reply + len, size - len, node);
+	snprintf(reply + len, size - len, "}");
+	return 200;
+}
+
+static int fakeEtcd_handleRequest(struct mg_connection *conn) {
+	const struct mg_request_info *request = mg_get_request_info(conn);
+	struct fake_etcd *etcd = (struct fake_etcd *) request->user_data;
+	const char *query = request->query_string != NULL ? request->query_string : "";
+	const char *key = request->uri + strlen(FAKE_ETCD_KEYS_PATH);
+	char form[1024] = "";
+	char reply[8192];
+	char flag[16];
+	int code = 404;
+	bool known = false;
+	long long index;
+
+	if (strncmp(request->uri, FAKE_ETCD_KEYS_PATH "/", strlen(FAKE_ETCD_KEYS_PATH) + 1) != 0) {
+		return 0;
+	}
+	if (strcmp(request->request_method, "PUT") == 0) {
+		int len = mg_read(conn, form, sizeof(form) - 1);
+		form[len > 0 ? len : 0] = '\0';
+	}
+
+	pthread_mutex_lock(&etcd->lock);
+	etcd->nrOfRequests++;
+	for (int i = 0; i < etcd->nrOfConnections; ++i) {
+		known |= etcd->ports[i] == request->remote_port;
+	}
+	if (!known && etcd->nrOfConnections < FAKE_ETCD_MAX_CONNECTIONS) {
+		etcd->ports[etcd->nrOfConnections++] = request->remote_port;
+	}
+
+	fakeEtcd_expire(etcd);
+	struct fake_node *node = fakeEtcd_find(etcd, key);
+	snprintf(reply, sizeof(reply), "{\"errorCode\":100,\"message\":\"Key not found\",\"cause\":\"%s\",\"index\":%lld}", key, etcd->index);
+
+	if (strcmp(request->request_method, "GET") == 0 && fakeEtcd_getParameter(query, "wait", flag, sizeof(flag))) {
+		code = fakeEtcd_watch(etcd, key, query, reply, sizeof(reply));
+	} else if (strcmp(request->request_method, "GET") == 0 && node != NULL) {
+		code = fakeEtcd_get(etcd, node, reply, sizeof(reply));
+	} else if (strcmp(request->request_method, "PUT") == 0) {
+		code = fakeEtcd_put(etcd, key, form, reply, sizeof(reply));
+	} else if (strcmp(request->request_method, "DELETE") == 0 && node != NULL) {
+		int len = snprintf(reply, sizeof(reply), "{\"action\":\"delete\",\"node\":");
+		len += fakeEtcd_writeNode(reply + len, sizeof(reply) - len, node);
+		snprintf(reply + len, sizeof(reply) - len, "}");
+		fakeEtcd_remove(etcd, node, ETCDLIB_ACTION_DELETE);
+		code = 200;
+	}
+	index = etcd->index;
+	pthread_mutex_unlock(&etcd->lock);
+
+	mg_printf(conn, "HTTP/1.1 %d %s\r\nContent-Type: application/json\r\nX-Etcd-Index: %lld\r\nContent-Length: %zu\r\n\r\n%s",
+			code, code == 200 ? "OK" : "Error", index, strlen(reply), reply);
+	return 1;
+}
+
+static void *watchRoot(void *data) {
+	struct test_watcher *watcher = (struct test_watcher *) data;
+
+	while (watcher->running) {
+		char *action = NULL;
+		char *key = NULL;
+		long long modifiedIndex = 0;
+
+		int rc = etcd_watch("celix", watcher->index, &action, NULL, NULL, &key, &modifiedIndex);
+		if (rc == ETCDLIB_RC_OK && action != NULL && key != NULL) {
+			pthread_mutex_lock(&watcher->lock);
+			if (watcher->nrOfEvents < TEST_MAX_EVENTS) {
+				snprintf(watcher->events[watcher->nrOfEvents++], sizeof(watcher->events[0]), "%s %s", action, key);
+			}
+			pthread_mutex_unlock(&watcher->lock);
+			watcher->index = modifiedIndex + 1;
+		} else if (rc == ETCDLIB_RC_ERROR && watcher->running) {
+			usleep(100000);
+		}
+		free(action);
+		free(key);
+	}
+
+	return NULL;
+}
+
+static void countKey(const char *key, const char *value, void *arg) {
+	(*(int *) arg)++;
+}
+
+static int watchedEvents(struct test_watcher *watcher, int index, const char *expected) {
+	int nrOfEvents;
+
+	pthread_mutex_lock(&watcher->lock);
+	nrOfEvents = watcher->nrOfEvents;
+	if (expected != NULL && (index >= nrOfEvents || strcmp(watcher->events[index], expected) != 0)) {
+		nrOfEvents = -1;
+	}
+	pthread_mutex_unlock(&watcher->lock);
+
+	return nrOfEvents;
+}
+
+TEST_GROUP(etcdlib) {
+	struct fake_etcd *etcd;
+	struct test_watcher watcher;
+	pthread_t watcherThread;
+
+	void setup() {
+		const char *options[] = {
+				"listening_ports", FAKE_ETCD_PORT,
+				"num_threads", "4",
+				"enable_keep_alive", "yes",
+				NULL
+		};
+		struct mg_callbacks callbacks;
+
+		memset(&callbacks, 0, sizeof(callbacks));
+		callbacks.begin_request = fakeEtcd_handleRequest;
+		etcd = (struct fake_etcd *) calloc(1, sizeof(*etcd));
+		pthread_mutex_init(&etcd->lock, NULL);
+		pthread_cond_init(&etcd->changed, NULL);
+		etcd->ctx = mg_start(&callbacks, etcd, options);
+		CHECK(etcd->ctx != NULL);
+		etcd_init("127.0.0.1", atoi(FAKE_ETCD_PORT), 0);
+
+		memset(&watcher, 0, sizeof(watcher));
+		pthread_mutex_init(&watcher.lock, NULL);
+	}
+
+	void teardown() {
+		pthread_mutex_lock(&etcd->lock);
+		etcd->stopping = true;
+		pthread_cond_broadcast(&etcd->changed);
+		pthread_mutex_unlock(&etcd->lock);
+
+		if (watcher.running) {
+			watcher.running = false;
+			pthread_join(watcherThread, NULL);
+		}
+		etcd_cleanup();
+		if (etcd->ctx != NULL) {
+			mg_stop(etcd->ctx);
+		}
+		pthread_cond_destroy(&etcd->changed);
+		pthread_mutex_destroy(&etcd->lock);
+		pthread_mutex_destroy(&watcher.lock);
+		free(etcd);
+	}
+
+	/* creates the directory of a framework with a ttl and two keys without, returns its modified index */
+	long long createDirectory() {
+		long long modifiedIndex = 0;
+		int nrOfKeys = 0;
+
+		LONGS_EQUAL(0, etcd_set_directory("celix/fw1", TEST_TTL));
+		LONGS_EQUAL(0, etcd_set("celix/fw1/pub1", "v1", 0, false));
+		LONGS_EQUAL(0, etcd_set("celix/fw1/pub2", "v2", 0, false));
+		LONGS_EQUAL(0, etcd_get_directory("celix/fw1", countKey, &nrOfKeys, &modifiedIndex));
+		LONGS_EQUAL(2, nrOfKeys);
+		return modifiedIndex;
+	}
+
+	/* follows the changes below the root directory after index */
+	void startWatcher(long long index) {
+		watcher.running = true;
+		watcher.index = index + 1;
+		pthread_create(&watcherThread, NULL, watchRoot, &watcher);
+	}
+
+	/* keeps the directory alive with refreshes for twice its ttl */
+	void refreshDirectory() {
+		for (int i = 0; i < 2 * TEST_TTL; ++i) {
+			sleep(1);
+			LONGS_EQUAL(0, etcd_refresh_directory("celix/fw1", TEST_TTL));
+		}
+	}
+};
+
+TEST(etcdlib, directoryWithTtlAndKeysIsCreated) {
+	char *value = NULL;
+
+	CHECK(createDirectory() > 0);
+	LONGS_EQUAL(0, etcd_get("celix/fw1/pub2", &value, NULL));
+	STRCMP_EQUAL("v2", value);
+	free(value);
+}
+
+TEST(etcdlib, refreshedDirectoryKeepsKeysWithoutNotifyingWatchers) {
+	char *value = NULL;
+
+	startWatcher(createDirectory());
+	refreshDirectory();
+
+	LONGS_EQUAL(0, etcd_get("celix/fw1/pub1", &value, NULL));
+	STRCMP_EQUAL("v1", value);
+	free(value);
+	LONGS_EQUAL(0, watchedEvents(&watcher, 0, NULL));
+}
+
+TEST(etcdlib, expiredDirectoryRemovesKeysAndNotifiesWatchers) {
+	char *value = NULL;
+
+	startWatcher(createDirectory());
+	refreshDirectory();
+	sleep(TEST_TTL + 1);
+
+	CHECK(etcd_get("celix/fw1/pub1", &value, NULL) != 0);
+	free(value);
+	CHECK(etcd_refresh_directory("celix/fw1", TEST_TTL) != 0);
+	LONGS_EQUAL(1, watchedEvents(&watcher, 0, "expire /celix/fw1"));
+}
+
+TEST(etcdlib, refreshedKeyKeepsValueWithoutNotifyingWatchers) {
+	char *value = NULL;
+
+	startWatcher(0);
+	LONGS_EQUAL(0, etcd_set("celix/fw2", "http://fw2", TEST_TTL, false));
+	for (int i = 0; i < 2 * TEST_TTL; ++i) {
+		sleep(1);
+		LONGS_EQUAL(0, etcd_refresh("celix/fw2", TEST_TTL));
+	}
+	LONGS_EQUAL(0, etcd_get("celix/fw2", &value, NULL));
+	STRCMP_EQUAL("http://fw2", value);
+	free(value);
+
+	LONGS_EQUAL(0, etcd_del("celix/fw2"));
+	usleep(200000);
+	LONGS_EQUAL(2, watchedEvents(&watcher, 0, "set /celix/fw2"));
+	LONGS_EQUAL(2, watchedEvents(&watcher, 1, "delete /celix/fw2"));
+}
+
+TEST(etcdlib, requestsReuseConnections) {
+	char *value = NULL;
+
+	createDirectory();
+	for (int i = 0; i < 10; ++i) {
+		LONGS_EQUAL(0, etcd_refresh_directory("celix/fw1", TEST_TTL));
+		LONGS_EQUAL(0, etcd_get("celix/fw1/pub1", &value, NULL));
+		free(value);
+		value = NULL;
+	}
+
+	pthread_mutex_lock(&etcd->lock);
+	int nrOfRequests = etcd->nrOfRequests;
+	int nrOfConnections = etcd->nrOfConnections;
+	pthread_mutex_unlock(&etcd->lock);
+	LONGS_EQUAL(24, nrOfRequests);
+	LONGS_EQUAL(1, nrOfConnections);
+}
@@ -37,6 +37,10 @@
 #define ETCDLIB_ACTION_DELETE   "delete"
 #define ETCDLIB_ACTION_EXPIRE   "expire"
 
+#define ETCDLIB_RC_OK           0
+#define ETCDLIB_RC_ERROR        -1
+#define ETCDLIB_RC_TIMEOUT      1
+
 typedef void (*etcd_key_value_callback) (const char *key, const char *value, void* arg);
 
 /**
@@ -77,6 +81,31 @@ int etcd_get_directory(const char* directory, etcd_key_value_callback callback,
  */
 int etcd_set(const char* key, const char* value, int ttl, bool prevExist);
 
+/**
+ * @desc Refreshes the TTL of an existing Etcd-key without changing the value. Watchers are not notified.
+ * @param const char* key. The Etcd-key (Note: a leading '/' should be avoided)
+ * @param int ttl. The new TTL value
+ * @return 0 on success, non zero otherwise (e.g. when the key does not exist anymore)
+ */
+int etcd_refresh(const char* key, int ttl);
+
+/**
+ * @desc Creates an Etcd-directory. If a TTL is given, the directory and all keys within expire together,
+ * so the keys can be kept alive with a single etcd_refresh_directory call.
+ * @param const char* directory. The Etcd-directory (Note: a leading '/' should be avoided)
+ * @param int ttl. If non-zero this is used as the TTL value
+ * @return 0 on success, non zero otherwise
+ */
+int etcd_set_directory(const char* directory, int ttl);
+
+/**
+ * @desc Refreshes the TTL of an existing Etcd-directory. Watchers are not notified.
+ * @param const char* directory. The Etcd-directory (Note: a leading '/' should be avoided)
+ * @param int ttl. The new TTL value
+ * @return 0 on success, non zero otherwise (e.g. when the directory does not exist anymore)
+ */
+int etcd_refresh_directory(const char* directory, int ttl);
+
 /**
  * @desc Setting an Etcd-key/value and checks if there is a different previuos value
  * @param const char* key. The Etcd-key (Note: a leading '/' should be avoided)
@@ -103,8 +132,13 @@ int etcd_del(const char* key);
  * @param char** value. If not NULL, memory is allocated and contains the new value. The caller is responsible of freeing the memory.
  * @param char** rkey. If not NULL, memory is allocated and contains the updated key. The caller is responsible of freeing the memory.
  * @param long long* modifiedIndex. If not NULL, the index of the modification is written.
- * @return 0 on success, non zero otherwise
+ * @return 0 on success, ETCDLIB_RC_TIMEOUT if nothing changed within the request timeout, ETCDLIB_RC_ERROR otherwise
  */
 int etcd_watch(const char* key, long long index, char** action, char** prevValue, char** value, char** rkey, long long* modifiedIndex);
 
+/**
+ * @desc Closes the connections kept open for reuse. Can be called when etcdlib is not used for a while.
+ */
+void etcd_cleanup(void);
+
 #endif /*ETCDLIB_H_ */
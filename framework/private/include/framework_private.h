@@ -44,8 +44,11 @@
 #include "bundle_context.h"
 #include "bundle_cache.h"
 #include "celix_log.h"
+#include "metrics_service.h"
 
 #include "celix_threads.h"
+#include "celix_metrics.h"
+#include "celix_trace.h"
 
 struct framework {
 #ifdef WITH_APR
@@ -88,6 +91,12 @@ struct framework {
     celix_thread_t shutdownThread;
 
     framework_logger_pt logger;
+
+    struct metrics_service metricsService;
+    service_registration_pt metricsRegistration;
+    celix_metric_pt serviceEventsMetric;
+    celix_metric_pt listenerCallsMetric;
+    celix_metric_pt serviceChangedMetric;
 };
 
 celix_status_t framework_start(framework_pt framework);
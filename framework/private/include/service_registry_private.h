@@ -30,6 +30,7 @@
 
 #include "registry_callback_private.h"
 #include "service_registry.h"
+#include "celix_metrics.h"
 
 struct serviceRegistry {
 	framework_pt framework;
@@ -47,6 +48,8 @@ struct serviceRegistry {
 	array_list_pt listenerHooks;
 
 	celix_thread_rwlock_t lock;
+
+	celix_metric_pt getServiceMetric;
 };
 
 typedef enum reference_status_enum {
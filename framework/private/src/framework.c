@@ -94,6 +94,11 @@ static celix_status_t frameworkActivator_start(void * userData, bundle_context_p
 static celix_status_t frameworkActivator_stop(void * userData, bundle_context_pt context);
 static celix_status_t frameworkActivator_destroy(void * userData, bundle_context_pt context);
 
+static celix_status_t framework_metricsSetEnabled(void *handle, bool enabled);
+static celix_status_t framework_metricsIsEnabled(void *handle, bool *enabled);
+static celix_status_t framework_metricsReset(void *handle);
+static celix_status_t framework_metricsDump(void *handle, FILE *out);
+
 
 struct fw_refreshHelper {
     framework_pt framework;
@@ -234,6 +239,16 @@ celix_status_t framework_create(framework_pt *framework, properties_pt config) {
             (*framework)->configurationMap = config;
             (*framework)->logger = logger;
 
+            (*framework)->metricsService.handle = *framework;
+            (*framework)->metricsService.setEnabled = framework_metricsSetEnabled;
+            (*framework)->metricsService.isEnabled = framework_metricsIsEnabled;
+            (*framework)->metricsService.reset = framework_metricsReset;
+            (*framework)->metricsService.dump = framework_metricsDump;
+            (*framework)->metricsRegistration = NULL;
+            celixMetrics_get("framework_service_events_total", CELIX_METRIC_COUNTER, &(*framework)->serviceEventsMetric);
+            celixMetrics_get("framework_service_listener_calls_total", CELIX_METRIC_COUNTER, &(*framework)->listenerCallsMetric);
+            celixMetrics_get("framework_service_changed_ns", CELIX_METRIC_HISTOGRAM, &(*framework)->serviceChangedMetric);
+
 
             status = CELIX_DO_IF(status, bundle_create(&(*framework)->bundle));
             status = CELIX_DO_IF(status, arrayList_create(&(*framework)->globalLockWaitersList));
@@ -348,6 +363,10 @@ celix_status_t framework_destroy(framework_pt framework) {
 
     properties_destroy(framework->configurationMap);
 
+    celixMetrics_release(framework->serviceEventsMetric);
+    celixMetrics_release(framework->listenerCallsMetric);
+    celixMetrics_release(framework->serviceChangedMetric);
+
     free(framework);
 
 	return status;
@@ -395,6 +414,18 @@ celix_status_t fw_init(framework_pt framework) {
 
         properties_set(framework->configurationMap, (char*) OSGI_FRAMEWORK_FRAMEWORK_UUID, uuid);
 
+        const char *metricsEnabled = NULL;
+        fw_getProperty(framework, CELIX_METRICS_ENABLED, "false", &metricsEnabled);
+        if (strcmp(metricsEnabled, "true") == 0) {
+            celixMetrics_setEnabled(true);
+        }
+
+        const char *traceSampleRate = NULL;
+        fw_getProperty(framework, CELIX_FRAMEWORK_TRACE_SAMPLE_RATE, "0", &traceSampleRate);
+        if (celixTrace_setSampleRate((unsigned int) strtoul(traceSampleRate, NULL, 10)) != CELIX_SUCCESS) {
+            fw_log(framework->logger, OSGI_FRAMEWORK_LOG_WARNING, "Cannot enable tracing");
+        }
+
         framework->installedBundleMap = hashMap_create(utils_stringHash, NULL, utils_stringEquals, NULL);
 	}
 
@@ -779,6 +810,7 @@ celix_status_t framework_updateBundle(framework_pt framework, bundle_pt bundle,
 	const char *location;
 	bundle_archive_pt archive = NULL;
 	char *error = NULL;
+	bool locked = false;
 
 	status = CELIX_DO_IF(status, framework_acquireBundleLock(framework, bundle, OSGI_FRAMEWORK_BUNDLE_INSTALLED|OSGI_FRAMEWORK_BUNDLE_RESOLVED|OSGI_FRAMEWORK_BUNDLE_ACTIVE));
 	status = CELIX_DO_IF(status, bundle_getState(bundle, &oldState));
@@ -791,7 +823,7 @@ celix_status_t framework_updateBundle(framework_pt framework, bundle_pt bundle,
 	status = CELIX_DO_IF(status, bundleArchive_getLocation(archive, &location));
 
 	if (status == CELIX_SUCCESS) {
-	    bool locked = framework_acquireGlobalLock(framework);
+	    locked = framework_acquireGlobalLock(framework);
 	    if (!locked) {
 	        status = CELIX_BUNDLE_EXCEPTION;
 	        error = "Unable to acquire the global lock to update the bundle";
@@ -799,7 +831,11 @@ celix_status_t framework_updateBundle(framework_pt framework, bundle_pt bundle,
 	}
 
 	status = CELIX_DO_IF(status, bundle_revise(bundle, location, inputFile));
-	status = CELIX_DO_IF(status, framework_releaseGlobalLock(framework));
+	// also release the global lock if the new revision could not be created, e.g. for a corrupt input file
+	if (locked) {
+	    celix_status_t releaseStatus = framework_releaseGlobalLock(framework);
+	    status = CELIX_DO_IF(status, releaseStatus);
+	}
 
 	status = CELIX_DO_IF(status, bundleArchive_setLastModified(archive, time(NULL)));
 	status = CELIX_DO_IF(status, framework_setBundleStateAndNotify(framework, bundle, OSGI_FRAMEWORK_BUNDLE_INSTALLED));
@@ -1633,7 +1669,9 @@ celix_status_t fw_removeFrameworkListener(framework_pt framework, bundle_pt bund
 void fw_serviceChanged(framework_pt framework, service_event_type_e eventType, service_registration_pt registration, properties_pt oldprops) {
     unsigned int i;
     fw_service_listener_pt element;
+    uint64_t start = celixMetrics_startTimer();
 
+    celixMetrics_add(framework->serviceEventsMetric, 1);
     if (arrayList_size(framework->serviceListeners) > 0) {
         for (i = 0; i < arrayList_size(framework->serviceListeners); i++) {
             int matched = 0;
@@ -1665,6 +1703,7 @@ void fw_serviceChanged(framework_pt framework, service_event_type_e eventType, s
                 event->reference = reference;
 
                 element->listener->serviceChanged(element->listener, event);
+                celixMetrics_add(framework->listenerCallsMetric, 1);
 
                 serviceRegistry_ungetServiceReference(framework->registry, element->bundle, reference);
                 
@@ -1693,6 +1732,7 @@ void fw_serviceChanged(framework_pt framework, service_event_type_e eventType, s
                     endmatch->reference = reference;
                     endmatch->type = OSGI_FRAMEWORK_SERVICE_EVENT_MODIFIED_ENDMATCH;
                     element->listener->serviceChanged(element->listener, endmatch);
+                    celixMetrics_add(framework->listenerCallsMetric, 1);
 
                     serviceRegistry_ungetServiceReference(framework->registry, element->bundle, reference);
                     free(endmatch);
@@ -1702,6 +1742,7 @@ void fw_serviceChanged(framework_pt framework, service_event_type_e eventType, s
         }
     }
 
+    celixMetrics_stopTimer(framework->serviceChangedMetric, start);
 }
 
 //celix_status_t fw_isServiceAssignable(framework_pt fw, bundle_pt requester, service_reference_pt reference, bool *assignable) {
@@ -2142,6 +2183,18 @@ static void *framework_shutdown(void *framework) {
 	hashMapIterator_destroy(iter);
 	celixThreadMutex_unlock(&fw->installedBundleMapLock);
 
+    // the framework bundle is not cleared like other bundles, all other bundles are stopped now
+    if (fw->metricsRegistration != NULL) {
+        serviceRegistration_unregister(fw->metricsRegistration);
+        fw->metricsRegistration = NULL;
+    }
+
+    const char *traceFile = NULL;
+    fw_getProperty(fw, CELIX_FRAMEWORK_TRACE_FILE, NULL, &traceFile);
+    if (traceFile != NULL && celixTrace_getSampleRate() > 0 && celixTrace_dumpToFile(traceFile) != CELIX_SUCCESS) {
+        fw_log(fw->logger, OSGI_FRAMEWORK_LOG_WARNING, "Cannot write trace file %s", traceFile);
+    }
+
     err = celixThreadMutex_lock(&fw->mutex);
     if (err != 0) {
         fw_log(fw->logger, OSGI_FRAMEWORK_LOG_ERROR,  "Error locking the framework, cannot exit clean.");
@@ -2440,8 +2493,15 @@ celix_status_t fw_invokeFrameworkListener(framework_pt framework, framework_list
 }
 
 static celix_status_t frameworkActivator_start(void * userData, bundle_context_pt context) {
-	// nothing to do
-	return CELIX_SUCCESS;
+	celix_status_t status = CELIX_SUCCESS;
+	framework_pt framework = NULL;
+
+	status = bundleContext_getFramework(context, &framework);
+	status = CELIX_DO_IF(status, bundleContext_registerService(context, CELIX_METRICS_SERVICE_NAME, &framework->metricsService, NULL, &framework->metricsRegistration));
+
+	framework_logIfError(logger, status, NULL, "Failed to register metrics service");
+
+	return status;
 }
 
 static celix_status_t frameworkActivator_stop(void * userData, bundle_context_pt context) {
@@ -2468,6 +2528,25 @@ static celix_status_t frameworkActivator_destroy(void * userData, bundle_context
 	return CELIX_SUCCESS;
 }
 
+static celix_status_t framework_metricsSetEnabled(void *handle, bool enabled) {
+	celixMetrics_setEnabled(enabled);
+	return CELIX_SUCCESS;
+}
+
+static celix_status_t framework_metricsIsEnabled(void *handle, bool *enabled) {
+	*enabled = celixMetrics_isEnabled();
+	return CELIX_SUCCESS;
+}
+
+static celix_status_t framework_metricsReset(void *handle) {
+	celixMetrics_reset();
+	return CELIX_SUCCESS;
+}
+
+static celix_status_t framework_metricsDump(void *handle, FILE *out) {
+	return celixMetrics_dump(out);
+}
+
 
 static celix_status_t framework_loadBundleLibraries(framework_pt framework, bundle_pt bundle) {
     celix_status_t status = CELIX_SUCCESS;
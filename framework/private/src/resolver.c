@@ -31,6 +31,7 @@
 #include "linked_list_iterator.h"
 #include "bundle.h"
 #include "celix_log.h"
+#include "utils.h"
 
 struct capabilityList {
     char * serviceName;
@@ -47,15 +48,36 @@ struct candidateSet {
 
 typedef struct candidateSet * candidate_set_pt;
 
+struct unresolvableModule {
+    // capability generation at which resolving the module failed
+    unsigned long generation;
+    // names of the libraries which could not be satisfied while resolving the module
+    linked_list_pt missingNames;
+};
+
+typedef struct unresolvableModule * unresolvable_module_pt;
+
 // List containing module_ts
 linked_list_pt m_modules = NULL;
-// List containing capability_t_LISTs
-linked_list_pt m_unresolvedServices = NULL;
-// List containing capability_t_LISTs
-linked_list_pt m_resolvedServices = NULL;
-
-int resolver_populateCandidatesMap(hash_map_pt candidatesMap, module_pt targetModule);
-capability_list_pt resolver_getCapabilityList(linked_list_pt list, const char* name);
+// Map containing service name -> capability_list_pt
+hash_map_pt m_unresolvedServices = NULL;
+// Map containing service name -> capability_list_pt
+hash_map_pt m_resolvedServices = NULL;
+// Map containing module_pt -> unresolvable_module_pt
+hash_map_pt m_unresolvableModules = NULL;
+// Map containing service name -> capability generation at which a capability with that name was last added
+hash_map_pt m_capabilityGenerations = NULL;
+// Incremented every time a capability is added, only then can a failed module become resolvable
+static unsigned long m_capabilityGeneration = 0;
+
+int resolver_populateCandidatesMap(hash_map_pt candidatesMap, module_pt targetModule, linked_list_pt missingNames);
+static bool resolver_isKnownUnresolvable(module_pt module);
+static void resolver_setUnresolvable(module_pt module, linked_list_pt missingNames);
+static void resolver_clearUnresolvable(module_pt module);
+capability_list_pt resolver_getCapabilityList(hash_map_pt services, const char* name);
+static void resolver_addCapability(hash_map_pt services, capability_pt cap);
+static void resolver_removeCapability(hash_map_pt services, capability_pt cap);
+static void resolver_addCandidates(linked_list_pt candidates, capability_list_pt capList, requirement_pt req);
 void resolver_removeInvalidCandidate(module_pt module, hash_map_pt candidates, linked_list_pt invalid);
 linked_list_pt resolver_populateWireMap(hash_map_pt candidates, module_pt importer, linked_list_pt wireMap);
 
@@ -63,15 +85,23 @@ linked_list_pt resolver_resolve(module_pt root) {
     hash_map_pt candidatesMap = NULL;
     linked_list_pt wireMap = NULL;
     linked_list_pt resolved = NULL;
+    linked_list_pt missingNames = NULL;
     hash_map_iterator_pt iter = NULL;
 
     if (module_isResolved(root)) {
         return NULL;
     }
 
+    if (resolver_isKnownUnresolvable(root)) {
+        // none of the missing libraries became available since the last attempt, resolving will fail again
+        return NULL;
+    }
+
     candidatesMap = hashMap_create(NULL, NULL, NULL, NULL);
+    linkedList_create(&missingNames);
 
-    if (resolver_populateCandidatesMap(candidatesMap, root) != 0) {
+    if (resolver_populateCandidatesMap(candidatesMap, root, missingNames) != 0) {
+        resolver_setUnresolvable(root, missingNames);
         hash_map_iterator_pt iter = hashMapIterator_create(candidatesMap);
         while (hashMapIterator_hasNext(iter)) {
             hash_map_entry_pt entry = hashMapIterator_nextEntry(iter);
@@ -91,9 +121,13 @@ linked_list_pt resolver_resolve(module_pt root) {
         }
         hashMapIterator_destroy(iter);
         hashMap_destroy(candidatesMap, false, false);
+        linkedList_destroy(missingNames);
         return NULL;
     }
 
+    resolver_clearUnresolvable(root);
+    linkedList_destroy(missingNames);
+
     linkedList_create(&wireMap);
     resolved = resolver_populateWireMap(candidatesMap, root, wireMap);
     iter = hashMapIterator_create(candidatesMap);
@@ -118,7 +152,7 @@ linked_list_pt resolver_resolve(module_pt root) {
     return resolved;
 }
 
-int resolver_populateCandidatesMap(hash_map_pt candidatesMap, module_pt targetModule) {
+int resolver_populateCandidatesMap(hash_map_pt candidatesMap, module_pt targetModule, linked_list_pt missingNames) {
     linked_list_pt candSetList;
     linked_list_pt candidates;
     linked_list_pt invalid;
@@ -140,24 +174,9 @@ int resolver_populateCandidatesMap(hash_map_pt candidatesMap, module_pt targetMo
             capList = resolver_getCapabilityList(m_resolvedServices, targetName);
 
             if (linkedList_create(&candidates) == CELIX_SUCCESS) {
-                int c;
-                for (c = 0; (capList != NULL) && (c < linkedList_size(capList->capabilities)); c++) {
-                    capability_pt cap = (capability_pt) linkedList_get(capList->capabilities, c);
-                    bool satisfied = false;
-                    requirement_isSatisfied(req, cap, &satisfied);
-                    if (satisfied) {
-                        linkedList_addElement(candidates, cap);
-                    }
-                }
+                resolver_addCandidates(candidates, capList, req);
                 capList = resolver_getCapabilityList(m_unresolvedServices, targetName);
-                for (c = 0; (capList != NULL) && (c < linkedList_size(capList->capabilities)); c++) {
-                    capability_pt cap = (capability_pt) linkedList_get(capList->capabilities, c);
-                    bool satisfied = false;
-                    requirement_isSatisfied(req, cap, &satisfied);
-                    if (satisfied) {
-                        linkedList_addElement(candidates, cap);
-                    }
-                }
+                resolver_addCandidates(candidates, capList, req);
 
                 if (linkedList_size(candidates) > 0) {
                     linked_list_iterator_pt iterator = NULL;
@@ -166,7 +185,7 @@ int resolver_populateCandidatesMap(hash_map_pt candidatesMap, module_pt targetMo
                         module_pt module = NULL;
                         capability_getModule(candidate, &module);
                         if (!module_isResolved(module)) {
-                            if (resolver_populateCandidatesMap(candidatesMap, module) != 0) {
+                            if (resolver_populateCandidatesMap(candidatesMap, module, missingNames) != 0) {
                                 linkedListIterator_remove(iterator);
                             }
                         }
@@ -180,6 +199,7 @@ int resolver_populateCandidatesMap(hash_map_pt candidatesMap, module_pt targetMo
                         resolver_removeInvalidCandidate(targetModule, candidatesMap, invalid);
 
                         module_getSymbolicName(targetModule, &name);
+                        linkedList_addElement(missingNames, (void *) targetName);
 
                         linkedList_destroy(invalid);
                         fw_log(logger, OSGI_FRAMEWORK_LOG_INFO, "Unable to resolve: %s, %s\n", name, targetName);
@@ -248,40 +268,32 @@ void resolver_addModule(module_pt module) {
 
     if (m_modules == NULL) {
         linkedList_create(&m_modules);
-        linkedList_create(&m_unresolvedServices);
-        linkedList_create(&m_resolvedServices);
+        m_unresolvedServices = hashMap_create(utils_stringHash, NULL, utils_stringEquals, NULL);
+        m_resolvedServices = hashMap_create(utils_stringHash, NULL, utils_stringEquals, NULL);
+        m_unresolvableModules = hashMap_create(NULL, NULL, NULL, NULL);
+        m_capabilityGenerations = hashMap_create(utils_stringHash, NULL, utils_stringEquals, NULL);
     }
 
     if (m_modules != NULL && m_unresolvedServices != NULL) {
-        int i;
+        linked_list_pt caps = module_getCapabilities(module);
 
         linkedList_addElement(m_modules, module);
 
-        for (i = 0; i < linkedList_size(module_getCapabilities(module)); i++) {
-            const char *serviceName = NULL;
-            capability_list_pt list = NULL;
-            capability_pt cap;
-
-            cap = (capability_pt) linkedList_get(module_getCapabilities(module), i);
-            capability_getServiceName(cap, &serviceName);
-            list = resolver_getCapabilityList(m_unresolvedServices, serviceName);
-            if (list == NULL) {
-                list = (capability_list_pt) malloc(sizeof(*list));
-                if (list != NULL) {
-                    list->serviceName = strdup(serviceName);
-                    if (linkedList_create(&list->capabilities) == CELIX_SUCCESS) {
-                        linkedList_addElement(m_unresolvedServices, list);
-                    }
-                    else{
-                    	free(list->serviceName);
-                    	free(list);
-			list=NULL;
-                    }
+        if (caps != NULL) {
+            linked_list_iterator_pt iter = linkedListIterator_create(caps, 0);
+            m_capabilityGeneration++;
+            while (linkedListIterator_hasNext(iter)) {
+                capability_pt cap = (capability_pt) linkedListIterator_next(iter);
+                const char *serviceName = NULL;
+                capability_getServiceName(cap, &serviceName);
+                if (!hashMap_containsKey(m_capabilityGenerations, serviceName)) {
+                    hashMap_put(m_capabilityGenerations, strdup(serviceName), (void *) m_capabilityGeneration);
+                } else {
+                    hashMap_put(m_capabilityGenerations, (void *) serviceName, (void *) m_capabilityGeneration);
                 }
+                resolver_addCapability(m_unresolvedServices, cap);
             }
-            if(list != NULL){
-		linkedList_addElement(list->capabilities, cap);
-            }
+            linkedListIterator_destroy(iter);
         }
     }
 }
@@ -289,54 +301,37 @@ void resolver_addModule(module_pt module) {
 void resolver_removeModule(module_pt module) {
     linked_list_pt caps = NULL;
     linkedList_removeElement(m_modules, module);
+    resolver_clearUnresolvable(module);
     caps = module_getCapabilities(module);
     if (caps != NULL) {
-        int i = 0;
-        for (i = 0; i < linkedList_size(caps); i++) {
-            capability_pt cap = (capability_pt) linkedList_get(caps, i);
-            const char *serviceName = NULL;
-            capability_list_pt list;
-            capability_getServiceName(cap, &serviceName);
-            list = resolver_getCapabilityList(m_unresolvedServices, serviceName);
-            if (list != NULL) {
-                linkedList_removeElement(list->capabilities, cap);
-
-                if (linkedList_isEmpty(list->capabilities)) {
-                    linkedList_removeElement(m_unresolvedServices, list);
-                    linkedList_destroy(list->capabilities);
-                    free(list->serviceName);
-                    free(list);
-                }
-            }
-            list = resolver_getCapabilityList(m_resolvedServices, serviceName);
-            if (list != NULL) {
-                linkedList_removeElement(list->capabilities, cap);
-
-                if (linkedList_isEmpty(list->capabilities)) {
-                    linkedList_removeElement(m_resolvedServices, list);
-                    linkedList_destroy(list->capabilities);
-                    free(list->serviceName);
-                    free(list);
-                }
-            }
+        linked_list_iterator_pt iter = linkedListIterator_create(caps, 0);
+        while (linkedListIterator_hasNext(iter)) {
+            capability_pt cap = (capability_pt) linkedListIterator_next(iter);
+            resolver_removeCapability(m_unresolvedServices, cap);
+            resolver_removeCapability(m_resolvedServices, cap);
         }
+        linkedListIterator_destroy(iter);
     }
     if (linkedList_isEmpty(m_modules)) {
         linkedList_destroy(m_modules);
         m_modules = NULL;
 
-        if (!linkedList_isEmpty(m_unresolvedServices)) {
+        if (!hashMap_isEmpty(m_unresolvedServices)) {
             // #TODO: Something is wrong, not all modules have been removed from the resolver
             fw_log(logger, OSGI_FRAMEWORK_LOG_ERROR, "Unexpected entries in unresolved module list");
         }
-        linkedList_destroy(m_unresolvedServices);
+        hashMap_destroy(m_unresolvedServices, false, false);
         m_unresolvedServices = NULL;
-        if (!linkedList_isEmpty(m_resolvedServices)) {
+        if (!hashMap_isEmpty(m_resolvedServices)) {
             // #TODO: Something is wrong, not all modules have been removed from the resolver
             fw_log(logger, OSGI_FRAMEWORK_LOG_ERROR, "Unexpected entries in resolved module list");
         }
-        linkedList_destroy(m_resolvedServices);
+        hashMap_destroy(m_resolvedServices, false, false);
         m_resolvedServices = NULL;
+        hashMap_destroy(m_unresolvableModules, false, false);
+        m_unresolvableModules = NULL;
+        hashMap_destroy(m_capabilityGenerations, true, false);
+        m_capabilityGenerations = NULL;
     }
 }
 
@@ -347,87 +342,211 @@ void resolver_moduleResolved(module_pt module) {
 
         if (linkedList_create(&capsCopy) == CELIX_SUCCESS) {
             linked_list_pt wires = NULL;
-            int capIdx;
-
-            for (capIdx = 0; (module_getCapabilities(module) != NULL) && (capIdx < linkedList_size(module_getCapabilities(module))); capIdx++) {
-                capability_pt cap = (capability_pt) linkedList_get(module_getCapabilities(module), capIdx);
-                const char *serviceName = NULL;
-                capability_list_pt list;
-                capability_getServiceName(cap, &serviceName);
-                list = resolver_getCapabilityList(m_unresolvedServices, serviceName);
-                if(list != NULL){
-			linkedList_removeElement(list->capabilities, cap);
+            linked_list_pt caps = module_getCapabilities(module);
+            linked_list_iterator_pt iter = NULL;
+
+            if (caps != NULL) {
+                iter = linkedListIterator_create(caps, 0);
+                while (linkedListIterator_hasNext(iter)) {
+                    capability_pt cap = (capability_pt) linkedListIterator_next(iter);
+                    resolver_removeCapability(m_unresolvedServices, cap);
+                    linkedList_addElement(capsCopy, cap);
                 }
-
-                linkedList_addElement(capsCopy, cap);
+                linkedListIterator_destroy(iter);
             }
 
             wires = module_getWires(module);
-            for (capIdx = 0; (capsCopy != NULL) && (capIdx < linkedList_size(capsCopy)); capIdx++) {
-                capability_pt cap = linkedList_get(capsCopy, capIdx);
-
-                int wireIdx = 0;
-                for (wireIdx = 0; (wires != NULL) && (wireIdx < linkedList_size(wires)); wireIdx++) {
-                    wire_pt wire = (wire_pt) linkedList_get(wires, wireIdx);
-                    requirement_pt req = NULL;
-                    bool satisfied = false;
-                    wire_getRequirement(wire, &req);
-                    requirement_isSatisfied(req, cap, &satisfied);
-                    if (satisfied) {
-                        linkedList_set(capsCopy, capIdx, NULL);
-                        break;
-                    }
-                }
-            }
+            iter = linkedListIterator_create(capsCopy, 0);
+            while (linkedListIterator_hasNext(iter)) {
+                capability_pt cap = (capability_pt) linkedListIterator_next(iter);
+                const char *serviceName = NULL;
+                bool satisfied = false;
 
-            for (capIdx = 0; (capsCopy != NULL) && (capIdx < linkedList_size(capsCopy)); capIdx++) {
-                capability_pt cap = linkedList_get(capsCopy, capIdx);
-
-                if (cap != NULL) {
-                    const char *serviceName = NULL;
-                    capability_list_pt list = NULL;
-                    capability_getServiceName(cap, &serviceName);
-
-                    list = resolver_getCapabilityList(m_resolvedServices, serviceName);
-                    if (list == NULL) {
-                        list = (capability_list_pt) malloc(sizeof(*list));
-                        if (list != NULL) {
-                            list->serviceName = strdup(serviceName);
-                            if (linkedList_create(&list->capabilities) == CELIX_SUCCESS) {
-                                linkedList_addElement(m_resolvedServices, list);
-                            }
-                            else{
-                            	free(list->serviceName);
-                            	free(list);
-				list=NULL;
-                            }
+                capability_getServiceName(cap, &serviceName);
+                if (wires != NULL) {
+                    linked_list_iterator_pt wireIter = linkedListIterator_create(wires, 0);
+                    while (!satisfied && linkedListIterator_hasNext(wireIter)) {
+                        wire_pt wire = (wire_pt) linkedListIterator_next(wireIter);
+                        requirement_pt req = NULL;
+                        const char *targetName = NULL;
+                        wire_getRequirement(wire, &req);
+                        requirement_getTargetName(req, &targetName);
+                        // only an import of the same library substitutes the export
+                        if (targetName != NULL && serviceName != NULL && strcmp(targetName, serviceName) == 0) {
+                            requirement_isSatisfied(req, cap, &satisfied);
                         }
                     }
-                    if(list != NULL){
-			linkedList_addElement(list->capabilities, cap);
-                    }
+                    linkedListIterator_destroy(wireIter);
+                }
+
+                if (!satisfied) {
+                    resolver_addCapability(m_resolvedServices, cap);
                 }
             }
+            linkedListIterator_destroy(iter);
 
             linkedList_destroy(capsCopy);
         }
     }
 }
 
-capability_list_pt resolver_getCapabilityList(linked_list_pt list, const char * name) {
-    capability_list_pt capabilityList = NULL;
-    linked_list_iterator_pt iterator = linkedListIterator_create(list, 0);
-    while (linkedListIterator_hasNext(iterator)) {
-        capability_list_pt services = (capability_list_pt) linkedListIterator_next(iterator);
-        if (strcmp(services->serviceName, name) == 0) {
-            capabilityList = services;
-            break;
+static bool resolver_isKnownUnresolvable(module_pt module) {
+    bool unresolvable = false;
+    unresolvable_module_pt entry = NULL;
+
+    if (m_unresolvableModules != NULL) {
+        entry = (unresolvable_module_pt) hashMap_get(m_unresolvableModules, module);
+    }
+
+    if (entry != NULL) {
+        linked_list_iterator_pt iter = linkedListIterator_create(entry->missingNames, 0);
+        unresolvable = true;
+        while (unresolvable && linkedListIterator_hasNext(iter)) {
+            const char *name = (const char *) linkedListIterator_next(iter);
+            unsigned long added = (unsigned long) hashMap_get(m_capabilityGenerations, name);
+            if (added > entry->generation) {
+                unresolvable = false;
+            }
+        }
+        linkedListIterator_destroy(iter);
+    }
+
+    return unresolvable;
+}
+
+static void resolver_setUnresolvable(module_pt module, linked_list_pt missingNames) {
+    unresolvable_module_pt entry = NULL;
+
+    if (m_unresolvableModules == NULL) {
+        return;
+    }
+
+    resolver_clearUnresolvable(module);
+
+    entry = (unresolvable_module_pt) malloc(sizeof(*entry));
+    if (entry != NULL) {
+        linked_list_iterator_pt iter = linkedListIterator_create(missingNames, 0);
+        entry->generation = m_capabilityGeneration;
+        linkedList_create(&entry->missingNames);
+        while (linkedListIterator_hasNext(iter)) {
+            const char *name = (const char *) linkedListIterator_next(iter);
+            linkedList_addElement(entry->missingNames, strdup(name));
+        }
+        linkedListIterator_destroy(iter);
+        hashMap_put(m_unresolvableModules, module, entry);
+    }
+}
+
+static void resolver_clearUnresolvable(module_pt module) {
+    unresolvable_module_pt entry = NULL;
+
+    if (m_unresolvableModules != NULL) {
+        entry = (unresolvable_module_pt) hashMap_remove(m_unresolvableModules, module);
+    }
+
+    if (entry != NULL) {
+        linked_list_iterator_pt iter = linkedListIterator_create(entry->missingNames, 0);
+        while (linkedListIterator_hasNext(iter)) {
+            char *name = (char *) linkedListIterator_next(iter);
+            linkedListIterator_remove(iter);
+            free(name);
         }
+        linkedListIterator_destroy(iter);
+        linkedList_destroy(entry->missingNames);
+        free(entry);
+    }
+}
+
+capability_list_pt resolver_getCapabilityList(hash_map_pt services, const char * name) {
+    capability_list_pt capabilityList = NULL;
+    if (services != NULL && name != NULL) {
+        capabilityList = (capability_list_pt) hashMap_get(services, name);
     }
-    linkedListIterator_destroy(iterator);
     return capabilityList;
 }
 
+/**
+ * Adds the capability to the capability list for its service name. The list is kept sorted on
+ * version, highest version first, so that the first satisfying candidate is the preferred one.
+ */
+static void resolver_addCapability(hash_map_pt services, capability_pt cap) {
+    const char *serviceName = NULL;
+    capability_list_pt list = NULL;
+
+    capability_getServiceName(cap, &serviceName);
+    list = resolver_getCapabilityList(services, serviceName);
+    if (list == NULL) {
+        list = (capability_list_pt) malloc(sizeof(*list));
+        if (list != NULL) {
+            list->serviceName = strdup(serviceName);
+            if (linkedList_create(&list->capabilities) == CELIX_SUCCESS) {
+                hashMap_put(services, list->serviceName, list);
+            } else {
+                free(list->serviceName);
+                free(list);
+                list = NULL;
+            }
+        }
+    }
+
+    if (list != NULL) {
+        version_pt version = NULL;
+        int index = 0;
+        linked_list_iterator_pt iter = linkedListIterator_create(list->capabilities, 0);
+
+        capability_getVersion(cap, &version);
+        while (linkedListIterator_hasNext(iter)) {
+            capability_pt other = (capability_pt) linkedListIterator_next(iter);
+            version_pt otherVersion = NULL;
+            int cmp = 0;
+            capability_getVersion(other, &otherVersion);
+            if (version != NULL && otherVersion != NULL) {
+                version_compareTo(version, otherVersion, &cmp);
+            }
+            if (cmp > 0) {
+                break;
+            }
+            index++;
+        }
+        linkedListIterator_destroy(iter);
+
+        linkedList_addIndex(list->capabilities, index, cap);
+    }
+}
+
+static void resolver_removeCapability(hash_map_pt services, capability_pt cap) {
+    const char *serviceName = NULL;
+    capability_list_pt list = NULL;
+
+    capability_getServiceName(cap, &serviceName);
+    list = resolver_getCapabilityList(services, serviceName);
+    if (list != NULL) {
+        linkedList_removeElement(list->capabilities, cap);
+
+        if (linkedList_isEmpty(list->capabilities)) {
+            hashMap_remove(services, list->serviceName);
+            linkedList_destroy(list->capabilities);
+            free(list->serviceName);
+            free(list);
+        }
+    }
+}
+
+static void resolver_addCandidates(linked_list_pt candidates, capability_list_pt capList, requirement_pt req) {
+    if (capList != NULL) {
+        linked_list_iterator_pt iter = linkedListIterator_create(capList->capabilities, 0);
+        while (linkedListIterator_hasNext(iter)) {
+            capability_pt cap = (capability_pt) linkedListIterator_next(iter);
+            bool satisfied = false;
+            requirement_isSatisfied(req, cap, &satisfied);
+            if (satisfied) {
+                linkedList_addElement(candidates, cap);
+            }
+        }
+        linkedListIterator_destroy(iter);
+    }
+}
+
 linked_list_pt resolver_populateWireMap(hash_map_pt candidates, module_pt importer, linked_list_pt wireMap) {
     linked_list_pt serviceWires;
 
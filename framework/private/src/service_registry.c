@@ -79,6 +79,8 @@ celix_status_t serviceRegistry_create(framework_pt framework, serviceChanged_fun
 
 		arrayList_create(&reg->listenerHooks);
 
+		celixMetrics_get("framework_get_service_ns", CELIX_METRIC_HISTOGRAM, &reg->getServiceMetric);
+
 		status = celixThreadRwlock_create(&reg->lock, NULL);
 	}
 
@@ -112,6 +114,8 @@ celix_status_t serviceRegistry_destroy(service_registry_pt registry) {
 
     hashMap_destroy(registry->deletedServiceReferences, false, false);
 
+    celixMetrics_release(registry->getServiceMetric);
+
     free(registry);
 
     return CELIX_SUCCESS;
@@ -630,8 +634,7 @@ celix_status_t serviceRegistry_getService(service_registry_pt registry, bundle_p
     size_t count = 0;
     const void *service = NULL;
     reference_status_t refStatus;
-
-
+    uint64_t start = celixMetrics_startTimer();
 
     celixThreadRwlock_readLock(&registry->lock);
     serviceRegistry_checkReference(registry, reference, &refStatus);
@@ -658,6 +661,8 @@ celix_status_t serviceRegistry_getService(service_registry_pt registry, bundle_p
     }
     celixThreadRwlock_unlock(&registry->lock);
 
+    celixMetrics_stopTimer(registry->getServiceMetric, start);
+
 	return status;
 }
 
@@ -0,0 +1,151 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+/*
+ * resolver_benchmark.c
+ *
+ * Synthetic resolver benchmark. Installs NR_OF_UNRESOLVABLE_MODULES modules with an unsatisfiable import
+ * followed by NR_OF_MODULES modules which export a library and import up to three libraries exported by
+ * earlier installed modules. After every install all unresolved modules are resolved again, like a
+ * management agent retrying to start bundles which could not be resolved yet.
+ *
+ *  \author    	<a href="mailto:dev@celix.apache.org">Apache Celix Project Team</a>
+ *  \copyright	Apache License, Version 2.0
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "resolver.h"
+#include "manifest.h"
+#include "module.h"
+#include "constants.h"
+#include "linked_list_iterator.h"
+
+#define NR_OF_MODULES 500
+#define NR_OF_UNRESOLVABLE_MODULES 10
+#define TOTAL_MODULES (NR_OF_MODULES + NR_OF_UNRESOLVABLE_MODULES)
+
+static double resolverBenchmark_elapsedMs(struct timespec *begin, struct timespec *end) {
+    return (end->tv_sec - begin->tv_sec) * 1000.0 + (end->tv_nsec - begin->tv_nsec) / 1000000.0;
+}
+
+static manifest_pt resolverBenchmark_createManifest(int idx) {
+    manifest_pt manifest = NULL;
+    char name[64];
+    char exports[128];
+    char imports[512];
+    properties_pt attributes = NULL;
+
+    manifest_create(&manifest);
+    attributes = manifest_getMainAttributes(manifest);
+
+    snprintf(name, sizeof(name), "bench_module_%i", idx);
+    properties_set(attributes, OSGI_FRAMEWORK_BUNDLE_SYMBOLICNAME, name);
+    properties_set(attributes, OSGI_FRAMEWORK_BUNDLE_VERSION, "1.0.0");
+
+    if (idx < NR_OF_UNRESOLVABLE_MODULES) {
+        properties_set(attributes, OSGI_FRAMEWORK_IMPORT_LIBRARY, "bench_missing_lib;version=\"[1.0.0,2.0.0)\"");
+    } else {
+        int lib = idx - NR_OF_UNRESOLVABLE_MODULES;
+        snprintf(exports, sizeof(exports), "bench_lib_%i;version=\"1.%i.0\"", lib, lib % 5);
+        properties_set(attributes, OSGI_FRAMEWORK_EXPORT_LIBRARY, exports);
+
+        imports[0] = '\0';
+        if (lib > 0) {
+            int deps[3] = {lib - 1, lib / 2, lib / 3};
+            int i;
+            for (i = 0; i < 3; ++i) {
+                char import[96];
+                if (i > 0 && (deps[i] == deps[i - 1] || deps[i] == deps[0])) {
+                    continue;
+                }
+                snprintf(import, sizeof(import), "%sbench_lib_%i;version=\"[1.0.0,2.0.0)\"", strlen(imports) > 0 ? "," : "", deps[i]);
+                strcat(imports, import);
+            }
+            properties_set(attributes, OSGI_FRAMEWORK_IMPORT_LIBRARY, imports);
+        }
+    }
+
+    return manifest;
+}
+
+static void resolverBenchmark_markResolved(linked_list_pt wireMap) {
+    linked_list_iterator_pt iter = linkedListIterator_create(wireMap, linkedList_size(wireMap));
+    while (linkedListIterator_hasPrevious(iter)) {
+        importer_wires_pt iw = linkedListIterator_previous(iter);
+        module_setWires(iw->importer, iw->wires);
+        module_setResolved(iw->importer);
+        resolver_moduleResolved(iw->importer);
+        linkedListIterator_remove(iter);
+        free(iw);
+    }
+    linkedListIterator_destroy(iter);
+    linkedList_destroy(wireMap);
+}
+
+static int resolverBenchmark_resolveAll(module_pt modules[], int nrOfModules) {
+    int resolved = 0;
+    int i;
+    for (i = 0; i < nrOfModules; ++i) {
+        if (!module_isResolved(modules[i])) {
+            linked_list_pt wireMap = resolver_resolve(modules[i]);
+            if (wireMap != NULL) {
+                resolverBenchmark_markResolved(wireMap);
+            }
+        }
+        if (module_isResolved(modules[i])) {
+            resolved++;
+        }
+    }
+    return resolved;
+}
+
+int main(int argc, char **argv) {
+    manifest_pt manifests[TOTAL_MODULES];
+    module_pt modules[TOTAL_MODULES];
+    struct timespec begin;
+    struct timespec end;
+    int resolved = 0;
+    int i;
+
+    for (i = 0; i < TOTAL_MODULES; ++i) {
+        char id[16];
+        snprintf(id, sizeof(id), "%i", i + 1);
+        manifests[i] = resolverBenchmark_createManifest(i);
+        modules[i] = module_create(manifests[i], id, NULL);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    for (i = 0; i < TOTAL_MODULES; ++i) {
+        resolver_addModule(modules[i]);
+        resolved = resolverBenchmark_resolveAll(modules, i + 1);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    printf("Installed %i modules and resolved %i modules in %.3f ms\n", TOTAL_MODULES, resolved, resolverBenchmark_elapsedMs(&begin, &end));
+
+    for (i = 0; i < TOTAL_MODULES; ++i) {
+        resolver_removeModule(modules[i]);
+        module_destroy(modules[i]);
+        manifest_destroy(manifests[i]);
+    }
+
+    return resolved == NR_OF_MODULES ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,172 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+/*
+ * resolver_retry_test.cpp
+ *
+ * Runs the resolver with real modules. A module which failed to resolve is skipped until a library it misses is
+ * installed, these tests check that such a module is retried and resolves once a matching library is installed.
+ *
+ *  \author     <a href="mailto:dev@celix.apache.org">Apache Celix Project Team</a>
+ *  \copyright  Apache License, Version 2.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/TestHarness_c.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+extern "C"
+{
+#include "resolver.h"
+#include "manifest.h"
+#include "module.h"
+#include "constants.h"
+#include "linked_list_iterator.h"
+}
+
+int main(int argc, char** argv) {
+	return RUN_ALL_TESTS(argc, argv);
+}
+
+#define MAX_MODULES 8
+
+TEST_GROUP(resolver_retry) {
+	manifest_pt manifests[MAX_MODULES];
+	module_pt modules[MAX_MODULES];
+	int nrOfModules;
+
+	void setup() {
+		nrOfModules = 0;
+	}
+
+	void teardown() {
+		for (int i = 0; i < nrOfModules; ++i) {
+			resolver_removeModule(modules[i]);
+			module_destroy(modules[i]);
+			manifest_destroy(manifests[i]);
+		}
+	}
+
+	module_pt install(const char* name, const char* exports, const char* imports) {
+		properties_pt attributes = NULL;
+		char id[16];
+
+		manifest_create(&manifests[nrOfModules]);
+		attributes = manifest_getMainAttributes(manifests[nrOfModules]);
+		properties_set(attributes, (char*) OSGI_FRAMEWORK_BUNDLE_SYMBOLICNAME, (char*) name);
+		properties_set(attributes, (char*) OSGI_FRAMEWORK_BUNDLE_VERSION, (char*) "1.0.0");
+		if (exports != NULL) {
+			properties_set(attributes, (char*) OSGI_FRAMEWORK_EXPORT_LIBRARY, (char*) exports);
+		}
+		if (imports != NULL) {
+			properties_set(attributes, (char*) OSGI_FRAMEWORK_IMPORT_LIBRARY, (char*) imports);
+		}
+
+		snprintf(id, sizeof(id), "%i", nrOfModules + 1);
+		modules[nrOfModules] = module_create(manifests[nrOfModules], id, NULL);
+		resolver_addModule(modules[nrOfModules]);
+		return modules[nrOfModules++];
+	}
+
+	/* resolves the module like the framework does, marking all modules of the wire map resolved */
+	bool resolve(module_pt module) {
+		linked_list_pt wireMap = resolver_resolve(module);
+		if (wireMap != NULL) {
+			linked_list_iterator_pt iter = linkedListIterator_create(wireMap, linkedList_size(wireMap));
+			while (linkedListIterator_hasPrevious(iter)) {
+				importer_wires_pt iw = (importer_wires_pt) linkedListIterator_previous(iter);
+				module_setWires(iw->importer, iw->wires);
+				module_setResolved(iw->importer);
+				resolver_moduleResolved(iw->importer);
+				linkedListIterator_remove(iter);
+				free(iw);
+			}
+			linkedListIterator_destroy(iter);
+			linkedList_destroy(wireMap);
+		}
+		return module_isResolved(module);
+	}
+
+	/* the module the first wire of the module is connected to */
+	module_pt exporter(module_pt module) {
+		linked_list_pt wires = module_getWires(module);
+		module_pt exporter = NULL;
+		if (wires != NULL && linkedList_size(wires) > 0) {
+			wire_getExporter((wire_pt) linkedList_get(wires, 0), &exporter);
+		}
+		return exporter;
+	}
+};
+
+TEST(resolver_retry, resolvesOnceMissingLibraryIsInstalled) {
+	module_pt importer = install("importer", NULL, "retry_lib;version=\"[1.0.0,2.0.0)\"");
+
+	CHECK_FALSE(resolve(importer));
+	CHECK_FALSE(resolve(importer)); //known unresolvable, skipped
+
+	install("unrelated", "other_lib;version=\"1.0.0\"", NULL);
+	CHECK_FALSE(resolve(importer));
+
+	module_pt provider = install("provider", "retry_lib;version=\"1.0.0\"", NULL);
+	CHECK(resolve(importer));
+	POINTERS_EQUAL(provider, exporter(importer));
+}
+
+TEST(resolver_retry, resolvesOnceLibraryTwoLevelsDownIsInstalled) {
+	module_pt top = install("top", NULL, "retry_middle_lib;version=\"[1.0.0,2.0.0)\"");
+	module_pt middle = install("middle", "retry_middle_lib;version=\"1.0.0\"", "retry_lib;version=\"[1.0.0,2.0.0)\"");
+
+	CHECK_FALSE(resolve(top));
+	CHECK_FALSE(resolve(middle));
+	CHECK_FALSE(resolve(top));
+
+	module_pt provider = install("provider", "retry_lib;version=\"1.0.0\"", NULL);
+	CHECK(resolve(top));
+	CHECK(module_isResolved(middle));
+	POINTERS_EQUAL(middle, exporter(top));
+	POINTERS_EQUAL(provider, exporter(middle));
+}
+
+TEST(resolver_retry, resolvesOnceMissingLibraryTwoLevelsDownIsInstalledWithoutResolvingTheMiddle) {
+	module_pt top = install("top", NULL, "retry_middle_lib;version=\"[1.0.0,2.0.0)\"");
+	module_pt middle = install("middle", "retry_middle_lib;version=\"1.0.0\"", "retry_lib;version=\"[1.0.0,2.0.0)\"");
+
+	CHECK_FALSE(resolve(top));
+	CHECK_FALSE(resolve(top));
+
+	install("provider", "retry_lib;version=\"1.0.0\"", NULL);
+	CHECK(resolve(top));
+	CHECK(module_isResolved(middle));
+}
+
+TEST(resolver_retry, resolvesOnceProviderInVersionRangeIsInstalled) {
+	module_pt importer = install("importer", NULL, "retry_lib;version=\"[1.0.0,2.0.0)\"");
+
+	install("too_new", "retry_lib;version=\"3.0.0\"", NULL);
+	CHECK_FALSE(resolve(importer));
+	CHECK_FALSE(resolve(importer));
+
+	install("too_old", "retry_lib;version=\"0.9.0\"", NULL);
+	CHECK_FALSE(resolve(importer));
+
+	module_pt provider = install("provider", "retry_lib;version=\"1.2.0\"", NULL);
+	CHECK(resolve(importer));
+	POINTERS_EQUAL(provider, exporter(importer));
+}
@@ -60,6 +60,9 @@ static const char *const OSGI_FRAMEWORK_FRAMEWORK_STORAGE_CLEAN = "org.osgi.fram
 static const char *const OSGI_FRAMEWORK_FRAMEWORK_STORAGE_CLEAN_ONFIRSTINIT = "onFirstInit";
 static const char *const OSGI_FRAMEWORK_FRAMEWORK_UUID = "org.osgi.framework.uuid";
 
+static const char *const CELIX_FRAMEWORK_TRACE_SAMPLE_RATE = "CELIX_TRACE_SAMPLE_RATE";
+static const char *const CELIX_FRAMEWORK_TRACE_FILE = "CELIX_TRACE_FILE";
+
 #ifdef __cplusplus
 }
 #endif
@@ -17,18 +17,45 @@
  *under the License.
  */
 /*
- * miniunz.h
+ * metrics_service.h
+ *
+ * Service registered by the framework bundle to control and read the metrics of celix_metrics.h. Metrics are enabled
+ * at startup when the CELIX_METRICS_ENABLED framework property is true.
  *
- *  \date       Aug 8, 2012
  *  \author    	<a href="mailto:dev@celix.apache.org">Apache Celix Project Team</a>
  *  \copyright	Apache License, Version 2.0
  */
 
-#ifndef MINIUNZ_H_
-#define MINIUNZ_H_
+#ifndef METRICS_SERVICE_H_
+#define METRICS_SERVICE_H_
+
+#include <stdio.h>
 
+#include "celixbool.h"
 #include "celix_errno.h"
 
-celix_status_t unzip_extractDeploymentPackage(char * packageName, char * destination);
+#define CELIX_METRICS_SERVICE_NAME "celix_metrics_service"
+
+#define CELIX_METRICS_ENABLED "CELIX_METRICS_ENABLED"
+
+typedef struct metrics_service *metrics_service_pt;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct metrics_service {
+	void *handle;
+
+	celix_status_t (*setEnabled)(void *handle, bool enabled);
+	celix_status_t (*isEnabled)(void *handle, bool *enabled);
+	celix_status_t (*reset)(void *handle);
+	/* Writes all metrics in the Prometheus text format */
+	celix_status_t (*dump)(void *handle, FILE *out);
+};
+
+#ifdef __cplusplus
+}
+#endif
 
-#endif /* MINIUNZ_H_ */
+#endif /* METRICS_SERVICE_H_ */
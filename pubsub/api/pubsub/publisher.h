@@ -61,6 +61,7 @@ struct pubsub_publisher {
      * with use of a distributed key/value store or communication between  participation parties.
      * this is called the local message type id. This local message type id can be requested with the localMsgIdForMsgType method.
      * When return is successful the msgTypeId is always greater than 0. (Note this can be used to specify/detect uninitialized msg type ids in the consumer code).
+     * The msgTypeId is only valid for the publisher service it was requested from.
      *
      * Returns 0 on success.
      */
@@ -0,0 +1,64 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+/*
+ * benchmark_msg.h
+ *
+ *  \author    	<a href="mailto:dev@celix.apache.org">Apache Celix Project Team</a>
+ *  \copyright	Apache License, Version 2.0
+ */
+
+#ifndef BENCHMARK_MSG_H_
+#define BENCHMARK_MSG_H_
+
+#include <stdint.h>
+#include <time.h>
+
+#define BENCHMARK_TOPIC "benchmark"
+#define BENCHMARK_MSG_NAME "benchmark"
+
+/* Configuration of the publisher and subscriber bundles, read as framework property or environment variable */
+#define BENCHMARK_ID_PROPERTY "PUBSUB_BENCHMARK_ID"
+#define BENCHMARK_PAYLOAD_SIZE_PROPERTY "PUBSUB_BENCHMARK_PAYLOAD_SIZE" //bytes, default 64
+#define BENCHMARK_WARMUP_PROPERTY "PUBSUB_BENCHMARK_WARMUP" //seconds before the first send, default 5
+#define BENCHMARK_DURATION_PROPERTY "PUBSUB_BENCHMARK_DURATION" //seconds of sending, default 10
+#define BENCHMARK_RATE_PROPERTY "PUBSUB_BENCHMARK_RATE" //msgs/s per publisher, 0 (default) sends as fast as possible
+#define BENCHMARK_THREADS_PROPERTY "PUBSUB_BENCHMARK_THREADS" //sending threads per publisher, default 1
+#define BENCHMARK_RESULT_FILE_PROPERTY "PUBSUB_BENCHMARK_RESULT_FILE" //JSON results, default stdout
+
+#define BENCHMARK_MAX_PUBLISHERS 256
+
+/* See msg_descriptors/msg_benchmark.descriptor */
+typedef struct benchmark_msg {
+    int64_t sendTime; //CLOCK_MONOTONIC in ns, comparable between processes on the same host
+    uint32_t publisherId;
+    uint32_t seqNr;
+    struct {
+        uint32_t cap;
+        uint32_t len;
+        uint8_t *buf;
+    } payload;
+} benchmark_msg_t;
+
+static inline int64_t benchmark_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+#endif /* BENCHMARK_MSG_H_ */
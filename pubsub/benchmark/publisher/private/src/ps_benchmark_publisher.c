@@ -0,0 +1,300 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+/*
+ * ps_benchmark_publisher.c
+ *
+ * Publisher of the pubsub benchmark. Waits for the warmup time (discovery and connecting the subscribers), sends
+ * benchmark messages for the configured duration and writes the number of sent messages as JSON.
+ *
+ *  \author    	<a href="mailto:dev@celix.apache.org">Apache Celix Project Team</a>
+ *  \copyright	Apache License, Version 2.0
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include "bundle_activator.h"
+#include "service_tracker.h"
+#include "constants.h"
+#include "celix_threads.h"
+
+#include "publisher.h"
+#include "benchmark_msg.h"
+
+struct benchmark_send_thread {
+    struct benchmark_publisher *publisher;
+    celix_thread_t thread;
+    unsigned int publisherId;
+    uint64_t sent;
+    uint64_t errors;
+    int64_t elapsed;
+};
+
+struct benchmark_publisher {
+    bundle_context_pt context;
+    service_tracker_pt tracker;
+
+    celix_thread_rwlock_t svcLock; //protects pubSvc and msgTypeId, read locked while sending
+    pubsub_publisher_pt pubSvc;
+    unsigned int msgTypeId; //local to pubSvc
+
+    celix_thread_mutex_t mutex; //protects writing running
+    volatile bool running;
+    unsigned int nrOfThreads;
+    struct benchmark_send_thread *threads;
+
+    unsigned int id;
+    unsigned int payloadSize;
+    double warmup;
+    double duration;
+    unsigned int rate;
+    const char *resultFile;
+};
+
+static celix_status_t benchmarkPublisher_publisherAdded(void *handle, service_reference_pt reference, void *service);
+static celix_status_t benchmarkPublisher_publisherRemoved(void *handle, service_reference_pt reference, void *service);
+static void *benchmarkPublisher_run(void *handle);
+static bool benchmarkPublisher_sleepUntil(struct benchmark_publisher *publisher, int64_t time);
+static void benchmarkPublisher_writeResult(struct benchmark_publisher *publisher);
+static const char *benchmarkPublisher_getProperty(bundle_context_pt context, const char *name, const char *defaultValue);
+
+celix_status_t bundleActivator_create(bundle_context_pt context, void **userData) {
+    struct benchmark_publisher *publisher = calloc(1, sizeof(*publisher));
+    if (publisher == NULL) {
+        return CELIX_ENOMEM;
+    }
+
+    publisher->context = context;
+    celixThreadRwlock_create(&publisher->svcLock, NULL);
+    celixThreadMutex_create(&publisher->mutex, NULL);
+    publisher->id = (unsigned int) strtoul(benchmarkPublisher_getProperty(context, BENCHMARK_ID_PROPERTY, "0"), NULL, 10);
+    publisher->payloadSize = (unsigned int) strtoul(benchmarkPublisher_getProperty(context, BENCHMARK_PAYLOAD_SIZE_PROPERTY, "64"), NULL, 10);
+    publisher->warmup = atof(benchmarkPublisher_getProperty(context, BENCHMARK_WARMUP_PROPERTY, "5"));
+    publisher->duration = atof(benchmarkPublisher_getProperty(context, BENCHMARK_DURATION_PROPERTY, "10"));
+    publisher->rate = (unsigned int) strtoul(benchmarkPublisher_getProperty(context, BENCHMARK_RATE_PROPERTY, "0"), NULL, 10);
+    publisher->nrOfThreads = (unsigned int) strtoul(benchmarkPublisher_getProperty(context, BENCHMARK_THREADS_PROPERTY, "1"), NULL, 10);
+    publisher->resultFile = benchmarkPublisher_getProperty(context, BENCHMARK_RESULT_FILE_PROPERTY, NULL);
+    if (publisher->nrOfThreads == 0) {
+        publisher->nrOfThreads = 1;
+    }
+
+    publisher->threads = calloc(publisher->nrOfThreads, sizeof(*publisher->threads));
+    if (publisher->threads == NULL) {
+        celixThreadMutex_destroy(&publisher->mutex);
+        celixThreadRwlock_destroy(&publisher->svcLock);
+        free(publisher);
+        return CELIX_ENOMEM;
+    }
+
+    *userData = publisher;
+    return CELIX_SUCCESS;
+}
+
+celix_status_t bundleActivator_start(void *userData, bundle_context_pt context) {
+    struct benchmark_publisher *publisher = userData;
+    service_tracker_customizer_pt customizer = NULL;
+    char filter[128];
+    unsigned int i;
+
+    snprintf(filter, sizeof(filter), "(&(%s=%s)(%s=%s))", OSGI_FRAMEWORK_OBJECTCLASS, PUBSUB_PUBLISHER_SERVICE_NAME,
+            PUBSUB_PUBLISHER_TOPIC, BENCHMARK_TOPIC);
+    serviceTrackerCustomizer_create(publisher, NULL, benchmarkPublisher_publisherAdded, NULL, benchmarkPublisher_publisherRemoved, &customizer);
+    serviceTracker_createWithFilter(context, filter, customizer, &publisher->tracker);
+    serviceTracker_open(publisher->tracker);
+
+    publisher->running = true;
+    for (i = 0; i < publisher->nrOfThreads; i++) {
+        struct benchmark_send_thread *thread = &publisher->threads[i];
+        thread->publisher = publisher;
+        //every thread has its own sequence numbers, the subscribers see them as separate publishers
+        thread->publisherId = publisher->id * publisher->nrOfThreads + i;
+        celixThread_create(&thread->thread, NULL, benchmarkPublisher_run, thread);
+    }
+
+    return CELIX_SUCCESS;
+}
+
+celix_status_t bundleActivator_stop(void *userData, bundle_context_pt context) {
+    struct benchmark_publisher *publisher = userData;
+    unsigned int i;
+
+    celixThreadMutex_lock(&publisher->mutex);
+    publisher->running = false;
+    celixThreadMutex_unlock(&publisher->mutex);
+    for (i = 0; i < publisher->nrOfThreads; i++) {
+        celixThread_join(publisher->threads[i].thread, NULL);
+    }
+    benchmarkPublisher_writeResult(publisher);
+
+    serviceTracker_close(publisher->tracker);
+    return CELIX_SUCCESS;
+}
+
+celix_status_t bundleActivator_destroy(void *userData, bundle_context_pt context) {
+    struct benchmark_publisher *publisher = userData;
+
+    serviceTracker_destroy(publisher->tracker);
+    celixThreadMutex_destroy(&publisher->mutex);
+    celixThreadRwlock_destroy(&publisher->svcLock);
+    free(publisher->threads);
+    free(publisher);
+    return CELIX_SUCCESS;
+}
+
+static celix_status_t benchmarkPublisher_publisherAdded(void *handle, service_reference_pt reference, void *service) {
+    struct benchmark_publisher *publisher = handle;
+    pubsub_publisher_pt pubSvc = service;
+
+    celixThreadRwlock_writeLock(&publisher->svcLock);
+    publisher->pubSvc = pubSvc;
+    publisher->msgTypeId = 0;
+    pubSvc->localMsgTypeIdForMsgType(pubSvc->handle, BENCHMARK_MSG_NAME, &publisher->msgTypeId);
+    celixThreadRwlock_unlock(&publisher->svcLock);
+    return CELIX_SUCCESS;
+}
+
+static celix_status_t benchmarkPublisher_publisherRemoved(void *handle, service_reference_pt reference, void *service) {
+    struct benchmark_publisher *publisher = handle;
+
+    celixThreadRwlock_writeLock(&publisher->svcLock);
+    if (publisher->pubSvc == service) {
+        publisher->pubSvc = NULL;
+    }
+    celixThreadRwlock_unlock(&publisher->svcLock);
+    return CELIX_SUCCESS;
+}
+
+static void *benchmarkPublisher_run(void *handle) {
+    struct benchmark_send_thread *thread = handle;
+    struct benchmark_publisher *publisher = thread->publisher;
+    benchmark_msg_t msg;
+    uint64_t sent = 0;
+    uint64_t errors = 0;
+    int64_t start;
+    int64_t end;
+    int64_t now;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.publisherId = thread->publisherId;
+    msg.payload.cap = publisher->payloadSize;
+    msg.payload.len = publisher->payloadSize;
+    msg.payload.buf = malloc(publisher->payloadSize > 0 ? publisher->payloadSize : 1);
+    if (msg.payload.buf == NULL) {
+        return NULL;
+    }
+    memset(msg.payload.buf, 0x5a, publisher->payloadSize);
+
+    if (!benchmarkPublisher_sleepUntil(publisher, benchmark_now() + (int64_t) (publisher->warmup * 1e9))) {
+        free(msg.payload.buf);
+        return NULL;
+    }
+
+    start = benchmark_now();
+    end = start + (int64_t) (publisher->duration * 1e9);
+    //running is read without the mutex, so the sending threads only share the read lock
+    for (now = start; now < end && publisher->running; now = benchmark_now()) {
+        int rc = -1;
+
+        celixThreadRwlock_readLock(&publisher->svcLock);
+        if (publisher->pubSvc != NULL) {
+            msg.seqNr = (uint32_t) (sent + errors);
+            msg.sendTime = benchmark_now();
+            rc = publisher->pubSvc->send(publisher->pubSvc->handle, publisher->msgTypeId, &msg);
+        }
+        celixThreadRwlock_unlock(&publisher->svcLock);
+
+        if (rc == 0) {
+            sent++;
+        } else {
+            errors++;
+        }
+        if (publisher->rate > 0 && !benchmarkPublisher_sleepUntil(publisher, start + (int64_t) ((sent + errors) * 1e9 / publisher->rate))) {
+            break;
+        }
+    }
+
+    thread->sent = sent;
+    thread->errors = errors;
+    thread->elapsed = benchmark_now() - start;
+    free(msg.payload.buf);
+    return NULL;
+}
+
+/* Sleeps until the given CLOCK_MONOTONIC time, returns false when the bundle is stopped in the meantime */
+static bool benchmarkPublisher_sleepUntil(struct benchmark_publisher *publisher, int64_t time) {
+    bool running = true;
+    int64_t now;
+
+    //sleep in steps of at most 100ms, so that a stop is noticed during the warmup
+    for (now = benchmark_now(); running && now < time; now = benchmark_now()) {
+        int64_t until = now + 100000000LL < time ? now + 100000000LL : time;
+        struct timespec ts = { until / 1000000000LL, until % 1000000000LL };
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+
+        celixThreadMutex_lock(&publisher->mutex);
+        running = publisher->running;
+        celixThreadMutex_unlock(&publisher->mutex);
+    }
+    return running;
+}
+
+static void benchmarkPublisher_writeResult(struct benchmark_publisher *publisher) {
+    FILE *out = stdout;
+    uint64_t sent = 0;
+    uint64_t errors = 0;
+    int64_t elapsed = 0;
+    double seconds;
+    unsigned int i;
+
+    for (i = 0; i < publisher->nrOfThreads; i++) {
+        sent += publisher->threads[i].sent;
+        errors += publisher->threads[i].errors;
+        if (publisher->threads[i].elapsed > elapsed) {
+            elapsed = publisher->threads[i].elapsed;
+        }
+    }
+    seconds = elapsed / 1e9;
+
+    if (publisher->resultFile != NULL) {
+        out = fopen(publisher->resultFile, "w");
+        if (out == NULL) {
+            fprintf(stderr, "PUBSUB_BENCHMARK: Cannot write result file '%s': %s\n", publisher->resultFile, strerror(errno));
+            return;
+        }
+    }
+
+    fprintf(out, "{\"role\": \"publisher\", \"id\": %u, \"threads\": %u, \"payload_size\": %u, \"rate\": %u, \"sent\": %llu, \"send_errors\": %llu, "
+            "\"duration_s\": %.6f, \"msgs_per_second\": %.3f, \"bytes_per_second\": %.3f}\n",
+            publisher->id, publisher->nrOfThreads, publisher->payloadSize, publisher->rate, (unsigned long long) sent, (unsigned long long) errors,
+            seconds, seconds > 0.0 ? sent / seconds : 0.0, seconds > 0.0 ? sent * (double) publisher->payloadSize / seconds : 0.0);
+
+    if (out != stdout) {
+        fclose(out);
+    } else {
+        fflush(out);
+    }
+}
+
+static const char *benchmarkPublisher_getProperty(bundle_context_pt context, const char *name, const char *defaultValue) {
+    const char *value = NULL;
+    bundleContext_getPropertyWithDefault(context, name, defaultValue, &value);
+    return value;
+}
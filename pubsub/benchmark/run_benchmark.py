@@ -0,0 +1,279 @@
+#!/usr/bin/env python3
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+
+"""Runs the pubsub benchmark matrix on localhost.
+
+For every combination of admin, serializer, payload size, publisher count and
+subscriber count the subscriber and publisher containers are started as
+separate processes, each with its own config.properties. After the warmup and
+duration the processes are stopped and the JSON results of all processes are
+combined. See README.md.
+"""
+
+import argparse
+import datetime
+import itertools
+import json
+import os
+import shutil
+import signal
+import socket
+import subprocess
+import sys
+import tempfile
+import time
+
+STOP_TIMEOUT = 30
+
+
+def int_list(value):
+    return [int(v) for v in value.split(",")]
+
+
+def str_list(value):
+    return value.split(",")
+
+
+def container(deploy_dir, admin, serializer, role):
+    name = "pubsub_benchmark_%s_%s_%s" % (admin, serializer, role)
+    return os.path.join(deploy_dir, name, name)
+
+
+def start(executable, work_dir, properties):
+    os.makedirs(work_dir)
+    with open(os.path.join(work_dir, "config.properties"), "w") as config:
+        for key, value in sorted(properties.items()):
+            config.write("%s=%s\n" % (key, value))
+    log = open(os.path.join(work_dir, "output.log"), "w")
+    return subprocess.Popen([executable], cwd=work_dir, stdout=log, stderr=subprocess.STDOUT)
+
+
+def stop(processes):
+    for process in processes:
+        if process.poll() is None:
+            process.send_signal(signal.SIGINT)
+    deadline = time.time() + STOP_TIMEOUT
+    for process in processes:
+        try:
+            process.wait(max(deadline - time.time(), 0.1))
+        except subprocess.TimeoutExpired:
+            process.kill()
+            process.wait()
+
+
+def load(result_file):
+    try:
+        with open(result_file) as f:
+            return json.load(f)
+    except (IOError, ValueError):
+        return None
+
+
+def percentile(histogram, total, value):
+    rank = max(int(value / 100.0 * total + 0.5), 1)
+    count = 0
+    for latency, bucket_count in histogram:
+        count += bucket_count
+        if count >= rank:
+            return latency
+    return 0
+
+
+def combine(point, publishers, subscribers):
+    result = dict(point)
+    errors = []
+    if any(p is None for p in publishers):
+        errors.append("missing publisher result")
+    if any(s is None for s in subscribers):
+        errors.append("missing subscriber result")
+    publishers = [p for p in publishers if p is not None]
+    subscribers = [s for s in subscribers if s is not None]
+
+    sent = sum(p["sent"] for p in publishers)
+    received = sum(s["received"] for s in subscribers)
+    result["sent"] = sent
+    result["send_errors"] = sum(p["send_errors"] for p in publishers)
+    result["received"] = received
+    result["lost"] = sum(s["lost"] for s in subscribers)
+    expected = sent * point["subscribers"]
+    result["delivery_ratio"] = received / float(expected) if expected > 0 else 0.0
+    result["send_msgs_per_second"] = sum(p["msgs_per_second"] for p in publishers)
+    # delivered messages over all subscribers
+    result["msgs_per_second"] = sum(s["msgs_per_second"] for s in subscribers)
+    result["bytes_per_second"] = sum(s["bytes_per_second"] for s in subscribers)
+
+    merged = {}
+    for s in subscribers:
+        for latency, count in s["latency_histogram"]:
+            merged[latency] = merged.get(latency, 0) + count
+    histogram = sorted(merged.items())
+    result["latency_ns"] = {
+        "p50": percentile(histogram, received, 50.0),
+        "p99": percentile(histogram, received, 99.0),
+        "p999": percentile(histogram, received, 99.9),
+        "max": histogram[-1][0] if histogram else 0,
+    }
+
+    if received == 0:
+        errors.append("no messages received")
+    if errors:
+        result["error"] = ", ".join(errors)
+    return result
+
+
+def run_point(args, point, work_dir):
+    properties = dict(args.property)
+    properties["PUBSUB_BENCHMARK_PAYLOAD_SIZE"] = point["payload_size"]
+    properties["PUBSUB_BENCHMARK_WARMUP"] = args.warmup
+    properties["PUBSUB_BENCHMARK_DURATION"] = args.duration
+    properties["PUBSUB_BENCHMARK_RATE"] = args.rate
+    properties["PUBSUB_BENCHMARK_THREADS"] = point["publisher_threads"]
+
+    subscriber_files = []
+    subscribers = []
+    publisher_files = []
+    publishers = []
+    try:
+        for i in range(point["subscribers"]):
+            result_file = os.path.join(work_dir, "subscriber_%i" % i, "result.json")
+            properties["PUBSUB_BENCHMARK_ID"] = i
+            properties["PUBSUB_BENCHMARK_RESULT_FILE"] = result_file
+            subscriber_files.append(result_file)
+            subscribers.append(start(container(args.deploy_dir, point["admin"], point["serializer"], "subscriber"),
+                                     os.path.dirname(result_file), properties))
+        for i in range(point["publishers"]):
+            result_file = os.path.join(work_dir, "publisher_%i" % i, "result.json")
+            properties["PUBSUB_BENCHMARK_ID"] = i
+            properties["PUBSUB_BENCHMARK_RESULT_FILE"] = result_file
+            publisher_files.append(result_file)
+            publishers.append(start(container(args.deploy_dir, point["admin"], point["serializer"], "publisher"),
+                                    os.path.dirname(result_file), properties))
+
+        time.sleep(args.warmup + args.duration + args.drain)
+    finally:
+        # subscribers write their results when stopped
+        stop(subscribers)
+        stop(publishers)
+
+    return combine(point, [load(f) for f in publisher_files], [load(f) for f in subscriber_files])
+
+
+def benchmark_entries(result):
+    """google benchmark like entries, to compare runs with benchmarks/compare_benchmarks.py"""
+    name = "pubsub/%s/%s/%i/%ipub/%ithr/%isub" % (result["admin"], result["serializer"], result["payload_size"],
+                                                  result["publishers"], result["publisher_threads"], result["subscribers"])
+    entries = []
+    if "error" in result:
+        return [{"name": name, "run_type": "iteration", "error_occurred": True, "error_message": result["error"],
+                 "real_time": 0, "cpu_time": 0, "time_unit": "ns"}]
+    if result["msgs_per_second"] > 0:
+        ns_per_msg = 1e9 / result["msgs_per_second"]
+        entries.append({"name": name + "/throughput", "run_type": "iteration", "iterations": result["received"],
+                        "real_time": ns_per_msg, "cpu_time": ns_per_msg, "time_unit": "ns",
+                        "items_per_second": result["msgs_per_second"], "bytes_per_second": result["bytes_per_second"]})
+    for key in ("p50", "p99", "p999"):
+        latency = result["latency_ns"][key]
+        entries.append({"name": "%s/latency_%s" % (name, key), "run_type": "iteration", "iterations": result["received"],
+                        "real_time": latency, "cpu_time": latency, "time_unit": "ns"})
+    return entries
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Runs the pubsub benchmark matrix on localhost")
+    parser.add_argument("--deploy-dir", default=os.path.dirname(os.path.abspath(__file__)),
+                        help="directory with the pubsub_benchmark_* containers (default: directory of this script)")
+    parser.add_argument("--admins", type=str_list, default=["zmq", "udp_mc"])
+    parser.add_argument("--serializers", type=str_list, default=["json"])
+    parser.add_argument("--payload-sizes", type=int_list, default=[64, 1024, 16384], help="payload bytes per message")
+    parser.add_argument("--publishers", type=int_list, default=[1], help="publisher process counts")
+    parser.add_argument("--publisher-threads", type=int_list, default=[1], help="sending threads per publisher process")
+    parser.add_argument("--subscribers", type=int_list, default=[1, 4], help="subscriber process counts")
+    parser.add_argument("--warmup", type=float, default=5.0, help="seconds between start and the first send")
+    parser.add_argument("--duration", type=float, default=10.0, help="seconds of sending")
+    parser.add_argument("--drain", type=float, default=2.0, help="seconds to wait for in flight messages")
+    parser.add_argument("--rate", type=int, default=0, help="msgs/s per publisher, 0 sends as fast as possible")
+    parser.add_argument("--property", action="append", default=[], type=lambda p: tuple(p.split("=", 1)),
+                        help="additional config property KEY=VALUE for all processes, e.g. PSA_INTERFACE=lo")
+    parser.add_argument("--start-etcd", action="store_true", help="start etcd for the pubsub discovery")
+    parser.add_argument("--keep", action="store_true", help="keep the working directories with the process output")
+    parser.add_argument("--out", help="write the results as JSON to this file")
+    args = parser.parse_args()
+    args.deploy_dir = os.path.abspath(args.deploy_dir) #the processes run in their own working directory
+
+    missing = [c for a, s, r in itertools.product(args.admins, args.serializers, ("publisher", "subscriber"))
+               for c in [container(args.deploy_dir, a, s, r)] if not os.path.isfile(c)]
+    if missing:
+        sys.stderr.write("Missing containers (build with BUILD_PUBSUB_BENCHMARKS, and BUILD_PUBSUB_PSA_ZMQ for zmq):\n  %s\n"
+                         % "\n  ".join(missing))
+        return 1
+
+    root = tempfile.mkdtemp(prefix="pubsub_benchmark_")
+    etcd = None
+    if args.start_etcd:
+        etcd = subprocess.Popen(["etcd", "--data-dir", os.path.join(root, "etcd")],
+                                stdout=open(os.path.join(root, "etcd.log"), "w"), stderr=subprocess.STDOUT)
+        time.sleep(2)
+
+    results = []
+    try:
+        print("%-8s %-6s %8s %4s %4s %4s %12s %14s %10s %10s %10s %8s" % ("admin", "ser", "payload", "pub", "thr", "sub", "msgs/s",
+              "bytes/s", "p50 us", "p99 us", "p999 us", "lost"))
+        points = itertools.product(args.admins, args.serializers, args.payload_sizes, args.publishers,
+                                   args.publisher_threads, args.subscribers)
+        for index, (admin, serializer, payload_size, publishers, threads, subscribers) in enumerate(points):
+            if publishers * threads > 256:
+                sys.stderr.write("Skipping %i publishers with %i threads, at most 256 sending threads\n" % (publishers, threads))
+                continue
+            point = {"admin": admin, "serializer": serializer, "payload_size": payload_size, "publishers": publishers,
+                     "publisher_threads": threads, "subscribers": subscribers, "rate": args.rate}
+            result = run_point(args, point, os.path.join(root, "run_%i" % index))
+            results.append(result)
+            latency = result["latency_ns"]
+            print("%-8s %-6s %8i %4i %4i %4i %12.1f %14.1f %10.1f %10.1f %10.1f %8i%s" % (
+                admin, serializer, payload_size, publishers, threads, subscribers, result["msgs_per_second"],
+                result["bytes_per_second"], latency["p50"] / 1e3, latency["p99"] / 1e3, latency["p999"] / 1e3,
+                result["lost"], "  ERROR: " + result["error"] if "error" in result else ""))
+            sys.stdout.flush()
+    finally:
+        if etcd is not None:
+            stop([etcd])
+        if args.keep:
+            print("Output of the processes is kept in %s" % root)
+        else:
+            shutil.rmtree(root, ignore_errors=True)
+
+    output = {
+        "context": {
+            "date": datetime.datetime.now().isoformat(),
+            "host_name": socket.gethostname(),
+            "num_cpus": os.cpu_count(),
+            "warmup_s": args.warmup,
+            "duration_s": args.duration,
+            "rate": args.rate,
+        },
+        "results": results,
+        "benchmarks": [entry for result in results for entry in benchmark_entries(result)],
+    }
+    if args.out:
+        with open(args.out, "w") as f:
+            json.dump(output, f, indent=2)
+    return 1 if any("error" in r for r in results) else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,226 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+/*
+ * ps_benchmark_subscriber.c
+ *
+ * Subscriber of the pubsub benchmark. Counts the received messages and bytes, detects lost messages with the
+ * sequence number of every publisher and keeps a histogram of the latency (receive time - embedded send time). The
+ * results are written as JSON when the bundle is stopped.
+ *
+ *  \author    	<a href="mailto:dev@celix.apache.org">Apache Celix Project Team</a>
+ *  \copyright	Apache License, Version 2.0
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include "bundle_activator.h"
+#include "celix_threads.h"
+
+#include "subscriber.h"
+#include "benchmark_msg.h"
+
+// log-linear histogram: values below 16ns get their own bucket, above that every power of two has 16 sub buckets
+// (a relative error of at most 6.25%)
+#define HISTOGRAM_SUB_BUCKETS 16
+#define HISTOGRAM_BUCKETS ((64 - 3) * HISTOGRAM_SUB_BUCKETS)
+
+struct benchmark_subscriber {
+    pubsub_subscriber_t subSvc;
+    service_registration_pt registration;
+
+    celix_thread_mutex_t mutex; //protects the statistics below
+    uint64_t received;
+    uint64_t lost;
+    uint64_t payloadBytes;
+    int64_t firstReceived;
+    int64_t lastReceived;
+    int64_t nextSeqNr[BENCHMARK_MAX_PUBLISHERS]; //0 if nothing received yet from the publisher
+    uint64_t histogram[HISTOGRAM_BUCKETS];
+
+    unsigned int id;
+    const char *resultFile;
+};
+
+static int benchmarkSubscriber_receive(void *handle, const char *msgType, unsigned int msgTypeId, void *msg, pubsub_multipart_callbacks_t *callbacks, bool *release);
+static unsigned int benchmarkSubscriber_bucket(uint64_t value);
+static uint64_t benchmarkSubscriber_bucketValue(unsigned int bucket);
+static uint64_t benchmarkSubscriber_percentile(struct benchmark_subscriber *subscriber, double percentile);
+static void benchmarkSubscriber_writeResult(struct benchmark_subscriber *subscriber);
+
+celix_status_t bundleActivator_create(bundle_context_pt context, void **userData) {
+    struct benchmark_subscriber *subscriber = calloc(1, sizeof(*subscriber));
+    const char *id = NULL;
+
+    if (subscriber == NULL) {
+        return CELIX_ENOMEM;
+    }
+
+    celixThreadMutex_create(&subscriber->mutex, NULL);
+    bundleContext_getPropertyWithDefault(context, BENCHMARK_ID_PROPERTY, "0", &id);
+    subscriber->id = (unsigned int) strtoul(id, NULL, 10);
+    bundleContext_getProperty(context, BENCHMARK_RESULT_FILE_PROPERTY, &subscriber->resultFile);
+
+    *userData = subscriber;
+    return CELIX_SUCCESS;
+}
+
+celix_status_t bundleActivator_start(void *userData, bundle_context_pt context) {
+    struct benchmark_subscriber *subscriber = userData;
+    properties_pt props = properties_create();
+
+    properties_set(props, PUBSUB_SUBSCRIBER_TOPIC, BENCHMARK_TOPIC);
+    subscriber->subSvc.handle = subscriber;
+    subscriber->subSvc.receive = benchmarkSubscriber_receive;
+    return bundleContext_registerService(context, PUBSUB_SUBSCRIBER_SERVICE_NAME, &subscriber->subSvc, props, &subscriber->registration);
+}
+
+celix_status_t bundleActivator_stop(void *userData, bundle_context_pt context) {
+    struct benchmark_subscriber *subscriber = userData;
+
+    serviceRegistration_unregister(subscriber->registration);
+    subscriber->registration = NULL;
+    benchmarkSubscriber_writeResult(subscriber);
+    return CELIX_SUCCESS;
+}
+
+celix_status_t bundleActivator_destroy(void *userData, bundle_context_pt context) {
+    struct benchmark_subscriber *subscriber = userData;
+
+    celixThreadMutex_destroy(&subscriber->mutex);
+    free(subscriber);
+    return CELIX_SUCCESS;
+}
+
+static int benchmarkSubscriber_receive(void *handle, const char *msgType, unsigned int msgTypeId, void *msg, pubsub_multipart_callbacks_t *callbacks, bool *release) {
+    struct benchmark_subscriber *subscriber = handle;
+    benchmark_msg_t *benchmarkMsg = msg;
+    int64_t now = benchmark_now();
+    int64_t latency = now - benchmarkMsg->sendTime;
+
+    if (strcmp(msgType, BENCHMARK_MSG_NAME) != 0) {
+        return CELIX_SUCCESS;
+    }
+
+    celixThreadMutex_lock(&subscriber->mutex);
+    if (subscriber->received == 0) {
+        subscriber->firstReceived = now;
+    }
+    subscriber->lastReceived = now;
+    subscriber->received++;
+    subscriber->payloadBytes += benchmarkMsg->payload.len;
+    subscriber->histogram[benchmarkSubscriber_bucket(latency > 0 ? (uint64_t) latency : 0)]++;
+
+    if (benchmarkMsg->publisherId < BENCHMARK_MAX_PUBLISHERS) {
+        int64_t *next = &subscriber->nextSeqNr[benchmarkMsg->publisherId];
+        // messages sent before this subscriber was connected are not lost
+        if (*next != 0 && (int64_t) benchmarkMsg->seqNr + 1 > *next) {
+            subscriber->lost += benchmarkMsg->seqNr + 1 - *next;
+        }
+        if (*next == 0 || (int64_t) benchmarkMsg->seqNr + 2 > *next) {
+            *next = (int64_t) benchmarkMsg->seqNr + 2; //the expected sequence number + 1, a reordered message is not counted twice
+        }
+    }
+    celixThreadMutex_unlock(&subscriber->mutex);
+
+    return CELIX_SUCCESS;
+}
+
+static unsigned int benchmarkSubscriber_bucket(uint64_t value) {
+    unsigned int msb;
+
+    if (value < HISTOGRAM_SUB_BUCKETS) {
+        return (unsigned int) value;
+    }
+    msb = 63 - __builtin_clzll(value);
+    return (msb - 3) * HISTOGRAM_SUB_BUCKETS + (unsigned int) ((value >> (msb - 4)) & (HISTOGRAM_SUB_BUCKETS - 1));
+}
+
+/* The middle of the range of values in the bucket */
+static uint64_t benchmarkSubscriber_bucketValue(unsigned int bucket) {
+    unsigned int msb;
+    uint64_t lowest;
+
+    if (bucket < HISTOGRAM_SUB_BUCKETS) {
+        return bucket;
+    }
+    msb = bucket / HISTOGRAM_SUB_BUCKETS + 3;
+    lowest = (uint64_t) (HISTOGRAM_SUB_BUCKETS + bucket % HISTOGRAM_SUB_BUCKETS) << (msb - 4);
+    return lowest + ((1ULL << (msb - 4)) >> 1);
+}
+
+static uint64_t benchmarkSubscriber_percentile(struct benchmark_subscriber *subscriber, double percentile) {
+    uint64_t rank = (uint64_t) (percentile / 100.0 * subscriber->received + 0.5);
+    uint64_t count = 0;
+    unsigned int i;
+
+    rank = rank < 1 ? 1 : rank;
+    for (i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        count += subscriber->histogram[i];
+        if (count >= rank) {
+            return benchmarkSubscriber_bucketValue(i);
+        }
+    }
+    return 0;
+}
+
+static void benchmarkSubscriber_writeResult(struct benchmark_subscriber *subscriber) {
+    FILE *out = stdout;
+    double seconds;
+    bool first = true;
+    unsigned int i;
+
+    if (subscriber->resultFile != NULL) {
+        out = fopen(subscriber->resultFile, "w");
+        if (out == NULL) {
+            fprintf(stderr, "PUBSUB_BENCHMARK: Cannot write result file '%s': %s\n", subscriber->resultFile, strerror(errno));
+            return;
+        }
+    }
+
+    celixThreadMutex_lock(&subscriber->mutex);
+    seconds = (subscriber->lastReceived - subscriber->firstReceived) / 1e9;
+    fprintf(out, "{\"role\": \"subscriber\", \"id\": %u, \"received\": %llu, \"lost\": %llu, \"payload_bytes\": %llu, \"duration_s\": %.6f, "
+            "\"msgs_per_second\": %.3f, \"bytes_per_second\": %.3f, ",
+            subscriber->id, (unsigned long long) subscriber->received, (unsigned long long) subscriber->lost,
+            (unsigned long long) subscriber->payloadBytes, seconds,
+            seconds > 0.0 ? subscriber->received / seconds : 0.0, seconds > 0.0 ? subscriber->payloadBytes / seconds : 0.0);
+    fprintf(out, "\"latency_ns\": {\"p50\": %llu, \"p99\": %llu, \"p999\": %llu, \"max\": %llu}, \"latency_histogram\": [",
+            (unsigned long long) benchmarkSubscriber_percentile(subscriber, 50.0),
+            (unsigned long long) benchmarkSubscriber_percentile(subscriber, 99.0),
+            (unsigned long long) benchmarkSubscriber_percentile(subscriber, 99.9),
+            (unsigned long long) benchmarkSubscriber_percentile(subscriber, 100.0));
+    // sparse [value, count] pairs, the runner merges them to get the percentiles over all subscribers
+    for (i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        if (subscriber->histogram[i] > 0) {
+            fprintf(out, "%s[%llu, %llu]", first ? "" : ", ", (unsigned long long) benchmarkSubscriber_bucketValue(i), (unsigned long long) subscriber->histogram[i]);
+            first = false;
+        }
+    }
+    fprintf(out, "]}\n");
+    celixThreadMutex_unlock(&subscriber->mutex);
+
+    if (out != stdout) {
+        fclose(out);
+    } else {
+        fflush(out);
+    }
+}
@@ -33,9 +33,13 @@
 #include "utils.h"
 #include "service_factory.h"
 #include "version.h"
+#include "celix_metrics.h"
+#include "celix_trace.h"
 
 #include "topic_publication.h"
 #include "pubsub_common.h"
+#include "pubsub_send_descriptor.h"
+#include "pubsub_wire_header.h"
 #include "publisher.h"
 #include "large_udp.h"
 
@@ -54,6 +58,11 @@ struct topic_publication {
 	celix_thread_mutex_t tp_lock;
 	pubsub_serializer_service_t *serializer;
 	struct sockaddr_in destAddr;
+	unsigned int seqNr; //Of the next msg, protected by tp_lock
+
+	celix_metric_pt sendMetric;
+	celix_metric_pt sentBytesMetric;
+	celix_metric_pt sendFailuresMetric;
 };
 
 typedef struct publish_bundle_bound_service {
@@ -63,6 +72,7 @@ typedef struct publish_bundle_bound_service {
 	char *scope;
 	char *topic;
 	hash_map_pt msgTypes;
+	pubsub_send_descriptors_pt sendDescriptors; //indexed by local msg type id
 	unsigned short getCount;
 	celix_thread_mutex_t mp_lock;
 	largeUdp_pt largeUdpHandle;
@@ -70,7 +80,8 @@ typedef struct publish_bundle_bound_service {
 
 
 typedef struct pubsub_msg{
-	pubsub_msg_header_pt header;
+	unsigned char* header; //Encoded
+	size_t headerSize;
 	char* payload;
 	unsigned int payloadSize;
 } pubsub_msg_t;
@@ -114,6 +125,10 @@ celix_status_t pubsub_topicPublicationCreate(int sendSocket, pubsub_endpoint_pt
 
 	pub->serializer = best_serializer;
 
+	celixMetrics_get("pubsub_udpmc_send_ns", CELIX_METRIC_HISTOGRAM, &pub->sendMetric);
+	celixMetrics_get("pubsub_udpmc_sent_bytes_total", CELIX_METRIC_COUNTER, &pub->sentBytesMetric);
+	celixMetrics_get("pubsub_udpmc_send_failures_total", CELIX_METRIC_COUNTER, &pub->sendFailuresMetric);
+
 	pubsub_topicPublicationAddPublisherEP(pub,pubEP);
 
 	*out = pub;
@@ -148,6 +163,10 @@ celix_status_t pubsub_topicPublicationDestroy(topic_publication_pt pub){
 
 	celixThreadMutex_destroy(&(pub->tp_lock));
 
+	celixMetrics_release(pub->sendMetric);
+	celixMetrics_release(pub->sentBytesMetric);
+	celixMetrics_release(pub->sendFailuresMetric);
+
 	free(pub);
 
 	return status;
@@ -278,16 +297,14 @@ static celix_status_t pubsub_topicPublicationUngetService(void* handle, bundle_p
 }
 
 static bool send_pubsub_msg(publish_bundle_bound_service_pt bound, pubsub_msg_t* msg, bool last, pubsub_release_callback_t *releaseCallback){
-	const int iovec_len = 3; // header + size + payload
+	const int iovec_len = 2; // header + payload, the payload size follows from the datagram size
 	bool ret = true;
 
 	struct iovec msg_iovec[iovec_len];
 	msg_iovec[0].iov_base = msg->header;
-	msg_iovec[0].iov_len = sizeof(*msg->header);
-	msg_iovec[1].iov_base = &msg->payloadSize;
-	msg_iovec[1].iov_len = sizeof(msg->payloadSize);
-	msg_iovec[2].iov_base = msg->payload;
-	msg_iovec[2].iov_len = msg->payloadSize;
+	msg_iovec[0].iov_len = msg->headerSize;
+	msg_iovec[1].iov_base = msg->payload;
+	msg_iovec[1].iov_len = msg->payloadSize;
 
 	delay_first_send_for_late_joiners();
 
@@ -306,43 +323,44 @@ static bool send_pubsub_msg(publish_bundle_bound_service_pt bound, pubsub_msg_t*
 
 static int pubsub_topicPublicationSend(void* handle, unsigned int msgTypeId, const void *inMsg) {
 	int status = 0;
+	uint64_t start = celixMetrics_startTimer();
+	celix_trace_span_t span;
+	celix_trace_context_t traceContext;
 	publish_bundle_bound_service_pt bound = (publish_bundle_bound_service_pt) handle;
 
+	celixTrace_beginSpan("pubsub.send", bound->topic, &span);
+	celixTrace_currentContext(&traceContext);
+
 	celixThreadMutex_lock(&(bound->parent->tp_lock));
 	celixThreadMutex_lock(&(bound->mp_lock));
 
-	pubsub_msg_serializer_t* msgSer = (pubsub_msg_serializer_t*)hashMap_get(bound->msgTypes, (void*)(intptr_t)msgTypeId);
-
-	if (msgSer != NULL) {
-		int major=0, minor=0;
+	pubsub_send_descriptor_t* desc = pubsubSendDescriptors_get(bound->sendDescriptors, msgTypeId);
 
-		pubsub_msg_header_pt msg_hdr = calloc(1,sizeof(struct pubsub_msg_header));
-		strncpy(msg_hdr->topic,bound->topic,MAX_TOPIC_LEN-1);
-		msg_hdr->type = msgTypeId;
+	if (desc != NULL) {
+		pubsub_msg_serializer_t* msgSer = desc->msgSer;
 
-
-		if (msgSer->msgVersion != NULL){
-			version_getMajor(msgSer->msgVersion, &major);
-			version_getMinor(msgSer->msgVersion, &minor);
-			msg_hdr->major = major;
-			msg_hdr->minor = minor;
-		}
+		// the send is synchronous, the header can live on the stack
+		struct pubsub_msg_header msg_hdr = desc->header;
+		unsigned char encoded_hdr[PUBSUB_WIRE_HEADER_MAX_SIZE];
+		msg_hdr.seqNr = bound->parent->seqNr++;
+		msg_hdr.traceId = traceContext.traceId;
+		msg_hdr.spanId = traceContext.spanId;
 
 		void* serializedOutput = NULL;
 		size_t serializedOutputLen = 0;
 		msgSer->serialize(msgSer,inMsg,&serializedOutput, &serializedOutputLen);
 
-		pubsub_msg_t *msg = calloc(1,sizeof(pubsub_msg_t));
-		msg->header = msg_hdr;
-		msg->payload = (char*)serializedOutput;
-		msg->payloadSize = serializedOutputLen;
+		pubsub_msg_t msg;
+		msg.header = encoded_hdr;
+		msg.headerSize = pubsubWireHeader_encode(&msg_hdr, encoded_hdr);
+		msg.payload = (char*)serializedOutput;
+		msg.payloadSize = serializedOutputLen;
 
 
-		if(send_pubsub_msg(bound, msg,true, NULL) == false) {
+		celixMetrics_add(bound->parent->sentBytesMetric, serializedOutputLen);
+		if(send_pubsub_msg(bound, &msg,true, NULL) == false) {
 			status = -1;
 		}
-		free(msg_hdr);
-		free(msg);
 		free(serializedOutput);
 
 
@@ -351,15 +369,21 @@ static int pubsub_topicPublicationSend(void* handle, unsigned int msgTypeId, con
 		status=-1;
 	}
 
+	if(status != 0){
+		celixMetrics_add(bound->parent->sendFailuresMetric, 1);
+	}
+	celixMetrics_stopTimer(bound->parent->sendMetric, start);
+
 	celixThreadMutex_unlock(&(bound->mp_lock));
 	celixThreadMutex_unlock(&(bound->parent->tp_lock));
+	celixTrace_endSpan(&span);
 
 	return status;
 }
 
 static int pubsub_localMsgTypeIdForUUID(void* handle, const char* msgType, unsigned int* msgTypeId){
-	*msgTypeId = utils_stringHash(msgType);
-	return 0;
+	publish_bundle_bound_service_pt bound = (publish_bundle_bound_service_pt) handle;
+	return pubsubSendDescriptors_localMsgTypeId(bound->sendDescriptors, msgType, msgTypeId);
 }
 
 
@@ -388,6 +412,7 @@ static publish_bundle_bound_service_pt pubsub_createPublishBundleBoundService(to
 		pubsub_endpoint_pt pubEP = (pubsub_endpoint_pt)arrayList_get(bound->parent->pub_ep_list,0);
 		bound->scope=strdup(pubEP->scope);
 		bound->topic=strdup(pubEP->topic);
+		pubsubSendDescriptors_create(bound->topic, bound->msgTypes, &bound->sendDescriptors);
 		bound->largeUdpHandle = largeUdp_create(1);
 
 		bound->service.handle = bound;
@@ -404,6 +429,8 @@ static void pubsub_destroyPublishBundleBoundService(publish_bundle_bound_service
 
 	celixThreadMutex_lock(&boundSvc->mp_lock);
 
+	pubsubSendDescriptors_destroy(boundSvc->sendDescriptors);
+
 	if(boundSvc->parent->serializer != NULL && boundSvc->msgTypes != NULL){
 		boundSvc->parent->serializer->destroySerializerMap(boundSvc->parent->serializer->handle, boundSvc->msgTypes);
 	}
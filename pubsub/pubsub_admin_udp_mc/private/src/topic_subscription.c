@@ -39,12 +39,15 @@
 #include "celix_errno.h"
 #include "constants.h"
 #include "version.h"
+#include "celix_metrics.h"
+#include "celix_trace.h"
 
 #include "topic_subscription.h"
 #include "topic_publication.h"
 #include "subscriber.h"
 #include "publisher.h"
 #include "large_udp.h"
+#include "pubsub_wire_header.h"
 
 #include "pubsub_serializer.h"
 
@@ -61,6 +64,9 @@ struct topic_subscription{
 	bool running;
 	celix_thread_mutex_t ts_lock;
 	bundle_context_pt context;
+	char* topic;
+	unsigned int topicHash;
+	bool anyTopic;
 
 	pubsub_serializer_service_t *serializer;
 
@@ -78,6 +84,9 @@ struct topic_subscription{
 	//array_list_pt rawServices;
 	unsigned int nrSubscribers;
 	largeUdp_pt largeUdpHandle;
+
+	celix_metric_pt receiveMetric;
+	celix_metric_pt receivedBytesMetric;
 };
 
 typedef struct msg_map_entry{
@@ -101,6 +110,9 @@ celix_status_t pubsub_topicSubscriptionCreate(bundle_context_pt bundle_context,
 	topic_subscription_pt ts = (topic_subscription_pt) calloc(1,sizeof(*ts));
 	ts->context = bundle_context;
 	ts->ifIpAddress = strdup(ifIp);
+	ts->topic = strdup(topic);
+	ts->topicHash = pubsubWireHeader_topicHash(topic);
+	ts->anyTopic = strcmp(topic,PUBSUB_ANY_SUB_TOPIC)==0;
 #if defined(__APPLE__) && defined(__MACH__)
 	//TODO: Use kqueue for OSX
 #else
@@ -127,6 +139,9 @@ celix_status_t pubsub_topicSubscriptionCreate(bundle_context_pt bundle_context,
 
 	ts->largeUdpHandle = largeUdp_create(MAX_UDP_SESSIONS);
 
+	celixMetrics_get("pubsub_udpmc_receive_ns", CELIX_METRIC_HISTOGRAM, &ts->receiveMetric);
+	celixMetrics_get("pubsub_udpmc_received_bytes_total", CELIX_METRIC_COUNTER, &ts->receivedBytesMetric);
+
 	char filter[128];
 	memset(filter,0,128);
 	if(strncmp(PUBSUB_SUBSCRIBER_SCOPE_DEFAULT, scope, strlen(PUBSUB_SUBSCRIBER_SCOPE_DEFAULT)) == 0) {
@@ -198,6 +213,10 @@ celix_status_t pubsub_topicSubscriptionDestroy(topic_subscription_pt ts){
 
 	celixThreadMutex_destroy(&ts->ts_lock);
 
+	celixMetrics_release(ts->receiveMetric);
+	celixMetrics_release(ts->receivedBytesMetric);
+
+	free(ts->topic);
 	free(ts);
 
 	return status;
@@ -493,7 +512,28 @@ static celix_status_t topicsub_subscriberUntracked(void * handle, service_refere
 }
 
 
-static void process_msg(topic_subscription_pt sub,pubsub_udp_msg_t *msg){
+static void process_msg(topic_subscription_pt sub,const char* data,unsigned int size){
+
+	uint64_t start = celixMetrics_startTimer();
+	struct pubsub_msg_header header;
+	size_t headerSize = 0;
+	celix_trace_span_t span;
+
+	size_t payloadSize = 0;
+	int rc = pubsubWireHeader_decodeDatagram(data, size, &header, &headerSize, &payloadSize);
+	if (rc != 0) {
+		printf("PSA_UDP_MC_TS: Cannot decode message header (%s).\n", rc == -2 ? "unsupported version" : "invalid size");
+		return;
+	}
+	if (!sub->anyTopic && header.topicHash != sub->topicHash) {
+		return;
+	}
+
+	const char* payload = data + headerSize;
+	celix_trace_context_t remote = { header.traceId, header.spanId };
+
+	celixMetrics_add(sub->receivedBytesMetric, payloadSize);
+	celixTrace_beginRemoteSpan("pubsub.receive", sub->topic, &remote, &span);
 
 	celixThreadMutex_lock(&sub->ts_lock);
 	hash_map_iterator_pt iter = hashMapIterator_create(sub->servicesMap);
@@ -502,17 +542,17 @@ static void process_msg(topic_subscription_pt sub,pubsub_udp_msg_t *msg){
 		pubsub_subscriber_pt subsvc = hashMapEntry_getKey(entry);
 		hash_map_pt msgTypes = hashMapEntry_getValue(entry);
 
-		pubsub_msg_serializer_t *msgSer = hashMap_get(msgTypes,(void*)(uintptr_t )msg->header.type);
+		pubsub_msg_serializer_t *msgSer = hashMap_get(msgTypes,(void*)(uintptr_t )header.type);
 		if (msgSer == NULL) {
-			printf("PSA_UDP_MC_TS: Serializer not available for message %d.\n",msg->header.type);
+			printf("PSA_UDP_MC_TS: Serializer not available for message %d.\n",header.type);
 		}
 		else{
 			void *msgInst = NULL;
-			bool validVersion = checkVersion(msgSer->msgVersion,&msg->header);
+			bool validVersion = checkVersion(msgSer->msgVersion,&header);
 
 			if(validVersion){
 
-				celix_status_t status = msgSer->deserialize(msgSer, (const void *) msg->payload, 0, &msgInst);
+				celix_status_t status = msgSer->deserialize(msgSer, (const void *) payload, 0, &msgInst);
 
 				if (status == CELIX_SUCCESS) {
 					bool release = true;
@@ -521,7 +561,10 @@ static void process_msg(topic_subscription_pt sub,pubsub_udp_msg_t *msg){
 					mp_callbacks.localMsgTypeIdForMsgType = pubsub_localMsgTypeIdForMsgType;
 					mp_callbacks.getMultipart = NULL;
 
-					subsvc->receive(subsvc->handle, msgSer->msgName, msg->header.type, msgInst, &mp_callbacks, &release);
+					celix_trace_span_t dispatchSpan;
+					celixTrace_beginSpan("pubsub.dispatch", msgSer->msgName, &dispatchSpan);
+					subsvc->receive(subsvc->handle, msgSer->msgName, header.type, msgInst, &mp_callbacks, &release);
+					celixTrace_endSpan(&dispatchSpan);
 
 					if(release){
 						msgSer->freeMsg(msgSer,msgInst);
@@ -537,13 +580,16 @@ static void process_msg(topic_subscription_pt sub,pubsub_udp_msg_t *msg){
 				version_getMajor(msgSer->msgVersion,&major);
 				version_getMinor(msgSer->msgVersion,&minor);
 				printf("PSA_UDP_MC_TS: Version mismatch for primary message '%s' (have %d.%d, received %u.%u). NOT sending any part of the whole message.\n",
-						msgSer->msgName,major,minor,msg->header.major,msg->header.minor);
+						msgSer->msgName,major,minor,header.major,header.minor);
 			}
 
 		}
 	}
 	hashMapIterator_destroy(iter);
 	celixThreadMutex_unlock(&sub->ts_lock);
+
+	celixMetrics_stopTimer(sub->receiveMetric, start);
+	celixTrace_endSpan(&span);
 }
 
 static void* udp_recv_thread_func(void * arg) {
@@ -555,8 +601,8 @@ static void* udp_recv_thread_func(void * arg) {
 	while (sub->running) {
 		int nfds = 0;
 		if(nfds > 0) {
-			pubsub_udp_msg_t* udpMsg = NULL;
-			process_msg(sub, udpMsg);
+			char* udpMsg = NULL;
+			process_msg(sub, udpMsg, 0);
 		}
 	}
 #else
@@ -570,13 +616,13 @@ static void* udp_recv_thread_func(void * arg) {
 			unsigned int size;
 			if(largeUdp_dataAvailable(sub->largeUdpHandle, events[i].data.fd, &index, &size) == true) {
 				// Handle data
-				pubsub_udp_msg_t *udpMsg = NULL;
+				char *udpMsg = NULL;
 				if(largeUdp_read(sub->largeUdpHandle, index, (void**)&udpMsg, size) != 0) {
 					printf("PSA_UDP_MC_TS: ERROR largeUdp_read with index %d\n", index);
 					continue;
 				}
 
-				process_msg(sub, udpMsg);
+				process_msg(sub, udpMsg, size);
 
 				free(udpMsg);
 			}
@@ -0,0 +1,184 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+/*
+ * pubsub_wire_header_test.cpp
+ *
+ *  \author     <a href="mailto:dev@celix.apache.org">Apache Celix Project Team</a>
+ *  \copyright  Apache License, Version 2.0
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/TestHarness_c.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+extern "C"
+{
+#include "pubsub_wire_header.h"
+}
+
+int main(int argc, char** argv) {
+	return RUN_ALL_TESTS(argc, argv);
+}
+
+static const char PAYLOAD[] = "{\"temperature\":21}";
+
+/* Builds a datagram as sent by the legacy udp publishers: header (layoutSize bytes of it), payload size, payload */
+static size_t legacyDatagram(char *buf, size_t layoutSize, uint64_t traceId) {
+	struct pubsub_legacy_msg_header legacy;
+	unsigned int payloadSize = sizeof(PAYLOAD);
+
+	memset(&legacy, 0, sizeof(legacy));
+	strcpy(legacy.topic, "weather");
+	legacy.type = 42;
+	legacy.major = 1;
+	legacy.minor = 3;
+	legacy.traceId = traceId;
+	legacy.spanId = 7;
+
+	memcpy(buf, &legacy, layoutSize);
+	memcpy(buf + layoutSize, &payloadSize, sizeof(payloadSize));
+	memcpy(buf + layoutSize + sizeof(payloadSize), PAYLOAD, sizeof(PAYLOAD));
+	return layoutSize + sizeof(payloadSize) + sizeof(PAYLOAD);
+}
+
+TEST_GROUP(pubsub_wire_header) {
+	char buf[sizeof(struct pubsub_legacy_msg_header) + sizeof(unsigned int) + sizeof(PAYLOAD)];
+	struct pubsub_msg_header header;
+	size_t headerSize;
+	size_t payloadSize;
+
+	void setup() {
+		memset(buf, 0, sizeof(buf));
+		headerSize = 0;
+		payloadSize = 0;
+	}
+
+	void teardown() {
+	}
+};
+
+TEST(pubsub_wire_header, encodeDecode) {
+	struct pubsub_msg_header in;
+	memset(&in, 0, sizeof(in));
+	in.topicHash = pubsubWireHeader_topicHash("weather");
+	in.type = 0xdeadbeef;
+	in.major = 3;
+	in.minor = 7;
+	in.seqNr = 0x01020304;
+
+	size_t size = pubsubWireHeader_encode(&in, (unsigned char *) buf);
+	LONGS_EQUAL(PUBSUB_WIRE_HEADER_SIZE, size);
+	LONGS_EQUAL(0xef, (unsigned char) buf[12]); //little endian
+
+	unsigned char prefix[PUBSUB_WIRE_HEADER_PREFIX_SIZE];
+	pubsubWireHeader_prefix("weather", prefix);
+	CHECK(memcmp(prefix, buf, sizeof(prefix)) == 0);
+
+	LONGS_EQUAL(0, pubsubWireHeader_decode(buf, size, &header, &headerSize));
+	LONGS_EQUAL(size, headerSize);
+	LONGS_EQUAL(in.topicHash, header.topicHash);
+	LONGS_EQUAL(in.type, header.type);
+	LONGS_EQUAL(in.seqNr, header.seqNr);
+	LONGS_EQUAL(0, header.flags);
+
+	in.traceId = 0x1122334455667788ULL;
+	in.spanId = 9;
+	size = pubsubWireHeader_encode(&in, (unsigned char *) buf);
+	LONGS_EQUAL(PUBSUB_WIRE_HEADER_MAX_SIZE, size);
+	LONGS_EQUAL(0, pubsubWireHeader_decode(buf, size, &header, &headerSize));
+	CHECK(header.traceId == in.traceId);
+	CHECK(header.flags & PUBSUB_WIRE_FLAG_TRACE);
+
+	LONGS_EQUAL(-1, pubsubWireHeader_decode(buf, PUBSUB_WIRE_HEADER_SIZE - 1, &header, &headerSize));
+	buf[1] = PUBSUB_WIRE_HEADER_VERSION + 1;
+	LONGS_EQUAL(-2, pubsubWireHeader_decode(buf, size, &header, &headerSize));
+}
+
+TEST(pubsub_wire_header, decodeDatagram) {
+	struct pubsub_msg_header in;
+	memset(&in, 0, sizeof(in));
+	in.topicHash = pubsubWireHeader_topicHash("weather");
+	in.type = 42;
+
+	size_t size = pubsubWireHeader_encode(&in, (unsigned char *) buf);
+	memcpy(buf + size, PAYLOAD, sizeof(PAYLOAD));
+	LONGS_EQUAL(0, pubsubWireHeader_decodeDatagram(buf, size + sizeof(PAYLOAD), &header, &headerSize, &payloadSize));
+	LONGS_EQUAL(size, headerSize);
+	LONGS_EQUAL(sizeof(PAYLOAD), payloadSize);
+	STRCMP_EQUAL(PAYLOAD, buf + headerSize);
+}
+
+TEST(pubsub_wire_header, decodeBaselineDatagram) {
+	size_t layoutSize = offsetof(struct pubsub_legacy_msg_header, traceId);
+	size_t size = legacyDatagram(buf, layoutSize, 0);
+
+	LONGS_EQUAL(0, pubsubWireHeader_decodeDatagram(buf, size, &header, &headerSize, &payloadSize));
+	LONGS_EQUAL(layoutSize + sizeof(unsigned int), headerSize);
+	LONGS_EQUAL(sizeof(PAYLOAD), payloadSize);
+	STRCMP_EQUAL(PAYLOAD, buf + headerSize);
+	LONGS_EQUAL(pubsubWireHeader_topicHash("weather"), header.topicHash);
+	LONGS_EQUAL(42, header.type);
+	LONGS_EQUAL(1, header.major);
+	LONGS_EQUAL(3, header.minor);
+	LONGS_EQUAL(PUBSUB_WIRE_FLAG_LEGACY, header.flags);
+	CHECK(header.traceId == 0);
+}
+
+TEST(pubsub_wire_header, decodeLegacyTraceDatagram) {
+	size_t size = legacyDatagram(buf, sizeof(struct pubsub_legacy_msg_header), 0x0102030405060708ULL);
+
+	LONGS_EQUAL(0, pubsubWireHeader_decodeDatagram(buf, size, &header, &headerSize, &payloadSize));
+	LONGS_EQUAL(sizeof(struct pubsub_legacy_msg_header) + sizeof(unsigned int), headerSize);
+	LONGS_EQUAL(sizeof(PAYLOAD), payloadSize);
+	STRCMP_EQUAL(PAYLOAD, buf + headerSize);
+	CHECK(header.traceId == 0x0102030405060708ULL);
+	CHECK(header.spanId == 7);
+	CHECK(header.flags & PUBSUB_WIRE_FLAG_TRACE);
+}
+
+TEST(pubsub_wire_header, decodeTruncatedLegacyDatagram) {
+	size_t size = legacyDatagram(buf, offsetof(struct pubsub_legacy_msg_header, traceId), 0);
+
+	LONGS_EQUAL(-1, pubsubWireHeader_decodeDatagram(buf, size - 1, &header, &headerSize, &payloadSize));
+}
+
+TEST(pubsub_wire_header, decodeLegacyFrame) {
+	struct pubsub_legacy_msg_header legacy;
+	size_t withoutTrace = offsetof(struct pubsub_legacy_msg_header, traceId);
+
+	memset(&legacy, 0, sizeof(legacy));
+	strcpy(legacy.topic, "weather");
+	legacy.type = 42;
+	legacy.traceId = 5;
+
+	LONGS_EQUAL(0, pubsubWireHeader_decode(&legacy, sizeof(legacy), &header, &headerSize));
+	LONGS_EQUAL(sizeof(legacy), headerSize);
+	CHECK(header.traceId == 5);
+
+	LONGS_EQUAL(0, pubsubWireHeader_decode(&legacy, withoutTrace, &header, &headerSize));
+	LONGS_EQUAL(withoutTrace, headerSize);
+	CHECK(header.traceId == 0);
+	LONGS_EQUAL(42, header.type);
+
+	LONGS_EQUAL(-1, pubsubWireHeader_decode(&legacy, withoutTrace - 1, &header, &headerSize));
+}
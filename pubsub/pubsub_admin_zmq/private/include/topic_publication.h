@@ -33,6 +33,9 @@
 
 #include "pubsub_serializer.h"
 
+#define PSA_ZMQ_SEND_QUEUE_SIZE "PSA_ZMQ_SEND_QUEUE_SIZE"
+#define PSA_ZMQ_DEFAULT_SEND_QUEUE_SIZE 10000
+
 typedef struct topic_publication *topic_publication_pt;
 
 celix_status_t pubsub_topicPublicationCreate(bundle_context_pt bundle_context,pubsub_endpoint_pt pubEP, pubsub_serializer_service_t *best_serializer, char* bindIP, unsigned int basePort, unsigned int maxPort, topic_publication_pt *out);
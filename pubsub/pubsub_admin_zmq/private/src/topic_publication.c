@@ -30,6 +30,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <sched.h>
 
 #include "array_list.h"
 #include "celixbool.h"
@@ -37,9 +38,14 @@
 #include "utils.h"
 #include "service_factory.h"
 #include "version.h"
+#include "celix_metrics.h"
+#include "celix_trace.h"
 
 #include "pubsub_common.h"
 #include "pubsub_utils.h"
+#include "pubsub_send_descriptor.h"
+#include "pubsub_wire_header.h"
+#include "pubsub_mpsc_queue.h"
 #include "publisher.h"
 
 #include "topic_publication.h"
@@ -58,8 +64,7 @@
 #define FIRST_SEND_DELAY	2
 
 struct topic_publication {
-	zsock_t* zmq_socket;
-	celix_thread_mutex_t socket_lock; //Protects zmq_socket access
+	zsock_t* zmq_socket; //Only used by the send thread
 	zcert_t * zmq_cert;
 	char* endpoint;
 	service_registration_pt svcFactoryReg;
@@ -67,6 +72,19 @@ struct topic_publication {
 	hash_map_pt boundServices; //<bundle_pt,bound_service>
 	pubsub_serializer_service_t *serializer;
 	celix_thread_mutex_t tp_lock;
+
+	pubsub_mpsc_queue_t sendQueue; //<pubsub_msg>, multipart msgs are queued as one chain of parts
+	volatile unsigned int queued; //Nr of msgs in sendQueue
+	volatile unsigned int seqNr; //Of the next msg
+	unsigned int maxQueued;
+	celix_thread_t sendThread;
+	celix_thread_mutex_t send_lock; //Protects running, used with sendCond to wait for msgs
+	celix_thread_cond_t sendCond;
+	bool running;
+
+	celix_metric_pt sendMetric;
+	celix_metric_pt sentBytesMetric;
+	celix_metric_pt sendFailuresMetric;
 };
 
 typedef struct publish_bundle_bound_service {
@@ -75,22 +93,29 @@ typedef struct publish_bundle_bound_service {
 	bundle_pt bundle;
 	char *topic;
 	hash_map_pt msgTypes;
+	pubsub_send_descriptors_pt sendDescriptors; //indexed by local msg type id
 	unsigned short getCount;
-	celix_thread_mutex_t mp_lock; //Protects publish_bundle_bound_service data structure
+	celix_thread_mutex_t mp_lock; //Protects the multipart msg in progress
 	bool mp_send_in_progress;
-	array_list_pt mp_parts;
+	struct pubsub_msg* mp_first;
+	struct pubsub_msg* mp_last;
 }* publish_bundle_bound_service_pt;
 
 /* Note: correct locking order is
  * 1. tp_lock
  * 2. mp_lock
- * 3. socket_lock
  *
- * tp_lock and socket_lock are independent.
+ * Sending does not take tp_lock: msgs are serialized without locks and handed to the send thread through the
+ * lock-free sendQueue, only the parts of a multipart msg are collected under mp_lock of the bound service.
+ * send_lock is only taken to wake up the send thread.
  */
 
 typedef struct pubsub_msg{
-	pubsub_msg_header_pt header;
+	pubsub_mpsc_queue_node_t node; //Must be the first member
+	struct pubsub_msg* nextPart; //Next part of a multipart msg, NULL for the last part
+	unsigned int type;
+	unsigned char header[PUBSUB_WIRE_HEADER_MAX_SIZE]; //Encoded
+	size_t headerSize;
 	char* payload;
 	int payloadSize;
 }* pubsub_msg_pt;
@@ -107,6 +132,12 @@ static int pubsub_topicPublicationSend(void* handle,unsigned int msgTypeId, cons
 static int pubsub_topicPublicationSendMultipart(void *handle, unsigned int msgTypeId, const void *inMsg, int flags);
 static int pubsub_localMsgTypeIdForUUID(void* handle, const char* msgType, unsigned int* msgTypeId);
 
+static pubsub_msg_pt pubsub_createMsg(pubsub_send_descriptor_t* desc, const void* inMsg, celix_trace_context_t* traceContext, unsigned int seqNr);
+static void pubsub_destroyMsg(pubsub_msg_pt msg);
+static int pubsub_topicPublicationAddPart(publish_bundle_bound_service_pt bound, pubsub_msg_pt msg, int flags);
+static int pubsub_topicPublicationEnqueue(topic_publication_pt pub, pubsub_msg_pt msg);
+static void* pubsub_topicPublicationSendThread(void* handle);
+
 static void delay_first_send_for_late_joiners(void);
 
 celix_status_t pubsub_topicPublicationCreate(bundle_context_pt bundle_context, pubsub_endpoint_pt pubEP, pubsub_serializer_service_t *best_serializer, char* bindIP, unsigned int basePort, unsigned int maxPort, topic_publication_pt *out){
@@ -216,7 +247,21 @@ celix_status_t pubsub_topicPublicationCreate(bundle_context_pt bundle_context, p
 	pub->zmq_socket = socket;
 	pub->serializer = best_serializer;
 
-	celixThreadMutex_create(&(pub->socket_lock),NULL);
+	const char* maxQueued = NULL;
+	bundleContext_getPropertyWithDefault(bundle_context, PSA_ZMQ_SEND_QUEUE_SIZE, NULL, &maxQueued);
+	pub->maxQueued = maxQueued != NULL ? strtoul(maxQueued, NULL, 10) : 0;
+	if (pub->maxQueued == 0) {
+		pub->maxQueued = PSA_ZMQ_DEFAULT_SEND_QUEUE_SIZE;
+	}
+	pubsubMpscQueue_init(&pub->sendQueue);
+	celixThreadMutex_create(&(pub->send_lock),NULL);
+	celixThreadCondition_init(&(pub->sendCond),NULL);
+	pub->running = true;
+	celixThread_create(&(pub->sendThread), NULL, pubsub_topicPublicationSendThread, pub);
+
+	celixMetrics_get("pubsub_zmq_send_ns", CELIX_METRIC_HISTOGRAM, &pub->sendMetric);
+	celixMetrics_get("pubsub_zmq_sent_bytes_total", CELIX_METRIC_COUNTER, &pub->sentBytesMetric);
+	celixMetrics_get("pubsub_zmq_send_failures_total", CELIX_METRIC_COUNTER, &pub->sendFailuresMetric);
 
 #ifdef BUILD_WITH_ZMQ_SECURITY
 	if (pubEP->is_secure){
@@ -234,6 +279,13 @@ celix_status_t pubsub_topicPublicationCreate(bundle_context_pt bundle_context, p
 celix_status_t pubsub_topicPublicationDestroy(topic_publication_pt pub){
 	celix_status_t status = CELIX_SUCCESS;
 
+	/* The send thread sends the queued msgs before it stops */
+	celixThreadMutex_lock(&(pub->send_lock));
+	pub->running = false;
+	celixThreadCondition_signal(&(pub->sendCond));
+	celixThreadMutex_unlock(&(pub->send_lock));
+	celixThread_join(pub->sendThread, NULL);
+
 	celixThreadMutex_lock(&(pub->tp_lock));
 
 	free(pub->endpoint);
@@ -257,11 +309,14 @@ celix_status_t pubsub_topicPublicationDestroy(topic_publication_pt pub){
 
 	celixThreadMutex_destroy(&(pub->tp_lock));
 
-	celixThreadMutex_lock(&(pub->socket_lock));
 	zsock_destroy(&(pub->zmq_socket));
-	celixThreadMutex_unlock(&(pub->socket_lock));
 
-	celixThreadMutex_destroy(&(pub->socket_lock));
+	celixThreadCondition_destroy(&(pub->sendCond));
+	celixThreadMutex_destroy(&(pub->send_lock));
+
+	celixMetrics_release(pub->sendMetric);
+	celixMetrics_release(pub->sentBytesMetric);
+	celixMetrics_release(pub->sendFailuresMetric);
 
 	free(pub);
 
@@ -397,49 +452,32 @@ static celix_status_t pubsub_topicPublicationUngetService(void* handle, bundle_p
 	return CELIX_SUCCESS;
 }
 
-static bool send_pubsub_msg(zsock_t* zmq_socket, pubsub_msg_pt msg, bool last){
+static bool send_pubsub_msg(zsock_t* zmq_socket, pubsub_msg_pt msg){
 
 	bool ret = true;
 
-	zframe_t* headerMsg = zframe_new(msg->header, sizeof(struct pubsub_msg_header));
-	if (headerMsg == NULL) ret=false;
-	zframe_t* payloadMsg = zframe_new(msg->payload, msg->payloadSize);
-	if (payloadMsg == NULL) ret=false;
-
 	delay_first_send_for_late_joiners();
 
-	if( zframe_send(&headerMsg,zmq_socket, ZFRAME_MORE) == -1) ret=false;
-
-	if(!last){
-		if( zframe_send(&payloadMsg,zmq_socket, ZFRAME_MORE) == -1) ret=false;
-	}
-	else{
-		if( zframe_send(&payloadMsg,zmq_socket, 0) == -1) ret=false;
-	}
-
-	if (!ret){
-		zframe_destroy(&headerMsg);
-		zframe_destroy(&payloadMsg);
-	}
-
-	free(msg->header);
-	free(msg->payload);
-	free(msg);
-
-	return ret;
+	/* All parts of a multipart msg are sent back to back, the send thread is the only user of the socket */
+	while(msg != NULL){
+		pubsub_msg_pt next = msg->nextPart;
 
-}
+		if(ret){
+			zframe_t* headerMsg = zframe_new(msg->header, msg->headerSize);
+			if (headerMsg == NULL) ret=false;
+			zframe_t* payloadMsg = zframe_new(msg->payload, msg->payloadSize);
+			if (payloadMsg == NULL) ret=false;
 
-static bool send_pubsub_mp_msg(zsock_t* zmq_socket, array_list_pt mp_msg_parts){
+			if( ret && zframe_send(&headerMsg,zmq_socket, ZFRAME_MORE) == -1) ret=false;
+			if( ret && zframe_send(&payloadMsg,zmq_socket, next != NULL ? ZFRAME_MORE : 0) == -1) ret=false;
 
-	bool ret = true;
+			zframe_destroy(&headerMsg);
+			zframe_destroy(&payloadMsg);
+		}
 
-	unsigned int i = 0;
-	unsigned int mp_num = arrayList_size(mp_msg_parts);
-	for(;i<mp_num;i++){
-		ret = ret && send_pubsub_msg(zmq_socket, (pubsub_msg_pt)arrayList_get(mp_msg_parts,i), (i==mp_num-1));
+		pubsub_destroyMsg(msg);
+		msg = next;
 	}
-	arrayList_clear(mp_msg_parts);
 
 	return ret;
 
@@ -454,101 +492,203 @@ static int pubsub_topicPublicationSend(void* handle, unsigned int msgTypeId, con
 static int pubsub_topicPublicationSendMultipart(void *handle, unsigned int msgTypeId, const void *inMsg, int flags){
 
 	int status = 0;
+	uint64_t start = celixMetrics_startTimer();
+	celix_trace_span_t span;
+	celix_trace_context_t traceContext;
 
 	publish_bundle_bound_service_pt bound = (publish_bundle_bound_service_pt) handle;
 
-	celixThreadMutex_lock(&(bound->parent->tp_lock));
-	celixThreadMutex_lock(&(bound->mp_lock));
-	if( (flags & PUBSUB_PUBLISHER_FIRST_MSG) && !(flags & PUBSUB_PUBLISHER_LAST_MSG) && bound->mp_send_in_progress){ //means a real mp_msg
-		printf("PSA_ZMQ_TP: Multipart send already in progress. Cannot process a new one.\n");
-		celixThreadMutex_unlock(&(bound->mp_lock));
-		celixThreadMutex_unlock(&(bound->parent->tp_lock));
-		return -3;
-	}
+	celixTrace_beginSpan("pubsub.send", bound->topic, &span);
+	celixTrace_currentContext(&traceContext);
 
-	pubsub_msg_serializer_t* msgSer = (pubsub_msg_serializer_t*)hashMap_get(bound->msgTypes, (void*)(uintptr_t)msgTypeId);
+	/* The descriptors do not change while the bound service exists, serializing does not need a lock */
+	pubsub_send_descriptor_t* desc = pubsubSendDescriptors_get(bound->sendDescriptors, msgTypeId);
 
-	if (msgSer!= NULL) {
-		int major=0, minor=0;
+	if (desc != NULL) {
+		pubsub_msg_pt msg = pubsub_createMsg(desc, inMsg, &traceContext, __sync_fetch_and_add(&bound->parent->seqNr, 1));
 
-		pubsub_msg_header_pt msg_hdr = calloc(1,sizeof(struct pubsub_msg_header));
-		strncpy(msg_hdr->topic,bound->topic,MAX_TOPIC_LEN-1);
-		msg_hdr->type = msgTypeId;
+		if (msg == NULL) {
+			printf("PSA_ZMQ_TP: Cannot serialize message %u.\n", msgTypeId);
+			status = -1;
+		} else {
+			celixMetrics_add(bound->parent->sentBytesMetric, msg->payloadSize);
 
-		if (msgSer->msgVersion != NULL){
-			version_getMajor(msgSer->msgVersion, &major);
-			version_getMinor(msgSer->msgVersion, &minor);
-			msg_hdr->major = major;
-			msg_hdr->minor = minor;
+			if (flags == (PUBSUB_PUBLISHER_FIRST_MSG | PUBSUB_PUBLISHER_LAST_MSG)) { //Normal send case
+				status = pubsub_topicPublicationEnqueue(bound->parent, msg);
+			} else {
+				status = pubsub_topicPublicationAddPart(bound, msg, flags);
+			}
 		}
+	} else {
+        printf("PSA_ZMQ_TP: No msg serializer available for msg type id %d\n", msgTypeId);
+		status=-1;
+	}
+
+	if(status != 0){
+		celixMetrics_add(bound->parent->sendFailuresMetric, 1);
+	}
+	celixMetrics_stopTimer(bound->parent->sendMetric, start);
+
+	celixTrace_endSpan(&span);
+
+	return status;
+
+}
+
+static pubsub_msg_pt pubsub_createMsg(pubsub_send_descriptor_t* desc, const void* inMsg, celix_trace_context_t* traceContext, unsigned int seqNr){
 
-		void *serializedOutput = NULL;
-		size_t serializedOutputLen = 0;
-		msgSer->serialize(msgSer,inMsg,&serializedOutput, &serializedOutputLen);
+	void *serializedOutput = NULL;
+	size_t serializedOutputLen = 0;
 
-		pubsub_msg_pt msg = calloc(1,sizeof(struct pubsub_msg));
-		msg->header = msg_hdr;
-		msg->payload = (char*)serializedOutput;
-		msg->payloadSize = serializedOutputLen;
-		bool snd = true;
+	if (desc->msgSer->serialize(desc->msgSer, inMsg, &serializedOutput, &serializedOutputLen) != CELIX_SUCCESS) {
+		free(serializedOutput);
+		return NULL;
+	}
+
+	pubsub_msg_pt msg = malloc(sizeof(struct pubsub_msg));
+	if (msg == NULL) {
+		free(serializedOutput);
+		return NULL;
+	}
+	struct pubsub_msg_header header = desc->header;
+	header.seqNr = seqNr;
+	header.traceId = traceContext->traceId;
+	header.spanId = traceContext->spanId;
+
+	msg->nextPart = NULL;
+	msg->type = header.type;
+	msg->headerSize = pubsubWireHeader_encode(&header, msg->header);
+	msg->payload = (char*)serializedOutput;
+	msg->payloadSize = serializedOutputLen;
+
+	return msg;
+}
+
+static void pubsub_destroyMsg(pubsub_msg_pt msg){
+	free(msg->payload);
+	free(msg);
+}
+
+static int pubsub_topicPublicationAddPart(publish_bundle_bound_service_pt bound, pubsub_msg_pt msg, int flags){
+
+	int status = 0;
+	pubsub_msg_pt complete = NULL;
 
-		switch(flags){
-		case PUBSUB_PUBLISHER_FIRST_MSG:
+	celixThreadMutex_lock(&(bound->mp_lock));
+	switch(flags){
+	case PUBSUB_PUBLISHER_FIRST_MSG:
+		if(bound->mp_send_in_progress){
+			printf("PSA_ZMQ_TP: Multipart send already in progress. Cannot process a new one.\n");
+			status = -3;
+		}
+		else{
 			bound->mp_send_in_progress = true;
-			arrayList_add(bound->mp_parts,msg);
-			break;
-		case PUBSUB_PUBLISHER_PART_MSG:
-			if(!bound->mp_send_in_progress){
-				printf("PSA_ZMQ_TP: ERROR: received msg part without the first part.\n");
-				status = -4;
-			}
-			else{
-				arrayList_add(bound->mp_parts,msg);
-			}
-			break;
-		case PUBSUB_PUBLISHER_LAST_MSG:
-			if(!bound->mp_send_in_progress){
-				printf("PSA_ZMQ_TP: ERROR: received end msg without the first part.\n");
-				status = -4;
-			}
-			else{
-				arrayList_add(bound->mp_parts,msg);
-				snd = send_pubsub_mp_msg(bound->parent->zmq_socket,bound->mp_parts);
+			bound->mp_first = msg;
+			bound->mp_last = msg;
+		}
+		break;
+	case PUBSUB_PUBLISHER_PART_MSG:
+	case PUBSUB_PUBLISHER_LAST_MSG:
+		if(!bound->mp_send_in_progress){
+			printf("PSA_ZMQ_TP: ERROR: received %s without the first part.\n", flags == PUBSUB_PUBLISHER_PART_MSG ? "msg part" : "end msg");
+			status = -4;
+		}
+		else{
+			bound->mp_last->nextPart = msg;
+			bound->mp_last = msg;
+			if(flags == PUBSUB_PUBLISHER_LAST_MSG){
+				complete = bound->mp_first;
+				bound->mp_first = NULL;
+				bound->mp_last = NULL;
 				bound->mp_send_in_progress = false;
 			}
-			break;
-		case PUBSUB_PUBLISHER_FIRST_MSG | PUBSUB_PUBLISHER_LAST_MSG:	//Normal send case
-			snd = send_pubsub_msg(bound->parent->zmq_socket,msg,true);
-			break;
-		default:
-			printf("PSA_ZMQ_TP: ERROR: Invalid MP flags combination\n");
-			status = -4;
-			break;
 		}
+		break;
+	default:
+		printf("PSA_ZMQ_TP: ERROR: Invalid MP flags combination\n");
+		status = -4;
+		break;
+	}
+	celixThreadMutex_unlock(&(bound->mp_lock));
 
-		if(status==-4){
-			free(msg);
-		}
+	if(status != 0){
+		pubsub_destroyMsg(msg);
+	}
+	else if(complete != NULL){
+		/* The parts are queued as one chain, so they cannot interleave with msgs of other senders */
+		status = pubsub_topicPublicationEnqueue(bound->parent, complete);
+	}
 
-		if(!snd){
-			printf("PSA_ZMQ_TP: Failed to send %s message %u.\n",flags == (PUBSUB_PUBLISHER_FIRST_MSG | PUBSUB_PUBLISHER_LAST_MSG) ? "single" : "multipart", msgTypeId);
+	return status;
+}
+
+static int pubsub_topicPublicationEnqueue(topic_publication_pt pub, pubsub_msg_pt msg){
+
+	unsigned int queued = __sync_fetch_and_add(&pub->queued, 1);
+
+	if(queued >= pub->maxQueued){
+		__sync_fetch_and_sub(&pub->queued, 1);
+		while(msg != NULL){
+			pubsub_msg_pt next = msg->nextPart;
+			pubsub_destroyMsg(msg);
+			msg = next;
 		}
+		return -5;
+	}
 
-	} else {
-        printf("PSA_ZMQ_TP: No msg serializer available for msg type id %d\n", msgTypeId);
-		status=-1;
+	pubsubMpscQueue_push(&pub->sendQueue, &msg->node);
+
+	if(queued == 0){
+		/* The send thread can only be waiting when the queue was empty */
+		celixThreadMutex_lock(&(pub->send_lock));
+		celixThreadCondition_signal(&(pub->sendCond));
+		celixThreadMutex_unlock(&(pub->send_lock));
 	}
 
-	celixThreadMutex_unlock(&(bound->mp_lock));
-	celixThreadMutex_unlock(&(bound->parent->tp_lock));
+	return 0;
+}
 
-	return status;
+static void* pubsub_topicPublicationSendThread(void* handle){
+
+	topic_publication_pt pub = (topic_publication_pt) handle;
+	bool running = true;
+
+	while(running){
+		pubsub_msg_pt msg = (pubsub_msg_pt) pubsubMpscQueue_pop(&pub->sendQueue);
 
+		if(msg != NULL){
+			unsigned int type = msg->type;
+			bool multipart = msg->nextPart != NULL;
+
+			__sync_fetch_and_sub(&pub->queued, 1);
+			if(!send_pubsub_msg(pub->zmq_socket, msg)){
+				printf("PSA_ZMQ_TP: Failed to send %s message %u.\n", multipart ? "multipart" : "single", type);
+				celixMetrics_add(pub->sendFailuresMetric, 1);
+			}
+		}
+		else{
+			bool waited = false;
+
+			celixThreadMutex_lock(&(pub->send_lock));
+			while(pub->queued == 0 && pub->running){
+				celixThreadCondition_wait(&(pub->sendCond), &(pub->send_lock));
+				waited = true;
+			}
+			running = pub->running || pub->queued > 0;
+			celixThreadMutex_unlock(&(pub->send_lock));
+
+			if(running && !waited){
+				sched_yield(); //A push is in progress
+			}
+		}
+	}
+
+	return NULL;
 }
 
 static int pubsub_localMsgTypeIdForUUID(void* handle, const char* msgType, unsigned int* msgTypeId){
-	*msgTypeId = utils_stringHash(msgType);
-	return 0;
+	publish_bundle_bound_service_pt bound = (publish_bundle_bound_service_pt) handle;
+	return pubsubSendDescriptors_localMsgTypeId(bound->sendDescriptors, msgType, msgTypeId);
 }
 
 
@@ -577,10 +717,9 @@ static publish_bundle_bound_service_pt pubsub_createPublishBundleBoundService(to
 			tp->serializer->createSerializerMap(tp->serializer->handle,bundle,&bound->msgTypes);
 		}
 
-		arrayList_create(&bound->mp_parts);
-
 		pubsub_endpoint_pt pubEP = (pubsub_endpoint_pt)arrayList_get(bound->parent->pub_ep_list,0);
 		bound->topic=strdup(pubEP->topic);
+		pubsubSendDescriptors_create(bound->topic, bound->msgTypes, &bound->sendDescriptors);
 
 		bound->service.handle = bound;
 		bound->service.localMsgTypeIdForMsgType = pubsub_localMsgTypeIdForUUID;
@@ -598,13 +737,16 @@ static void pubsub_destroyPublishBundleBoundService(publish_bundle_bound_service
 
 	celixThreadMutex_lock(&boundSvc->mp_lock);
 
+	pubsubSendDescriptors_destroy(boundSvc->sendDescriptors);
 
 	if(boundSvc->parent->serializer != NULL && boundSvc->msgTypes != NULL){
 		boundSvc->parent->serializer->destroySerializerMap(boundSvc->parent->serializer->handle, boundSvc->msgTypes);
 	}
 
-	if(boundSvc->mp_parts!=NULL){
-		arrayList_destroy(boundSvc->mp_parts);
+	while(boundSvc->mp_first!=NULL){ //Unfinished multipart msg
+		pubsub_msg_pt next = boundSvc->mp_first->nextPart;
+		pubsub_destroyMsg(boundSvc->mp_first);
+		boundSvc->mp_first = next;
 	}
 
 	if(boundSvc->topic!=NULL){
@@ -43,10 +43,13 @@
 #include "celix_errno.h"
 #include "constants.h"
 #include "version.h"
+#include "celix_metrics.h"
+#include "celix_trace.h"
 
 #include "subscriber.h"
 #include "publisher.h"
 #include "pubsub_utils.h"
+#include "pubsub_wire_header.h"
 
 #ifdef BUILD_WITH_ZMQ_SECURITY
 #include "zmq_crypto.h"
@@ -69,6 +72,9 @@ struct topic_subscription{
 	bool running;
 	celix_thread_mutex_t ts_lock;
 	bundle_context_pt context;
+	char* topic;
+	unsigned int topicHash;
+	bool anyTopic;
 
 	pubsub_serializer_service_t *serializer;
 
@@ -81,6 +87,9 @@ struct topic_subscription{
 	celix_thread_mutex_t pendingDisconnections_lock;
 
 	unsigned int nrSubscribers;
+
+	celix_metric_pt receiveMetric;
+	celix_metric_pt receivedBytesMetric;
 };
 
 typedef struct complete_zmq_msg{
@@ -102,6 +111,7 @@ static celix_status_t topicsub_subscriberTracked(void * handle, service_referenc
 static celix_status_t topicsub_subscriberUntracked(void * handle, service_reference_pt reference, void * service);
 static void* zmq_recv_thread_func(void* arg);
 static bool checkVersion(version_pt msgVersion,pubsub_msg_header_pt hdr);
+static bool decodeHeader(topic_subscription_pt sub, zframe_t* frame, pubsub_msg_header_pt hdr);
 static void sigusr1_sighandler(int signo);
 static int pubsub_localMsgTypeIdForMsgType(void* handle, const char* msgType, unsigned int* msgTypeId);
 static int pubsub_getMultipart(void *handle, unsigned int msgTypeId, bool retain, void **part);
@@ -170,11 +180,18 @@ celix_status_t pubsub_topicSubscriptionCreate(bundle_context_pt bundle_context,
 		zsock_set_subscribe (zmq_s, "");
 	}
 	else{
-		zsock_set_subscribe (zmq_s, topic);
+		/* zsock_set_subscribe stops at the first 0 byte, the topic prefix of the header is binary */
+		unsigned char prefix[PUBSUB_WIRE_HEADER_PREFIX_SIZE];
+		pubsubWireHeader_prefix(topic, prefix);
+		zmq_setsockopt(zsock_resolve(zmq_s), ZMQ_SUBSCRIBE, prefix, sizeof(prefix));
+		zsock_set_subscribe (zmq_s, topic); //Legacy headers start with the topic
 	}
 
 	topic_subscription_pt ts = (topic_subscription_pt) calloc(1,sizeof(*ts));
 	ts->context = bundle_context;
+	ts->topic = strdup(topic);
+	ts->topicHash = pubsubWireHeader_topicHash(topic);
+	ts->anyTopic = strcmp(topic,PUBSUB_ANY_SUB_TOPIC)==0;
 	ts->zmq_socket = zmq_s;
 	ts->running = false;
 	ts->nrSubscribers = 0;
@@ -195,6 +212,9 @@ celix_status_t pubsub_topicSubscriptionCreate(bundle_context_pt bundle_context,
 	celixThreadMutex_create(&ts->pendingConnections_lock, NULL);
 	celixThreadMutex_create(&ts->pendingDisconnections_lock, NULL);
 
+	celixMetrics_get("pubsub_zmq_receive_ns", CELIX_METRIC_HISTOGRAM, &ts->receiveMetric);
+	celixMetrics_get("pubsub_zmq_received_bytes_total", CELIX_METRIC_COUNTER, &ts->receivedBytesMetric);
+
 	char filter[128];
 	memset(filter,0,128);
 	if(strncmp(PUBSUB_SUBSCRIBER_SCOPE_DEFAULT,scope,strlen(PUBSUB_SUBSCRIBER_SCOPE_DEFAULT)) == 0) {
@@ -261,6 +281,10 @@ celix_status_t pubsub_topicSubscriptionDestroy(topic_subscription_pt ts){
 
 	celixThreadMutex_destroy(&ts->ts_lock);
 
+	celixMetrics_release(ts->receiveMetric);
+	celixMetrics_release(ts->receivedBytesMetric);
+
+	free(ts->topic);
 	free(ts);
 
 	return status;
@@ -436,10 +460,20 @@ static celix_status_t topicsub_subscriberUntracked(void * handle, service_refere
 
 static void process_msg(topic_subscription_pt sub,array_list_pt msg_list){
 
-	pubsub_msg_header_pt first_msg_hdr = (pubsub_msg_header_pt)zframe_data(((complete_zmq_msg_pt)arrayList_get(msg_list,0))->header);
+	uint64_t start = celixMetrics_startTimer();
+	zframe_t *first_header = ((complete_zmq_msg_pt)arrayList_get(msg_list,0))->header;
+	struct pubsub_msg_header first_hdr;
+	pubsub_msg_header_pt first_msg_hdr = &first_hdr;
+	celix_trace_span_t span;
+	celix_trace_context_t remote = { 0, 0 };
+
+	bool valid = decodeHeader(sub, first_header, first_msg_hdr);
+	remote.traceId = first_msg_hdr->traceId;
+	remote.spanId = first_msg_hdr->spanId;
+	celixTrace_beginRemoteSpan("pubsub.receive", sub->topic, &remote, &span);
 
 	hash_map_iterator_pt iter = hashMapIterator_create(sub->servicesMap);
-	while (hashMapIterator_hasNext(iter)) {
+	while (valid && hashMapIterator_hasNext(iter)) {
 		hash_map_entry_pt entry = hashMapIterator_nextEntry(iter);
 		pubsub_subscriber_pt subsvc = hashMapEntry_getKey(entry);
 		hash_map_pt msgTypes = hashMapEntry_getValue(entry);
@@ -463,7 +497,10 @@ static void process_msg(topic_subscription_pt sub,array_list_pt msg_list){
 					mp_callbacks.handle = mp_handle;
 					mp_callbacks.localMsgTypeIdForMsgType = pubsub_localMsgTypeIdForMsgType;
 					mp_callbacks.getMultipart = pubsub_getMultipart;
+					celix_trace_span_t dispatchSpan;
+					celixTrace_beginSpan("pubsub.dispatch", msgSer->msgName, &dispatchSpan);
 					subsvc->receive(subsvc->handle, msgSer->msgName, first_msg_hdr->type, msgInst, &mp_callbacks, &release);
+					celixTrace_endSpan(&dispatchSpan);
 
 					if(release){
 						msgSer->freeMsg(msgSer,msgInst); // pubsubSerializer_freeMsg(msgType, msgInst);
@@ -488,10 +525,12 @@ static void process_msg(topic_subscription_pt sub,array_list_pt msg_list){
 		}
 	}
 	hashMapIterator_destroy(iter);
+	celixTrace_endSpan(&span);
 
 	int i = 0;
 	for(;i<arrayList_size(msg_list);i++){
 		complete_zmq_msg_pt c_msg = arrayList_get(msg_list,i);
+		celixMetrics_add(sub->receivedBytesMetric, zframe_size(c_msg->payload));
 		zframe_destroy(&(c_msg->header));
 		zframe_destroy(&(c_msg->payload));
 		free(c_msg);
@@ -499,6 +538,7 @@ static void process_msg(topic_subscription_pt sub,array_list_pt msg_list){
 
 	arrayList_destroy(msg_list);
 
+	celixMetrics_stopTimer(sub->receiveMetric, start);
 }
 
 static void* zmq_recv_thread_func(void * arg) {
@@ -519,8 +559,6 @@ static void* zmq_recv_thread_func(void * arg) {
 		}
 		else {
 
-			pubsub_msg_header_pt hdr = (pubsub_msg_header_pt) zframe_data(headerMsg);
-
 			if (zframe_more(headerMsg)) {
 
 				zframe_t* payloadMsg = zframe_recv(sub->zmq_socket);
@@ -587,7 +625,7 @@ static void* zmq_recv_thread_func(void * arg) {
 			} //zframe_more(headerMsg)
 			else {
 				free(headerMsg);
-				printf("PSA_ZMQ_TS: received message %u for topic %s without payload!\n", hdr->type, hdr->topic);
+				printf("PSA_ZMQ_TS: received message for topic %s without payload!\n", sub->topic);
 			}
 
 		} // headerMsg != NULL
@@ -639,6 +677,19 @@ static bool checkVersion(version_pt msgVersion,pubsub_msg_header_pt hdr){
 	return check;
 }
 
+/* Decodes a header frame, false when it cannot be decoded or is for another topic (a legacy header of which the
+ * topic only starts with the subscribed topic). The parts of a multipart msg are not checked (sub is NULL) */
+static bool decodeHeader(topic_subscription_pt sub, zframe_t* frame, pubsub_msg_header_pt hdr){
+	size_t headerSize = 0;
+	int rc = pubsubWireHeader_decode(zframe_data(frame), zframe_size(frame), hdr, &headerSize);
+
+	if(rc != 0){
+		printf("PSA_ZMQ_TS: Cannot decode message header (%s).\n", rc == -2 ? "unsupported version" : "too short");
+		return false;
+	}
+	return sub == NULL || sub->anyTopic || hdr->topicHash == sub->topicHash;
+}
+
 static int pubsub_localMsgTypeIdForMsgType(void* handle, const char* msgType, unsigned int* msgTypeId){
 	*msgTypeId = utils_stringHash(msgType);
 	return 0;
@@ -680,9 +731,13 @@ static mp_handle_pt create_mp_handle(hash_map_pt svc_msg_db,array_list_pt rcv_ms
 	int i=1; //We skip the first message, it will be handle differently
 	for(;i<arrayList_size(rcv_msg_list);i++){
 		complete_zmq_msg_pt c_msg = (complete_zmq_msg_pt)arrayList_get(rcv_msg_list,i);
-		pubsub_msg_header_pt header = (pubsub_msg_header_pt)zframe_data(c_msg->header);
+		struct pubsub_msg_header hdr;
+		pubsub_msg_header_pt header = &hdr;
+		pubsub_msg_serializer_t* msgSer = NULL;
 
-		pubsub_msg_serializer_t* msgSer = hashMap_get(svc_msg_db, (void*)(uintptr_t)(header->type));
+		if (decodeHeader(NULL, c_msg->header, header)) {
+			msgSer = hashMap_get(svc_msg_db, (void*)(uintptr_t)(header->type));
+		}
 
 		if (msgSer!= NULL) {
 			void *msgInst = NULL;
@@ -20,11 +20,14 @@
 #ifndef PUBLISHER_ENDPOINT_ANNOUNCE_H_
 #define PUBLISHER_ENDPOINT_ANNOUNCE_H_
 
+#include "array_list.h"
 #include "pubsub_endpoint.h"
 
 struct publisher_endpoint_announce {
 	void *handle;
 	celix_status_t (*announcePublisher)(void *handle, pubsub_endpoint_pt pubEP);
+	/* optional, announces a batch of publishers at once. NULL if only announcePublisher is supported */
+	celix_status_t (*announcePublishers)(void *handle, array_list_pt pubEPs);
 	celix_status_t (*removePublisher)(void *handle, pubsub_endpoint_pt pubEP);
 	celix_status_t (*interestedInTopic)(void* handle, const char *scope, const char *topic);
 	celix_status_t (*uninterestedInTopic)(void* handle, const char *scope, const char *topic);
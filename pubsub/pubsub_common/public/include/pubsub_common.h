@@ -27,6 +27,8 @@
 #ifndef PUBSUB_COMMON_H_
 #define PUBSUB_COMMON_H_
 
+#include <stdint.h>
+
 #define PUBSUB_SERIALIZER_SERVICE 		"pubsub_serializer"
 #define PUBSUB_ADMIN_SERVICE 			"pubsub_admin"
 #define PUBSUB_DISCOVERY_SERVICE		"pubsub_discovery"
@@ -39,11 +41,26 @@
 #define MAX_SCOPE_LEN                           1024
 #define MAX_TOPIC_LEN				1024
 
+/* Decoded header of a pubsub msg, see pubsub_wire_header.h for the encoding on the wire */
 struct pubsub_msg_header{
+	unsigned int topicHash; //pubsubWireHeader_topicHash of the topic
+	unsigned int type;
+	unsigned char major;
+	unsigned char minor;
+	unsigned short flags; //PUBSUB_WIRE_FLAG_*
+	unsigned int seqNr; //per publication, wraps around
+	uint64_t traceId; //trace context of the sending span (celix_trace.h), 0 when the message is not traced
+	uint64_t spanId;
+};
+
+/* The header as sent before the versioned wire header, only decoded to receive from older publishers */
+struct pubsub_legacy_msg_header{
 	char topic[MAX_TOPIC_LEN];
 	unsigned int type;
 	unsigned char major;
 	unsigned char minor;
+	uint64_t traceId;
+	uint64_t spanId;
 };
 
 typedef struct pubsub_msg_header* pubsub_msg_header_pt;
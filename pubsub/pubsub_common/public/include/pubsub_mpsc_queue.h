@@ -0,0 +1,47 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+/*
+ * pubsub_mpsc_queue.h
+ *
+ * Intrusive lock-free multi producer, single consumer queue (Vyukov). Push is wait-free and can be called from any
+ * thread, pop must only be called from one thread at a time. The queue does not allocate, the queued elements embed
+ * a pubsub_mpsc_queue_node_t. Pop can return NULL while a push is in progress, even though the queue is not empty.
+ *
+ *  \author    	<a href="mailto:dev@celix.apache.org">Apache Celix Project Team</a>
+ *  \copyright	Apache License, Version 2.0
+ */
+
+#ifndef PUBSUB_MPSC_QUEUE_H_
+#define PUBSUB_MPSC_QUEUE_H_
+
+typedef struct pubsub_mpsc_queue_node {
+	struct pubsub_mpsc_queue_node* volatile next;
+} pubsub_mpsc_queue_node_t;
+
+typedef struct pubsub_mpsc_queue {
+	pubsub_mpsc_queue_node_t* volatile head; //last pushed node, producers
+	pubsub_mpsc_queue_node_t* tail; //next node to pop, consumer
+	pubsub_mpsc_queue_node_t stub;
+} pubsub_mpsc_queue_t;
+
+void pubsubMpscQueue_init(pubsub_mpsc_queue_t* queue);
+void pubsubMpscQueue_push(pubsub_mpsc_queue_t* queue, pubsub_mpsc_queue_node_t* node);
+pubsub_mpsc_queue_node_t* pubsubMpscQueue_pop(pubsub_mpsc_queue_t* queue);
+
+#endif /* PUBSUB_MPSC_QUEUE_H_ */
@@ -0,0 +1,83 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+/*
+ * pubsub_send_descriptor.h
+ *
+ * Per bound publisher service table with everything a send needs per msg type: the msg serializer and a
+ * ready header (topic hash, type and version). The local msg type ids handed out by localMsgTypeIdForMsgType
+ * are the compact indexes (starting at 1) in this table, so a send is an array lookup.
+ *
+ *  \author    	<a href="mailto:dev@celix.apache.org">Apache Celix Project Team</a>
+ *  \copyright	Apache License, Version 2.0
+ */
+
+#ifndef PUBSUB_SEND_DESCRIPTOR_H_
+#define PUBSUB_SEND_DESCRIPTOR_H_
+
+#include "celix_errno.h"
+#include "hash_map.h"
+
+#include "pubsub_common.h"
+#include "pubsub_serializer.h"
+
+typedef struct pubsub_send_descriptor {
+	pubsub_msg_serializer_t* msgSer;
+	struct pubsub_msg_header header; //seqNr and trace context are not filled in, they differ per msg
+} pubsub_send_descriptor_t;
+
+typedef struct pubsub_send_descriptors {
+	unsigned int size;
+	pubsub_send_descriptor_t* descriptors; //ordered on msg name, local msg type id i is at index i-1
+} pubsub_send_descriptors_t;
+
+typedef struct pubsub_send_descriptors* pubsub_send_descriptors_pt;
+
+/**
+ * Creates the descriptors for all msg serializers in msgTypes (the serializer map of the bound bundle, can be NULL).
+ * The serializers are borrowed, msgTypes must outlive the descriptors.
+ */
+celix_status_t pubsubSendDescriptors_create(const char* topic, hash_map_pt msgTypes, pubsub_send_descriptors_pt* out);
+void pubsubSendDescriptors_destroy(pubsub_send_descriptors_pt descriptors);
+
+/**
+ * Implementation of the publisher localMsgTypeIdForMsgType. Returns 0 and the compact local id (> 0) when the
+ * bundle has a msg serializer for msgType, otherwise -1 and msgTypeId 0.
+ */
+int pubsubSendDescriptors_localMsgTypeId(pubsub_send_descriptors_pt descriptors, const char* msgType, unsigned int* msgTypeId);
+
+/**
+ * Slow path of pubsubSendDescriptors_get for publishers still sending with the msg id (hash of the msg name)
+ * instead of the local id.
+ */
+pubsub_send_descriptor_t* pubsubSendDescriptors_getByMsgId(pubsub_send_descriptors_pt descriptors, unsigned int msgId);
+
+/**
+ * Returns the descriptor for a local msg type id, or NULL when unknown (or when descriptors is NULL).
+ */
+static inline pubsub_send_descriptor_t* pubsubSendDescriptors_get(pubsub_send_descriptors_pt descriptors, unsigned int msgTypeId) {
+	if (descriptors == NULL) {
+		return NULL;
+	}
+	if (msgTypeId - 1 < descriptors->size) { //also rejects 0
+		return &descriptors->descriptors[msgTypeId - 1];
+	}
+	return pubsubSendDescriptors_getByMsgId(descriptors, msgTypeId);
+}
+
+#endif /* PUBSUB_SEND_DESCRIPTOR_H_ */
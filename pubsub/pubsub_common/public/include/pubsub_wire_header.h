@@ -0,0 +1,89 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+/*
+ * pubsub_wire_header.h
+ *
+ * Encoding of the pubsub msg header on the wire, shared by the admins. All fields are little endian:
+ *
+ *   offset  size
+ *   0       1     magic (PUBSUB_WIRE_HEADER_MAGIC)
+ *   1       1     version (PUBSUB_WIRE_HEADER_VERSION)
+ *   2       4     topic hash
+ *   6       1     msg major version
+ *   7       1     msg minor version
+ *   8       2     flags
+ *   10      2     header size, including the extensions. The payload starts after it
+ *   12      4     msg type id
+ *   16      4     sequence number
+ *   20      16    trace id and span id, only with PUBSUB_WIRE_FLAG_TRACE
+ *
+ * The first bytes (magic, version, topic hash) are the same for every msg of a topic, the zmq admin subscribes on
+ * them. A legacy header starts with the topic string, the magic is never the first byte of a (UTF-8) topic.
+ *
+ *  \author    	<a href="mailto:dev@celix.apache.org">Apache Celix Project Team</a>
+ *  \copyright	Apache License, Version 2.0
+ */
+
+#ifndef PUBSUB_WIRE_HEADER_H_
+#define PUBSUB_WIRE_HEADER_H_
+
+#include <stddef.h>
+
+#include "pubsub_common.h"
+
+#define PUBSUB_WIRE_HEADER_MAGIC		0xFE
+#define PUBSUB_WIRE_HEADER_VERSION		1
+
+#define PUBSUB_WIRE_HEADER_SIZE			20 //without extensions
+#define PUBSUB_WIRE_HEADER_TRACE_SIZE		16
+#define PUBSUB_WIRE_HEADER_MAX_SIZE		(PUBSUB_WIRE_HEADER_SIZE + PUBSUB_WIRE_HEADER_TRACE_SIZE)
+#define PUBSUB_WIRE_HEADER_PREFIX_SIZE		6 //magic, version and topic hash
+
+#define PUBSUB_WIRE_FLAG_TRACE			0x0001 //trace context extension present
+#define PUBSUB_WIRE_FLAG_LEGACY			0x8000 //decoded from a legacy header, never sent
+
+unsigned int pubsubWireHeader_topicHash(const char* topic);
+
+/**
+ * Writes the topic prefix of the encoded headers for topic, PUBSUB_WIRE_HEADER_PREFIX_SIZE bytes.
+ */
+void pubsubWireHeader_prefix(const char* topic, unsigned char* prefix);
+
+/**
+ * Encodes header in buf (at least PUBSUB_WIRE_HEADER_MAX_SIZE bytes) and returns the encoded size. The trace
+ * extension is added when header->traceId is set.
+ */
+size_t pubsubWireHeader_encode(const struct pubsub_msg_header* header, unsigned char* buf);
+
+/**
+ * Decodes the header at the start of data, a versioned or a legacy (struct pubsub_legacy_msg_header) header. A
+ * legacy header must be all of data (a zmq frame), its size tells whether it has the trace ids. headerSize is set to the offset of the payload, legacy headers get PUBSUB_WIRE_FLAG_LEGACY.
+ * Returns 0 on success, -1 when data is too short and -2 for an unsupported version.
+ */
+int pubsubWireHeader_decode(const void* data, size_t size, struct pubsub_msg_header* header, size_t* headerSize);
+
+/**
+ * Decodes the header of a udp datagram of size bytes. Next to the headers of pubsubWireHeader_decode this accepts
+ * legacy datagrams, which have the payload size between the header and the payload. headerSize is set to the offset
+ * of the payload and payloadSize to its size. Returns 0 on success, -1 when the datagram does not fit any layout
+ * and -2 for an unsupported version.
+ */
+int pubsubWireHeader_decodeDatagram(const void* data, size_t size, struct pubsub_msg_header* header, size_t* headerSize, size_t* payloadSize);
+
+#endif /* PUBSUB_WIRE_HEADER_H_ */
@@ -0,0 +1,76 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+/*
+ * pubsub_mpsc_queue.c
+ *
+ *  \author    	<a href="mailto:dev@celix.apache.org">Apache Celix Project Team</a>
+ *  \copyright	Apache License, Version 2.0
+ */
+
+#include <stddef.h>
+
+#include "pubsub_mpsc_queue.h"
+
+void pubsubMpscQueue_init(pubsub_mpsc_queue_t* queue){
+	queue->stub.next = NULL;
+	queue->head = &queue->stub;
+	queue->tail = &queue->stub;
+}
+
+void pubsubMpscQueue_push(pubsub_mpsc_queue_t* queue, pubsub_mpsc_queue_node_t* node){
+	pubsub_mpsc_queue_node_t* prev;
+
+	node->next = NULL;
+	__sync_synchronize(); //the node content must be visible before the node is linked
+	prev = __sync_lock_test_and_set(&queue->head, node);
+	// between the exchange and this store the consumer sees the queue as empty from prev on
+	prev->next = node;
+}
+
+pubsub_mpsc_queue_node_t* pubsubMpscQueue_pop(pubsub_mpsc_queue_t* queue){
+	pubsub_mpsc_queue_node_t* tail = queue->tail;
+	pubsub_mpsc_queue_node_t* next = tail->next;
+
+	if (tail == &queue->stub) {
+		if (next == NULL) {
+			return NULL;
+		}
+		queue->tail = next;
+		tail = next;
+		next = next->next;
+	}
+
+	if (next != NULL) {
+		queue->tail = next;
+		return tail;
+	}
+
+	if (tail != queue->head) {
+		return NULL; //a push is in progress
+	}
+
+	// tail is the last node, push the stub behind it so tail can be handed out
+	pubsubMpscQueue_push(queue, &queue->stub);
+	next = tail->next;
+	if (next != NULL) {
+		queue->tail = next;
+		return tail;
+	}
+	return NULL;
+}
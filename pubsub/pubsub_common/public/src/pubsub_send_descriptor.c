@@ -0,0 +1,114 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+/*
+ * pubsub_send_descriptor.c
+ *
+ *  \author    	<a href="mailto:dev@celix.apache.org">Apache Celix Project Team</a>
+ *  \copyright	Apache License, Version 2.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "version.h"
+
+#include "pubsub_wire_header.h"
+#include "pubsub_send_descriptor.h"
+
+static int pubsubSendDescriptors_compareName(const void* a, const void* b);
+
+celix_status_t pubsubSendDescriptors_create(const char* topic, hash_map_pt msgTypes, pubsub_send_descriptors_pt* out){
+	pubsub_send_descriptors_pt descriptors = calloc(1, sizeof(*descriptors));
+	unsigned int size = msgTypes != NULL ? (unsigned int)hashMap_size(msgTypes) : 0;
+	unsigned int i = 0;
+
+	if (descriptors == NULL) {
+		return CELIX_ENOMEM;
+	}
+	if (size > 0) {
+		descriptors->descriptors = calloc(size, sizeof(*descriptors->descriptors));
+		if (descriptors->descriptors == NULL) {
+			free(descriptors);
+			return CELIX_ENOMEM;
+		}
+
+		hash_map_iterator_pt iter = hashMapIterator_create(msgTypes);
+		while (hashMapIterator_hasNext(iter) && i < size) {
+			descriptors->descriptors[i++].msgSer = hashMapIterator_nextValue(iter);
+		}
+		hashMapIterator_destroy(iter);
+		// the ids should not depend on the hash map layout
+		qsort(descriptors->descriptors, i, sizeof(*descriptors->descriptors), pubsubSendDescriptors_compareName);
+	}
+	descriptors->size = i;
+
+	for (i = 0; i < descriptors->size; i++) {
+		pubsub_send_descriptor_t* desc = &descriptors->descriptors[i];
+		int major = 0, minor = 0;
+
+		desc->header.topicHash = pubsubWireHeader_topicHash(topic);
+		desc->header.type = desc->msgSer->msgId;
+		if (desc->msgSer->msgVersion != NULL) {
+			version_getMajor(desc->msgSer->msgVersion, &major);
+			version_getMinor(desc->msgSer->msgVersion, &minor);
+		}
+		desc->header.major = (unsigned char)major;
+		desc->header.minor = (unsigned char)minor;
+	}
+
+	*out = descriptors;
+	return CELIX_SUCCESS;
+}
+
+void pubsubSendDescriptors_destroy(pubsub_send_descriptors_pt descriptors){
+	if (descriptors != NULL) {
+		free(descriptors->descriptors);
+		free(descriptors);
+	}
+}
+
+int pubsubSendDescriptors_localMsgTypeId(pubsub_send_descriptors_pt descriptors, const char* msgType, unsigned int* msgTypeId){
+	unsigned int i;
+
+	for (i = 0; descriptors != NULL && i < descriptors->size; i++) {
+		if (strcmp(descriptors->descriptors[i].msgSer->msgName, msgType) == 0) {
+			*msgTypeId = i + 1;
+			return 0;
+		}
+	}
+	*msgTypeId = 0;
+	return -1;
+}
+
+pubsub_send_descriptor_t* pubsubSendDescriptors_getByMsgId(pubsub_send_descriptors_pt descriptors, unsigned int msgId){
+	unsigned int i;
+
+	for (i = 0; i < descriptors->size; i++) {
+		if (descriptors->descriptors[i].msgSer->msgId == msgId) {
+			return &descriptors->descriptors[i];
+		}
+	}
+	return NULL;
+}
+
+static int pubsubSendDescriptors_compareName(const void* a, const void* b){
+	const pubsub_send_descriptor_t* descA = a;
+	const pubsub_send_descriptor_t* descB = b;
+	return strcmp(descA->msgSer->msgName, descB->msgSer->msgName);
+}
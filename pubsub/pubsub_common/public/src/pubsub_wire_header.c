@@ -0,0 +1,208 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+/*
+ * pubsub_wire_header.c
+ *
+ *  \author    	<a href="mailto:dev@celix.apache.org">Apache Celix Project Team</a>
+ *  \copyright	Apache License, Version 2.0
+ */
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "utils.h"
+
+#include "pubsub_wire_header.h"
+
+static int pubsubWireHeader_decodeLegacy(const unsigned char* buf, size_t size, size_t layoutSize, struct pubsub_msg_header* header, size_t* headerSize);
+static bool pubsubWireHeader_legacyDatagramFits(const unsigned char* buf, size_t size, size_t layoutSize);
+
+static void pubsubWireHeader_put16(unsigned char* buf, unsigned int val){
+	buf[0] = (unsigned char)val;
+	buf[1] = (unsigned char)(val >> 8);
+}
+
+static void pubsubWireHeader_put32(unsigned char* buf, unsigned int val){
+	pubsubWireHeader_put16(buf, val & 0xFFFF);
+	pubsubWireHeader_put16(buf + 2, val >> 16);
+}
+
+static void pubsubWireHeader_put64(unsigned char* buf, uint64_t val){
+	pubsubWireHeader_put32(buf, (unsigned int)(val & 0xFFFFFFFF));
+	pubsubWireHeader_put32(buf + 4, (unsigned int)(val >> 32));
+}
+
+static unsigned int pubsubWireHeader_get16(const unsigned char* buf){
+	return buf[0] | (buf[1] << 8);
+}
+
+static unsigned int pubsubWireHeader_get32(const unsigned char* buf){
+	return pubsubWireHeader_get16(buf) | (pubsubWireHeader_get16(buf + 2) << 16);
+}
+
+static uint64_t pubsubWireHeader_get64(const unsigned char* buf){
+	return pubsubWireHeader_get32(buf) | ((uint64_t)pubsubWireHeader_get32(buf + 4) << 32);
+}
+
+unsigned int pubsubWireHeader_topicHash(const char* topic){
+	return utils_stringHash(topic);
+}
+
+void pubsubWireHeader_prefix(const char* topic, unsigned char* prefix){
+	prefix[0] = PUBSUB_WIRE_HEADER_MAGIC;
+	prefix[1] = PUBSUB_WIRE_HEADER_VERSION;
+	pubsubWireHeader_put32(prefix + 2, pubsubWireHeader_topicHash(topic));
+}
+
+size_t pubsubWireHeader_encode(const struct pubsub_msg_header* header, unsigned char* buf){
+	unsigned int flags = header->flags & ~(PUBSUB_WIRE_FLAG_TRACE | PUBSUB_WIRE_FLAG_LEGACY);
+	size_t size = PUBSUB_WIRE_HEADER_SIZE;
+
+	if (header->traceId != 0) {
+		flags |= PUBSUB_WIRE_FLAG_TRACE;
+		size += PUBSUB_WIRE_HEADER_TRACE_SIZE;
+	}
+
+	buf[0] = PUBSUB_WIRE_HEADER_MAGIC;
+	buf[1] = PUBSUB_WIRE_HEADER_VERSION;
+	pubsubWireHeader_put32(buf + 2, header->topicHash);
+	buf[6] = header->major;
+	buf[7] = header->minor;
+	pubsubWireHeader_put16(buf + 8, flags);
+	pubsubWireHeader_put16(buf + 10, (unsigned int)size);
+	pubsubWireHeader_put32(buf + 12, header->type);
+	pubsubWireHeader_put32(buf + 16, header->seqNr);
+	if (flags & PUBSUB_WIRE_FLAG_TRACE) {
+		pubsubWireHeader_put64(buf + 20, header->traceId);
+		pubsubWireHeader_put64(buf + 28, header->spanId);
+	}
+	return size;
+}
+
+int pubsubWireHeader_decode(const void* data, size_t size, struct pubsub_msg_header* header, size_t* headerSize){
+	const unsigned char* buf = data;
+	size_t encodedSize;
+
+	memset(header, 0, sizeof(*header));
+	if (size == 0) {
+		return -1;
+	}
+	if (buf[0] != PUBSUB_WIRE_HEADER_MAGIC) {
+		/* A legacy header in a frame of its own: the frame size tells the layout */
+		size_t layoutSize = size >= sizeof(struct pubsub_legacy_msg_header) ? sizeof(struct pubsub_legacy_msg_header) : offsetof(struct pubsub_legacy_msg_header, traceId);
+		return pubsubWireHeader_decodeLegacy(buf, size, layoutSize, header, headerSize);
+	}
+	if (size < PUBSUB_WIRE_HEADER_SIZE) {
+		return -1;
+	}
+	if (buf[1] != PUBSUB_WIRE_HEADER_VERSION) {
+		return -2;
+	}
+
+	encodedSize = pubsubWireHeader_get16(buf + 10);
+	if (encodedSize < PUBSUB_WIRE_HEADER_SIZE || encodedSize > size) {
+		return -1;
+	}
+	header->topicHash = pubsubWireHeader_get32(buf + 2);
+	header->major = buf[6];
+	header->minor = buf[7];
+	header->flags = (unsigned short)pubsubWireHeader_get16(buf + 8);
+	header->type = pubsubWireHeader_get32(buf + 12);
+	header->seqNr = pubsubWireHeader_get32(buf + 16);
+	if (header->flags & PUBSUB_WIRE_FLAG_TRACE) {
+		if (encodedSize < PUBSUB_WIRE_HEADER_SIZE + PUBSUB_WIRE_HEADER_TRACE_SIZE) {
+			return -1;
+		}
+		header->traceId = pubsubWireHeader_get64(buf + 20);
+		header->spanId = pubsubWireHeader_get64(buf + 28);
+	}
+	// extensions added later in this version are skipped with the header size
+	*headerSize = encodedSize;
+	return 0;
+}
+
+int pubsubWireHeader_decodeDatagram(const void* data, size_t size, struct pubsub_msg_header* header, size_t* headerSize, size_t* payloadSize){
+	const unsigned char* buf = data;
+	size_t withoutTrace = offsetof(struct pubsub_legacy_msg_header, traceId);
+	size_t layoutSize;
+	int rc;
+
+	if (size > 0 && buf[0] == PUBSUB_WIRE_HEADER_MAGIC) {
+		rc = pubsubWireHeader_decode(data, size, header, headerSize);
+		if (rc == 0) {
+			*payloadSize = size - *headerSize;
+		}
+		return rc;
+	}
+
+	/* Legacy datagrams are the header followed by the payload size and the payload. The trace ids of the newer
+	 * layout take the place of the payload size of the older one, so the layout is the one whose payload size
+	 * matches the datagram. The older layout is tried first, its payload size is only matched by the random
+	 * trace id of a newer publisher by chance */
+	memset(header, 0, sizeof(*header));
+	if (pubsubWireHeader_legacyDatagramFits(buf, size, withoutTrace)) {
+		layoutSize = withoutTrace;
+	} else if (pubsubWireHeader_legacyDatagramFits(buf, size, sizeof(struct pubsub_legacy_msg_header))) {
+		layoutSize = sizeof(struct pubsub_legacy_msg_header);
+	} else {
+		return -1;
+	}
+	rc = pubsubWireHeader_decodeLegacy(buf, size, layoutSize, header, headerSize);
+	if (rc == 0) {
+		*headerSize += sizeof(unsigned int);
+		*payloadSize = size - *headerSize;
+	}
+	return rc;
+}
+
+static bool pubsubWireHeader_legacyDatagramFits(const unsigned char* buf, size_t size, size_t layoutSize){
+	unsigned int legacyPayloadSize;
+
+	if (size < layoutSize + sizeof(legacyPayloadSize)) {
+		return false;
+	}
+	memcpy(&legacyPayloadSize, buf + layoutSize, sizeof(legacyPayloadSize));
+	return legacyPayloadSize == size - layoutSize - sizeof(legacyPayloadSize);
+}
+
+/* Older publishers send the struct in host byte order, publishers from before the trace context without traceId
+ * and spanId. layoutSize selects which of the two is at the start of buf */
+static int pubsubWireHeader_decodeLegacy(const unsigned char* buf, size_t size, size_t layoutSize, struct pubsub_msg_header* header, size_t* headerSize){
+	struct pubsub_legacy_msg_header legacy;
+
+	if (size < layoutSize) {
+		return -1;
+	}
+	memset(&legacy, 0, sizeof(legacy));
+	memcpy(&legacy, buf, layoutSize);
+	*headerSize = layoutSize;
+	legacy.topic[MAX_TOPIC_LEN - 1] = '\0';
+
+	header->topicHash = pubsubWireHeader_topicHash(legacy.topic);
+	header->type = legacy.type;
+	header->major = legacy.major;
+	header->minor = legacy.minor;
+	header->flags = PUBSUB_WIRE_FLAG_LEGACY;
+	header->traceId = legacy.traceId;
+	header->spanId = legacy.spanId;
+	if (header->traceId != 0) {
+		header->flags |= PUBSUB_WIRE_FLAG_TRACE;
+	}
+	return 0;
+}
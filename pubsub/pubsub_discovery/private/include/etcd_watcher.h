@@ -28,10 +28,13 @@
 
 typedef struct etcd_watcher *etcd_watcher_pt;
 
-celix_status_t etcdWatcher_create(pubsub_discovery_pt discovery,  bundle_context_pt context, const char *scope, const char* topic, etcd_watcher_pt *watcher);
+celix_status_t etcdWatcher_create(pubsub_discovery_pt discovery,  bundle_context_pt context, etcd_watcher_pt *watcher);
 celix_status_t etcdWatcher_destroy(etcd_watcher_pt watcher);
 celix_status_t etcdWatcher_stop(etcd_watcher_pt watcher);
 
+celix_status_t etcdWatcher_addTopic(etcd_watcher_pt watcher, const char *scope, const char* topic);
+celix_status_t etcdWatcher_removeTopic(etcd_watcher_pt watcher, const char *scope, const char* topic);
+
 celix_status_t etcdWatcher_getPublisherEndpointFromKey(pubsub_discovery_pt discovery, const char* key, const char* value, pubsub_endpoint_pt* pubEP);
 
 
@@ -29,11 +29,6 @@
 
 #define FREE_MEM(ptr) if(ptr) {free(ptr); ptr = NULL;}
 
-struct watcher_info {
-    etcd_watcher_pt watcher;
-    int nr_references;
-};
-
 struct pubsub_discovery {
 	bundle_context_pt context;
 
@@ -43,8 +38,7 @@ struct pubsub_discovery {
 	celix_thread_mutex_t listenerReferencesMutex;
 	hash_map_pt listenerReferences; //key=serviceReference, value=nop
 
-	celix_thread_mutex_t watchersMutex;
-	hash_map_pt watchers; //key = topicname, value = struct watcher_info
+	etcd_watcher_pt watcher;
 
 	etcd_writer_pt writer;
 };
@@ -56,7 +50,9 @@ celix_status_t pubsub_discovery_start(pubsub_discovery_pt node_discovery);
 celix_status_t pubsub_discovery_stop(pubsub_discovery_pt node_discovery);
 
 celix_status_t pubsub_discovery_addNode(pubsub_discovery_pt node_discovery, pubsub_endpoint_pt pubEP);
+celix_status_t pubsub_discovery_addNodes(pubsub_discovery_pt node_discovery, array_list_pt pubEPs);
 celix_status_t pubsub_discovery_removeNode(pubsub_discovery_pt node_discovery, pubsub_endpoint_pt pubEP);
+celix_status_t pubsub_discovery_removeFrameworkNodes(pubsub_discovery_pt node_discovery, const char* scope, const char* topic, const char* fwUUID);
 
 celix_status_t pubsub_discovery_tmPublisherAnnounceAdded(void * handle, service_reference_pt reference, void * service);
 celix_status_t pubsub_discovery_tmPublisherAnnounceModified(void * handle, service_reference_pt reference, void * service);
@@ -68,5 +64,6 @@ celix_status_t pubsub_discovery_interestedInTopic(void *handle, const char* scop
 celix_status_t pubsub_discovery_uninterestedInTopic(void *handle, const char* scope, const char* topic);
 
 celix_status_t pubsub_discovery_informPublishersListeners(pubsub_discovery_pt discovery, pubsub_endpoint_pt endpoint, bool endpointAdded);
+celix_status_t pubsub_discovery_informPublishersListenersAdded(pubsub_discovery_pt discovery, array_list_pt endpoints);
 
 #endif /* PUBSUB_DISCOVERY_IMPL_H_ */
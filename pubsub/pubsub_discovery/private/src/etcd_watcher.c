@@ -19,11 +19,13 @@
 
 #include <stdbool.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <unistd.h>
 #include <string.h>
 
 #include "celix_log.h"
 #include "constants.h"
+#include "utils.h"
 
 #include "etcd.h"
 #include "etcd_watcher.h"
@@ -50,24 +52,28 @@
 #define CFG_ETCD_TTL                    "DISCOVERY_ETCD_TTL"
 #define DEFAULT_ETCD_TTL                30
 
+// retry interval after a failed watch, e.g. when etcd is not reachable
+#define ETCD_WATCH_RETRY_INTERVAL       1
 
+/*
+ * A single watcher follows all changes below the root path and dispatches them
+ * to the topics someone is interested in, instead of one watch connection per topic.
+ */
 struct etcd_watcher {
 	pubsub_discovery_pt pubsub_discovery;
 
 	celix_thread_mutex_t watcherLock;
 	celix_thread_t watcherThread;
 
-	char *scope;
-	char *topic;
-	volatile bool running;
-};
+	hash_map_pt topics; //key = scope/topic key, value = nr of references
+
+	/* the publishers already known for a new topic are read by the loader thread, the discovery
+	 * listeners must not be called from the thread calling interestedInTopic */
+	celix_thread_cond_t topicAdded;
+	array_list_pt newTopics; //topic root paths
+	celix_thread_t loaderThread;
 
-struct etcd_writer {
-	pubsub_discovery_pt pubsub_discovery;
-	celix_thread_mutex_t localPubsLock;
-	array_list_pt localPubs;
 	volatile bool running;
-	celix_thread_t writerThread;
 };
 
 
@@ -99,54 +105,133 @@ static celix_status_t etcdWatcher_getRootPath(bundle_context_pt context, char* r
 }
 
 
+struct etcd_watcher_loaded_nodes {
+	pubsub_discovery_pt discovery;
+	array_list_pt endpoints;
+};
+
 static void add_node(const char *key, const char *value, void* arg) {
-	pubsub_discovery_pt ps_discovery = (pubsub_discovery_pt) arg;
+	struct etcd_watcher_loaded_nodes *loaded = arg;
 	pubsub_endpoint_pt pubEP = NULL;
-	celix_status_t status = etcdWatcher_getPublisherEndpointFromKey(ps_discovery, key, value, &pubEP);
+	celix_status_t status = etcdWatcher_getPublisherEndpointFromKey(loaded->discovery, key, value, &pubEP);
 	if(!status && pubEP) {
-		pubsub_discovery_addNode(ps_discovery, pubEP);
+		arrayList_add(loaded->endpoints, pubEP);
 	}
 }
 
+static void ignore_node(const char *key, const char *value, void* arg) {
+	// only the modified index is needed
+}
+
 static celix_status_t etcdWatcher_addAlreadyExistingPublishers(pubsub_discovery_pt ps_discovery, const char *rootPath, long long * highestModified) {
 	celix_status_t status = CELIX_SUCCESS;
-	if(etcd_get_directory(rootPath, add_node, ps_discovery, highestModified)) {
+	struct etcd_watcher_loaded_nodes loaded = { .discovery = ps_discovery, .endpoints = NULL };
+
+	arrayList_create(&loaded.endpoints);
+
+	/* collect the whole directory first, so the listeners are informed with a single batch */
+	if(etcd_get_directory(rootPath, add_node, &loaded, highestModified)) {
 		status = CELIX_ILLEGAL_ARGUMENT;
 	}
+
+	if (arrayList_size(loaded.endpoints) > 0) {
+		pubsub_discovery_addNodes(ps_discovery, loaded.endpoints);
+	}
+	arrayList_destroy(loaded.endpoints);
+
 	return status;
 }
 
+/*
+ * splits an etcd key in scope, topic, framework uuid and service id.
+ * returns the number of found fields, a framework directory has 3 fields, a publisher 4.
+ */
+static int etcdWatcher_parseKey(pubsub_discovery_pt pubsub_discovery, const char* etcdKey, char* scope, char* topic, char* fwUUID, char* serviceId) {
+	char rootPath[MAX_ROOTNODE_LENGTH];
+	char *expr = NULL;
+	int foundItems = 0;
+
+	memset(rootPath,0,MAX_ROOTNODE_LENGTH);
+	etcdWatcher_getRootPath(pubsub_discovery->context, rootPath);
+
+	asprintf(&expr, "/%s/%%127[^/]/%%127[^/]/%%127[^/]/%%127[^/].*", rootPath);
+	if(expr) {
+		foundItems = sscanf(etcdKey, expr, scope, topic, fwUUID, serviceId);
+		free(expr);
+	}
+
+	return foundItems;
+}
+
 // gets everything from provided key
 celix_status_t etcdWatcher_getPublisherEndpointFromKey(pubsub_discovery_pt pubsub_discovery, const char* etcdKey, const char* etcdValue, pubsub_endpoint_pt* pubEP) {
 
 	celix_status_t status = CELIX_SUCCESS;
 
-	char rootPath[MAX_ROOTNODE_LENGTH];
-	char *expr = NULL;
 	char scope[MAX_FIELD_LENGTH];
 	char topic[MAX_FIELD_LENGTH];
 	char fwUUID[MAX_FIELD_LENGTH];
 	char serviceId[MAX_FIELD_LENGTH];
 
-	memset(rootPath,0,MAX_ROOTNODE_LENGTH);
+	memset(scope,0,MAX_FIELD_LENGTH);
 	memset(topic,0,MAX_FIELD_LENGTH);
 	memset(fwUUID,0,MAX_FIELD_LENGTH);
 	memset(serviceId,0,MAX_FIELD_LENGTH);
 
-	etcdWatcher_getRootPath(pubsub_discovery->context, rootPath);
+	if (etcdWatcher_parseKey(pubsub_discovery, etcdKey, scope, topic, fwUUID, serviceId) != 4) { // Could happen when a directory is removed, just don't process this.
+		status = CELIX_ILLEGAL_STATE;
+	}
+	else{
+		status = pubsubEndpoint_create(fwUUID,scope,topic,strtol(serviceId,NULL,10),etcdValue,NULL,pubEP);
+	}
+	return status;
+}
 
-	asprintf(&expr, "/%s/%%[^/]/%%[^/]/%%[^/]/%%[^/].*", rootPath);
-	if(expr) {
-		int foundItems = sscanf(etcdKey, expr, scope, topic, fwUUID, serviceId);
-		free(expr);
-		if (foundItems != 4) { // Could happen when a directory is removed, just don't process this.
-			status = CELIX_ILLEGAL_STATE;
+static bool etcdWatcher_isInterested(etcd_watcher_pt watcher, const char* scope, const char* topic) {
+	char *scope_topic_key = createScopeTopicKey(scope, topic);
+
+	celixThreadMutex_lock(&watcher->watcherLock);
+	bool interested = hashMap_containsKey(watcher->topics, scope_topic_key);
+	celixThreadMutex_unlock(&watcher->watcherLock);
+
+	free(scope_topic_key);
+
+	return interested;
+}
+
+static void etcdWatcher_handleEvent(etcd_watcher_pt watcher, const char* action, const char* rkey, const char* value, const char* preValue) {
+	pubsub_discovery_pt ps_discovery = watcher->pubsub_discovery;
+	char scope[MAX_FIELD_LENGTH];
+	char topic[MAX_FIELD_LENGTH];
+	char fwUUID[MAX_FIELD_LENGTH];
+	char serviceId[MAX_FIELD_LENGTH];
+	pubsub_endpoint_pt pubEP = NULL;
+
+	memset(scope,0,MAX_FIELD_LENGTH);
+	memset(topic,0,MAX_FIELD_LENGTH);
+	memset(fwUUID,0,MAX_FIELD_LENGTH);
+	memset(serviceId,0,MAX_FIELD_LENGTH);
+
+	int foundItems = etcdWatcher_parseKey(ps_discovery, rkey, scope, topic, fwUUID, serviceId);
+
+	if (foundItems < 3 || !etcdWatcher_isInterested(watcher, scope, topic)) {
+		return;
+	}
+
+	if ((strcmp(action, "set") == 0) || (strcmp(action, "create") == 0) || (strcmp(action, "update") == 0)) {
+		if (foundItems == 4 && pubsubEndpoint_create(fwUUID, scope, topic, strtol(serviceId, NULL, 10), value, NULL, &pubEP) == CELIX_SUCCESS) {
+			pubsub_discovery_addNode(ps_discovery, pubEP);
 		}
-		else{
-			status = pubsubEndpoint_create(fwUUID,scope,topic,strtol(serviceId,NULL,10),etcdValue,NULL,pubEP);
+	} else if ((strcmp(action, "delete") == 0) || (strcmp(action, "expire") == 0)) {
+		if (foundItems == 3) {
+			// the directory lease of a framework is removed or expired, including all its publishers
+			pubsub_discovery_removeFrameworkNodes(ps_discovery, scope, topic, fwUUID);
+		} else if (pubsubEndpoint_create(fwUUID, scope, topic, strtol(serviceId, NULL, 10), preValue, NULL, &pubEP) == CELIX_SUCCESS) {
+			pubsub_discovery_removeNode(ps_discovery, pubEP);
 		}
+	} else {
+		fw_log(logger, OSGI_FRAMEWORK_LOG_INFO, "Unexpected action: %s", action);
 	}
-	return status;
 }
 
 /*
@@ -155,7 +240,6 @@ celix_status_t etcdWatcher_getPublisherEndpointFromKey(pubsub_discovery_pt pubsu
  */
 static void* etcdWatcher_run(void* data) {
 	etcd_watcher_pt watcher = (etcd_watcher_pt) data;
-	time_t timeBeforeWatch = time(NULL);
 	char rootPath[MAX_ROOTNODE_LENGTH];
 	long long highestModified = 0;
 
@@ -164,11 +248,10 @@ static void* etcdWatcher_run(void* data) {
 
 	memset(rootPath, 0, MAX_ROOTNODE_LENGTH);
 
-	//TODO: add topic to etcd key
-	etcdWatcher_getTopicRootPath(context, watcher->scope, watcher->topic, rootPath, MAX_ROOTNODE_LENGTH);
-	etcdWatcher_addAlreadyExistingPublishers(ps_discovery, rootPath, &highestModified);
+	etcdWatcher_getRootPath(context, rootPath);
+	etcd_get_directory(rootPath, ignore_node, NULL, &highestModified);
 
-	while ((celixThreadMutex_lock(&watcher->watcherLock) == CELIX_SUCCESS) && watcher->running) {
+	while (watcher->running) {
 
 		char *rkey = NULL;
 		char *value = NULL;
@@ -176,56 +259,51 @@ static void* etcdWatcher_run(void* data) {
 		char *action = NULL;
 		long long modIndex;
 
-		celixThreadMutex_unlock(&watcher->watcherLock);
-
-		if (etcd_watch(rootPath, highestModified + 1, &action, &preValue, &value, &rkey, &modIndex) == 0 && action != NULL) {
-			pubsub_endpoint_pt pubEP = NULL;
-			if ((strcmp(action, "set") == 0) || (strcmp(action, "create") == 0)) {
-				if (etcdWatcher_getPublisherEndpointFromKey(ps_discovery, rkey, value, &pubEP) == CELIX_SUCCESS) {
-					pubsub_discovery_addNode(ps_discovery, pubEP);
-				}
-			} else if (strcmp(action, "delete") == 0) {
-				if (etcdWatcher_getPublisherEndpointFromKey(ps_discovery, rkey, preValue, &pubEP) == CELIX_SUCCESS) {
-					pubsub_discovery_removeNode(ps_discovery, pubEP);
-				}
-			} else if (strcmp(action, "expire") == 0) {
-				if (etcdWatcher_getPublisherEndpointFromKey(ps_discovery, rkey, preValue, &pubEP) == CELIX_SUCCESS) {
-					pubsub_discovery_removeNode(ps_discovery, pubEP);
-				}
-			} else if (strcmp(action, "update") == 0) {
-				if (etcdWatcher_getPublisherEndpointFromKey(ps_discovery, rkey, value, &pubEP) == CELIX_SUCCESS) {
-					pubsub_discovery_addNode(ps_discovery, pubEP);
-				}
-			} else {
-				fw_log(logger, OSGI_FRAMEWORK_LOG_INFO, "Unexpected action: %s", action);
-			}
+		int rc = etcd_watch(rootPath, highestModified > 0 ? highestModified + 1 : 0, &action, &preValue, &value, &rkey, &modIndex);
+
+		if (rc == ETCDLIB_RC_OK && action != NULL && rkey != NULL) {
+			etcdWatcher_handleEvent(watcher, action, rkey, value, preValue);
 			highestModified = modIndex;
-		} else if (time(NULL) - timeBeforeWatch <= (DEFAULT_ETCD_TTL / 4)) {
-			sleep(DEFAULT_ETCD_TTL / 4);
+		} else if (rc != ETCDLIB_RC_TIMEOUT) {
+			/* prevent busy waiting, in case etcd_watch fails */
+			sleep(ETCD_WATCH_RETRY_INTERVAL);
 		}
 
 		FREE_MEM(action);
 		FREE_MEM(value);
 		FREE_MEM(preValue);
 		FREE_MEM(rkey);
+	}
 
-		/* prevent busy waiting, in case etcd_watch returns false */
+	return NULL;
+}
 
+/*
+ * reads the publishers already known for new topics, the watcher only follows changes.
+ */
+static void* etcdWatcher_runLoader(void* data) {
+	etcd_watcher_pt watcher = (etcd_watcher_pt) data;
 
-		if (time(NULL) - timeBeforeWatch > (DEFAULT_ETCD_TTL / 4)) {
-			timeBeforeWatch = time(NULL);
+	celixThreadMutex_lock(&watcher->watcherLock);
+	while (watcher->running) {
+		if (arrayList_size(watcher->newTopics) == 0) {
+			celixThreadCondition_wait(&watcher->topicAdded, &watcher->watcherLock);
+		} else {
+			char *rootPath = arrayList_remove(watcher->newTopics, 0);
+			long long highestModified = 0;
+
+			celixThreadMutex_unlock(&watcher->watcherLock);
+			etcdWatcher_addAlreadyExistingPublishers(watcher->pubsub_discovery, rootPath, &highestModified);
+			free(rootPath);
+			celixThreadMutex_lock(&watcher->watcherLock);
 		}
-
-	}
-
-	if (watcher->running == false) {
-		celixThreadMutex_unlock(&watcher->watcherLock);
 	}
+	celixThreadMutex_unlock(&watcher->watcherLock);
 
 	return NULL;
 }
 
-celix_status_t etcdWatcher_create(pubsub_discovery_pt pubsub_discovery, bundle_context_pt context, const char *scope, const char *topic, etcd_watcher_pt *watcher) {
+celix_status_t etcdWatcher_create(pubsub_discovery_pt pubsub_discovery, bundle_context_pt context, etcd_watcher_pt *watcher) {
 	celix_status_t status = CELIX_SUCCESS;
 
 
@@ -240,17 +318,27 @@ celix_status_t etcdWatcher_create(pubsub_discovery_pt pubsub_discovery, bundle_c
 	}
 
 	(*watcher)->pubsub_discovery = pubsub_discovery;
-	(*watcher)->scope = strdup(scope);
-	(*watcher)->topic = strdup(topic);
+	(*watcher)->topics = hashMap_create(utils_stringHash, NULL, utils_stringEquals, NULL);
+	arrayList_create(&(*watcher)->newTopics);
 
 
 	celixThreadMutex_create(&(*watcher)->watcherLock, NULL);
+	celixThreadCondition_init(&(*watcher)->topicAdded, NULL);
 
 	celixThreadMutex_lock(&(*watcher)->watcherLock);
 
+	(*watcher)->running = true;
 	status = celixThread_create(&(*watcher)->watcherThread, NULL, etcdWatcher_run, *watcher);
 	if (status == CELIX_SUCCESS) {
-		(*watcher)->running = true;
+		status = celixThread_create(&(*watcher)->loaderThread, NULL, etcdWatcher_runLoader, *watcher);
+		if (status != CELIX_SUCCESS) {
+			(*watcher)->running = false;
+			celixThreadMutex_unlock(&(*watcher)->watcherLock);
+			celixThread_join((*watcher)->watcherThread, NULL);
+			celixThreadMutex_lock(&(*watcher)->watcherLock);
+		}
+	} else {
+		(*watcher)->running = false;
 	}
 
 	celixThreadMutex_unlock(&(*watcher)->watcherLock);
@@ -263,12 +351,14 @@ celix_status_t etcdWatcher_destroy(etcd_watcher_pt watcher) {
 
 	celix_status_t status = CELIX_SUCCESS;
 
-	char rootPath[MAX_ROOTNODE_LENGTH];
-	etcdWatcher_getTopicRootPath(watcher->pubsub_discovery->context, watcher->scope, watcher->topic, rootPath, MAX_ROOTNODE_LENGTH);
+	for (int i = 0; i < arrayList_size(watcher->newTopics); i++) {
+		free(arrayList_get(watcher->newTopics, i));
+	}
+	arrayList_destroy(watcher->newTopics);
+	hashMap_destroy(watcher->topics, true, false);
+	celixThreadCondition_destroy(&watcher->topicAdded);
 	celixThreadMutex_destroy(&(watcher->watcherLock));
 
-	free(watcher->scope);
-	free(watcher->topic);
 	free(watcher);
 
 	return status;
@@ -278,13 +368,64 @@ celix_status_t etcdWatcher_stop(etcd_watcher_pt watcher){
 	celix_status_t status = CELIX_SUCCESS;
 
 	celixThreadMutex_lock(&(watcher->watcherLock));
+	bool running = watcher->running;
 	watcher->running = false;
+	celixThreadCondition_broadcast(&watcher->topicAdded);
 	celixThreadMutex_unlock(&(watcher->watcherLock));
 
-	celixThread_join(watcher->watcherThread, NULL);
+	if (running) {
+		celixThread_join(watcher->watcherThread, NULL);
+		celixThread_join(watcher->loaderThread, NULL);
+	}
 
 	return status;
 
 }
 
+celix_status_t etcdWatcher_addTopic(etcd_watcher_pt watcher, const char *scope, const char *topic) {
+	celix_status_t status = CELIX_SUCCESS;
+	char *scope_topic_key = createScopeTopicKey(scope, topic);
+
+	celixThreadMutex_lock(&watcher->watcherLock);
+	intptr_t nrOfReferences = (intptr_t) hashMap_get(watcher->topics, scope_topic_key);
+	if (nrOfReferences > 0) {
+		hashMap_put(watcher->topics, scope_topic_key, (void*) (nrOfReferences + 1));
+		free(scope_topic_key);
+	} else {
+		char rootPath[MAX_ROOTNODE_LENGTH];
+
+		hashMap_put(watcher->topics, scope_topic_key, (void*) (intptr_t) 1);
 
+		etcdWatcher_getTopicRootPath(watcher->pubsub_discovery->context, scope, topic, rootPath, MAX_ROOTNODE_LENGTH);
+		arrayList_add(watcher->newTopics, strdup(rootPath));
+		celixThreadCondition_broadcast(&watcher->topicAdded);
+	}
+	celixThreadMutex_unlock(&watcher->watcherLock);
+
+	return status;
+}
+
+celix_status_t etcdWatcher_removeTopic(etcd_watcher_pt watcher, const char *scope, const char *topic) {
+	celix_status_t status = CELIX_SUCCESS;
+	char *scope_topic_key = createScopeTopicKey(scope, topic);
+
+	celixThreadMutex_lock(&watcher->watcherLock);
+	hash_map_entry_pt entry = hashMap_getEntry(watcher->topics, scope_topic_key);
+	if (entry) {
+		intptr_t nrOfReferences = (intptr_t) hashMapEntry_getValue(entry);
+		if (nrOfReferences > 1) {
+			hashMap_put(watcher->topics, hashMapEntry_getKey(entry), (void*) (nrOfReferences - 1));
+		} else {
+			char *key = hashMapEntry_getKey(entry);
+			hashMap_remove(watcher->topics, scope_topic_key);
+			free(key);
+		}
+	} else {
+		status = CELIX_ILLEGAL_ARGUMENT;
+	}
+	celixThreadMutex_unlock(&watcher->watcherLock);
+
+	free(scope_topic_key);
+
+	return status;
+}
@@ -24,6 +24,7 @@
 
 #include "celix_log.h"
 #include "constants.h"
+#include "utils.h"
 
 #include "etcd.h"
 #include "etcd_writer.h"
@@ -46,16 +47,24 @@
 #define CFG_ETCD_TTL   "DISCOVERY_ETCD_TTL"
 #define DEFAULT_ETCD_TTL 30
 
+/*
+ * The publishers of a framework are stored below a directory per topic (<root>/<scope>/<topic>/<fwUUID>).
+ * Only that directory has a TTL, so all publishers of a topic are kept alive with one refresh request,
+ * and a refresh does not notify the watchers.
+ */
 struct etcd_writer {
 	pubsub_discovery_pt pubsub_discovery;
 	celix_thread_mutex_t localPubsLock;
 	array_list_pt localPubs;
+	int ttl;
 	volatile bool running;
 	celix_thread_t writerThread;
 };
 
 
 static const char* etcdWriter_getRootPath(bundle_context_pt context);
+static int etcdWriter_getTtl(bundle_context_pt context);
+static void etcdWriter_getLeaseDirectory(etcd_writer_pt writer, pubsub_endpoint_pt pubEP, char* dir);
 static void* etcdWriter_run(void* data);
 
 
@@ -65,6 +74,7 @@ etcd_writer_pt etcdWriter_create(pubsub_discovery_pt disc) {
 		celixThreadMutex_create(&writer->localPubsLock, NULL);
 		arrayList_create(&writer->localPubs);
 		writer->pubsub_discovery = disc;
+		writer->ttl = etcdWriter_getTtl(disc->context);
 		writer->running = true;
 		celixThread_create(&writer->writerThread, NULL, etcdWriter_run, writer);
 	}
@@ -73,7 +83,6 @@ etcd_writer_pt etcdWriter_create(pubsub_discovery_pt disc) {
 
 void etcdWriter_destroy(etcd_writer_pt writer) {
 	char dir[MAX_ROOTNODE_LENGTH];
-	const char *rootPath = etcdWriter_getRootPath(writer->pubsub_discovery->context);
 
 	writer->running = false;
 	celixThread_join(writer->writerThread, NULL);
@@ -81,8 +90,7 @@ void etcdWriter_destroy(etcd_writer_pt writer) {
 	celixThreadMutex_lock(&writer->localPubsLock);
 	for(int i = 0; i < arrayList_size(writer->localPubs); i++) {
 		pubsub_endpoint_pt pubEP = (pubsub_endpoint_pt)arrayList_get(writer->localPubs,i);
-		memset(dir,0,MAX_ROOTNODE_LENGTH);
-		snprintf(dir,MAX_ROOTNODE_LENGTH,"%s/%s/%s/%s",rootPath,pubEP->scope,pubEP->topic,pubEP->frameworkUUID);
+		etcdWriter_getLeaseDirectory(writer, pubEP, dir);
 		etcd_del(dir);
 		pubsubEndpoint_destroy(pubEP);
 	}
@@ -95,7 +103,7 @@ void etcdWriter_destroy(etcd_writer_pt writer) {
 }
 
 celix_status_t etcdWriter_addPublisherEndpoint(etcd_writer_pt writer, pubsub_endpoint_pt pubEP, bool storeEP){
-	celix_status_t status = CELIX_BUNDLE_EXCEPTION;
+	celix_status_t status = CELIX_SUCCESS;
 
 	if(storeEP){
 		const char *fwUUID = NULL;
@@ -110,28 +118,20 @@ celix_status_t etcdWriter_addPublisherEndpoint(etcd_writer_pt writer, pubsub_end
 	}
 
 	char *key;
-
-	const char* ttlStr = NULL;
-	int ttl = 0;
-
-	// determine ttl
-	if ((bundleContext_getProperty(writer->pubsub_discovery->context, CFG_ETCD_TTL, &ttlStr) != CELIX_SUCCESS) || !ttlStr) {
-		ttl = DEFAULT_ETCD_TTL;
-	} else {
-		char* endptr = NULL;
-		errno = 0;
-		ttl = strtol(ttlStr, &endptr, 10);
-		if (*endptr || errno != 0) {
-			ttl = DEFAULT_ETCD_TTL;
-		}
-	}
+	char dir[MAX_ROOTNODE_LENGTH];
 
 	const char *rootPath = etcdWriter_getRootPath(writer->pubsub_discovery->context);
 
 	asprintf(&key,"%s/%s/%s/%s/%ld",rootPath,pubEP->scope,pubEP->topic,pubEP->frameworkUUID,pubEP->serviceID);
 
-	if(!etcd_set(key,pubEP->endpoint,ttl,false)){
+	// the key itself has no ttl, it expires together with the lease directory
+	if(etcd_set(key,pubEP->endpoint,0,false) != 0){
 		status = CELIX_ILLEGAL_ARGUMENT;
+	} else {
+		etcdWriter_getLeaseDirectory(writer, pubEP, dir);
+		if (etcd_refresh_directory(dir, writer->ttl) != 0) {
+			status = CELIX_ILLEGAL_ARGUMENT;
+		}
 	}
 	FREE_MEM(key);
 	return status;
@@ -164,15 +164,43 @@ celix_status_t etcdWriter_deletePublisherEndpoint(etcd_writer_pt writer, pubsub_
 	return status;
 }
 
+/*
+ * refreshes every lease directory once. If a directory is expired (e.g. etcd was
+ * not reachable) the publishers in that directory are written again.
+ */
+static void etcdWriter_refreshLeases(etcd_writer_pt writer) {
+	hash_map_pt leases = hashMap_create(utils_stringHash, NULL, utils_stringEquals, NULL); //key = lease directory, value = expired
+	char dir[MAX_ROOTNODE_LENGTH];
+
+	celixThreadMutex_lock(&writer->localPubsLock);
+	for(int i=0; i < arrayList_size(writer->localPubs); i++) {
+		pubsub_endpoint_pt pubEP = (pubsub_endpoint_pt)arrayList_get(writer->localPubs,i);
+		etcdWriter_getLeaseDirectory(writer, pubEP, dir);
+
+		if (!hashMap_containsKey(leases, dir)) {
+			bool expired = etcd_refresh_directory(dir, writer->ttl) != 0;
+			hashMap_put(leases, strdup(dir), expired ? (void*) 0x1 : NULL);
+		}
+
+		if (hashMap_get(leases, dir) != NULL) {
+			etcdWriter_addPublisherEndpoint(writer, pubEP, false);
+		}
+	}
+	celixThreadMutex_unlock(&writer->localPubsLock);
+
+	hashMap_destroy(leases, true, false);
+}
+
 static void* etcdWriter_run(void* data) {
 	etcd_writer_pt writer = (etcd_writer_pt)data;
+	int interval = writer->ttl / 4 > 0 ? writer->ttl / 4 : 1;
+
 	while(writer->running) {
-		celixThreadMutex_lock(&writer->localPubsLock);
-		for(int i=0; i < arrayList_size(writer->localPubs); i++) {
-			etcdWriter_addPublisherEndpoint(writer,(pubsub_endpoint_pt)arrayList_get(writer->localPubs,i),false);
+		etcdWriter_refreshLeases(writer);
+
+		for (int i = 0; i < interval && writer->running; i++) {
+			sleep(1);
 		}
-		celixThreadMutex_unlock(&writer->localPubsLock);
-		sleep(DEFAULT_ETCD_TTL / 2);
 	}
 
 	return NULL;
@@ -187,3 +215,27 @@ static const char* etcdWriter_getRootPath(bundle_context_pt context) {
 	return rootPath;
 }
 
+static int etcdWriter_getTtl(bundle_context_pt context) {
+	const char* ttlStr = NULL;
+	int ttl = 0;
+
+	if ((bundleContext_getProperty(context, CFG_ETCD_TTL, &ttlStr) != CELIX_SUCCESS) || !ttlStr) {
+		ttl = DEFAULT_ETCD_TTL;
+	} else {
+		char* endptr = NULL;
+		errno = 0;
+		ttl = strtol(ttlStr, &endptr, 10);
+		if (*endptr || errno != 0 || ttl <= 0) {
+			ttl = DEFAULT_ETCD_TTL;
+		}
+	}
+
+	return ttl;
+}
+
+static void etcdWriter_getLeaseDirectory(etcd_writer_pt writer, pubsub_endpoint_pt pubEP, char* dir) {
+	const char *rootPath = etcdWriter_getRootPath(writer->pubsub_discovery->context);
+
+	memset(dir,0,MAX_ROOTNODE_LENGTH);
+	snprintf(dir,MAX_ROOTNODE_LENGTH,"%s/%s/%s/%s",rootPath,pubEP->scope,pubEP->topic,pubEP->frameworkUUID);
+}
@@ -36,6 +36,7 @@
 #include "service_registration.h"
 
 #include "publisher_endpoint_announce.h"
+#include "etcd.h"
 #include "etcd_common.h"
 #include "etcd_watcher.h"
 #include "etcd_writer.h"
@@ -55,10 +56,8 @@ celix_status_t pubsub_discovery_create(bundle_context_pt context, pubsub_discove
 		(*ps_discovery)->context = context;
 		(*ps_discovery)->discoveredPubs = hashMap_create(utils_stringHash, NULL, utils_stringEquals, NULL);
 		(*ps_discovery)->listenerReferences = hashMap_create(serviceReference_hashCode, NULL, serviceReference_equals2, NULL);
-		(*ps_discovery)->watchers = hashMap_create(utils_stringHash,NULL,utils_stringEquals, NULL);
 		celixThreadMutex_create(&(*ps_discovery)->listenerReferencesMutex, NULL);
 		celixThreadMutex_create(&(*ps_discovery)->discoveredPubsMutex, NULL);
-		celixThreadMutex_create(&(*ps_discovery)->watchersMutex, NULL);
 	}
 
 	return status;
@@ -109,6 +108,10 @@ celix_status_t pubsub_discovery_start(pubsub_discovery_pt ps_discovery) {
     status = etcdCommon_init(ps_discovery->context);
     ps_discovery->writer = etcdWriter_create(ps_discovery);
 
+    if (status == CELIX_SUCCESS) {
+        status = etcdWatcher_create(ps_discovery, ps_discovery->context, &ps_discovery->watcher);
+    }
+
     return status;
 }
 
@@ -123,20 +126,15 @@ celix_status_t pubsub_discovery_stop(pubsub_discovery_pt ps_discovery) {
         return CELIX_INVALID_BUNDLE_CONTEXT;
     }
 
-    celixThreadMutex_lock(&ps_discovery->watchersMutex);
-
-    hash_map_iterator_pt iter = hashMapIterator_create(ps_discovery->watchers);
-    while (hashMapIterator_hasNext(iter)) {
-        struct watcher_info * wi = hashMapIterator_nextValue(iter);
-        etcdWatcher_stop(wi->watcher);
+    if (ps_discovery->watcher != NULL) {
+        etcdWatcher_stop(ps_discovery->watcher);
     }
-    hashMapIterator_destroy(iter);
 
     celixThreadMutex_lock(&ps_discovery->discoveredPubsMutex);
 
     /* Unexport all publishers for the local framework, and also delete from ETCD publisher belonging to the local framework */
 
-    iter = hashMapIterator_create(ps_discovery->discoveredPubs);
+    hash_map_iterator_pt iter = hashMapIterator_create(ps_discovery->discoveredPubs);
     while (hashMapIterator_hasNext(iter)) {
         array_list_pt pubEP_list = (array_list_pt) hashMapIterator_nextValue(iter);
 
@@ -159,23 +157,21 @@ celix_status_t pubsub_discovery_stop(pubsub_discovery_pt ps_discovery) {
     celixThreadMutex_unlock(&ps_discovery->discoveredPubsMutex);
     etcdWriter_destroy(ps_discovery->writer);
 
-    iter = hashMapIterator_create(ps_discovery->watchers);
-    while (hashMapIterator_hasNext(iter)) {
-        struct watcher_info * wi = hashMapIterator_nextValue(iter);
-        etcdWatcher_destroy(wi->watcher);
+    if (ps_discovery->watcher != NULL) {
+        etcdWatcher_destroy(ps_discovery->watcher);
+        ps_discovery->watcher = NULL;
     }
-    hashMapIterator_destroy(iter);
-    hashMap_destroy(ps_discovery->watchers, true, true);
-    celixThreadMutex_unlock(&ps_discovery->watchersMutex);
+
+    etcd_cleanup();
+
     return status;
 }
 
 /* Functions called by the etcd_watcher */
 
-celix_status_t pubsub_discovery_addNode(pubsub_discovery_pt pubsub_discovery, pubsub_endpoint_pt pubEP) {
-	celix_status_t status = CELIX_SUCCESS;
+/* Caller must hold the discoveredPubsMutex. Takes ownership of pubEP, returns whether it was not known yet */
+static bool pubsub_discovery_storeNode(pubsub_discovery_pt pubsub_discovery, pubsub_endpoint_pt pubEP) {
 	bool inform=false;
-	celixThreadMutex_lock(&pubsub_discovery->discoveredPubsMutex);
 
 	char *pubs_key = createScopeTopicKey(pubEP->scope, pubEP->topic);
 	array_list_pt pubEP_list = (array_list_pt)hashMap_get(pubsub_discovery->discoveredPubs,pubs_key);
@@ -201,6 +197,16 @@ celix_status_t pubsub_discovery_addNode(pubsub_discovery_pt pubsub_discovery, pu
 	}
 	free(pubs_key);
 
+	return inform;
+}
+
+celix_status_t pubsub_discovery_addNode(pubsub_discovery_pt pubsub_discovery, pubsub_endpoint_pt pubEP) {
+	celix_status_t status = CELIX_SUCCESS;
+	bool inform=false;
+	celixThreadMutex_lock(&pubsub_discovery->discoveredPubsMutex);
+
+	inform = pubsub_discovery_storeNode(pubsub_discovery, pubEP);
+
 	celixThreadMutex_unlock(&pubsub_discovery->discoveredPubsMutex);
 
 	if(inform){
@@ -210,6 +216,30 @@ celix_status_t pubsub_discovery_addNode(pubsub_discovery_pt pubsub_discovery, pu
 	return status;
 }
 
+celix_status_t pubsub_discovery_addNodes(pubsub_discovery_pt pubsub_discovery, array_list_pt pubEPs) {
+	celix_status_t status = CELIX_SUCCESS;
+	array_list_pt added = NULL;
+	int i;
+
+	arrayList_create(&added);
+
+	celixThreadMutex_lock(&pubsub_discovery->discoveredPubsMutex);
+	for(i=0;i<arrayList_size(pubEPs);i++){
+		pubsub_endpoint_pt pubEP = (pubsub_endpoint_pt)arrayList_get(pubEPs,i);
+		if(pubsub_discovery_storeNode(pubsub_discovery, pubEP)){
+			arrayList_add(added,pubEP);
+		}
+	}
+	celixThreadMutex_unlock(&pubsub_discovery->discoveredPubsMutex);
+
+	if(arrayList_size(added)>0){
+		status = pubsub_discovery_informPublishersListenersAdded(pubsub_discovery,added);
+	}
+	arrayList_destroy(added);
+
+	return status;
+}
+
 celix_status_t pubsub_discovery_removeNode(pubsub_discovery_pt pubsub_discovery, pubsub_endpoint_pt pubEP) {
     celix_status_t status = CELIX_SUCCESS;
     pubsub_endpoint_pt p = NULL;
@@ -244,6 +274,40 @@ celix_status_t pubsub_discovery_removeNode(pubsub_discovery_pt pubsub_discovery,
     return status;
 }
 
+celix_status_t pubsub_discovery_removeFrameworkNodes(pubsub_discovery_pt pubsub_discovery, const char* scope, const char* topic, const char* fwUUID) {
+    celix_status_t status = CELIX_SUCCESS;
+    array_list_pt removed = NULL;
+
+    arrayList_create(&removed);
+
+    celixThreadMutex_lock(&pubsub_discovery->discoveredPubsMutex);
+    char *pubs_key = createScopeTopicKey(scope, topic);
+    array_list_pt pubEP_list = (array_list_pt) hashMap_get(pubsub_discovery->discoveredPubs, pubs_key);
+    free(pubs_key);
+    if (pubEP_list != NULL) {
+        int i;
+
+        for (i = 0; i < arrayList_size(pubEP_list); i++) {
+            pubsub_endpoint_pt p = arrayList_get(pubEP_list, i);
+            if (strcmp(p->frameworkUUID, fwUUID) == 0) {
+                arrayList_remove(pubEP_list, i);
+                arrayList_add(removed, p);
+                i--;
+            }
+        }
+    }
+    celixThreadMutex_unlock(&pubsub_discovery->discoveredPubsMutex);
+
+    for (int i = 0; i < arrayList_size(removed); i++) {
+        pubsub_endpoint_pt p = arrayList_get(removed, i);
+        status += pubsub_discovery_informPublishersListeners(pubsub_discovery, p, false);
+        pubsubEndpoint_destroy(p);
+    }
+    arrayList_destroy(removed);
+
+    return status;
+}
+
 /* Callback to the pubsub_topology_manager */
 celix_status_t pubsub_discovery_informPublishersListeners(pubsub_discovery_pt pubsub_discovery, pubsub_endpoint_pt pubEP, bool epAdded) {
 	celix_status_t status = CELIX_SUCCESS;
@@ -275,6 +339,47 @@ celix_status_t pubsub_discovery_informPublishersListeners(pubsub_discovery_pt pu
 }
 
 
+/* Announces a batch of endpoints, using the bulk callback of the listener when it provides one */
+static celix_status_t pubsub_discovery_announceTo(publisher_endpoint_announce_pt listener, array_list_pt endpoints) {
+	celix_status_t status = CELIX_SUCCESS;
+
+	if (listener->announcePublishers != NULL) {
+		status = listener->announcePublishers(listener->handle, endpoints);
+	} else {
+		int i;
+		for (i = 0; i < arrayList_size(endpoints); i++) {
+			status += listener->announcePublisher(listener->handle, (pubsub_endpoint_pt) arrayList_get(endpoints, i));
+		}
+	}
+
+	return status;
+}
+
+celix_status_t pubsub_discovery_informPublishersListenersAdded(pubsub_discovery_pt pubsub_discovery, array_list_pt endpoints) {
+	celix_status_t status = CELIX_SUCCESS;
+
+	celixThreadMutex_lock(&pubsub_discovery->listenerReferencesMutex);
+
+	if (pubsub_discovery->listenerReferences != NULL) {
+		hash_map_iterator_pt iter = hashMapIterator_create(pubsub_discovery->listenerReferences);
+		while (hashMapIterator_hasNext(iter)) {
+			service_reference_pt reference = hashMapIterator_nextKey(iter);
+
+			publisher_endpoint_announce_pt listener = NULL;
+
+			bundleContext_getService(pubsub_discovery->context, reference, (void**) &listener);
+			status += pubsub_discovery_announceTo(listener, endpoints);
+			bundleContext_ungetService(pubsub_discovery->context, reference, NULL);
+		}
+		hashMapIterator_destroy(iter);
+	}
+
+	celixThreadMutex_unlock(&pubsub_discovery->listenerReferencesMutex);
+
+	return status;
+}
+
+
 /* Service's functions implementation */
 celix_status_t pubsub_discovery_announcePublisher(void *handle, pubsub_endpoint_pt pubEP) {
 	celix_status_t status = CELIX_SUCCESS;
@@ -350,47 +455,19 @@ celix_status_t pubsub_discovery_removePublisher(void *handle, pubsub_endpoint_pt
 celix_status_t pubsub_discovery_interestedInTopic(void *handle, const char* scope, const char* topic) {
     pubsub_discovery_pt pubsub_discovery = (pubsub_discovery_pt) handle;
 
-    char *scope_topic_key = createScopeTopicKey(scope, topic);
-    celixThreadMutex_lock(&pubsub_discovery->watchersMutex);
-    struct watcher_info * wi = hashMap_get(pubsub_discovery->watchers, scope_topic_key);
-    if(wi) {
-        wi->nr_references++;
-        free(scope_topic_key);
-    } else {
-        wi = calloc(1, sizeof(*wi));
-        etcdWatcher_create(pubsub_discovery, pubsub_discovery->context, scope, topic, &wi->watcher);
-        wi->nr_references = 1;
-        hashMap_put(pubsub_discovery->watchers, scope_topic_key, wi);
+    if (pubsub_discovery->watcher == NULL) {
+        return CELIX_ILLEGAL_STATE;
     }
 
-    celixThreadMutex_unlock(&pubsub_discovery->watchersMutex);
-
-    return CELIX_SUCCESS;
+    return etcdWatcher_addTopic(pubsub_discovery->watcher, scope, topic);
 }
 
 celix_status_t pubsub_discovery_uninterestedInTopic(void *handle, const char* scope, const char* topic) {
     pubsub_discovery_pt pubsub_discovery = (pubsub_discovery_pt) handle;
 
-    char *scope_topic_key = createScopeTopicKey(scope, topic);
-    celixThreadMutex_lock(&pubsub_discovery->watchersMutex);
-
-    hash_map_entry_pt entry =  hashMap_getEntry(pubsub_discovery->watchers, scope_topic_key);
-    if(entry) {
-        struct watcher_info * wi = hashMapEntry_getValue(entry);
-        wi->nr_references--;
-        if(wi->nr_references == 0) {
-            char *key = hashMapEntry_getKey(entry);
-            hashMap_remove(pubsub_discovery->watchers, scope_topic_key);
-            free(key);
-            free(scope_topic_key);
-            etcdWatcher_stop(wi->watcher);
-            etcdWatcher_destroy(wi->watcher);
-            free(wi);
-        }
-    } else {
+    if (pubsub_discovery->watcher == NULL || etcdWatcher_removeTopic(pubsub_discovery->watcher, scope, topic) != CELIX_SUCCESS) {
         fprintf(stderr, "[DISC] Inconsistency error: Removing unknown topic %s\n", topic);
     }
-    celixThreadMutex_unlock(&pubsub_discovery->watchersMutex);
     return CELIX_SUCCESS;
 }
 
@@ -406,18 +483,22 @@ celix_status_t pubsub_discovery_tmPublisherAnnounceAdded(void * handle, service_
 	celixThreadMutex_lock(&pubsub_discovery->listenerReferencesMutex);
 
 	/* Notify the PSTM about discovered publisher endpoints */
+	array_list_pt discovered = NULL;
+	arrayList_create(&discovered);
+
 	hash_map_iterator_pt iter = hashMapIterator_create(pubsub_discovery->discoveredPubs);
 	while(hashMapIterator_hasNext(iter)){
 		array_list_pt pubEP_list = (array_list_pt)hashMapIterator_nextValue(iter);
-		int i;
-		for(i=0;i<arrayList_size(pubEP_list);i++){
-			pubsub_endpoint_pt pubEP = (pubsub_endpoint_pt)arrayList_get(pubEP_list,i);
-			status += listener->announcePublisher(listener->handle, pubEP);
-		}
+		arrayList_addAll(discovered, pubEP_list);
 	}
 
 	hashMapIterator_destroy(iter);
 
+	if(arrayList_size(discovered)>0){
+		status += pubsub_discovery_announceTo(listener, discovered);
+	}
+	arrayList_destroy(discovered);
+
 	hashMap_put(pubsub_discovery->listenerReferences, reference, NULL);
 
 	celixThreadMutex_unlock(&pubsub_discovery->listenerReferencesMutex);
@@ -32,17 +32,26 @@
 #include "bundle_context.h"
 #include "log_helper.h"
 
+#include <stdio.h>
+
 #include "pubsub_common.h"
 #include "pubsub_endpoint.h"
 #include "publisher.h"
 #include "subscriber.h"
 
 
+struct pubsub_tm_timing {
+	unsigned long count;
+	double totalMs;
+	double maxMs;
+};
+
 struct pubsub_topology_manager {
 	bundle_context_pt context;
 
 	celix_thread_mutex_t psaListLock;
 	array_list_pt psaList;
+	hash_map_pt bestAdmins; //<scope:topic:admin:serializer:qos(string),psa>, guarded by psaListLock, cleared when the psa list or the serializers change
 
 	celix_thread_mutex_t discoveryListLock;
 	hash_map_pt discoveryList; //<serviceReference,NULL>
@@ -53,6 +62,14 @@ struct pubsub_topology_manager {
 	celix_thread_mutex_t subscriptionsLock;
 	hash_map_pt subscriptions; //<topic(string),list<pubsub_ep>>
 
+	celix_thread_mutex_t statsLock;
+	unsigned long matchCacheHits;
+	unsigned long matchCacheMisses;
+	unsigned long matchCalls;
+	struct pubsub_tm_timing subscriberAddedTiming;
+	struct pubsub_tm_timing publisherAddedTiming;
+	struct pubsub_tm_timing publisherDiscoveredTiming;
+
 	log_helper_pt loghelper;
 };
 
@@ -66,6 +83,9 @@ celix_status_t pubsub_topologyManager_psaAdded(void *handle, service_reference_p
 celix_status_t pubsub_topologyManager_psaModified(void *handle, service_reference_pt reference, void *service);
 celix_status_t pubsub_topologyManager_psaRemoved(void *handle, service_reference_pt reference, void *service);
 
+celix_status_t pubsub_topologyManager_serializerAdded(void *handle, service_reference_pt reference, void *service);
+celix_status_t pubsub_topologyManager_serializerRemoved(void *handle, service_reference_pt reference, void *service);
+
 celix_status_t pubsub_topologyManager_pubsubDiscoveryAdded(void* handle, service_reference_pt reference, void* service);
 celix_status_t pubsub_topologyManager_pubsubDiscoveryModified(void * handle, service_reference_pt reference, void* service);
 celix_status_t pubsub_topologyManager_pubsubDiscoveryRemoved(void * handle, service_reference_pt reference, void* service);
@@ -78,6 +98,9 @@ celix_status_t pubsub_topologyManager_publisherTrackerAdded(void *handle, array_
 celix_status_t pubsub_topologyManager_publisherTrackerRemoved(void *handle, array_list_pt listeners);
 
 celix_status_t pubsub_topologyManager_announcePublisher(void *handle, pubsub_endpoint_pt pubEP);
+celix_status_t pubsub_topologyManager_announcePublishers(void *handle, array_list_pt pubEPs);
 celix_status_t pubsub_topologyManager_removePublisher(void *handle, pubsub_endpoint_pt pubEP);
 
+celix_status_t pubsub_topologyManager_executeCommand(void *handle, char *commandLine, FILE *outStream, FILE *errorStream);
+
 #endif /* PUBSUB_TOPOLOGY_MANAGER_H_ */
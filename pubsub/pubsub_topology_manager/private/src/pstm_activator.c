@@ -38,6 +38,7 @@
 #include "listener_hook_service.h"
 #include "log_service.h"
 #include "log_helper.h"
+#include "command.h"
 
 
 #include "pubsub_topology_manager.h"
@@ -51,6 +52,7 @@ struct activator {
 	service_tracker_pt pubsubDiscoveryTracker;
 	service_tracker_pt pubsubAdminTracker;
 	service_tracker_pt pubsubSubscribersTracker;
+	service_tracker_pt pubsubSerializerTracker;
 
 	listener_hook_service_pt hookService;
 	service_registration_pt hook;
@@ -58,6 +60,9 @@ struct activator {
 	publisher_endpoint_announce_pt publisherEPDiscover;
 	service_registration_pt publisherEPDiscoverService;
 
+	command_service_t pstmCommand;
+	service_registration_pt pstmCommandService;
+
 	log_helper_pt loghelper;
 };
 
@@ -65,6 +70,7 @@ struct activator {
 static celix_status_t bundleActivator_createPSDTracker(struct activator *activator, service_tracker_pt *tracker);
 static celix_status_t bundleActivator_createPSATracker(struct activator *activator, service_tracker_pt *tracker);
 static celix_status_t bundleActivator_createPSSubTracker(struct activator *activator, service_tracker_pt *tracker);
+static celix_status_t bundleActivator_createSerializerTracker(struct activator *activator, service_tracker_pt *tracker);
 
 
 static celix_status_t bundleActivator_createPSDTracker(struct activator *activator, service_tracker_pt *tracker) {
@@ -124,6 +130,25 @@ static celix_status_t bundleActivator_createPSSubTracker(struct activator *activ
 	return status;
 }
 
+static celix_status_t bundleActivator_createSerializerTracker(struct activator *activator, service_tracker_pt *tracker) {
+	celix_status_t status = CELIX_SUCCESS;
+
+	service_tracker_customizer_pt customizer = NULL;
+
+	status = serviceTrackerCustomizer_create(activator->manager,
+			NULL,
+			pubsub_topologyManager_serializerAdded,
+			NULL,
+			pubsub_topologyManager_serializerRemoved,
+			&customizer);
+
+	if (status == CELIX_SUCCESS) {
+		status = serviceTracker_create(activator->context, PUBSUB_SERIALIZER_SERVICE, customizer, tracker);
+	}
+
+	return status;
+}
+
 celix_status_t bundleActivator_create(bundle_context_pt context, void **userData) {
 	celix_status_t status = CELIX_SUCCESS;
 	struct activator *activator = NULL;
@@ -146,6 +171,9 @@ celix_status_t bundleActivator_create(bundle_context_pt context, void **userData
 			status = bundleActivator_createPSATracker(activator, &activator->pubsubAdminTracker);
 			if (status == CELIX_SUCCESS) {
 				status = bundleActivator_createPSSubTracker(activator, &activator->pubsubSubscribersTracker);
+				if (status == CELIX_SUCCESS) {
+					status = bundleActivator_createSerializerTracker(activator, &activator->pubsubSerializerTracker);
+				}
 				if (status == CELIX_SUCCESS) {
 					*userData = activator;
 				}
@@ -168,6 +196,7 @@ celix_status_t bundleActivator_start(void * userData, bundle_context_pt context)
 	publisher_endpoint_announce_pt pubEPDiscover = calloc(1, sizeof(*pubEPDiscover));
 	pubEPDiscover->handle = activator->manager;
 	pubEPDiscover->announcePublisher = pubsub_topologyManager_announcePublisher;
+	pubEPDiscover->announcePublishers = pubsub_topologyManager_announcePublishers;
 	pubEPDiscover->removePublisher = pubsub_topologyManager_removePublisher;
 	activator->publisherEPDiscover = pubEPDiscover;
 
@@ -182,6 +211,17 @@ celix_status_t bundleActivator_start(void * userData, bundle_context_pt context)
 
 	status += bundleContext_registerService(context, (char *) OSGI_FRAMEWORK_LISTENER_HOOK_SERVICE_NAME, hookService, NULL, &activator->hook);
 
+	activator->pstmCommand.handle = activator->manager;
+	activator->pstmCommand.executeCommand = pubsub_topologyManager_executeCommand;
+
+	properties_pt commandProps = properties_create();
+	properties_set(commandProps, CELIX_FRAMEWORK_SERVICE_LANGUAGE, CELIX_FRAMEWORK_SERVICE_C_LANGUAGE);
+	properties_set(commandProps, OSGI_SHELL_COMMAND_NAME, "pstm");
+	properties_set(commandProps, OSGI_SHELL_COMMAND_USAGE, "pstm [reset]");
+	properties_set(commandProps, OSGI_SHELL_COMMAND_DESCRIPTION, "Shows the admin match cache and timing statistics of the pubsub topology manager.");
+
+	status += bundleContext_registerService(context, (char *) OSGI_SHELL_COMMAND_SERVICE_NAME, &activator->pstmCommand, commandProps, &activator->pstmCommandService);
+
 	/* NOTE: Enable those line in order to remotely expose the topic_info service
 	properties_pt props = properties_create();
 	properties_set(props, (char *) OSGI_RSA_SERVICE_EXPORTED_INTERFACES, (char *) PUBSUB_TOPIC_INFO_SERVICE);
@@ -189,6 +229,8 @@ celix_status_t bundleActivator_start(void * userData, bundle_context_pt context)
 	*/
 	status += serviceTracker_open(activator->pubsubAdminTracker);
 
+	status += serviceTracker_open(activator->pubsubSerializerTracker);
+
 	status += serviceTracker_open(activator->pubsubDiscoveryTracker);
 
 	status += serviceTracker_open(activator->pubsubSubscribersTracker);
@@ -201,7 +243,10 @@ celix_status_t bundleActivator_stop(void * userData, bundle_context_pt context)
 	celix_status_t status = CELIX_SUCCESS;
 	struct activator *activator = userData;
 
+	serviceRegistration_unregister(activator->pstmCommandService);
+
 	serviceTracker_close(activator->pubsubSubscribersTracker);
+	serviceTracker_close(activator->pubsubSerializerTracker);
 	serviceTracker_close(activator->pubsubDiscoveryTracker);
 	serviceTracker_close(activator->pubsubAdminTracker);
 
@@ -225,6 +270,9 @@ celix_status_t bundleActivator_destroy(void * userData, bundle_context_pt contex
 		if(activator->pubsubSubscribersTracker!=NULL){
 			serviceTracker_destroy(activator->pubsubSubscribersTracker);
 		}
+		if(activator->pubsubSerializerTracker!=NULL){
+			serviceTracker_destroy(activator->pubsubSerializerTracker);
+		}
 		if(activator->pubsubDiscoveryTracker!=NULL){
 			serviceTracker_destroy(activator->pubsubDiscoveryTracker);
 		}
@@ -27,6 +27,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <time.h>
 
 #include "hash_map.h"
 #include "array_list.h"
@@ -48,8 +49,14 @@
 #include "pubsub_topology_manager.h"
 #include "pubsub_endpoint.h"
 #include "pubsub_admin.h"
+#include "pubsub_admin_match.h"
+#include "pubsub_serializer.h"
 #include "pubsub_utils.h"
 
+static pubsub_admin_service_pt pubsub_topologyManager_findBestAdmin(pubsub_topology_manager_pt manager, pubsub_endpoint_pt endpoint);
+static void pubsub_topologyManager_clearBestAdmins(pubsub_topology_manager_pt manager);
+static celix_status_t pubsub_topologyManager_addDiscoveredPublisher(pubsub_topology_manager_pt manager, pubsub_endpoint_pt pubEP);
+static void pubsub_topologyManager_recordTiming(pubsub_topology_manager_pt manager, struct pubsub_tm_timing *timing, struct timespec *begin, unsigned long count);
 
 celix_status_t pubsub_topologyManager_create(bundle_context_pt context, log_helper_pt logHelper, pubsub_topology_manager_pt *manager) {
 	celix_status_t status = CELIX_SUCCESS;
@@ -70,8 +77,10 @@ celix_status_t pubsub_topologyManager_create(bundle_context_pt context, log_help
 	status = celixThreadMutex_create(&(*manager)->publicationsLock, NULL);
 	status = celixThreadMutex_create(&(*manager)->subscriptionsLock, NULL);
 	status = celixThreadMutex_create(&(*manager)->discoveryListLock, NULL);
+	status = celixThreadMutex_create(&(*manager)->statsLock, NULL);
 
 	arrayList_create(&(*manager)->psaList);
+	(*manager)->bestAdmins = hashMap_create(utils_stringHash, NULL, utils_stringEquals, NULL);
 
 	(*manager)->discoveryList = hashMap_create(serviceReference_hashCode, NULL, serviceReference_equals2, NULL);
 	(*manager)->publications = hashMap_create(utils_stringHash, NULL, utils_stringEquals, NULL);
@@ -92,8 +101,10 @@ celix_status_t pubsub_topologyManager_destroy(pubsub_topology_manager_pt manager
 
 	celixThreadMutex_lock(&manager->psaListLock);
 	arrayList_destroy(manager->psaList);
+	hashMap_destroy(manager->bestAdmins, true, false);
 	celixThreadMutex_unlock(&manager->psaListLock);
 	celixThreadMutex_destroy(&manager->psaListLock);
+	celixThreadMutex_destroy(&manager->statsLock);
 
 	celixThreadMutex_lock(&manager->publicationsLock);
 	hash_map_iterator_pt pubit = hashMapIterator_create(manager->publications);
@@ -140,6 +151,7 @@ celix_status_t pubsub_topologyManager_psaAdded(void * handle, service_reference_
 
 	celixThreadMutex_lock(&manager->psaListLock);
 	arrayList_add(manager->psaList, psa);
+	pubsub_topologyManager_clearBestAdmins(manager);
 	celixThreadMutex_unlock(&manager->psaListLock);
 
 	// Add already detected subscriptions to new PSA
@@ -248,6 +260,7 @@ celix_status_t pubsub_topologyManager_psaRemoved(void * handle, service_referenc
 
 	celixThreadMutex_lock(&manager->psaListLock);
 	arrayList_removeElement(manager->psaList, psa);
+	pubsub_topologyManager_clearBestAdmins(manager);
 	celixThreadMutex_unlock(&manager->psaListLock);
 
 	logHelper_log(manager->loghelper, OSGI_LOGSERVICE_INFO, "PSTM: Removed PSA");
@@ -259,6 +272,9 @@ celix_status_t pubsub_topologyManager_subscriberAdded(void * handle, service_ref
 	celix_status_t status = CELIX_SUCCESS;
 	pubsub_topology_manager_pt manager = handle;
 	//subscriber_service_pt subscriber = (subscriber_service_pt)service;
+	struct timespec begin;
+
+	clock_gettime(CLOCK_MONOTONIC, &begin);
 
 	pubsub_endpoint_pt sub = NULL;
 	if(pubsubEndpoint_createFromServiceReference(reference,&sub,false) == CELIX_SUCCESS){
@@ -275,21 +291,10 @@ celix_status_t pubsub_topologyManager_subscriberAdded(void * handle, service_ref
 
 		celixThreadMutex_unlock(&manager->subscriptionsLock);
 
-		int j;
-		double score = 0;
-		double best_score = 0;
-		pubsub_admin_service_pt best_psa = NULL;
 		celixThreadMutex_lock(&manager->psaListLock);
-		for(j=0;j<arrayList_size(manager->psaList);j++){
-			pubsub_admin_service_pt psa = (pubsub_admin_service_pt)arrayList_get(manager->psaList,j);
-			psa->matchEndpoint(psa->admin,sub,&score);
-			if(score>best_score){ /* We have a new winner! */
-				best_score = score;
-				best_psa = psa;
-			}
-		}
+		pubsub_admin_service_pt best_psa = pubsub_topologyManager_findBestAdmin(manager, sub);
 
-		if(best_psa != NULL && best_score>0){
+		if(best_psa != NULL){
 			best_psa->addSubscription(best_psa->admin,sub);
 		}
 
@@ -307,6 +312,8 @@ celix_status_t pubsub_topologyManager_subscriberAdded(void * handle, service_ref
 		celixThreadMutex_unlock(&manager->discoveryListLock);
 
 		celixThreadMutex_unlock(&manager->psaListLock);
+
+		pubsub_topologyManager_recordTiming(manager, &manager->subscriberAddedTiming, &begin, 1);
 	}
 	else{
 		status=CELIX_INVALID_BUNDLE_CONTEXT;
@@ -429,9 +436,9 @@ celix_status_t pubsub_topologyManager_pubsubDiscoveryAdded(void* handle, service
 
 	while(hashMapIterator_hasNext(iter)) {
 		array_list_pt l = (array_list_pt)hashMapIterator_nextValue(iter);
-		int i;
-		for(i=0;i<arrayList_size(l);i++){
-			pubsub_endpoint_pt subEp = (pubsub_endpoint_pt)arrayList_get(l,i);
+		/* all subscriptions in the list share the same scope and topic */
+		if(arrayList_size(l)>0){
+			pubsub_endpoint_pt subEp = (pubsub_endpoint_pt)arrayList_get(l,0);
 
 			disc->interestedInTopic(disc->handle, subEp->scope, subEp->topic);
 		}
@@ -475,9 +482,12 @@ celix_status_t pubsub_topologyManager_publisherTrackerAdded(void *handle, array_
 
 	celix_status_t status = CELIX_SUCCESS;
 	pubsub_topology_manager_pt manager = handle;
+	struct timespec begin;
 
 	int l_index;
 
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+
 	for (l_index = 0; l_index < arrayList_size(listeners); l_index++) {
 
 		listener_hook_info_pt info = arrayList_get(listeners, l_index);
@@ -497,22 +507,10 @@ celix_status_t pubsub_topologyManager_publisherTrackerAdded(void *handle, array_
 
 			celixThreadMutex_unlock(&manager->publicationsLock);
 
-			int j;
-			double score = 0;
-			double best_score = 0;
-			pubsub_admin_service_pt best_psa = NULL;
 			celixThreadMutex_lock(&manager->psaListLock);
+			pubsub_admin_service_pt best_psa = pubsub_topologyManager_findBestAdmin(manager, pub);
 
-			for(j=0;j<arrayList_size(manager->psaList);j++){
-				pubsub_admin_service_pt psa = (pubsub_admin_service_pt)arrayList_get(manager->psaList,j);
-				psa->matchEndpoint(psa->admin,pub,&score);
-				if(score>best_score){ /* We have a new winner! */
-					best_score = score;
-					best_psa = psa;
-				}
-			}
-
-			if(best_psa != NULL && best_score>0){
+			if(best_psa != NULL){
 				status = best_psa->addPublication(best_psa->admin,pub);
 				if(status==CELIX_SUCCESS){
 					celixThreadMutex_lock(&manager->discoveryListLock);
@@ -535,6 +533,10 @@ celix_status_t pubsub_topologyManager_publisherTrackerAdded(void *handle, array_
 
 	}
 
+	if (arrayList_size(listeners) > 0) {
+		pubsub_topologyManager_recordTiming(manager, &manager->publisherAddedTiming, &begin, arrayList_size(listeners));
+	}
+
 	return status;
 
 }
@@ -617,58 +619,58 @@ celix_status_t pubsub_topologyManager_publisherTrackerRemoved(void *handle, arra
 
 celix_status_t pubsub_topologyManager_announcePublisher(void *handle, pubsub_endpoint_pt pubEP){
 	celix_status_t status = CELIX_SUCCESS;
-	printf("PSTM: New publisher discovered for topic %s [fwUUID=%s, ep=%s]\n",pubEP->topic,pubEP->frameworkUUID,pubEP->endpoint);
-
 	pubsub_topology_manager_pt manager = handle;
+	struct timespec begin;
+
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+
 	celixThreadMutex_lock(&manager->psaListLock);
 	celixThreadMutex_lock(&manager->publicationsLock);
 
-	char *pub_key = createScopeTopicKey(pubEP->scope, pubEP->topic);
+	status = pubsub_topologyManager_addDiscoveredPublisher(manager, pubEP);
 
-	array_list_pt pub_list_by_topic = hashMap_get(manager->publications,pub_key);
-	if(pub_list_by_topic==NULL){
-		arrayList_create(&pub_list_by_topic);
-		hashMap_put(manager->publications,strdup(pub_key),pub_list_by_topic);
-	}
-	free(pub_key);
+	celixThreadMutex_unlock(&manager->publicationsLock);
+	celixThreadMutex_unlock(&manager->psaListLock);
 
-	/* Shouldn't be any other duplicate, since it's filtered out by the discovery */
-	pubsub_endpoint_pt p = NULL;
-	pubsubEndpoint_clone(pubEP, &p);
-	arrayList_add(pub_list_by_topic,p);
+	pubsub_topologyManager_recordTiming(manager, &manager->publisherDiscoveredTiming, &begin, 1);
 
-	int j;
-	double score = 0;
-	double best_score = 0;
-	pubsub_admin_service_pt best_psa = NULL;
+	return status;
+}
 
-	for(j=0;j<arrayList_size(manager->psaList);j++){
-		pubsub_admin_service_pt psa = (pubsub_admin_service_pt)arrayList_get(manager->psaList,j);
-		psa->matchEndpoint(psa->admin,p,&score);
-		if(score>best_score){ /* We have a new winner! */
-			best_score = score;
-			best_psa = psa;
-		}
-	}
+celix_status_t pubsub_topologyManager_announcePublishers(void *handle, array_list_pt pubEPs){
+	celix_status_t status = CELIX_SUCCESS;
+	pubsub_topology_manager_pt manager = handle;
+	struct timespec begin;
+	int i;
 
-	if(best_psa != NULL && best_score>0){
-		best_psa->addPublication(best_psa->admin,p);
-	}
-	else{
-		status = CELIX_ILLEGAL_STATE;
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+
+	logHelper_log(manager->loghelper, OSGI_LOGSERVICE_DEBUG, "PSTM: %i publishers discovered", arrayList_size(pubEPs));
+
+	/* The whole batch is matched and added under one acquisition of the locks */
+	celixThreadMutex_lock(&manager->psaListLock);
+	celixThreadMutex_lock(&manager->publicationsLock);
+
+	for(i=0;i<arrayList_size(pubEPs);i++){
+		if(pubsub_topologyManager_addDiscoveredPublisher(manager, (pubsub_endpoint_pt)arrayList_get(pubEPs,i)) != CELIX_SUCCESS){
+			status = CELIX_ILLEGAL_STATE;
+		}
 	}
 
 	celixThreadMutex_unlock(&manager->publicationsLock);
 	celixThreadMutex_unlock(&manager->psaListLock);
 
+	if (arrayList_size(pubEPs) > 0) {
+		pubsub_topologyManager_recordTiming(manager, &manager->publisherDiscoveredTiming, &begin, arrayList_size(pubEPs));
+	}
+
 	return status;
 }
 
 celix_status_t pubsub_topologyManager_removePublisher(void *handle, pubsub_endpoint_pt pubEP){
 	celix_status_t status = CELIX_SUCCESS;
-	printf("PSTM: Publisher removed for topic %s [fwUUID=%s, ep=%s]\n",pubEP->topic,pubEP->frameworkUUID,pubEP->endpoint);
-
 	pubsub_topology_manager_pt manager = handle;
+	logHelper_log(manager->loghelper, OSGI_LOGSERVICE_DEBUG, "PSTM: Publisher removed for topic %s [fwUUID=%s, ep=%s]", pubEP->topic, pubEP->frameworkUUID, pubEP->endpoint);
 	celixThreadMutex_lock(&manager->psaListLock);
 	celixThreadMutex_lock(&manager->publicationsLock);
 	int i;
@@ -721,3 +723,180 @@ celix_status_t pubsub_topologyManager_removePublisher(void *handle, pubsub_endpo
 	return status;
 }
 
+celix_status_t pubsub_topologyManager_executeCommand(void *handle, char *commandLine, FILE *outStream, FILE *errorStream) {
+	pubsub_topology_manager_pt manager = handle;
+	char *save = NULL;
+	char *line = strdup(commandLine);
+	char *sub = NULL;
+
+	strtok_r(line, " ", &save); //skip command name
+	sub = strtok_r(NULL, " ", &save);
+
+	if (sub != NULL && strcmp(sub, "reset") == 0) {
+		celixThreadMutex_lock(&manager->statsLock);
+		manager->matchCacheHits = 0;
+		manager->matchCacheMisses = 0;
+		manager->matchCalls = 0;
+		memset(&manager->subscriberAddedTiming, 0, sizeof(manager->subscriberAddedTiming));
+		memset(&manager->publisherAddedTiming, 0, sizeof(manager->publisherAddedTiming));
+		memset(&manager->publisherDiscoveredTiming, 0, sizeof(manager->publisherDiscoveredTiming));
+		celixThreadMutex_unlock(&manager->statsLock);
+		fprintf(outStream, "PSTM statistics reset\n");
+	} else if (sub != NULL) {
+		fprintf(errorStream, "Usage: pstm [reset]\n");
+	} else {
+		int admins = 0;
+		int cached = 0;
+
+		celixThreadMutex_lock(&manager->psaListLock);
+		admins = arrayList_size(manager->psaList);
+		cached = hashMap_size(manager->bestAdmins);
+		celixThreadMutex_unlock(&manager->psaListLock);
+
+		celixThreadMutex_lock(&manager->statsLock);
+		fprintf(outStream, "Pubsub admins: %i, cached admin assignments: %i\n", admins, cached);
+		fprintf(outStream, "Admin match cache: %lu hits, %lu misses, %lu matchEndpoint calls\n", manager->matchCacheHits, manager->matchCacheMisses, manager->matchCalls);
+		fprintf(outStream, "%-24s %10s %12s %12s\n", "", "count", "total (ms)", "max (ms)");
+		fprintf(outStream, "%-24s %10lu %12.3f %12.3f\n", "subscribers added", manager->subscriberAddedTiming.count, manager->subscriberAddedTiming.totalMs, manager->subscriberAddedTiming.maxMs);
+		fprintf(outStream, "%-24s %10lu %12.3f %12.3f\n", "publishers added", manager->publisherAddedTiming.count, manager->publisherAddedTiming.totalMs, manager->publisherAddedTiming.maxMs);
+		fprintf(outStream, "%-24s %10lu %12.3f %12.3f\n", "publishers discovered", manager->publisherDiscoveredTiming.count, manager->publisherDiscoveredTiming.totalMs, manager->publisherDiscoveredTiming.maxMs);
+		celixThreadMutex_unlock(&manager->statsLock);
+	}
+
+	free(line);
+
+	return CELIX_SUCCESS;
+}
+
+/* Caller must hold the psaListLock and the publicationsLock */
+static celix_status_t pubsub_topologyManager_addDiscoveredPublisher(pubsub_topology_manager_pt manager, pubsub_endpoint_pt pubEP){
+	celix_status_t status = CELIX_SUCCESS;
+
+	logHelper_log(manager->loghelper, OSGI_LOGSERVICE_DEBUG, "PSTM: New publisher discovered for topic %s [fwUUID=%s, ep=%s]", pubEP->topic, pubEP->frameworkUUID, pubEP->endpoint);
+
+	char *pub_key = createScopeTopicKey(pubEP->scope, pubEP->topic);
+
+	array_list_pt pub_list_by_topic = hashMap_get(manager->publications,pub_key);
+	if(pub_list_by_topic==NULL){
+		arrayList_create(&pub_list_by_topic);
+		hashMap_put(manager->publications,strdup(pub_key),pub_list_by_topic);
+	}
+	free(pub_key);
+
+	/* Shouldn't be any other duplicate, since it's filtered out by the discovery */
+	pubsub_endpoint_pt p = NULL;
+	pubsubEndpoint_clone(pubEP, &p);
+	arrayList_add(pub_list_by_topic,p);
+
+	pubsub_admin_service_pt best_psa = pubsub_topologyManager_findBestAdmin(manager, p);
+
+	if(best_psa != NULL){
+		best_psa->addPublication(best_psa->admin,p);
+	}
+	else{
+		status = CELIX_ILLEGAL_STATE;
+	}
+
+	return status;
+}
+
+/*
+ * The score of a psa depends on the serializers it has, the cached best admins are chosen again on the next match.
+ */
+celix_status_t pubsub_topologyManager_serializerAdded(void *handle, service_reference_pt reference, void *service) {
+	pubsub_topology_manager_pt manager = handle;
+
+	celixThreadMutex_lock(&manager->psaListLock);
+	pubsub_topologyManager_clearBestAdmins(manager);
+	celixThreadMutex_unlock(&manager->psaListLock);
+
+	return CELIX_SUCCESS;
+}
+
+celix_status_t pubsub_topologyManager_serializerRemoved(void *handle, service_reference_pt reference, void *service) {
+	return pubsub_topologyManager_serializerAdded(handle, reference, service);
+}
+
+/*
+ * The score of a psa only depends on the scope, topic and the requested admin, serializer and qos,
+ * so endpoints sharing those share the best admin.
+ */
+static char *pubsub_topologyManager_createMatchKey(pubsub_endpoint_pt endpoint) {
+	const char *admin = NULL;
+	const char *serializer = NULL;
+	const char *qos = NULL;
+	char *key = NULL;
+
+	if (endpoint->topic_props != NULL) {
+		admin = properties_get(endpoint->topic_props, PUBSUB_ADMIN_TYPE_KEY);
+		serializer = properties_get(endpoint->topic_props, PUBSUB_SERIALIZER_TYPE_KEY);
+		qos = properties_get(endpoint->topic_props, QOS_ATTRIBUTE_KEY);
+	}
+
+	if (asprintf(&key, "%s:%s:%s:%s:%s", endpoint->scope != NULL ? endpoint->scope : "", endpoint->topic != NULL ? endpoint->topic : "",
+			admin != NULL ? admin : "", serializer != NULL ? serializer : "", qos != NULL ? qos : "") < 0) {
+		key = NULL;
+	}
+
+	return key;
+}
+
+/* Caller must hold the psaListLock */
+static pubsub_admin_service_pt pubsub_topologyManager_findBestAdmin(pubsub_topology_manager_pt manager, pubsub_endpoint_pt endpoint) {
+	char *key = pubsub_topologyManager_createMatchKey(endpoint);
+	pubsub_admin_service_pt best_psa = key != NULL ? hashMap_get(manager->bestAdmins, key) : NULL;
+
+	if (best_psa != NULL) {
+		free(key);
+		celixThreadMutex_lock(&manager->statsLock);
+		manager->matchCacheHits++;
+		celixThreadMutex_unlock(&manager->statsLock);
+		return best_psa;
+	}
+
+	int j;
+	int size = arrayList_size(manager->psaList);
+	double best_score = 0;
+
+	for(j=0;j<size;j++){
+		pubsub_admin_service_pt psa = (pubsub_admin_service_pt)arrayList_get(manager->psaList,j);
+		double score = 0;
+		psa->matchEndpoint(psa->admin,endpoint,&score);
+		if(score>best_score){ /* We have a new winner! */
+			best_score = score;
+			best_psa = psa;
+		}
+	}
+
+	if (best_psa != NULL && key != NULL) {
+		hashMap_put(manager->bestAdmins, key, best_psa);
+	} else {
+		free(key);
+	}
+
+	celixThreadMutex_lock(&manager->statsLock);
+	manager->matchCacheMisses++;
+	manager->matchCalls += size;
+	celixThreadMutex_unlock(&manager->statsLock);
+
+	return best_psa;
+}
+
+/* Caller must hold the psaListLock */
+static void pubsub_topologyManager_clearBestAdmins(pubsub_topology_manager_pt manager) {
+	hashMap_clear(manager->bestAdmins, true, false);
+}
+
+static void pubsub_topologyManager_recordTiming(pubsub_topology_manager_pt manager, struct pubsub_tm_timing *timing, struct timespec *begin, unsigned long count) {
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	double ms = (end.tv_sec - begin->tv_sec) * 1000.0 + (end.tv_nsec - begin->tv_nsec) / 1000000.0;
+
+	celixThreadMutex_lock(&manager->statsLock);
+	timing->count += count;
+	timing->totalMs += ms;
+	if (ms > timing->maxMs) {
+		timing->maxMs = ms;
+	}
+	celixThreadMutex_unlock(&manager->statsLock);
+}
@@ -0,0 +1,209 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+/*
+ * pstm_benchmark.c
+ *
+ * Pubsub topology manager benchmark. Announces NR_OF_TOPICS topics published by NR_OF_FRAMEWORKS remote
+ * frameworks to a topology manager with NR_OF_ADMINS mock pubsub admins, first one endpoint at a time and then
+ * as a single batch, and reports the time spent and the number of matchEndpoint calls needed. Finally checks that the
+ * cached best admin is chosen again after a serializer change.
+ *
+ *  \author    	<a href="mailto:dev@celix.apache.org">Apache Celix Project Team</a>
+ *  \copyright	Apache License, Version 2.0
+ */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "celix_launcher.h"
+#include "framework.h"
+#include "constants.h"
+#include "properties.h"
+#include "array_list.h"
+#include "log_helper.h"
+
+#include "pubsub_admin.h"
+#include "pubsub_endpoint.h"
+#include "pubsub_topology_manager.h"
+
+#define NR_OF_TOPICS 1000
+#define NR_OF_FRAMEWORKS 3
+#define NR_OF_ADMINS 2
+#define NR_OF_ENDPOINTS (NR_OF_TOPICS * NR_OF_FRAMEWORKS)
+
+struct pubsub_admin {
+	double score;
+	unsigned long matchCalls;
+	int publications;
+};
+
+static double pstmBenchmark_elapsedMs(struct timespec *begin, struct timespec *end) {
+	return (end->tv_sec - begin->tv_sec) * 1000.0 + (end->tv_nsec - begin->tv_nsec) / 1000000.0;
+}
+
+static celix_status_t pstmBenchmark_addSubscription(pubsub_admin_pt admin, pubsub_endpoint_pt subEP) {
+	return CELIX_SUCCESS;
+}
+
+static celix_status_t pstmBenchmark_removeSubscription(pubsub_admin_pt admin, pubsub_endpoint_pt subEP) {
+	return CELIX_SUCCESS;
+}
+
+static celix_status_t pstmBenchmark_addPublication(pubsub_admin_pt admin, pubsub_endpoint_pt pubEP) {
+	admin->publications++;
+	return CELIX_SUCCESS;
+}
+
+static celix_status_t pstmBenchmark_removePublication(pubsub_admin_pt admin, pubsub_endpoint_pt pubEP) {
+	return CELIX_SUCCESS;
+}
+
+static celix_status_t pstmBenchmark_closeAllPublications(pubsub_admin_pt admin, char *scope, char *topic) {
+	return CELIX_SUCCESS;
+}
+
+static celix_status_t pstmBenchmark_closeAllSubscriptions(pubsub_admin_pt admin, char *scope, char *topic) {
+	return CELIX_SUCCESS;
+}
+
+static celix_status_t pstmBenchmark_matchEndpoint(pubsub_admin_pt admin, pubsub_endpoint_pt endpoint, double *score) {
+	admin->matchCalls++;
+	*score = admin->score;
+	return CELIX_SUCCESS;
+}
+
+static void pstmBenchmark_createEndpoints(array_list_pt endpoints) {
+	int i;
+	int j;
+	for (i = 0; i < NR_OF_TOPICS; ++i) {
+		char topic[32];
+		snprintf(topic, sizeof(topic), "bench_topic_%i", i);
+		for (j = 0; j < NR_OF_FRAMEWORKS; ++j) {
+			char fwUUID[32];
+			char url[64];
+			pubsub_endpoint_pt ep = NULL;
+			snprintf(fwUUID, sizeof(fwUUID), "bench-framework-%i", j);
+			snprintf(url, sizeof(url), "tcp://10.0.0.%i:%i", j + 1, 5000 + i);
+			pubsubEndpoint_create(fwUUID, "default", topic, i + 1, url, NULL, &ep);
+			arrayList_add(endpoints, ep);
+		}
+	}
+}
+
+static unsigned long pstmBenchmark_matchCalls(struct pubsub_admin admins[]) {
+	unsigned long calls = 0;
+	int i;
+	for (i = 0; i < NR_OF_ADMINS; ++i) {
+		calls += admins[i].matchCalls;
+		admins[i].matchCalls = 0;
+	}
+	return calls;
+}
+
+int main(int argc, char **argv) {
+	framework_pt framework = NULL;
+	bundle_pt bundle = NULL;
+	bundle_context_pt context = NULL;
+	log_helper_pt loghelper = NULL;
+	pubsub_topology_manager_pt manager = NULL;
+	struct pubsub_admin admins[NR_OF_ADMINS];
+	struct pubsub_admin_service services[NR_OF_ADMINS];
+	array_list_pt endpoints = NULL;
+	struct timespec begin;
+	struct timespec end;
+	int published = 0;
+	int i;
+
+	properties_pt config = properties_create();
+	properties_set(config, (char *) OSGI_FRAMEWORK_FRAMEWORK_STORAGE_CLEAN, (char *) OSGI_FRAMEWORK_FRAMEWORK_STORAGE_CLEAN_ONFIRSTINIT);
+	if (celixLauncher_launchWithProperties(config, &framework) != CELIX_SUCCESS) {
+		return EXIT_FAILURE;
+	}
+	framework_getFrameworkBundle(framework, &bundle);
+	bundle_getContext(bundle, &context);
+
+	logHelper_create(context, &loghelper);
+	logHelper_start(loghelper);
+	pubsub_topologyManager_create(context, loghelper, &manager);
+
+	for (i = 0; i < NR_OF_ADMINS; ++i) {
+		memset(&admins[i], 0, sizeof(admins[i]));
+		admins[i].score = 100.0 * (i + 1);
+
+		memset(&services[i], 0, sizeof(services[i]));
+		services[i].admin = &admins[i];
+		services[i].addSubscription = pstmBenchmark_addSubscription;
+		services[i].removeSubscription = pstmBenchmark_removeSubscription;
+		services[i].addPublication = pstmBenchmark_addPublication;
+		services[i].removePublication = pstmBenchmark_removePublication;
+		services[i].closeAllPublications = pstmBenchmark_closeAllPublications;
+		services[i].closeAllSubscriptions = pstmBenchmark_closeAllSubscriptions;
+		services[i].matchEndpoint = pstmBenchmark_matchEndpoint;
+		pubsub_topologyManager_psaAdded(manager, NULL, &services[i]);
+	}
+
+	arrayList_create(&endpoints);
+	pstmBenchmark_createEndpoints(endpoints);
+
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	for (i = 0; i < arrayList_size(endpoints); ++i) {
+		pubsub_topologyManager_announcePublisher(manager, arrayList_get(endpoints, i));
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	printf("Announced %i publishers one at a time in %.3f ms, %lu matchEndpoint calls\n", NR_OF_ENDPOINTS, pstmBenchmark_elapsedMs(&begin, &end), pstmBenchmark_matchCalls(admins));
+	for (i = 0; i < arrayList_size(endpoints); ++i) {
+		pubsub_topologyManager_removePublisher(manager, arrayList_get(endpoints, i));
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	pubsub_topologyManager_announcePublishers(manager, endpoints);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	printf("Announced %i publishers as one batch in %.3f ms, %lu matchEndpoint calls\n", NR_OF_ENDPOINTS, pstmBenchmark_elapsedMs(&begin, &end), pstmBenchmark_matchCalls(admins));
+	published = admins[NR_OF_ADMINS - 1].publications;
+
+	pubsub_topologyManager_executeCommand(manager, "pstm", stdout, stderr);
+
+	/* a serializer change can make another admin the best one, the cached choice must not be used anymore */
+	pubsub_endpoint_pt reannounced = arrayList_get(endpoints, 0);
+	pubsub_topologyManager_removePublisher(manager, reannounced);
+	admins[0].score = 1000.0;
+	pubsub_topologyManager_serializerAdded(manager, NULL, NULL);
+	pubsub_topologyManager_announcePublisher(manager, reannounced);
+	bool rematched = admins[0].publications == 1;
+	printf("Best admin chosen again after a serializer change: %s\n", rematched ? "yes" : "no");
+
+	for (i = 0; i < arrayList_size(endpoints); ++i) {
+		pubsub_topologyManager_removePublisher(manager, arrayList_get(endpoints, i));
+		pubsubEndpoint_destroy(arrayList_get(endpoints, i));
+	}
+	arrayList_destroy(endpoints);
+
+	pubsub_topologyManager_destroy(manager);
+	logHelper_stop(loghelper);
+	logHelper_destroy(&loghelper);
+
+	celixLauncher_stop(framework);
+	celixLauncher_waitForShutdown(framework);
+	celixLauncher_destroy(framework);
+
+	/* the best scoring admin must have been selected for every announcement of both rounds */
+	return published == 2 * NR_OF_ENDPOINTS && rematched ? EXIT_SUCCESS : EXIT_FAILURE;
+}
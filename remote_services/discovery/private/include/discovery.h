@@ -39,6 +39,17 @@
 #define DISCOVERY_SERVER_PATH 		"DISCOVERY_CFG_SERVER_PATH"
 #define DISCOVERY_POLL_ENDPOINTS 	"DISCOVERY_CFG_POLL_ENDPOINTS"
 #define DISCOVERY_SERVER_MAX_EP	"DISCOVERY_CFG_SERVER_MAX_EP"
+#define DISCOVERY_SERVER_THREADS	"DISCOVERY_CFG_SERVER_THREADS"
+
+/*
+ * The endpoint discovery server returns an ETag with every document. A poller which sends this ETag back with
+ * If-None-Match gets a 304 when nothing changed, can wait for a change with the wait query parameter (long poll)
+ * and can ask for only the changed endpoints with the delta query parameter.
+ */
+#define DISCOVERY_WAIT_PARAMETER	"wait"
+#define DISCOVERY_DELTA_PARAMETER	"delta"
+#define DISCOVERY_DELTA_HEADER		"X-Celix-Discovery-Delta"
+#define DISCOVERY_REMOVED_HEADER	"X-Celix-Discovery-Removed"
 
 typedef struct discovery *discovery_pt;
 
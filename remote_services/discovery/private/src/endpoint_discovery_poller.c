@@ -27,7 +27,9 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <strings.h>
 #include <unistd.h>
+#include <time.h>
 
 #include <curl/curl.h>
 
@@ -43,11 +45,39 @@
 #define DISCOVERY_POLL_INTERVAL "DISCOVERY_CFG_POLL_INTERVAL"
 #define DEFAULT_POLL_INTERVAL "10"
 
+#define MAX_ETAG_LENGTH 64
+
+struct MemoryStruct {
+	char *memory;
+	size_t size;
+};
+
+typedef struct endpoint_discovery_poller_entry {
+	hash_map_pt endpoints; // key = endpoint id, value = endpoint_description_pt
+	char etag[MAX_ETAG_LENGTH]; // ETag of the last processed response, empty if the server does not provide one
+} *endpoint_discovery_poller_entry_pt;
+
+typedef struct endpoint_discovery_poller_request {
+	char *url;
+	char etag[MAX_ETAG_LENGTH]; // ETag send with If-None-Match
+
+	CURL *curl;
+	struct curl_slist *headers;
+	struct MemoryStruct body;
+	bool done;
+
+	char responseEtag[MAX_ETAG_LENGTH];
+	bool delta;
+	char *removed;
+} *endpoint_discovery_poller_request_pt;
+
 
 static void *endpointDiscoveryPoller_performPeriodicPoll(void *data);
-celix_status_t endpointDiscoveryPoller_poll(endpoint_discovery_poller_pt poller, char *url, array_list_pt currentEndpoints);
-static celix_status_t endpointDiscoveryPoller_getEndpoints(endpoint_discovery_poller_pt poller, char *url, array_list_pt *updatedEndpoints);
-static celix_status_t endpointDiscoveryPoller_endpointDescriptionEquals(const void *endpointPtr, const void *comparePtr, bool *equals);
+celix_status_t endpointDiscoveryPoller_poll(endpoint_discovery_poller_pt poller, char *url, endpoint_discovery_poller_entry_pt entry);
+static endpoint_discovery_poller_request_pt endpointDiscoveryPoller_createRequest(char *url, const char *etag, unsigned int waitInSec);
+static void endpointDiscoveryPoller_destroyRequest(endpoint_discovery_poller_request_pt request);
+static bool endpointDiscoveryPoller_processResponse(endpoint_discovery_poller_pt poller, endpoint_discovery_poller_request_pt request, CURLcode res);
+static void endpointDiscoveryPoller_destroyEntry(endpoint_discovery_poller_pt poller, endpoint_discovery_poller_entry_pt entry);
 
 /**
  * Allocates memory and initializes a new endpoint_discovery_poller instance.
@@ -182,18 +212,22 @@ celix_status_t endpointDiscoveryPoller_addDiscoveryEndpoint(endpoint_discovery_p
 	}
 
 	// Avoid memory leaks when adding an already existing URL...
-	array_list_pt endpoints = hashMap_get(poller->entries, url);
-	if (endpoints == NULL) {
-		status = arrayList_createWithEquals(endpointDiscoveryPoller_endpointDescriptionEquals, &endpoints);
+	endpoint_discovery_poller_entry_pt entry = hashMap_get(poller->entries, url);
+	if (entry == NULL) {
+		entry = calloc(1, sizeof(*entry));
+
+		if (entry == NULL) {
+			status = CELIX_ENOMEM;
+		} else {
+			entry->endpoints = hashMap_create(utils_stringHash, NULL, utils_stringEquals, NULL);
 
-		if (status == CELIX_SUCCESS) {
 			logHelper_log(*poller->loghelper, OSGI_LOGSERVICE_DEBUG, "ENDPOINT_POLLER: add new discovery endpoint with url %s", url);
-			hashMap_put(poller->entries, strdup(url), endpoints);
-			endpointDiscoveryPoller_poll(poller, url, endpoints);
+			hashMap_put(poller->entries, strdup(url), entry);
+			endpointDiscoveryPoller_poll(poller, url, entry);
 		}
 	}
 
-	status = celixThreadMutex_unlock(&poller->pollerLock);
+	celixThreadMutex_unlock(&poller->pollerLock);
 
 	return status;
 }
@@ -216,16 +250,10 @@ celix_status_t endpointDiscoveryPoller_removeDiscoveryEndpoint(endpoint_discover
 
 			logHelper_log(*poller->loghelper, OSGI_LOGSERVICE_DEBUG, "ENDPOINT_POLLER: remove discovery endpoint with url %s", url);
 
-			array_list_pt entries = hashMap_remove(poller->entries, url);
+			endpoint_discovery_poller_entry_pt pollerEntry = hashMap_remove(poller->entries, url);
 
-			if (entries != NULL) {
-				for (unsigned int i = arrayList_size(entries); i > 0; i--) {
-					endpoint_description_pt endpoint = arrayList_get(entries, i - 1);
-					discovery_removeDiscoveredEndpoint(poller->discovery, endpoint);
-					arrayList_remove(entries, i - 1);
-					endpointDescription_destroy(endpoint);
-				}
-				arrayList_destroy(entries);
+			if (pollerEntry != NULL) {
+				endpointDiscoveryPoller_destroyEntry(poller, pollerEntry);
 			}
 
 			free(origKey);
@@ -236,59 +264,199 @@ celix_status_t endpointDiscoveryPoller_removeDiscoveryEndpoint(endpoint_discover
 	return status;
 }
 
+static void endpointDiscoveryPoller_destroyEntry(endpoint_discovery_poller_pt poller, endpoint_discovery_poller_entry_pt entry) {
+	hash_map_iterator_pt iter = hashMapIterator_create(entry->endpoints);
+	while (hashMapIterator_hasNext(iter)) {
+		endpoint_description_pt endpoint = hashMapIterator_nextValue(iter);
 
+		discovery_removeDiscoveredEndpoint(poller->discovery, endpoint);
+		endpointDescription_destroy(endpoint);
+	}
+	hashMapIterator_destroy(iter);
 
+	hashMap_destroy(entry->endpoints, false, false);
+	free(entry);
+}
 
-celix_status_t endpointDiscoveryPoller_poll(endpoint_discovery_poller_pt poller, char *url, array_list_pt currentEndpoints) {
-	celix_status_t status;
-	array_list_pt updatedEndpoints = NULL;
+/**
+ * Polls the url once without waiting for changes, should be called with the poller lock taken.
+ */
+celix_status_t endpointDiscoveryPoller_poll(endpoint_discovery_poller_pt poller, char *url, endpoint_discovery_poller_entry_pt entry) {
+	celix_status_t status = CELIX_SUCCESS;
 
-	// create an arraylist with a custom equality test to ensure we can find endpoints properly...
-	arrayList_createWithEquals(endpointDiscoveryPoller_endpointDescriptionEquals, &updatedEndpoints);
-	status = endpointDiscoveryPoller_getEndpoints(poller, url, &updatedEndpoints);
+	endpoint_discovery_poller_request_pt request = endpointDiscoveryPoller_createRequest(url, entry->etag, 0);
+	if (request == NULL) {
+		status = CELIX_ILLEGAL_STATE;
+	} else {
+		CURLcode res = curl_easy_perform(request->curl);
+		endpointDiscoveryPoller_processResponse(poller, request, res);
+		endpointDiscoveryPoller_destroyRequest(request);
+	}
 
-	if (status == CELIX_SUCCESS) {
-		if (updatedEndpoints!=NULL) {
-			for (unsigned int i = arrayList_size(currentEndpoints); i > 0; i--) {
-				endpoint_description_pt endpoint = arrayList_get(currentEndpoints, i - 1);
-
-				if (!arrayList_contains(updatedEndpoints, endpoint)) {
-					status = discovery_removeDiscoveredEndpoint(poller->discovery, endpoint);
-					arrayList_remove(currentEndpoints, i - 1);
-					endpointDescription_destroy(endpoint);
-				}
-			}
+	return status;
+}
 
-			for (int i = arrayList_size(updatedEndpoints); i > 0; i--) {
-				endpoint_description_pt endpoint = arrayList_remove(updatedEndpoints, 0);
+/* replaces the endpoints of the entry with the endpoints of a full document */
+static void endpointDiscoveryPoller_applyEndpoints(endpoint_discovery_poller_pt poller, endpoint_discovery_poller_entry_pt entry, array_list_pt updatedEndpoints) {
+	hash_map_pt updatedIds = hashMap_create(utils_stringHash, NULL, utils_stringEquals, NULL);
+	array_list_pt removed = NULL;
 
-				if (!arrayList_contains(currentEndpoints, endpoint)) {
-					arrayList_add(currentEndpoints, endpoint);
-					status = discovery_addDiscoveredEndpoint(poller->discovery, endpoint);
-				} else {
-					endpointDescription_destroy(endpoint);
+	for (unsigned int i = 0; i < arrayList_size(updatedEndpoints); i++) {
+		endpoint_description_pt endpoint = arrayList_get(updatedEndpoints, i);
+		hashMap_put(updatedIds, endpoint->id, endpoint);
+	}
 
-				}
+	// remove the endpoints which are not available anymore
+	arrayList_create(&removed);
+	hash_map_iterator_pt iter = hashMapIterator_create(entry->endpoints);
+	while (hashMapIterator_hasNext(iter)) {
+		endpoint_description_pt endpoint = hashMapIterator_nextValue(iter);
+		if (!hashMap_containsKey(updatedIds, endpoint->id)) {
+			arrayList_add(removed, endpoint);
+		}
+	}
+	hashMapIterator_destroy(iter);
+
+	for (unsigned int i = 0; i < arrayList_size(removed); i++) {
+		endpoint_description_pt endpoint = arrayList_get(removed, i);
+
+		hashMap_remove(entry->endpoints, endpoint->id);
+		discovery_removeDiscoveredEndpoint(poller->discovery, endpoint);
+		endpointDescription_destroy(endpoint);
+	}
+	arrayList_destroy(removed);
+
+	// add the new endpoints
+	for (unsigned int i = 0; i < arrayList_size(updatedEndpoints); i++) {
+		endpoint_description_pt endpoint = arrayList_get(updatedEndpoints, i);
+
+		if (hashMap_containsKey(entry->endpoints, endpoint->id)) {
+			endpointDescription_destroy(endpoint);
+		} else {
+			hashMap_put(entry->endpoints, endpoint->id, endpoint);
+			discovery_addDiscoveredEndpoint(poller->discovery, endpoint);
+		}
+	}
+
+	hashMap_destroy(updatedIds, false, false);
+}
+
+/* applies a delta document: changed endpoints are replaced and the removed endpoint ids are removed */
+static void endpointDiscoveryPoller_applyDelta(endpoint_discovery_poller_pt poller, endpoint_discovery_poller_entry_pt entry, array_list_pt changedEndpoints, char *removedIds) {
+	if (removedIds != NULL) {
+		char *save_ptr = NULL;
+		char *id = strtok_r(removedIds, ",", &save_ptr);
+
+		while (id != NULL) {
+			endpoint_description_pt endpoint = hashMap_remove(entry->endpoints, utils_stringTrim(id));
+			if (endpoint != NULL) {
+				discovery_removeDiscoveredEndpoint(poller->discovery, endpoint);
+				endpointDescription_destroy(endpoint);
 			}
+			id = strtok_r(NULL, ",", &save_ptr);
 		}
 	}
 
-	if(updatedEndpoints!=NULL){
+	for (unsigned int i = 0; i < arrayList_size(changedEndpoints); i++) {
+		endpoint_description_pt endpoint = arrayList_get(changedEndpoints, i);
+		endpoint_description_pt old = hashMap_remove(entry->endpoints, endpoint->id);
+
+		if (old != NULL) {
+			discovery_removeDiscoveredEndpoint(poller->discovery, old);
+			endpointDescription_destroy(old);
+		}
+
+		hashMap_put(entry->endpoints, endpoint->id, endpoint);
+		discovery_addDiscoveredEndpoint(poller->discovery, endpoint);
+	}
+}
+
+/**
+ * Processes a finished request, should be called with the poller lock taken.
+ * Returns true if a versioned server reported changed endpoints.
+ */
+static bool endpointDiscoveryPoller_processResponse(endpoint_discovery_poller_pt poller, endpoint_discovery_poller_request_pt request, CURLcode res) {
+	bool changed = false;
+	long responseCode = 0;
+
+	if (res != CURLE_OK) {
+		logHelper_log(*poller->loghelper, OSGI_LOGSERVICE_ERROR, "ENDPOINT_POLLER: unable to read endpoints from %s, reason: %s", request->url, curl_easy_strerror(res));
+		return false;
+	}
+
+	endpoint_discovery_poller_entry_pt entry = hashMap_get(poller->entries, request->url);
+	if (entry == NULL) {
+		// url removed while the request was pending
+		return false;
+	}
+
+	curl_easy_getinfo(request->curl, CURLINFO_RESPONSE_CODE, &responseCode);
+	if (responseCode == 304) {
+		// not modified
+		return false;
+	} else if (responseCode != 200) {
+		logHelper_log(*poller->loghelper, OSGI_LOGSERVICE_WARNING, "ENDPOINT_POLLER: unexpected response code %ld from %s", responseCode, request->url);
+		return false;
+	}
+
+	if (request->delta && strcmp(entry->etag, request->etag) != 0) {
+		// delta relative to an outdated version, request the full document next time
+		entry->etag[0] = '\0';
+		return true;
+	}
+
+	array_list_pt updatedEndpoints = NULL;
+	endpoint_descriptor_reader_pt reader = NULL;
+	celix_status_t status = arrayList_create(&updatedEndpoints);
+
+	if (status == CELIX_SUCCESS) {
+		status = endpointDescriptorReader_create(poller, &reader);
+	}
+	if (status == CELIX_SUCCESS) {
+		status = endpointDescriptorReader_parseDocument(reader, request->body.memory, &updatedEndpoints);
+	}
+	if (reader) {
+		endpointDescriptorReader_destroy(reader);
+	}
+
+	if (status == CELIX_SUCCESS) {
+		if (request->delta) {
+			endpointDiscoveryPoller_applyDelta(poller, entry, updatedEndpoints, request->removed);
+		} else {
+			endpointDiscoveryPoller_applyEndpoints(poller, entry, updatedEndpoints);
+		}
+
+		snprintf(entry->etag, MAX_ETAG_LENGTH, "%s", request->responseEtag);
+		changed = strlen(entry->etag) > 0;
+	} else {
+		for (unsigned int i = 0; i < arrayList_size(updatedEndpoints); i++) {
+			endpointDescription_destroy(arrayList_get(updatedEndpoints, i));
+		}
+	}
+
+	if (updatedEndpoints != NULL) {
 		arrayList_destroy(updatedEndpoints);
 	}
 
-	return status;
+	return changed;
 }
 
 static void *endpointDiscoveryPoller_performPeriodicPoll(void *data) {
 	endpoint_discovery_poller_pt poller = (endpoint_discovery_poller_pt) data;
-
-	useconds_t interval = (useconds_t) (poller->poll_interval * 1000000L);
+	CURLM *multi = curl_multi_init();
 
 	while (poller->running) {
-		usleep(interval);
-		celix_status_t status = celixThreadMutex_lock(&poller->pollerLock);
+		struct timespec begin;
+		struct timespec now;
+		bool changed = false;
+		array_list_pt requests = NULL;
+		int active = 0;
+
+		clock_gettime(CLOCK_MONOTONIC, &begin);
+		arrayList_create(&requests);
 
+		// the requests are performed without the poller lock, long poll requests can take up to the poll interval
+		celix_status_t status = celixThreadMutex_lock(&poller->pollerLock);
 		if (status != CELIX_SUCCESS) {
 			logHelper_log(*poller->loghelper, OSGI_LOGSERVICE_WARNING, "ENDPOINT_POLLER: failed to obtain lock; retrying...");
 		} else {
@@ -296,31 +464,74 @@ static void *endpointDiscoveryPoller_performPeriodicPoll(void *data) {
 
 			while (hashMapIterator_hasNext(iterator)) {
 				hash_map_entry_pt entry = hashMapIterator_nextEntry(iterator);
+				endpoint_discovery_poller_entry_pt pollerEntry = hashMapEntry_getValue(entry);
 
-				char *url = hashMapEntry_getKey(entry);
-				array_list_pt currentEndpoints = hashMapEntry_getValue(entry);
-
-				endpointDiscoveryPoller_poll(poller, url, currentEndpoints);
+				endpoint_discovery_poller_request_pt request = endpointDiscoveryPoller_createRequest(hashMapEntry_getKey(entry), pollerEntry->etag, poller->poll_interval);
+				if (request != NULL) {
+					arrayList_add(requests, request);
+					curl_multi_add_handle(multi, request->curl);
+					active++;
+				}
 			}
 
 			hashMapIterator_destroy(iterator);
+
+			status = celixThreadMutex_unlock(&poller->pollerLock);
+			if (status != CELIX_SUCCESS) {
+				logHelper_log(*poller->loghelper, OSGI_LOGSERVICE_WARNING, "ENDPOINT_POLLER: failed to release lock; retrying...");
+			}
 		}
 
-		status = celixThreadMutex_unlock(&poller->pollerLock);
-		if (status != CELIX_SUCCESS) {
-			logHelper_log(*poller->loghelper, OSGI_LOGSERVICE_WARNING, "ENDPOINT_POLLER: failed to release lock; retrying...");
+		while (active > 0 && poller->running) {
+			CURLMsg *msg = NULL;
+			int msgsLeft = 0;
+
+			curl_multi_perform(multi, &active);
+
+			// process finished requests right away, so that a change is not delayed by the other long poll requests
+			while ((msg = curl_multi_info_read(multi, &msgsLeft)) != NULL) {
+				if (msg->msg == CURLMSG_DONE) {
+					endpoint_discovery_poller_request_pt request = NULL;
+
+					curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char**) &request);
+					curl_multi_remove_handle(multi, msg->easy_handle);
+					request->done = true;
+
+					if (celixThreadMutex_lock(&poller->pollerLock) == CELIX_SUCCESS) {
+						changed |= endpointDiscoveryPoller_processResponse(poller, request, msg->data.result);
+						celixThreadMutex_unlock(&poller->pollerLock);
+					}
+				}
+			}
+
+			if (active > 0) {
+				curl_multi_wait(multi, NULL, 0, 1000, NULL);
+			}
 		}
-	}
 
-	return NULL;
-}
+		for (unsigned int i = 0; i < arrayList_size(requests); i++) {
+			endpoint_discovery_poller_request_pt request = arrayList_get(requests, i);
+			if (!request->done) {
+				curl_multi_remove_handle(multi, request->curl);
+			}
+			endpointDiscoveryPoller_destroyRequest(request);
+		}
+		arrayList_destroy(requests);
 
+		// servers which do not support long polling are polled once per interval
+		while (!changed && poller->running) {
+			clock_gettime(CLOCK_MONOTONIC, &now);
+			if ((now.tv_sec - begin.tv_sec) * 1000000L + (now.tv_nsec - begin.tv_nsec) / 1000L >= poller->poll_interval * 1000000L) {
+				break;
+			}
+			usleep(100000);
+		}
+	}
 
+	curl_multi_cleanup(multi);
 
-struct MemoryStruct {
-	char *memory;
-	size_t size;
-};
+	return NULL;
+}
 
 static size_t endpointDiscoveryPoller_writeMemory(void *contents, size_t size, size_t nmemb, void *memoryPtr) {
 	size_t realsize = size * nmemb;
@@ -339,65 +550,83 @@ static size_t endpointDiscoveryPoller_writeMemory(void *contents, size_t size, s
 	return realsize;
 }
 
-static celix_status_t endpointDiscoveryPoller_getEndpoints(endpoint_discovery_poller_pt poller, char *url, array_list_pt *updatedEndpoints) {
-	celix_status_t status = CELIX_SUCCESS;
+static size_t endpointDiscoveryPoller_writeHeader(char *buffer, size_t size, size_t nitems, void *requestPtr) {
+	size_t realsize = size * nitems;
+	endpoint_discovery_poller_request_pt request = (endpoint_discovery_poller_request_pt) requestPtr;
+	char *header = strndup(buffer, realsize);
+	char *value = header != NULL ? strchr(header, ':') : NULL;
+
+	if (value != NULL) {
+		*value = '\0';
+		value = utils_stringTrim(value + 1);
+
+		if (strcasecmp(header, "ETag") == 0) {
+			snprintf(request->responseEtag, MAX_ETAG_LENGTH, "%s", value);
+		} else if (strcasecmp(header, DISCOVERY_DELTA_HEADER) == 0) {
+			request->delta = strcmp(value, "true") == 0;
+		} else if (strcasecmp(header, DISCOVERY_REMOVED_HEADER) == 0) {
+			free(request->removed);
+			request->removed = strdup(value);
+		}
+	}
 
+	free(header);
 
-	CURL *curl = NULL;
-	CURLcode res = CURLE_OK;
+	return realsize;
+}
 
-	struct MemoryStruct chunk;
-	chunk.memory = malloc(1);
-	chunk.size = 0;
+static endpoint_discovery_poller_request_pt endpointDiscoveryPoller_createRequest(char *url, const char *etag, unsigned int waitInSec) {
+	endpoint_discovery_poller_request_pt request = calloc(1, sizeof(*request));
+	char *requestUrl = NULL;
 
-	curl = curl_easy_init();
-	if (!curl) {
-		status = CELIX_ILLEGAL_STATE;
-	} else {
-		curl_easy_setopt(curl, CURLOPT_URL, url);
-		curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1);
-		curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, endpointDiscoveryPoller_writeMemory);
-		curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&chunk);
-		curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 5L);
-		curl_easy_setopt(curl, CURLOPT_TIMEOUT, 10L);
-		res = curl_easy_perform(curl);
+	if (request != NULL) {
+		request->curl = curl_easy_init();
+	}
 
-		curl_easy_cleanup(curl);
+	if (request == NULL || request->curl == NULL) {
+		free(request);
+		return NULL;
 	}
 
-	// process endpoints file
-	if (res == CURLE_OK) {
-		endpoint_descriptor_reader_pt reader = NULL;
+	request->url = strdup(url);
+	snprintf(request->etag, MAX_ETAG_LENGTH, "%s", etag);
+	request->body.memory = malloc(1);
+	request->body.memory[0] = '\0';
+	request->body.size = 0;
 
-		status = endpointDescriptorReader_create(poller, &reader);
-		if (status == CELIX_SUCCESS) {
-			status = endpointDescriptorReader_parseDocument(reader, chunk.memory, updatedEndpoints);
-		}
+	if (strlen(request->etag) > 0) {
+		char header[MAX_ETAG_LENGTH + 32];
+		snprintf(header, sizeof(header), "If-None-Match: %s", request->etag);
+		request->headers = curl_slist_append(NULL, header);
 
-		if (reader) {
-			endpointDescriptorReader_destroy(reader);
+		// ask for a delta and wait for changes when the server supports versioning
+		if (asprintf(&requestUrl, "%s%c%s=%u&%s=true", url, strchr(url, '?') != NULL ? '&' : '?', DISCOVERY_WAIT_PARAMETER, waitInSec, DISCOVERY_DELTA_PARAMETER) < 0) {
+			requestUrl = NULL;
 		}
-	} else {
-		logHelper_log(*poller->loghelper, OSGI_LOGSERVICE_ERROR, "ENDPOINT_POLLER: unable to read endpoints from %s, reason: %s", url, curl_easy_strerror(res));
 	}
 
-	// clean up endpoints file
-	if (chunk.memory) {
-		free(chunk.memory);
-	}
-
-	return status;
+	curl_easy_setopt(request->curl, CURLOPT_URL, requestUrl != NULL ? requestUrl : url);
+	curl_easy_setopt(request->curl, CURLOPT_NOSIGNAL, 1);
+	curl_easy_setopt(request->curl, CURLOPT_WRITEFUNCTION, endpointDiscoveryPoller_writeMemory);
+	curl_easy_setopt(request->curl, CURLOPT_WRITEDATA, (void *) &request->body);
+	curl_easy_setopt(request->curl, CURLOPT_HEADERFUNCTION, endpointDiscoveryPoller_writeHeader);
+	curl_easy_setopt(request->curl, CURLOPT_HEADERDATA, (void *) request);
+	curl_easy_setopt(request->curl, CURLOPT_HTTPHEADER, request->headers);
+	curl_easy_setopt(request->curl, CURLOPT_PRIVATE, (void *) request);
+	curl_easy_setopt(request->curl, CURLOPT_CONNECTTIMEOUT, 5L);
+	curl_easy_setopt(request->curl, CURLOPT_TIMEOUT, 10L + waitInSec);
+
+	// CURLOPT_URL copies the string
+	free(requestUrl);
+
+	return request;
 }
 
-static celix_status_t endpointDiscoveryPoller_endpointDescriptionEquals(const void *endpointPtr, const void *comparePtr, bool *equals) {
-	endpoint_description_pt endpoint = (endpoint_description_pt) endpointPtr;
-	endpoint_description_pt compare = (endpoint_description_pt) comparePtr;
-
-	if (strcmp(endpoint->id, compare->id) == 0) {
-		*equals = true;
-	} else {
-		*equals = false;
-	}
-
-	return CELIX_SUCCESS;
+static void endpointDiscoveryPoller_destroyRequest(endpoint_discovery_poller_request_pt request) {
+	curl_easy_cleanup(request->curl);
+	curl_slist_free_all(request->headers);
+	free(request->body.memory);
+	free(request->removed);
+	free(request->url);
+	free(request);
 }
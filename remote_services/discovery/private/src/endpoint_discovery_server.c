@@ -24,7 +24,11 @@
  * \copyright	Apache License, Version 2.0
  */
 #include <stdlib.h>
+#include <stdio.h>
 #include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
 #include <arpa/inet.h>
 #include <netdb.h>
 #ifndef ANDROID
@@ -41,7 +45,17 @@
 
 // defines how often the webserver is restarted (with an increased port number)
 #define MAX_NUMBER_OF_RESTARTS 	15
-#define DEFAULT_SERVER_THREADS "1"
+// long poll requests occupy a server thread, so use more than one
+#define DEFAULT_SERVER_THREADS "5"
+// number of server threads which are never used for long poll requests, so that plain requests are still served
+#define RESERVED_SERVER_THREADS 1
+
+// number of changes kept to be able to answer delta requests
+#define MAX_NUMBER_OF_CHANGES 128
+// maximum number of removed endpoint ids in a delta response, otherwise the full document is returned
+#define MAX_NUMBER_OF_REMOVED_IN_DELTA 64
+// maximum time in seconds a long poll request is kept waiting for a change
+#define MAX_LONG_POLL_WAIT 60
 
 #define CIVETWEB_REQUEST_NOT_HANDLED 0
 #define CIVETWEB_REQUEST_HANDLED 1
@@ -52,11 +66,42 @@ static const char *response_headers =
 		"Content-Type: application/xml;charset=utf-8\r\n"
 		"\r\n";
 
+static const char *versioned_response_headers =
+		"HTTP/1.1 200 OK\r\n"
+		"Cache: no-cache\r\n"
+		"Content-Type: application/xml;charset=utf-8\r\n"
+		"ETag: \"%lx-%lu\"\r\n"
+		"\r\n";
+
+static const char *delta_response_headers =
+		"HTTP/1.1 200 OK\r\n"
+		"Cache: no-cache\r\n"
+		"Content-Type: application/xml;charset=utf-8\r\n"
+		"ETag: \"%lx-%lu\"\r\n"
+		DISCOVERY_DELTA_HEADER ": true\r\n"
+		DISCOVERY_REMOVED_HEADER ": %s\r\n"
+		"\r\n";
+
+static const char *not_modified_response_headers =
+		"HTTP/1.1 304 Not Modified\r\n"
+		"ETag: \"%lx-%lu\"\r\n"
+		"\r\n";
+
 struct endpoint_discovery_server {
 	log_helper_pt* loghelper;
 	hash_map_pt entries; // key = endpointId, value = endpoint_descriptor_pt
 
 	celix_thread_mutex_t serverLock;
+	celix_thread_cond_t versionChanged;
+
+	unsigned long instance; // part of the ETag, so that a restarted server is not mistaken for the previous one
+	unsigned long version; // incremented on every added or removed endpoint, protected by serverLock
+	char* changes[MAX_NUMBER_OF_CHANGES]; // endpoint id changed in version v is stored at v % MAX_NUMBER_OF_CHANGES
+	char* document; // cached document with all endpoints for documentVersion
+	unsigned long documentVersion;
+	bool stopping;
+	int longPolls; // number of waiting long poll requests, protected by serverLock
+	int maxLongPolls;
 
 	const char* path;
 	const char *port;
@@ -66,6 +111,7 @@ struct endpoint_discovery_server {
 
 // Forward declarations...
 static int endpointDiscoveryServer_callback(struct mg_connection *conn);
+static void endpointDiscoveryServer_changed(endpoint_discovery_server_pt server, const char* endpointId);
 static char* format_path(const char* path);
 
 #ifndef ANDROID
@@ -94,11 +140,24 @@ celix_status_t endpointDiscoveryServer_create(discovery_pt discovery, bundle_con
 		return CELIX_ENOMEM;
 	}
 
+	(*server)->instance = (unsigned long) time(NULL);
+	(*server)->version = 0;
+	memset((*server)->changes, 0, sizeof((*server)->changes));
+	(*server)->document = NULL;
+	(*server)->documentVersion = 0;
+	(*server)->stopping = false;
+	(*server)->longPolls = 0;
+
 	status = celixThreadMutex_create(&(*server)->serverLock, NULL);
 	if (status != CELIX_SUCCESS) {
 		return CELIX_BUNDLE_EXCEPTION;
 	}
 
+	status = celixThreadCondition_init(&(*server)->versionChanged, NULL);
+	if (status != CELIX_SUCCESS) {
+		return CELIX_BUNDLE_EXCEPTION;
+	}
+
 	bundleContext_getProperty(context, DISCOVERY_SERVER_IP, &ip);
 #ifndef ANDROID
 	if (ip == NULL) {
@@ -140,6 +199,18 @@ celix_status_t endpointDiscoveryServer_create(discovery_pt discovery, bundle_con
 		path = DEFAULT_SERVER_PATH;
 	}
 
+	const char *threads = NULL;
+	bundleContext_getProperty(context, DISCOVERY_SERVER_THREADS, &threads);
+	if (threads == NULL) {
+		threads = DEFAULT_SERVER_THREADS;
+	}
+
+	// beyond this number long poll requests are answered right away, the pollers then poll once per interval
+	(*server)->maxLongPolls = atoi(threads) - RESERVED_SERVER_THREADS;
+	if ((*server)->maxLongPolls < 0) {
+		(*server)->maxLongPolls = 0;
+	}
+
 	bundleContext_getProperty(context, DISCOVERY_SERVER_MAX_EP, &retries);
 	if (retries != NULL) {
 		errno=0;
@@ -161,7 +232,7 @@ celix_status_t endpointDiscoveryServer_create(discovery_pt discovery, bundle_con
 	do {
 		const char *options[] = {
 				"listening_ports", port,
-				"num_threads", DEFAULT_SERVER_THREADS,
+				"num_threads", threads,
 				NULL
 		};
 
@@ -210,6 +281,12 @@ celix_status_t endpointDiscoveryServer_getUrl(endpoint_discovery_server_pt serve
 celix_status_t endpointDiscoveryServer_destroy(endpoint_discovery_server_pt server) {
 	celix_status_t status;
 
+	// release pending long poll requests, otherwise mg_stop waits until they time out
+	celixThreadMutex_lock(&server->serverLock);
+	server->stopping = true;
+	celixThreadCondition_broadcast(&server->versionChanged);
+	celixThreadMutex_unlock(&server->serverLock);
+
 	// stop & block until the actual server is shut down...
 	if (server->ctx != NULL) {
 		mg_stop(server->ctx);
@@ -220,7 +297,13 @@ celix_status_t endpointDiscoveryServer_destroy(endpoint_discovery_server_pt serv
 
 	hashMap_destroy(server->entries, true /* freeKeys */, false /* freeValues */);
 
+	for (int i = 0; i < MAX_NUMBER_OF_CHANGES; i++) {
+		free(server->changes[i]);
+	}
+	free(server->document);
+
 	status = celixThreadMutex_unlock(&server->serverLock);
+	status = celixThreadCondition_destroy(&server->versionChanged);
 	status = celixThreadMutex_destroy(&server->serverLock);
 
 	free((void*) server->path);
@@ -247,6 +330,9 @@ celix_status_t endpointDiscoveryServer_addEndpoint(endpoint_discovery_server_pt
 		logHelper_log(*server->loghelper, OSGI_LOGSERVICE_INFO, "exposing new endpoint \"%s\"...", endpointId);
 
 		hashMap_put(server->entries, endpointId, endpoint);
+		endpointDiscoveryServer_changed(server, endpointId);
+	} else {
+		free(endpointId);
 	}
 
 	status = celixThreadMutex_unlock(&server->serverLock);
@@ -272,6 +358,7 @@ celix_status_t endpointDiscoveryServer_removeEndpoint(endpoint_discovery_server_
 		logHelper_log(*server->loghelper, OSGI_LOGSERVICE_INFO, "removing endpoint \"%s\"...\n", key);
 
 		hashMap_remove(server->entries, key);
+		endpointDiscoveryServer_changed(server, key);
 
 		// we've made this key, see _addEnpoint above...
 		free((void*) key);
@@ -285,6 +372,17 @@ celix_status_t endpointDiscoveryServer_removeEndpoint(endpoint_discovery_server_
 	return status;
 }
 
+/* registers a change of the endpoint and wakes up the long poll requests, should be called with the serverLock taken */
+static void endpointDiscoveryServer_changed(endpoint_discovery_server_pt server, const char* endpointId) {
+	server->version++;
+
+	unsigned int index = server->version % MAX_NUMBER_OF_CHANGES;
+	free(server->changes[index]);
+	server->changes[index] = strdup(endpointId);
+
+	celixThreadCondition_broadcast(&server->versionChanged);
+}
+
 static char* format_path(const char* path) {
 	char* result = strdup(path);
 	result = utils_stringTrim(result);
@@ -349,20 +447,160 @@ static int endpointDiscoveryServer_writeEndpoints(struct mg_connection* conn, ar
 	return rv;
 }
 
+/* parses the version from an ETag header value, only ETags of this server instance are accepted */
+static bool endpointDiscoveryServer_parseVersion(endpoint_discovery_server_pt server, const char* etag, unsigned long* version) {
+	unsigned long instance = 0;
+
+	return etag != NULL && sscanf(etag, "\"%lx-%lu\"", &instance, version) == 2 && instance == server->instance;
+}
+
+/* waits at most waitInSec until the version differs from the provided version, should be called with the serverLock taken */
+static void endpointDiscoveryServer_waitForChange(endpoint_discovery_server_pt server, unsigned long version, int waitInSec) {
+	struct timespec deadline;
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += waitInSec > MAX_LONG_POLL_WAIT ? MAX_LONG_POLL_WAIT : waitInSec;
+
+	while (server->version == version && !server->stopping) {
+		if (pthread_cond_timedwait(&server->versionChanged, &server->serverLock, &deadline) != 0) {
+			break;
+		}
+	}
+}
+
+/* returns the endpoints changed after the provided version, should be called with the serverLock taken */
+static int endpointDiscoveryServer_returnDelta(endpoint_discovery_server_pt server, struct mg_connection* conn, unsigned long version) {
+	int status = CIVETWEB_REQUEST_NOT_HANDLED;
+	hash_map_pt changedIds = hashMap_create(&utils_stringHash, NULL, &utils_stringEquals, NULL);
+	array_list_pt endpoints = NULL;
+	size_t removedLength = 0;
+	unsigned int nrOfRemoved = 0;
+
+	arrayList_create(&endpoints);
+
+	for (unsigned long v = version + 1; v <= server->version; v++) {
+		char* endpointId = server->changes[v % MAX_NUMBER_OF_CHANGES];
+
+		if (!hashMap_containsKey(changedIds, endpointId)) {
+			endpoint_description_pt endpoint = hashMap_get(server->entries, endpointId);
+
+			hashMap_put(changedIds, endpointId, endpoint);
+			if (endpoint != NULL) {
+				arrayList_add(endpoints, endpoint);
+			} else {
+				removedLength += strlen(endpointId) + 1;
+				nrOfRemoved++;
+			}
+		}
+	}
+
+	if (nrOfRemoved <= MAX_NUMBER_OF_REMOVED_IN_DELTA) {
+		char* removed = calloc(removedLength + 1, sizeof(*removed));
+
+		hash_map_iterator_pt iter = hashMapIterator_create(changedIds);
+		while (hashMapIterator_hasNext(iter)) {
+			hash_map_entry_pt entry = hashMapIterator_nextEntry(iter);
+
+			if (hashMapEntry_getValue(entry) == NULL) {
+				if (strlen(removed) > 0) {
+					strcat(removed, ",");
+				}
+				strcat(removed, hashMapEntry_getKey(entry));
+			}
+		}
+		hashMapIterator_destroy(iter);
+
+		endpoint_descriptor_writer_pt writer = NULL;
+		if (endpointDescriptorWriter_create(&writer) == CELIX_SUCCESS) {
+			char *buffer = NULL;
+
+			endpointDescriptorWriter_writeDocument(writer, endpoints, &buffer);
+			if (buffer) {
+				mg_printf(conn, delta_response_headers, server->instance, server->version, removed);
+				mg_write(conn, buffer, strlen(buffer));
+			}
+
+			endpointDescriptorWriter_destroy(writer);
+			status = CIVETWEB_REQUEST_HANDLED;
+		}
+
+		free(removed);
+	}
+
+	arrayList_destroy(endpoints);
+	hashMap_destroy(changedIds, false, false);
+
+	return status;
+}
+
 // returns all endpoints as XML...
 static int endpointDiscoveryServer_returnAllEndpoints(endpoint_discovery_server_pt server, struct mg_connection* conn) {
 	int status = CIVETWEB_REQUEST_NOT_HANDLED;
 
-	array_list_pt endpoints = NULL;
+	const struct mg_request_info *request_info = mg_get_request_info(conn);
+	unsigned long knownVersion = 0;
+	bool versionKnown = endpointDiscoveryServer_parseVersion(server, mg_get_header(conn, "If-None-Match"), &knownVersion);
+	bool deltaRequested = false;
+	int waitInSec = 0;
+
+	if (request_info->query_string != NULL) {
+		char value[16];
+		size_t queryLength = strlen(request_info->query_string);
+
+		if (mg_get_var(request_info->query_string, queryLength, DISCOVERY_WAIT_PARAMETER, value, sizeof(value)) > 0) {
+			waitInSec = atoi(value);
+		}
+		if (mg_get_var(request_info->query_string, queryLength, DISCOVERY_DELTA_PARAMETER, value, sizeof(value)) > 0) {
+			deltaRequested = strcmp(value, "true") == 0;
+		}
+	}
 
 	if (celixThreadMutex_lock(&server->serverLock) == CELIX_SUCCESS) {
-		endpointDiscoveryServer_getEndpoints(server, NULL, &endpoints);
-		if (endpoints) {
-			status = endpointDiscoveryServer_writeEndpoints(conn, endpoints);
+		if (versionKnown && knownVersion == server->version && waitInSec > 0 && server->longPolls < server->maxLongPolls) {
+			server->longPolls++;
+			endpointDiscoveryServer_waitForChange(server, knownVersion, waitInSec);
+			server->longPolls--;
+		}
 
-			arrayList_destroy(endpoints);
+		if (versionKnown && knownVersion == server->version) {
+			mg_printf(conn, not_modified_response_headers, server->instance, server->version);
+			status = CIVETWEB_REQUEST_HANDLED;
+		} else if (versionKnown && deltaRequested && knownVersion < server->version && server->version - knownVersion <= MAX_NUMBER_OF_CHANGES) {
+			status = endpointDiscoveryServer_returnDelta(server, conn, knownVersion);
 		}
 
+		if (status == CIVETWEB_REQUEST_NOT_HANDLED) {
+			// the document is only written again after the endpoints have been changed
+			if (server->document == NULL || server->documentVersion != server->version) {
+				array_list_pt endpoints = NULL;
+				endpoint_descriptor_writer_pt writer = NULL;
+
+				free(server->document);
+				server->document = NULL;
+
+				endpointDiscoveryServer_getEndpoints(server, NULL, &endpoints);
+				if (endpoints && endpointDescriptorWriter_create(&writer) == CELIX_SUCCESS) {
+					char *buffer = NULL;
+
+					endpointDescriptorWriter_writeDocument(writer, endpoints, &buffer);
+					if (buffer) {
+						server->document = strdup(buffer);
+						server->documentVersion = server->version;
+					}
+
+					endpointDescriptorWriter_destroy(writer);
+				}
+
+				if (endpoints) {
+					arrayList_destroy(endpoints);
+				}
+			}
+
+			if (server->document != NULL) {
+				mg_printf(conn, versioned_response_headers, server->instance, server->version);
+				mg_write(conn, server->document, strlen(server->document));
+				status = CIVETWEB_REQUEST_HANDLED;
+			}
+		}
 
 		celixThreadMutex_unlock(&server->serverLock);
 	}
@@ -0,0 +1,263 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+/*
+ * endpoint_discovery_server_test.cpp
+ *
+ * Runs the endpoint discovery server with SERVER_THREADS threads and sends NR_OF_POLLERS long poll requests, more
+ * than the threads, like peers which all poll the same framework. Checks that the long polls beyond the cap are
+ * answered right away with a 304, that a plain request is still answered while the others wait, and that the
+ * waiting long polls are answered with the endpoints when an endpoint is added. Every test starts its own framework
+ * and server.
+ *
+ *  \author    	<a href="mailto:dev@celix.apache.org">Apache Celix Project Team</a>
+ *  \copyright	Apache License, Version 2.0
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/TestHarness_c.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+extern "C"
+{
+#include "celix_launcher.h"
+#include "framework.h"
+#include "constants.h"
+#include "properties.h"
+#include "celix_threads.h"
+#include "remote_constants.h"
+#include "discovery.h"
+#include "discovery_impl.h"
+}
+
+int main(int argc, char** argv) {
+	return RUN_ALL_TESTS(argc, argv);
+}
+
+#define SERVER_PORT "9990"
+#define SERVER_THREADS "3"
+#define NR_OF_POLLERS 5
+#define MAX_LONG_POLLS 2 //SERVER_THREADS minus the thread reserved for plain requests
+
+struct test_request {
+	char path[256];
+	char etag[64];
+	int responseCode;
+	char responseEtag[64];
+	double elapsedMs;
+	volatile bool done;
+};
+
+static double elapsedMs(struct timespec *begin, struct timespec *end) {
+	return (end->tv_sec - begin->tv_sec) * 1000.0 + (end->tv_nsec - begin->tv_nsec) / 1000000.0;
+}
+
+/* performs a HTTP/1.0 GET, the server closes the connection after the response */
+static void *performRequest(void *data) {
+	struct test_request *request = (struct test_request *) data;
+	struct sockaddr_in addr;
+	struct timeval timeout = { .tv_sec = 60, .tv_usec = 0 };
+	struct timespec begin;
+	struct timespec end;
+	char buf[4096];
+	size_t size = 0;
+	ssize_t rc;
+	int fd;
+
+	request->responseCode = -1;
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(atoi(SERVER_PORT));
+	addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+
+	fd = socket(AF_INET, SOCK_STREAM, 0);
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) == 0) {
+		char *header = NULL;
+
+		rc = snprintf(buf, sizeof(buf), "GET %s HTTP/1.0\r\n%s%s%s\r\n", request->path,
+				request->etag[0] != '\0' ? "If-None-Match: " : "", request->etag, request->etag[0] != '\0' ? "\r\n" : "");
+		if (send(fd, buf, rc, 0) == rc) {
+			while (size < sizeof(buf) - 1 && (rc = recv(fd, buf + size, sizeof(buf) - 1 - size, 0)) > 0) {
+				size += rc;
+			}
+		}
+		buf[size] = '\0';
+
+		sscanf(buf, "HTTP/1.%*d %d", &request->responseCode);
+		header = strstr(buf, "ETag: ");
+		if (header != NULL) {
+			sscanf(header, "ETag: %63s", request->responseEtag);
+		}
+	}
+	close(fd);
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	request->elapsedMs = elapsedMs(&begin, &end);
+	request->done = true;
+	return NULL;
+}
+
+TEST_GROUP(endpoint_discovery_server) {
+	framework_pt framework;
+	struct discovery discovery;
+	endpoint_discovery_server_pt server;
+	endpoint_description_pt endpoint;
+	struct test_request pollers[NR_OF_POLLERS];
+	celix_thread_t threads[NR_OF_POLLERS];
+	bool polling;
+
+	void setup() {
+		bundle_pt bundle = NULL;
+
+		properties_pt config = properties_create();
+		properties_set(config, OSGI_FRAMEWORK_FRAMEWORK_STORAGE_CLEAN, OSGI_FRAMEWORK_FRAMEWORK_STORAGE_CLEAN_ONFIRSTINIT);
+		properties_set(config, DISCOVERY_SERVER_IP, "127.0.0.1");
+		properties_set(config, DISCOVERY_SERVER_PORT, SERVER_PORT);
+		properties_set(config, DISCOVERY_SERVER_MAX_EP, "1");
+		properties_set(config, DISCOVERY_SERVER_THREADS, SERVER_THREADS);
+		framework = NULL;
+		LONGS_EQUAL(CELIX_SUCCESS, celixLauncher_launchWithProperties(config, &framework));
+		framework_getFrameworkBundle(framework, &bundle);
+
+		memset(&discovery, 0, sizeof(discovery));
+		bundle_getContext(bundle, &discovery.context);
+		logHelper_create(discovery.context, &discovery.loghelper);
+		logHelper_start(discovery.loghelper);
+		server = NULL;
+		endpointDiscoveryServer_create(&discovery, discovery.context, &server);
+		endpoint = NULL;
+		polling = false;
+	}
+
+	void teardown() {
+		if (polling) {
+			addEndpoint();
+			joinPollers();
+		}
+		if (endpoint != NULL) {
+			endpointDiscoveryServer_removeEndpoint(server, endpoint);
+		}
+		endpointDiscoveryServer_destroy(server);
+		if (endpoint != NULL) {
+			endpointDescription_destroy(endpoint);
+		}
+		logHelper_stop(discovery.loghelper);
+		logHelper_destroy(&discovery.loghelper);
+
+		celixLauncher_stop(framework);
+		celixLauncher_waitForShutdown(framework);
+		celixLauncher_destroy(framework);
+	}
+
+	void get(struct test_request *request, const char *etag) {
+		memset(request, 0, sizeof(*request));
+		snprintf(request->path, sizeof(request->path), "%s", DEFAULT_SERVER_PATH);
+		snprintf(request->etag, sizeof(request->etag), "%s", etag);
+		performRequest(request);
+	}
+
+	/* starts the long polls with the current ETag and gives the server two seconds to answer or park them */
+	void startPollers() {
+		struct test_request plain;
+
+		get(&plain, "");
+		for (int i = 0; i < NR_OF_POLLERS; ++i) {
+			memset(&pollers[i], 0, sizeof(pollers[i]));
+			snprintf(pollers[i].path, sizeof(pollers[i].path), "%s?%s=30", DEFAULT_SERVER_PATH, DISCOVERY_WAIT_PARAMETER);
+			snprintf(pollers[i].etag, sizeof(pollers[i].etag), "%s", plain.responseEtag);
+			celixThread_create(&threads[i], NULL, performRequest, &pollers[i]);
+		}
+		polling = true;
+		sleep(2);
+	}
+
+	void joinPollers() {
+		for (int i = 0; i < NR_OF_POLLERS; ++i) {
+			celixThread_join(threads[i], NULL);
+		}
+		polling = false;
+	}
+
+	void addEndpoint() {
+		properties_pt props = properties_create();
+		properties_set(props, OSGI_RSA_ENDPOINT_FRAMEWORK_UUID, "test-framework");
+		properties_set(props, OSGI_RSA_ENDPOINT_ID, "test-endpoint");
+		properties_set(props, OSGI_RSA_ENDPOINT_SERVICE_ID, "42");
+		properties_set(props, OSGI_FRAMEWORK_OBJECTCLASS, "org.apache.celix.Test");
+		endpointDescription_create(props, &endpoint);
+		endpointDiscoveryServer_addEndpoint(server, endpoint);
+	}
+};
+
+TEST(endpoint_discovery_server, plainRequestIsAnsweredWithEtag) {
+	struct test_request plain;
+
+	get(&plain, "");
+	LONGS_EQUAL(200, plain.responseCode);
+	CHECK(plain.responseEtag[0] != '\0');
+}
+
+TEST(endpoint_discovery_server, longPollsBeyondCapAreAnsweredRightAway) {
+	int answered = 0;
+	int notModified = 0;
+
+	startPollers();
+	for (int i = 0; i < NR_OF_POLLERS; ++i) {
+		if (pollers[i].done) {
+			answered++;
+			notModified += pollers[i].responseCode == 304 ? 1 : 0;
+		}
+	}
+	LONGS_EQUAL(NR_OF_POLLERS - MAX_LONG_POLLS, answered);
+	LONGS_EQUAL(answered, notModified);
+}
+
+TEST(endpoint_discovery_server, plainRequestIsAnsweredWhileLongPollsWait) {
+	struct test_request plain;
+
+	startPollers();
+	get(&plain, "");
+	LONGS_EQUAL(200, plain.responseCode);
+	CHECK(plain.elapsedMs < 1000);
+}
+
+TEST(endpoint_discovery_server, waitingLongPollsAreAnsweredOnChange) {
+	int answered = 0;
+
+	startPollers();
+	addEndpoint();
+	joinPollers();
+	for (int i = 0; i < NR_OF_POLLERS; ++i) {
+		if (pollers[i].responseCode == 200 && pollers[i].elapsedMs > 1000 && pollers[i].elapsedMs < 10000) {
+			answered++;
+		}
+	}
+	LONGS_EQUAL(MAX_LONG_POLLS, answered);
+}
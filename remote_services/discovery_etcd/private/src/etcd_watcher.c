@@ -46,6 +46,7 @@ struct etcd_watcher {
     discovery_pt discovery;
     log_helper_pt* loghelper;
     hash_map_pt entries;
+    int ttl;
 
 	celix_thread_mutex_t watcherLock;
 	celix_thread_t watcherThread;
@@ -71,6 +72,9 @@ struct etcd_watcher {
 #define CFG_ETCD_TTL   				"DISCOVERY_ETCD_TTL"
 #define DEFAULT_ETCD_TTL 			30
 
+// retry interval after a failed watch, e.g. when etcd is not reachable
+#define ETCD_WATCH_RETRY_INTERVAL	1
+
 
 // note that the rootNode shouldn't have a leading slash
 static celix_status_t etcdWatcher_getRootPath(bundle_context_pt context, char* rootNode) {
@@ -136,16 +140,31 @@ static celix_status_t etcdWatcher_addAlreadyExistingWatchpoints(discovery_pt dis
 }
 
 
+static int etcdWatcher_getTtl(bundle_context_pt context) {
+    const char* ttlStr = NULL;
+    int ttl;
+
+    if ((bundleContext_getProperty(context, CFG_ETCD_TTL, &ttlStr) != CELIX_SUCCESS) || !ttlStr) {
+        ttl = DEFAULT_ETCD_TTL;
+    }
+    else
+    {
+        char* endptr = (char *) ttlStr;
+        errno = 0;
+        ttl = strtol(ttlStr, &endptr, 10);
+        if (*endptr || errno != 0 || ttl <= 0) {
+            ttl = DEFAULT_ETCD_TTL;
+        }
+    }
+
+    return ttl;
+}
+
 static celix_status_t etcdWatcher_addOwnFramework(etcd_watcher_pt watcher)
 {
     celix_status_t status = CELIX_BUNDLE_EXCEPTION;
     char localNodePath[MAX_LOCALNODE_LENGTH];
-    char *value;
  	char url[MAX_VALUE_LENGTH];
-    int modIndex;
-    char* endpoints = NULL;
-    const char* ttlStr = NULL;
-    int ttl;
 
 	bundle_context_pt context = watcher->discovery->context;
 	endpoint_discovery_server_pt server = watcher->discovery->server;
@@ -159,32 +178,29 @@ static celix_status_t etcdWatcher_addOwnFramework(etcd_watcher_pt watcher)
 		snprintf(url, MAX_VALUE_LENGTH, "http://%s:%s/%s", DEFAULT_SERVER_IP, DEFAULT_SERVER_PORT, DEFAULT_SERVER_PATH);
 	}
 
-	endpoints = url;
-
-    if ((bundleContext_getProperty(context, CFG_ETCD_TTL, &ttlStr) != CELIX_SUCCESS) || !ttlStr) {
-        ttl = DEFAULT_ETCD_TTL;
-    }
-    else
-    {
-        char* endptr = (char *) ttlStr;
-        errno = 0;
-        ttl = strtol(ttlStr, &endptr, 10);
-        if (*endptr || errno != 0) {
-            ttl = DEFAULT_ETCD_TTL;
-        }
-    }
-
-	if (etcd_get(localNodePath, &value, &modIndex) != true) {
-		etcd_set(localNodePath, endpoints, ttl, false);
-	}
-	else if (etcd_set(localNodePath, endpoints, ttl, true) == false)  {
+	if (etcd_set(localNodePath, url, watcher->ttl, false) != 0)  {
 		logHelper_log(*watcher->loghelper, OSGI_LOGSERVICE_WARNING, "Cannot register local discovery");
-    }
-    else {
-        status = CELIX_SUCCESS;
+		status = CELIX_BUNDLE_EXCEPTION;
     }
 
-	FREE_MEM(value);
+    return status;
+}
+
+/*
+ * refreshes the ttl of the own framework registration. A refresh does not
+ * notify the watchers of the other frameworks, only when the registration
+ * is expired (e.g. etcd was not reachable) it is registered again.
+ */
+static celix_status_t etcdWatcher_refreshOwnFramework(etcd_watcher_pt watcher)
+{
+    celix_status_t status;
+    char localNodePath[MAX_LOCALNODE_LENGTH];
+
+    status = etcdWatcher_getLocalNodePath(watcher->discovery->context, localNodePath);
+
+    if (status == CELIX_SUCCESS && etcd_refresh(localNodePath, watcher->ttl) != 0) {
+        status = etcdWatcher_addOwnFramework(watcher);
+    }
 
     return status;
 }
@@ -265,7 +281,9 @@ static void* etcdWatcher_run(void* data) {
 		char *action = NULL;
 		long long modIndex;
 
-        if (etcd_watch(rootPath, highestModified + 1, &action, &preValue, &value, &rkey, &modIndex) == 0 && action != NULL) {
+        int rc = etcd_watch(rootPath, highestModified + 1, &action, &preValue, &value, &rkey, &modIndex);
+
+        if (rc == ETCDLIB_RC_OK && action != NULL) {
 			if (strcmp(action, "set") == 0) {
 				etcdWatcher_addEntry(watcher, rkey, value);
 			} else if (strcmp(action, "delete") == 0) {
@@ -279,8 +297,8 @@ static void* etcdWatcher_run(void* data) {
 			}
 
 			highestModified = modIndex;
-        } else if (time(NULL) - timeBeforeWatch <= (DEFAULT_ETCD_TTL / 4)) {
-			sleep(DEFAULT_ETCD_TTL / 4);
+        } else if (rc != ETCDLIB_RC_TIMEOUT) {
+			sleep(ETCD_WATCH_RETRY_INTERVAL);
         }
 
         FREE_MEM(action);
@@ -289,8 +307,8 @@ static void* etcdWatcher_run(void* data) {
         FREE_MEM(rkey);
 
 		// update own framework uuid
-		if (time(NULL) - timeBeforeWatch > (DEFAULT_ETCD_TTL / 4)) {
-			etcdWatcher_addOwnFramework(watcher);
+		if (time(NULL) - timeBeforeWatch > (watcher->ttl / 4)) {
+			etcdWatcher_refreshOwnFramework(watcher);
 			timeBeforeWatch = time(NULL);
 		}
 	}
@@ -324,6 +342,7 @@ celix_status_t etcdWatcher_create(discovery_pt discovery, bundle_context_pt cont
 		(*watcher)->discovery = discovery;
 		(*watcher)->loghelper = &discovery->loghelper;
 		(*watcher)->entries = hashMap_create(utils_stringHash, NULL, utils_stringEquals, NULL);
+		(*watcher)->ttl = etcdWatcher_getTtl(context);
 	}
 
 	if ((bundleContext_getProperty(context, CFG_ETCD_SERVER_IP, &etcd_server) != CELIX_SUCCESS) || !etcd_server) {
@@ -381,11 +400,13 @@ celix_status_t etcdWatcher_destroy(etcd_watcher_pt watcher) {
 	// register own framework
 	status = etcdWatcher_getLocalNodePath(watcher->discovery->context, localNodePath);
 
-	if (status != CELIX_SUCCESS || etcd_del(localNodePath) == false)
+	if (status != CELIX_SUCCESS || etcd_del(localNodePath) != 0)
 	{
 		logHelper_log(*watcher->loghelper, OSGI_LOGSERVICE_WARNING, "Cannot remove local discovery registration.");
 	}
 
+	etcd_cleanup();
+
 	watcher->loghelper = NULL;
 
 	hashMap_destroy(watcher->entries, true, true);
@@ -36,7 +36,9 @@
 #define SHM_ENTRY_MAX_VALUE_LENGTH	256
 
 // defines the time-to-live in seconds
+#ifndef SHM_ENTRY_DEFAULT_TTL
 #define SHM_ENTRY_DEFAULT_TTL		60
+#endif
 
 // we currently support 64 separate discovery instances
 #define SHM_DATA_MAX_ENTRIES		64
@@ -50,6 +52,15 @@ celix_status_t discoveryShm_set(shmData_pt data, char *key, char* value);
 celix_status_t discoveryShm_get(shmData_pt data, char* key, char* value);
 celix_status_t discoveryShm_getKeys(shmData_pt data, char** keys, int* size);
 celix_status_t discoveryShm_remove(shmData_pt data, char* key);
+/* removes all expired entries, e.g. of crashed frameworks which never refresh them. Sets removed to the number of removed entries */
+celix_status_t discoveryShm_removeExpired(shmData_pt data, int* removed);
+
+/* returns the number of changes (added, changed or removed entries) since the shared memory block was created */
+celix_status_t discoveryShm_getChangeCount(shmData_pt data, unsigned int* changeCount);
+/* waits at most timeoutInSec until the change count differs from lastChangeCount or until notified */
+celix_status_t discoveryShm_waitForChange(shmData_pt data, unsigned int lastChangeCount, unsigned int timeoutInSec, unsigned int* changeCount);
+/* wakes up all waiting watchers */
+celix_status_t discoveryShm_notify(shmData_pt data);
 celix_status_t discoveryShm_detach(shmData_pt data);
 celix_status_t discoveryShm_destroy(shmData_pt data);
 
@@ -32,6 +32,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <errno.h>
 
 #include <sys/types.h>
 #include <sys/sem.h>
@@ -39,6 +40,7 @@
 
 #include <celix_errno.h>
 #include <celix_threads.h>
+#include <utils.h>
 
 #include "discovery_shm.h"
 
@@ -48,26 +50,37 @@
 #define DISCOVERY_SEM_FILENAME "/dev/null"
 #define DISCOVERY_SEM_FTOK_ID 54
 
+enum shmEntryState {
+    SHM_ENTRY_EMPTY = 0,
+    SHM_ENTRY_USED,
+    SHM_ENTRY_DELETED
+};
+
 struct shmEntry {
     char key[SHM_ENTRY_MAX_KEY_LENGTH];
     char value[SHM_ENTRY_MAX_VALUE_LENGTH];
 
     time_t expires;
+    enum shmEntryState state;
 };
 
 typedef struct shmEntry shmEntry;
 
 struct shmData {
-    shmEntry entries[SHM_DATA_MAX_ENTRIES];
+    shmEntry entries[SHM_DATA_MAX_ENTRIES]; // open addressing hash table on key
     int numOfEntries;
     int shmId;
 
+    // incremented on every added, changed or removed entry
+    unsigned int changeCount;
+
     celix_thread_mutex_t globalLock;
+    celix_thread_cond_t changed;
 };
 
 void* shmAdress;
 
-static celix_status_t discoveryShm_removeWithIndex(shmData_pt data, int index);
+static void discoveryShm_removeWithIndex(shmData_pt data, int index);
 
 /* returns the ftok key to identify shared memory*/
 static key_t discoveryShm_getKey() {
@@ -89,11 +102,19 @@ celix_status_t discoveryShm_create(shmData_pt* data) {
         status = CELIX_BUNDLE_EXCEPTION;
     } else {
         celix_thread_mutexattr_t threadAttr;
+        celix_thread_condattr_t condAttr;
 
         shmData->numOfEntries = 0;
+        shmData->changeCount = 0;
+
+        memcpy(shmAdress, shmData, sizeof(struct shmData));
 
         status = celixThreadMutexAttr_create(&threadAttr);
 
+        if (status == CELIX_SUCCESS) {
+            status = pthread_mutexattr_setpshared(&threadAttr, PTHREAD_PROCESS_SHARED);
+        }
+
 #ifdef LINUX
         if (status == CELIX_SUCCESS) {
             // This is Linux specific
@@ -101,12 +122,25 @@ celix_status_t discoveryShm_create(shmData_pt* data) {
         }
 #endif
 
+        // the mutex and condition are shared between processes, so they are initialized in place
+        if (status == CELIX_SUCCESS) {
+            status = celixThreadMutex_create(&((shmData_pt) shmAdress)->globalLock, &threadAttr);
+        }
+
+        if (status == CELIX_SUCCESS) {
+            status = pthread_condattr_init(&condAttr);
+        }
+
         if (status == CELIX_SUCCESS) {
-            status = celixThreadMutex_create(&shmData->globalLock, &threadAttr);
+            status = pthread_condattr_setpshared(&condAttr, PTHREAD_PROCESS_SHARED);
+        }
+
+        if (status == CELIX_SUCCESS) {
+            status = celixThreadCondition_init(&((shmData_pt) shmAdress)->changed, &condAttr);
+            pthread_condattr_destroy(&condAttr);
         }
 
         if (status == CELIX_SUCCESS) {
-            memcpy(shmAdress, shmData, sizeof(struct shmData));
             (*data) = shmAdress;
         }
     }
@@ -137,19 +171,44 @@ celix_status_t discoveryShm_attach(shmData_pt* data) {
     return status;
 }
 
-static celix_status_t discoveryShm_getwithIndex(shmData_pt data, char* key, char* value, int* index) {
+/* notifies all watchers about a change, should be called with the global lock taken */
+static void discoveryShm_changed(shmData_pt data) {
+    data->changeCount++;
+    celixThreadCondition_broadcast(&data->changed);
+}
+
+/*
+ * Looks up the slot of key. Expired entries found while probing are removed.
+ * If the key is not found and freeIndex is provided, freeIndex is set to the first free slot (or -1 if the table is full).
+ */
+static celix_status_t discoveryShm_getwithIndex(shmData_pt data, char* key, char* value, int* index, int* freeIndex) {
     celix_status_t status = CELIX_BUNDLE_EXCEPTION;
     time_t currentTime = time(NULL);
-    unsigned int i;
+    unsigned int start = utils_stringHash(key) % SHM_DATA_MAX_ENTRIES;
+    unsigned int probe;
+    int firstFree = -1;
+
+    for (probe = 0; probe < SHM_DATA_MAX_ENTRIES && status != CELIX_SUCCESS; probe++) {
+        int i = (start + probe) % SHM_DATA_MAX_ENTRIES;
+        shmEntry* entry = &data->entries[i];
 
-    for (i = 0; i < data->numOfEntries && status != CELIX_SUCCESS; i++) {
-        shmEntry entry = data->entries[i];
         // check if entry is still valid
-        if (data->entries[i].expires < currentTime) {
+        if (entry->state == SHM_ENTRY_USED && entry->expires < currentTime) {
             discoveryShm_removeWithIndex(data, i);
-        } else if (strcmp(entry.key, key) == 0) {
+        }
+
+        if (entry->state == SHM_ENTRY_EMPTY) {
+            if (firstFree < 0) {
+                firstFree = i;
+            }
+            break;
+        } else if (entry->state == SHM_ENTRY_DELETED) {
+            if (firstFree < 0) {
+                firstFree = i;
+            }
+        } else if (strcmp(entry->key, key) == 0) {
             if (value) {
-                strcpy(value, entry.value);
+                strcpy(value, entry->value);
             }
             if (index) {
                 (*index) = i;
@@ -158,6 +217,10 @@ static celix_status_t discoveryShm_getwithIndex(shmData_pt data, char* key, char
         }
     }
 
+    if (freeIndex) {
+        (*freeIndex) = firstFree;
+    }
+
     return status;
 }
 
@@ -167,16 +230,21 @@ celix_status_t discoveryShm_getKeys(shmData_pt data, char** keys, int* size) {
     status = celixThreadMutex_lock(&data->globalLock);
 
     if (status == CELIX_SUCCESS) {
-    	unsigned int i = 0;
-        for (i = 0; i < data->numOfEntries; i++) {
-            shmEntry entry = data->entries[i];
+        time_t currentTime = time(NULL);
+        unsigned int i = 0;
+        int nrOfKeys = 0;
+
+        for (i = 0; i < SHM_DATA_MAX_ENTRIES; i++) {
+            shmEntry* entry = &data->entries[i];
 
-            if (strlen(entry.key)>0) {
-                snprintf(keys[i], SHM_ENTRY_MAX_KEY_LENGTH, "%s", entry.key);
+            if (entry->state == SHM_ENTRY_USED && entry->expires < currentTime) {
+                discoveryShm_removeWithIndex(data, i);
+            } else if (entry->state == SHM_ENTRY_USED && strlen(entry->key) > 0) {
+                snprintf(keys[nrOfKeys++], SHM_ENTRY_MAX_KEY_LENGTH, "%s", entry->key);
             }
         }
 
-        (*size) = i;
+        (*size) = nrOfKeys;
 
         celixThreadMutex_unlock(&data->globalLock);
     }
@@ -187,29 +255,38 @@ celix_status_t discoveryShm_getKeys(shmData_pt data, char** keys, int* size) {
 celix_status_t discoveryShm_set(shmData_pt data, char *key, char* value) {
     celix_status_t status;
     int index = -1;
+    int freeIndex = -1;
 
-    if (data->numOfEntries >= SHM_DATA_MAX_ENTRIES) {
-        status = CELIX_ILLEGAL_STATE;
-    } else {
-        status = celixThreadMutex_lock(&data->globalLock);
+    status = celixThreadMutex_lock(&data->globalLock);
 
-        if (status == CELIX_SUCCESS) {
-            // check if key already there
-            status = discoveryShm_getwithIndex(data, key, NULL, &index);
-            if (status != CELIX_SUCCESS) {
-                index = data->numOfEntries;
+    if (status == CELIX_SUCCESS) {
+        // check if key already there
+        status = discoveryShm_getwithIndex(data, key, NULL, &index, &freeIndex);
+        if (status != CELIX_SUCCESS) {
+            if (freeIndex < 0 || data->numOfEntries >= SHM_DATA_MAX_ENTRIES) {
+                status = CELIX_ILLEGAL_STATE;
+            } else {
+                index = freeIndex;
 
                 snprintf(data->entries[index].key, SHM_ENTRY_MAX_KEY_LENGTH, "%s", key);
+                data->entries[index].value[0] = '\0';
+                data->entries[index].state = SHM_ENTRY_USED;
                 data->numOfEntries++;
 
-                 status = CELIX_SUCCESS;
+                status = CELIX_SUCCESS;
             }
+        }
 
-            snprintf(data->entries[index].value, SHM_ENTRY_MAX_VALUE_LENGTH, "%s", value);
+        if (status == CELIX_SUCCESS) {
+            // refreshing the time-to-live of an unchanged entry does not wake up the watchers
+            if (strncmp(data->entries[index].value, value, SHM_ENTRY_MAX_VALUE_LENGTH) != 0) {
+                snprintf(data->entries[index].value, SHM_ENTRY_MAX_VALUE_LENGTH, "%s", value);
+                discoveryShm_changed(data);
+            }
             data->entries[index].expires = (time(NULL) + SHM_ENTRY_DEFAULT_TTL);
-
-            celixThreadMutex_unlock(&data->globalLock);
         }
+
+        celixThreadMutex_unlock(&data->globalLock);
     }
 
     return status;
@@ -221,7 +298,7 @@ celix_status_t discoveryShm_get(shmData_pt data, char* key, char* value) {
     status = celixThreadMutex_lock(&data->globalLock);
 
     if (status == CELIX_SUCCESS) {
-        status = discoveryShm_getwithIndex(data, key, value, NULL);
+        status = discoveryShm_getwithIndex(data, key, value, NULL, NULL);
 
         celixThreadMutex_unlock(&data->globalLock);
     }
@@ -229,17 +306,78 @@ celix_status_t discoveryShm_get(shmData_pt data, char* key, char* value) {
     return status;
 }
 
-static celix_status_t discoveryShm_removeWithIndex(shmData_pt data, int index) {
-    celix_status_t status = CELIX_SUCCESS;
+celix_status_t discoveryShm_getChangeCount(shmData_pt data, unsigned int* changeCount) {
+    celix_status_t status;
 
-    data->numOfEntries--;
-    if (index < data->numOfEntries) {
-        memcpy((void*) &data->entries[index], (void*) &data->entries[index + 1], ((data->numOfEntries - index) * sizeof(struct shmEntry)));
+    status = celixThreadMutex_lock(&data->globalLock);
+
+    if (status == CELIX_SUCCESS) {
+        (*changeCount) = data->changeCount;
+
+        celixThreadMutex_unlock(&data->globalLock);
     }
 
     return status;
 }
 
+celix_status_t discoveryShm_waitForChange(shmData_pt data, unsigned int lastChangeCount, unsigned int timeoutInSec, unsigned int* changeCount) {
+    celix_status_t status;
+
+    status = celixThreadMutex_lock(&data->globalLock);
+
+    if (status == CELIX_SUCCESS) {
+        if (data->changeCount == lastChangeCount) {
+            struct timespec timeout;
+            clock_gettime(CLOCK_REALTIME, &timeout);
+            timeout.tv_sec += timeoutInSec;
+
+            // a single wait is enough, the caller re-evaluates the change count after waking up
+            int rc = pthread_cond_timedwait(&data->changed, &data->globalLock, &timeout);
+            if (rc != 0 && rc != ETIMEDOUT) {
+                status = CELIX_BUNDLE_EXCEPTION;
+            }
+        }
+
+        (*changeCount) = data->changeCount;
+
+        celixThreadMutex_unlock(&data->globalLock);
+    }
+
+    return status;
+}
+
+celix_status_t discoveryShm_notify(shmData_pt data) {
+    celix_status_t status;
+
+    status = celixThreadMutex_lock(&data->globalLock);
+
+    if (status == CELIX_SUCCESS) {
+        celixThreadCondition_broadcast(&data->changed);
+
+        celixThreadMutex_unlock(&data->globalLock);
+    }
+
+    return status;
+}
+
+/* marks the slot as deleted, so that lookups keep probing past it */
+static void discoveryShm_removeWithIndex(shmData_pt data, int index) {
+    data->entries[index].state = SHM_ENTRY_DELETED;
+    data->entries[index].key[0] = '\0';
+    data->entries[index].value[0] = '\0';
+    data->numOfEntries--;
+
+    if (data->numOfEntries == 0) {
+        // no entries left, so no probe sequence needs to be preserved
+        unsigned int i;
+        for (i = 0; i < SHM_DATA_MAX_ENTRIES; i++) {
+            data->entries[i].state = SHM_ENTRY_EMPTY;
+        }
+    }
+
+    discoveryShm_changed(data);
+}
+
 celix_status_t discoveryShm_remove(shmData_pt data, char* key) {
     celix_status_t status;
     int index = -1;
@@ -247,10 +385,38 @@ celix_status_t discoveryShm_remove(shmData_pt data, char* key) {
     status = celixThreadMutex_lock(&data->globalLock);
 
     if (status == CELIX_SUCCESS) {
-        status = discoveryShm_getwithIndex(data, key, NULL, &index);
+        status = discoveryShm_getwithIndex(data, key, NULL, &index, NULL);
 
         if (status == CELIX_SUCCESS) {
-            status = discoveryShm_removeWithIndex(data, index);
+            discoveryShm_removeWithIndex(data, index);
+        }
+
+        celixThreadMutex_unlock(&data->globalLock);
+    }
+
+    return status;
+}
+
+celix_status_t discoveryShm_removeExpired(shmData_pt data, int* removed) {
+    celix_status_t status;
+
+    status = celixThreadMutex_lock(&data->globalLock);
+
+    if (status == CELIX_SUCCESS) {
+        time_t currentTime = time(NULL);
+        unsigned int i;
+        int nrOfRemoved = 0;
+
+        // every removal increments the change count and wakes up the watchers
+        for (i = 0; i < SHM_DATA_MAX_ENTRIES; i++) {
+            if (data->entries[i].state == SHM_ENTRY_USED && data->entries[i].expires < currentTime) {
+                discoveryShm_removeWithIndex(data, i);
+                nrOfRemoved++;
+            }
+        }
+
+        if (removed) {
+            (*removed) = nrOfRemoved;
         }
 
         celixThreadMutex_unlock(&data->globalLock);
@@ -29,10 +29,13 @@
 #include <unistd.h>
 #include <string.h>
 #include <stdio.h>
+#include <time.h>
 
 
 #include "celix_log.h"
 #include "constants.h"
+#include "hash_map.h"
+#include "utils.h"
 #include "discovery_impl.h"
 
 #include "discovery_shm.h"
@@ -40,11 +43,16 @@
 
 #include "endpoint_discovery_poller.h"
 
+// interval in seconds in which the local registration is refreshed, should be smaller than SHM_ENTRY_DEFAULT_TTL
+#define DISCOVERY_SHM_REFRESH_INTERVAL 5
+
 struct shm_watcher {
     shmData_pt shmData;
     celix_thread_t watcherThread;
     celix_thread_mutex_t watcherLock;
 
+    hash_map_pt endpoints; // shm key -> discovery url, only accessed by the watcher thread
+
     volatile bool running;
 };
 
@@ -79,56 +87,54 @@ static celix_status_t discoveryShmWatcher_getLocalNodePath(bundle_context_pt con
     return status;
 }
 
-/* retrieves all endpoints from shm and syncs them with the ones already available */
+/* retrieves all endpoints from shm and applies the differences with the previously synced endpoints */
 static celix_status_t discoveryShmWatcher_syncEndpoints(discovery_pt discovery) {
     celix_status_t status = CELIX_SUCCESS;
     shm_watcher_pt watcher = discovery->watcher;
     char** shmKeyArr = calloc(SHM_DATA_MAX_ENTRIES, sizeof(*shmKeyArr));
-    array_list_pt registeredKeyArr = NULL;
+    hash_map_pt current = hashMap_create(utils_stringHash, NULL, utils_stringEquals, NULL);
+    hash_map_iterator_pt iter = NULL;
 
-    int i, j, shmSize;
+    int i, shmSize = 0;
 
     for (i = 0; i < SHM_DATA_MAX_ENTRIES; i++) {
         shmKeyArr[i] = calloc(SHM_ENTRY_MAX_KEY_LENGTH, sizeof(*shmKeyArr[i]));
     }
 
-    arrayList_create(&registeredKeyArr);
-
     // get all urls available in shm
     discoveryShm_getKeys(watcher->shmData, shmKeyArr, &shmSize);
 
-    // get all locally registered endpoints
-    endpointDiscoveryPoller_getDiscoveryEndpoints(discovery->poller, registeredKeyArr);
-
-    // add discovery points which are in shm, but not local yet
+    // add discovery points which are new or changed since the last sync
     for (i = 0; i < shmSize; i++) {
         char url[SHM_ENTRY_MAX_VALUE_LENGTH];
 
         if (discoveryShm_get(watcher->shmData, shmKeyArr[i], &url[0]) == CELIX_SUCCESS) {
-            bool elementFound = false;
-
-            for (j = 0; j < arrayList_size(registeredKeyArr) && elementFound == false; j++) {
+            char* knownUrl = hashMap_get(watcher->endpoints, shmKeyArr[i]);
 
-                if (strcmp(url, (char*) arrayList_get(registeredKeyArr, j)) == 0) {
-                    free(arrayList_remove(registeredKeyArr, j));
-                    elementFound = true;
-                }
-            }
-
-            if (elementFound == false) {
+            if (knownUrl == NULL) {
+                endpointDiscoveryPoller_addDiscoveryEndpoint(discovery->poller, url);
+            } else if (strcmp(knownUrl, url) != 0) {
+                endpointDiscoveryPoller_removeDiscoveryEndpoint(discovery->poller, knownUrl);
                 endpointDiscoveryPoller_addDiscoveryEndpoint(discovery->poller, url);
             }
+
+            hashMap_put(current, strdup(shmKeyArr[i]), strdup(url));
         }
     }
 
-    // remove those which are not in shm
-    for (i = 0; i < arrayList_size(registeredKeyArr); i++) {
-        char* regUrl = arrayList_get(registeredKeyArr, i);
+    // remove those which are not in shm anymore
+    iter = hashMapIterator_create(watcher->endpoints);
+    while (hashMapIterator_hasNext(iter)) {
+        hash_map_entry_pt entry = hashMapIterator_nextEntry(iter);
 
-        if (regUrl != NULL) {
-            endpointDiscoveryPoller_removeDiscoveryEndpoint(discovery->poller, regUrl);
+        if (!hashMap_containsKey(current, hashMapEntry_getKey(entry))) {
+            endpointDiscoveryPoller_removeDiscoveryEndpoint(discovery->poller, hashMapEntry_getValue(entry));
         }
     }
+    hashMapIterator_destroy(iter);
+
+    hashMap_destroy(watcher->endpoints, true, true);
+    watcher->endpoints = current;
 
     for (i = 0; i < SHM_DATA_MAX_ENTRIES; i++) {
         free(shmKeyArr[i]);
@@ -136,12 +142,6 @@ static celix_status_t discoveryShmWatcher_syncEndpoints(discovery_pt discovery)
 
     free(shmKeyArr);
 
-    for (j = 0; j < arrayList_size(registeredKeyArr); j++) {
-        free(arrayList_get(registeredKeyArr, j));
-    }
-
-    arrayList_destroy(registeredKeyArr);
-
     return status;
 }
 
@@ -150,6 +150,10 @@ static void* discoveryShmWatcher_run(void* data) {
     shm_watcher_pt watcher = discovery->watcher;
     char localNodePath[MAX_LOCALNODE_LENGTH];
     char url[MAX_LOCALNODE_LENGTH];
+    unsigned int lastChangeCount = 0;
+    unsigned int changeCount = 0;
+    bool synced = false;
+    time_t nextRefresh = 0;
 
     if (discoveryShmWatcher_getLocalNodePath(discovery->context, &localNodePath[0]) != CELIX_SUCCESS) {
         logHelper_log(discovery->loghelper, OSGI_LOGSERVICE_WARNING, "Cannot retrieve local discovery path.");
@@ -160,13 +164,26 @@ static void* discoveryShmWatcher_run(void* data) {
     }
 
     while (watcher->running) {
-        // register own framework
-        if (discoveryShm_set(watcher->shmData, localNodePath, url) != CELIX_SUCCESS) {
-            logHelper_log(discovery->loghelper, OSGI_LOGSERVICE_WARNING, "Cannot set local discovery registration.");
+        if (time(NULL) >= nextRefresh) {
+            // register own framework, also refreshes the time-to-live of the registration
+            if (discoveryShm_set(watcher->shmData, localNodePath, url) != CELIX_SUCCESS) {
+                logHelper_log(discovery->loghelper, OSGI_LOGSERVICE_WARNING, "Cannot set local discovery registration.");
+            }
+            nextRefresh = time(NULL) + DISCOVERY_SHM_REFRESH_INTERVAL;
+        }
+
+        // entries of crashed frameworks are never refreshed nor removed by their owner, so they are reaped here
+        discoveryShm_removeExpired(watcher->shmData, NULL);
+
+        discoveryShm_getChangeCount(watcher->shmData, &changeCount);
+        if (!synced || changeCount != lastChangeCount) {
+            discoveryShmWatcher_syncEndpoints(discovery);
+            lastChangeCount = changeCount;
+            synced = true;
         }
 
-        discoveryShmWatcher_syncEndpoints(discovery);
-        sleep(5);
+        // sleeps until another framework changes the shm or the registration needs to be refreshed
+        discoveryShm_waitForChange(watcher->shmData, lastChangeCount, DISCOVERY_SHM_REFRESH_INTERVAL, &changeCount);
     }
 
     return NULL;
@@ -194,6 +211,7 @@ celix_status_t discoveryShmWatcher_create(discovery_pt discovery) {
         }
 
         if (status == CELIX_SUCCESS) {
+            watcher->endpoints = hashMap_create(utils_stringHash, NULL, utils_stringEquals, NULL);
             discovery->watcher = watcher;
         }
         else{
@@ -223,6 +241,8 @@ celix_status_t discoveryShmWatcher_destroy(discovery_pt discovery) {
     watcher->running = false;
     celixThreadMutex_unlock(&watcher->watcherLock);
 
+    // wake up the watcher thread, it could be waiting for a change
+    discoveryShm_notify(watcher->shmData);
     celixThread_join(watcher->watcherThread, NULL);
 
     // remove own framework
@@ -234,6 +254,7 @@ celix_status_t discoveryShmWatcher_destroy(discovery_pt discovery) {
 
     if (status == CELIX_SUCCESS) {
         discoveryShm_detach(watcher->shmData);
+        hashMap_destroy(watcher->endpoints, true, true);
         free(watcher);
     }
     else {
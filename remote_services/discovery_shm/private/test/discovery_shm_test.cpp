@@ -0,0 +1,146 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+/*
+ * discovery_shm_test.cpp
+ *
+ * Built with SHM_ENTRY_DEFAULT_TTL set to 1 second, so entries which are not refreshed expire during the test.
+ *
+ *  \author     <a href="mailto:dev@celix.apache.org">Apache Celix Project Team</a>
+ *  \copyright  Apache License, Version 2.0
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/TestHarness_c.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+extern "C"
+{
+#include "discovery_shm.h"
+}
+
+int main(int argc, char** argv) {
+	return RUN_ALL_TESTS(argc, argv);
+}
+
+static char CRASHED_KEY[] = "discovery/crashed";
+static char CRASHED_URL[] = "http://127.0.0.1:9999/org.apache.celix.discovery.shm";
+static char ALIVE_KEY[] = "discovery/alive";
+static char ALIVE_URL[] = "http://127.0.0.1:9998/org.apache.celix.discovery.shm";
+
+struct change_waiter {
+	shmData_pt data;
+	unsigned int lastChangeCount;
+	unsigned int changeCount;
+	double waitedInSec;
+};
+
+static void* waitForChange(void* handle) {
+	struct change_waiter* waiter = (struct change_waiter*) handle;
+	struct timespec begin;
+	struct timespec end;
+
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	discoveryShm_waitForChange(waiter->data, waiter->lastChangeCount, 30, &waiter->changeCount);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	waiter->waitedInSec = (end.tv_sec - begin.tv_sec) + (end.tv_nsec - begin.tv_nsec) / 1000000000.0;
+	return NULL;
+}
+
+TEST_GROUP(discovery_shm) {
+	shmData_pt data;
+
+	void setup() {
+		data = NULL;
+		LONGS_EQUAL(CELIX_SUCCESS, discoveryShm_create(&data));
+	}
+
+	void teardown() {
+		discoveryShm_remove(data, CRASHED_KEY);
+		discoveryShm_remove(data, ALIVE_KEY);
+		discoveryShm_destroy(data);
+	}
+};
+
+TEST(discovery_shm, expiredEntryIsRemoved) {
+	char url[SHM_ENTRY_MAX_VALUE_LENGTH];
+	char* keys[SHM_DATA_MAX_ENTRIES];
+	unsigned int changeCount = 0;
+	unsigned int lastChangeCount = 0;
+	int removed = 0;
+	int size = 0;
+	int i;
+
+	LONGS_EQUAL(CELIX_SUCCESS, discoveryShm_set(data, CRASHED_KEY, CRASHED_URL));
+	LONGS_EQUAL(CELIX_SUCCESS, discoveryShm_set(data, ALIVE_KEY, ALIVE_URL));
+	discoveryShm_getChangeCount(data, &lastChangeCount);
+
+	// only the alive framework refreshes its entry, the crashed one never does
+	for (i = 0; i < 6; i++) {
+		usleep(500000);
+		LONGS_EQUAL(CELIX_SUCCESS, discoveryShm_set(data, ALIVE_KEY, ALIVE_URL));
+	}
+
+	LONGS_EQUAL(CELIX_SUCCESS, discoveryShm_removeExpired(data, &removed));
+	discoveryShm_getChangeCount(data, &changeCount);
+	CHECK(changeCount != lastChangeCount);
+
+	CHECK(discoveryShm_get(data, CRASHED_KEY, url) != CELIX_SUCCESS);
+	LONGS_EQUAL(CELIX_SUCCESS, discoveryShm_get(data, ALIVE_KEY, url));
+	STRCMP_EQUAL(ALIVE_URL, url);
+
+	for (i = 0; i < SHM_DATA_MAX_ENTRIES; i++) {
+		keys[i] = (char*) calloc(SHM_ENTRY_MAX_KEY_LENGTH, 1);
+	}
+	discoveryShm_getKeys(data, keys, &size);
+	LONGS_EQUAL(1, size);
+	STRCMP_EQUAL(ALIVE_KEY, keys[0]);
+	for (i = 0; i < SHM_DATA_MAX_ENTRIES; i++) {
+		free(keys[i]);
+	}
+}
+
+TEST(discovery_shm, watcherIsWokenWhenEntryExpires) {
+	struct change_waiter waiter;
+	pthread_t thread;
+	int removed = 0;
+
+	LONGS_EQUAL(CELIX_SUCCESS, discoveryShm_set(data, CRASHED_KEY, CRASHED_URL));
+
+	memset(&waiter, 0, sizeof(waiter));
+	waiter.data = data;
+	discoveryShm_getChangeCount(data, &waiter.lastChangeCount);
+	pthread_create(&thread, NULL, waitForChange, &waiter);
+
+	// nothing touches the expired entry, only the sweep can remove it
+	sleep(SHM_ENTRY_DEFAULT_TTL + 2);
+	LONGS_EQUAL(CELIX_SUCCESS, discoveryShm_removeExpired(data, &removed));
+	LONGS_EQUAL(1, removed);
+
+	pthread_join(thread, NULL);
+	LONGS_EQUAL(waiter.lastChangeCount + 1, waiter.changeCount);
+	CHECK(waiter.waitedInSec < 10);
+
+	LONGS_EQUAL(CELIX_SUCCESS, discoveryShm_removeExpired(data, &removed));
+	LONGS_EQUAL(0, removed);
+}
@@ -0,0 +1,60 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+/*
+ * binary_transport.h
+ *
+ * Length prefixed frames over a persistent TCP or unix domain socket, used for remote calls with the binary rpc
+ * encoding of dfi. Every frame has a request id, so a client sends the calls of all its threads over one connection
+ * and matches the replies as they arrive; the server handles the requests of a connection concurrently on a pool of
+ * worker threads. Addresses are urls of the form tcp://host:port or unix:///path.
+ *
+ *  \author    	<a href="mailto:dev@celix.apache.org">Apache Celix Project Team</a>
+ *  \copyright	Apache License, Version 2.0
+ */
+
+#ifndef BINARY_TRANSPORT_H_
+#define BINARY_TRANSPORT_H_
+
+#include <stddef.h>
+
+#include "celix_errno.h"
+
+typedef struct binary_server *binary_server_pt;
+typedef struct binary_client *binary_client_pt;
+
+/* Handles one request, the reply is allocated by the callee. An error is sent back as the reply status */
+typedef celix_status_t (*binary_server_call_fpt)(void *handle, unsigned long serviceId, const void *request, size_t requestSize, void **reply, size_t *replySize);
+
+/* Listens on url, a tcp port of 0 listens on a free port */
+celix_status_t binaryServer_create(const char *url, unsigned int nrOfThreads, binary_server_call_fpt call, void *handle, binary_server_pt *server);
+celix_status_t binaryServer_destroy(binary_server_pt server);
+/* The tcp port the server listens on, 0 for a unix domain socket */
+unsigned int binaryServer_getPort(binary_server_pt server);
+
+celix_status_t binaryClient_create(const char *url, binary_client_pt *client);
+celix_status_t binaryClient_destroy(binary_client_pt client);
+
+/*
+ * Sends a request and waits for its reply, timeout in seconds (0 waits forever). Returns CELIX_ILLEGAL_STATE when the
+ * request could not be sent, so the caller can use another transport. When the request is sent replyStatus is the
+ * status of the call: 0 with a reply, the status of the server or CELIX_ILLEGAL_STATE when the connection is lost.
+ */
+celix_status_t binaryClient_call(binary_client_pt client, unsigned long serviceId, const void *request, size_t requestSize, unsigned int timeout, void **reply, size_t *replySize, int *replyStatus);
+
+#endif /* BINARY_TRANSPORT_H_ */
@@ -25,6 +25,22 @@
 #include "log_helper.h"
 #include "endpoint_description.h"
 
+/*
+ * Exported services are called concurrently from the worker threads of the webserver and the binary transport.
+ * Services which are not thread safe can set this property to true to get their remote calls serialized.
+ */
+#define OSGI_RSA_SERVICE_EXPORTED_SERIAL "service.exported.serial"
+
+/* Calls are only counted while metrics are enabled (celixMetrics_setEnabled) */
+struct export_registration_statistics {
+    unsigned long calls;
+    unsigned long failures;
+    unsigned int inFlight;
+    unsigned int maxInFlight;
+    unsigned long long totalLatencyNs;
+    unsigned long long maxLatencyNs;
+};
+
 celix_status_t exportRegistration_create(log_helper_pt helper, service_reference_pt reference, endpoint_description_pt endpoint, bundle_context_pt context, export_registration_pt *registration);
 celix_status_t exportRegistration_close(export_registration_pt registration);
 void exportRegistration_destroy(export_registration_pt registration);
@@ -33,6 +49,9 @@ celix_status_t exportRegistration_start(export_registration_pt registration);
 celix_status_t exportRegistration_stop(export_registration_pt registration);
 
 celix_status_t exportRegistration_call(export_registration_pt export, char *data, int datalength, char **response, int *responseLength);
+/* Calls the service with a request of the binary transport, the response is encoded the same way */
+celix_status_t exportRegistration_callBinary(export_registration_pt export, const void *request, size_t requestSize, void **response, size_t *responseSize);
+celix_status_t exportRegistration_getStatistics(export_registration_pt export, struct export_registration_statistics *statistics);
 
 
 #endif //CELIX_EXPORT_REGISTRATION_DFI_H
@@ -22,12 +22,15 @@
 
 #include "import_registration.h"
 #include "dfi_utils.h"
+#include "interface_cache.h"
 
 #include <celix_errno.h>
 
 typedef void (*send_func_type)(void *handle, endpoint_description_pt endpointDescription, char *request, char **reply, int* replyStatus);
+/* Returns CELIX_ILLEGAL_STATE when the request cannot be sent, the json send function is used instead */
+typedef celix_status_t (*send_binary_func_type)(void *handle, endpoint_description_pt endpointDescription, const void *request, size_t requestSize, void **reply, size_t *replySize, int *replyStatus);
 
-celix_status_t importRegistration_create(bundle_context_pt context, endpoint_description_pt description, const char *classObject, const char* serviceVersion,
+celix_status_t importRegistration_create(bundle_context_pt context, interface_cache_pt interfaceCache, endpoint_description_pt description, const char *classObject, const char* serviceVersion,
                                          import_registration_pt *import);
 celix_status_t importRegistration_close(import_registration_pt import);
 void importRegistration_destroy(import_registration_pt import);
@@ -35,6 +38,14 @@ void importRegistration_destroy(import_registration_pt import);
 celix_status_t importRegistration_setSendFn(import_registration_pt reg,
                                             send_func_type,
                                             void *handle);
+celix_status_t importRegistration_setSendBinaryFn(import_registration_pt reg,
+                                                  send_binary_func_type,
+                                                  void *handle);
+/*
+ * Calls of oneway methods are queued and sent as one json batch request when maxBatchSize calls are queued or
+ * maxDelayMs after the first queued call. Should be set before the import is started.
+ */
+celix_status_t importRegistration_setOnewayBatch(import_registration_pt reg, size_t maxBatchSize, unsigned int maxDelayMs);
 celix_status_t importRegistration_start(import_registration_pt import);
 celix_status_t importRegistration_stop(import_registration_pt import);
 
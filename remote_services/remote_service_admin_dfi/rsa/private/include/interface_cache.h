@@ -0,0 +1,55 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+/*
+ * interface_cache.h
+ *
+ * Cache of parsed interface descriptors. Interfaces are keyed by the content of their descriptor, so every distinct
+ * descriptor is parsed once and the closures of its methods are created once, no matter how many bundles use it. The
+ * cached interfaces are immutable and reference counted, an interface is destroyed when it is released by its last user.
+ */
+
+#ifndef INTERFACE_CACHE_H_
+#define INTERFACE_CACHE_H_
+
+#include <stdio.h>
+
+#include "celix_errno.h"
+#include "dyn_interface.h"
+
+typedef struct interface_cache *interface_cache_pt;
+typedef struct interface_cache_entry *interface_cache_entry_pt;
+
+typedef void (*interface_cache_bind_fpt)(void *userData, void *args[], void *returnVal);
+
+celix_status_t interfaceCache_create(interface_cache_pt *cache);
+void interfaceCache_destroy(interface_cache_pt cache);
+
+/*
+ * Returns the entry for the descriptor, parsing the descriptor only when it is not cached yet. The method closures of
+ * a new entry are bound to bind with the method entry as user data, all users of a cache have to use the same bind
+ * function. Every get has to be matched by a release.
+ */
+celix_status_t interfaceCache_get(interface_cache_pt cache, FILE *descriptor, interface_cache_bind_fpt bind, interface_cache_entry_pt *entry);
+void interfaceCache_release(interface_cache_pt cache, interface_cache_entry_pt entry);
+
+dyn_interface_type *interfaceCacheEntry_getInterface(interface_cache_entry_pt entry);
+/* The closures of the methods, in the order of the method indices */
+int interfaceCacheEntry_getMethods(interface_cache_entry_pt entry, void (***methods)(void));
+
+#endif /* INTERFACE_CACHE_H_ */
@@ -0,0 +1,811 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+/*
+ * binary_transport.c
+ *
+ *  \author    	<a href="mailto:dev@celix.apache.org">Apache Celix Project Team</a>
+ *  \copyright	Apache License, Version 2.0
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "celix_threads.h"
+#include "array_list.h"
+#include "hash_map.h"
+#include "binary_transport.h"
+
+/*
+ * A frame is a header followed by the payload: the length of the payload, the request id, the kind of frame and the
+ * service id of a request or the status of a failed request, all little endian.
+ */
+#define FRAME_HEADER_SIZE 17
+#define FRAME_REQUEST 1
+#define FRAME_REPLY 2
+#define FRAME_FAILURE 3
+
+#define MAX_FRAME_SIZE (64 * 1024 * 1024)
+
+// sent by the client and echoed by the server when a connection is opened
+#define HANDSHAKE "CBF1"
+#define HANDSHAKE_SIZE 4
+#define HANDSHAKE_TIMEOUT_S 5
+
+// a client which cannot connect does not try again for this long, calls use another transport meanwhile
+#define RECONNECT_DELAY_S 5
+
+struct binary_frame {
+    uint32_t requestId;
+    uint8_t kind;
+    uint64_t value;
+    void *payload;
+    size_t payloadSize;
+};
+
+struct binary_job {
+    struct binary_connection *connection;
+    struct binary_frame frame;
+    struct binary_job *next;
+};
+
+struct binary_connection {
+    binary_server_pt server;
+    int fd;
+    celix_thread_mutex_t writeMutex; //a frame is written at once
+    unsigned int count; //the reader and the queued jobs, protected by the server mutex
+};
+
+struct binary_server {
+    int listenFd;
+    int wakeup[2]; //wakes the accept thread when stopping
+    char *socketPath; //unix domain socket to remove when destroyed
+    unsigned int port;
+
+    binary_server_call_fpt call;
+    void *handle;
+
+    celix_thread_t acceptThread;
+    celix_thread_t *workers;
+    unsigned int nrOfWorkers;
+
+    celix_thread_mutex_t mutex; //protects running, connections and the job queue
+    celix_thread_cond_t cond; //signals new jobs and closed connections
+    bool running;
+    array_list_pt connections;
+    struct binary_job *firstJob;
+    struct binary_job *lastJob;
+};
+
+struct binary_call {
+    celix_thread_cond_t cond;
+    bool done;
+    int status;
+    void *reply;
+    size_t replySize;
+};
+
+struct binary_client {
+    char *url;
+
+    celix_thread_mutex_t mutex; //protects all below, also held while writing a frame
+    celix_thread_cond_t readerStopped;
+    int fd;
+    bool readerRunning;
+    uint32_t nextRequestId;
+    hash_map_pt calls; //key -> request id, value -> binary_call
+    time_t retryAfter;
+};
+
+static celix_status_t binaryTransport_parseUrl(const char *url, bool listen, struct sockaddr_storage *addr, socklen_t *addrLen, char **socketPath);
+static celix_status_t binaryTransport_writeFully(int fd, const void *data, size_t size);
+static celix_status_t binaryTransport_readFully(int fd, void *data, size_t size);
+static celix_status_t binaryTransport_writeFrame(int fd, struct binary_frame *frame);
+static celix_status_t binaryTransport_readFrame(int fd, struct binary_frame *frame);
+
+static void *binaryServer_accept(void *data);
+static void *binaryServer_read(void *data);
+static void *binaryServer_work(void *data);
+static void binaryServer_releaseConnection(struct binary_connection *connection);
+
+static celix_status_t binaryClient_connect(binary_client_pt client);
+static void *binaryClient_read(void *data);
+
+celix_status_t binaryServer_create(const char *url, unsigned int nrOfThreads, binary_server_call_fpt call, void *handle, binary_server_pt *out) {
+    celix_status_t status = CELIX_SUCCESS;
+    struct sockaddr_storage addr;
+    socklen_t addrLen = 0;
+    char *socketPath = NULL;
+    int one = 1;
+    unsigned int i;
+
+    binary_server_pt server = calloc(1, sizeof(*server));
+    if (server == NULL) {
+        return CELIX_ENOMEM;
+    }
+    server->listenFd = -1;
+    server->wakeup[0] = -1;
+    server->wakeup[1] = -1;
+    server->call = call;
+    server->handle = handle;
+    server->nrOfWorkers = nrOfThreads > 0 ? nrOfThreads : 1;
+
+    status = binaryTransport_parseUrl(url, true, &addr, &addrLen, &socketPath);
+    if (status == CELIX_SUCCESS) {
+        server->listenFd = socket(addr.ss_family, SOCK_STREAM, 0);
+        if (server->listenFd < 0) {
+            status = CELIX_FILE_IO_EXCEPTION;
+        }
+    }
+    if (status == CELIX_SUCCESS) {
+        if (socketPath != NULL) {
+            // a socket left behind by a previous run
+            unlink(socketPath);
+            server->socketPath = socketPath;
+        } else {
+            setsockopt(server->listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        }
+        if (bind(server->listenFd, (struct sockaddr *) &addr, addrLen) != 0 || listen(server->listenFd, SOMAXCONN) != 0) {
+            status = CELIX_FILE_IO_EXCEPTION;
+        }
+    }
+    if (status == CELIX_SUCCESS && socketPath == NULL) {
+        addrLen = sizeof(addr);
+        getsockname(server->listenFd, (struct sockaddr *) &addr, &addrLen);
+        server->port = ntohs(addr.ss_family == AF_INET6 ? ((struct sockaddr_in6 *) &addr)->sin6_port : ((struct sockaddr_in *) &addr)->sin_port);
+    }
+    if (status == CELIX_SUCCESS && pipe(server->wakeup) != 0) {
+        status = CELIX_FILE_IO_EXCEPTION;
+    }
+
+    if (status == CELIX_SUCCESS) {
+        celixThreadMutex_create(&server->mutex, NULL);
+        celixThreadCondition_init(&server->cond, NULL);
+        arrayList_create(&server->connections);
+        server->running = true;
+
+        server->workers = calloc(server->nrOfWorkers, sizeof(*server->workers));
+        for (i = 0; i < server->nrOfWorkers; i++) {
+            celixThread_create(&server->workers[i], NULL, binaryServer_work, server);
+        }
+        celixThread_create(&server->acceptThread, NULL, binaryServer_accept, server);
+        *out = server;
+    } else {
+        if (server->listenFd >= 0) {
+            close(server->listenFd);
+        }
+        if (server->wakeup[0] >= 0) {
+            close(server->wakeup[0]);
+            close(server->wakeup[1]);
+        }
+        if (server->socketPath != NULL) {
+            unlink(server->socketPath);
+        }
+        free(socketPath);
+        free(server);
+    }
+
+    return status;
+}
+
+celix_status_t binaryServer_destroy(binary_server_pt server) {
+    unsigned int i;
+    char stop = 0;
+
+    celixThreadMutex_lock(&server->mutex);
+    server->running = false;
+    celixThreadCondition_broadcast(&server->cond);
+    celixThreadMutex_unlock(&server->mutex);
+
+    if (write(server->wakeup[1], &stop, 1) != 1) {
+        // the accept thread also stops when the listen socket is shut down
+        shutdown(server->listenFd, SHUT_RDWR);
+    }
+    celixThread_join(server->acceptThread, NULL);
+
+    // wake the readers and wait until all connections are closed
+    celixThreadMutex_lock(&server->mutex);
+    for (i = 0; i < arrayList_size(server->connections); i++) {
+        struct binary_connection *connection = arrayList_get(server->connections, i);
+        shutdown(connection->fd, SHUT_RDWR);
+    }
+    while (arrayList_size(server->connections) > 0) {
+        celixThreadCondition_wait(&server->cond, &server->mutex);
+    }
+    celixThreadMutex_unlock(&server->mutex);
+
+    for (i = 0; i < server->nrOfWorkers; i++) {
+        celixThread_join(server->workers[i], NULL);
+    }
+
+    close(server->listenFd);
+    close(server->wakeup[0]);
+    close(server->wakeup[1]);
+    if (server->socketPath != NULL) {
+        unlink(server->socketPath);
+        free(server->socketPath);
+    }
+
+    arrayList_destroy(server->connections);
+    celixThreadCondition_destroy(&server->cond);
+    celixThreadMutex_destroy(&server->mutex);
+    free(server->workers);
+    free(server);
+
+    return CELIX_SUCCESS;
+}
+
+unsigned int binaryServer_getPort(binary_server_pt server) {
+    return server->port;
+}
+
+static void *binaryServer_accept(void *data) {
+    binary_server_pt server = data;
+    struct pollfd fds[2];
+
+    fds[0].fd = server->listenFd;
+    fds[0].events = POLLIN;
+    fds[1].fd = server->wakeup[0];
+    fds[1].events = POLLIN;
+
+    while (true) {
+        int fd;
+        int one = 1;
+        celix_thread_t reader;
+        struct binary_connection *connection = NULL;
+
+        if (poll(fds, 2, -1) < 0 && errno != EINTR) {
+            break;
+        }
+        if (fds[1].revents != 0) {
+            break;
+        }
+        if ((fds[0].revents & POLLIN) == 0) {
+            continue;
+        }
+
+        fd = accept(server->listenFd, NULL, NULL);
+        if (fd < 0) {
+            continue;
+        }
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        connection = calloc(1, sizeof(*connection));
+        if (connection == NULL) {
+            close(fd);
+            continue;
+        }
+        connection->server = server;
+        connection->fd = fd;
+        connection->count = 1;
+        celixThreadMutex_create(&connection->writeMutex, NULL);
+
+        celixThreadMutex_lock(&server->mutex);
+        if (server->running) {
+            arrayList_add(server->connections, connection);
+            celixThread_create(&reader, NULL, binaryServer_read, connection);
+            celixThread_detach(reader);
+            connection = NULL;
+        }
+        celixThreadMutex_unlock(&server->mutex);
+
+        if (connection != NULL) {
+            binaryServer_releaseConnection(connection);
+        }
+    }
+
+    return NULL;
+}
+
+static void *binaryServer_read(void *data) {
+    struct binary_connection *connection = data;
+    binary_server_pt server = connection->server;
+    char handshake[HANDSHAKE_SIZE];
+    struct binary_frame frame;
+    celix_status_t status;
+
+    status = binaryTransport_readFully(connection->fd, handshake, HANDSHAKE_SIZE);
+    if (status == CELIX_SUCCESS && memcmp(handshake, HANDSHAKE, HANDSHAKE_SIZE) != 0) {
+        status = CELIX_ILLEGAL_ARGUMENT;
+    }
+    if (status == CELIX_SUCCESS) {
+        status = binaryTransport_writeFully(connection->fd, HANDSHAKE, HANDSHAKE_SIZE);
+    }
+
+    while (status == CELIX_SUCCESS) {
+        status = binaryTransport_readFrame(connection->fd, &frame);
+        if (status == CELIX_SUCCESS && frame.kind != FRAME_REQUEST) {
+            free(frame.payload);
+            status = CELIX_ILLEGAL_ARGUMENT;
+        }
+
+        if (status == CELIX_SUCCESS) {
+            struct binary_job *job = calloc(1, sizeof(*job));
+            if (job == NULL) {
+                free(frame.payload);
+                status = CELIX_ENOMEM;
+                break;
+            }
+            job->connection = connection;
+            job->frame = frame;
+
+            celixThreadMutex_lock(&server->mutex);
+            if (server->running) {
+                connection->count += 1;
+                if (server->lastJob == NULL) {
+                    server->firstJob = job;
+                } else {
+                    server->lastJob->next = job;
+                }
+                server->lastJob = job;
+                celixThreadCondition_signal(&server->cond);
+                job = NULL;
+            }
+            celixThreadMutex_unlock(&server->mutex);
+
+            if (job != NULL) {
+                free(job->frame.payload);
+                free(job);
+                status = CELIX_ILLEGAL_STATE;
+            }
+        }
+    }
+
+    celixThreadMutex_lock(&server->mutex);
+    arrayList_removeElement(server->connections, connection);
+    celixThreadCondition_broadcast(&server->cond);
+    celixThreadMutex_unlock(&server->mutex);
+
+    binaryServer_releaseConnection(connection);
+
+    return NULL;
+}
+
+static void *binaryServer_work(void *data) {
+    binary_server_pt server = data;
+
+    celixThreadMutex_lock(&server->mutex);
+    while (true) {
+        struct binary_job *job = NULL;
+        struct binary_frame reply;
+        celix_status_t status;
+
+        while (server->firstJob == NULL && server->running) {
+            celixThreadCondition_wait(&server->cond, &server->mutex);
+        }
+        job = server->firstJob;
+        if (job == NULL) {
+            break;
+        }
+        server->firstJob = job->next;
+        if (server->firstJob == NULL) {
+            server->lastJob = NULL;
+        }
+        celixThreadMutex_unlock(&server->mutex);
+
+        memset(&reply, 0, sizeof(reply));
+        reply.requestId = job->frame.requestId;
+        status = server->call(server->handle, (unsigned long) job->frame.value, job->frame.payload, job->frame.payloadSize, &reply.payload, &reply.payloadSize);
+        if (status == CELIX_SUCCESS) {
+            reply.kind = FRAME_REPLY;
+        } else {
+            free(reply.payload);
+            reply.payload = NULL;
+            reply.payloadSize = 0;
+            reply.kind = FRAME_FAILURE;
+            reply.value = (uint32_t) status;
+        }
+
+        celixThreadMutex_lock(&job->connection->writeMutex);
+        if (binaryTransport_writeFrame(job->connection->fd, &reply) != CELIX_SUCCESS) {
+            // wakes the reader, which closes the connection
+            shutdown(job->connection->fd, SHUT_RDWR);
+        }
+        celixThreadMutex_unlock(&job->connection->writeMutex);
+
+        free(reply.payload);
+        free(job->frame.payload);
+        binaryServer_releaseConnection(job->connection);
+        free(job);
+
+        celixThreadMutex_lock(&server->mutex);
+    }
+    celixThreadMutex_unlock(&server->mutex);
+
+    return NULL;
+}
+
+static void binaryServer_releaseConnection(struct binary_connection *connection) {
+    binary_server_pt server = connection->server;
+    unsigned int count;
+
+    celixThreadMutex_lock(&server->mutex);
+    count = --connection->count;
+    celixThreadMutex_unlock(&server->mutex);
+
+    if (count == 0) {
+        close(connection->fd);
+        celixThreadMutex_destroy(&connection->writeMutex);
+        free(connection);
+    }
+}
+
+celix_status_t binaryClient_create(const char *url, binary_client_pt *out) {
+    binary_client_pt client = calloc(1, sizeof(*client));
+
+    if (client == NULL) {
+        return CELIX_ENOMEM;
+    }
+    client->url = strdup(url);
+    client->fd = -1;
+    client->nextRequestId = 1;
+    client->calls = hashMap_create(NULL, NULL, NULL, NULL);
+    celixThreadMutex_create(&client->mutex, NULL);
+    celixThreadCondition_init(&client->readerStopped, NULL);
+
+    *out = client;
+
+    return CELIX_SUCCESS;
+}
+
+celix_status_t binaryClient_destroy(binary_client_pt client) {
+    celixThreadMutex_lock(&client->mutex);
+    if (client->fd >= 0) {
+        shutdown(client->fd, SHUT_RDWR);
+    }
+    while (client->readerRunning) {
+        celixThreadCondition_wait(&client->readerStopped, &client->mutex);
+    }
+    celixThreadMutex_unlock(&client->mutex);
+
+    hashMap_destroy(client->calls, false, false);
+    celixThreadCondition_destroy(&client->readerStopped);
+    celixThreadMutex_destroy(&client->mutex);
+    free(client->url);
+    free(client);
+
+    return CELIX_SUCCESS;
+}
+
+celix_status_t binaryClient_call(binary_client_pt client, unsigned long serviceId, const void *request, size_t requestSize, unsigned int timeout, void **reply, size_t *replySize, int *replyStatus) {
+    celix_status_t status = CELIX_SUCCESS;
+    struct binary_call call;
+    struct binary_frame frame;
+    struct timespec deadline;
+
+    memset(&call, 0, sizeof(call));
+    celixThreadCondition_init(&call.cond, NULL);
+
+    if (timeout > 0) {
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += timeout;
+    }
+
+    celixThreadMutex_lock(&client->mutex);
+
+    if (client->fd < 0) {
+        status = binaryClient_connect(client);
+    }
+
+    if (status == CELIX_SUCCESS) {
+        frame.requestId = client->nextRequestId++;
+        if (client->nextRequestId == 0) {
+            client->nextRequestId = 1;
+        }
+        frame.kind = FRAME_REQUEST;
+        frame.value = serviceId;
+        frame.payload = (void *) request;
+        frame.payloadSize = requestSize;
+
+        hashMap_put(client->calls, (void *) (uintptr_t) frame.requestId, &call);
+        status = binaryTransport_writeFrame(client->fd, &frame);
+        if (status != CELIX_SUCCESS) {
+            // an incomplete frame is never handled, the reader fails the calls of the broken connection
+            hashMap_remove(client->calls, (void *) (uintptr_t) frame.requestId);
+            shutdown(client->fd, SHUT_RDWR);
+            status = CELIX_ILLEGAL_STATE;
+        }
+    }
+
+    if (status == CELIX_SUCCESS) {
+        while (!call.done) {
+            if (timeout == 0) {
+                celixThreadCondition_wait(&call.cond, &client->mutex);
+            } else if (pthread_cond_timedwait(&call.cond, &client->mutex, &deadline) == ETIMEDOUT) {
+                break;
+            }
+        }
+        if (call.done) {
+            *replyStatus = call.status;
+            *reply = call.reply;
+            *replySize = call.replySize;
+        } else {
+            // a reply arriving later is dropped
+            hashMap_remove(client->calls, (void *) (uintptr_t) frame.requestId);
+            *replyStatus = CELIX_ILLEGAL_STATE;
+        }
+    }
+
+    celixThreadMutex_unlock(&client->mutex);
+    celixThreadCondition_destroy(&call.cond);
+
+    return status;
+}
+
+static celix_status_t binaryClient_connect(binary_client_pt client) {
+    celix_status_t status = CELIX_SUCCESS;
+    struct sockaddr_storage addr;
+    socklen_t addrLen = 0;
+    struct timeval handshakeTimeout = {HANDSHAKE_TIMEOUT_S, 0};
+    struct timeval noTimeout = {0, 0};
+    char handshake[HANDSHAKE_SIZE];
+    celix_thread_t reader;
+    int one = 1;
+    int fd = -1;
+
+    if (time(NULL) < client->retryAfter || client->readerRunning) {
+        return CELIX_ILLEGAL_STATE;
+    }
+
+    status = binaryTransport_parseUrl(client->url, false, &addr, &addrLen, NULL);
+    if (status == CELIX_SUCCESS) {
+        fd = socket(addr.ss_family, SOCK_STREAM, 0);
+        if (fd < 0 || connect(fd, (struct sockaddr *) &addr, addrLen) != 0) {
+            status = CELIX_ILLEGAL_STATE;
+        }
+    }
+    if (status == CELIX_SUCCESS) {
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &handshakeTimeout, sizeof(handshakeTimeout));
+        status = binaryTransport_writeFully(fd, HANDSHAKE, HANDSHAKE_SIZE);
+        if (status == CELIX_SUCCESS) {
+            status = binaryTransport_readFully(fd, handshake, HANDSHAKE_SIZE);
+        }
+        if (status != CELIX_SUCCESS || memcmp(handshake, HANDSHAKE, HANDSHAKE_SIZE) != 0) {
+            status = CELIX_ILLEGAL_STATE;
+        }
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &noTimeout, sizeof(noTimeout));
+    }
+
+    if (status == CELIX_SUCCESS) {
+        client->fd = fd;
+        client->readerRunning = true;
+        celixThread_create(&reader, NULL, binaryClient_read, client);
+        celixThread_detach(reader);
+    } else {
+        if (fd >= 0) {
+            close(fd);
+        }
+        client->retryAfter = time(NULL) + RECONNECT_DELAY_S;
+        status = CELIX_ILLEGAL_STATE;
+    }
+
+    return status;
+}
+
+static void *binaryClient_read(void *data) {
+    binary_client_pt client = data;
+    struct binary_frame frame;
+    hash_map_iterator_pt iter = NULL;
+    int fd;
+
+    celixThreadMutex_lock(&client->mutex);
+    fd = client->fd;
+    celixThreadMutex_unlock(&client->mutex);
+
+    while (binaryTransport_readFrame(fd, &frame) == CELIX_SUCCESS) {
+        struct binary_call *call = NULL;
+
+        celixThreadMutex_lock(&client->mutex);
+        call = hashMap_remove(client->calls, (void *) (uintptr_t) frame.requestId);
+        if (call != NULL) {
+            call->done = true;
+            if (frame.kind == FRAME_REPLY) {
+                call->status = CELIX_SUCCESS;
+                call->reply = frame.payload;
+                call->replySize = frame.payloadSize;
+                frame.payload = NULL;
+            } else {
+                call->status = frame.kind == FRAME_FAILURE ? (int) (uint32_t) frame.value : CELIX_ILLEGAL_STATE;
+            }
+            celixThreadCondition_signal(&call->cond);
+        }
+        celixThreadMutex_unlock(&client->mutex);
+
+        free(frame.payload);
+    }
+
+    // the connection is lost, fail the calls waiting for a reply
+    celixThreadMutex_lock(&client->mutex);
+    iter = hashMapIterator_create(client->calls);
+    while (hashMapIterator_hasNext(iter)) {
+        struct binary_call *call = hashMapIterator_nextValue(iter);
+        call->done = true;
+        call->status = CELIX_ILLEGAL_STATE;
+        celixThreadCondition_signal(&call->cond);
+    }
+    hashMapIterator_destroy(iter);
+    hashMap_clear(client->calls, false, false);
+
+    close(fd);
+    client->fd = -1;
+    client->readerRunning = false;
+    celixThreadCondition_broadcast(&client->readerStopped);
+    celixThreadMutex_unlock(&client->mutex);
+
+    return NULL;
+}
+
+static celix_status_t binaryTransport_parseUrl(const char *url, bool listen, struct sockaddr_storage *addr, socklen_t *addrLen, char **socketPath) {
+    celix_status_t status = CELIX_SUCCESS;
+
+    memset(addr, 0, sizeof(*addr));
+    if (strncmp(url, "unix://", 7) == 0) {
+        struct sockaddr_un *un = (struct sockaddr_un *) addr;
+        const char *path = url + 7;
+
+        if (strlen(path) == 0 || strlen(path) >= sizeof(un->sun_path)) {
+            status = CELIX_ILLEGAL_ARGUMENT;
+        } else {
+            un->sun_family = AF_UNIX;
+            strcpy(un->sun_path, path);
+            *addrLen = sizeof(*un);
+            if (socketPath != NULL) {
+                *socketPath = strdup(path);
+            }
+        }
+    } else if (strncmp(url, "tcp://", 6) == 0) {
+        const char *host = url + 6;
+        const char *port = strrchr(host, ':');
+        struct addrinfo hints;
+        struct addrinfo *result = NULL;
+        char hostname[256];
+
+        if (port == NULL || port - host >= sizeof(hostname)) {
+            status = CELIX_ILLEGAL_ARGUMENT;
+        } else {
+            memcpy(hostname, host, port - host);
+            hostname[port - host] = '\0';
+
+            memset(&hints, 0, sizeof(hints));
+            hints.ai_family = AF_UNSPEC;
+            hints.ai_socktype = SOCK_STREAM;
+            hints.ai_flags = listen ? AI_PASSIVE : 0;
+            // an empty host or * listens on all interfaces
+            if (getaddrinfo(strlen(hostname) == 0 || strcmp(hostname, "*") == 0 ? NULL : hostname, port + 1, &hints, &result) != 0 || result == NULL) {
+                status = CELIX_ILLEGAL_ARGUMENT;
+            } else {
+                memcpy(addr, result->ai_addr, result->ai_addrlen);
+                *addrLen = result->ai_addrlen;
+                freeaddrinfo(result);
+            }
+        }
+    } else {
+        status = CELIX_ILLEGAL_ARGUMENT;
+    }
+
+    return status;
+}
+
+static celix_status_t binaryTransport_writeFully(int fd, const void *data, size_t size) {
+    const char *ptr = data;
+
+    while (size > 0) {
+        ssize_t written = send(fd, ptr, size, MSG_NOSIGNAL);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        } else if (written <= 0) {
+            return CELIX_FILE_IO_EXCEPTION;
+        }
+        ptr += written;
+        size -= written;
+    }
+
+    return CELIX_SUCCESS;
+}
+
+static celix_status_t binaryTransport_readFully(int fd, void *data, size_t size) {
+    char *ptr = data;
+
+    while (size > 0) {
+        ssize_t nrOfBytes = recv(fd, ptr, size, 0);
+        if (nrOfBytes < 0 && errno == EINTR) {
+            continue;
+        } else if (nrOfBytes <= 0) {
+            return CELIX_FILE_IO_EXCEPTION;
+        }
+        ptr += nrOfBytes;
+        size -= nrOfBytes;
+    }
+
+    return CELIX_SUCCESS;
+}
+
+static celix_status_t binaryTransport_writeFrame(int fd, struct binary_frame *frame) {
+    celix_status_t status;
+    uint8_t header[FRAME_HEADER_SIZE];
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        header[i] = (uint8_t) (frame->payloadSize >> (8 * i));
+        header[4 + i] = (uint8_t) (frame->requestId >> (8 * i));
+    }
+    header[8] = frame->kind;
+    for (i = 0; i < 8; i++) {
+        header[9 + i] = (uint8_t) (frame->value >> (8 * i));
+    }
+
+    status = binaryTransport_writeFully(fd, header, FRAME_HEADER_SIZE);
+    if (status == CELIX_SUCCESS && frame->payloadSize > 0) {
+        status = binaryTransport_writeFully(fd, frame->payload, frame->payloadSize);
+    }
+
+    return status;
+}
+
+static celix_status_t binaryTransport_readFrame(int fd, struct binary_frame *frame) {
+    celix_status_t status;
+    uint8_t header[FRAME_HEADER_SIZE];
+    uint32_t size = 0;
+    int i;
+
+    memset(frame, 0, sizeof(*frame));
+    status = binaryTransport_readFully(fd, header, FRAME_HEADER_SIZE);
+    if (status == CELIX_SUCCESS) {
+        for (i = 3; i >= 0; i--) {
+            size = (size << 8) | header[i];
+            frame->requestId = (frame->requestId << 8) | header[4 + i];
+        }
+        frame->kind = header[8];
+        for (i = 7; i >= 0; i--) {
+            frame->value = (frame->value << 8) | header[9 + i];
+        }
+        if (size > MAX_FRAME_SIZE) {
+            status = CELIX_ILLEGAL_ARGUMENT;
+        }
+    }
+
+    if (status == CELIX_SUCCESS && size > 0) {
+        frame->payload = malloc(size);
+        if (frame->payload == NULL) {
+            status = CELIX_ENOMEM;
+        } else {
+            status = binaryTransport_readFully(fd, frame->payload, size);
+        }
+    }
+
+    if (status == CELIX_SUCCESS) {
+        frame->payloadSize = size;
+    } else {
+        free(frame->payload);
+        frame->payload = NULL;
+    }
+
+    return status;
+}
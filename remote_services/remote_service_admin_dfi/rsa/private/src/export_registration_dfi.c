@@ -17,6 +17,7 @@
  *under the License.
  */
 
+#include <time.h>
 #include <jansson.h>
 #include <dyn_interface.h>
 #include <json_serializer.h>
@@ -25,7 +26,9 @@
 #include <service_tracker_customizer.h>
 #include <service_tracker.h>
 #include <json_rpc.h>
+#include <binary_rpc.h>
 #include "constants.h"
+#include "celix_metrics.h"
 #include "export_registration_dfi.h"
 #include "dfi_utils.h"
 
@@ -41,8 +44,15 @@ struct export_registration {
     dyn_interface_type *intf; //owner
     service_tracker_pt tracker;
 
-    celix_thread_mutex_t mutex;
-    void *service; //protected by mutex
+    celix_thread_rwlock_t lock;
+    void *service; //protected by lock
+
+    bool serial;
+    celix_thread_mutex_t callMutex; //only used for serial exports
+
+    struct export_registration_statistics statistics; //updated atomically
+    celix_metric_pt callMetric;
+    celix_metric_pt failuresMetric;
 
     //TODO add tracker and lock
     bool closed;
@@ -50,6 +60,8 @@ struct export_registration {
 
 static void exportRegistration_addServ(export_registration_pt reg, service_reference_pt ref, void *service);
 static void exportRegistration_removeServ(export_registration_pt reg, service_reference_pt ref, void *service);
+static uint64_t exportRegistration_beginCall(export_registration_pt export);
+static void exportRegistration_endCall(export_registration_pt export, uint64_t begin, int status);
 
 celix_status_t exportRegistration_create(log_helper_pt helper, service_reference_pt reference, endpoint_description_pt endpoint, bundle_context_pt context, export_registration_pt *out) {
     celix_status_t status = CELIX_SUCCESS;
@@ -75,7 +87,14 @@ celix_status_t exportRegistration_create(log_helper_pt helper, service_reference
         reg->exportReference.reference = reference;
         reg->closed = false;
 
-        celixThreadMutex_create(&reg->mutex, NULL);
+        celixThreadRwlock_create(&reg->lock, NULL);
+        celixThreadMutex_create(&reg->callMutex, NULL);
+        celixMetrics_get("rsa_export_call_ns", CELIX_METRIC_HISTOGRAM, &reg->callMetric);
+        celixMetrics_get("rsa_export_call_failures_total", CELIX_METRIC_COUNTER, &reg->failuresMetric);
+
+        const char *serial = NULL;
+        serviceReference_getProperty(reference, OSGI_RSA_SERVICE_EXPORTED_SERIAL, &serial);
+        reg->serial = serial != NULL && strcmp(serial, "true") == 0;
     }
 
     const char *exports = NULL;
@@ -143,14 +162,107 @@ celix_status_t exportRegistration_call(export_registration_pt export, char *data
 
     //printf("calling for '%s'\n");
 
+    uint64_t begin;
+
     *responseLength = -1;
-    celixThreadMutex_lock(&export->mutex);
-    status = jsonRpc_call(export->intf, export->service, data, responseOut);
-    celixThreadMutex_unlock(&export->mutex);
+
+    begin = exportRegistration_beginCall(export);
+
+    // the read lock only guards the service pointer, calls of different threads run concurrently
+    celixThreadRwlock_readLock(&export->lock);
+    if (export->service == NULL) {
+        status = CELIX_ILLEGAL_STATE;
+    } else if (export->serial) {
+        celixThreadMutex_lock(&export->callMutex);
+        status = jsonRpc_call(export->intf, export->service, data, responseOut);
+        celixThreadMutex_unlock(&export->callMutex);
+    } else {
+        status = jsonRpc_call(export->intf, export->service, data, responseOut);
+    }
+    celixThreadRwlock_unlock(&export->lock);
+
+    exportRegistration_endCall(export, begin, status);
+
+    return status;
+}
+
+celix_status_t exportRegistration_callBinary(export_registration_pt export, const void *request, size_t requestSize, void **response, size_t *responseSize) {
+    int status = CELIX_SUCCESS;
+    uint64_t begin;
+
+    begin = exportRegistration_beginCall(export);
+
+    celixThreadRwlock_readLock(&export->lock);
+    if (export->service == NULL) {
+        status = CELIX_ILLEGAL_STATE;
+    } else if (export->serial) {
+        celixThreadMutex_lock(&export->callMutex);
+        status = binaryRpc_call(export->intf, export->service, request, requestSize, response, responseSize);
+        celixThreadMutex_unlock(&export->callMutex);
+    } else {
+        status = binaryRpc_call(export->intf, export->service, request, requestSize, response, responseSize);
+    }
+    celixThreadRwlock_unlock(&export->lock);
+
+    exportRegistration_endCall(export, begin, status);
 
     return status;
 }
 
+/*
+ * The statistics are kept with the metrics, a call costs no clock reads or atomics when metrics are disabled.
+ * Returns the begin timestamp for exportRegistration_endCall, 0 when metrics are disabled.
+ */
+static uint64_t exportRegistration_beginCall(export_registration_pt export) {
+    unsigned int inFlight;
+    unsigned int maxInFlight;
+    uint64_t begin = celixMetrics_startTimer();
+
+    if (begin != 0) {
+        inFlight = __sync_add_and_fetch(&export->statistics.inFlight, 1);
+        maxInFlight = export->statistics.maxInFlight;
+        while (inFlight > maxInFlight && !__sync_bool_compare_and_swap(&export->statistics.maxInFlight, maxInFlight, inFlight)) {
+            maxInFlight = export->statistics.maxInFlight;
+        }
+    }
+    return begin;
+}
+
+static void exportRegistration_endCall(export_registration_pt export, uint64_t begin, int status) {
+    uint64_t end;
+    uint64_t latency;
+    unsigned long long maxLatency;
+
+    if (begin == 0) {
+        return;
+    }
+
+    end = celixMetrics_startTimer(); //0 when metrics were disabled during the call
+    latency = end > begin ? end - begin : 0;
+    __sync_add_and_fetch(&export->statistics.calls, 1);
+    if (status != CELIX_SUCCESS) {
+        __sync_add_and_fetch(&export->statistics.failures, 1);
+        celixMetrics_add(export->failuresMetric, 1);
+    }
+    celixMetrics_record(export->callMetric, latency);
+    __sync_add_and_fetch(&export->statistics.totalLatencyNs, latency);
+    maxLatency = export->statistics.maxLatencyNs;
+    while (latency > maxLatency && !__sync_bool_compare_and_swap(&export->statistics.maxLatencyNs, maxLatency, latency)) {
+        maxLatency = export->statistics.maxLatencyNs;
+    }
+    __sync_sub_and_fetch(&export->statistics.inFlight, 1);
+}
+
+celix_status_t exportRegistration_getStatistics(export_registration_pt export, struct export_registration_statistics *statistics) {
+    statistics->calls = __sync_add_and_fetch(&export->statistics.calls, 0);
+    statistics->failures = __sync_add_and_fetch(&export->statistics.failures, 0);
+    statistics->inFlight = __sync_add_and_fetch(&export->statistics.inFlight, 0);
+    statistics->maxInFlight = __sync_add_and_fetch(&export->statistics.maxInFlight, 0);
+    statistics->totalLatencyNs = __sync_add_and_fetch(&export->statistics.totalLatencyNs, 0);
+    statistics->maxLatencyNs = __sync_add_and_fetch(&export->statistics.maxLatencyNs, 0);
+    return CELIX_SUCCESS;
+}
+
 void exportRegistration_destroy(export_registration_pt reg) {
     if (reg != NULL) {
         if (reg->intf != NULL) {
@@ -167,7 +279,10 @@ void exportRegistration_destroy(export_registration_pt reg) {
         if (reg->tracker != NULL) {
             serviceTracker_destroy(reg->tracker);
         }
-        celixThreadMutex_destroy(&reg->mutex);
+        celixThreadRwlock_destroy(&reg->lock);
+        celixThreadMutex_destroy(&reg->callMutex);
+        celixMetrics_release(reg->callMetric);
+        celixMetrics_release(reg->failuresMetric);
 
         free(reg);
     }
@@ -191,17 +306,17 @@ celix_status_t exportRegistration_stop(export_registration_pt reg) {
 }
 
 static void exportRegistration_addServ(export_registration_pt reg, service_reference_pt ref, void *service) {
-    celixThreadMutex_lock(&reg->mutex);
+    celixThreadRwlock_writeLock(&reg->lock);
     reg->service = service;
-    celixThreadMutex_unlock(&reg->mutex);
+    celixThreadRwlock_unlock(&reg->lock);
 }
 
 static void exportRegistration_removeServ(export_registration_pt reg, service_reference_pt ref, void *service) {
-    celixThreadMutex_lock(&reg->mutex);
+    celixThreadRwlock_writeLock(&reg->lock);
     if (reg->service == service) {
         reg->service = NULL;
     }
-    celixThreadMutex_unlock(&reg->mutex);
+    celixThreadRwlock_unlock(&reg->lock);
 }
 
 
@@ -18,45 +18,89 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/time.h>
 #include <jansson.h>
 #include <json_rpc.h>
+#include <binary_rpc.h>
 #include <assert.h>
 #include "version.h"
+#include "celix_trace.h"
 #include "json_serializer.h"
 #include "dyn_interface.h"
 #include "import_registration.h"
 #include "import_registration_dfi.h"
 
+#define DEFAULT_ONEWAY_BATCH_SIZE 64
+#define DEFAULT_ONEWAY_DELAY_MS 10
+
+/* Json invoke requests of oneway calls */
+struct oneway_batch {
+    char **requests;
+    dyn_function_type **funcs;
+    size_t count;
+};
+
 struct import_registration {
     bundle_context_pt context;
     endpoint_description_pt  endpoint; //TODO owner? -> free when destroyed
     const char *classObject; //NOTE owned by endpoint
     version_pt version;
 
-    celix_thread_mutex_t mutex; //protects send & sendhandle
+    celix_thread_rwlock_t lock; //protects send, sendHandle, sendBinary & sendBinaryHandle
     send_func_type send;
     void *sendHandle;
+    send_binary_func_type sendBinary;
+    void *sendBinaryHandle;
 
     service_factory_pt factory;
     service_registration_pt factoryReg;
 
-    hash_map_pt proxies; //key -> bundle, value -> service_proxy
-    celix_thread_mutex_t proxiesMutex; //protects proxies
+    interface_cache_pt interfaceCache;
+    hash_map_pt proxies; //key -> bundle, value -> bundle_proxy
+    hash_map_pt sharedProxies; //key -> interface_cache_entry, value -> service_proxy
+    celix_thread_mutex_t proxiesMutex; //protects proxies and sharedProxies
+
+    size_t onewayBatchSize;
+    unsigned int onewayDelayMs;
+    celix_thread_mutex_t onewayMutex; //protects the fields below, except sending
+    celix_thread_cond_t onewayCond;
+    struct oneway_batch queued;
+    struct timespec onewayDeadline; //when the first queued call should be sent
+    bool onewayRunning;
+    bool onewayThreadStarted;
+    bool onewayFlushing; //a batch is being sent
+    celix_thread_t onewayThread;
+    celix_thread_mutex_t flushMutex; //protects sending, batches are sent one at a time to keep the calls in order
+    struct oneway_batch sending;
 };
 
+/* The proxy service of one descriptor, shared by all bundles with the same descriptor */
 struct service_proxy {
-    dyn_interface_type *intf;
+    interface_cache_entry_pt entry;
     void *service;
-    size_t count;
+    size_t count; //nr of bundles
+};
+
+struct bundle_proxy {
+    struct service_proxy *proxy;
+    size_t count; //nr of gets of the bundle
 };
 
 static celix_status_t importRegistration_createProxy(import_registration_pt import, bundle_pt bundle,
                                               struct service_proxy **proxy);
 static void importRegistration_proxyFunc(void *userData, void *args[], void *returnVal);
-static void importRegistration_destroyProxy(struct service_proxy *proxy);
+static celix_status_t importRegistration_callJson(import_registration_pt import, struct method_entry *entry, void *args[], int *returnVal);
+static celix_status_t importRegistration_callBinary(import_registration_pt import, struct method_entry *entry, void *args[], int *returnVal);
+static celix_status_t importRegistration_queueOneway(import_registration_pt import, struct method_entry *entry, void *args[], int *returnVal);
+static void importRegistration_flushOneway(import_registration_pt import);
+static void *importRegistration_onewayThread(void *data);
+static celix_status_t importRegistration_allocBatch(struct oneway_batch *batch, size_t size);
+static void importRegistration_releaseProxy(import_registration_pt import, struct service_proxy *proxy);
 static void importRegistration_clearProxies(import_registration_pt import);
 
-celix_status_t importRegistration_create(bundle_context_pt context, endpoint_description_pt endpoint, const char *classObject, const char* serviceVersion,
+celix_status_t importRegistration_create(bundle_context_pt context, interface_cache_pt interfaceCache, endpoint_description_pt endpoint, const char *classObject, const char* serviceVersion,
                                          import_registration_pt *out) {
     celix_status_t status = CELIX_SUCCESS;
     import_registration_pt reg = calloc(1, sizeof(*reg));
@@ -69,11 +113,20 @@ celix_status_t importRegistration_create(bundle_context_pt context, endpoint_des
         reg->context = context;
         reg->endpoint = endpoint;
         reg->classObject = classObject;
+        reg->interfaceCache = interfaceCache;
         reg->proxies = hashMap_create(NULL, NULL, NULL, NULL);
+        reg->sharedProxies = hashMap_create(NULL, NULL, NULL, NULL);
 
-        celixThreadMutex_create(&reg->mutex, NULL);
+        celixThreadRwlock_create(&reg->lock, NULL);
         celixThreadMutex_create(&reg->proxiesMutex, NULL);
-        status = version_createVersionFromString((char*)serviceVersion,&(reg->version));
+        celixThreadMutex_create(&reg->onewayMutex, NULL);
+        celixThreadCondition_init(&reg->onewayCond, NULL);
+        celixThreadMutex_create(&reg->flushMutex, NULL);
+        reg->onewayRunning = true;
+        status = importRegistration_setOnewayBatch(reg, DEFAULT_ONEWAY_BATCH_SIZE, DEFAULT_ONEWAY_DELAY_MS);
+        if (status == CELIX_SUCCESS) {
+            status = version_createVersionFromString((char*)serviceVersion,&(reg->version));
+        }
 
         reg->factory->handle = reg;
         reg->factory->getService = (void *)importRegistration_getService;
@@ -97,25 +150,83 @@ celix_status_t importRegistration_create(bundle_context_pt context, endpoint_des
 celix_status_t importRegistration_setSendFn(import_registration_pt reg,
                                             send_func_type send,
                                             void *handle) {
-    celixThreadMutex_lock(&reg->mutex);
+    celixThreadRwlock_writeLock(&reg->lock);
     reg->send = send;
     reg->sendHandle = handle;
-    celixThreadMutex_unlock(&reg->mutex);
+    celixThreadRwlock_unlock(&reg->lock);
 
     return CELIX_SUCCESS;
 }
 
+celix_status_t importRegistration_setSendBinaryFn(import_registration_pt reg,
+                                                  send_binary_func_type send,
+                                                  void *handle) {
+    celixThreadRwlock_writeLock(&reg->lock);
+    reg->sendBinary = send;
+    reg->sendBinaryHandle = handle;
+    celixThreadRwlock_unlock(&reg->lock);
+
+    return CELIX_SUCCESS;
+}
+
+celix_status_t importRegistration_setOnewayBatch(import_registration_pt reg, size_t maxBatchSize, unsigned int maxDelayMs) {
+    celix_status_t status = CELIX_SUCCESS;
+
+    if (maxBatchSize == 0) {
+        status = CELIX_ILLEGAL_ARGUMENT;
+    }
+
+    if (status == CELIX_SUCCESS) {
+        celixThreadMutex_lock(&reg->flushMutex);
+        celixThreadMutex_lock(&reg->onewayMutex);
+        if (reg->queued.count > 0 || reg->onewayThreadStarted) {
+            status = CELIX_ILLEGAL_STATE;
+        }
+        if (status == CELIX_SUCCESS) {
+            status = importRegistration_allocBatch(&reg->queued, maxBatchSize);
+        }
+        if (status == CELIX_SUCCESS) {
+            status = importRegistration_allocBatch(&reg->sending, maxBatchSize);
+        }
+        if (status == CELIX_SUCCESS) {
+            reg->onewayBatchSize = maxBatchSize;
+            reg->onewayDelayMs = maxDelayMs;
+        }
+        celixThreadMutex_unlock(&reg->onewayMutex);
+        celixThreadMutex_unlock(&reg->flushMutex);
+    }
+
+    return status;
+}
+
+static celix_status_t importRegistration_allocBatch(struct oneway_batch *batch, size_t size) {
+    char **requests = realloc(batch->requests, size * sizeof(*requests));
+    if (requests != NULL) {
+        batch->requests = requests;
+    }
+    dyn_function_type **funcs = realloc(batch->funcs, size * sizeof(*funcs));
+    if (funcs != NULL) {
+        batch->funcs = funcs;
+    }
+    return requests != NULL && funcs != NULL ? CELIX_SUCCESS : CELIX_ENOMEM;
+}
+
 static void importRegistration_clearProxies(import_registration_pt import) {
     if (import != NULL) {
         pthread_mutex_lock(&import->proxiesMutex);
         if (import->proxies != NULL) {
-            hash_map_iterator_pt iter = hashMapIterator_create(import->proxies);
+            hashMap_clear(import->proxies, false, true);
+        }
+        if (import->sharedProxies != NULL) {
+            hash_map_iterator_pt iter = hashMapIterator_create(import->sharedProxies);
             while (hashMapIterator_hasNext(iter)) {
-                hash_map_entry_pt  entry = hashMapIterator_nextEntry(iter);
-                struct service_proxy *proxy = hashMapEntry_getValue(entry);
-                importRegistration_destroyProxy(proxy);
+                struct service_proxy *proxy = hashMapIterator_nextValue(iter);
+                interfaceCache_release(import->interfaceCache, proxy->entry);
+                free(proxy->service);
+                free(proxy);
             }
             hashMapIterator_destroy(iter);
+            hashMap_clear(import->sharedProxies, false, false);
         }
         pthread_mutex_unlock(&import->proxiesMutex);
     }
@@ -127,9 +238,20 @@ void importRegistration_destroy(import_registration_pt import) {
             hashMap_destroy(import->proxies, false, false);
             import->proxies = NULL;
         }
+        if (import->sharedProxies != NULL) {
+            hashMap_destroy(import->sharedProxies, false, false);
+            import->sharedProxies = NULL;
+        }
 
-        pthread_mutex_destroy(&import->mutex);
+        celixThreadRwlock_destroy(&import->lock);
         pthread_mutex_destroy(&import->proxiesMutex);
+        celixThreadMutex_destroy(&import->onewayMutex);
+        celixThreadCondition_destroy(&import->onewayCond);
+        celixThreadMutex_destroy(&import->flushMutex);
+        free(import->queued.requests);
+        free(import->queued.funcs);
+        free(import->sending.requests);
+        free(import->sending.funcs);
 
         if (import->factory != NULL) {
             free(import->factory);
@@ -162,6 +284,17 @@ celix_status_t importRegistration_stop(import_registration_pt import) {
         import->factoryReg = NULL;
     }
 
+    // the queued oneway calls are sent before the thread stops, later calls are sent right away
+    celixThreadMutex_lock(&import->onewayMutex);
+    bool started = import->onewayThreadStarted;
+    import->onewayRunning = false;
+    import->onewayThreadStarted = false;
+    celixThreadCondition_broadcast(&import->onewayCond);
+    celixThreadMutex_unlock(&import->onewayMutex);
+    if (started) {
+        celixThread_join(import->onewayThread, NULL);
+    }
+
     importRegistration_clearProxies(import);
 
     return status;
@@ -181,17 +314,24 @@ celix_status_t importRegistration_getService(import_registration_pt import, bund
 
 
     pthread_mutex_lock(&import->proxiesMutex);
-    struct service_proxy *proxy = hashMap_get(import->proxies, bundle);
-    if (proxy == NULL) {
-        status = importRegistration_createProxy(import, bundle, &proxy);
-        if (status == CELIX_SUCCESS) {
-            hashMap_put(import->proxies, bundle, proxy);
+    struct bundle_proxy *bundleProxy = hashMap_get(import->proxies, bundle);
+    if (bundleProxy == NULL) {
+        bundleProxy = calloc(1, sizeof(*bundleProxy));
+        if (bundleProxy == NULL) {
+            status = CELIX_ENOMEM;
+        } else {
+            status = importRegistration_createProxy(import, bundle, &bundleProxy->proxy);
+            if (status == CELIX_SUCCESS) {
+                hashMap_put(import->proxies, bundle, bundleProxy);
+            } else {
+                free(bundleProxy);
+            }
         }
     }
 
     if (status == CELIX_SUCCESS) {
-        proxy->count += 1;
-        *out = proxy->service;
+        bundleProxy->count += 1;
+        *out = bundleProxy->proxy->service;
     }
     pthread_mutex_unlock(&import->proxiesMutex);
 
@@ -200,7 +340,7 @@ celix_status_t importRegistration_getService(import_registration_pt import, bund
 
 static celix_status_t importRegistration_createProxy(import_registration_pt import, bundle_pt bundle, struct service_proxy **out) {
     celix_status_t  status;
-    dyn_interface_type* intf = NULL;
+    interface_cache_entry_pt entry = NULL;
     FILE *descriptor = NULL;
 
     status = dfi_findDescriptor(import->context, bundle, import->classObject, &descriptor);
@@ -211,18 +351,25 @@ static celix_status_t importRegistration_createProxy(import_registration_pt impo
         return CELIX_BUNDLE_EXCEPTION;
     }
 
-    if (status == CELIX_SUCCESS) {
-        int rc = dynInterface_parse(descriptor, &intf);
-        fclose(descriptor);
-        if (rc != 0 || intf==NULL) {
-            return CELIX_BUNDLE_EXCEPTION;
-        }
+    // bundles with the same descriptor share the parsed interface, its closures and the proxy service
+    status = interfaceCache_get(import->interfaceCache, descriptor, importRegistration_proxyFunc, &entry);
+    fclose(descriptor);
+    if (status != CELIX_SUCCESS) {
+        return CELIX_BUNDLE_EXCEPTION;
+    }
+
+    struct service_proxy *proxy = hashMap_get(import->sharedProxies, entry);
+    if (proxy != NULL) {
+        interfaceCache_release(import->interfaceCache, entry);
+        proxy->count += 1;
+        *out = proxy;
+        return CELIX_SUCCESS;
     }
 
     /* Check if the imported service version is compatible with the one in the consumer descriptor */
     version_pt consumerVersion = NULL;
     bool isCompatible = false;
-    dynInterface_getVersion(intf,&consumerVersion);
+    dynInterface_getVersion(interfaceCacheEntry_getInterface(entry),&consumerVersion);
     version_isCompatible(consumerVersion,import->version,&isCompatible);
 
     if(!isCompatible){
@@ -231,13 +378,11 @@ static celix_status_t importRegistration_createProxy(import_registration_pt impo
     	version_toString(consumerVersion,&cVerString);
     	version_toString(import->version,&pVerString);
     	printf("Service version mismatch: consumer has %s, provider has %s. NOT creating proxy.\n",cVerString,pVerString);
-    	dynInterface_destroy(intf);
     	free(cVerString);
     	free(pVerString);
     	status = CELIX_SERVICE_EXCEPTION;
     }
 
-    struct service_proxy *proxy = NULL;
     if (status == CELIX_SUCCESS) {
         proxy = calloc(1, sizeof(*proxy));
         if (proxy == NULL) {
@@ -246,44 +391,30 @@ static celix_status_t importRegistration_createProxy(import_registration_pt impo
     }
 
     if (status == CELIX_SUCCESS) {
-    	proxy->intf = intf;
-        size_t count = dynInterface_nrOfMethods(proxy->intf);
+        void (**methods)(void) = NULL;
+        int count = interfaceCacheEntry_getMethods(entry, &methods);
+        proxy->entry = entry;
         proxy->service = calloc(1 + count, sizeof(void *));
         if (proxy->service == NULL) {
             status = CELIX_ENOMEM;
+        } else {
+            // the closures are shared, the import is passed to them as the service handle
+            void **serv = proxy->service;
+            serv[0] = import;
+            memcpy(&serv[1], methods, count * sizeof(void *));
         }
     }
 
     if (status == CELIX_SUCCESS) {
-        void **serv = proxy->service;
-        serv[0] = import;
-
-        struct methods_head *list = NULL;
-        dynInterface_methods(proxy->intf, &list);
-        struct method_entry *entry = NULL;
-        void (*fn)(void) = NULL;
-        int index = 0;
-        TAILQ_FOREACH(entry, list, entries) {
-            int rc = dynFunction_createClosure(entry->dynFunc, importRegistration_proxyFunc, entry, &fn);
-            serv[index + 1] = fn;
-            index += 1;
-
-            if (rc != 0) {
-                status = CELIX_BUNDLE_EXCEPTION;
-                break;
-            }
-        }
-    }
-
-    if (status == CELIX_SUCCESS) {
+        proxy->count = 1;
+        hashMap_put(import->sharedProxies, entry, proxy);
         *out = proxy;
-    } else if (proxy != NULL) {
-        if (proxy->intf != NULL) {
-            dynInterface_destroy(proxy->intf);
-            proxy->intf = NULL;
+    } else {
+        interfaceCache_release(import->interfaceCache, entry);
+        if (proxy != NULL) {
+            free(proxy->service);
+            free(proxy);
         }
-        free(proxy->service);
-        free(proxy);
     }
 
     return status;
@@ -293,28 +424,183 @@ static void importRegistration_proxyFunc(void *userData, void *args[], void *ret
     int  status = CELIX_SUCCESS;
     struct method_entry *entry = userData;
     import_registration_pt import = *((void **)args[0]);
+    celix_trace_span_t span;
 
-    if (import == NULL || import->send == NULL) {
+    if (import == NULL) {
         status = CELIX_ILLEGAL_ARGUMENT;
     }
 
+    // the request carries the context of this span, the remote invoke becomes its child
+    celixTrace_beginSpan("rsa.call", entry->id, &span);
+
+    if (status == CELIX_SUCCESS && entry->oneway) {
+        status = importRegistration_queueOneway(import, entry, args, (int *) returnVal);
+    } else if (status == CELIX_SUCCESS) {
+        // queued oneway calls are sent first, so the remote service gets the calls in order
+        celixThreadMutex_lock(&import->onewayMutex);
+        bool pending = import->queued.count > 0 || import->onewayFlushing;
+        celixThreadMutex_unlock(&import->onewayMutex);
+        if (pending) {
+            importRegistration_flushOneway(import);
+        }
+
+        // a read lock, so calls of different threads are sent concurrently
+        celixThreadRwlock_readLock(&import->lock);
+        status = CELIX_ILLEGAL_STATE;
+        if (import->sendBinary != NULL) {
+            status = importRegistration_callBinary(import, entry, args, (int *) returnVal);
+        }
+        if (status == CELIX_ILLEGAL_STATE && import->send != NULL) {
+            //the binary transport is not available, use json over http
+            status = importRegistration_callJson(import, entry, args, (int *) returnVal);
+        }
+        celixThreadRwlock_unlock(&import->lock);
+    }
+    celixTrace_endSpan(&span);
+
+    if (status != CELIX_SUCCESS) {
+        //TODO log error
+    }
+}
+
+/* The call succeeds as soon as it is queued, remote errors are only logged */
+static celix_status_t importRegistration_queueOneway(import_registration_pt import, struct method_entry *entry, void *args[], int *returnVal) {
+    celix_status_t status = CELIX_SUCCESS;
+    char *request = NULL;
+    bool flush = false;
+
+    if (jsonRpc_prepareInvokeRequest(entry->dynFunc, entry->id, args, &request) != 0) {
+        status = CELIX_ILLEGAL_ARGUMENT;
+    }
 
-    char *invokeRequest = NULL;
     if (status == CELIX_SUCCESS) {
-        status = jsonRpc_prepareInvokeRequest(entry->dynFunc, entry->id, args, &invokeRequest);
-        //printf("Need to send following json '%s'\n", invokeRequest);
+        celixThreadMutex_lock(&import->onewayMutex);
+        while (import->queued.count == import->onewayBatchSize) {
+            // the caller that filled the batch is sending it
+            celixThreadMutex_unlock(&import->onewayMutex);
+            importRegistration_flushOneway(import);
+            celixThreadMutex_lock(&import->onewayMutex);
+        }
+
+        import->queued.requests[import->queued.count] = request;
+        import->queued.funcs[import->queued.count] = entry->dynFunc;
+        import->queued.count += 1;
+
+        if (import->queued.count == 1 && import->onewayRunning) {
+            struct timeval now;
+            gettimeofday(&now, NULL);
+            unsigned long long nsec = now.tv_usec * 1000ULL + import->onewayDelayMs * 1000000ULL;
+            import->onewayDeadline.tv_sec = now.tv_sec + nsec / 1000000000ULL;
+            import->onewayDeadline.tv_nsec = nsec % 1000000000ULL;
+            if (!import->onewayThreadStarted) {
+                import->onewayThreadStarted = celixThread_create(&import->onewayThread, NULL, importRegistration_onewayThread, import) == CELIX_SUCCESS;
+            }
+            celixThreadCondition_signal(&import->onewayCond);
+        }
+        flush = import->queued.count == import->onewayBatchSize || !import->onewayThreadStarted;
+        celixThreadMutex_unlock(&import->onewayMutex);
+
+        *returnVal = 0;
+    }
+
+    if (flush) {
+        importRegistration_flushOneway(import);
+    }
+
+    return status;
+}
+
+/* Sends the queued oneway calls, waits for batches sent by other threads */
+static void importRegistration_flushOneway(import_registration_pt import) {
+    struct oneway_batch *batch = &import->sending;
+    char *request = NULL;
+    char *reply = NULL;
+    int rc = CELIX_ILLEGAL_STATE;
+    size_t failures = 0;
+    size_t i;
+
+    celixThreadMutex_lock(&import->flushMutex);
+
+    celixThreadMutex_lock(&import->onewayMutex);
+    struct oneway_batch tmp = import->queued;
+    import->queued = import->sending;
+    import->sending = tmp;
+    import->onewayFlushing = batch->count > 0;
+    celixThreadMutex_unlock(&import->onewayMutex);
+
+    if (batch->count > 0 && jsonRpc_prepareBatchRequest(batch->requests, batch->count, &request) == 0) {
+        celixThreadRwlock_readLock(&import->lock);
+        if (import->send != NULL) {
+            import->send(import->sendHandle, import->endpoint, request, &reply, &rc);
+        }
+        celixThreadRwlock_unlock(&import->lock);
+    }
+
+    if (batch->count > 0) {
+        int *callStatus = calloc(batch->count, sizeof(*callStatus));
+        void ***args = calloc(batch->count, sizeof(*args)); //no outputs
+        if (rc != 0 || callStatus == NULL || args == NULL
+                || jsonRpc_handleBatchReply(batch->funcs, reply, args, callStatus, batch->count) != 0) {
+            failures = batch->count;
+        } else {
+            for (i = 0; i < batch->count; i += 1) {
+                failures += callStatus[i] != 0 ? 1 : 0;
+            }
+        }
+        free(callStatus);
+        free(args);
+
+        if (failures > 0) {
+            fprintf(stderr, "RSA_DFI: %zu of %zu oneway calls to '%s' failed\n", failures, batch->count, import->classObject);
+        }
     }
 
+    for (i = 0; i < batch->count; i += 1) {
+        free(batch->requests[i]);
+    }
+    batch->count = 0;
+    free(request);
+    free(reply);
+
+    celixThreadMutex_lock(&import->onewayMutex);
+    import->onewayFlushing = false;
+    celixThreadMutex_unlock(&import->onewayMutex);
+
+    celixThreadMutex_unlock(&import->flushMutex);
+}
+
+static void *importRegistration_onewayThread(void *data) {
+    import_registration_pt import = data;
+
+    celixThreadMutex_lock(&import->onewayMutex);
+    while (import->onewayRunning || import->queued.count > 0) {
+        if (import->queued.count == 0) {
+            celixThreadCondition_wait(&import->onewayCond, &import->onewayMutex);
+        } else if (import->onewayRunning && pthread_cond_timedwait(&import->onewayCond, &import->onewayMutex, &import->onewayDeadline) != ETIMEDOUT) {
+            //woken up before the deadline, check again
+        } else {
+            celixThreadMutex_unlock(&import->onewayMutex);
+            importRegistration_flushOneway(import);
+            celixThreadMutex_lock(&import->onewayMutex);
+        }
+    }
+    celixThreadMutex_unlock(&import->onewayMutex);
+
+    return NULL;
+}
+
+static celix_status_t importRegistration_callJson(import_registration_pt import, struct method_entry *entry, void *args[], int *returnVal) {
+    int status = CELIX_SUCCESS;
+    char *invokeRequest = NULL;
+
+    status = jsonRpc_prepareInvokeRequest(entry->dynFunc, entry->id, args, &invokeRequest);
+    //printf("Need to send following json '%s'\n", invokeRequest);
 
     if (status == CELIX_SUCCESS) {
         char *reply = NULL;
         int rc = 0;
         //printf("sending request\n");
-        celixThreadMutex_lock(&import->mutex);
-        if (import->send != NULL) {
-            import->send(import->sendHandle, import->endpoint, invokeRequest, &reply, &rc);
-        }
-        celixThreadMutex_unlock(&import->mutex);
+        import->send(import->sendHandle, import->endpoint, invokeRequest, &reply, &rc);
         //printf("request sended. got reply '%s' with status %i\n", reply, rc);
 
         if (rc == 0) {
@@ -322,15 +608,49 @@ static void importRegistration_proxyFunc(void *userData, void *args[], void *ret
             status = jsonRpc_handleReply(entry->dynFunc, reply, args);
         }
 
-        *(int *) returnVal = rc;
+        *returnVal = rc;
 
         free(invokeRequest); //Allocated by json_dumps in jsonRpc_prepareInvokeRequest
         free(reply); //Allocated by json_dumps in remoteServiceAdmin_send through curl call
     }
 
-    if (status != CELIX_SUCCESS) {
-        //TODO log error
+    return status;
+}
+
+/* Returns CELIX_ILLEGAL_STATE when the request is not sent */
+static celix_status_t importRegistration_callBinary(import_registration_pt import, struct method_entry *entry, void *args[], int *returnVal) {
+    int status = CELIX_SUCCESS;
+    void *request = NULL;
+    size_t requestSize = 0;
+    void *reply = NULL;
+    size_t replySize = 0;
+    int rc = 0;
+
+    if (binaryRpc_prepareInvokeRequest(entry->dynFunc, entry->id, args, &request, &requestSize) != 0) {
+        status = CELIX_ILLEGAL_ARGUMENT;
     }
+
+    if (status == CELIX_SUCCESS) {
+        status = import->sendBinary(import->sendBinaryHandle, import->endpoint, request, requestSize, &reply, &replySize, &rc);
+    }
+
+    if (status == CELIX_SUCCESS && rc == 0) {
+        int callStatus = 0;
+        if (binaryRpc_handleReply(entry->dynFunc, reply, replySize, args, &callStatus) == 0) {
+            rc = callStatus;
+        } else {
+            rc = CELIX_ILLEGAL_ARGUMENT;
+        }
+    }
+
+    if (status == CELIX_SUCCESS) {
+        *returnVal = rc;
+    }
+
+    free(request);
+    free(reply);
+
+    return status;
 }
 
 celix_status_t importRegistration_ungetService(import_registration_pt import, bundle_pt bundle, service_registration_pt registration, void **out) {
@@ -341,17 +661,18 @@ celix_status_t importRegistration_ungetService(import_registration_pt import, bu
 
     pthread_mutex_lock(&import->proxiesMutex);
 
-    struct service_proxy *proxy = hashMap_get(import->proxies, bundle);
-    if (proxy != NULL) {
-        if (*out == proxy->service) {
-            proxy->count -= 1;
+    struct bundle_proxy *bundleProxy = hashMap_get(import->proxies, bundle);
+    if (bundleProxy != NULL) {
+        if (*out == bundleProxy->proxy->service) {
+            bundleProxy->count -= 1;
         } else {
             status = CELIX_ILLEGAL_ARGUMENT;
         }
 
-        if (proxy->count == 0) {
+        if (bundleProxy->count == 0) {
             hashMap_remove(import->proxies, bundle);
-            importRegistration_destroyProxy(proxy);
+            importRegistration_releaseProxy(import, bundleProxy->proxy);
+            free(bundleProxy);
         }
     }
 
@@ -360,14 +681,12 @@ celix_status_t importRegistration_ungetService(import_registration_pt import, bu
     return status;
 }
 
-static void importRegistration_destroyProxy(struct service_proxy *proxy) {
-    if (proxy != NULL) {
-        if (proxy->intf != NULL) {
-            dynInterface_destroy(proxy->intf);
-        }
-        if (proxy->service != NULL) {
-            free(proxy->service);
-        }
+static void importRegistration_releaseProxy(import_registration_pt import, struct service_proxy *proxy) {
+    proxy->count -= 1;
+    if (proxy->count == 0) {
+        hashMap_remove(import->sharedProxies, proxy->entry);
+        interfaceCache_release(import->interfaceCache, proxy->entry);
+        free(proxy->service);
         free(proxy);
     }
 }
@@ -0,0 +1,223 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+/*
+ * interface_cache.c
+ *
+ *  \author    	<a href="mailto:dev@celix.apache.org">Apache Celix Project Team</a>
+ *  \copyright	Apache License, Version 2.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "celix_threads.h"
+#include "hash_map.h"
+#include "utils.h"
+#include "interface_cache.h"
+
+struct interface_cache {
+    celix_thread_mutex_t mutex; //protects entries and the reference counts
+    hash_map_pt entries; //key -> descriptor content, value -> interface_cache_entry
+};
+
+struct interface_cache_entry {
+    char *descriptor; //owner, also the key in the cache
+    dyn_interface_type *intf; //owner
+    void (**methods)(void);
+    int nrOfMethods;
+    size_t count;
+};
+
+static celix_status_t interfaceCache_read(FILE *descriptor, char **out);
+static celix_status_t interfaceCache_createEntry(char *descriptor, interface_cache_bind_fpt bind, interface_cache_entry_pt *out);
+static void interfaceCache_destroyEntry(interface_cache_entry_pt entry);
+
+celix_status_t interfaceCache_create(interface_cache_pt *out) {
+    celix_status_t status = CELIX_SUCCESS;
+    interface_cache_pt cache = calloc(1, sizeof(*cache));
+
+    if (cache == NULL) {
+        status = CELIX_ENOMEM;
+    } else {
+        celixThreadMutex_create(&cache->mutex, NULL);
+        cache->entries = hashMap_create(utils_stringHash, NULL, utils_stringEquals, NULL);
+        *out = cache;
+    }
+
+    return status;
+}
+
+void interfaceCache_destroy(interface_cache_pt cache) {
+    if (cache != NULL) {
+        hash_map_iterator_pt iter = hashMapIterator_create(cache->entries);
+        while (hashMapIterator_hasNext(iter)) {
+            interfaceCache_destroyEntry(hashMapIterator_nextValue(iter));
+        }
+        hashMapIterator_destroy(iter);
+        hashMap_destroy(cache->entries, false, false);
+        celixThreadMutex_destroy(&cache->mutex);
+        free(cache);
+    }
+}
+
+celix_status_t interfaceCache_get(interface_cache_pt cache, FILE *descriptor, interface_cache_bind_fpt bind, interface_cache_entry_pt *out) {
+    celix_status_t status;
+    interface_cache_entry_pt entry = NULL;
+    char *content = NULL;
+
+    status = interfaceCache_read(descriptor, &content);
+
+    if (status == CELIX_SUCCESS) {
+        celixThreadMutex_lock(&cache->mutex);
+        entry = hashMap_get(cache->entries, content);
+        if (entry != NULL) {
+            free(content);
+        } else {
+            status = interfaceCache_createEntry(content, bind, &entry);
+            if (status == CELIX_SUCCESS) {
+                hashMap_put(cache->entries, entry->descriptor, entry);
+            }
+        }
+        if (status == CELIX_SUCCESS) {
+            entry->count += 1;
+            *out = entry;
+        }
+        celixThreadMutex_unlock(&cache->mutex);
+    }
+
+    return status;
+}
+
+void interfaceCache_release(interface_cache_pt cache, interface_cache_entry_pt entry) {
+    if (entry != NULL) {
+        celixThreadMutex_lock(&cache->mutex);
+        entry->count -= 1;
+        if (entry->count == 0) {
+            hashMap_remove(cache->entries, entry->descriptor);
+            interfaceCache_destroyEntry(entry);
+        }
+        celixThreadMutex_unlock(&cache->mutex);
+    }
+}
+
+dyn_interface_type *interfaceCacheEntry_getInterface(interface_cache_entry_pt entry) {
+    return entry->intf;
+}
+
+int interfaceCacheEntry_getMethods(interface_cache_entry_pt entry, void (***methods)(void)) {
+    *methods = entry->methods;
+    return entry->nrOfMethods;
+}
+
+static celix_status_t interfaceCache_read(FILE *descriptor, char **out) {
+    celix_status_t status = CELIX_SUCCESS;
+    size_t size = 0;
+    size_t capacity = 1024;
+    size_t read;
+    char *content = malloc(capacity);
+
+    while (content != NULL && (read = fread(content + size, 1, capacity - size - 1, descriptor)) > 0) {
+        size += read;
+        if (capacity - size == 1) {
+            char *bigger = realloc(content, capacity * 2);
+            if (bigger == NULL) {
+                free(content);
+            }
+            content = bigger;
+            capacity *= 2;
+        }
+    }
+
+    if (content == NULL) {
+        status = CELIX_ENOMEM;
+    } else if (ferror(descriptor)) {
+        free(content);
+        status = CELIX_FILE_IO_EXCEPTION;
+    } else {
+        content[size] = '\0';
+        *out = content;
+    }
+
+    return status;
+}
+
+static celix_status_t interfaceCache_createEntry(char *descriptor, interface_cache_bind_fpt bind, interface_cache_entry_pt *out) {
+    celix_status_t status = CELIX_SUCCESS;
+    interface_cache_entry_pt entry = calloc(1, sizeof(*entry));
+
+    if (entry == NULL) {
+        free(descriptor);
+        return CELIX_ENOMEM;
+    }
+    entry->descriptor = descriptor;
+
+    FILE *stream = fmemopen(descriptor, strlen(descriptor), "r");
+    if (stream == NULL) {
+        status = CELIX_ENOMEM;
+    } else {
+        int rc = dynInterface_parse(stream, &entry->intf);
+        fclose(stream);
+        if (rc != 0 || entry->intf == NULL) {
+            status = CELIX_BUNDLE_EXCEPTION;
+        }
+    }
+
+    if (status == CELIX_SUCCESS) {
+        entry->nrOfMethods = dynInterface_nrOfMethods(entry->intf);
+        entry->methods = calloc(entry->nrOfMethods + 1, sizeof(*entry->methods));
+        if (entry->methods == NULL) {
+            status = CELIX_ENOMEM;
+        }
+    }
+
+    if (status == CELIX_SUCCESS) {
+        struct methods_head *list = NULL;
+        dynInterface_methods(entry->intf, &list);
+        struct method_entry *method = NULL;
+        int index = 0;
+        TAILQ_FOREACH(method, list, entries) {
+            int rc = dynFunction_createClosure(method->dynFunc, bind, method, &entry->methods[index]);
+            index += 1;
+
+            if (rc != 0) {
+                status = CELIX_BUNDLE_EXCEPTION;
+                break;
+            }
+        }
+    }
+
+    if (status == CELIX_SUCCESS) {
+        *out = entry;
+    } else {
+        interfaceCache_destroyEntry(entry);
+    }
+
+    return status;
+}
+
+static void interfaceCache_destroyEntry(interface_cache_entry_pt entry) {
+    if (entry != NULL) {
+        if (entry->intf != NULL) {
+            dynInterface_destroy(entry->intf);
+        }
+        free(entry->methods);
+        free(entry->descriptor);
+        free(entry);
+    }
+}
@@ -39,12 +39,16 @@
 #include "celix_threads.h"
 #include "hash_map.h"
 #include "array_list.h"
+#include "utils.h"
 
 #include "import_registration_dfi.h"
 #include "export_registration_dfi.h"
 #include "remote_service_admin_dfi.h"
 #include "dyn_interface.h"
 #include "json_rpc.h"
+#include "binary_serializer.h"
+#include "binary_rpc.h"
+#include "binary_transport.h"
 
 #include "remote_constants.h"
 #include "constants.h"
@@ -67,21 +71,28 @@ struct remote_service_admin {
     bundle_context_pt context;
     log_helper_pt loghelper;
 
-    celix_thread_mutex_t exportedServicesLock;
+    celix_thread_rwlock_t exportedServicesLock;
     hash_map_pt exportedServices;
 
     celix_thread_mutex_t importedServicesLock;
     array_list_pt importedServices;
 
+    interface_cache_pt interfaceCache; //shared by the proxies of all imports
+
     char *port;
     char *ip;
 
     struct mg_context *ctx;
-};
 
-struct post {
-    const char *readptr;
-    int size;
+    bool binaryEnabled;
+    binary_server_pt binaryServer;
+    char *binaryUrl; //advertised in the endpoints, NULL when the binary server is not running
+
+    celix_thread_mutex_t binaryClientsLock;
+    hash_map_pt binaryClients; //key -> url, value -> binary_client, one connection per exporting framework
+
+    size_t onewayBatchSize;
+    unsigned int onewayDelayMs;
 };
 
 struct get {
@@ -104,17 +115,27 @@ static const char *no_content_response_headers =
 // TODO do we need to specify a non-Amdatu specific configuration type?!
 static const char * const CONFIGURATION_TYPE = "org.amdatu.remote.admin.http";
 static const char * const ENDPOINT_URL = "org.amdatu.remote.admin.http.url";
+// importers which do not know this property keep using json over http
+static const char * const ENDPOINT_BINARY_URL = "org.apache.celix.remote.admin.dfi.binary.url";
 
 static const char *DEFAULT_PORT = "8888";
 static const char *DEFAULT_IP = "127.0.0.1";
+static const char *DEFAULT_NUM_THREADS = "5";
+static const char *DEFAULT_BINARY_PORT = "0"; //any free port
+static const size_t DEFAULT_ONEWAY_BATCH_SIZE = 64;
+static const unsigned int DEFAULT_ONEWAY_DELAY_MS = 10;
 
 static const unsigned int DEFAULT_TIMEOUT = 0;
 
 static int remoteServiceAdmin_callback(struct mg_connection *conn);
+static celix_status_t remoteServiceAdmin_callBinary(void *handle, unsigned long serviceId, const void *request, size_t requestSize, void **reply, size_t *replySize);
+static export_registration_pt remoteServiceAdmin_findExport(remote_service_admin_pt rsa, unsigned long serviceId);
+static void remoteServiceAdmin_startBinaryServer(remote_service_admin_pt admin, const char *numThreads);
 static celix_status_t remoteServiceAdmin_createEndpointDescription(remote_service_admin_pt admin, service_reference_pt reference, properties_pt props, char *interface, endpoint_description_pt *description);
 static celix_status_t remoteServiceAdmin_send(void *handle, endpoint_description_pt endpointDescription, char *request, char **reply, int* replyStatus);
+static celix_status_t remoteServiceAdmin_sendBinary(void *handle, endpoint_description_pt endpointDescription, const void *request, size_t requestSize, void **reply, size_t *replySize, int *replyStatus);
+static int remoteServiceAdmin_getTimeout(remote_service_admin_pt rsa, endpoint_description_pt endpointDescription);
 static celix_status_t remoteServiceAdmin_getIpAdress(char* interface, char** ip);
-static size_t remoteServiceAdmin_readCallback(void *ptr, size_t size, size_t nmemb, void *userp);
 static size_t remoteServiceAdmin_write(void *contents, size_t size, size_t nmemb, void *userp);
 static void remoteServiceAdmin_log(remote_service_admin_pt admin, int level, const char *file, int line, const char *msg, ...);
 
@@ -129,13 +150,20 @@ celix_status_t remoteServiceAdmin_create(bundle_context_pt context, remote_servi
         unsigned int port_counter = 0;
         const char *port = NULL;
         const char *ip = NULL;
+        const char *numThreads = NULL;
+        const char *binary = NULL;
+        const char *onewayBatchSize = NULL;
+        const char *onewayDelay = NULL;
         char *detectedIp = NULL;
         (*admin)->context = context;
         (*admin)->exportedServices = hashMap_create(NULL, NULL, NULL, NULL);
          arrayList_create(&(*admin)->importedServices);
 
-        celixThreadMutex_create(&(*admin)->exportedServicesLock, NULL);
+        celixThreadRwlock_create(&(*admin)->exportedServicesLock, NULL);
         celixThreadMutex_create(&(*admin)->importedServicesLock, NULL);
+        celixThreadMutex_create(&(*admin)->binaryClientsLock, NULL);
+        (*admin)->binaryClients = hashMap_create(utils_stringHash, NULL, utils_stringEquals, NULL);
+        interfaceCache_create(&(*admin)->interfaceCache);
 
         if (logHelper_create(context, &(*admin)->loghelper) == CELIX_SUCCESS) {
             logHelper_start((*admin)->loghelper);
@@ -145,6 +173,8 @@ celix_status_t remoteServiceAdmin_create(bundle_context_pt context, remote_servi
             dynInterface_logSetup((void *)remoteServiceAdmin_log, *admin, 1);
             jsonSerializer_logSetup((void *)remoteServiceAdmin_log, *admin, 1);
             jsonRpc_logSetup((void *)remoteServiceAdmin_log, *admin, 1);
+            binarySerializer_logSetup((void *)remoteServiceAdmin_log, *admin, 1);
+            binaryRpc_logSetup((void *)remoteServiceAdmin_log, *admin, 1);
         }
 
         bundleContext_getProperty(context, "RSA_PORT", &port);
@@ -152,6 +182,12 @@ celix_status_t remoteServiceAdmin_create(bundle_context_pt context, remote_servi
             port = (char *)DEFAULT_PORT;
         }
 
+        // every webserver thread handles one remote call at a time
+        bundleContext_getProperty(context, "RSA_NUM_THREADS", &numThreads);
+        if (numThreads == NULL || atoi(numThreads) <= 0) {
+            numThreads = DEFAULT_NUM_THREADS;
+        }
+
         bundleContext_getProperty(context, "RSA_IP", &ip);
         if (ip == NULL) {
             const char *interface = NULL;
@@ -190,12 +226,12 @@ celix_status_t remoteServiceAdmin_create(bundle_context_pt context, remote_servi
 
         do {
 
-            const char *options[] = { "listening_ports", port, "num_threads", "5", NULL};
+            const char *options[] = { "listening_ports", port, "num_threads", numThreads, NULL};
 
             (*admin)->ctx = mg_start(&callbacks, (*admin), options);
 
             if ((*admin)->ctx != NULL) {
-                logHelper_log((*admin)->loghelper, OSGI_LOGSERVICE_INFO, "RSA: Start webserver: %s", port);
+                logHelper_log((*admin)->loghelper, OSGI_LOGSERVICE_INFO, "RSA: Start webserver: %s with %s threads", port, numThreads);
                 (*admin)->port = strdup(port);
 
             }
@@ -216,6 +252,18 @@ celix_status_t remoteServiceAdmin_create(bundle_context_pt context, remote_servi
             }
         } while(((*admin)->ctx == NULL) && (port_counter < MAX_NUMBER_OF_RESTARTS));
 
+        // binary calls are enabled unless RSA_BINARY is false, for exports as well as imports
+        bundleContext_getProperty(context, "RSA_BINARY", &binary);
+        (*admin)->binaryEnabled = binary == NULL || strcmp(binary, "false") != 0;
+        if ((*admin)->binaryEnabled) {
+            remoteServiceAdmin_startBinaryServer(*admin, numThreads);
+        }
+
+        // calls of oneway methods of imported services are sent in batches
+        bundleContext_getProperty(context, "RSA_ONEWAY_BATCH_SIZE", &onewayBatchSize);
+        (*admin)->onewayBatchSize = onewayBatchSize != NULL && atoi(onewayBatchSize) > 0 ? (size_t) atoi(onewayBatchSize) : DEFAULT_ONEWAY_BATCH_SIZE;
+        bundleContext_getProperty(context, "RSA_ONEWAY_DELAY_MS", &onewayDelay);
+        (*admin)->onewayDelayMs = onewayDelay != NULL && atoi(onewayDelay) >= 0 ? (unsigned int) atoi(onewayDelay) : DEFAULT_ONEWAY_DELAY_MS;
     }
 
     return status;
@@ -228,6 +276,10 @@ celix_status_t remoteServiceAdmin_destroy(remote_service_admin_pt *admin)
 
     free((*admin)->ip);
     free((*admin)->port);
+    free((*admin)->binaryUrl);
+    hashMap_destroy((*admin)->binaryClients, false, false);
+    celixThreadMutex_destroy(&(*admin)->binaryClientsLock);
+    interfaceCache_destroy((*admin)->interfaceCache);
     free(*admin);
 
     //TODO destroy exports/imports
@@ -241,7 +293,12 @@ celix_status_t remoteServiceAdmin_destroy(remote_service_admin_pt *admin)
 celix_status_t remoteServiceAdmin_stop(remote_service_admin_pt admin) {
     celix_status_t status = CELIX_SUCCESS;
 
-    celixThreadMutex_lock(&admin->exportedServicesLock);
+    if (admin->binaryServer != NULL) {
+        binaryServer_destroy(admin->binaryServer);
+        admin->binaryServer = NULL;
+    }
+
+    celixThreadRwlock_writeLock(&admin->exportedServicesLock);
 
     hash_map_iterator_pt iter = hashMapIterator_create(admin->exportedServices);
     while (hashMapIterator_hasNext(iter)) {
@@ -257,7 +314,7 @@ celix_status_t remoteServiceAdmin_stop(remote_service_admin_pt admin) {
         arrayList_destroy(exports);
     }
     hashMapIterator_destroy(iter);
-    celixThreadMutex_unlock(&admin->exportedServicesLock);
+    celixThreadRwlock_unlock(&admin->exportedServicesLock);
 
     celixThreadMutex_lock(&admin->importedServicesLock);
     int i;
@@ -271,6 +328,17 @@ celix_status_t remoteServiceAdmin_stop(remote_service_admin_pt admin) {
     }
     celixThreadMutex_unlock(&admin->importedServicesLock);
 
+    celixThreadMutex_lock(&admin->binaryClientsLock);
+    hash_map_iterator_pt clientIter = hashMapIterator_create(admin->binaryClients);
+    while (hashMapIterator_hasNext(clientIter)) {
+        hash_map_entry_pt entry = hashMapIterator_nextEntry(clientIter);
+        free(hashMapEntry_getKey(entry));
+        binaryClient_destroy(hashMapEntry_getValue(entry));
+    }
+    hashMapIterator_destroy(clientIter);
+    hashMap_clear(admin->binaryClients, false, false);
+    celixThreadMutex_unlock(&admin->binaryClientsLock);
+
     if (admin->ctx != NULL) {
         logHelper_log(admin->loghelper, OSGI_LOGSERVICE_INFO, "RSA: Stopping webserver...");
         mg_stop(admin->ctx);
@@ -315,30 +383,10 @@ static int remoteServiceAdmin_callback(struct mg_connection *conn) {
             service[pos] = '\0';
             unsigned long serviceId = strtoul(service,NULL,10);
 
-            celixThreadMutex_lock(&rsa->exportedServicesLock);
-
-            //find endpoint
-            export_registration_pt export = NULL;
-            hash_map_iterator_pt iter = hashMapIterator_create(rsa->exportedServices);
-            while (hashMapIterator_hasNext(iter)) {
-                hash_map_entry_pt entry = hashMapIterator_nextEntry(iter);
-                array_list_pt exports = hashMapEntry_getValue(entry);
-                int expIt = 0;
-                for (expIt = 0; expIt < arrayList_size(exports); expIt++) {
-                    export_registration_pt check = arrayList_get(exports, expIt);
-                    export_reference_pt  ref = NULL;
-                    exportRegistration_getExportReference(check, &ref);
-                    endpoint_description_pt  checkEndpoint = NULL;
-                    exportReference_getExportedEndpoint(ref, &checkEndpoint);
-                    if (serviceId == checkEndpoint->serviceId) {
-                        export = check;
-                        free(ref);
-                        break;
-                    }
-                    free(ref);
-                }
-            }
-            hashMapIterator_destroy(iter);
+            // a read lock, so calls run concurrently while removing an export waits for the calls to finish
+            celixThreadRwlock_readLock(&rsa->exportedServicesLock);
+
+            export_registration_pt export = remoteServiceAdmin_findExport(rsa, serviceId);
 
             if (export != NULL) {
 
@@ -369,7 +417,7 @@ static int remoteServiceAdmin_callback(struct mg_connection *conn) {
                 RSA_LOG_WARNING(rsa, "NO export registration found for service id %lu", serviceId);
             }
 
-            celixThreadMutex_unlock(&rsa->exportedServicesLock);
+            celixThreadRwlock_unlock(&rsa->exportedServicesLock);
 
         }
     }
@@ -377,6 +425,83 @@ static int remoteServiceAdmin_callback(struct mg_connection *conn) {
     return result;
 }
 
+/* Called with the exportedServicesLock held */
+static export_registration_pt remoteServiceAdmin_findExport(remote_service_admin_pt rsa, unsigned long serviceId) {
+    export_registration_pt export = NULL;
+    hash_map_iterator_pt iter = hashMapIterator_create(rsa->exportedServices);
+    while (hashMapIterator_hasNext(iter) && export == NULL) {
+        hash_map_entry_pt entry = hashMapIterator_nextEntry(iter);
+        array_list_pt exports = hashMapEntry_getValue(entry);
+        int expIt = 0;
+        for (expIt = 0; expIt < arrayList_size(exports); expIt++) {
+            export_registration_pt check = arrayList_get(exports, expIt);
+            export_reference_pt  ref = NULL;
+            exportRegistration_getExportReference(check, &ref);
+            endpoint_description_pt  checkEndpoint = NULL;
+            exportReference_getExportedEndpoint(ref, &checkEndpoint);
+            if (serviceId == checkEndpoint->serviceId) {
+                export = check;
+                free(ref);
+                break;
+            }
+            free(ref);
+        }
+    }
+    hashMapIterator_destroy(iter);
+
+    return export;
+}
+
+static celix_status_t remoteServiceAdmin_callBinary(void *handle, unsigned long serviceId, const void *request, size_t requestSize, void **reply, size_t *replySize) {
+    remote_service_admin_pt rsa = handle;
+    celix_status_t status = CELIX_SUCCESS;
+
+    celixThreadRwlock_readLock(&rsa->exportedServicesLock);
+    export_registration_pt export = remoteServiceAdmin_findExport(rsa, serviceId);
+    if (export != NULL) {
+        status = exportRegistration_callBinary(export, request, requestSize, reply, replySize);
+        if (status != CELIX_SUCCESS) {
+            RSA_LOG_ERROR(rsa, "Error trying to invoke remove service, got error %i\n", status);
+        }
+    } else {
+        status = CELIX_ILLEGAL_ARGUMENT;
+        RSA_LOG_WARNING(rsa, "NO export registration found for service id %lu", serviceId);
+    }
+    celixThreadRwlock_unlock(&rsa->exportedServicesLock);
+
+    return status;
+}
+
+static void remoteServiceAdmin_startBinaryServer(remote_service_admin_pt admin, const char *numThreads) {
+    const char *socketPath = NULL;
+    const char *port = NULL;
+    char url[1024];
+
+    // a unix domain socket when RSA_BINARY_SOCKET is set, a tcp port otherwise
+    bundleContext_getProperty(admin->context, "RSA_BINARY_SOCKET", &socketPath);
+    bundleContext_getProperty(admin->context, "RSA_BINARY_PORT", &port);
+    if (port == NULL) {
+        port = DEFAULT_BINARY_PORT;
+    }
+
+    if (socketPath != NULL) {
+        snprintf(url, sizeof(url), "unix://%s", socketPath);
+    } else {
+        snprintf(url, sizeof(url), "tcp://*:%s", port);
+    }
+
+    if (binaryServer_create(url, atoi(numThreads), remoteServiceAdmin_callBinary, admin, &admin->binaryServer) == CELIX_SUCCESS) {
+        if (socketPath == NULL) {
+            snprintf(url, sizeof(url), "tcp://%s:%u", admin->ip, binaryServer_getPort(admin->binaryServer));
+        }
+        admin->binaryUrl = strdup(url);
+        logHelper_log(admin->loghelper, OSGI_LOGSERVICE_INFO, "RSA: Start binary server: %s", admin->binaryUrl);
+    } else {
+        admin->binaryServer = NULL;
+        logHelper_log(admin->loghelper, OSGI_LOGSERVICE_WARNING, "RSA: Cannot start binary server on %s, exports are only available over http", url);
+    }
+}
+
 celix_status_t remoteServiceAdmin_exportService(remote_service_admin_pt admin, char *serviceId, properties_pt properties, array_list_pt *registrations) {
     celix_status_t status;
 
@@ -439,9 +564,9 @@ celix_status_t remoteServiceAdmin_exportService(remote_service_admin_pt admin, c
 
 
     if (status == CELIX_SUCCESS) {
-        celixThreadMutex_lock(&admin->exportedServicesLock);
+        celixThreadRwlock_writeLock(&admin->exportedServicesLock);
         hashMap_put(admin->exportedServices, reference, *registrations);
-        celixThreadMutex_unlock(&admin->exportedServicesLock);
+        celixThreadRwlock_unlock(&admin->exportedServicesLock);
     }
     else{
     	arrayList_destroy(*registrations);
@@ -461,7 +586,7 @@ celix_status_t remoteServiceAdmin_removeExportedService(remote_service_admin_pt
 
     if (status == CELIX_SUCCESS && ref != NULL) {
     	service_reference_pt servRef;
-        celixThreadMutex_lock(&admin->exportedServicesLock);
+        celixThreadRwlock_writeLock(&admin->exportedServicesLock);
     	exportReference_getExportedService(ref, &servRef);
 
     	array_list_pt exports = (array_list_pt)hashMap_remove(admin->exportedServices, servRef);
@@ -472,7 +597,7 @@ celix_status_t remoteServiceAdmin_removeExportedService(remote_service_admin_pt
         exportRegistration_close(registration);
         exportRegistration_destroy(registration);
 
-        celixThreadMutex_unlock(&admin->exportedServicesLock);
+        celixThreadRwlock_unlock(&admin->exportedServicesLock);
 
         free(ref);
 
@@ -529,6 +654,9 @@ static celix_status_t remoteServiceAdmin_createEndpointDescription(remote_servic
     properties_set(endpointProperties, (char*) OSGI_RSA_SERVICE_IMPORTED, "true");
     properties_set(endpointProperties, (char*) OSGI_RSA_SERVICE_IMPORTED_CONFIGS, (char*) CONFIGURATION_TYPE);
     properties_set(endpointProperties, (char*) ENDPOINT_URL, url);
+    if (admin->binaryUrl != NULL) {
+        properties_set(endpointProperties, (char*) ENDPOINT_BINARY_URL, admin->binaryUrl);
+    }
 
     if (props != NULL) {
         hash_map_iterator_pt propIter = hashMapIterator_create(props);
@@ -624,10 +752,14 @@ celix_status_t remoteServiceAdmin_importService(remote_service_admin_pt admin, e
     logHelper_log(admin->loghelper, OSGI_LOGSERVICE_INFO, "Registering service factory (proxy) for service '%s'\n", objectClass);
 
     if (objectClass != NULL) {
-        status = importRegistration_create(admin->context, endpointDescription, objectClass, serviceVersion, &import);
+        status = importRegistration_create(admin->context, admin->interfaceCache, endpointDescription, objectClass, serviceVersion, &import);
     }
     if (status == CELIX_SUCCESS && import != NULL) {
         importRegistration_setSendFn(import, (send_func_type) remoteServiceAdmin_send, admin);
+        if (admin->binaryEnabled && properties_get(endpointDescription->properties, (char*) ENDPOINT_BINARY_URL) != NULL) {
+            importRegistration_setSendBinaryFn(import, remoteServiceAdmin_sendBinary, admin);
+        }
+        status = importRegistration_setOnewayBatch(import, admin->onewayBatchSize, admin->onewayDelayMs);
     }
 
     if (status == CELIX_SUCCESS && import != NULL) {
@@ -671,10 +803,6 @@ celix_status_t remoteServiceAdmin_removeImportedService(remote_service_admin_pt
 
 static celix_status_t remoteServiceAdmin_send(void *handle, endpoint_description_pt endpointDescription, char *request, char **reply, int* replyStatus) {
     remote_service_admin_pt  rsa = handle;
-    struct post post;
-    post.readptr = request;
-    post.size = strlen(request);
-
     struct get get;
     get.size = 0;
     get.writeptr = malloc(1);
@@ -683,25 +811,13 @@ static celix_status_t remoteServiceAdmin_send(void *handle, endpoint_description
     char url[256];
     snprintf(url, 256, "%s", serviceUrl);
 
-    // assume the default timeout
-    int timeout = DEFAULT_TIMEOUT;
-
-    const char *timeoutStr = NULL;
-    // Check if the endpoint has a timeout, if so, use it.
-    timeoutStr = (char*) properties_get(endpointDescription->properties, (char*) OSGI_RSA_REMOTE_PROXY_TIMEOUT);
-    if (timeoutStr == NULL) {
-        // If not, get the global variable and use that one.
-        bundleContext_getProperty(rsa->context, (char*) OSGI_RSA_REMOTE_PROXY_TIMEOUT, &timeoutStr);
-    }
-
-    // Update timeout if a property is used to set it.
-    if (timeoutStr != NULL) {
-        timeout = atoi(timeoutStr);
-    }
+    int timeout = remoteServiceAdmin_getTimeout(rsa, endpointDescription);
 
     celix_status_t status = CELIX_SUCCESS;
     CURL *curl;
     CURLcode res;
+    // no 'Expect: 100-continue' for large requests like batches, which would cost an extra round trip
+    struct curl_slist *headers = curl_slist_append(NULL, "Expect:");
 
     curl = curl_easy_init();
     if(!curl) {
@@ -711,11 +827,12 @@ static celix_status_t remoteServiceAdmin_send(void *handle, endpoint_description
         curl_easy_setopt(curl, CURLOPT_TIMEOUT, timeout);
         curl_easy_setopt(curl, CURLOPT_URL, url);
         curl_easy_setopt(curl, CURLOPT_POST, 1L);
-        curl_easy_setopt(curl, CURLOPT_READFUNCTION, remoteServiceAdmin_readCallback);
-        curl_easy_setopt(curl, CURLOPT_READDATA, &post);
+        // the request is posted as a whole, not copied to curl byte by byte
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, request);
         curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, remoteServiceAdmin_write);
         curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&get);
-        curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (curl_off_t)post.size);
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (curl_off_t)strlen(request));
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
         logHelper_log(rsa->loghelper, OSGI_LOGSERVICE_DEBUG, "RSA: Performing curl post\n");
         res = curl_easy_perform(curl);
 
@@ -724,21 +841,63 @@ static celix_status_t remoteServiceAdmin_send(void *handle, endpoint_description
 
         curl_easy_cleanup(curl);
     }
+    curl_slist_free_all(headers);
 
     return status;
 }
 
-static size_t remoteServiceAdmin_readCallback(void *ptr, size_t size, size_t nmemb, void *userp) {
-    struct post *post = userp;
+static celix_status_t remoteServiceAdmin_sendBinary(void *handle, endpoint_description_pt endpointDescription, const void *request, size_t requestSize, void **reply, size_t *replySize, int *replyStatus) {
+    remote_service_admin_pt rsa = handle;
+    celix_status_t status = CELIX_SUCCESS;
+    binary_client_pt client = NULL;
+
+    const char *url = properties_get(endpointDescription->properties, (char*) ENDPOINT_BINARY_URL);
+    if (url == NULL) {
+        status = CELIX_ILLEGAL_STATE;
+    }
 
-    if (post->size) {
-        *(char *) ptr = post->readptr[0];
-        post->readptr++;
-        post->size--;
-        return 1;
+    // the calls of all imports of the same framework share its connection
+    if (status == CELIX_SUCCESS) {
+        celixThreadMutex_lock(&rsa->binaryClientsLock);
+        client = hashMap_get(rsa->binaryClients, url);
+        if (client == NULL) {
+            status = binaryClient_create(url, &client);
+            if (status == CELIX_SUCCESS) {
+                hashMap_put(rsa->binaryClients, strdup(url), client);
+            }
+        }
+        celixThreadMutex_unlock(&rsa->binaryClientsLock);
+    }
+
+    if (status == CELIX_SUCCESS) {
+        status = binaryClient_call(client, endpointDescription->serviceId, request, requestSize, remoteServiceAdmin_getTimeout(rsa, endpointDescription), reply, replySize, replyStatus);
+        if (status != CELIX_SUCCESS) {
+            logHelper_log(rsa->loghelper, OSGI_LOGSERVICE_DEBUG, "RSA: Cannot reach %s, using http", url);
+            status = CELIX_ILLEGAL_STATE;
+        }
+    }
+
+    return status;
+}
+
+static int remoteServiceAdmin_getTimeout(remote_service_admin_pt rsa, endpoint_description_pt endpointDescription) {
+    // assume the default timeout
+    int timeout = DEFAULT_TIMEOUT;
+
+    const char *timeoutStr = NULL;
+    // Check if the endpoint has a timeout, if so, use it.
+    timeoutStr = (char*) properties_get(endpointDescription->properties, (char*) OSGI_RSA_REMOTE_PROXY_TIMEOUT);
+    if (timeoutStr == NULL) {
+        // If not, get the global variable and use that one.
+        bundleContext_getProperty(rsa->context, (char*) OSGI_RSA_REMOTE_PROXY_TIMEOUT, &timeoutStr);
+    }
+
+    // Update timeout if a property is used to set it.
+    if (timeoutStr != NULL) {
+        timeout = atoi(timeoutStr);
     }
 
-    return 0;
+    return timeout;
 }
 
 static size_t remoteServiceAdmin_write(void *contents, size_t size, size_t nmemb, void *userp) {
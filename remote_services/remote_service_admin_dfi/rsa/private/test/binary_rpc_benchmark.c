@@ -0,0 +1,336 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+/*
+ * binary_rpc_benchmark.c
+ *
+ * Benchmark of the binary transport against json over http on loopback. Exports a service and imports it twice, once
+ * with the binary url of the endpoint removed so its calls use json over http and once with an unreachable http url so
+ * its calls can only succeed over the binary transport. Measures the round trip latency of one caller and the
+ * throughput of NR_OF_CALLERS concurrent callers for both imports. Pass "unix" to use a unix domain socket.
+ *
+ *  \author    	<a href="mailto:dev@celix.apache.org">Apache Celix Project Team</a>
+ *  \copyright	Apache License, Version 2.0
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <curl/curl.h>
+
+#include "celix_launcher.h"
+#include "constants.h"
+#include "framework.h"
+#include "bundle_context.h"
+#include "celix_threads.h"
+#include "remote_constants.h"
+#include "remote_service_admin.h"
+#include "remote_service_admin_dfi.h"
+#include "export_registration_dfi.h"
+#include "import_registration_dfi.h"
+
+#define NR_OF_LATENCY_CALLS 2000
+#define NR_OF_CALLERS 8
+#define CALLS_PER_CALLER 200
+#define SEQUENCE_LENGTH 256
+#define FAILURE_CODE 7
+
+#define MATH_NAME "bench.Math"
+#define BINARY_URL "org.apache.celix.remote.admin.dfi.binary.url"
+#define TRANSPORT "bench.transport"
+
+static const char * const MATH_DESCRIPTOR =
+        ":header\n"
+        "type=interface\n"
+        "name=math\n"
+        "version=1.0.0\n"
+        ":annotations\n"
+        ":types\n"
+        ":methods\n"
+        "add(DD)D=add(#am=handle;PDD#am=pre;*D)N\n"
+        "sum([D)D=sum(#am=handle;P[D#am=pre;*D)N\n"
+        "fail(I)D=fail(#am=handle;PI#am=pre;*D)N\n";
+
+struct sequence {
+    uint32_t cap;
+    uint32_t len;
+    double *buf;
+};
+
+struct math_service {
+    void *handle;
+    int (*add)(void *handle, double a, double b, double *result);
+    int (*sum)(void *handle, struct sequence values, double *result);
+    int (*fail)(void *handle, int code, double *result);
+};
+
+struct caller {
+    struct math_service *service;
+    int index;
+    int failures;
+};
+
+static double benchmark_elapsedMs(struct timespec *begin, struct timespec *end) {
+    return (end->tv_sec - begin->tv_sec) * 1000.0 + (end->tv_nsec - begin->tv_nsec) / 1000000.0;
+}
+
+static int benchmark_add(void *handle, double a, double b, double *result) {
+    *result = a + b;
+    return 0;
+}
+
+static int benchmark_sum(void *handle, struct sequence values, double *result) {
+    uint32_t i;
+
+    *result = 0.0;
+    for (i = 0; i < values.len; i++) {
+        *result += values.buf[i];
+    }
+    return 0;
+}
+
+static int benchmark_fail(void *handle, int code, double *result) {
+    return code;
+}
+
+static void *benchmark_call(void *data) {
+    struct caller *caller = data;
+    double values[SEQUENCE_LENGTH];
+    struct sequence sequence = {SEQUENCE_LENGTH, SEQUENCE_LENGTH, values};
+    double expected = 0.0;
+    int i;
+
+    for (i = 0; i < SEQUENCE_LENGTH; i++) {
+        values[i] = caller->index + i;
+        expected += values[i];
+    }
+    for (i = 0; i < CALLS_PER_CALLER; i++) {
+        double result = 0.0;
+        if (caller->service->sum(caller->service->handle, sequence, &result) != 0 || result != expected) {
+            caller->failures++;
+        }
+    }
+
+    return NULL;
+}
+
+static int benchmark_run(const char *transport, struct math_service *service) {
+    struct caller callers[NR_OF_CALLERS];
+    celix_thread_t threads[NR_OF_CALLERS];
+    struct timespec begin;
+    struct timespec end;
+    double result = 0.0;
+    int failures = 0;
+    int calls = NR_OF_CALLERS * CALLS_PER_CALLER;
+    int i;
+
+    // the error code of the service is the return value of the proxy, json over http only reports the http status
+    if (strcmp(transport, "binary") == 0 && service->fail(service->handle, FAILURE_CODE, &result) != FAILURE_CODE) {
+        printf("%s: error code not returned\n", transport);
+        failures++;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    for (i = 0; i < NR_OF_LATENCY_CALLS; i++) {
+        if (service->add(service->handle, i, 0.5, &result) != 0 || result != i + 0.5) {
+            failures++;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("%-6s: %i sequential calls, round trip %.1f us\n", transport, NR_OF_LATENCY_CALLS, benchmark_elapsedMs(&begin, &end) * 1000.0 / NR_OF_LATENCY_CALLS);
+
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    for (i = 0; i < NR_OF_CALLERS; i++) {
+        callers[i].service = service;
+        callers[i].index = i;
+        callers[i].failures = 0;
+        celixThread_create(&threads[i], NULL, benchmark_call, &callers[i]);
+    }
+    for (i = 0; i < NR_OF_CALLERS; i++) {
+        celixThread_join(threads[i], NULL);
+        failures += callers[i].failures;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("%-6s: %i calls with %i doubles by %i callers in %.1f ms, %.0f calls/s\n", transport, calls, SEQUENCE_LENGTH, NR_OF_CALLERS,
+            benchmark_elapsedMs(&begin, &end), calls / (benchmark_elapsedMs(&begin, &end) / 1000.0));
+
+    return failures;
+}
+
+static endpoint_description_pt benchmark_createEndpoint(endpoint_description_pt exported, const char *transport) {
+    endpoint_description_pt endpoint = NULL;
+    properties_pt properties = NULL;
+
+    properties_copy(exported->properties, &properties);
+    properties_set(properties, TRANSPORT, transport);
+    if (strcmp(transport, "json") == 0) {
+        hash_map_entry_pt entry = hashMap_getEntry(properties, BINARY_URL);
+        if (entry != NULL) {
+            char *key = hashMapEntry_getKey(entry);
+            free(hashMap_remove(properties, BINARY_URL));
+            free(key);
+        }
+    } else {
+        // calls falling back to http fail
+        properties_set(properties, "org.amdatu.remote.admin.http.url", "http://127.0.0.1:1/service");
+    }
+    endpointDescription_create(properties, &endpoint);
+
+    return endpoint;
+}
+
+int main(int argc, char **argv) {
+    framework_pt framework = NULL;
+    bundle_pt frameworkBundle = NULL;
+    bundle_context_pt context = NULL;
+    remote_service_admin_pt admin = NULL;
+    service_registration_pt registration = NULL;
+    array_list_pt exports = NULL;
+    export_reference_pt reference = NULL;
+    endpoint_description_pt exported = NULL;
+    const char *transports[] = {"json", "binary"};
+    endpoint_description_pt endpoints[2];
+    import_registration_pt imports[2];
+    struct math_service service;
+    char dir[] = "/tmp/binary_rpc_benchmark_XXXXXX";
+    char path[128];
+    char socketPath[128];
+    char numThreads[16];
+    const char *serviceId = NULL;
+    char id[32];
+    int failures = 0;
+    FILE *descriptor;
+    int i;
+
+    if (mkdtemp(dir) == NULL) {
+        return EXIT_FAILURE;
+    }
+    // services of the framework bundle find their descriptor in the extender path
+    snprintf(path, sizeof(path), "%s/%s.descriptor", dir, MATH_NAME);
+    descriptor = fopen(path, "w");
+    if (descriptor == NULL) {
+        return EXIT_FAILURE;
+    }
+    fputs(MATH_DESCRIPTOR, descriptor);
+    fclose(descriptor);
+    snprintf(socketPath, sizeof(socketPath), "%s/rsa.sock", dir);
+
+    curl_global_init(CURL_GLOBAL_ALL);
+
+    properties_pt config = properties_create();
+    snprintf(numThreads, sizeof(numThreads), "%i", NR_OF_CALLERS);
+    properties_set(config, "RSA_IP", "127.0.0.1");
+    properties_set(config, "RSA_PORT", "18892");
+    properties_set(config, "RSA_NUM_THREADS", numThreads);
+    if (argc > 1 && strcmp(argv[1], "unix") == 0) {
+        properties_set(config, "RSA_BINARY_SOCKET", socketPath);
+    }
+    properties_set(config, "CELIX_FRAMEWORK_EXTENDER_PATH", dir);
+    properties_set(config, OSGI_FRAMEWORK_FRAMEWORK_STORAGE_CLEAN, OSGI_FRAMEWORK_FRAMEWORK_STORAGE_CLEAN_ONFIRSTINIT);
+    if (celixLauncher_launchWithProperties(config, &framework) != CELIX_SUCCESS) {
+        return EXIT_FAILURE;
+    }
+    framework_getFrameworkBundle(framework, &frameworkBundle);
+    bundle_getContext(frameworkBundle, &context);
+
+    if (remoteServiceAdmin_create(context, &admin) != CELIX_SUCCESS) {
+        return EXIT_FAILURE;
+    }
+
+    properties_pt properties = properties_create();
+    service.handle = NULL;
+    service.add = benchmark_add;
+    service.sum = benchmark_sum;
+    service.fail = benchmark_fail;
+    properties_set(properties, (char *) OSGI_RSA_SERVICE_EXPORTED_INTERFACES, MATH_NAME);
+    bundleContext_registerService(context, MATH_NAME, &service, properties, &registration);
+    serviceRegistration_getProperties(registration, &properties);
+    serviceId = properties_get(properties, (char *) OSGI_FRAMEWORK_SERVICE_ID);
+    snprintf(id, sizeof(id), "%s", serviceId != NULL ? serviceId : "");
+
+    if (remoteServiceAdmin_exportService(admin, id, NULL, &exports) != CELIX_SUCCESS || arrayList_size(exports) != 1) {
+        printf("Cannot export %s\n", MATH_NAME);
+        return EXIT_FAILURE;
+    }
+    exportRegistration_getExportReference(arrayList_get(exports, 0), &reference);
+    exportReference_getExportedEndpoint(reference, &exported);
+    if (properties_get(exported->properties, BINARY_URL) == NULL) {
+        printf("No binary url advertised\n");
+        return EXIT_FAILURE;
+    }
+    printf("Binary url %s\n", properties_get(exported->properties, BINARY_URL));
+
+    for (i = 0; i < 2; i++) {
+        array_list_pt references = NULL;
+        service_reference_pt proxyReference = NULL;
+        struct math_service *proxy = NULL;
+        char filter[64];
+        bool result = false;
+
+        endpoints[i] = benchmark_createEndpoint(exported, transports[i]);
+        imports[i] = NULL;
+        if (remoteServiceAdmin_importService(admin, endpoints[i], &imports[i]) != CELIX_SUCCESS) {
+            printf("Cannot import %s\n", MATH_NAME);
+            return EXIT_FAILURE;
+        }
+
+        snprintf(filter, sizeof(filter), "(%s=%s)", TRANSPORT, transports[i]);
+        bundleContext_getServiceReferences(context, MATH_NAME, filter, &references);
+        if (references != NULL && arrayList_size(references) == 1) {
+            proxyReference = arrayList_get(references, 0);
+            bundleContext_getService(context, proxyReference, (void **) &proxy);
+        }
+        if (proxy == NULL) {
+            printf("Cannot get the %s proxy\n", transports[i]);
+            failures++;
+        } else {
+            failures += benchmark_run(transports[i], proxy);
+            bundleContext_ungetService(context, proxyReference, &result);
+        }
+        if (references != NULL) {
+            int j;
+            for (j = 0; j < arrayList_size(references); j++) {
+                bundleContext_ungetServiceReference(context, arrayList_get(references, j));
+            }
+            arrayList_destroy(references);
+        }
+    }
+
+    for (i = 0; i < 2; i++) {
+        remoteServiceAdmin_removeImportedService(admin, imports[i]);
+        endpointDescription_destroy(endpoints[i]);
+    }
+    free(reference);
+    remoteServiceAdmin_removeExportedService(admin, arrayList_get(exports, 0));
+    serviceRegistration_unregister(registration);
+
+    remoteServiceAdmin_stop(admin);
+    remoteServiceAdmin_destroy(&admin);
+
+    celixLauncher_stop(framework);
+    celixLauncher_waitForShutdown(framework);
+    celixLauncher_destroy(framework);
+
+    curl_global_cleanup();
+    unlink(path);
+    rmdir(dir);
+
+    printf("%i failures\n", failures);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
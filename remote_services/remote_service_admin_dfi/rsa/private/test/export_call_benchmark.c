@@ -0,0 +1,267 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+/*
+ * export_call_benchmark.c
+ *
+ * Benchmark of remote calls to an exported service. NR_OF_CALLERS threads call a service exported by the DFI remote
+ * service admin over HTTP, every call blocks WORK_US microseconds in the service. The service is exported twice, once
+ * called concurrently and once with service.exported.serial set. Checks every reply, that the serial export is never
+ * called concurrently and that the statistics of the exports add up.
+ *
+ *  \author    	<a href="mailto:dev@celix.apache.org">Apache Celix Project Team</a>
+ *  \copyright	Apache License, Version 2.0
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <curl/curl.h>
+#include <jansson.h>
+
+#include "celix_launcher.h"
+#include "constants.h"
+#include "framework.h"
+#include "bundle_context.h"
+#include "celix_threads.h"
+#include "metrics_service.h"
+#include "remote_constants.h"
+#include "remote_service_admin.h"
+#include "remote_service_admin_dfi.h"
+#include "export_registration_dfi.h"
+
+#define NR_OF_CALLERS 8
+#define CALLS_PER_CALLER 100
+#define WORK_US 1000
+
+#define WORKER_NAME "bench.Worker"
+
+static const char * const WORKER_DESCRIPTOR =
+        ":header\n"
+        "type=interface\n"
+        "name=worker\n"
+        "version=1.0.0\n"
+        ":annotations\n"
+        ":types\n"
+        ":methods\n"
+        "work(I)D=work(#am=handle;PI#am=pre;*D)N\n";
+
+struct worker_service {
+    void *handle;
+    int (*work)(void *handle, int input, double *result);
+};
+
+struct worker {
+    int running;
+    int maxRunning;
+};
+
+struct caller {
+    const char *url;
+    int index;
+    int failures;
+};
+
+static double benchmark_elapsedMs(struct timespec *begin, struct timespec *end) {
+    return (end->tv_sec - begin->tv_sec) * 1000.0 + (end->tv_nsec - begin->tv_nsec) / 1000000.0;
+}
+
+static int benchmark_work(void *handle, int input, double *result) {
+    struct worker *worker = handle;
+    int running = __sync_add_and_fetch(&worker->running, 1);
+    int maxRunning = worker->maxRunning;
+
+    while (running > maxRunning && !__sync_bool_compare_and_swap(&worker->maxRunning, maxRunning, running)) {
+        maxRunning = worker->maxRunning;
+    }
+    usleep(WORK_US);
+    *result = input * 2.0;
+    __sync_sub_and_fetch(&worker->running, 1);
+
+    return 0;
+}
+
+static size_t benchmark_write(void *contents, size_t size, size_t nmemb, void *userp) {
+    json_t **reply = userp;
+    json_error_t error;
+
+    if (*reply == NULL) {
+        *reply = json_loadb(contents, size * nmemb, 0, &error);
+    }
+    return size * nmemb;
+}
+
+static void *benchmark_call(void *data) {
+    struct caller *caller = data;
+    CURL *curl = curl_easy_init();
+    int i;
+
+    curl_easy_setopt(curl, CURLOPT_URL, caller->url);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, benchmark_write);
+    for (i = 0; i < CALLS_PER_CALLER; i++) {
+        char request[64];
+        json_t *reply = NULL;
+        int input = caller->index * CALLS_PER_CALLER + i;
+
+        snprintf(request, sizeof(request), "{\"m\":\"work(I)D\",\"a\":[%i]}", input);
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, request);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &reply);
+        if (curl_easy_perform(curl) != CURLE_OK || reply == NULL || json_real_value(json_object_get(reply, "r")) != input * 2.0) {
+            caller->failures++;
+        }
+        json_decref(reply);
+    }
+    curl_easy_cleanup(curl);
+
+    return NULL;
+}
+
+static int benchmark_run(bundle_context_pt context, remote_service_admin_pt admin, bool serial) {
+    struct worker worker;
+    struct worker_service service;
+    struct caller callers[NR_OF_CALLERS];
+    struct export_registration_statistics statistics;
+    celix_thread_t threads[NR_OF_CALLERS];
+    service_registration_pt registration = NULL;
+    array_list_pt exports = NULL;
+    export_registration_pt export = NULL;
+    export_reference_pt reference = NULL;
+    endpoint_description_pt endpoint = NULL;
+    properties_pt properties = properties_create();
+    struct timespec begin;
+    struct timespec end;
+    char serviceId[32];
+    const char *id = NULL;
+    int failures = 0;
+    int calls = NR_OF_CALLERS * CALLS_PER_CALLER;
+    int i;
+
+    memset(&worker, 0, sizeof(worker));
+    service.handle = &worker;
+    service.work = benchmark_work;
+    properties_set(properties, (char *) OSGI_RSA_SERVICE_EXPORTED_INTERFACES, WORKER_NAME);
+    properties_set(properties, OSGI_RSA_SERVICE_EXPORTED_SERIAL, serial ? "true" : "false");
+    bundleContext_registerService(context, WORKER_NAME, &service, properties, &registration);
+    serviceRegistration_getProperties(registration, &properties);
+    id = properties_get(properties, (char *) OSGI_FRAMEWORK_SERVICE_ID);
+    snprintf(serviceId, sizeof(serviceId), "%s", id != NULL ? id : "");
+
+    if (remoteServiceAdmin_exportService(admin, serviceId, NULL, &exports) != CELIX_SUCCESS || arrayList_size(exports) != 1) {
+        printf("Cannot export %s\n", WORKER_NAME);
+        serviceRegistration_unregister(registration);
+        return 1;
+    }
+    export = arrayList_get(exports, 0);
+    exportRegistration_getExportReference(export, &reference);
+    exportReference_getExportedEndpoint(reference, &endpoint);
+
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    for (i = 0; i < NR_OF_CALLERS; i++) {
+        callers[i].url = properties_get(endpoint->properties, "org.amdatu.remote.admin.http.url");
+        callers[i].index = i;
+        callers[i].failures = 0;
+        celixThread_create(&threads[i], NULL, benchmark_call, &callers[i]);
+    }
+    for (i = 0; i < NR_OF_CALLERS; i++) {
+        celixThread_join(threads[i], NULL);
+        failures += callers[i].failures;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    exportRegistration_getStatistics(export, &statistics);
+    printf("%s export: %i calls by %i callers in %.3f ms, %.0f calls/s, max %u in flight, service ran %i at once, avg latency %.3f ms, max %.3f ms\n",
+            serial ? "Serial" : "Concurrent", calls, NR_OF_CALLERS, benchmark_elapsedMs(&begin, &end), calls / (benchmark_elapsedMs(&begin, &end) / 1000.0),
+            statistics.maxInFlight, worker.maxRunning, statistics.calls > 0 ? statistics.totalLatencyNs / 1000000.0 / statistics.calls : 0.0,
+            statistics.maxLatencyNs / 1000000.0);
+
+    if (statistics.calls != calls || statistics.failures != 0 || statistics.inFlight != 0) {
+        failures++;
+    }
+    if (serial ? worker.maxRunning != 1 : worker.maxRunning < 2) {
+        failures++;
+    }
+
+    free(reference);
+    remoteServiceAdmin_removeExportedService(admin, export);
+    serviceRegistration_unregister(registration);
+
+    return failures;
+}
+
+int main(int argc, char **argv) {
+    framework_pt framework = NULL;
+    bundle_pt frameworkBundle = NULL;
+    bundle_context_pt context = NULL;
+    remote_service_admin_pt admin = NULL;
+    char dir[] = "/tmp/export_call_benchmark_XXXXXX";
+    char path[128];
+    char numThreads[16];
+    int failures = 0;
+    FILE *descriptor;
+
+    if (mkdtemp(dir) == NULL) {
+        return EXIT_FAILURE;
+    }
+    // services of the framework bundle find their descriptor in the extender path
+    snprintf(path, sizeof(path), "%s/%s.descriptor", dir, WORKER_NAME);
+    descriptor = fopen(path, "w");
+    if (descriptor == NULL) {
+        return EXIT_FAILURE;
+    }
+    fputs(WORKER_DESCRIPTOR, descriptor);
+    fclose(descriptor);
+
+    curl_global_init(CURL_GLOBAL_ALL);
+
+    properties_pt config = properties_create();
+    snprintf(numThreads, sizeof(numThreads), "%i", NR_OF_CALLERS);
+    properties_set(config, "RSA_IP", "127.0.0.1");
+    properties_set(config, "RSA_PORT", "18890");
+    properties_set(config, "RSA_NUM_THREADS", numThreads);
+    properties_set(config, "CELIX_FRAMEWORK_EXTENDER_PATH", dir);
+    properties_set(config, CELIX_METRICS_ENABLED, "true"); //the export statistics are only kept with the metrics
+    properties_set(config, OSGI_FRAMEWORK_FRAMEWORK_STORAGE_CLEAN, OSGI_FRAMEWORK_FRAMEWORK_STORAGE_CLEAN_ONFIRSTINIT);
+    if (celixLauncher_launchWithProperties(config, &framework) != CELIX_SUCCESS) {
+        return EXIT_FAILURE;
+    }
+    framework_getFrameworkBundle(framework, &frameworkBundle);
+    bundle_getContext(frameworkBundle, &context);
+
+    if (remoteServiceAdmin_create(context, &admin) != CELIX_SUCCESS) {
+        return EXIT_FAILURE;
+    }
+
+    failures += benchmark_run(context, admin, false);
+    failures += benchmark_run(context, admin, true);
+
+    remoteServiceAdmin_stop(admin);
+    remoteServiceAdmin_destroy(&admin);
+
+    celixLauncher_stop(framework);
+    celixLauncher_waitForShutdown(framework);
+    celixLauncher_destroy(framework);
+
+    curl_global_cleanup();
+    unlink(path);
+    rmdir(dir);
+
+    printf("%i failures\n", failures);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,307 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+/*
+ * import_proxy_benchmark.c
+ *
+ * Benchmark of proxies for an imported service. Installs NR_OF_CONSUMERS bundles which all carry the descriptor of
+ * an interface with NR_OF_METHODS methods, every tenth bundle with a descriptor of the newer minor version the service
+ * is imported with. All bundles get the imported service, which creates a proxy per bundle. Measures the time and the
+ * memory used for getting the proxies and checks that bundles with the same descriptor share their proxy.
+ *
+ *  \author    	<a href="mailto:dev@celix.apache.org">Apache Celix Project Team</a>
+ *  \copyright	Apache License, Version 2.0
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "celix_launcher.h"
+#include "constants.h"
+#include "framework.h"
+#include "bundle_context.h"
+#include "remote_constants.h"
+#include "remote_service_admin.h"
+#include "remote_service_admin_dfi.h"
+#include "import_registration_dfi.h"
+
+#define NR_OF_CONSUMERS 50
+#define NR_OF_METHODS 40
+
+#define CALCULATOR_NAME "bench.Calculator"
+
+struct zip_buffer {
+    unsigned char *data;
+    size_t size;
+    size_t capacity;
+    unsigned char *central;
+    size_t centralSize;
+    size_t centralCapacity;
+    int entries;
+};
+
+static double benchmark_elapsedMs(struct timespec *begin, struct timespec *end) {
+    return (end->tv_sec - begin->tv_sec) * 1000.0 + (end->tv_nsec - begin->tv_nsec) / 1000000.0;
+}
+
+static long benchmark_rssKb(void) {
+    long pages = 0;
+    FILE *statm = fopen("/proc/self/statm", "r");
+
+    if (statm != NULL) {
+        if (fscanf(statm, "%*s %ld", &pages) != 1) {
+            pages = 0;
+        }
+        fclose(statm);
+    }
+    return pages * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static unsigned long zipBuffer_crc32(const unsigned char *data, size_t length) {
+    unsigned long crc = 0xffffffffUL;
+    size_t i;
+    int bit;
+
+    for (i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xedb88320UL & -(crc & 1));
+        }
+    }
+    return crc ^ 0xffffffffUL;
+}
+
+static void zipBuffer_append(unsigned char **data, size_t *size, size_t *capacity, const void *bytes, size_t length) {
+    if (*size + length > *capacity) {
+        *capacity = (*size + length) * 2;
+        *data = realloc(*data, *capacity);
+    }
+    memcpy(*data + *size, bytes, length);
+    *size += length;
+}
+
+static void zipBuffer_appendShort(unsigned char **data, size_t *size, size_t *capacity, unsigned int value) {
+    unsigned char bytes[2] = { value & 0xff, (value >> 8) & 0xff };
+    zipBuffer_append(data, size, capacity, bytes, sizeof(bytes));
+}
+
+static void zipBuffer_appendInt(unsigned char **data, size_t *size, size_t *capacity, unsigned long value) {
+    unsigned char bytes[4] = { value & 0xff, (value >> 8) & 0xff, (value >> 16) & 0xff, (value >> 24) & 0xff };
+    zipBuffer_append(data, size, capacity, bytes, sizeof(bytes));
+}
+
+/*
+ * Adds a stored entry
+ */
+static void zipBuffer_add(struct zip_buffer *zip, const char *name, const char *content) {
+    size_t length = strlen(content);
+    unsigned long crc = zipBuffer_crc32((const unsigned char *) content, length);
+    unsigned long offset = zip->size;
+
+    zipBuffer_appendInt(&zip->data, &zip->size, &zip->capacity, 0x04034b50);
+    zipBuffer_appendShort(&zip->data, &zip->size, &zip->capacity, 20);
+    zipBuffer_appendShort(&zip->data, &zip->size, &zip->capacity, 0);
+    zipBuffer_appendShort(&zip->data, &zip->size, &zip->capacity, 0);
+    zipBuffer_appendShort(&zip->data, &zip->size, &zip->capacity, 0);
+    zipBuffer_appendShort(&zip->data, &zip->size, &zip->capacity, 0x21);
+    zipBuffer_appendInt(&zip->data, &zip->size, &zip->capacity, crc);
+    zipBuffer_appendInt(&zip->data, &zip->size, &zip->capacity, length);
+    zipBuffer_appendInt(&zip->data, &zip->size, &zip->capacity, length);
+    zipBuffer_appendShort(&zip->data, &zip->size, &zip->capacity, strlen(name));
+    zipBuffer_appendShort(&zip->data, &zip->size, &zip->capacity, 0);
+    zipBuffer_append(&zip->data, &zip->size, &zip->capacity, name, strlen(name));
+    zipBuffer_append(&zip->data, &zip->size, &zip->capacity, content, length);
+
+    zipBuffer_appendInt(&zip->central, &zip->centralSize, &zip->centralCapacity, 0x02014b50);
+    zipBuffer_appendShort(&zip->central, &zip->centralSize, &zip->centralCapacity, 20);
+    zipBuffer_appendShort(&zip->central, &zip->centralSize, &zip->centralCapacity, 20);
+    zipBuffer_appendShort(&zip->central, &zip->centralSize, &zip->centralCapacity, 0);
+    zipBuffer_appendShort(&zip->central, &zip->centralSize, &zip->centralCapacity, 0);
+    zipBuffer_appendShort(&zip->central, &zip->centralSize, &zip->centralCapacity, 0);
+    zipBuffer_appendShort(&zip->central, &zip->centralSize, &zip->centralCapacity, 0x21);
+    zipBuffer_appendInt(&zip->central, &zip->centralSize, &zip->centralCapacity, crc);
+    zipBuffer_appendInt(&zip->central, &zip->centralSize, &zip->centralCapacity, length);
+    zipBuffer_appendInt(&zip->central, &zip->centralSize, &zip->centralCapacity, length);
+    zipBuffer_appendShort(&zip->central, &zip->centralSize, &zip->centralCapacity, strlen(name));
+    zipBuffer_appendShort(&zip->central, &zip->centralSize, &zip->centralCapacity, 0);
+    zipBuffer_appendShort(&zip->central, &zip->centralSize, &zip->centralCapacity, 0);
+    zipBuffer_appendShort(&zip->central, &zip->centralSize, &zip->centralCapacity, 0);
+    zipBuffer_appendShort(&zip->central, &zip->centralSize, &zip->centralCapacity, 0);
+    zipBuffer_appendInt(&zip->central, &zip->centralSize, &zip->centralCapacity, 0);
+    zipBuffer_appendInt(&zip->central, &zip->centralSize, &zip->centralCapacity, offset);
+    zipBuffer_append(&zip->central, &zip->centralSize, &zip->centralCapacity, name, strlen(name));
+
+    zip->entries++;
+}
+
+static void zipBuffer_finish(struct zip_buffer *zip) {
+    unsigned long centralOffset = zip->size;
+
+    zipBuffer_append(&zip->data, &zip->size, &zip->capacity, zip->central, zip->centralSize);
+    zipBuffer_appendInt(&zip->data, &zip->size, &zip->capacity, 0x06054b50);
+    zipBuffer_appendShort(&zip->data, &zip->size, &zip->capacity, 0);
+    zipBuffer_appendShort(&zip->data, &zip->size, &zip->capacity, 0);
+    zipBuffer_appendShort(&zip->data, &zip->size, &zip->capacity, zip->entries);
+    zipBuffer_appendShort(&zip->data, &zip->size, &zip->capacity, zip->entries);
+    zipBuffer_appendInt(&zip->data, &zip->size, &zip->capacity, zip->centralSize);
+    zipBuffer_appendInt(&zip->data, &zip->size, &zip->capacity, centralOffset);
+    zipBuffer_appendShort(&zip->data, &zip->size, &zip->capacity, 0);
+
+    free(zip->central);
+    zip->central = NULL;
+}
+
+static bundle_pt benchmark_installConsumer(bundle_context_pt context, int index) {
+    struct zip_buffer zip;
+    bundle_pt bundle = NULL;
+    char manifest[256];
+    char descriptor[NR_OF_METHODS * 64 + 256];
+    char file[] = "/tmp/import_proxy_benchmark_XXXXXX";
+    int length;
+    int fd;
+    int i;
+
+    snprintf(manifest, sizeof(manifest), "Manifest-Version: 1.0\nBundle-SymbolicName: bench.consumer.%i\nBundle-Version: 1.0.0\nBundle-Name: consumer %i\n\n", index, index);
+    length = snprintf(descriptor, sizeof(descriptor), ":header\ntype=interface\nname=calculator\nversion=%s\n:annotations\n:types\n:methods\n",
+            index % 10 == 0 ? "1.1.0" : "1.0.0");
+    for (i = 0; i < NR_OF_METHODS; i++) {
+        length += snprintf(descriptor + length, sizeof(descriptor) - length, "op%i(DD)D=op%i(#am=handle;PDD#am=pre;*D)N\n", i, i);
+    }
+
+    memset(&zip, 0, sizeof(zip));
+    zipBuffer_add(&zip, "META-INF/MANIFEST.MF", manifest);
+    zipBuffer_add(&zip, "META-INF/descriptors/" CALCULATOR_NAME ".descriptor", descriptor);
+    zipBuffer_finish(&zip);
+
+    fd = mkstemp(file);
+    if (fd >= 0) {
+        if (write(fd, zip.data, zip.size) == (ssize_t) zip.size) {
+            bundleContext_installBundle(context, file, &bundle);
+        }
+        close(fd);
+        unlink(file);
+    }
+    free(zip.data);
+
+    return bundle;
+}
+
+static endpoint_description_pt benchmark_createEndpoint(void) {
+    endpoint_description_pt endpoint = NULL;
+    properties_pt properties = properties_create();
+
+    properties_set(properties, (char *) OSGI_FRAMEWORK_OBJECTCLASS, CALCULATOR_NAME);
+    properties_set(properties, (char *) OSGI_RSA_ENDPOINT_FRAMEWORK_UUID, "bench-framework");
+    properties_set(properties, (char *) OSGI_RSA_ENDPOINT_ID, "bench-endpoint");
+    properties_set(properties, (char *) OSGI_RSA_ENDPOINT_SERVICE_ID, "42");
+    properties_set(properties, (char *) CELIX_FRAMEWORK_SERVICE_VERSION, "1.1.0");
+    properties_set(properties, "org.amdatu.remote.admin.http.url", "http://127.0.0.1:18891/service/42/" CALCULATOR_NAME);
+    endpointDescription_create(properties, &endpoint);
+
+    return endpoint;
+}
+
+int main(int argc, char **argv) {
+    framework_pt framework = NULL;
+    bundle_pt frameworkBundle = NULL;
+    bundle_context_pt context = NULL;
+    remote_service_admin_pt admin = NULL;
+    endpoint_description_pt endpoint = NULL;
+    import_registration_pt import = NULL;
+    bundle_context_pt consumers[NR_OF_CONSUMERS];
+    service_reference_pt references[NR_OF_CONSUMERS];
+    void *services[NR_OF_CONSUMERS];
+    struct timespec begin;
+    struct timespec end;
+    long rss;
+    int failures = 0;
+    int i;
+
+    properties_pt config = properties_create();
+    properties_set(config, "RSA_IP", "127.0.0.1");
+    properties_set(config, "RSA_PORT", "18891");
+    properties_set(config, OSGI_FRAMEWORK_FRAMEWORK_STORAGE_CLEAN, OSGI_FRAMEWORK_FRAMEWORK_STORAGE_CLEAN_ONFIRSTINIT);
+    if (celixLauncher_launchWithProperties(config, &framework) != CELIX_SUCCESS) {
+        return EXIT_FAILURE;
+    }
+    framework_getFrameworkBundle(framework, &frameworkBundle);
+    bundle_getContext(frameworkBundle, &context);
+
+    for (i = 0; i < NR_OF_CONSUMERS; i++) {
+        bundle_pt bundle = benchmark_installConsumer(context, i);
+        consumers[i] = NULL;
+        if (bundle == NULL || bundle_start(bundle) != CELIX_SUCCESS || bundle_getContext(bundle, &consumers[i]) != CELIX_SUCCESS) {
+            printf("Cannot start consumer %i\n", i);
+            return EXIT_FAILURE;
+        }
+    }
+
+    remoteServiceAdmin_create(context, &admin);
+    endpoint = benchmark_createEndpoint();
+    if (endpoint == NULL || remoteServiceAdmin_importService(admin, endpoint, &import) != CELIX_SUCCESS) {
+        printf("Cannot import %s\n", CALCULATOR_NAME);
+        return EXIT_FAILURE;
+    }
+
+    rss = benchmark_rssKb();
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    for (i = 0; i < NR_OF_CONSUMERS; i++) {
+        references[i] = NULL;
+        services[i] = NULL;
+        bundleContext_getServiceReference(consumers[i], CALCULATOR_NAME, &references[i]);
+        if (references[i] == NULL || bundleContext_getService(consumers[i], references[i], &services[i]) != CELIX_SUCCESS || services[i] == NULL) {
+            failures++;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("Got %i proxies with %i methods in %.3f ms, %.3f ms per consumer, RSS grew %ld kB\n", NR_OF_CONSUMERS, NR_OF_METHODS,
+            benchmark_elapsedMs(&begin, &end), benchmark_elapsedMs(&begin, &end) / NR_OF_CONSUMERS, benchmark_rssKb() - rss);
+
+    // consumers with the same descriptor share one proxy, the handle of the proxies is the import
+    for (i = 0; i < NR_OF_CONSUMERS; i++) {
+        int shared = i % 10 == 0 ? 0 : 1;
+        if (services[i] == NULL || *(void **) services[i] != import || services[i] != services[shared]) {
+            failures++;
+        }
+    }
+    if (services[0] == services[1]) {
+        failures++;
+    }
+
+    for (i = 0; i < NR_OF_CONSUMERS; i++) {
+        bool result = false;
+        if (references[i] != NULL) {
+            bundleContext_ungetService(consumers[i], references[i], &result);
+            bundleContext_ungetServiceReference(consumers[i], references[i]);
+        }
+    }
+
+    remoteServiceAdmin_removeImportedService(admin, import);
+    endpointDescription_destroy(endpoint);
+    remoteServiceAdmin_stop(admin);
+    remoteServiceAdmin_destroy(&admin);
+
+    celixLauncher_stop(framework);
+    celixLauncher_waitForShutdown(framework);
+    celixLauncher_destroy(framework);
+
+    printf("%i failures\n", failures);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
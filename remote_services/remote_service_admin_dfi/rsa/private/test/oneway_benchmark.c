@@ -0,0 +1,298 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+/*
+ * oneway_benchmark.c
+ *
+ * Benchmark of oneway calls against synchronous calls on loopback. Exports a service and imports it, NR_OF_CALLERS
+ * threads call a synchronous method and a oneway method of the proxy with the same arguments. The oneway run ends
+ * with a synchronous call, which first sends the queued calls, and checks that every call arrived in order. Pass
+ * "json" to disable the binary transport for the synchronous calls.
+ *
+ *  \author    	<a href="mailto:dev@celix.apache.org">Apache Celix Project Team</a>
+ *  \copyright	Apache License, Version 2.0
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <curl/curl.h>
+
+#include "celix_launcher.h"
+#include "constants.h"
+#include "framework.h"
+#include "bundle_context.h"
+#include "celix_threads.h"
+#include "remote_constants.h"
+#include "remote_service_admin.h"
+#include "remote_service_admin_dfi.h"
+#include "export_registration_dfi.h"
+#include "import_registration_dfi.h"
+
+#define NR_OF_CALLERS 8
+#define CALLS_PER_CALLER 1000
+
+#define NOTIFIER_NAME "bench.Notifier"
+
+static const char * const NOTIFIER_DESCRIPTOR =
+        ":header\n"
+        "type=interface\n"
+        "name=notifier\n"
+        "version=1.0.0\n"
+        ":annotations\n"
+        "oneway=notify(I)V\n"
+        ":types\n"
+        ":methods\n"
+        "notify(I)V=notify(#am=handle;PI)N\n"
+        "notifySync(I)V=notifySync(#am=handle;PI)N\n"
+        "count()I=count(#am=handle;P#am=pre;*I)N\n";
+
+struct notifier_service {
+    void *handle;
+    int (*notify)(void *handle, int value);
+    int (*notifySync)(void *handle, int value);
+    int (*count)(void *handle, int *count);
+};
+
+struct notifier {
+    int received;
+    int outOfOrder;
+    int last[NR_OF_CALLERS];
+};
+
+struct caller {
+    struct notifier_service *service;
+    int index;
+    bool oneway;
+    int failures;
+};
+
+static double benchmark_elapsedMs(struct timespec *begin, struct timespec *end) {
+    return (end->tv_sec - begin->tv_sec) * 1000.0 + (end->tv_nsec - begin->tv_nsec) / 1000000.0;
+}
+
+static int benchmark_notify(void *handle, int value) {
+    struct notifier *notifier = handle;
+    int caller = value / CALLS_PER_CALLER;
+
+    // the calls of one caller are invoked one after the other, in the order they were made
+    if (value <= notifier->last[caller]) {
+        __sync_add_and_fetch(&notifier->outOfOrder, 1);
+    }
+    notifier->last[caller] = value;
+    __sync_add_and_fetch(&notifier->received, 1);
+
+    return 0;
+}
+
+static int benchmark_count(void *handle, int *count) {
+    struct notifier *notifier = handle;
+    *count = __sync_add_and_fetch(&notifier->received, 0);
+    return 0;
+}
+
+static void *benchmark_call(void *data) {
+    struct caller *caller = data;
+    int i;
+
+    for (i = 0; i < CALLS_PER_CALLER; i++) {
+        int value = caller->index * CALLS_PER_CALLER + i;
+        int rc = caller->oneway ? caller->service->notify(caller->service->handle, value) : caller->service->notifySync(caller->service->handle, value);
+        if (rc != 0) {
+            caller->failures++;
+        }
+    }
+
+    return NULL;
+}
+
+static int benchmark_run(struct notifier_service *service, struct notifier *notifier, int nrOfCallers, bool oneway) {
+    struct caller callers[NR_OF_CALLERS];
+    celix_thread_t threads[NR_OF_CALLERS];
+    struct timespec begin;
+    struct timespec queued;
+    struct timespec end;
+    int failures = 0;
+    int calls = nrOfCallers * CALLS_PER_CALLER;
+    int count = 0;
+    int i;
+
+    memset(notifier, 0, sizeof(*notifier));
+    for (i = 0; i < NR_OF_CALLERS; i++) {
+        notifier->last[i] = -1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    for (i = 0; i < nrOfCallers; i++) {
+        callers[i].service = service;
+        callers[i].index = i;
+        callers[i].oneway = oneway;
+        callers[i].failures = 0;
+        celixThread_create(&threads[i], NULL, benchmark_call, &callers[i]);
+    }
+    for (i = 0; i < nrOfCallers; i++) {
+        celixThread_join(threads[i], NULL);
+        failures += callers[i].failures;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &queued);
+    // sends the calls which are still queued
+    if (service->count(service->handle, &count) != 0) {
+        failures++;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    printf("%-7s: %i calls by %i callers in %.1f ms, %.0f calls/s, callers done after %.1f ms\n", oneway ? "oneway" : "sync", calls, nrOfCallers,
+            benchmark_elapsedMs(&begin, &end), calls / (benchmark_elapsedMs(&begin, &end) / 1000.0), benchmark_elapsedMs(&begin, &queued));
+
+    if (count != calls || notifier->outOfOrder != 0) {
+        printf("%-7s: received %i of %i calls, %i out of order\n", oneway ? "oneway" : "sync", count, calls, notifier->outOfOrder);
+        failures++;
+    }
+
+    return failures;
+}
+
+int main(int argc, char **argv) {
+    framework_pt framework = NULL;
+    bundle_pt frameworkBundle = NULL;
+    bundle_context_pt context = NULL;
+    remote_service_admin_pt admin = NULL;
+    service_registration_pt registration = NULL;
+    array_list_pt exports = NULL;
+    export_reference_pt reference = NULL;
+    endpoint_description_pt exported = NULL;
+    endpoint_description_pt endpoint = NULL;
+    import_registration_pt import = NULL;
+    array_list_pt references = NULL;
+    service_reference_pt proxyReference = NULL;
+    struct notifier_service *proxy = NULL;
+    struct notifier_service service;
+    struct notifier notifier;
+    char dir[] = "/tmp/oneway_benchmark_XXXXXX";
+    char path[128];
+    char numThreads[16];
+    const char *serviceId = NULL;
+    char id[32];
+    int failures = 0;
+    FILE *descriptor;
+    int i;
+
+    if (mkdtemp(dir) == NULL) {
+        return EXIT_FAILURE;
+    }
+    // services of the framework bundle find their descriptor in the extender path
+    snprintf(path, sizeof(path), "%s/%s.descriptor", dir, NOTIFIER_NAME);
+    descriptor = fopen(path, "w");
+    if (descriptor == NULL) {
+        return EXIT_FAILURE;
+    }
+    fputs(NOTIFIER_DESCRIPTOR, descriptor);
+    fclose(descriptor);
+
+    curl_global_init(CURL_GLOBAL_ALL);
+
+    properties_pt config = properties_create();
+    snprintf(numThreads, sizeof(numThreads), "%i", NR_OF_CALLERS);
+    properties_set(config, "RSA_IP", "127.0.0.1");
+    properties_set(config, "RSA_PORT", "18894");
+    properties_set(config, "RSA_NUM_THREADS", numThreads);
+    if (argc > 1 && strcmp(argv[1], "json") == 0) {
+        properties_set(config, "RSA_BINARY", "false");
+    }
+    properties_set(config, "CELIX_FRAMEWORK_EXTENDER_PATH", dir);
+    properties_set(config, OSGI_FRAMEWORK_FRAMEWORK_STORAGE_CLEAN, OSGI_FRAMEWORK_FRAMEWORK_STORAGE_CLEAN_ONFIRSTINIT);
+    if (celixLauncher_launchWithProperties(config, &framework) != CELIX_SUCCESS) {
+        return EXIT_FAILURE;
+    }
+    framework_getFrameworkBundle(framework, &frameworkBundle);
+    bundle_getContext(frameworkBundle, &context);
+
+    if (remoteServiceAdmin_create(context, &admin) != CELIX_SUCCESS) {
+        return EXIT_FAILURE;
+    }
+
+    properties_pt properties = properties_create();
+    service.handle = &notifier;
+    service.notify = benchmark_notify;
+    service.notifySync = benchmark_notify;
+    service.count = benchmark_count;
+    properties_set(properties, (char *) OSGI_RSA_SERVICE_EXPORTED_INTERFACES, NOTIFIER_NAME);
+    bundleContext_registerService(context, NOTIFIER_NAME, &service, properties, &registration);
+    serviceRegistration_getProperties(registration, &properties);
+    serviceId = properties_get(properties, (char *) OSGI_FRAMEWORK_SERVICE_ID);
+    snprintf(id, sizeof(id), "%s", serviceId != NULL ? serviceId : "");
+
+    if (remoteServiceAdmin_exportService(admin, id, NULL, &exports) != CELIX_SUCCESS || arrayList_size(exports) != 1) {
+        printf("Cannot export %s\n", NOTIFIER_NAME);
+        return EXIT_FAILURE;
+    }
+    exportRegistration_getExportReference(arrayList_get(exports, 0), &reference);
+    exportReference_getExportedEndpoint(reference, &exported);
+
+    properties_copy(exported->properties, &properties);
+    properties_set(properties, "bench.imported", "true");
+    endpointDescription_create(properties, &endpoint);
+    if (remoteServiceAdmin_importService(admin, endpoint, &import) != CELIX_SUCCESS) {
+        printf("Cannot import %s\n", NOTIFIER_NAME);
+        return EXIT_FAILURE;
+    }
+
+    bundleContext_getServiceReferences(context, NOTIFIER_NAME, "(bench.imported=true)", &references);
+    if (references != NULL && arrayList_size(references) == 1) {
+        proxyReference = arrayList_get(references, 0);
+        bundleContext_getService(context, proxyReference, (void **) &proxy);
+    }
+    if (proxy == NULL) {
+        printf("Cannot get the proxy\n");
+        failures++;
+    } else {
+        bool result = false;
+        failures += benchmark_run(proxy, &notifier, 1, false);
+        failures += benchmark_run(proxy, &notifier, 1, true);
+        failures += benchmark_run(proxy, &notifier, NR_OF_CALLERS, false);
+        failures += benchmark_run(proxy, &notifier, NR_OF_CALLERS, true);
+        bundleContext_ungetService(context, proxyReference, &result);
+    }
+    if (references != NULL) {
+        for (i = 0; i < arrayList_size(references); i++) {
+            bundleContext_ungetServiceReference(context, arrayList_get(references, i));
+        }
+        arrayList_destroy(references);
+    }
+
+    remoteServiceAdmin_removeImportedService(admin, import);
+    endpointDescription_destroy(endpoint);
+    free(reference);
+    remoteServiceAdmin_removeExportedService(admin, arrayList_get(exports, 0));
+    serviceRegistration_unregister(registration);
+
+    remoteServiceAdmin_stop(admin);
+    remoteServiceAdmin_destroy(&admin);
+
+    celixLauncher_stop(framework);
+    celixLauncher_waitForShutdown(framework);
+    celixLauncher_destroy(framework);
+
+    curl_global_cleanup();
+    unlink(path);
+    rmdir(dir);
+
+    printf("%i failures\n", failures);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -30,6 +30,7 @@ extern "C" {
 	#include <string.h>
 	#include <ctype.h>
 	#include <unistd.h>
+	#include <time.h>
 
 	#include "celix_launcher.h"
 	#include "framework.h"
@@ -397,6 +398,71 @@ extern "C" {
 		arrayList_destroy(rsaBundles);
 	}
 
+	static double elapsedMs(struct timespec* begin, struct timespec* end) {
+		return (end->tv_sec - begin->tv_sec) * 1000.0 + (end->tv_nsec - begin->tv_nsec) / 1000000.0;
+	}
+
+	/* waits at most timeoutInMs until the calculator service is (un)available in the client framework */
+	static bool waitForCalculator(bool available, int timeoutInMs) {
+		service_reference_pt ref = NULL;
+		int waited = 0;
+
+		for (;;) {
+			ref = NULL;
+			bundleContext_getServiceReference(clientContext, (char *) CALCULATOR_SERVICE, &ref);
+			if (ref != NULL) {
+				bundleContext_ungetServiceReference(clientContext, ref);
+			}
+			if ((ref != NULL) == available || waited >= timeoutInMs) {
+				break;
+			}
+			usleep(10000);
+			waited += 10;
+		}
+
+		return (ref != NULL) == available;
+	}
+
+	static void testEndpointPropagationLatency(void) {
+		celix_status_t status;
+		array_list_pt bundleNames = NULL;
+		array_list_pt discoveryBundles = NULL;
+		bundle_pt bundle = NULL;
+		struct timespec begin;
+		struct timespec end;
+
+		arrayList_create(&bundleNames);
+		arrayList_create(&discoveryBundles);
+
+		arrayList_add(bundleNames, (void*) DISCOVERY_CFG_NAME);
+		status = getSpecifiedBundles(serverContext, bundleNames, discoveryBundles);
+		CHECK_EQUAL(CELIX_SUCCESS, status);
+		CHECK_EQUAL(arrayList_size(bundleNames), arrayList_size(discoveryBundles));
+
+		status = bundleContext_getBundleById(serverContext, (long) arrayList_get(discoveryBundles, 0), &bundle);
+		CHECK_EQUAL(CELIX_SUCCESS, status);
+
+		CHECK(waitForCalculator(true, 10000));
+
+		// removing the server discovery should remove the imported calculator from the client
+		status = bundle_stop(bundle);
+		CHECK_EQUAL(CELIX_SUCCESS, status);
+		CHECK(waitForCalculator(false, 10000));
+
+		clock_gettime(CLOCK_MONOTONIC, &begin);
+		status = bundle_start(bundle);
+		CHECK_EQUAL(CELIX_SUCCESS, status);
+		CHECK(waitForCalculator(true, 10000));
+		clock_gettime(CLOCK_MONOTONIC, &end);
+
+		printf("Endpoint propagation latency: %.3f ms\n", elapsedMs(&begin, &end));
+		// the shm watcher is woken up on change, only the endpoint poll interval (1s) should contribute to the latency
+		CHECK(elapsedMs(&begin, &end) < 3000.0);
+
+		arrayList_destroy(bundleNames);
+		arrayList_destroy(discoveryBundles);
+	}
+
 	/*
 	static void testProxyRemoval(void) {
 		celix_status_t status;
@@ -483,6 +549,10 @@ TEST(RsaShmClientServerTests, TestExport) {
 	testExport();
 }
 
+TEST(RsaShmClientServerTests, TestEndpointPropagationLatency) {
+	testEndpointPropagationLatency();
+}
+
 /*
 TEST(RsaShmClientServerTests, TestProxyRemoval) {
 	// test is currenlty failing
@@ -232,6 +232,7 @@ celix_status_t bundleActivator_start(void * userData, bundle_context_pt context)
 		status = CELIX_DO_IF(status, serviceReference_getProperty(reference, OSGI_FRAMEWORK_SERVICE_ID, &serviceId));
 
 		CELIX_DO_IF(status, topologyManager_addExportedService(activator->manager, reference, (char*)serviceId));
+		bundleContext_ungetServiceReference(context, reference);
 	}
 	arrayList_destroy(references);
 
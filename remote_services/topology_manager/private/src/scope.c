@@ -33,6 +33,7 @@
 
 struct scope_item {
     properties_pt props;
+    filter_pt filter;   // parsed once, NULL if the filter is not parseable
 };
 
 struct scope {
@@ -74,6 +75,7 @@ celix_status_t tm_addExportScope(void *handle, char *filter, properties_pt props
                 status = CELIX_ENOMEM;
             } else {
                 item->props = props;
+                item->filter = filter_create(filter);
                 hashMap_put(scope->exportScopes, (void*) strdup(filter), (void*) item);
             }
         } else {
@@ -99,12 +101,18 @@ celix_status_t tm_removeExportScope(void *handle, char *filter) {
         return CELIX_ILLEGAL_ARGUMENT;
 
     if (celixThreadMutex_lock(&scope->exportScopeLock) == CELIX_SUCCESS) {
-        struct scope_item *present = (struct scope_item *) hashMap_get(scope->exportScopes, filter);
-        if (present == NULL) {
+        hash_map_entry_pt entry = hashMap_getEntry(scope->exportScopes, filter);
+        if (entry == NULL) {
             status = CELIX_ILLEGAL_ARGUMENT;
         } else {
+            char *key = (char *) hashMapEntry_getKey(entry);
+            struct scope_item *present = (struct scope_item *) hashMap_remove(scope->exportScopes, filter);
             properties_destroy(present->props);
-            hashMap_remove(scope->exportScopes, filter); // frees also the item!
+            if (present->filter != NULL) {
+                filter_destroy(present->filter);
+            }
+            free(present);
+            free(key);
         }
         celixThreadMutex_unlock(&scope->exportScopeLock);
     }
@@ -216,6 +224,9 @@ celix_status_t scope_scopeDestroy(scope_pt scope) {
             hash_map_entry_pt scopedEntry = hashMapIterator_nextEntry(iter);
             struct scope_item *item = (struct scope_item*) hashMapEntry_getValue(scopedEntry);
             properties_destroy(item->props);
+            if (item->filter != NULL) {
+                filter_destroy(item->filter);
+            }
         }
         hashMapIterator_destroy(iter);
         hashMap_destroy(scope->exportScopes, true, true); // free keys, free values
@@ -304,17 +315,14 @@ celix_status_t scope_getExportProperties(scope_pt scope, service_reference_pt re
         //       the additional output properties for each filter that matches?
         while ((!found) && hashMapIterator_hasNext(scopedPropIter)) {
             hash_map_entry_pt scopedEntry = hashMapIterator_nextEntry(scopedPropIter);
-            char *filterStr = (char *) hashMapEntry_getKey(scopedEntry);
-            filter_pt filter = filter_create(filterStr);
-            if (filter != NULL) {
+            struct scope_item *item = (struct scope_item *) hashMapEntry_getValue(scopedEntry);
+            if (item->filter != NULL) {
                 // test if the scope filter matches the exported service properties
-                status = filter_match(filter, serviceProperties, &found);
+                status = filter_match(item->filter, serviceProperties, &found);
                 if (found) {
-                    struct scope_item *item = (struct scope_item *) hashMapEntry_getValue(scopedEntry);
                     *props = item->props;
                 }
             }
-            filter_destroy(filter);
         }
         hashMapIterator_destroy(scopedPropIter);
         properties_destroy(serviceProperties);
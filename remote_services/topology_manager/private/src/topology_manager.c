@@ -26,6 +26,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 
 #include "celixbool.h"
 #include "topology_manager.h"
@@ -44,7 +45,20 @@
 #include "topology_manager.h"
 #include "scope.h"
 #include "hash_map.h"
+#include "celix_threads.h"
 
+#define TM_EXPORT_UPDATE	1	// export to every RSA which does not export the service yet
+#define TM_EXPORT_REEXPORT	2	// close all exports of the service and export it again
+
+/*
+ * The topology manager keeps a desired state (exportable services keyed on service id, announced endpoints keyed
+ * on endpoint id) and an actual state (export/import registrations per RSA). Service events, new RSAs, new
+ * endpoint listeners and scope changes only mark the affected ids dirty; the reconcile thread diffs the desired
+ * against the actual state for the dirty ids in batches. Removals are handled directly by the caller, because the
+ * underlying service or RSA is about to disappear.
+ *
+ * Lock order: rsaListLock -> exportedServicesLock -> importedServicesLock -> listenerListLock -> changesLock
+ */
 struct topology_manager {
 	bundle_context_pt context;
 
@@ -53,25 +67,59 @@ struct topology_manager {
 	array_list_pt rsaList;
 
 	celix_thread_mutex_t listenerListLock;
-	hash_map_pt listenerList;
+	hash_map_pt listenerList;				// service reference -> struct endpoint_listener_entry
 
 	celix_thread_mutex_t exportedServicesLock;
-	hash_map_pt exportedServices;
+	hash_map_pt exportedServices;			// service id -> hash map (rsa -> array list of export registrations)
 
 	celix_thread_mutex_t importedServicesLock;
 	celix_thread_mutexattr_t importedServicesLockAttr;
-	hash_map_pt importedServices;
+	hash_map_pt importedServices;			// endpoint id -> struct imported_service
+
+	celix_thread_mutex_t changesLock;
+	celix_thread_cond_t changesCond;
+	hash_map_pt exportableServices;			// service id -> retained service reference
+	hash_map_pt dirtyExports;				// service id -> TM_EXPORT_UPDATE or TM_EXPORT_REEXPORT
+	array_list_pt changedExportScopes;		// filters of added/removed export scopes
+	bool allExportsDirty;
+	bool allImportsDirty;
+	bool listenersDirty;
+	unsigned long submitted;
+	unsigned long processed;
+	bool running;
+	celix_thread_t reconcileThread;
 
 	scope_pt scope;
 
 	log_helper_pt loghelper;
 };
 
+struct imported_service {
+	endpoint_description_pt endpoint;
+	hash_map_pt imports;					// rsa -> import registration
+};
+
+struct endpoint_listener_entry {
+	endpoint_listener_pt listener;
+	char *scope;
+	filter_pt filter;
+	bool announced;							// false until all current exports are announced to the listener
+};
+
 celix_status_t topologyManager_exportScopeChanged(void *handle, char *service_name);
 celix_status_t topologyManager_importScopeChanged(void *handle, char *service_name);
 celix_status_t topologyManager_notifyListenersEndpointAdded(topology_manager_pt manager, remote_service_admin_service_pt rsa, array_list_pt registrations);
 celix_status_t topologyManager_notifyListenersEndpointRemoved(topology_manager_pt manager, remote_service_admin_service_pt rsa, export_registration_pt export);
 
+static void *topologyManager_reconcile(void *data);
+static void topologyManager_submitLocked(topology_manager_pt manager);
+static void topologyManager_waitForReconcile(topology_manager_pt manager);
+static void topologyManager_markExportDirtyLocked(topology_manager_pt manager, const char *serviceId, int mode);
+static celix_status_t topologyManager_closeExportRegistrations(topology_manager_pt manager, hash_map_pt exports, remote_service_admin_service_pt rsa);
+static celix_status_t topologyManager_closeImportRegistrations(topology_manager_pt manager, struct imported_service *imported, remote_service_admin_service_pt rsa);
+static celix_status_t topologyManager_reconcileImport(topology_manager_pt manager, struct imported_service *imported);
+static void topologyManager_destroyListenerEntry(struct endpoint_listener_entry *entry);
+
 celix_status_t topologyManager_create(bundle_context_pt context, log_helper_pt logHelper, topology_manager_pt *manager, void **scope) {
 	celix_status_t status = CELIX_SUCCESS;
 
@@ -97,10 +145,15 @@ celix_status_t topologyManager_create(bundle_context_pt context, log_helper_pt l
 
 	celixThreadMutex_create(&(*manager)->exportedServicesLock, NULL);
 	celixThreadMutex_create(&(*manager)->listenerListLock, NULL);
+	celixThreadMutex_create(&(*manager)->changesLock, NULL);
+	celixThreadCondition_init(&(*manager)->changesCond, NULL);
 
 	(*manager)->listenerList = hashMap_create(serviceReference_hashCode, NULL, serviceReference_equals2, NULL);
-	(*manager)->exportedServices = hashMap_create(serviceReference_hashCode, NULL, serviceReference_equals2, NULL);
-	(*manager)->importedServices = hashMap_create(NULL, NULL, NULL, NULL);
+	(*manager)->exportedServices = hashMap_create(utils_stringHash, NULL, utils_stringEquals, NULL);
+	(*manager)->importedServices = hashMap_create(utils_stringHash, NULL, utils_stringEquals, NULL);
+	(*manager)->exportableServices = hashMap_create(utils_stringHash, NULL, utils_stringEquals, NULL);
+	(*manager)->dirtyExports = hashMap_create(utils_stringHash, NULL, utils_stringEquals, NULL);
+	arrayList_create(&(*manager)->changedExportScopes);
 
 	status = scope_scopeCreate(*manager, &(*manager)->scope);
 	scope_setExportScopeChangedCallback((*manager)->scope, topologyManager_exportScopeChanged);
@@ -109,6 +162,13 @@ celix_status_t topologyManager_create(bundle_context_pt context, log_helper_pt l
 
 	(*manager)->loghelper = logHelper;
 
+	if (status == CELIX_SUCCESS) {
+		(*manager)->running = true;
+		status = celixThread_create(&(*manager)->reconcileThread, NULL, topologyManager_reconcile, *manager);
+		if (status != CELIX_SUCCESS) {
+			(*manager)->running = false;
+		}
+	}
 
 	return status;
 }
@@ -116,7 +176,22 @@ celix_status_t topologyManager_create(bundle_context_pt context, log_helper_pt l
 celix_status_t topologyManager_destroy(topology_manager_pt manager) {
 	celix_status_t status = CELIX_SUCCESS;
 
+	celixThreadMutex_lock(&manager->changesLock);
+	bool running = manager->running;
+	manager->running = false;
+	celixThreadCondition_broadcast(&manager->changesCond);
+	celixThreadMutex_unlock(&manager->changesLock);
+
+	if (running) {
+		celixThread_join(manager->reconcileThread, NULL);
+	}
+
 	celixThreadMutex_lock(&manager->listenerListLock);
+	hash_map_iterator_pt iter = hashMapIterator_create(manager->listenerList);
+	while (hashMapIterator_hasNext(iter)) {
+		topologyManager_destroyListenerEntry(hashMapIterator_nextValue(iter));
+	}
+	hashMapIterator_destroy(iter);
 	hashMap_destroy(manager->listenerList, false, false);
 
 	celixThreadMutex_unlock(&manager->listenerListLock);
@@ -132,19 +207,50 @@ celix_status_t topologyManager_destroy(topology_manager_pt manager) {
 
 	celixThreadMutex_lock(&manager->exportedServicesLock);
 
-	hashMap_destroy(manager->exportedServices, false, false);
+	iter = hashMapIterator_create(manager->exportedServices);
+	while (hashMapIterator_hasNext(iter)) {
+		hashMap_destroy(hashMapIterator_nextValue(iter), false, false);
+	}
+	hashMapIterator_destroy(iter);
+	hashMap_destroy(manager->exportedServices, true, false);
 
 	celixThreadMutex_unlock(&manager->exportedServicesLock);
 	celixThreadMutex_destroy(&manager->exportedServicesLock);
 
 	celixThreadMutex_lock(&manager->importedServicesLock);
 
-	hashMap_destroy(manager->importedServices, false, false);
+	iter = hashMapIterator_create(manager->importedServices);
+	while (hashMapIterator_hasNext(iter)) {
+		struct imported_service *imported = hashMapIterator_nextValue(iter);
+		hashMap_destroy(imported->imports, false, false);
+		free(imported);
+	}
+	hashMapIterator_destroy(iter);
+	hashMap_destroy(manager->importedServices, true, false);
 
 	celixThreadMutex_unlock(&manager->importedServicesLock);
 	celixThreadMutex_destroy(&manager->importedServicesLock);
 	celixThreadMutexAttr_destroy(&manager->importedServicesLockAttr);
 
+	celixThreadMutex_lock(&manager->changesLock);
+
+	iter = hashMapIterator_create(manager->exportableServices);
+	while (hashMapIterator_hasNext(iter)) {
+		bundleContext_ungetServiceReference(manager->context, hashMapIterator_nextValue(iter));
+	}
+	hashMapIterator_destroy(iter);
+	hashMap_destroy(manager->exportableServices, true, false);
+	hashMap_destroy(manager->dirtyExports, true, false);
+
+	for (int i = 0; i < arrayList_size(manager->changedExportScopes); i++) {
+		filter_destroy(arrayList_get(manager->changedExportScopes, i));
+	}
+	arrayList_destroy(manager->changedExportScopes);
+
+	celixThreadMutex_unlock(&manager->changesLock);
+	celixThreadCondition_destroy(&manager->changesCond);
+	celixThreadMutex_destroy(&manager->changesLock);
+
 	scope_scopeDestroy(manager->scope);
 	free(manager);
 
@@ -159,30 +265,16 @@ celix_status_t topologyManager_closeImports(topology_manager_pt manager) {
 	hash_map_iterator_pt iter = hashMapIterator_create(manager->importedServices);
 	while (hashMapIterator_hasNext(iter)) {
 		hash_map_entry_pt entry = hashMapIterator_nextEntry(iter);
-		endpoint_description_pt ep = hashMapEntry_getKey(entry);
-		hash_map_pt imports = hashMapEntry_getValue(entry);
-
-		if (imports != NULL) {
-			logHelper_log(manager->loghelper, OSGI_LOGSERVICE_INFO, "TOPOLOGY_MANAGER: Remove imported service (%s; %s).", ep->service, ep->id);
-			hash_map_iterator_pt importsIter = hashMapIterator_create(imports);
+		char *endpointId = hashMapEntry_getKey(entry);
+		struct imported_service *imported = hashMapEntry_getValue(entry);
 
-			while (hashMapIterator_hasNext(importsIter)) {
-				hash_map_entry_pt entry = hashMapIterator_nextEntry(importsIter);
+		logHelper_log(manager->loghelper, OSGI_LOGSERVICE_INFO, "TOPOLOGY_MANAGER: Remove imported service (%s; %s).", imported->endpoint->service, endpointId);
+		topologyManager_closeImportRegistrations(manager, imported, NULL);
 
-				remote_service_admin_service_pt rsa = hashMapEntry_getKey(entry);
-				import_registration_pt import = hashMapEntry_getValue(entry);
-
-				status = rsa->importRegistration_close(rsa->admin, import);
-				if (status == CELIX_SUCCESS) {
-					hashMapIterator_remove(importsIter);
-				}
-			}
-			hashMapIterator_destroy(importsIter);
-
-			hashMapIterator_remove(iter);
-
-			hashMap_destroy(imports, false, false);
-		}
+		hashMapIterator_remove(iter);
+		hashMap_destroy(imported->imports, false, false);
+		free(imported);
+		free(endpointId);
 	}
 	hashMapIterator_destroy(iter);
 
@@ -203,7 +295,6 @@ celix_status_t topologyManager_rsaAdding(void * handle, service_reference_pt ref
 celix_status_t topologyManager_rsaAdded(void * handle, service_reference_pt reference, void * service) {
 	celix_status_t status;
 	topology_manager_pt manager = (topology_manager_pt) handle;
-	properties_pt serviceProperties = NULL;
 	remote_service_admin_service_pt rsa = (remote_service_admin_service_pt) service;
 	logHelper_log(manager->loghelper, OSGI_LOGSERVICE_INFO, "TOPOLOGY_MANAGER: Added RSA");
 
@@ -214,76 +305,15 @@ celix_status_t topologyManager_rsaAdded(void * handle, service_reference_pt refe
 		status = celixThreadMutex_unlock(&manager->rsaListLock);
 	}
 
-	// add already imported services to new rsa
+	// already exported and imported services are added to the new rsa by the reconcile thread
 	if (status == CELIX_SUCCESS) {
-		status = celixThreadMutex_lock(&manager->importedServicesLock);
-
-		if (status == CELIX_SUCCESS) {
-			hash_map_iterator_pt importedServicesIterator = hashMapIterator_create(manager->importedServices);
-
-			while (hashMapIterator_hasNext(importedServicesIterator)) {
-				hash_map_entry_pt entry = hashMapIterator_nextEntry(importedServicesIterator);
-				endpoint_description_pt endpoint = hashMapEntry_getKey(entry);
-				if (scope_allowImport(manager->scope, endpoint)) {
-					import_registration_pt import = NULL;
-					status = rsa->importService(rsa->admin, endpoint, &import);
-
-					if (status == CELIX_SUCCESS) {
-						hash_map_pt imports = hashMapEntry_getValue(entry);
-
-						if (imports == NULL) {
-							imports = hashMap_create(NULL, NULL, NULL, NULL);
-							hashMap_put(manager->importedServices,endpoint,imports);
-						}
-
-						hashMap_put(imports, service, import);
-					}
-				}
-			}
-
-			hashMapIterator_destroy(importedServicesIterator);
-
-			celixThreadMutex_unlock(&manager->importedServicesLock);
-		}
+		celixThreadMutex_lock(&manager->changesLock);
+		manager->allExportsDirty = true;
+		manager->allImportsDirty = true;
+		topologyManager_submitLocked(manager);
+		celixThreadMutex_unlock(&manager->changesLock);
 	}
 
-	// add already exported services to new rsa
-	if (status == CELIX_SUCCESS) {
-		status = celixThreadMutex_lock(&manager->exportedServicesLock);
-
-		if (status == CELIX_SUCCESS) {
-			hash_map_iterator_pt exportedServicesIterator = hashMapIterator_create(manager->exportedServices);
-
-			while (hashMapIterator_hasNext(exportedServicesIterator)) {
-				hash_map_entry_pt entry = hashMapIterator_nextEntry(exportedServicesIterator);
-				service_reference_pt reference = hashMapEntry_getKey(entry);
-				const char* serviceId = NULL;
-
-				serviceReference_getProperty(reference, OSGI_FRAMEWORK_SERVICE_ID, &serviceId);
-
-				scope_getExportProperties(manager->scope, reference, &serviceProperties);
-
-				array_list_pt endpoints = NULL;
-				status = rsa->exportService(rsa->admin, (char*)serviceId, serviceProperties, &endpoints);
-
-				if (status == CELIX_SUCCESS) {
-					hash_map_pt exports = hashMapEntry_getValue(entry);
-
-					if (exports == NULL) {
-						exports = hashMap_create(NULL, NULL, NULL, NULL);
-						hashMap_put(manager->exportedServices,reference,exports);
-					}
-
-					hashMap_put(exports, rsa, endpoints);
-					status = topologyManager_notifyListenersEndpointAdded(manager, rsa, endpoints);
-				}
-			}
-
-			hashMapIterator_destroy(exportedServicesIterator);
-
-			celixThreadMutex_unlock(&manager->exportedServicesLock);
-		}
-	}
 	return status;
 }
 
@@ -300,73 +330,44 @@ celix_status_t topologyManager_rsaRemoved(void * handle, service_reference_pt re
 	topology_manager_pt manager = (topology_manager_pt) handle;
 	remote_service_admin_service_pt rsa = (remote_service_admin_service_pt) service;
 
-	if (celixThreadMutex_lock(&manager->exportedServicesLock) == CELIX_SUCCESS) {
-		hash_map_iterator_pt iter = hashMapIterator_create(manager->exportedServices);
-
-		while (hashMapIterator_hasNext(iter)) {
-
-			hash_map_entry_pt entry = hashMapIterator_nextEntry(iter);
-			service_reference_pt key = hashMapEntry_getKey(entry);
-			hash_map_pt exports = hashMapEntry_getValue(entry);
+	if (celixThreadMutex_lock(&manager->rsaListLock) == CELIX_SUCCESS) {
+		arrayList_removeElement(manager->rsaList, rsa);
 
-			/*
-			 * the problem here is that also the rsa has a a list of
-			 * endpoints which is destroyed when closing the exportRegistration
-			 */
-			array_list_pt exports_list = hashMap_get(exports, rsa);
-
-			if (exports_list != NULL) {
-				int exportsIter = 0;
-				int exportListSize = arrayList_size(exports_list);
-				for (exportsIter = 0; exports_list != NULL && exportsIter < exportListSize; exportsIter++) {
-					export_registration_pt export = arrayList_get(exports_list, exportsIter);
-					topologyManager_notifyListenersEndpointRemoved(manager, rsa, export);
-					rsa->exportRegistration_close(rsa->admin, export);
-				}
-			}
+		if (celixThreadMutex_lock(&manager->exportedServicesLock) == CELIX_SUCCESS) {
+			hash_map_iterator_pt iter = hashMapIterator_create(manager->exportedServices);
 
-			hashMap_remove(exports, rsa);
-			/*if(exports_list!=NULL){
-            	arrayList_destroy(exports_list);
-            }*/
+			while (hashMapIterator_hasNext(iter)) {
+				hash_map_entry_pt entry = hashMapIterator_nextEntry(iter);
+				char *serviceId = hashMapEntry_getKey(entry);
+				hash_map_pt exports = hashMapEntry_getValue(entry);
 
-			if (hashMap_size(exports) == 0) {
-				hashMap_remove(manager->exportedServices, key);
-				hashMap_destroy(exports, false, false);
+				topologyManager_closeExportRegistrations(manager, exports, rsa);
 
-				hashMapIterator_destroy(iter);
-				iter = hashMapIterator_create(manager->exportedServices);
+				if (hashMap_size(exports) == 0) {
+					hashMapIterator_remove(iter);
+					hashMap_destroy(exports, false, false);
+					free(serviceId);
+				}
 			}
+			hashMapIterator_destroy(iter);
+			celixThreadMutex_unlock(&manager->exportedServicesLock);
 		}
-		hashMapIterator_destroy(iter);
-		celixThreadMutex_unlock(&manager->exportedServicesLock);
-	}
 
-	if (celixThreadMutex_lock(&manager->importedServicesLock) == CELIX_SUCCESS) {
-		hash_map_iterator_pt iter = hashMapIterator_create(manager->importedServices);
+		if (celixThreadMutex_lock(&manager->importedServicesLock) == CELIX_SUCCESS) {
+			hash_map_iterator_pt iter = hashMapIterator_create(manager->importedServices);
 
-		while (hashMapIterator_hasNext(iter)) {
-			hash_map_entry_pt entry = hashMapIterator_nextEntry(iter);
-			hash_map_pt imports = hashMapEntry_getValue(entry);
-
-			import_registration_pt import = hashMap_get(imports, rsa);
-
-			if (import != NULL) {
-				celix_status_t subStatus = rsa->importRegistration_close(rsa->admin, import);
+			while (hashMapIterator_hasNext(iter)) {
+				struct imported_service *imported = hashMapIterator_nextValue(iter);
+				celix_status_t subStatus = topologyManager_closeImportRegistrations(manager, imported, rsa);
 
-				if (subStatus == CELIX_SUCCESS) {
-					hashMap_remove(imports, rsa);
-				} else {
+				if (subStatus != CELIX_SUCCESS) {
 					status = subStatus;
 				}
 			}
+			hashMapIterator_destroy(iter);
+			celixThreadMutex_unlock(&manager->importedServicesLock);
 		}
-		hashMapIterator_destroy(iter);
-		celixThreadMutex_unlock(&manager->importedServicesLock);
-	}
 
-	if (celixThreadMutex_lock(&manager->rsaListLock) == CELIX_SUCCESS) {
-		arrayList_removeElement(manager->rsaList, rsa);
 		celixThreadMutex_unlock(&manager->rsaListLock);
 	}
 
@@ -386,7 +387,7 @@ celix_status_t topologyManager_serviceChanged(void *listener, service_event_pt e
 	serviceReference_getProperty(event->reference, OSGI_RSA_SERVICE_EXPORTED_INTERFACES, &export);
 	serviceReference_getProperty(event->reference, OSGI_FRAMEWORK_SERVICE_ID, &serviceId);
 
-	if (!export) {
+	if (!export && event->type != OSGI_FRAMEWORK_SERVICE_EVENT_MODIFIED_ENDMATCH) {
 		// Nothing needs to be done: we're not interested...
 		return status;
 	}
@@ -396,16 +397,18 @@ celix_status_t topologyManager_serviceChanged(void *listener, service_event_pt e
 		status = topologyManager_addExportedService(manager, event->reference, (char*)serviceId);
 		break;
 	case OSGI_FRAMEWORK_SERVICE_EVENT_MODIFIED:
-		status = topologyManager_removeExportedService(manager, event->reference, (char*)serviceId);
+		status = topologyManager_addExportedService(manager, event->reference, (char*)serviceId);
 
 		if (status == CELIX_SUCCESS) {
-			status = topologyManager_addExportedService(manager, event->reference, (char*)serviceId);
+			celixThreadMutex_lock(&manager->changesLock);
+			topologyManager_markExportDirtyLocked(manager, serviceId, TM_EXPORT_REEXPORT);
+			topologyManager_submitLocked(manager);
+			celixThreadMutex_unlock(&manager->changesLock);
 		}
 		break;
 	case OSGI_FRAMEWORK_SERVICE_EVENT_UNREGISTERING:
-		status = topologyManager_removeExportedService(manager, event->reference, (char*)serviceId);
-		break;
 	case OSGI_FRAMEWORK_SERVICE_EVENT_MODIFIED_ENDMATCH:
+		status = topologyManager_removeExportedService(manager, event->reference, (char*)serviceId);
 		break;
 	}
 
@@ -413,114 +416,36 @@ celix_status_t topologyManager_serviceChanged(void *listener, service_event_pt e
 }
 
 celix_status_t topologyManager_exportScopeChanged(void *handle, char *filterStr) {
-	celix_status_t status = CELIX_SUCCESS;
 	topology_manager_pt manager = (topology_manager_pt) handle;
-	service_registration_pt reg = NULL;
-	const char* serviceId = NULL;
-	bool found;
-	properties_pt props;
 	filter_pt filter = filter_create(filterStr);
 
 	if (filter == NULL) {
-		printf("filter creating failed\n");
+		logHelper_log(manager->loghelper, OSGI_LOGSERVICE_ERROR, "TOPOLOGY_MANAGER: Invalid export scope filter %s.", filterStr);
 		return CELIX_ENOMEM;
 	}
 
-	// add already exported services to new rsa
-	if (celixThreadMutex_lock(&manager->exportedServicesLock) == CELIX_SUCCESS) {
-		hash_map_iterator_pt exportedServicesIterator = hashMapIterator_create(manager->exportedServices);
-		int size = hashMap_size(manager->exportedServices);
-		service_reference_pt *srvRefs = (service_reference_pt *) calloc(size, sizeof(service_reference_pt));
-		char **srvIds = (char **) calloc(size, sizeof(char*));
-		int nrFound = 0;
-
-		found = false;
-
-		while (hashMapIterator_hasNext(exportedServicesIterator)) {
-			hash_map_entry_pt entry = hashMapIterator_nextEntry(exportedServicesIterator);
-			service_reference_pt reference = hashMapEntry_getKey(entry);
-			reg = NULL;
-			serviceReference_getServiceRegistration(reference, &reg);
-			if (reg != NULL) {
-				props = NULL;
-				serviceRegistration_getProperties(reg, &props);
-				status = filter_match(filter, props, &found);
-				if (found) {
-					srvRefs[nrFound] = reference;
-					serviceReference_getProperty(reference, OSGI_FRAMEWORK_SERVICE_ID, &serviceId);
-					srvIds[nrFound++] = (char*)serviceId;
-				}
-			}
-		}
-
-		hashMapIterator_destroy(exportedServicesIterator);
-		celixThreadMutex_unlock(&manager->exportedServicesLock);
-
-		if (nrFound > 0) {
-			for (int i = 0; i < nrFound; i++) {
-				// Question: can srvRefs become invalid meanwhile??
-				const char* export = NULL;
-				serviceReference_getProperty(srvRefs[i], (char *) OSGI_RSA_SERVICE_EXPORTED_INTERFACES, &export);
-
-				if (export) {
-					celix_status_t substatus = topologyManager_removeExportedService(manager, srvRefs[i], srvIds[i]);
-
-					if (substatus != CELIX_SUCCESS) {
-						logHelper_log(manager->loghelper, OSGI_LOGSERVICE_ERROR, "TOPOLOGY_MANAGER: Removal of exported service (%s) failed.", srvIds[i]);
-					} else {
-						substatus = topologyManager_addExportedService(manager, srvRefs[i], srvIds[i]);
-					}
-
-					if (substatus != CELIX_SUCCESS) {
-						status = substatus;
-					}
-				}
-			}
-		}
-
-		free(srvRefs);
-		free(srvIds);
-	}
+	// the reconcile thread re-exports the exportable services matching the filter
+	celixThreadMutex_lock(&manager->changesLock);
+	arrayList_add(manager->changedExportScopes, filter);
+	topologyManager_submitLocked(manager);
+	celixThreadMutex_unlock(&manager->changesLock);
 
-	filter_destroy(filter);
+	topologyManager_waitForReconcile(manager);
 
-	return status;
+	return CELIX_SUCCESS;
 }
 
 celix_status_t topologyManager_importScopeChanged(void *handle, char *service_name) {
-	celix_status_t status = CELIX_SUCCESS;
-	endpoint_description_pt endpoint;
 	topology_manager_pt manager = (topology_manager_pt) handle;
-	bool found = false;
 
-	// add already exported services to new rsa
-	if (celixThreadMutex_lock(&manager->importedServicesLock) == CELIX_SUCCESS) {
-		hash_map_iterator_pt importedServicesIterator = hashMapIterator_create(manager->importedServices);
-		while (!found && hashMapIterator_hasNext(importedServicesIterator)) {
-			hash_map_entry_pt entry = hashMapIterator_nextEntry(importedServicesIterator);
-			endpoint = hashMapEntry_getKey(entry);
-
-			entry = hashMap_getEntry(endpoint->properties, (void *) OSGI_FRAMEWORK_OBJECTCLASS);
-			char* name = (char *) hashMapEntry_getValue(entry);
-			// Test if a service with the same name is imported
-			if (strcmp(name, service_name) == 0) {
-				found = true;
-			}
-		}
-		hashMapIterator_destroy(importedServicesIterator);
-		celixThreadMutex_unlock(&manager->importedServicesLock);
-	}
+	celixThreadMutex_lock(&manager->changesLock);
+	manager->allImportsDirty = true;
+	topologyManager_submitLocked(manager);
+	celixThreadMutex_unlock(&manager->changesLock);
 
-	if (found) {
-		status = topologyManager_removeImportedService(manager, endpoint, NULL);
+	topologyManager_waitForReconcile(manager);
 
-		if (status != CELIX_SUCCESS) {
-			logHelper_log(manager->loghelper, OSGI_LOGSERVICE_ERROR, "TOPOLOGY_MANAGER: Removal of imported service (%s; %s) failed.", endpoint->service, endpoint->id);
-		} else {
-			status = topologyManager_addImportedService(manager, endpoint, NULL);
-		}
-	}
-	return status;
+	return CELIX_SUCCESS;
 }
 
 celix_status_t topologyManager_addImportedService(void *handle, endpoint_description_pt endpoint, char *matchedFilter) {
@@ -529,34 +454,33 @@ celix_status_t topologyManager_addImportedService(void *handle, endpoint_descrip
 
 	logHelper_log(manager->loghelper, OSGI_LOGSERVICE_INFO, "TOPOLOGY_MANAGER: Add imported service (%s; %s).", endpoint->service, endpoint->id);
 
-	if (celixThreadMutex_lock(&manager->importedServicesLock) == CELIX_SUCCESS) {
+	if (celixThreadMutex_lock(&manager->rsaListLock) == CELIX_SUCCESS) {
+		if (celixThreadMutex_lock(&manager->importedServicesLock) == CELIX_SUCCESS) {
+			struct imported_service *imported = hashMap_get(manager->importedServices, endpoint->id);
 
-		hash_map_pt imports = hashMap_create(NULL, NULL, NULL, NULL);
-		hashMap_put(manager->importedServices, endpoint, imports);
-
-		if (scope_allowImport(manager->scope, endpoint)) {
-			if (celixThreadMutex_lock(&manager->rsaListLock) == CELIX_SUCCESS) {
-				int size = arrayList_size(manager->rsaList);
-
-				for (int iter = 0; iter < size; iter++) {
-					import_registration_pt import = NULL;
-					remote_service_admin_service_pt rsa = arrayList_get(manager->rsaList, iter);
-					celix_status_t substatus = rsa->importService(rsa->admin, endpoint, &import);
-					if (substatus == CELIX_SUCCESS) {
-						hashMap_put(imports, rsa, import);
-					} else {
-						status = substatus;
-					}
+			if (imported == NULL) {
+				imported = calloc(1, sizeof(*imported));
+				if (imported == NULL) {
+					status = CELIX_ENOMEM;
+				} else {
+					imported->imports = hashMap_create(NULL, NULL, NULL, NULL);
+					hashMap_put(manager->importedServices, strdup(endpoint->id), imported);
 				}
-				celixThreadMutex_unlock(&manager->rsaListLock);
+			} else if (imported->endpoint != endpoint) {
+				// the endpoint description was replaced, the existing imports refer to the old one
+				topologyManager_closeImportRegistrations(manager, imported, NULL);
 			}
 
-		}
+			if (status == CELIX_SUCCESS) {
+				imported->endpoint = endpoint;
+				status = topologyManager_reconcileImport(manager, imported);
+			}
 
-		celixThreadMutex_unlock(&manager->importedServicesLock);
+			celixThreadMutex_unlock(&manager->importedServicesLock);
+		}
+		celixThreadMutex_unlock(&manager->rsaListLock);
 	}
 
-
 	return status;
 }
 
@@ -567,34 +491,20 @@ celix_status_t topologyManager_removeImportedService(void *handle, endpoint_desc
 	logHelper_log(manager->loghelper, OSGI_LOGSERVICE_INFO, "TOPOLOGY_MANAGER: Remove imported service (%s; %s).", endpoint->service, endpoint->id);
 
 	if (celixThreadMutex_lock(&manager->importedServicesLock) == CELIX_SUCCESS) {
+		hash_map_entry_pt entry = hashMap_getEntry(manager->importedServices, endpoint->id);
 
-		hash_map_iterator_pt iter = hashMapIterator_create(manager->importedServices);
-		while (hashMapIterator_hasNext(iter)) {
-			hash_map_entry_pt entry = hashMapIterator_nextEntry(iter);
-			endpoint_description_pt ep = hashMapEntry_getKey(entry);
-			hash_map_pt imports = hashMapEntry_getValue(entry);
-
-			if (imports != NULL && strcmp(endpoint->id, ep->id) == 0) {
-				hash_map_iterator_pt importsIter = hashMapIterator_create(imports);
-
-				while (hashMapIterator_hasNext(importsIter)) {
-					hash_map_entry_pt entry = hashMapIterator_nextEntry(importsIter);
-					remote_service_admin_service_pt rsa = hashMapEntry_getKey(entry);
-					import_registration_pt import = hashMapEntry_getValue(entry);
-					celix_status_t substatus = rsa->importRegistration_close(rsa->admin, import);
-					if (substatus == CELIX_SUCCESS) {
-						hashMapIterator_remove(importsIter);
-					} else {
-						status = substatus;
-					}
-				}
-				hashMapIterator_destroy(importsIter);
-				hashMapIterator_remove(iter);
+		if (entry != NULL) {
+			char *endpointId = hashMapEntry_getKey(entry);
+			struct imported_service *imported = hashMapEntry_getValue(entry);
 
-				hashMap_destroy(imports, false, false);
-			}
+			status = topologyManager_closeImportRegistrations(manager, imported, NULL);
+
+			hashMap_remove(manager->importedServices, endpointId);
+			hashMap_destroy(imported->imports, false, false);
+			free(imported);
+			free(endpointId);
 		}
-		hashMapIterator_destroy(iter);
+
 		celixThreadMutex_unlock(&manager->importedServicesLock);
 	}
 
@@ -603,82 +513,73 @@ celix_status_t topologyManager_removeImportedService(void *handle, endpoint_desc
 
 celix_status_t topologyManager_addExportedService(topology_manager_pt manager, service_reference_pt reference, char *serviceId) {
 	celix_status_t status = CELIX_SUCCESS;
-	properties_pt serviceProperties = NULL;
 
 	logHelper_log(manager->loghelper, OSGI_LOGSERVICE_INFO, "TOPOLOGY_MANAGER: Add exported service (%s).", serviceId);
 
-	if (celixThreadMutex_lock(&manager->exportedServicesLock) == CELIX_SUCCESS) {
-		scope_getExportProperties(manager->scope, reference, &serviceProperties);
-		hash_map_pt exports = hashMap_create(NULL, NULL, NULL, NULL);
-		hashMap_put(manager->exportedServices, reference, exports);
-
-		if (celixThreadMutex_lock(&manager->rsaListLock) == CELIX_SUCCESS) {
-			int size = arrayList_size(manager->rsaList);
-
-			if (size == 0) {
-				logHelper_log(manager->loghelper, OSGI_LOGSERVICE_WARNING, "TOPOLOGY_MANAGER: No RSA available yet.");
-			}
-
-			for (int iter = 0; iter < size; iter++) {
-				remote_service_admin_service_pt rsa = arrayList_get(manager->rsaList, iter);
-
-				array_list_pt endpoints = NULL;
-				celix_status_t substatus = rsa->exportService(rsa->admin, serviceId, serviceProperties, &endpoints);
+	celixThreadMutex_lock(&manager->changesLock);
 
-				if (substatus == CELIX_SUCCESS) {
-					hashMap_put(exports, rsa, endpoints);
-					topologyManager_notifyListenersEndpointAdded(manager, rsa, endpoints);
-				} else {
-					status = substatus;
-				}
-			}
-			celixThreadMutex_unlock(&manager->rsaListLock);
+	if (!hashMap_containsKey(manager->exportableServices, serviceId)) {
+		status = bundleContext_retainServiceReference(manager->context, reference);
+		if (status == CELIX_SUCCESS) {
+			hashMap_put(manager->exportableServices, strdup(serviceId), reference);
 		}
-		celixThreadMutex_unlock(&manager->exportedServicesLock);
 	}
 
+	if (status == CELIX_SUCCESS) {
+		topologyManager_markExportDirtyLocked(manager, serviceId, TM_EXPORT_UPDATE);
+		topologyManager_submitLocked(manager);
+	}
+
+	celixThreadMutex_unlock(&manager->changesLock);
+
 	return status;
 }
 
 celix_status_t topologyManager_removeExportedService(topology_manager_pt manager, service_reference_pt reference, char *serviceId) {
 	celix_status_t status = CELIX_SUCCESS;
+	service_reference_pt retained = NULL;
 
 	logHelper_log(manager->loghelper, OSGI_LOGSERVICE_INFO, "TOPOLOGY_MANAGER: Remove exported service (%s).", serviceId);
 
-	if (celixThreadMutex_lock(&manager->exportedServicesLock) == CELIX_SUCCESS) {
-		hash_map_pt exports = hashMap_get(manager->exportedServices, reference);
-		if (exports) {
-			hash_map_iterator_pt iter = hashMapIterator_create(exports);
-			while (hashMapIterator_hasNext(iter)) {
-				hash_map_entry_pt entry = hashMapIterator_nextEntry(iter);
-				remote_service_admin_service_pt rsa = hashMapEntry_getKey(entry);
-				array_list_pt exportRegistrations = hashMapEntry_getValue(entry);
+	celixThreadMutex_lock(&manager->changesLock);
 
-				int size = arrayList_size(exportRegistrations);
+	hash_map_entry_pt entry = hashMap_getEntry(manager->exportableServices, serviceId);
+	if (entry != NULL) {
+		char *key = hashMapEntry_getKey(entry);
+		retained = hashMap_remove(manager->exportableServices, key);
+		free(key);
+	}
 
-				for (int exportsIter = 0; exportsIter < size; exportsIter++) {
-					export_registration_pt export = arrayList_get(exportRegistrations, exportsIter);
-					topologyManager_notifyListenersEndpointRemoved(manager, rsa, export);
-					rsa->exportRegistration_close(rsa->admin, export);
-				}
+	entry = hashMap_getEntry(manager->dirtyExports, serviceId);
+	if (entry != NULL) {
+		char *key = hashMapEntry_getKey(entry);
+		hashMap_remove(manager->dirtyExports, key);
+		free(key);
+	}
 
-				hashMap_remove(exports, rsa);
-				//arrayList_destroy(exportRegistrations);
-				hashMapIterator_destroy(iter);
-				iter = hashMapIterator_create(exports);
+	celixThreadMutex_unlock(&manager->changesLock);
 
-			}
-			hashMapIterator_destroy(iter);
-		}
-		exports = hashMap_remove(manager->exportedServices, reference);
+	// the service is going away, so its exports are closed right away instead of by the reconcile thread
+	if (celixThreadMutex_lock(&manager->exportedServicesLock) == CELIX_SUCCESS) {
+		entry = hashMap_getEntry(manager->exportedServices, serviceId);
+		if (entry != NULL) {
+			char *key = hashMapEntry_getKey(entry);
+			hash_map_pt exports = hashMapEntry_getValue(entry);
 
-		if (exports != NULL) {
+			status = topologyManager_closeExportRegistrations(manager, exports, NULL);
+
+			hashMap_remove(manager->exportedServices, key);
 			hashMap_destroy(exports, false, false);
+			free(key);
 		}
 
 		celixThreadMutex_unlock(&manager->exportedServicesLock);
 	}
 
+	if (retained != NULL) {
+		bundleContext_ungetServiceReference(manager->context, retained);
+	}
+
 	return status;
 }
 
@@ -713,47 +614,27 @@ celix_status_t topologyManager_endpointListenerAdded(void* handle, service_refer
 
 	logHelper_log(manager->loghelper, OSGI_LOGSERVICE_INFO, "TOPOLOGY_MANAGER: Added ENDPOINT_LISTENER");
 
-	if (celixThreadMutex_lock(&manager->listenerListLock) == CELIX_SUCCESS) {
-		hashMap_put(manager->listenerList, reference, NULL);
-		celixThreadMutex_unlock(&manager->listenerListLock);
-
-		serviceReference_getProperty(reference, OSGI_ENDPOINT_LISTENER_SCOPE, &scope);
-
-		filter_pt filter = filter_create(scope);
-		hash_map_iterator_pt refIter = hashMapIterator_create(manager->exportedServices);
-
-		while (hashMapIterator_hasNext(refIter)) {
-			hash_map_pt rsaExports = hashMapIterator_nextValue(refIter);
-			hash_map_iterator_pt rsaIter = hashMapIterator_create(rsaExports);
-
-			while (hashMapIterator_hasNext(rsaIter)) {
-				hash_map_entry_pt entry = hashMapIterator_nextEntry(rsaIter);
-				remote_service_admin_service_pt rsa = hashMapEntry_getKey(entry);
-				array_list_pt registrations = hashMapEntry_getValue(entry);
+	struct endpoint_listener_entry *entry = calloc(1, sizeof(*entry));
+	if (entry == NULL) {
+		return CELIX_ENOMEM;
+	}
 
-				int arrayListSize = arrayList_size(registrations);
-				int cnt = 0;
+	serviceReference_getProperty(reference, OSGI_ENDPOINT_LISTENER_SCOPE, &scope);
 
-				for (; cnt < arrayListSize; cnt++) {
-					export_registration_pt export = arrayList_get(registrations, cnt);
-					endpoint_description_pt endpoint = NULL;
+	entry->listener = (endpoint_listener_pt) service;
+	entry->scope = scope != NULL ? strdup(scope) : NULL;
+	entry->filter = scope != NULL ? filter_create(scope) : NULL;
+	entry->announced = false;
 
-					status = topologyManager_getEndpointDescriptionForExportRegistration(rsa, export, &endpoint);
-					if (status == CELIX_SUCCESS) {
-						bool matchResult = false;
-						filter_match(filter, endpoint->properties, &matchResult);
-						if (matchResult) {
-							endpoint_listener_pt listener = (endpoint_listener_pt) service;
-							status = listener->endpointAdded(listener->handle, endpoint, (char*)scope);
-						}
-					}
-				}
-			}
-			hashMapIterator_destroy(rsaIter);
-		}
-		hashMapIterator_destroy(refIter);
+	if (celixThreadMutex_lock(&manager->listenerListLock) == CELIX_SUCCESS) {
+		hashMap_put(manager->listenerList, reference, entry);
+		celixThreadMutex_unlock(&manager->listenerListLock);
 
-		filter_destroy(filter);
+		// the already exported endpoints are announced by the reconcile thread
+		celixThreadMutex_lock(&manager->changesLock);
+		manager->listenersDirty = true;
+		topologyManager_submitLocked(manager);
+		celixThreadMutex_unlock(&manager->changesLock);
 	}
 
 	return status;
@@ -776,9 +657,11 @@ celix_status_t topologyManager_endpointListenerRemoved(void * handle, service_re
 	topology_manager_pt manager = handle;
 
 	if (celixThreadMutex_lock(&manager->listenerListLock) == CELIX_SUCCESS) {
+		struct endpoint_listener_entry *entry = hashMap_remove(manager->listenerList, reference);
 
-		if (hashMap_remove(manager->listenerList, reference)) {
+		if (entry != NULL) {
 			logHelper_log(manager->loghelper, OSGI_LOGSERVICE_INFO, "EndpointListener Removed");
+			topologyManager_destroyListenerEntry(entry);
 		}
 
 		celixThreadMutex_unlock(&manager->listenerListLock);
@@ -791,38 +674,36 @@ celix_status_t topologyManager_notifyListenersEndpointAdded(topology_manager_pt
 	celix_status_t status = CELIX_SUCCESS;
 
 	if (celixThreadMutex_lock(&manager->listenerListLock) == CELIX_SUCCESS) {
+		int regSize = arrayList_size(registrations);
 
-		hash_map_iterator_pt iter = hashMapIterator_create(manager->listenerList);
-		while (hashMapIterator_hasNext(iter)) {
-			const char* scope = NULL;
-			endpoint_listener_pt epl = NULL;
-			service_reference_pt reference = hashMapIterator_nextKey(iter);
+		for (int regIt = 0; regIt < regSize && hashMap_size(manager->listenerList) > 0; regIt++) {
+			export_registration_pt export = arrayList_get(registrations, regIt);
+			endpoint_description_pt endpoint = NULL;
+			celix_status_t substatus = topologyManager_getEndpointDescriptionForExportRegistration(rsa, export, &endpoint);
 
-			serviceReference_getProperty(reference, OSGI_ENDPOINT_LISTENER_SCOPE, &scope);
+			if (substatus != CELIX_SUCCESS) {
+				status = substatus;
+				continue;
+			}
 
-			status = bundleContext_getService(manager->context, reference, (void **) &epl);
-			if (status == CELIX_SUCCESS) {
-				filter_pt filter = filter_create(scope);
+			hash_map_iterator_pt iter = hashMapIterator_create(manager->listenerList);
+			while (hashMapIterator_hasNext(iter)) {
+				struct endpoint_listener_entry *entry = hashMapIterator_nextValue(iter);
+				bool matchResult = false;
 
-				int regSize = arrayList_size(registrations);
-				for (int regIt = 0; regIt < regSize; regIt++) {
-					export_registration_pt export = arrayList_get(registrations, regIt);
-					endpoint_description_pt endpoint = NULL;
-					celix_status_t substatus = topologyManager_getEndpointDescriptionForExportRegistration(rsa, export, &endpoint);
-					if (substatus == CELIX_SUCCESS) {
-						bool matchResult = false;
-						filter_match(filter, endpoint->properties, &matchResult);
-						if (matchResult) {
-							status = epl->endpointAdded(epl->handle, endpoint, (char*)scope);
-						}
-					} else {
-						status = substatus;
-					}
+				// listeners which are not announced yet get the complete set of endpoints later on
+				if (!entry->announced || entry->filter == NULL) {
+					continue;
+				}
+
+				filter_match(entry->filter, endpoint->properties, &matchResult);
+				if (matchResult) {
+					status = entry->listener->endpointAdded(entry->listener->handle, endpoint, entry->scope);
 				}
-				filter_destroy(filter);
 			}
+			hashMapIterator_destroy(iter);
 		}
-		hashMapIterator_destroy(iter);
+
 		celixThreadMutex_unlock(&manager->listenerListLock);
 	}
 
@@ -833,37 +714,419 @@ celix_status_t topologyManager_notifyListenersEndpointRemoved(topology_manager_p
 	celix_status_t status = CELIX_SUCCESS;
 
 	if (celixThreadMutex_lock(&manager->listenerListLock) == CELIX_SUCCESS) {
-		hash_map_iterator_pt iter = hashMapIterator_create(manager->listenerList);
+		endpoint_description_pt endpoint = NULL;
+
+		if (hashMap_size(manager->listenerList) > 0 && topologyManager_getEndpointDescriptionForExportRegistration(rsa, export, &endpoint) == CELIX_SUCCESS) {
+			hash_map_iterator_pt iter = hashMapIterator_create(manager->listenerList);
+			while (hashMapIterator_hasNext(iter)) {
+				struct endpoint_listener_entry *entry = hashMapIterator_nextValue(iter);
+
+				if (entry->announced) {
+					entry->listener->endpointRemoved(entry->listener->handle, endpoint, NULL);
+				}
+			}
+			hashMapIterator_destroy(iter);
+		}
+
+		celixThreadMutex_unlock(&manager->listenerListLock);
+	}
+
+	return status;
+}
+
+static void topologyManager_submitLocked(topology_manager_pt manager) {
+	manager->submitted++;
+	celixThreadCondition_broadcast(&manager->changesCond);
+}
+
+/*
+ * Blocks until all changes submitted before the call are reconciled. Used for the scope callbacks, whose callers
+ * expect the scope to be applied on return.
+ */
+static void topologyManager_waitForReconcile(topology_manager_pt manager) {
+	celixThreadMutex_lock(&manager->changesLock);
+	if (manager->running && !celixThread_equals(celixThread_self(), manager->reconcileThread)) {
+		unsigned long seq = manager->submitted;
+		while (manager->running && manager->processed < seq) {
+			celixThreadCondition_wait(&manager->changesCond, &manager->changesLock);
+		}
+	}
+	celixThreadMutex_unlock(&manager->changesLock);
+}
+
+static void topologyManager_markExportDirtyLocked(topology_manager_pt manager, const char *serviceId, int mode) {
+	int current = (int) (intptr_t) hashMap_get(manager->dirtyExports, serviceId);
+
+	if (current == 0) {
+		hashMap_put(manager->dirtyExports, strdup(serviceId), (void *) (intptr_t) mode);
+	} else if (mode > current) {
+		hashMap_put(manager->dirtyExports, (void *) serviceId, (void *) (intptr_t) mode);
+	}
+}
+
+/*
+ * Closes the export registrations of one exported service for the given rsa, or for all rsas when rsa is NULL.
+ * Caller must hold the exportedServicesLock.
+ */
+static celix_status_t topologyManager_closeExportRegistrations(topology_manager_pt manager, hash_map_pt exports, remote_service_admin_service_pt rsa) {
+	celix_status_t status = CELIX_SUCCESS;
+
+	hash_map_iterator_pt iter = hashMapIterator_create(exports);
+	while (hashMapIterator_hasNext(iter)) {
+		hash_map_entry_pt entry = hashMapIterator_nextEntry(iter);
+		remote_service_admin_service_pt exportRsa = hashMapEntry_getKey(entry);
+		array_list_pt exportRegistrations = hashMapEntry_getValue(entry);
+
+		if (rsa != NULL && exportRsa != rsa) {
+			continue;
+		}
+
+		/*
+		 * the problem here is that also the rsa has a a list of
+		 * endpoints which is destroyed when closing the exportRegistration
+		 */
+		int size = arrayList_size(exportRegistrations);
+		for (int exportsIter = 0; exportsIter < size; exportsIter++) {
+			export_registration_pt export = arrayList_get(exportRegistrations, exportsIter);
+			topologyManager_notifyListenersEndpointRemoved(manager, exportRsa, export);
+			celix_status_t substatus = exportRsa->exportRegistration_close(exportRsa->admin, export);
+			if (substatus != CELIX_SUCCESS) {
+				status = substatus;
+			}
+		}
+
+		hashMapIterator_remove(iter);
+	}
+	hashMapIterator_destroy(iter);
+
+	return status;
+}
+
+/*
+ * Closes the import registrations of one endpoint for the given rsa, or for all rsas when rsa is NULL.
+ * Caller must hold the importedServicesLock.
+ */
+static celix_status_t topologyManager_closeImportRegistrations(topology_manager_pt manager, struct imported_service *imported, remote_service_admin_service_pt rsa) {
+	celix_status_t status = CELIX_SUCCESS;
+
+	hash_map_iterator_pt iter = hashMapIterator_create(imported->imports);
+	while (hashMapIterator_hasNext(iter)) {
+		hash_map_entry_pt entry = hashMapIterator_nextEntry(iter);
+		remote_service_admin_service_pt importRsa = hashMapEntry_getKey(entry);
+		import_registration_pt import = hashMapEntry_getValue(entry);
+
+		if (rsa != NULL && importRsa != rsa) {
+			continue;
+		}
+
+		celix_status_t substatus = importRsa->importRegistration_close(importRsa->admin, import);
+		if (substatus == CELIX_SUCCESS) {
+			hashMapIterator_remove(iter);
+		} else {
+			status = substatus;
+		}
+	}
+	hashMapIterator_destroy(iter);
+
+	return status;
+}
+
+/*
+ * Diffs the desired export state of one service against its export registrations. Caller must hold the
+ * rsaListLock and the exportedServicesLock.
+ */
+static celix_status_t topologyManager_reconcileExport(topology_manager_pt manager, const char *serviceId, int mode) {
+	celix_status_t status = CELIX_SUCCESS;
+
+	// a removed service is only ungot after its exports are closed under the exportedServicesLock
+	celixThreadMutex_lock(&manager->changesLock);
+	service_reference_pt reference = hashMap_get(manager->exportableServices, serviceId);
+	celixThreadMutex_unlock(&manager->changesLock);
+
+	hash_map_entry_pt entry = hashMap_getEntry(manager->exportedServices, serviceId);
+	if (entry != NULL && (reference == NULL || mode == TM_EXPORT_REEXPORT)) {
+		char *key = hashMapEntry_getKey(entry);
+		hash_map_pt exports = hashMapEntry_getValue(entry);
+
+		status = topologyManager_closeExportRegistrations(manager, exports, NULL);
+
+		hashMap_remove(manager->exportedServices, key);
+		hashMap_destroy(exports, false, false);
+		free(key);
+	}
+
+	int size = arrayList_size(manager->rsaList);
+	if (reference == NULL || size == 0) {
+		return status;
+	}
+
+	hash_map_pt exports = hashMap_get(manager->exportedServices, serviceId);
+	if (exports == NULL) {
+		exports = hashMap_create(NULL, NULL, NULL, NULL);
+		hashMap_put(manager->exportedServices, strdup(serviceId), exports);
+	}
+
+	properties_pt serviceProperties = NULL;
+	bool propertiesResolved = false;
+
+	for (int iter = 0; iter < size; iter++) {
+		remote_service_admin_service_pt rsa = arrayList_get(manager->rsaList, iter);
+
+		if (hashMap_containsKey(exports, rsa)) {
+			continue;
+		}
+
+		if (!propertiesResolved) {
+			scope_getExportProperties(manager->scope, reference, &serviceProperties);
+			propertiesResolved = true;
+		}
+
+		array_list_pt endpoints = NULL;
+		celix_status_t substatus = rsa->exportService(rsa->admin, (char *) serviceId, serviceProperties, &endpoints);
+
+		if (substatus == CELIX_SUCCESS) {
+			hashMap_put(exports, rsa, endpoints);
+			topologyManager_notifyListenersEndpointAdded(manager, rsa, endpoints);
+		} else {
+			status = substatus;
+		}
+	}
+
+	if (hashMap_size(exports) == 0) {
+		hash_map_entry_pt emptyEntry = hashMap_getEntry(manager->exportedServices, serviceId);
+		char *key = hashMapEntry_getKey(emptyEntry);
+		hashMap_remove(manager->exportedServices, key);
+		hashMap_destroy(exports, false, false);
+		free(key);
+	}
+
+	return status;
+}
+
+/*
+ * Diffs the desired import state of one endpoint against its import registrations. Caller must hold the
+ * rsaListLock and the importedServicesLock.
+ */
+static celix_status_t topologyManager_reconcileImport(topology_manager_pt manager, struct imported_service *imported) {
+	celix_status_t status = CELIX_SUCCESS;
+
+	if (!scope_allowImport(manager->scope, imported->endpoint)) {
+		return topologyManager_closeImportRegistrations(manager, imported, NULL);
+	}
+
+	int size = arrayList_size(manager->rsaList);
+	for (int iter = 0; iter < size; iter++) {
+		remote_service_admin_service_pt rsa = arrayList_get(manager->rsaList, iter);
+
+		if (hashMap_containsKey(imported->imports, rsa)) {
+			continue;
+		}
+
+		import_registration_pt import = NULL;
+		celix_status_t substatus = rsa->importService(rsa->admin, imported->endpoint, &import);
+		if (substatus == CELIX_SUCCESS) {
+			hashMap_put(imported->imports, rsa, import);
+		} else {
+			status = substatus;
+		}
+	}
+
+	return status;
+}
+
+/*
+ * Announces all current exports to the endpoint listeners which were added since the previous batch. Caller must
+ * hold the exportedServicesLock.
+ */
+static void topologyManager_announceExports(topology_manager_pt manager) {
+	if (celixThreadMutex_lock(&manager->listenerListLock) != CELIX_SUCCESS) {
+		return;
+	}
+
+	hash_map_iterator_pt listenerIter = hashMapIterator_create(manager->listenerList);
+	while (hashMapIterator_hasNext(listenerIter)) {
+		struct endpoint_listener_entry *entry = hashMapIterator_nextValue(listenerIter);
+
+		if (entry->announced) {
+			continue;
+		}
+		entry->announced = true;
+
+		if (entry->filter == NULL) {
+			continue;
+		}
+
+		hash_map_iterator_pt refIter = hashMapIterator_create(manager->exportedServices);
+		while (hashMapIterator_hasNext(refIter)) {
+			hash_map_pt rsaExports = hashMapIterator_nextValue(refIter);
+			hash_map_iterator_pt rsaIter = hashMapIterator_create(rsaExports);
+
+			while (hashMapIterator_hasNext(rsaIter)) {
+				hash_map_entry_pt rsaEntry = hashMapIterator_nextEntry(rsaIter);
+				remote_service_admin_service_pt rsa = hashMapEntry_getKey(rsaEntry);
+				array_list_pt registrations = hashMapEntry_getValue(rsaEntry);
+
+				for (int cnt = 0; cnt < arrayList_size(registrations); cnt++) {
+					export_registration_pt export = arrayList_get(registrations, cnt);
+					endpoint_description_pt endpoint = NULL;
+
+					if (topologyManager_getEndpointDescriptionForExportRegistration(rsa, export, &endpoint) == CELIX_SUCCESS) {
+						bool matchResult = false;
+						filter_match(entry->filter, endpoint->properties, &matchResult);
+						if (matchResult) {
+							entry->listener->endpointAdded(entry->listener->handle, endpoint, entry->scope);
+						}
+					}
+				}
+			}
+			hashMapIterator_destroy(rsaIter);
+		}
+		hashMapIterator_destroy(refIter);
+	}
+	hashMapIterator_destroy(listenerIter);
+
+	celixThreadMutex_unlock(&manager->listenerListLock);
+}
+
+static void topologyManager_processBatch(topology_manager_pt manager, hash_map_pt dirty, array_list_pt scopes, bool allExports, bool allImports, bool listeners) {
+	celixThreadMutex_lock(&manager->rsaListLock);
+	celixThreadMutex_lock(&manager->exportedServicesLock);
+
+	// the exportable services matching a changed export scope get their new export properties
+	for (int i = 0; i < arrayList_size(scopes); i++) {
+		filter_pt filter = arrayList_get(scopes, i);
+
+		celixThreadMutex_lock(&manager->changesLock);
+		hash_map_iterator_pt iter = hashMapIterator_create(manager->exportableServices);
 		while (hashMapIterator_hasNext(iter)) {
-			endpoint_description_pt endpoint = NULL;
-			endpoint_listener_pt epl = NULL;
-			celix_status_t substatus;
-			const char* scope = NULL;
+			hash_map_entry_pt entry = hashMapIterator_nextEntry(iter);
+			char *serviceId = hashMapEntry_getKey(entry);
+			service_registration_pt reg = NULL;
+			properties_pt props = NULL;
+			bool found = false;
+
+			serviceReference_getServiceRegistration(hashMapEntry_getValue(entry), &reg);
+			if (reg != NULL && serviceRegistration_getProperties(reg, &props) == CELIX_SUCCESS) {
+				filter_match(filter, props, &found);
+			}
 
-			service_reference_pt reference = hashMapIterator_nextKey(iter);
-			serviceReference_getProperty(reference, OSGI_ENDPOINT_LISTENER_SCOPE, &scope);
+			if (found) {
+				if (hashMap_containsKey(dirty, serviceId)) {
+					hashMap_put(dirty, serviceId, (void *) (intptr_t) TM_EXPORT_REEXPORT);
+				} else {
+					hashMap_put(dirty, strdup(serviceId), (void *) (intptr_t) TM_EXPORT_REEXPORT);
+				}
+			}
+		}
+		hashMapIterator_destroy(iter);
+		celixThreadMutex_unlock(&manager->changesLock);
 
-			substatus = bundleContext_getService(manager->context, reference, (void **) &epl);
+		filter_destroy(filter);
+	}
 
-			if (substatus == CELIX_SUCCESS) {
-				substatus = topologyManager_getEndpointDescriptionForExportRegistration(rsa, export, &endpoint);
+	// after an rsa is added every exportable and every exported service is diffed
+	if (allExports) {
+		celixThreadMutex_lock(&manager->changesLock);
+		hash_map_iterator_pt iter = hashMapIterator_create(manager->exportableServices);
+		while (hashMapIterator_hasNext(iter)) {
+			char *serviceId = hashMapIterator_nextKey(iter);
+			if (!hashMap_containsKey(dirty, serviceId)) {
+				hashMap_put(dirty, strdup(serviceId), (void *) (intptr_t) TM_EXPORT_UPDATE);
 			}
+		}
+		hashMapIterator_destroy(iter);
+		celixThreadMutex_unlock(&manager->changesLock);
 
-			if (substatus == CELIX_SUCCESS) {
-				substatus = epl->endpointRemoved(epl->handle, endpoint, NULL);
+		iter = hashMapIterator_create(manager->exportedServices);
+		while (hashMapIterator_hasNext(iter)) {
+			char *serviceId = hashMapIterator_nextKey(iter);
+			if (!hashMap_containsKey(dirty, serviceId)) {
+				hashMap_put(dirty, strdup(serviceId), (void *) (intptr_t) TM_EXPORT_UPDATE);
 			}
+		}
+		hashMapIterator_destroy(iter);
+	}
+
+	hash_map_iterator_pt iter = hashMapIterator_create(dirty);
+	while (hashMapIterator_hasNext(iter)) {
+		hash_map_entry_pt entry = hashMapIterator_nextEntry(iter);
+		char *serviceId = hashMapEntry_getKey(entry);
+		int mode = (int) (intptr_t) hashMapEntry_getValue(entry);
+
+		if (topologyManager_reconcileExport(manager, serviceId, mode) != CELIX_SUCCESS) {
+			logHelper_log(manager->loghelper, OSGI_LOGSERVICE_ERROR, "TOPOLOGY_MANAGER: Export of service (%s) failed.", serviceId);
+		}
+	}
+	hashMapIterator_destroy(iter);
+
+	if (listeners) {
+		topologyManager_announceExports(manager);
+	}
 
-			/*            if (substatus != CELIX_SUCCESS) {
-             status = substatus;
+	celixThreadMutex_unlock(&manager->exportedServicesLock);
+
+	if (allImports && celixThreadMutex_lock(&manager->importedServicesLock) == CELIX_SUCCESS) {
+		iter = hashMapIterator_create(manager->importedServices);
+		while (hashMapIterator_hasNext(iter)) {
+			hash_map_entry_pt entry = hashMapIterator_nextEntry(iter);
+			struct imported_service *imported = hashMapEntry_getValue(entry);
 
-             }
-			 */
+			if (topologyManager_reconcileImport(manager, imported) != CELIX_SUCCESS) {
+				logHelper_log(manager->loghelper, OSGI_LOGSERVICE_ERROR, "TOPOLOGY_MANAGER: Import of endpoint (%s) failed.", (char *) hashMapEntry_getKey(entry));
+			}
 		}
 		hashMapIterator_destroy(iter);
-		celixThreadMutex_unlock(&manager->listenerListLock);
+		celixThreadMutex_unlock(&manager->importedServicesLock);
 	}
 
-	return status;
+	celixThreadMutex_unlock(&manager->rsaListLock);
+}
+
+static void *topologyManager_reconcile(void *data) {
+	topology_manager_pt manager = data;
+
+	celixThreadMutex_lock(&manager->changesLock);
+	while (manager->running) {
+		if (manager->processed == manager->submitted) {
+			celixThreadCondition_wait(&manager->changesCond, &manager->changesLock);
+			continue;
+		}
+
+		// take everything submitted so far as one batch
+		unsigned long seq = manager->submitted;
+		hash_map_pt dirty = manager->dirtyExports;
+		array_list_pt scopes = manager->changedExportScopes;
+		bool allExports = manager->allExportsDirty;
+		bool allImports = manager->allImportsDirty;
+		bool listeners = manager->listenersDirty;
+
+		manager->dirtyExports = hashMap_create(utils_stringHash, NULL, utils_stringEquals, NULL);
+		arrayList_create(&manager->changedExportScopes);
+		manager->allExportsDirty = false;
+		manager->allImportsDirty = false;
+		manager->listenersDirty = false;
+		celixThreadMutex_unlock(&manager->changesLock);
+
+		topologyManager_processBatch(manager, dirty, scopes, allExports, allImports, listeners);
+
+		hashMap_destroy(dirty, true, false);
+		arrayList_destroy(scopes);
+
+		celixThreadMutex_lock(&manager->changesLock);
+		manager->processed = seq;
+		celixThreadCondition_broadcast(&manager->changesCond);
+	}
+	celixThreadMutex_unlock(&manager->changesLock);
+
+	return NULL;
+}
+
+static void topologyManager_destroyListenerEntry(struct endpoint_listener_entry *entry) {
+	if (entry->filter != NULL) {
+		filter_destroy(entry->filter);
+	}
+	free(entry->scope);
+	free(entry);
 }
 
 celix_status_t topologyManager_extendFilter(topology_manager_pt manager, char *filter, char **updatedFilter) {
@@ -0,0 +1,260 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+/*
+ * tm_benchmark.c
+ *
+ * Topology manager benchmark. Registers NR_OF_SERVICES exportable services in a framework running only the
+ * topology manager bundle, then registers a mock remote service admin and measures how long it takes until all
+ * services are exported and announced to an endpoint listener. Finally an export scope matching all services is
+ * added, which re-exports every service.
+ *
+ *  \author    	<a href="mailto:dev@celix.apache.org">Apache Celix Project Team</a>
+ *  \copyright	Apache License, Version 2.0
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "celix_launcher.h"
+#include "framework.h"
+#include "constants.h"
+#include "properties.h"
+#include "celix_threads.h"
+#include "remote_service_admin.h"
+#include "remote_constants.h"
+#include "endpoint_listener.h"
+#include "tm_scope.h"
+
+#define NR_OF_SERVICES 5000
+#define BENCHMARK_TIMEOUT_MS 60000
+
+struct remote_service_admin {
+	const char *frameworkUUID;
+	celix_thread_mutex_t lock;
+	int exported;
+	int closed;
+};
+
+struct export_registration {
+	endpoint_description_pt endpoint;
+};
+
+struct export_reference {
+	endpoint_description_pt endpoint;
+};
+
+struct benchmark_listener {
+	celix_thread_mutex_t lock;
+	int announced;
+};
+
+static double tmBenchmark_elapsedMs(struct timespec *begin, struct timespec *end) {
+	return (end->tv_sec - begin->tv_sec) * 1000.0 + (end->tv_nsec - begin->tv_nsec) / 1000000.0;
+}
+
+static celix_status_t tmBenchmark_exportService(remote_service_admin_pt admin, char *serviceId, properties_pt properties, array_list_pt *registrations) {
+	struct export_registration *reg = calloc(1, sizeof(*reg));
+	char endpointId[64];
+
+	reg->endpoint = calloc(1, sizeof(*reg->endpoint));
+	snprintf(endpointId, sizeof(endpointId), "bench-endpoint-%s", serviceId);
+	reg->endpoint->id = strdup(endpointId);
+	reg->endpoint->service = strdup("bench_service");
+	reg->endpoint->frameworkUUID = strdup(admin->frameworkUUID);
+	reg->endpoint->serviceId = strtoul(serviceId, NULL, 10);
+	reg->endpoint->properties = properties_create();
+	properties_set(reg->endpoint->properties, (char *) OSGI_FRAMEWORK_OBJECTCLASS, "bench_service");
+	properties_set(reg->endpoint->properties, (char *) OSGI_RSA_ENDPOINT_FRAMEWORK_UUID, (char *) admin->frameworkUUID);
+	properties_set(reg->endpoint->properties, (char *) OSGI_RSA_ENDPOINT_ID, endpointId);
+
+	arrayList_create(registrations);
+	arrayList_add(*registrations, reg);
+
+	celixThreadMutex_lock(&admin->lock);
+	admin->exported++;
+	celixThreadMutex_unlock(&admin->lock);
+
+	return CELIX_SUCCESS;
+}
+
+static celix_status_t tmBenchmark_exportRegistrationClose(remote_service_admin_pt admin, export_registration_pt registration) {
+	endpoint_description_pt endpoint = registration->endpoint;
+
+	properties_destroy(endpoint->properties);
+	free(endpoint->id);
+	free(endpoint->service);
+	free(endpoint->frameworkUUID);
+	free(endpoint);
+	free(registration);
+
+	celixThreadMutex_lock(&admin->lock);
+	admin->closed++;
+	celixThreadMutex_unlock(&admin->lock);
+
+	return CELIX_SUCCESS;
+}
+
+static celix_status_t tmBenchmark_getExportReference(export_registration_pt registration, export_reference_pt *reference) {
+	*reference = calloc(1, sizeof(**reference));
+	(*reference)->endpoint = registration->endpoint;
+	return CELIX_SUCCESS;
+}
+
+static celix_status_t tmBenchmark_getExportedEndpoint(export_reference_pt reference, endpoint_description_pt *endpoint) {
+	*endpoint = reference->endpoint;
+	return CELIX_SUCCESS;
+}
+
+static celix_status_t tmBenchmark_importService(remote_service_admin_pt admin, endpoint_description_pt endpoint, import_registration_pt *registration) {
+	return CELIX_BUNDLE_EXCEPTION;
+}
+
+static celix_status_t tmBenchmark_endpointAdded(void *handle, endpoint_description_pt endpoint, char *matchedFilter) {
+	struct benchmark_listener *listener = handle;
+	celixThreadMutex_lock(&listener->lock);
+	listener->announced++;
+	celixThreadMutex_unlock(&listener->lock);
+	return CELIX_SUCCESS;
+}
+
+static celix_status_t tmBenchmark_endpointRemoved(void *handle, endpoint_description_pt endpoint, char *matchedFilter) {
+	struct benchmark_listener *listener = handle;
+	celixThreadMutex_lock(&listener->lock);
+	listener->announced--;
+	celixThreadMutex_unlock(&listener->lock);
+	return CELIX_SUCCESS;
+}
+
+static bool tmBenchmark_waitForExports(remote_service_admin_pt admin, struct benchmark_listener *listener, int expected) {
+	int waited = 0;
+	bool done = false;
+
+	while (!done && waited < BENCHMARK_TIMEOUT_MS) {
+		celixThreadMutex_lock(&admin->lock);
+		celixThreadMutex_lock(&listener->lock);
+		done = (admin->exported - admin->closed) == expected && listener->announced == expected;
+		celixThreadMutex_unlock(&listener->lock);
+		celixThreadMutex_unlock(&admin->lock);
+
+		if (!done) {
+			usleep(1000);
+			waited++;
+		}
+	}
+
+	return done;
+}
+
+int main(int argc, char **argv) {
+	framework_pt framework = NULL;
+	bundle_pt bundle = NULL;
+	bundle_context_pt context = NULL;
+	service_registration_pt registrations[NR_OF_SERVICES];
+	service_registration_pt rsaReg = NULL;
+	service_registration_pt listenerReg = NULL;
+	service_reference_pt scopeRef = NULL;
+	tm_scope_service_pt scopeService = NULL;
+	struct timespec begin;
+	struct timespec end;
+	int dummy = 0;
+	bool exported = false;
+	bool reexported = false;
+	int i;
+
+	if (celixLauncher_launch("config_benchmark.properties", &framework) != CELIX_SUCCESS) {
+		return EXIT_FAILURE;
+	}
+	framework_getFrameworkBundle(framework, &bundle);
+	bundle_getContext(bundle, &context);
+
+	struct remote_service_admin admin;
+	memset(&admin, 0, sizeof(admin));
+	celixThreadMutex_create(&admin.lock, NULL);
+	bundleContext_getProperty(context, OSGI_FRAMEWORK_FRAMEWORK_UUID, &admin.frameworkUUID);
+
+	struct remote_service_admin_service rsa;
+	memset(&rsa, 0, sizeof(rsa));
+	rsa.admin = &admin;
+	rsa.exportService = tmBenchmark_exportService;
+	rsa.exportRegistration_close = tmBenchmark_exportRegistrationClose;
+	rsa.exportRegistration_getExportReference = tmBenchmark_getExportReference;
+	rsa.exportReference_getExportedEndpoint = tmBenchmark_getExportedEndpoint;
+	rsa.importService = tmBenchmark_importService;
+
+	struct benchmark_listener listener;
+	memset(&listener, 0, sizeof(listener));
+	celixThreadMutex_create(&listener.lock, NULL);
+
+	struct endpoint_listener endpointListener;
+	endpointListener.handle = &listener;
+	endpointListener.endpointAdded = tmBenchmark_endpointAdded;
+	endpointListener.endpointRemoved = tmBenchmark_endpointRemoved;
+
+	properties_pt listenerProps = properties_create();
+	properties_set(listenerProps, (char *) OSGI_ENDPOINT_LISTENER_SCOPE, "(objectClass=bench_service)");
+	bundleContext_registerService(context, (char *) OSGI_ENDPOINT_LISTENER_SERVICE, &endpointListener, listenerProps, &listenerReg);
+
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	for (i = 0; i < NR_OF_SERVICES; ++i) {
+		properties_pt props = properties_create();
+		properties_set(props, (char *) OSGI_RSA_SERVICE_EXPORTED_INTERFACES, "*");
+		bundleContext_registerService(context, "bench_service", &dummy, props, &registrations[i]);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	printf("Registered %i exportable services in %.3f ms\n", NR_OF_SERVICES, tmBenchmark_elapsedMs(&begin, &end));
+
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	bundleContext_registerService(context, (char *) OSGI_RSA_REMOTE_SERVICE_ADMIN, &rsa, NULL, &rsaReg);
+	exported = tmBenchmark_waitForExports(&admin, &listener, NR_OF_SERVICES);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	printf("Exported and announced %i services after RSA registration in %.3f ms\n", NR_OF_SERVICES, tmBenchmark_elapsedMs(&begin, &end));
+
+	bundleContext_getServiceReference(context, (char *) TOPOLOGYMANAGER_SCOPE_SERVICE, &scopeRef);
+	if (exported && scopeRef != NULL && bundleContext_getService(context, scopeRef, (void **) &scopeService) == CELIX_SUCCESS) {
+		properties_pt scopeProps = properties_create();
+		properties_set(scopeProps, "bench.scope", "all");
+
+		clock_gettime(CLOCK_MONOTONIC, &begin);
+		scopeService->addExportScope(scopeService->handle, "(objectClass=bench_service)", scopeProps);
+		reexported = tmBenchmark_waitForExports(&admin, &listener, NR_OF_SERVICES) && admin.closed == NR_OF_SERVICES;
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		printf("Re-exported %i services after export scope change in %.3f ms\n", NR_OF_SERVICES, tmBenchmark_elapsedMs(&begin, &end));
+
+		bool result = false;
+		bundleContext_ungetService(context, scopeRef, &result);
+		bundleContext_ungetServiceReference(context, scopeRef);
+	}
+
+	serviceRegistration_unregister(rsaReg);
+	for (i = 0; i < NR_OF_SERVICES; ++i) {
+		serviceRegistration_unregister(registrations[i]);
+	}
+	serviceRegistration_unregister(listenerReg);
+
+	celixLauncher_stop(framework);
+	celixLauncher_waitForShutdown(framework);
+	celixLauncher_destroy(framework);
+
+	celixThreadMutex_destroy(&listener.lock);
+	celixThreadMutex_destroy(&admin.lock);
+
+	return exported && reexported ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -37,13 +37,25 @@ struct remote_shell {
 	shell_mediator_pt mediator;
 	celix_thread_mutex_t mutex;
 	int maximumConnections;
+	int workers;
 
+	int epollFd; //all connection sockets, handled by the event thread
+	int wakeupFd; //eventfd used to wake up the event thread
+	celix_thread_t eventThread;
+	celix_thread_t *workerThreads;
+
+	//protected by mutex
+	bool running;
 	array_list_pt connections;
+	array_list_pt readyConnections; //connections with pending commands, picked up by the workers
+	celix_thread_cond_t workAvailable;
+	celix_thread_cond_t outputDrained; //signalled when pending output of an executing connection was sent
 };
 typedef struct remote_shell *remote_shell_pt;
 
-celix_status_t remoteShell_create(shell_mediator_pt mediator, int maximumConnections, remote_shell_pt *instance);
+celix_status_t remoteShell_create(shell_mediator_pt mediator, int maximumConnections, int workers, remote_shell_pt *instance);
 celix_status_t remoteShell_destroy(remote_shell_pt instance);
+celix_status_t remoteShell_start(remote_shell_pt instance);
 celix_status_t remoteShell_addConnection(remote_shell_pt instance, int socket);
 celix_status_t remoteShell_stopConnections(remote_shell_pt instance);
 
@@ -43,6 +43,8 @@ struct shell_mediator {
 
 	//protected by mutex
 	shell_service_pt shellService;
+	int usage; //number of commands being executed with shellService
+	celix_thread_cond_t unused;
 };
 typedef struct shell_mediator *shell_mediator_pt;
 
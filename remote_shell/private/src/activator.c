@@ -42,6 +42,9 @@
 #define REMOTE_SHELL_TELNET_MAXCONN_PROPERTY_NAME 	"remote.shell.telnet.maxconn"
 #define DEFAULT_REMOTE_SHELL_TELNET_MAXCONN 		2
 
+#define REMOTE_SHELL_TELNET_WORKERS_PROPERTY_NAME 	"remote.shell.telnet.workers"
+#define DEFAULT_REMOTE_SHELL_TELNET_WORKERS 		0 //one worker per online cpu
+
 struct bundle_instance {
 	log_helper_pt loghelper;
 	shell_mediator_pt shellMediator;
@@ -53,6 +56,7 @@ typedef struct bundle_instance *bundle_instance_pt;
 
 static int bundleActivator_getPort(bundle_instance_pt bi, bundle_context_pt context);
 static int bundleActivator_getMaximumConnections(bundle_instance_pt bi, bundle_context_pt context);
+static int bundleActivator_getWorkers(bundle_instance_pt bi, bundle_context_pt context);
 static int bundleActivator_getProperty(bundle_instance_pt bi, bundle_context_pt context, char * propertyName, int defaultValue);
 
 celix_status_t bundleActivator_create(bundle_context_pt context, void **userData) {
@@ -86,11 +90,13 @@ celix_status_t bundleActivator_start(void * userData, bundle_context_pt context)
 
 	int port = bundleActivator_getPort(bi, context);
 	int maxConn = bundleActivator_getMaximumConnections(bi, context);
+	int workers = bundleActivator_getWorkers(bi, context);
 
 	status = logHelper_start(bi->loghelper);
 
 	status = CELIX_DO_IF(status, shellMediator_create(context, &bi->shellMediator));
-	status = CELIX_DO_IF(status, remoteShell_create(bi->shellMediator, maxConn, &bi->remoteShell));
+	status = CELIX_DO_IF(status, remoteShell_create(bi->shellMediator, maxConn, workers, &bi->remoteShell));
+	status = CELIX_DO_IF(status, remoteShell_start(bi->remoteShell));
 	status = CELIX_DO_IF(status, connectionListener_create(bi->remoteShell, port, &bi->connectionListener));
 	status = CELIX_DO_IF(status, connectionListener_start(bi->connectionListener));
 
@@ -102,11 +108,11 @@ celix_status_t bundleActivator_stop(void * userData, bundle_context_pt context)
 	bundle_instance_pt bi = (bundle_instance_pt) userData;
 
 	connectionListener_stop(bi->connectionListener);
+	remoteShell_stopConnections(bi->remoteShell);
+
 	shellMediator_stop(bi->shellMediator);
 	shellMediator_destroy(bi->shellMediator);
 
-	remoteShell_stopConnections(bi->remoteShell);
-
 	status = logHelper_stop(bi->loghelper);
 
 	return status;
@@ -117,6 +123,9 @@ celix_status_t bundleActivator_destroy(void * userData, bundle_context_pt contex
 	bundle_instance_pt bi = (bundle_instance_pt) userData;
 
 	connectionListener_destroy(bi->connectionListener);
+	if (bi->remoteShell != NULL) {
+		remoteShell_destroy(bi->remoteShell);
+	}
 	status = logHelper_destroy(&bi->loghelper);
 
 	return status;
@@ -130,6 +139,10 @@ static int bundleActivator_getMaximumConnections(bundle_instance_pt bi, bundle_c
 	return bundleActivator_getProperty(bi, context, REMOTE_SHELL_TELNET_MAXCONN_PROPERTY_NAME, DEFAULT_REMOTE_SHELL_TELNET_MAXCONN);
 }
 
+static int bundleActivator_getWorkers(bundle_instance_pt bi, bundle_context_pt context) {
+	return bundleActivator_getProperty(bi, context, REMOTE_SHELL_TELNET_WORKERS_PROPERTY_NAME, DEFAULT_REMOTE_SHELL_TELNET_WORKERS);
+}
+
 static int bundleActivator_getProperty(bundle_instance_pt bi, bundle_context_pt context, char* propertyName, int defaultValue) {
 	const char *strValue = NULL;
 	int value;
@@ -36,6 +36,8 @@
 #include <arpa/inet.h>
 #include <netdb.h>
 #include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 
 #include "log_service.h"
 #include "log_helper.h"
@@ -45,7 +47,7 @@
 #include "shell_mediator.h"
 #include "remote_shell.h"
 
-#define CONNECTION_LISTENER_TIMEOUT_SEC		5
+#define CONNECTION_LISTENER_BACKLOG		128
 
 struct connection_listener {
 	//constant
@@ -54,10 +56,11 @@ struct connection_listener {
 	remote_shell_pt remoteShell;
 	celix_thread_mutex_t mutex;
 
+	int stopFd; //eventfd, written to stop the listener thread
+
 	//protected by mutex
 	bool running;
 	celix_thread_t thread;
-	fd_set pollset;
 };
 
 static void* connection_listener_thread(void *data);
@@ -71,10 +74,12 @@ celix_status_t connectionListener_create(remote_shell_pt remoteShell, int port,
 		(*instance)->remoteShell = remoteShell;
 		(*instance)->running = false;
 		(*instance)->loghelper = remoteShell->loghelper;
-
-		FD_ZERO(&(*instance)-> pollset);
+		(*instance)->stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
 
 		status = celixThreadMutex_create(&(*instance)->mutex, NULL);
+		if (status == CELIX_SUCCESS && (*instance)->stopFd < 0) {
+			status = CELIX_BUNDLE_EXCEPTION;
+		}
 	} else {
 		status = CELIX_ENOMEM;
 	}
@@ -84,6 +89,7 @@ celix_status_t connectionListener_create(remote_shell_pt remoteShell, int port,
 celix_status_t connectionListener_start(connection_listener_pt instance) {
 	celix_status_t status = CELIX_SUCCESS;
 	celixThreadMutex_lock(&instance->mutex);
+	instance->running = true;
 	celixThread_create(&instance->thread, NULL, connection_listener_thread, instance);
 	celixThreadMutex_unlock(&instance->mutex);
 	return status;
@@ -92,24 +98,31 @@ celix_status_t connectionListener_start(connection_listener_pt instance) {
 celix_status_t connectionListener_stop(connection_listener_pt instance) {
 	celix_status_t status = CELIX_SUCCESS;
 	celix_thread_t thread;
-	fd_set pollset;
-
-	instance->running = false;
-	FD_ZERO(&pollset);
+	uint64_t one = 1;
+	bool running;
 
 	logHelper_log(*instance->loghelper, OSGI_LOGSERVICE_INFO, "CONNECTION_LISTENER: Stopping thread\n");
 
 	celixThreadMutex_lock(&instance->mutex);
+	running = instance->running;
+	instance->running = false;
 	thread = instance->thread;
-
-	pollset = instance->pollset;
 	celixThreadMutex_unlock(&instance->mutex);
 
-	celixThread_join(thread, NULL);
+	if (running) {
+		if (write(instance->stopFd, &one, sizeof(one)) < 0) {
+			logHelper_log(*instance->loghelper, OSGI_LOGSERVICE_ERROR, "CONNECTION_LISTENER: Cannot wake up thread: %s", strerror(errno));
+		}
+		celixThread_join(thread, NULL);
+	}
 	return status;
 }
 
 celix_status_t connectionListener_destroy(connection_listener_pt instance) {
+	if (instance->stopFd >= 0) {
+		close(instance->stopFd);
+	}
+	celixThreadMutex_destroy(&instance->mutex);
 	free(instance);
 
 	return CELIX_SUCCESS;
@@ -118,10 +131,8 @@ celix_status_t connectionListener_destroy(connection_listener_pt instance) {
 static void* connection_listener_thread(void *data) {
 	celix_status_t status = CELIX_BUNDLE_EXCEPTION;
 	connection_listener_pt instance = data;
-	struct timeval timeout; /* Timeout for select */
-	fd_set active_fd_set;
-	FD_ZERO(&active_fd_set);
-	int listenSocket = 0;
+	int listenSocket = -1;
+	int epollFd = -1;
 	int on = 1;
 
 	struct addrinfo *result, *rp;
@@ -156,7 +167,10 @@ static void* connection_listener_thread(void *data) {
 		else if (bind(listenSocket, rp->ai_addr, rp->ai_addrlen) < 0) {
 			logHelper_log(*instance->loghelper, OSGI_LOGSERVICE_ERROR, "cannot bind: %s", strerror(errno));
 		}
-		else if (listen(listenSocket, 5) < 0) {
+		else if (fcntl(listenSocket, F_SETFL, fcntl(listenSocket, F_GETFL, 0) | O_NONBLOCK) < 0) {
+			logHelper_log(*instance->loghelper, OSGI_LOGSERVICE_ERROR, "cannot set non-blocking mode: %s", strerror(errno));
+		}
+		else if (listen(listenSocket, CONNECTION_LISTENER_BACKLOG) < 0) {
 			logHelper_log(*instance->loghelper, OSGI_LOGSERVICE_ERROR, "listen failed: %s", strerror(errno));
 		}
 		else {
@@ -165,51 +179,70 @@ static void* connection_listener_thread(void *data) {
 	}
 
 	if (status == CELIX_SUCCESS) {
+		struct epoll_event event;
 
-		logHelper_log(*instance->loghelper, OSGI_LOGSERVICE_INFO, "Remote Shell accepting connections on port %d", instance->port);
+		epollFd = epoll_create1(EPOLL_CLOEXEC);
 
-		celixThreadMutex_lock(&instance->mutex);
-		instance->pollset = active_fd_set;
-		celixThreadMutex_unlock(&instance->mutex);
+		memset(&event, 0, sizeof(event));
+		event.events = EPOLLIN;
+		event.data.fd = listenSocket;
+		if (epollFd < 0 || epoll_ctl(epollFd, EPOLL_CTL_ADD, listenSocket, &event) < 0) {
+			status = CELIX_BUNDLE_EXCEPTION;
+		}
+		event.data.fd = instance->stopFd;
+		if (status == CELIX_SUCCESS && epoll_ctl(epollFd, EPOLL_CTL_ADD, instance->stopFd, &event) < 0) {
+			status = CELIX_BUNDLE_EXCEPTION;
+		}
+		if (status != CELIX_SUCCESS) {
+			logHelper_log(*instance->loghelper, OSGI_LOGSERVICE_ERROR, "cannot watch listenSocket: %s", strerror(errno));
+		}
+	}
 
-		instance->running = true;
+	if (status == CELIX_SUCCESS) {
+		bool running = true;
 
-		while (status == CELIX_SUCCESS && instance->running) {
-			int selectRet = -1;
-			do {
-				timeout.tv_sec = CONNECTION_LISTENER_TIMEOUT_SEC;
-				timeout.tv_usec = 0;
+		logHelper_log(*instance->loghelper, OSGI_LOGSERVICE_INFO, "Remote Shell accepting connections on port %d", instance->port);
 
-				FD_ZERO(&active_fd_set);
-				FD_SET(listenSocket, &active_fd_set);
+		while (status == CELIX_SUCCESS && running) {
+			struct epoll_event events[2];
+			int i;
+			int nrOfEvents = epoll_wait(epollFd, events, 2, -1);
 
-				selectRet = select(listenSocket + 1, &active_fd_set, NULL, NULL, &timeout);
-			} while (selectRet == -1 && errno == EINTR && instance->running == true);
-			if (selectRet < 0) {
-				logHelper_log(*instance->loghelper, OSGI_LOGSERVICE_ERROR, "select on listenSocket failed: %s", strerror(errno));
+			if (nrOfEvents < 0 && errno != EINTR) {
+				logHelper_log(*instance->loghelper, OSGI_LOGSERVICE_ERROR, "epoll_wait on listenSocket failed: %s", strerror(errno));
 				status = CELIX_BUNDLE_EXCEPTION;
 			}
-			else if (selectRet == 0) {
-				/* do nothing here */
-			}
-			else if (FD_ISSET(listenSocket, &active_fd_set)) {
-				int acceptedSocket = accept(listenSocket, NULL, NULL);
 
-				if (acceptedSocket < 0) {
-					logHelper_log(*instance->loghelper, OSGI_LOGSERVICE_ERROR, "REMOTE_SHELL: accept failed: %s.", strerror(errno));
-					status = CELIX_BUNDLE_EXCEPTION;
-				}
-				else {
-					logHelper_log(*instance->loghelper, OSGI_LOGSERVICE_INFO, "REMOTE_SHELL: connection established.");
-					remoteShell_addConnection(instance->remoteShell, acceptedSocket);
+			for (i = 0; i < nrOfEvents; i++) {
+				if (events[i].data.fd == listenSocket) {
+					/* accept every pending connection, the sockets are handed over to the remote shell event loop */
+					bool pending = true;
+					while (pending) {
+						int acceptedSocket = accept4(listenSocket, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+						if (acceptedSocket >= 0) {
+							logHelper_log(*instance->loghelper, OSGI_LOGSERVICE_DEBUG, "REMOTE_SHELL: connection established.");
+							remoteShell_addConnection(instance->remoteShell, acceptedSocket);
+						} else if (errno != EINTR) {
+							if (errno != EAGAIN && errno != EWOULDBLOCK) {
+								logHelper_log(*instance->loghelper, OSGI_LOGSERVICE_ERROR, "REMOTE_SHELL: accept failed: %s.", strerror(errno));
+							}
+							pending = false;
+						}
+					}
 				}
 			}
-			else {
-				logHelper_log(*instance->loghelper, OSGI_LOGSERVICE_DEBUG, "REMOTE_SHELL: received data on a not-expected file-descriptor?");
-			}
+
+			celixThreadMutex_lock(&instance->mutex);
+			running = instance->running;
+			celixThreadMutex_unlock(&instance->mutex);
 		}
 	}
 
+	if (epollFd >= 0) {
+		close(epollFd);
+	}
+
 	if (listenSocket >= 0) {
 		close(listenSocket);
 	}
@@ -26,10 +26,14 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include <utils.h>
 #include <array_list.h>
 #include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 
 #include "log_helper.h"
 
@@ -37,6 +41,9 @@
 #include "remote_shell.h"
 
 #define COMMAND_BUFF_SIZE (256)
+#define OUTPUT_BUFF_INITIAL_SIZE (1024)
+#define OUTPUT_PAGE_SIZE (16 * 1024) //a command writing more output waits until the client has read the previous page
+#define MAX_EVENTS (64)
 
 #define RS_PROMPT ("-> ")
 #define RS_WELCOME ("\n---- Apache Celix Remote Shell ----\n---- Type exit to disconnect   ----\n\n-> ")
@@ -44,37 +51,63 @@
 #define RS_ERROR ("Error executing command!\n")
 #define RS_MAXIMUM_CONNECTIONS_REACHED ("Maximum number of connections  reached. Disconnecting ...\n")
 
-#define CONNECTION_LISTENER_TIMEOUT_SEC		5
-
-
-
 struct connection {
 	remote_shell_pt parent;
-	FILE *socketStream;
-	fd_set pollset;
-	bool threadRunning;
+	int fd;
+
+	//only used by the event thread
+	char input[COMMAND_BUFF_SIZE];
+	size_t inputLen;
+
+	//protected by parent->mutex
+	array_list_pt commands; //received command lines, executed in order by one worker at a time
+	char *output; //not yet sent output, written when the socket becomes writable
+	size_t outputLen;
+	size_t outputSize;
+	bool writeRegistered;
+	bool executing;
+	bool closing;
+	bool peerClosed;
 };
 
 typedef struct connection *connection_pt;
 
 static celix_status_t remoteShell_connection_print(connection_pt connection, char * text);
-static celix_status_t remoteShell_connection_execute(connection_pt connection, char *command);
-static void* remoteShell_connection_run(void *data);
-
-celix_status_t remoteShell_create(shell_mediator_pt mediator, int maximumConnections, remote_shell_pt *instance) {
+static celix_status_t remoteShell_connection_append(connection_pt connection, const char *data, size_t len);
+static celix_status_t remoteShell_connection_flush(connection_pt connection);
+static celix_status_t remoteShell_connection_execute(connection_pt connection, char *command, FILE *out);
+static void remoteShell_connection_read(connection_pt connection);
+static void remoteShell_connection_schedule(connection_pt connection);
+static bool remoteShell_connection_canClose(connection_pt connection);
+static void remoteShell_connection_destroy(connection_pt connection);
+static void remoteShell_wakeup(remote_shell_pt instance);
+static ssize_t remoteShell_connection_write(void *cookie, const char *data, size_t len);
+static void* remoteShell_run(void *data);
+static void* remoteShell_work(void *data);
+
+celix_status_t remoteShell_create(shell_mediator_pt mediator, int maximumConnections, int workers, remote_shell_pt *instance) {
 	celix_status_t status = CELIX_SUCCESS;
 	(*instance) = calloc(1, sizeof(**instance));
 	if ((*instance) != NULL) {
 		(*instance)->mediator = mediator;
 		(*instance)->maximumConnections = maximumConnections;
+		(*instance)->workers = workers > 0 ? workers : (int) sysconf(_SC_NPROCESSORS_ONLN);
 		(*instance)->connections = NULL;
+		(*instance)->readyConnections = NULL;
 		(*instance)->loghelper = &mediator->loghelper;
+		(*instance)->running = false;
+		(*instance)->epollFd = -1;
+		(*instance)->wakeupFd = -1;
 
-		status = celixThreadMutex_create(&(*instance)->mutex, NULL);
-
-		if (status == CELIX_SUCCESS) {
-			status = arrayList_create(&(*instance)->connections);
+		if ((*instance)->workers <= 0) {
+			(*instance)->workers = 1;
 		}
+
+		status = celixThreadMutex_create(&(*instance)->mutex, NULL);
+		status = CELIX_DO_IF(status, celixThreadCondition_init(&(*instance)->workAvailable, NULL));
+		status = CELIX_DO_IF(status, celixThreadCondition_init(&(*instance)->outputDrained, NULL));
+		status = CELIX_DO_IF(status, arrayList_create(&(*instance)->connections));
+		status = CELIX_DO_IF(status, arrayList_create(&(*instance)->readyConnections));
 	} else {
 		status = CELIX_ENOMEM;
 	}
@@ -88,8 +121,48 @@ celix_status_t remoteShell_destroy(remote_shell_pt instance) {
 
 	celixThreadMutex_lock(&instance->mutex);
 	arrayList_destroy(instance->connections);
+	arrayList_destroy(instance->readyConnections);
 	celixThreadMutex_unlock(&instance->mutex);
 
+	celixThreadCondition_destroy(&instance->workAvailable);
+	celixThreadCondition_destroy(&instance->outputDrained);
+	celixThreadMutex_destroy(&instance->mutex);
+	free(instance->workerThreads);
+	free(instance);
+
+	return status;
+}
+
+celix_status_t remoteShell_start(remote_shell_pt instance) {
+	celix_status_t status = CELIX_SUCCESS;
+	struct epoll_event event;
+	int i;
+
+	instance->epollFd = epoll_create1(EPOLL_CLOEXEC);
+	instance->wakeupFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	event.data.ptr = NULL; //only the wakeup fd is registered without a connection
+
+	if (instance->epollFd < 0 || instance->wakeupFd < 0 || epoll_ctl(instance->epollFd, EPOLL_CTL_ADD, instance->wakeupFd, &event) != 0) {
+		logHelper_log(*instance->loghelper, OSGI_LOGSERVICE_ERROR, "REMOTE_SHELL: Cannot create event loop: %s", strerror(errno));
+		status = CELIX_BUNDLE_EXCEPTION;
+	}
+
+	if (status == CELIX_SUCCESS) {
+		instance->workerThreads = calloc(instance->workers, sizeof(*instance->workerThreads));
+
+		celixThreadMutex_lock(&instance->mutex);
+		instance->running = true;
+		celixThreadMutex_unlock(&instance->mutex);
+
+		status = celixThread_create(&instance->eventThread, NULL, remoteShell_run, instance);
+		for (i = 0; status == CELIX_SUCCESS && i < instance->workers; i++) {
+			status = celixThread_create(&instance->workerThreads[i], NULL, remoteShell_work, instance);
+		}
+	}
+
 	return status;
 }
 
@@ -98,36 +171,45 @@ celix_status_t remoteShell_addConnection(remote_shell_pt instance, int socket) {
 	connection_pt connection = calloc(1, sizeof(struct connection));
 
 	if (connection != NULL) {
+		struct epoll_event event;
+
 		connection->parent = instance;
-		connection->threadRunning = false;
-		connection->socketStream = fdopen(socket, "w");
+		connection->fd = socket;
+		arrayList_create(&connection->commands);
 
-		if (connection->socketStream != NULL) {
+		fcntl(socket, F_SETFL, fcntl(socket, F_GETFL, 0) | O_NONBLOCK);
 
-			celixThreadMutex_lock(&instance->mutex);
+		memset(&event, 0, sizeof(event));
+		event.events = EPOLLIN;
+		event.data.ptr = connection;
 
-			if (arrayList_size(instance->connections) < instance->maximumConnections) {
-				celix_thread_t connectionRunThread = celix_thread_default;
+		celixThreadMutex_lock(&instance->mutex);
+
+		if (!instance->running) {
+			status = CELIX_ILLEGAL_STATE;
+		} else if (arrayList_size(instance->connections) < instance->maximumConnections) {
+			if (epoll_ctl(instance->epollFd, EPOLL_CTL_ADD, socket, &event) == 0) {
 				arrayList_add(instance->connections, connection);
-				status = celixThread_create(&connectionRunThread, NULL, &remoteShell_connection_run, connection);
+				remoteShell_connection_print(connection, RS_WELCOME);
 			} else {
+				logHelper_log(*instance->loghelper, OSGI_LOGSERVICE_ERROR, "REMOTE_SHELL: Cannot watch connection: %s", strerror(errno));
 				status = CELIX_BUNDLE_EXCEPTION;
-				remoteShell_connection_print(connection, RS_MAXIMUM_CONNECTIONS_REACHED);
 			}
-			celixThreadMutex_unlock(&instance->mutex);
-
 		} else {
 			status = CELIX_BUNDLE_EXCEPTION;
+			send(socket, RS_MAXIMUM_CONNECTIONS_REACHED, strlen(RS_MAXIMUM_CONNECTIONS_REACHED), MSG_NOSIGNAL | MSG_DONTWAIT);
 		}
+		celixThreadMutex_unlock(&instance->mutex);
 	} else {
 		status = CELIX_ENOMEM;
 	}
 
-	if (status != CELIX_SUCCESS && connection != NULL) {
-		if (connection->socketStream != NULL) {
-			fclose(connection->socketStream);
+	if (status != CELIX_SUCCESS) {
+		close(socket);
+		if (connection != NULL) {
+			arrayList_destroy(connection->commands);
+			free(connection);
 		}
-		free(connection);
 	}
 
 	return status;
@@ -135,84 +217,260 @@ celix_status_t remoteShell_addConnection(remote_shell_pt instance, int socket) {
 
 celix_status_t remoteShell_stopConnections(remote_shell_pt instance) {
 	celix_status_t status = CELIX_SUCCESS;
-	int length = 0;
+	bool wasRunning = false;
 	int i = 0;
 
 	celixThreadMutex_lock(&instance->mutex);
-	length = arrayList_size(instance->connections);
+	wasRunning = instance->running;
+	instance->running = false;
+	celixThreadCondition_broadcast(&instance->workAvailable);
+	celixThreadCondition_broadcast(&instance->outputDrained);
+	celixThreadMutex_unlock(&instance->mutex);
 
-	for (i = 0; i < length; i += 1) {
-		connection_pt connection = arrayList_get(instance->connections, i);
-		connection->threadRunning = false;
+	if (wasRunning) {
+		remoteShell_wakeup(instance);
+
+		celixThread_join(instance->eventThread, NULL);
+		for (i = 0; i < instance->workers; i += 1) {
+			celixThread_join(instance->workerThreads[i], NULL);
+		}
+
+		celixThreadMutex_lock(&instance->mutex);
+		for (i = arrayList_size(instance->connections) - 1; i >= 0; i -= 1) {
+			connection_pt connection = arrayList_get(instance->connections, i);
+			remoteShell_connection_print(connection, RS_GOODBYE);
+			remoteShell_connection_destroy(connection);
+		}
+		arrayList_clear(instance->readyConnections);
+		celixThreadMutex_unlock(&instance->mutex);
 	}
 
-	celixThreadMutex_unlock(&instance->mutex);
+	if (instance->epollFd >= 0) {
+		close(instance->epollFd);
+		instance->epollFd = -1;
+	}
+	if (instance->wakeupFd >= 0) {
+		close(instance->wakeupFd);
+		instance->wakeupFd = -1;
+	}
 
 	return status;
 }
 
-void *remoteShell_connection_run(void *data) {
-	celix_status_t status = CELIX_SUCCESS;
-	connection_pt connection = data;
-	size_t len;
-	int result;
-	struct timeval timeout; /* Timeout for select */
-
-	int fd = fileno(connection->socketStream);
-
-	connection->threadRunning = true;
-	status = remoteShell_connection_print(connection, RS_WELCOME);
-
-	while (status == CELIX_SUCCESS && connection->threadRunning == true) {
-		do {
-			timeout.tv_sec = CONNECTION_LISTENER_TIMEOUT_SEC;
-			timeout.tv_usec = 0;
-
-			FD_ZERO(&connection->pollset);
-			FD_SET(fd, &connection->pollset);
-			result = select(fd + 1, &connection->pollset, NULL, NULL, &timeout);
-		} while (result == -1 && errno == EINTR && connection->threadRunning == true);
-
-		/* The socket_fd has data available to be read */
-		if (result > 0 && FD_ISSET(fd, &connection->pollset)) {
-			char buff[COMMAND_BUFF_SIZE];
-
-			len = recv(fd, buff, COMMAND_BUFF_SIZE - 1, 0);
-			if (len < COMMAND_BUFF_SIZE) {
-				celix_status_t commandStatus = CELIX_SUCCESS;
-				buff[len] = '\0';
-
-				commandStatus = remoteShell_connection_execute(connection, buff);
-
-				if (commandStatus == CELIX_SUCCESS) {
-					remoteShell_connection_print(connection, RS_PROMPT);
-				} else if (commandStatus == CELIX_FILE_IO_EXCEPTION) {
-					//exit command
-					break;
-				} else { //error
-					remoteShell_connection_print(connection, RS_ERROR);
-					remoteShell_connection_print(connection, RS_PROMPT);
+/*
+ * Event thread: reads the command lines of all connections and writes pending output once a socket becomes
+ * writable again. Connections are only closed from this thread, and only when no worker is executing for them.
+ */
+static void* remoteShell_run(void *data) {
+	remote_shell_pt instance = data;
+	struct epoll_event events[MAX_EVENTS];
+	bool running = true;
+
+	while (running) {
+		bool reap = false;
+		int i;
+		int nrOfEvents = epoll_wait(instance->epollFd, events, MAX_EVENTS, -1);
+
+		if (nrOfEvents < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			logHelper_log(*instance->loghelper, OSGI_LOGSERVICE_ERROR, "REMOTE_SHELL: epoll_wait failed: %s", strerror(errno));
+			break;
+		}
+
+		for (i = 0; i < nrOfEvents; i++) {
+			connection_pt connection = events[i].data.ptr;
+
+			if (connection == NULL) {
+				uint64_t count;
+				if (read(instance->wakeupFd, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+					logHelper_log(*instance->loghelper, OSGI_LOGSERVICE_ERROR, "REMOTE_SHELL: Cannot read wakeup event");
 				}
+				reap = true;
+				continue;
+			}
 
-			} else {
-				logHelper_log(*connection->parent->loghelper, OSGI_LOGSERVICE_ERROR, "REMOTE_SHELL: Error while retrieving data");
+			if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+				remoteShell_connection_read(connection);
+			}
+
+			celixThreadMutex_lock(&instance->mutex);
+			if (events[i].events & EPOLLOUT) {
+				remoteShell_connection_flush(connection);
+			}
+			if (connection->executing) {
+				//a worker may be waiting to stream the next page of output
+				celixThreadCondition_broadcast(&instance->outputDrained);
+			}
+			if (remoteShell_connection_canClose(connection)) {
+				remoteShell_connection_destroy(connection);
+			}
+			celixThreadMutex_unlock(&instance->mutex);
+		}
+
+		celixThreadMutex_lock(&instance->mutex);
+		if (reap) {
+			for (i = arrayList_size(instance->connections) - 1; i >= 0; i--) {
+				connection_pt connection = arrayList_get(instance->connections, i);
+				if (remoteShell_connection_canClose(connection)) {
+					remoteShell_connection_destroy(connection);
+				}
 			}
 		}
+		running = instance->running;
+		celixThreadMutex_unlock(&instance->mutex);
 	}
 
-	remoteShell_connection_print(connection, RS_GOODBYE);
+	return NULL;
+}
 
-	logHelper_log(*connection->parent->loghelper, OSGI_LOGSERVICE_INFO, "REMOTE_SHELL: Closing socket");
-	celixThreadMutex_lock(&connection->parent->mutex);
-	arrayList_removeElement(connection->parent->connections, connection);
-	celixThreadMutex_unlock(&connection->parent->mutex);
+/*
+ * Worker thread: executes the next command of a ready connection. A connection is handed to one worker at a time,
+ * so the commands of a session keep their order while a long running command does not block other sessions.
+ */
+static void* remoteShell_work(void *data) {
+	remote_shell_pt instance = data;
+
+	celixThreadMutex_lock(&instance->mutex);
+	while (instance->running) {
+		if (arrayList_size(instance->readyConnections) == 0) {
+			celixThreadCondition_wait(&instance->workAvailable, &instance->mutex);
+			continue;
+		}
+
+		connection_pt connection = arrayList_remove(instance->readyConnections, 0);
+		char *command = arrayList_remove(connection->commands, 0);
+		celixThreadMutex_unlock(&instance->mutex);
+
+		cookie_io_functions_t functions = { .read = NULL, .write = remoteShell_connection_write, .seek = NULL, .close = NULL };
+		celix_status_t commandStatus = CELIX_FILE_IO_EXCEPTION;
+		FILE *out = fopencookie(connection, "w", functions);
+
+		if (out != NULL) {
+			//output is streamed to the client while the command runs, instead of collected until it is done
+			commandStatus = remoteShell_connection_execute(connection, command, out);
+			fclose(out);
+		}
+		free(command);
+
+		celixThreadMutex_lock(&instance->mutex);
+
+		if (commandStatus == CELIX_SUCCESS) {
+			remoteShell_connection_print(connection, RS_PROMPT);
+		} else if (commandStatus == CELIX_FILE_IO_EXCEPTION) {
+			//exit command
+			remoteShell_connection_print(connection, RS_GOODBYE);
+			connection->closing = true;
+		} else { //error
+			remoteShell_connection_append(connection, RS_ERROR, strlen(RS_ERROR));
+			remoteShell_connection_print(connection, RS_PROMPT);
+		}
 
-	fclose(connection->socketStream);
+		if (!connection->closing && arrayList_size(connection->commands) > 0) {
+			arrayList_add(instance->readyConnections, connection);
+		} else {
+			connection->executing = false;
+			if (connection->closing) {
+				remoteShell_wakeup(instance);
+			}
+		}
+	}
+	celixThreadMutex_unlock(&instance->mutex);
 
 	return NULL;
 }
 
-static celix_status_t remoteShell_connection_execute(connection_pt connection, char *command) {
+/* Reads all available data and queues every complete line as a command. Only called by the event thread */
+static void remoteShell_connection_read(connection_pt connection) {
+	remote_shell_pt instance = connection->parent;
+	bool done = false;
+
+	while (!done) {
+		ssize_t len = recv(connection->fd, connection->input + connection->inputLen, COMMAND_BUFF_SIZE - 1 - connection->inputLen, 0);
+
+		if (len > 0) {
+			char *newline = NULL;
+
+			connection->inputLen += len;
+			connection->input[connection->inputLen] = '\0';
+
+			celixThreadMutex_lock(&instance->mutex);
+			while ((newline = strchr(connection->input, '\n')) != NULL) {
+				*newline = '\0';
+				if (!connection->closing) {
+					arrayList_add(connection->commands, strdup(connection->input));
+				}
+				connection->inputLen -= (newline + 1 - connection->input);
+				memmove(connection->input, newline + 1, connection->inputLen + 1);
+			}
+			remoteShell_connection_schedule(connection);
+			celixThreadMutex_unlock(&instance->mutex);
+
+			if (connection->inputLen == COMMAND_BUFF_SIZE - 1) {
+				logHelper_log(*instance->loghelper, OSGI_LOGSERVICE_ERROR, "REMOTE_SHELL: Error while retrieving data, command too long");
+				connection->inputLen = 0;
+			}
+		} else if (len < 0 && errno == EINTR) {
+			//retry
+		} else {
+			if (len == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+				//stop watching, a hung up socket stays readable until the running command is done
+				celixThreadMutex_lock(&instance->mutex);
+				connection->peerClosed = true;
+				connection->closing = true;
+				connection->writeRegistered = false;
+				epoll_ctl(instance->epollFd, EPOLL_CTL_DEL, connection->fd, NULL);
+				celixThreadMutex_unlock(&instance->mutex);
+			}
+			done = true;
+		}
+	}
+}
+
+/* Caller must hold the parent mutex */
+static void remoteShell_connection_schedule(connection_pt connection) {
+	remote_shell_pt instance = connection->parent;
+
+	if (!connection->executing && !connection->closing && arrayList_size(connection->commands) > 0) {
+		connection->executing = true;
+		arrayList_add(instance->readyConnections, connection);
+		celixThreadCondition_signal(&instance->workAvailable);
+	}
+}
+
+/* Caller must hold the parent mutex */
+static bool remoteShell_connection_canClose(connection_pt connection) {
+	return connection->closing && !connection->executing && (connection->outputLen == 0 || connection->peerClosed);
+}
+
+/* Caller must hold the parent mutex, and the connection may not be used by a worker */
+static void remoteShell_connection_destroy(connection_pt connection) {
+	remote_shell_pt instance = connection->parent;
+	int i;
+
+	logHelper_log(*instance->loghelper, OSGI_LOGSERVICE_INFO, "REMOTE_SHELL: Closing socket");
+
+	epoll_ctl(instance->epollFd, EPOLL_CTL_DEL, connection->fd, NULL);
+	close(connection->fd);
+	arrayList_removeElement(instance->connections, connection);
+
+	for (i = 0; i < arrayList_size(connection->commands); i++) {
+		free(arrayList_get(connection->commands, i));
+	}
+	arrayList_destroy(connection->commands);
+	free(connection->output);
+	free(connection);
+}
+
+static void remoteShell_wakeup(remote_shell_pt instance) {
+	uint64_t one = 1;
+	if (write(instance->wakeupFd, &one, sizeof(one)) < 0) {
+		logHelper_log(*instance->loghelper, OSGI_LOGSERVICE_ERROR, "REMOTE_SHELL: Cannot wake up event thread");
+	}
+}
+
+static celix_status_t remoteShell_connection_execute(connection_pt connection, char *command, FILE *out) {
 	celix_status_t status = CELIX_SUCCESS;
 
 	if (status == CELIX_SUCCESS) {
@@ -225,8 +483,7 @@ static celix_status_t remoteShell_connection_execute(connection_pt connection, c
 		} else if (len == 4 && strncmp("exit", line, 4) == 0) {
 			status = CELIX_FILE_IO_EXCEPTION;
 		} else {
-			status = shellMediator_executeCommand(connection->parent->mediator, line, connection->socketStream, connection->socketStream);
-            fflush(connection->socketStream);
+			status = shellMediator_executeCommand(connection->parent->mediator, line, out, out);
 		}
 
 		free(dline);
@@ -235,8 +492,91 @@ static celix_status_t remoteShell_connection_execute(connection_pt connection, c
 	return status;
 }
 
-celix_status_t remoteShell_connection_print(connection_pt connection, char *text) {
-	size_t len = strlen(text);
-    int fd = fileno(connection->socketStream);
-	return (send(fd, text, len, 0) > 0) ? CELIX_SUCCESS : CELIX_FILE_IO_EXCEPTION;
+/*
+ * Write function of the stream handed to an executing command. Output is sent page by page, the command blocks
+ * while a full page is still waiting for a slow client. Output for a client which is gone is discarded.
+ */
+static ssize_t remoteShell_connection_write(void *cookie, const char *data, size_t len) {
+	connection_pt connection = cookie;
+	remote_shell_pt instance = connection->parent;
+
+	celixThreadMutex_lock(&instance->mutex);
+	while (connection->outputLen >= OUTPUT_PAGE_SIZE && instance->running && !connection->peerClosed) {
+		celixThreadCondition_wait(&instance->outputDrained, &instance->mutex);
+	}
+	if (remoteShell_connection_append(connection, data, len) == CELIX_SUCCESS) {
+		remoteShell_connection_flush(connection);
+	}
+	celixThreadMutex_unlock(&instance->mutex);
+
+	return len;
+}
+
+/* Caller must hold the parent mutex */
+static celix_status_t remoteShell_connection_append(connection_pt connection, const char *data, size_t len) {
+	if (connection->peerClosed) {
+		return CELIX_FILE_IO_EXCEPTION;
+	}
+
+	if (connection->outputLen + len > connection->outputSize) {
+		size_t size = connection->outputSize > 0 ? connection->outputSize : OUTPUT_BUFF_INITIAL_SIZE;
+		char *output = NULL;
+
+		while (size < connection->outputLen + len) {
+			size *= 2;
+		}
+		output = realloc(connection->output, size);
+		if (output == NULL) {
+			return CELIX_ENOMEM;
+		}
+		connection->output = output;
+		connection->outputSize = size;
+	}
+
+	memcpy(connection->output + connection->outputLen, data, len);
+	connection->outputLen += len;
+
+	return CELIX_SUCCESS;
+}
+
+/* Writes as much pending output as the socket accepts, the rest is written by the event thread. Caller must hold the parent mutex */
+static celix_status_t remoteShell_connection_flush(connection_pt connection) {
+	celix_status_t status = CELIX_SUCCESS;
+	bool pending = false;
+
+	while (connection->outputLen > 0) {
+		ssize_t sent = send(connection->fd, connection->output, connection->outputLen, MSG_NOSIGNAL | MSG_DONTWAIT);
+		if (sent > 0) {
+			connection->outputLen -= sent;
+			memmove(connection->output, connection->output + sent, connection->outputLen);
+		} else if (sent < 0 && errno == EINTR) {
+			//retry
+		} else if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			break;
+		} else {
+			connection->closing = true;
+			connection->peerClosed = true;
+			connection->outputLen = 0;
+			status = CELIX_FILE_IO_EXCEPTION;
+		}
+	}
+
+	pending = connection->outputLen > 0;
+	if (pending != connection->writeRegistered && !connection->peerClosed) {
+		struct epoll_event event;
+
+		memset(&event, 0, sizeof(event));
+		event.events = pending ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+		event.data.ptr = connection;
+		epoll_ctl(connection->parent->epollFd, EPOLL_CTL_MOD, connection->fd, &event);
+		connection->writeRegistered = pending;
+	}
+
+	return status;
+}
+
+/* Caller must hold the parent mutex */
+static celix_status_t remoteShell_connection_print(connection_pt connection, char *text) {
+	celix_status_t status = remoteShell_connection_append(connection, text, strlen(text));
+	return CELIX_DO_IF(status, remoteShell_connection_flush(connection));
 }
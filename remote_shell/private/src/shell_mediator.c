@@ -53,6 +53,7 @@ celix_status_t shellMediator_create(bundle_context_pt context, shell_mediator_pt
 		status = logHelper_create(context, &(*instance)->loghelper);
 
 		status = CELIX_DO_IF(status, celixThreadMutex_create(&(*instance)->mutex, NULL));
+		status = CELIX_DO_IF(status, celixThreadCondition_init(&(*instance)->unused, NULL));
 
 		status = CELIX_DO_IF(status, serviceTrackerCustomizer_create((*instance), NULL, shellMediator_addedService,
 				NULL, shellMediator_removedService, &customizer));
@@ -94,6 +95,8 @@ celix_status_t shellMediator_destroy(shell_mediator_pt instance) {
 	serviceTracker_destroy(instance->tracker);
 	logHelper_stop(instance->loghelper);
 	status = logHelper_destroy(&instance->loghelper);
+	celixThreadMutex_unlock(&instance->mutex);
+	celixThreadCondition_destroy(&instance->unused);
 	celixThreadMutex_destroy(&instance->mutex);
 
 
@@ -105,16 +108,25 @@ celix_status_t shellMediator_destroy(shell_mediator_pt instance) {
 
 celix_status_t shellMediator_executeCommand(shell_mediator_pt instance, char *command, FILE *out, FILE *err) {
 	celix_status_t status = CELIX_SUCCESS;
+	shell_service_pt shellService = NULL;
 
+	/* the lock is not held while executing, so sessions can run commands concurrently */
 	celixThreadMutex_lock(&instance->mutex);
+	shellService = instance->shellService;
+	if (shellService != NULL) {
+		instance->usage++;
+	}
+	celixThreadMutex_unlock(&instance->mutex);
 
+	if (shellService != NULL) {
+		shellService->executeCommand(shellService->shell, command, out, err);
 
-	if (instance->shellService != NULL) {
-		instance->shellService->executeCommand(instance->shellService->shell, command, out, err);
+		celixThreadMutex_lock(&instance->mutex);
+		instance->usage--;
+		celixThreadCondition_broadcast(&instance->unused);
+		celixThreadMutex_unlock(&instance->mutex);
 	}
 
-	celixThreadMutex_unlock(&instance->mutex);
-
 	return status;
 }
 
@@ -133,6 +145,9 @@ static celix_status_t shellMediator_removedService(void *handler, service_refere
 	shell_mediator_pt instance = (shell_mediator_pt) handler;
 	celixThreadMutex_lock(&instance->mutex);
 	instance->shellService = NULL;
+	while (instance->usage > 0) {
+		celixThreadCondition_wait(&instance->unused, &instance->mutex);
+	}
 	celixThreadMutex_unlock(&instance->mutex);
 	return status;
 }
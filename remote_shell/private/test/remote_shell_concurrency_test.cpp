@@ -0,0 +1,243 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+/*
+ * remote_shell_concurrency_test.cpp
+ *
+ * Opens NR_OF_SESSIONS telnet sessions to the remote shell. The first session executes a command which blocks for
+ * SLOW_COMMAND_SEC seconds, while all other sessions execute a command and must get their answer before the slow
+ * command is done. Every test starts its own framework and remote shell with all sessions opened.
+ *
+ *  \author    	<a href="mailto:dev@celix.apache.org">Apache Celix Project Team</a>
+ *  \copyright	Apache License, Version 2.0
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/TestHarness_c.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+extern "C"
+{
+#include "celix_launcher.h"
+#include "framework.h"
+#include "constants.h"
+#include "properties.h"
+#include "shell.h"
+#include "log_helper.h"
+
+#include "shell_mediator.h"
+#include "remote_shell.h"
+#include "connection_listener.h"
+}
+
+int main(int argc, char** argv) {
+	return RUN_ALL_TESTS(argc, argv);
+}
+
+#define NR_OF_SESSIONS 200
+#define NR_OF_WORKERS 4
+#define TEST_PORT 16666
+#define SLOW_COMMAND_SEC 2
+#define READ_BUFF_SIZE 4096
+
+static double remoteShellTest_elapsedMs(struct timespec *begin, struct timespec *end) {
+	return (end->tv_sec - begin->tv_sec) * 1000.0 + (end->tv_nsec - begin->tv_nsec) / 1000000.0;
+}
+
+static celix_status_t remoteShellTest_executeCommand(shell_pt shell, char *commandLine, FILE *out, FILE *err) {
+	if (strcmp(commandLine, "slow") == 0) {
+		sleep(SLOW_COMMAND_SEC);
+		fprintf(out, "slow done\n");
+	} else {
+		fprintf(out, "echo %s\n", commandLine);
+	}
+	return CELIX_SUCCESS;
+}
+
+static int remoteShellTest_connect(void) {
+	struct sockaddr_in addr;
+	struct timeval timeout;
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+	timeout.tv_sec = 10;
+	timeout.tv_usec = 0;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(TEST_PORT);
+	addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0) {
+		close(fd);
+		fd = -1;
+	}
+	return fd;
+}
+
+/* reads until the output contains marker, returns false on timeout or when the connection is closed */
+static bool remoteShellTest_readUntil(int fd, const char *marker, char *buff) {
+	size_t len = 0;
+
+	buff[0] = '\0';
+	while (strstr(buff, marker) == NULL) {
+		ssize_t received = recv(fd, buff + len, READ_BUFF_SIZE - 1 - len, 0);
+		if (received <= 0) {
+			return false;
+		}
+		len += received;
+		buff[len] = '\0';
+	}
+	return true;
+}
+
+static bool remoteShellTest_send(int fd, const char *line) {
+	return send(fd, line, strlen(line), MSG_NOSIGNAL) == (ssize_t) strlen(line);
+}
+
+TEST_GROUP(remote_shell_concurrency) {
+	framework_pt framework;
+	service_registration_pt shellReg;
+	shell_service_t shell;
+	shell_mediator_pt mediator;
+	remote_shell_pt remoteShell;
+	connection_listener_pt listener;
+	int sessions[NR_OF_SESSIONS];
+	char buff[READ_BUFF_SIZE];
+
+	void setup() {
+		bundle_pt bundle = NULL;
+		bundle_context_pt context = NULL;
+
+		properties_pt config = properties_create();
+		properties_set(config, OSGI_FRAMEWORK_FRAMEWORK_STORAGE_CLEAN, OSGI_FRAMEWORK_FRAMEWORK_STORAGE_CLEAN_ONFIRSTINIT);
+		framework = NULL;
+		LONGS_EQUAL(CELIX_SUCCESS, celixLauncher_launchWithProperties(config, &framework));
+		framework_getFrameworkBundle(framework, &bundle);
+		bundle_getContext(bundle, &context);
+
+		memset(&shell, 0, sizeof(shell));
+		shell.executeCommand = remoteShellTest_executeCommand;
+		shellReg = NULL;
+		bundleContext_registerService(context, (char *) OSGI_SHELL_SERVICE_NAME, &shell, NULL, &shellReg);
+
+		mediator = NULL;
+		remoteShell = NULL;
+		listener = NULL;
+		shellMediator_create(context, &mediator);
+		remoteShell_create(mediator, NR_OF_SESSIONS, NR_OF_WORKERS, &remoteShell);
+		remoteShell_start(remoteShell);
+		connectionListener_create(remoteShell, TEST_PORT, &listener);
+		connectionListener_start(listener);
+
+		for (int i = 0; i < NR_OF_SESSIONS; i++) {
+			int retries = 0;
+			do {
+				sessions[i] = remoteShellTest_connect();
+				if (sessions[i] < 0) {
+					usleep(10000);
+				}
+			} while (sessions[i] < 0 && ++retries < 100);
+		}
+	}
+
+	void teardown() {
+		for (int i = 0; i < NR_OF_SESSIONS; i++) {
+			if (sessions[i] >= 0) {
+				close(sessions[i]);
+			}
+		}
+
+		connectionListener_stop(listener);
+		remoteShell_stopConnections(remoteShell);
+		shellMediator_stop(mediator);
+		shellMediator_destroy(mediator);
+		connectionListener_destroy(listener);
+		remoteShell_destroy(remoteShell);
+
+		serviceRegistration_unregister(shellReg);
+
+		celixLauncher_stop(framework);
+		celixLauncher_waitForShutdown(framework);
+		celixLauncher_destroy(framework);
+	}
+
+	/* returns the number of sessions which got the welcome message and prompt */
+	int welcomed() {
+		int welcomed = 0;
+		for (int i = 0; i < NR_OF_SESSIONS; i++) {
+			if (sessions[i] >= 0 && remoteShellTest_readUntil(sessions[i], "-> ", buff)) {
+				welcomed++;
+			}
+		}
+		return welcomed;
+	}
+};
+
+TEST(remote_shell_concurrency, allSessionsAreWelcomed) {
+	LONGS_EQUAL(NR_OF_SESSIONS, welcomed());
+}
+
+TEST(remote_shell_concurrency, slowCommandDoesNotBlockOtherSessions) {
+	struct timespec begin;
+	struct timespec end;
+	int answered = 0;
+
+	LONGS_EQUAL(NR_OF_SESSIONS, welcomed());
+	CHECK(remoteShellTest_send(sessions[0], "slow\n"));
+
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	for (int i = 1; i < NR_OF_SESSIONS; i++) {
+		char line[32];
+		snprintf(line, sizeof(line), "ping %i\n", i);
+		remoteShellTest_send(sessions[i], line);
+	}
+	for (int i = 1; i < NR_OF_SESSIONS; i++) {
+		char expected[32];
+		snprintf(expected, sizeof(expected), "echo ping %i\n", i);
+		if (remoteShellTest_readUntil(sessions[i], "-> ", buff) && strstr(buff, expected) != NULL) {
+			answered++;
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	LONGS_EQUAL(NR_OF_SESSIONS - 1, answered);
+	CHECK(remoteShellTest_elapsedMs(&begin, &end) < SLOW_COMMAND_SEC * 1000.0);
+
+	CHECK(remoteShellTest_readUntil(sessions[0], "-> ", buff));
+	CHECK(strstr(buff, "slow done\n") != NULL);
+}
+
+TEST(remote_shell_concurrency, sessionsAreClosedWithExit) {
+	int closed = 0;
+
+	LONGS_EQUAL(NR_OF_SESSIONS, welcomed());
+	for (int i = 0; i < NR_OF_SESSIONS; i++) {
+		if (remoteShellTest_send(sessions[i], "exit\n") && remoteShellTest_readUntil(sessions[i], "Goobye!", buff)) {
+			closed++;
+		}
+	}
+	LONGS_EQUAL(NR_OF_SESSIONS, closed);
+}
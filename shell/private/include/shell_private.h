@@ -32,11 +32,19 @@
 #include "hash_map.h"
 #include "command.h"
 #include "log_helper.h"
+#include "celix_threads.h"
+
+struct shell_command_entry {
+	char *name;
+	service_reference_pt reference;
+	command_service_pt service;
+};
 
 struct shell {
 	bundle_context_pt bundle_context_ptr;
-	hash_map_pt command_reference_map_ptr;
-	hash_map_pt command_name_map_ptr;
+	celix_thread_rwlock_t lock;
+	hash_map_pt command_reference_map_ptr; //<service_reference_pt, struct shell_command_entry *>, owns the entries
+	hash_map_pt command_name_map_ptr; //<name, struct shell_command_entry *>
 	log_helper_pt logHelper;
 };
 
@@ -70,43 +70,48 @@ celix_status_t helpCommand_execute(void *_ptr, char *line_str, FILE *out_ptr, FI
             for (i = 0; i < arrayList_size(commands); i++) {
                 char *name = arrayList_get(commands, i);
                 fprintf(out_ptr, "%s\n", name);
+                free(name);
             }
             fprintf(out_ptr, "\nUse 'help <command-name>' for more information.\n");
             arrayList_destroy(commands);
         } else {
             celix_status_t sub_status_desc;
             celix_status_t sub_status_usage;
-            int i;
-            array_list_pt commands = NULL;
-            shell_ptr->getCommands(shell_ptr->shell, &commands);
-            for (i = 0; i < arrayList_size(commands); i++) {
-                char *name = arrayList_get(commands, i);
-                if (strcmp(sub, name) == 0) {
-                    char *usage_str = NULL;
-                    char *desc_str = NULL;
-
-                    sub_status_desc = shell_ptr->getCommandDescription(shell_ptr->shell, name, &desc_str);
-                    sub_status_usage = shell_ptr->getCommandUsage(shell_ptr->shell, name, &usage_str);
-
-                    if (sub_status_usage == CELIX_SUCCESS && sub_status_desc == CELIX_SUCCESS) {
-                        fprintf(out_ptr, "Command     : %s\n", name);
-                        fprintf(out_ptr, "Usage       : %s\n", usage_str == NULL ? "" : usage_str);
-                        fprintf(out_ptr, "Description : %s\n", desc_str == NULL ? "" : desc_str);
-                    } else {
-                        fprintf(err_ptr, "Error retreiving help info for command '%s'\n", sub);
-                    }
-
-                    if (sub_status_desc != CELIX_SUCCESS && status == CELIX_SUCCESS) {
-                        status = sub_status_desc;
-                    }
-                    if (sub_status_usage != CELIX_SUCCESS && status == CELIX_SUCCESS) {
-                        status = sub_status_usage;
-                    }
+            service_reference_pt command_reference = NULL;
+
+            /* commands are indexed by name, no need to walk all of them */
+            shell_ptr->getCommandReference(shell_ptr->shell, sub, &command_reference);
+            if (command_reference != NULL) {
+                char *usage_str = NULL;
+                char *desc_str = NULL;
+
+                sub_status_desc = shell_ptr->getCommandDescription(shell_ptr->shell, sub, &desc_str);
+                sub_status_usage = shell_ptr->getCommandUsage(shell_ptr->shell, sub, &usage_str);
+
+                if (sub_status_usage == CELIX_SUCCESS && sub_status_desc == CELIX_SUCCESS) {
+                    fprintf(out_ptr, "Command     : %s\n", sub);
+                    fprintf(out_ptr, "Usage       : %s\n", usage_str == NULL ? "" : usage_str);
+                    fprintf(out_ptr, "Description : %s\n", desc_str == NULL ? "" : desc_str);
+                } else {
+                    fprintf(err_ptr, "Error retreiving help info for command '%s'\n", sub);
+                }
+
+                if (sub_status_desc != CELIX_SUCCESS && status == CELIX_SUCCESS) {
+                    status = sub_status_desc;
+                }
+                if (sub_status_usage != CELIX_SUCCESS && status == CELIX_SUCCESS) {
+                    status = sub_status_usage;
                 }
             }
-            arrayList_destroy(commands);
         }
     }
 
+    if (shell_ptr != NULL) {
+        bundleContext_ungetService(context_ptr, shell_service_reference_ptr, NULL);
+    }
+    if (shell_service_reference_ptr != NULL) {
+        bundleContext_ungetServiceReference(context_ptr, shell_service_reference_ptr);
+    }
+
     return status;
 }
@@ -36,7 +36,13 @@ static const char * const EVEN_COLOR = "\033[1m"; //bold
 static const char * const ODD_COLOR = "\033[3m";  //italic
 static const char * const END_COLOR = "\033[0m";
 
+struct lb_entry {
+    long id;
+    bundle_pt bundle;
+};
+
 static char * psCommand_stateString(bundle_state_e state); 
+static int psCommand_compareEntries(const void *a, const void *b);
 
 celix_status_t psCommand_execute(void *_ptr, char *command_line_str, FILE *out_ptr, FILE *err_ptr) {
     celix_status_t status = CELIX_SUCCESS;
@@ -92,41 +98,22 @@ celix_status_t psCommand_execute(void *_ptr, char *command_line_str, FILE *out_p
 
         unsigned int size = arrayList_size(bundles_ptr);
 
-        bundle_pt bundles_array_ptr[size];
+        struct lb_entry *entries = calloc(size > 0 ? size : 1, sizeof(*entries));
 
+        /* look up every bundle id once and sort on it, instead of comparing archives for every pair */
         for (unsigned int i = 0; i < size; i++) {
-            bundles_array_ptr[i] = arrayList_get(bundles_ptr, i);
-        }
-
-        for (unsigned int i = 0; i < size - 1; i++) {
-            for (unsigned int j = i + 1; j < size; j++) {
-                bundle_pt first_ptr = bundles_array_ptr[i];
-                bundle_pt second_ptr = bundles_array_ptr[j];
-
-                bundle_archive_pt first_archive_ptr = NULL;
-                bundle_archive_pt second_archive_ptr = NULL;
-
-                long first_id;
-                long second_id;
-
-                bundle_getArchive(first_ptr, &first_archive_ptr);
-                bundle_getArchive(second_ptr, &second_archive_ptr);
-
-                bundleArchive_getId(first_archive_ptr, &first_id);
-                bundleArchive_getId(second_archive_ptr, &second_id);
-
-                if (first_id > second_id) {
-                    bundle_pt temp_ptr = bundles_array_ptr[i];
-                    bundles_array_ptr[i] = bundles_array_ptr[j];
-                    bundles_array_ptr[j] = temp_ptr;
-                }
+            bundle_archive_pt archive_ptr = NULL;
+            entries[i].bundle = arrayList_get(bundles_ptr, i);
+            if (bundle_getArchive(entries[i].bundle, &archive_ptr) == CELIX_SUCCESS) {
+                bundleArchive_getId(archive_ptr, &entries[i].id);
             }
         }
+        qsort(entries, size, sizeof(*entries), psCommand_compareEntries);
 
         for (unsigned int i = 0; i < size; i++) {
             celix_status_t sub_status;
 
-            bundle_pt bundle_ptr = bundles_array_ptr[i];
+            bundle_pt bundle_ptr = entries[i].bundle;
 
             bundle_archive_pt archive_ptr = NULL;
             long id = 0;
@@ -181,6 +168,7 @@ celix_status_t psCommand_execute(void *_ptr, char *command_line_str, FILE *out_p
             }
         }
 
+        free(entries);
         arrayList_destroy(bundles_ptr);
     }
 
@@ -203,3 +191,9 @@ static char * psCommand_stateString(bundle_state_e state) {
             return "Unknown     ";
     }
 }
+
+static int psCommand_compareEntries(const void *a, const void *b) {
+    const struct lb_entry *first = a;
+    const struct lb_entry *second = b;
+    return (first->id > second->id) - (first->id < second->id);
+}
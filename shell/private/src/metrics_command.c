@@ -0,0 +1,88 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+/*
+ * metrics_command.c
+ *
+ *  \author    	<a href="mailto:dev@celix.apache.org">Apache Celix Project Team</a>
+ *  \copyright	Apache License, Version 2.0
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "bundle_context.h"
+#include "metrics_service.h"
+#include "std_commands.h"
+
+celix_status_t metricsCommand_execute(void *_ptr, char *command_line_str, FILE *out_ptr, FILE *err_ptr) {
+    celix_status_t status = CELIX_SUCCESS;
+    bundle_context_pt context_ptr = _ptr;
+    service_reference_pt reference = NULL;
+    metrics_service_pt metrics = NULL;
+
+    if (!context_ptr || !command_line_str || !out_ptr || !err_ptr) {
+        status = CELIX_ILLEGAL_ARGUMENT;
+    }
+
+    if (status == CELIX_SUCCESS) {
+        status = bundleContext_getServiceReference(context_ptr, CELIX_METRICS_SERVICE_NAME, &reference);
+        if (status == CELIX_SUCCESS && reference == NULL) {
+            fprintf(out_ptr, "No metrics service available\n");
+            return CELIX_SUCCESS;
+        }
+    }
+
+    if (status == CELIX_SUCCESS) {
+        status = bundleContext_getService(context_ptr, reference, (void **) &metrics);
+    }
+
+    if (status == CELIX_SUCCESS) {
+        char *sub_str = NULL;
+        char *save_ptr = NULL;
+
+        strtok_r(command_line_str, OSGI_SHELL_COMMAND_SEPARATOR, &save_ptr);
+        sub_str = strtok_r(NULL, OSGI_SHELL_COMMAND_SEPARATOR, &save_ptr);
+
+        if (sub_str == NULL) {
+            bool enabled = false;
+            metrics->isEnabled(metrics->handle, &enabled);
+            if (!enabled) {
+                fprintf(out_ptr, "# metrics are disabled, use 'metrics enable'\n");
+            }
+            status = metrics->dump(metrics->handle, out_ptr);
+        } else if (strcmp(sub_str, "enable") == 0) {
+            status = metrics->setEnabled(metrics->handle, true);
+        } else if (strcmp(sub_str, "disable") == 0) {
+            status = metrics->setEnabled(metrics->handle, false);
+        } else if (strcmp(sub_str, "reset") == 0) {
+            status = metrics->reset(metrics->handle);
+        } else {
+            fprintf(err_ptr, "Unknown argument '%s'\n", sub_str);
+            status = CELIX_ILLEGAL_ARGUMENT;
+        }
+
+        bool result = true;
+        bundleContext_ungetService(context_ptr, reference, &result);
+    }
+
+    if (reference != NULL) {
+        bundleContext_ungetServiceReference(context_ptr, reference);
+    }
+
+    return status;
+}
@@ -34,6 +34,8 @@
 
 #include "utils.h"
 
+#define SHELL_COMMAND_NAME_LENGTH 64
+
 celix_status_t shell_getCommands(shell_pt shell_ptr, array_list_pt *commands_ptr);
 celix_status_t shell_getCommandUsage(shell_pt shell_ptr, char *command_name_str, char **usage_pstr);
 celix_status_t shell_getCommandDescription(shell_pt shell_ptr, char *command_name_str, char **command_description_pstr);
@@ -63,7 +65,10 @@ celix_status_t shell_create(bundle_context_pt context_ptr, shell_service_pt *she
 		(*shell_service_ptr)->shell->bundle_context_ptr = context_ptr;
 		(*shell_service_ptr)->shell->command_name_map_ptr = hashMap_create(utils_stringHash, NULL, utils_stringEquals, NULL);
 		(*shell_service_ptr)->shell->command_reference_map_ptr = hashMap_create(NULL, NULL, NULL, NULL);
+		status = celixThreadRwlock_create(&(*shell_service_ptr)->shell->lock, NULL);
+	}
 
+	if (status == CELIX_SUCCESS) {
 		(*shell_service_ptr)->getCommands = shell_getCommands;
 		(*shell_service_ptr)->getCommandDescription = shell_getCommandDescription;
 		(*shell_service_ptr)->getCommandUsage = shell_getCommandUsage;
@@ -93,7 +98,15 @@ celix_status_t shell_destroy(shell_service_pt *shell_service_ptr) {
 				hashMap_destroy((*shell_service_ptr)->shell->command_name_map_ptr, false, false);
 			}
 			if ((*shell_service_ptr)->shell->command_reference_map_ptr) {
+				hash_map_iterator_pt iter = hashMapIterator_create((*shell_service_ptr)->shell->command_reference_map_ptr);
+				while (hashMapIterator_hasNext(iter)) {
+					struct shell_command_entry *entry = hashMapIterator_nextValue(iter);
+					free(entry->name);
+					free(entry);
+				}
+				hashMapIterator_destroy(iter);
 				hashMap_destroy((*shell_service_ptr)->shell->command_reference_map_ptr, false, false);
+				celixThreadRwlock_destroy(&(*shell_service_ptr)->shell->lock);
 			}
 			if ((*shell_service_ptr)->shell->logHelper) {
 				logHelper_destroy(&((*shell_service_ptr)->shell->logHelper));
@@ -110,17 +123,13 @@ celix_status_t shell_destroy(shell_service_pt *shell_service_ptr) {
 
 celix_status_t shell_addCommand(shell_pt shell_ptr, service_reference_pt reference_ptr, void *svc) {
     celix_status_t status = CELIX_SUCCESS;
-    command_service_pt command_ptr = NULL;
+    struct shell_command_entry *entry = NULL;
     const char *name_str = NULL;
 
     if (!shell_ptr || !reference_ptr) {
         return CELIX_ILLEGAL_ARGUMENT;
     }
 
-    if (status == CELIX_SUCCESS) {
-        command_ptr = svc;
-    }
-
     if (status == CELIX_SUCCESS) {
         status = serviceReference_getProperty(reference_ptr, "command.name", &name_str);
         if (!name_str) {
@@ -130,12 +139,28 @@ celix_status_t shell_addCommand(shell_pt shell_ptr, service_reference_pt referen
     }
 
     if (status == CELIX_SUCCESS) {
-        hashMap_put(shell_ptr->command_name_map_ptr, (char *)name_str, command_ptr);
-        hashMap_put(shell_ptr->command_reference_map_ptr, reference_ptr, command_ptr);
+        entry = calloc(1, sizeof(*entry));
+        if (!entry) {
+            status = CELIX_ENOMEM;
+        }
+    }
+
+    if (status == CELIX_SUCCESS) {
+        entry->name = strdup(name_str);
+        entry->reference = reference_ptr;
+        entry->service = svc;
+
+        celixThreadRwlock_writeLock(&shell_ptr->lock);
+        if (hashMap_containsKey(shell_ptr->command_name_map_ptr, entry->name)) {
+            logHelper_log(shell_ptr->logHelper, OSGI_LOGSERVICE_WARNING, "Command '%s' is registered more than once, using the last registered command", entry->name);
+            hashMap_remove(shell_ptr->command_name_map_ptr, entry->name);
+        }
+        hashMap_put(shell_ptr->command_name_map_ptr, entry->name, entry);
+        hashMap_put(shell_ptr->command_reference_map_ptr, reference_ptr, entry);
+        celixThreadRwlock_unlock(&shell_ptr->lock);
     }
 
     if (status != CELIX_SUCCESS) {
-        shell_removeCommand(shell_ptr, reference_ptr, svc);
         char err[32];
         celix_strerror(status, err, 32);
         logHelper_log(shell_ptr->logHelper, OSGI_LOGSERVICE_ERROR, "Could not add command, got error %s\n", err);
@@ -147,29 +172,26 @@ celix_status_t shell_addCommand(shell_pt shell_ptr, service_reference_pt referen
 celix_status_t shell_removeCommand(shell_pt shell_ptr, service_reference_pt reference_ptr, void *svc) {
     celix_status_t status = CELIX_SUCCESS;
 
-    command_service_pt command_ptr = NULL;
-    const char *name_str = NULL;
+    struct shell_command_entry *entry = NULL;
 
     if (!shell_ptr || !reference_ptr) {
         status = CELIX_ILLEGAL_ARGUMENT;
     }
 
     if (status == CELIX_SUCCESS) {
-        command_ptr = hashMap_remove(shell_ptr->command_reference_map_ptr, reference_ptr);
-        if (!command_ptr) {
+        celixThreadRwlock_writeLock(&shell_ptr->lock);
+        entry = hashMap_remove(shell_ptr->command_reference_map_ptr, reference_ptr);
+        if (!entry) {
             status = CELIX_ILLEGAL_ARGUMENT;
+        } else if (hashMap_get(shell_ptr->command_name_map_ptr, entry->name) == entry) {
+            hashMap_remove(shell_ptr->command_name_map_ptr, entry->name);
         }
+        celixThreadRwlock_unlock(&shell_ptr->lock);
     }
 
-    if (status == CELIX_SUCCESS) {
-        status = serviceReference_getProperty(reference_ptr, "command.name", &name_str);
-        if (!name_str) {
-            status = CELIX_BUNDLE_EXCEPTION;
-        }
-    }
-
-    if (status == CELIX_SUCCESS) {
-        hashMap_remove(shell_ptr->command_name_map_ptr, (char *)name_str);
+    if (entry) {
+        free(entry->name);
+        free(entry);
     }
 
     return status;
@@ -185,19 +207,21 @@ celix_status_t shell_getCommands(shell_pt shell_ptr, array_list_pt *commands_ptr
 	}
 
 	if (status == CELIX_SUCCESS) {
+		celixThreadRwlock_readLock(&shell_ptr->lock);
 		iter = hashMapIterator_create(shell_ptr->command_name_map_ptr);
 		if (!iter) {
 			status = CELIX_BUNDLE_EXCEPTION;
 		}
-	}
 
-	if (status == CELIX_SUCCESS) {
-		arrayList_create(commands_ptr);
-		while (hashMapIterator_hasNext(iter)) {
-			char *name_str = hashMapIterator_nextKey(iter);
-			arrayList_add(*commands_ptr, name_str);
+		if (status == CELIX_SUCCESS) {
+			arrayList_create(commands_ptr);
+			while (hashMapIterator_hasNext(iter)) {
+				char *name_str = hashMapIterator_nextKey(iter);
+				arrayList_add(*commands_ptr, strdup(name_str));
+			}
+			hashMapIterator_destroy(iter);
 		}
-		hashMapIterator_destroy(iter);
+		celixThreadRwlock_unlock(&shell_ptr->lock);
 	}
 
 	return status;
@@ -258,19 +282,12 @@ celix_status_t shell_getCommandReference(shell_pt shell_ptr, char *command_name_
 	}
 
 	if (status == CELIX_SUCCESS) {
-		*command_reference_ptr = NULL;
-		hash_map_iterator_pt iter = hashMapIterator_create(shell_ptr->command_reference_map_ptr);
-		while (hashMapIterator_hasNext(iter)) {
-			hash_map_entry_pt entry = hashMapIterator_nextEntry(iter);
-			service_reference_pt reference = hashMapEntry_getKey(entry);
-			const char *name_str = NULL;
-			serviceReference_getProperty(reference, "command.name", &name_str);
-			if (strcmp(name_str, command_name_str) == 0) {
-				*command_reference_ptr = (service_reference_pt) hashMapEntry_getKey(entry);
-				break;
-			}
-		}
-		hashMapIterator_destroy(iter);
+		struct shell_command_entry *entry = NULL;
+
+		celixThreadRwlock_readLock(&shell_ptr->lock);
+		entry = hashMap_get(shell_ptr->command_name_map_ptr, command_name_str);
+		*command_reference_ptr = entry != NULL ? entry->reference : NULL;
+		celixThreadRwlock_unlock(&shell_ptr->lock);
 	}
 
 	return status;
@@ -287,10 +304,26 @@ celix_status_t shell_executeCommand(shell_pt shell_ptr, char *command_line_str,
 
 	if (status == CELIX_SUCCESS) {
 		size_t pos = strcspn(command_line_str, " ");
+		char name_buf[SHELL_COMMAND_NAME_LENGTH];
+		char *command_name_str = name_buf;
+		struct shell_command_entry *entry = NULL;
+
+		/* most command names fit on the stack, no need to allocate for every executed line */
+		if (pos < sizeof(name_buf)) {
+			memcpy(name_buf, command_line_str, pos);
+			name_buf[pos] = '\0';
+		} else {
+			command_name_str = strndup(command_line_str, pos);
+		}
+
+		celixThreadRwlock_readLock(&shell_ptr->lock);
+		entry = hashMap_get(shell_ptr->command_name_map_ptr, command_name_str);
+		command_ptr = entry != NULL ? entry->service : NULL;
+		celixThreadRwlock_unlock(&shell_ptr->lock);
 
-		char *command_name_str = (pos != strlen(command_line_str)) ? strndup(command_line_str, pos) : strdup(command_line_str);
-		command_ptr = hashMap_get(shell_ptr->command_name_map_ptr, command_name_str);
-		free(command_name_str);
+		if (command_name_str != name_buf) {
+			free(command_name_str);
+		}
 		if (!command_ptr) {
 			fprintf(err, "No such command\n");
 			status = CELIX_BUNDLE_EXCEPTION;
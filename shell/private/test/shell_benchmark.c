@@ -0,0 +1,183 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+/*
+ * shell_benchmark.c
+ *
+ * Shell benchmark. Registers the shell service, the lb, help and inspect commands and NR_OF_COMMANDS benchmark
+ * commands the same way the shell activator does, then executes NR_OF_EXECUTIONS mixed command lines.
+ *
+ *  \author    	<a href="mailto:dev@celix.apache.org">Apache Celix Project Team</a>
+ *  \copyright	Apache License, Version 2.0
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "celix_launcher.h"
+#include "framework.h"
+#include "constants.h"
+#include "service_tracker.h"
+#include "shell_private.h"
+#include "std_commands.h"
+
+#define NR_OF_COMMANDS 500
+#define NR_OF_EXECUTIONS 10000
+#define NR_OF_KINDS 4
+
+static const char *shellBenchmark_kinds[NR_OF_KINDS] = { "lb", "help", "inspect", "plain" };
+
+struct benchmark_command {
+	char name[32];
+	command_service_t service;
+	service_registration_pt reg;
+};
+
+static double shellBenchmark_elapsedMs(struct timespec *begin, struct timespec *end) {
+	return (end->tv_sec - begin->tv_sec) * 1000.0 + (end->tv_nsec - begin->tv_nsec) / 1000000.0;
+}
+
+static celix_status_t shellBenchmark_execute(void *handle, char *commandLine, FILE *out, FILE *err) {
+	fprintf(out, "%s\n", commandLine);
+	return CELIX_SUCCESS;
+}
+
+static service_registration_pt shellBenchmark_registerCommand(bundle_context_pt context, command_service_pt service, char *name) {
+	service_registration_pt reg = NULL;
+	properties_pt props = properties_create();
+
+	properties_set(props, OSGI_SHELL_COMMAND_NAME, name);
+	properties_set(props, OSGI_SHELL_COMMAND_USAGE, name);
+	properties_set(props, OSGI_SHELL_COMMAND_DESCRIPTION, "benchmark command");
+	properties_set(props, CELIX_FRAMEWORK_SERVICE_LANGUAGE, CELIX_FRAMEWORK_SERVICE_C_LANGUAGE);
+	bundleContext_registerService(context, (char *) OSGI_SHELL_COMMAND_SERVICE_NAME, service, props, &reg);
+
+	return reg;
+}
+
+int main(int argc, char **argv) {
+	framework_pt framework = NULL;
+	bundle_pt bundle = NULL;
+	bundle_context_pt context = NULL;
+	shell_service_pt shell = NULL;
+	service_registration_pt shellReg = NULL;
+	service_tracker_customizer_pt customizer = NULL;
+	service_tracker_pt tracker = NULL;
+	struct benchmark_command *commands = NULL;
+	command_service_t lb;
+	command_service_t help;
+	command_service_t inspect;
+	service_registration_pt stdRegs[3];
+	struct timespec begin;
+	struct timespec end;
+	FILE *devNull = NULL;
+	double kindMs[NR_OF_KINDS] = { 0 };
+	int kindCount[NR_OF_KINDS] = { 0 };
+	int failures = 0;
+	int i;
+
+	properties_pt config = properties_create();
+	properties_set(config, OSGI_FRAMEWORK_FRAMEWORK_STORAGE_CLEAN, OSGI_FRAMEWORK_FRAMEWORK_STORAGE_CLEAN_ONFIRSTINIT);
+	if (celixLauncher_launchWithProperties(config, &framework) != CELIX_SUCCESS) {
+		return EXIT_FAILURE;
+	}
+	framework_getFrameworkBundle(framework, &bundle);
+	bundle_getContext(bundle, &context);
+	devNull = fopen("/dev/null", "w");
+
+	shell_create(context, &shell);
+	bundleContext_registerService(context, (char *) OSGI_SHELL_SERVICE_NAME, shell, NULL, &shellReg);
+	serviceTrackerCustomizer_create(shell->shell, NULL, (void *) shell_addCommand, NULL, (void *) shell_removeCommand, &customizer);
+	serviceTracker_create(context, (char *) OSGI_SHELL_COMMAND_SERVICE_NAME, customizer, &tracker);
+	serviceTracker_open(tracker);
+
+	lb.handle = context;
+	lb.executeCommand = psCommand_execute;
+	help.handle = context;
+	help.executeCommand = helpCommand_execute;
+	inspect.handle = context;
+	inspect.executeCommand = inspectCommand_execute;
+	stdRegs[0] = shellBenchmark_registerCommand(context, &lb, "lb");
+	stdRegs[1] = shellBenchmark_registerCommand(context, &help, "help");
+	stdRegs[2] = shellBenchmark_registerCommand(context, &inspect, "inspect");
+
+	commands = calloc(NR_OF_COMMANDS, sizeof(*commands));
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	for (i = 0; i < NR_OF_COMMANDS; ++i) {
+		snprintf(commands[i].name, sizeof(commands[i].name), "bench_%i", i);
+		commands[i].service.handle = &commands[i];
+		commands[i].service.executeCommand = shellBenchmark_execute;
+		commands[i].reg = shellBenchmark_registerCommand(context, &commands[i].service, commands[i].name);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	printf("Registered %i commands in %.3f ms\n", NR_OF_COMMANDS, shellBenchmark_elapsedMs(&begin, &end));
+
+	for (i = 0; i < NR_OF_EXECUTIONS; ++i) {
+		struct timespec commandBegin;
+		struct timespec commandEnd;
+		char line[64];
+		int kind = i % 10 < 3 ? i % 10 : 3;
+
+		switch (kind) {
+			case 0:
+				snprintf(line, sizeof(line), "lb -s");
+				break;
+			case 1:
+				snprintf(line, sizeof(line), "help bench_%i", i % NR_OF_COMMANDS);
+				break;
+			case 2:
+				snprintf(line, sizeof(line), "inspect service capability");
+				break;
+			default:
+				snprintf(line, sizeof(line), "bench_%i argument", i % NR_OF_COMMANDS);
+				break;
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &commandBegin);
+		if (shell->executeCommand(shell->shell, line, devNull, devNull) != CELIX_SUCCESS) {
+			failures++;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &commandEnd);
+		kindMs[kind] += shellBenchmark_elapsedMs(&commandBegin, &commandEnd);
+		kindCount[kind]++;
+	}
+	for (i = 0; i < NR_OF_KINDS; ++i) {
+		printf("Executed %i %s commands in %.3f ms\n", kindCount[i], shellBenchmark_kinds[i], kindMs[i]);
+	}
+	printf("Executed %i commands, %i failed\n", NR_OF_EXECUTIONS, failures);
+
+	for (i = 0; i < NR_OF_COMMANDS; ++i) {
+		serviceRegistration_unregister(commands[i].reg);
+	}
+	for (i = 0; i < 3; ++i) {
+		serviceRegistration_unregister(stdRegs[i]);
+	}
+	serviceTracker_close(tracker);
+	serviceTracker_destroy(tracker);
+	serviceRegistration_unregister(shellReg);
+	shell_destroy(&shell);
+	free(commands);
+	fclose(devNull);
+
+	celixLauncher_stop(framework);
+	celixLauncher_waitForShutdown(framework);
+	celixLauncher_destroy(framework);
+
+	return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
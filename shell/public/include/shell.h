@@ -38,6 +38,10 @@ typedef shell_t* shell_pt;
 struct shellService {
 	shell_pt shell;
 
+	/**
+	 * Creates a list with copies of the names of the registered commands. The caller frees the names and destroys
+	 * the list.
+	 */
 	celix_status_t (*getCommands)(shell_pt shell_ptr, array_list_pt *commands_ptr);
 	celix_status_t (*getCommandUsage)(shell_pt shell_ptr, char *command_name_str, char **usage_str);
 	celix_status_t (*getCommandDescription)(shell_pt shell_ptr, char *command_name_str, char **command_description_str);
@@ -415,6 +415,9 @@ static int autoComplete(shell_service_t* shellSvc, char *in, int cursorPos, size
 		}
 		printf("\n");
 	}
+	for (int i = 0; i < nrCmds; i++) {
+		free(arrayList_get(commandList, i));
+	}
 	arrayList_destroy(commandList);
 	arrayList_destroy(possibleCmdList);
 	return cursorPos;
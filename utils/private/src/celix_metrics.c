@@ -0,0 +1,416 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+/*
+ * celix_metrics.c
+ *
+ *  \author    	<a href="mailto:dev@celix.apache.org">Apache Celix Project Team</a>
+ *  \copyright	Apache License, Version 2.0
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "celix_metrics.h"
+#include "celix_threads.h"
+#include "array_list.h"
+
+#define METRICS_SHARDS 16
+#define METRICS_CACHE_LINE 64
+
+// values below 16 have their own bucket, larger values get 8 sub buckets per power of two up to 2^47
+#define METRICS_LINEAR_BUCKETS 16
+#define METRICS_SUB_BUCKET_BITS 3
+#define METRICS_SUB_BUCKETS (1 << METRICS_SUB_BUCKET_BITS)
+#define METRICS_MIN_EXPONENT 4
+#define METRICS_MAX_EXPONENT 47
+#define METRICS_BUCKETS (METRICS_LINEAR_BUCKETS + (METRICS_MAX_EXPONENT - METRICS_MIN_EXPONENT + 1) * METRICS_SUB_BUCKETS)
+
+struct metric_shard {
+    uint64_t count; //counter value or number of recorded values
+    uint64_t sum;
+    uint64_t max;
+    uint64_t *buckets;
+} __attribute__((aligned(METRICS_CACHE_LINE)));
+
+struct celix_metric {
+    struct metric_shard shards[METRICS_SHARDS];
+    char *name;
+    celix_metric_type_e type;
+    unsigned int refCount; //protected by metrics_lock
+    int64_t gauge;
+};
+
+static volatile bool metrics_enabled = false;
+
+static celix_thread_once_t metrics_init = CELIX_THREAD_ONCE_INIT;
+static celix_thread_mutex_t metrics_lock;
+static array_list_pt metrics_list = NULL; //protected by metrics_lock
+
+static unsigned int metrics_nextShard = 0;
+static __thread unsigned int metrics_threadShard = 0; //shard index + 1, 0 until the first update of a thread
+
+static void celixMetrics_init(void);
+static struct metric_shard *celixMetrics_shard(celix_metric_pt metric);
+static unsigned int celixMetrics_bucket(uint64_t value);
+static uint64_t celixMetrics_bucketUpperBound(unsigned int bucket);
+static uint64_t celixMetrics_merge(celix_metric_pt metric, uint64_t *buckets, uint64_t *sum, uint64_t *max);
+static uint64_t celixMetrics_percentileOf(uint64_t *buckets, uint64_t count, uint64_t max, double percentile);
+static void celixMetrics_destroy(celix_metric_pt metric);
+
+void celixMetrics_setEnabled(bool enabled) {
+    metrics_enabled = enabled;
+}
+
+bool celixMetrics_isEnabled(void) {
+    return metrics_enabled;
+}
+
+celix_status_t celixMetrics_get(const char *name, celix_metric_type_e type, celix_metric_pt *out) {
+    celix_status_t status = CELIX_SUCCESS;
+    celix_metric_pt metric = NULL;
+    unsigned int i;
+
+    if (name == NULL || out == NULL) {
+        return CELIX_ILLEGAL_ARGUMENT;
+    }
+
+    celixThread_once(&metrics_init, celixMetrics_init);
+    celixThreadMutex_lock(&metrics_lock);
+    for (i = 0; i < arrayList_size(metrics_list); i++) {
+        celix_metric_pt existing = arrayList_get(metrics_list, i);
+        if (strcmp(existing->name, name) == 0) {
+            metric = existing;
+            break;
+        }
+    }
+
+    if (metric != NULL) {
+        if (metric->type == type) {
+            metric->refCount++;
+        } else {
+            metric = NULL;
+            status = CELIX_ILLEGAL_ARGUMENT;
+        }
+    } else if (posix_memalign((void **) &metric, METRICS_CACHE_LINE, sizeof(*metric)) != 0) {
+        metric = NULL;
+        status = CELIX_ENOMEM;
+    } else {
+        memset(metric, 0, sizeof(*metric));
+        metric->name = strdup(name);
+        metric->type = type;
+        metric->refCount = 1;
+        if (type == CELIX_METRIC_HISTOGRAM) {
+            for (i = 0; i < METRICS_SHARDS; i++) {
+                metric->shards[i].buckets = calloc(METRICS_BUCKETS, sizeof(uint64_t));
+                if (metric->shards[i].buckets == NULL) {
+                    status = CELIX_ENOMEM;
+                }
+            }
+        }
+        if (metric->name == NULL) {
+            status = CELIX_ENOMEM;
+        }
+
+        if (status == CELIX_SUCCESS) {
+            arrayList_add(metrics_list, metric);
+        } else {
+            celixMetrics_destroy(metric);
+            metric = NULL;
+        }
+    }
+    celixThreadMutex_unlock(&metrics_lock);
+
+    *out = metric;
+    return status;
+}
+
+void celixMetrics_release(celix_metric_pt metric) {
+    if (metric == NULL) {
+        return;
+    }
+
+    celixThreadMutex_lock(&metrics_lock);
+    metric->refCount--;
+    if (metric->refCount == 0) {
+        arrayList_removeElement(metrics_list, metric);
+        celixMetrics_destroy(metric);
+    }
+    celixThreadMutex_unlock(&metrics_lock);
+}
+
+void celixMetrics_add(celix_metric_pt counter, uint64_t value) {
+    if (metrics_enabled && counter != NULL) {
+        __sync_add_and_fetch(&celixMetrics_shard(counter)->count, value);
+    }
+}
+
+void celixMetrics_setGauge(celix_metric_pt gauge, int64_t value) {
+    if (metrics_enabled && gauge != NULL) {
+        __sync_lock_test_and_set(&gauge->gauge, value);
+    }
+}
+
+void celixMetrics_addGauge(celix_metric_pt gauge, int64_t value) {
+    if (metrics_enabled && gauge != NULL) {
+        __sync_add_and_fetch(&gauge->gauge, value);
+    }
+}
+
+void celixMetrics_record(celix_metric_pt histogram, uint64_t value) {
+    struct metric_shard *shard;
+    uint64_t max;
+
+    if (!metrics_enabled || histogram == NULL || histogram->type != CELIX_METRIC_HISTOGRAM) {
+        return;
+    }
+
+    shard = celixMetrics_shard(histogram);
+    __sync_add_and_fetch(&shard->buckets[celixMetrics_bucket(value)], 1);
+    __sync_add_and_fetch(&shard->sum, value);
+    max = shard->max;
+    while (value > max && !__sync_bool_compare_and_swap(&shard->max, max, value)) {
+        max = shard->max;
+    }
+    // the count is updated last, readers never see more values than the buckets hold
+    __sync_add_and_fetch(&shard->count, 1);
+}
+
+uint64_t celixMetrics_startTimer(void) {
+    struct timespec now;
+
+    if (!metrics_enabled) {
+        return 0;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000ULL + now.tv_nsec + 1;
+}
+
+void celixMetrics_stopTimer(celix_metric_pt histogram, uint64_t start) {
+    struct timespec now;
+    uint64_t end;
+
+    if (start == 0) {
+        return;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    end = now.tv_sec * 1000000000ULL + now.tv_nsec + 1;
+    celixMetrics_record(histogram, end > start ? end - start : 0);
+}
+
+int64_t celixMetrics_value(celix_metric_pt metric) {
+    int64_t value = 0;
+    unsigned int i;
+
+    if (metric == NULL) {
+        return 0;
+    }
+
+    if (metric->type == CELIX_METRIC_GAUGE) {
+        value = __sync_add_and_fetch(&metric->gauge, 0);
+    } else {
+        for (i = 0; i < METRICS_SHARDS; i++) {
+            value += __sync_add_and_fetch(&metric->shards[i].count, 0);
+        }
+    }
+    return value;
+}
+
+uint64_t celixMetrics_percentile(celix_metric_pt histogram, double percentile) {
+    uint64_t result = 0;
+    uint64_t *buckets;
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+
+    if (histogram == NULL || histogram->type != CELIX_METRIC_HISTOGRAM) {
+        return 0;
+    }
+
+    buckets = calloc(METRICS_BUCKETS, sizeof(*buckets));
+    if (buckets != NULL) {
+        count = celixMetrics_merge(histogram, buckets, &sum, &max);
+        result = celixMetrics_percentileOf(buckets, count, max, percentile);
+        free(buckets);
+    }
+    return result;
+}
+
+void celixMetrics_reset(void) {
+    unsigned int i;
+    unsigned int j;
+
+    celixThread_once(&metrics_init, celixMetrics_init);
+    celixThreadMutex_lock(&metrics_lock);
+    for (i = 0; i < arrayList_size(metrics_list); i++) {
+        celix_metric_pt metric = arrayList_get(metrics_list, i);
+        // gauges describe the current state and keep their value
+        for (j = 0; j < METRICS_SHARDS; j++) {
+            struct metric_shard *shard = &metric->shards[j];
+            __sync_lock_test_and_set(&shard->count, 0);
+            __sync_lock_test_and_set(&shard->sum, 0);
+            __sync_lock_test_and_set(&shard->max, 0);
+            if (shard->buckets != NULL) {
+                memset(shard->buckets, 0, METRICS_BUCKETS * sizeof(uint64_t));
+            }
+        }
+    }
+    celixThreadMutex_unlock(&metrics_lock);
+}
+
+celix_status_t celixMetrics_dump(FILE *out) {
+    static const double percentiles[] = { 50.0, 90.0, 99.0, 99.9, 100.0 };
+    static const char * const quantiles[] = { "0.5", "0.9", "0.99", "0.999", "1" };
+    celix_status_t status = CELIX_SUCCESS;
+    uint64_t *buckets;
+    unsigned int i;
+    unsigned int j;
+
+    buckets = calloc(METRICS_BUCKETS, sizeof(*buckets));
+    if (buckets == NULL) {
+        return CELIX_ENOMEM;
+    }
+
+    celixThread_once(&metrics_init, celixMetrics_init);
+    celixThreadMutex_lock(&metrics_lock);
+    for (i = 0; i < arrayList_size(metrics_list); i++) {
+        celix_metric_pt metric = arrayList_get(metrics_list, i);
+        uint64_t count;
+        uint64_t sum;
+        uint64_t max;
+
+        switch (metric->type) {
+            case CELIX_METRIC_COUNTER:
+                fprintf(out, "# TYPE %s counter\n%s %lli\n", metric->name, metric->name, (long long) celixMetrics_value(metric));
+                break;
+            case CELIX_METRIC_GAUGE:
+                fprintf(out, "# TYPE %s gauge\n%s %lli\n", metric->name, metric->name, (long long) celixMetrics_value(metric));
+                break;
+            case CELIX_METRIC_HISTOGRAM:
+                memset(buckets, 0, METRICS_BUCKETS * sizeof(*buckets));
+                count = celixMetrics_merge(metric, buckets, &sum, &max);
+                fprintf(out, "# TYPE %s summary\n", metric->name);
+                for (j = 0; j < sizeof(percentiles) / sizeof(percentiles[0]); j++) {
+                    fprintf(out, "%s{quantile=\"%s\"} %llu\n", metric->name, quantiles[j],
+                            (unsigned long long) celixMetrics_percentileOf(buckets, count, max, percentiles[j]));
+                }
+                fprintf(out, "%s_sum %llu\n%s_count %llu\n", metric->name, (unsigned long long) sum, metric->name, (unsigned long long) count);
+                break;
+        }
+    }
+    celixThreadMutex_unlock(&metrics_lock);
+
+    free(buckets);
+    if (ferror(out)) {
+        status = CELIX_FILE_IO_EXCEPTION;
+    }
+    return status;
+}
+
+static void celixMetrics_init(void) {
+    celixThreadMutex_create(&metrics_lock, NULL);
+    arrayList_create(&metrics_list);
+}
+
+static struct metric_shard *celixMetrics_shard(celix_metric_pt metric) {
+    if (metrics_threadShard == 0) {
+        metrics_threadShard = __sync_fetch_and_add(&metrics_nextShard, 1) % METRICS_SHARDS + 1;
+    }
+    return &metric->shards[metrics_threadShard - 1];
+}
+
+static unsigned int celixMetrics_bucket(uint64_t value) {
+    unsigned int exponent;
+
+    if (value < METRICS_LINEAR_BUCKETS) {
+        return (unsigned int) value;
+    }
+    exponent = 63 - __builtin_clzll(value);
+    if (exponent > METRICS_MAX_EXPONENT) {
+        return METRICS_BUCKETS - 1;
+    }
+    return METRICS_LINEAR_BUCKETS + (exponent - METRICS_MIN_EXPONENT) * METRICS_SUB_BUCKETS
+            + ((value >> (exponent - METRICS_SUB_BUCKET_BITS)) & (METRICS_SUB_BUCKETS - 1));
+}
+
+static uint64_t celixMetrics_bucketUpperBound(unsigned int bucket) {
+    unsigned int exponent;
+    unsigned int subBucket;
+    unsigned int shift;
+
+    if (bucket < METRICS_LINEAR_BUCKETS) {
+        return bucket;
+    }
+    exponent = METRICS_MIN_EXPONENT + (bucket - METRICS_LINEAR_BUCKETS) / METRICS_SUB_BUCKETS;
+    subBucket = (bucket - METRICS_LINEAR_BUCKETS) % METRICS_SUB_BUCKETS;
+    shift = exponent - METRICS_SUB_BUCKET_BITS;
+    return (((uint64_t) (METRICS_SUB_BUCKETS + subBucket + 1)) << shift) - 1;
+}
+
+static uint64_t celixMetrics_merge(celix_metric_pt metric, uint64_t *buckets, uint64_t *sum, uint64_t *max) {
+    uint64_t count = 0;
+    unsigned int i;
+    unsigned int j;
+
+    *sum = 0;
+    *max = 0;
+    for (i = 0; i < METRICS_SHARDS; i++) {
+        struct metric_shard *shard = &metric->shards[i];
+        uint64_t shardMax = __sync_add_and_fetch(&shard->max, 0);
+
+        count += __sync_add_and_fetch(&shard->count, 0);
+        *sum += __sync_add_and_fetch(&shard->sum, 0);
+        *max = shardMax > *max ? shardMax : *max;
+        for (j = 0; j < METRICS_BUCKETS; j++) {
+            buckets[j] += shard->buckets[j];
+        }
+    }
+    return count;
+}
+
+static uint64_t celixMetrics_percentileOf(uint64_t *buckets, uint64_t count, uint64_t max, double percentile) {
+    uint64_t target;
+    uint64_t seen = 0;
+    uint64_t bound;
+    unsigned int i;
+
+    if (count == 0) {
+        return 0;
+    }
+
+    target = (uint64_t) (percentile / 100.0 * count + 0.999999);
+    target = target == 0 ? 1 : target;
+    for (i = 0; i < METRICS_BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen >= target) {
+            break;
+        }
+    }
+    bound = i < METRICS_BUCKETS ? celixMetrics_bucketUpperBound(i) : max;
+    return bound < max ? bound : max;
+}
+
+static void celixMetrics_destroy(celix_metric_pt metric) {
+    unsigned int i;
+
+    for (i = 0; i < METRICS_SHARDS; i++) {
+        free(metric->shards[i].buckets);
+    }
+    free(metric->name);
+    free(metric);
+}
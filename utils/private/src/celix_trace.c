@@ -0,0 +1,298 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+/*
+ * celix_trace.c
+ *
+ *  \author    	<a href="mailto:dev@celix.apache.org">Apache Celix Project Team</a>
+ *  \copyright	Apache License, Version 2.0
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "celix_trace.h"
+#include "celix_threads.h"
+
+#define TRACE_NAME_LEN 24
+#define TRACE_DETAIL_LEN 40
+
+enum trace_span_state {
+    TRACE_SPAN_OFF = 0,
+    TRACE_SPAN_RECORDED,
+    TRACE_SPAN_UNSAMPLED
+};
+
+struct trace_event {
+    volatile uint64_t seq; //index + 1 of the event in the slot, 0 while the slot is written
+    uint64_t traceId;
+    uint64_t spanId;
+    uint64_t parentId;
+    uint64_t start;
+    uint64_t duration;
+    unsigned int threadId;
+    char name[TRACE_NAME_LEN]; //copied, bundles defining the name may be unloaded before the dump
+    char detail[TRACE_DETAIL_LEN];
+};
+
+static volatile unsigned int trace_sampleRate = 0;
+
+static celix_thread_once_t trace_init = CELIX_THREAD_ONCE_INIT;
+static struct trace_event *trace_buffer = NULL;
+static uint64_t trace_head = 0;
+
+// all thread state in one thread local. The initial exec model avoids a __tls_get_addr call per span, celix_utils is
+// loaded at startup (and the state is small enough for the static TLS surplus when it is not)
+struct trace_thread {
+    celix_trace_context_t current;
+    unsigned int countdown;
+    unsigned int unsampledDepth; //open spans below an unsampled root
+    unsigned int threadId;
+    uint64_t random;
+};
+
+static unsigned int trace_nextThreadId = 0;
+static __thread struct trace_thread trace_thread __attribute__((tls_model("initial-exec")));
+
+static void celixTrace_init(void);
+static uint64_t celixTrace_now(void);
+static uint64_t celixTrace_newId(struct trace_thread *thread);
+static void celixTrace_start(struct trace_thread *thread, celix_trace_span_t *span, const char *name, const char *detail, uint64_t traceId, uint64_t parentId);
+static void celixTrace_record(struct trace_thread *thread, celix_trace_span_t *span, uint64_t end);
+static void celixTrace_copyString(char *dest, const char *src, size_t size);
+static void celixTrace_writeString(FILE *out, const char *str);
+
+celix_status_t celixTrace_setSampleRate(unsigned int rate) {
+    if (rate > 0) {
+        celixThread_once(&trace_init, celixTrace_init);
+        if (trace_buffer == NULL) {
+            return CELIX_ENOMEM;
+        }
+    }
+    trace_sampleRate = rate;
+    return CELIX_SUCCESS;
+}
+
+unsigned int celixTrace_getSampleRate(void) {
+    return trace_sampleRate;
+}
+
+void celixTrace_beginSpan(const char *name, const char *detail, celix_trace_span_t *span) {
+    celixTrace_beginRemoteSpan(name, detail, NULL, span);
+}
+
+void celixTrace_beginRemoteSpan(const char *name, const char *detail, const celix_trace_context_t *remote, celix_trace_span_t *span) {
+    unsigned int rate = trace_sampleRate;
+    struct trace_thread *thread;
+
+    span->state = TRACE_SPAN_OFF;
+    if (rate == 0) {
+        return;
+    }
+
+    thread = &trace_thread;
+    if (remote != NULL && remote->traceId != 0) {
+        // the sender already decided to sample this trace
+        celixTrace_start(thread, span, name, detail, remote->traceId, remote->spanId);
+    } else if (thread->current.traceId != 0) {
+        celixTrace_start(thread, span, name, detail, thread->current.traceId, thread->current.spanId);
+    } else if (thread->unsampledDepth > 0) {
+        thread->unsampledDepth++;
+        span->state = TRACE_SPAN_UNSAMPLED;
+    } else {
+        if (thread->countdown == 0 || thread->countdown > rate) {
+            thread->countdown = 1; //the first root of a thread is sampled
+        }
+        if (--thread->countdown == 0) {
+            thread->countdown = rate;
+            celixTrace_start(thread, span, name, detail, celixTrace_newId(thread), 0);
+        } else {
+            thread->unsampledDepth++;
+            span->state = TRACE_SPAN_UNSAMPLED;
+        }
+    }
+}
+
+void celixTrace_endSpan(celix_trace_span_t *span) {
+    if (span->state == TRACE_SPAN_RECORDED) {
+        struct trace_thread *thread = &trace_thread;
+        celixTrace_record(thread, span, celixTrace_now());
+        thread->current = span->previous;
+    } else if (span->state == TRACE_SPAN_UNSAMPLED) {
+        trace_thread.unsampledDepth--;
+    }
+    span->state = TRACE_SPAN_OFF;
+}
+
+void celixTrace_currentContext(celix_trace_context_t *context) {
+    if (trace_sampleRate == 0) {
+        context->traceId = 0;
+        context->spanId = 0;
+    } else {
+        *context = trace_thread.current;
+    }
+}
+
+celix_status_t celixTrace_dump(FILE *out) {
+    celix_status_t status = CELIX_SUCCESS;
+    uint64_t head = __sync_add_and_fetch(&trace_head, 0);
+    uint64_t first = head > CELIX_TRACE_BUFFER_SIZE ? head - CELIX_TRACE_BUFFER_SIZE : 0;
+    uint64_t i;
+    bool separator = false;
+    int pid = getpid();
+
+    fprintf(out, "{\"traceEvents\":[");
+    for (i = first; i < head && trace_buffer != NULL; i++) {
+        struct trace_event *slot = &trace_buffer[i % CELIX_TRACE_BUFFER_SIZE];
+        struct trace_event event;
+
+        // copy the event and check it was not overwritten while copying
+        if (slot->seq != i + 1) {
+            continue;
+        }
+        __sync_synchronize();
+        memcpy(&event, slot, sizeof(event));
+        __sync_synchronize();
+        if (slot->seq != i + 1) {
+            continue;
+        }
+        event.name[TRACE_NAME_LEN - 1] = '\0';
+        event.detail[TRACE_DETAIL_LEN - 1] = '\0';
+
+        fprintf(out, "%s\n{\"name\":", separator ? "," : "");
+        celixTrace_writeString(out, event.name);
+        fprintf(out, ",\"cat\":\"celix\",\"ph\":\"X\",\"ts\":%llu.%03llu,\"dur\":%llu.%03llu,\"pid\":%i,\"tid\":%u,",
+                (unsigned long long) (event.start / 1000), (unsigned long long) (event.start % 1000),
+                (unsigned long long) (event.duration / 1000), (unsigned long long) (event.duration % 1000),
+                pid, event.threadId);
+        fprintf(out, "\"args\":{\"trace\":\"%016llx\",\"span\":\"%016llx\",\"parent\":\"%016llx\",\"detail\":",
+                (unsigned long long) event.traceId, (unsigned long long) event.spanId, (unsigned long long) event.parentId);
+        celixTrace_writeString(out, event.detail);
+        fprintf(out, "}}");
+        separator = true;
+    }
+    fprintf(out, "\n],\"displayTimeUnit\":\"ns\"}\n");
+
+    if (ferror(out)) {
+        status = CELIX_FILE_IO_EXCEPTION;
+    }
+    return status;
+}
+
+celix_status_t celixTrace_dumpToFile(const char *path) {
+    celix_status_t status;
+    FILE *out;
+
+    if (path == NULL) {
+        return CELIX_ILLEGAL_ARGUMENT;
+    }
+
+    out = fopen(path, "w");
+    if (out == NULL) {
+        return CELIX_FILE_IO_EXCEPTION;
+    }
+    status = celixTrace_dump(out);
+    if (fclose(out) != 0) {
+        status = CELIX_FILE_IO_EXCEPTION;
+    }
+    return status;
+}
+
+static void celixTrace_init(void) {
+    trace_buffer = calloc(CELIX_TRACE_BUFFER_SIZE, sizeof(*trace_buffer));
+}
+
+static uint64_t celixTrace_now(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+static uint64_t celixTrace_newId(struct trace_thread *thread) {
+    uint64_t id;
+
+    // xorshift64*, seeded per thread. Ids only have to be unique, not unpredictable
+    if (thread->random == 0) {
+        thread->random = (celixTrace_now() ^ ((uint64_t) getpid() << 32) ^ (uint64_t) (uintptr_t) thread) | 1;
+    }
+    thread->random ^= thread->random >> 12;
+    thread->random ^= thread->random << 25;
+    thread->random ^= thread->random >> 27;
+    id = thread->random * 2685821657736338717ULL;
+    return id != 0 ? id : 1;
+}
+
+static void celixTrace_start(struct trace_thread *thread, celix_trace_span_t *span, const char *name, const char *detail, uint64_t traceId, uint64_t parentId) {
+    span->name = name;
+    span->detail = detail;
+    span->context.traceId = traceId;
+    span->context.spanId = celixTrace_newId(thread);
+    span->parentId = parentId;
+    span->previous = thread->current;
+    span->state = TRACE_SPAN_RECORDED;
+    thread->current = span->context;
+    span->start = celixTrace_now();
+}
+
+static void celixTrace_record(struct trace_thread *thread, celix_trace_span_t *span, uint64_t end) {
+    uint64_t index = __sync_fetch_and_add(&trace_head, 1);
+    struct trace_event *slot = &trace_buffer[index % CELIX_TRACE_BUFFER_SIZE];
+
+    if (thread->threadId == 0) {
+        thread->threadId = __sync_add_and_fetch(&trace_nextThreadId, 1);
+    }
+
+    slot->seq = 0;
+    __sync_synchronize();
+    slot->traceId = span->context.traceId;
+    slot->spanId = span->context.spanId;
+    slot->parentId = span->parentId;
+    slot->start = span->start;
+    slot->duration = end > span->start ? end - span->start : 0;
+    slot->threadId = thread->threadId;
+    celixTrace_copyString(slot->name, span->name, TRACE_NAME_LEN);
+    celixTrace_copyString(slot->detail, span->detail, TRACE_DETAIL_LEN);
+    __sync_synchronize();
+    slot->seq = index + 1;
+}
+
+static void celixTrace_copyString(char *dest, const char *src, size_t size) {
+    size_t len = 0;
+
+    if (src != NULL) {
+        len = strnlen(src, size - 1);
+        memcpy(dest, src, len);
+    }
+    dest[len] = '\0';
+}
+
+static void celixTrace_writeString(FILE *out, const char *str) {
+    fputc('"', out);
+    for (; *str != '\0'; str++) {
+        if (*str == '"' || *str == '\\') {
+            fprintf(out, "\\%c", *str);
+        } else if ((unsigned char) *str < 0x20) {
+            fprintf(out, "\\u%04x", (unsigned char) *str);
+        } else {
+            fputc(*str, out);
+        }
+    }
+    fputc('"', out);
+}
@@ -0,0 +1,200 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+/*
+ * celix_metrics_test.cpp
+ *
+ *  \author     <a href="mailto:dev@celix.apache.org">Apache Celix Project Team</a>
+ *  \copyright  Apache License, Version 2.0
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/TestHarness_c.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+extern "C"
+{
+#include "celix_metrics.h"
+#include "celix_threads.h"
+}
+
+#define NR_OF_THREADS 8
+#define UPDATES_PER_THREAD 10000
+
+int main(int argc, char** argv) {
+	return RUN_ALL_TESTS(argc, argv);
+}
+
+static void *updateMetrics(void *data) {
+	celix_metric_pt *metrics = (celix_metric_pt *) data;
+	for (int i = 0; i < UPDATES_PER_THREAD; i++) {
+		celixMetrics_add(metrics[0], 1);
+		celixMetrics_record(metrics[1], i);
+	}
+	return NULL;
+}
+
+TEST_GROUP(celix_metrics) {
+
+	void setup(void) {
+		celixMetrics_setEnabled(true);
+	}
+
+	void teardown() {
+		celixMetrics_setEnabled(false);
+	}
+};
+
+TEST(celix_metrics, counter) {
+	celix_metric_pt counter = NULL;
+	celix_metric_pt same = NULL;
+
+	LONGS_EQUAL(CELIX_SUCCESS, celixMetrics_get("test_counter_total", CELIX_METRIC_COUNTER, &counter));
+	LONGS_EQUAL(CELIX_SUCCESS, celixMetrics_get("test_counter_total", CELIX_METRIC_COUNTER, &same));
+	POINTERS_EQUAL(counter, same);
+
+	celixMetrics_add(counter, 2);
+	celixMetrics_add(same, 3);
+	LONGS_EQUAL(5, celixMetrics_value(counter));
+
+	celixMetrics_setEnabled(false);
+	celixMetrics_add(counter, 7);
+	LONGS_EQUAL(5, celixMetrics_value(counter));
+
+	celixMetrics_reset();
+	LONGS_EQUAL(0, celixMetrics_value(counter));
+
+	celixMetrics_release(same);
+	celixMetrics_release(counter);
+}
+
+TEST(celix_metrics, gauge) {
+	celix_metric_pt gauge = NULL;
+
+	LONGS_EQUAL(CELIX_SUCCESS, celixMetrics_get("test_gauge", CELIX_METRIC_GAUGE, &gauge));
+	celixMetrics_setGauge(gauge, 10);
+	celixMetrics_addGauge(gauge, -3);
+	LONGS_EQUAL(7, celixMetrics_value(gauge));
+
+	celixMetrics_reset();
+	LONGS_EQUAL(7, celixMetrics_value(gauge));
+
+	celixMetrics_release(gauge);
+}
+
+TEST(celix_metrics, typeMismatch) {
+	celix_metric_pt gauge = NULL;
+	celix_metric_pt counter = NULL;
+
+	LONGS_EQUAL(CELIX_SUCCESS, celixMetrics_get("test_mismatch", CELIX_METRIC_GAUGE, &gauge));
+	LONGS_EQUAL(CELIX_ILLEGAL_ARGUMENT, celixMetrics_get("test_mismatch", CELIX_METRIC_COUNTER, &counter));
+	POINTERS_EQUAL(NULL, counter);
+
+	celixMetrics_release(gauge);
+}
+
+TEST(celix_metrics, histogram) {
+	celix_metric_pt histogram = NULL;
+
+	LONGS_EQUAL(CELIX_SUCCESS, celixMetrics_get("test_histogram_ns", CELIX_METRIC_HISTOGRAM, &histogram));
+	for (int i = 1; i <= 1000; i++) {
+		celixMetrics_record(histogram, i * 1000);
+	}
+
+	LONGS_EQUAL(1000, celixMetrics_value(histogram));
+	uint64_t p50 = celixMetrics_percentile(histogram, 50.0);
+	uint64_t p99 = celixMetrics_percentile(histogram, 99.0);
+	CHECK(p50 >= 500000 && p50 <= 500000 * 1.125);
+	CHECK(p99 >= 990000 && p99 <= 990000 * 1.125);
+	LONGS_EQUAL(1000000, celixMetrics_percentile(histogram, 100.0));
+
+	celixMetrics_record(histogram, 3);
+	LONGS_EQUAL(3, celixMetrics_percentile(histogram, 0.0));
+
+	celixMetrics_release(histogram);
+}
+
+TEST(celix_metrics, timer) {
+	celix_metric_pt histogram = NULL;
+
+	LONGS_EQUAL(CELIX_SUCCESS, celixMetrics_get("test_timer_ns", CELIX_METRIC_HISTOGRAM, &histogram));
+	celixMetrics_stopTimer(histogram, celixMetrics_startTimer());
+	LONGS_EQUAL(1, celixMetrics_value(histogram));
+
+	celixMetrics_setEnabled(false);
+	uint64_t start = celixMetrics_startTimer();
+	LONGS_EQUAL(0, start);
+	celixMetrics_stopTimer(histogram, start);
+	LONGS_EQUAL(1, celixMetrics_value(histogram));
+
+	celixMetrics_release(histogram);
+}
+
+TEST(celix_metrics, concurrentUpdates) {
+	celix_metric_pt metrics[2];
+	celix_thread_t threads[NR_OF_THREADS];
+
+	LONGS_EQUAL(CELIX_SUCCESS, celixMetrics_get("test_concurrent_total", CELIX_METRIC_COUNTER, &metrics[0]));
+	LONGS_EQUAL(CELIX_SUCCESS, celixMetrics_get("test_concurrent_ns", CELIX_METRIC_HISTOGRAM, &metrics[1]));
+	for (int i = 0; i < NR_OF_THREADS; i++) {
+		celixThread_create(&threads[i], NULL, updateMetrics, metrics);
+	}
+	for (int i = 0; i < NR_OF_THREADS; i++) {
+		celixThread_join(threads[i], NULL);
+	}
+
+	LONGS_EQUAL(NR_OF_THREADS * UPDATES_PER_THREAD, celixMetrics_value(metrics[0]));
+	LONGS_EQUAL(NR_OF_THREADS * UPDATES_PER_THREAD, celixMetrics_value(metrics[1]));
+	LONGS_EQUAL(UPDATES_PER_THREAD - 1, celixMetrics_percentile(metrics[1], 100.0));
+
+	celixMetrics_release(metrics[0]);
+	celixMetrics_release(metrics[1]);
+}
+
+TEST(celix_metrics, dump) {
+	celix_metric_pt counter = NULL;
+	celix_metric_pt histogram = NULL;
+	char *text = NULL;
+	size_t size = 0;
+
+	celixMetrics_get("test_dump_total", CELIX_METRIC_COUNTER, &counter);
+	celixMetrics_get("test_dump_ns", CELIX_METRIC_HISTOGRAM, &histogram);
+	celixMetrics_add(counter, 42);
+	celixMetrics_record(histogram, 10);
+
+	FILE *out = open_memstream(&text, &size);
+	LONGS_EQUAL(CELIX_SUCCESS, celixMetrics_dump(out));
+	fclose(out);
+
+	CHECK(strstr(text, "# TYPE test_dump_total counter\ntest_dump_total 42\n") != NULL);
+	CHECK(strstr(text, "# TYPE test_dump_ns summary\n") != NULL);
+	CHECK(strstr(text, "test_dump_ns{quantile=\"0.99\"} 10\n") != NULL);
+	CHECK(strstr(text, "test_dump_ns_count 1\n") != NULL);
+	free(text);
+
+	celixMetrics_release(counter);
+	celixMetrics_release(histogram);
+
+	out = open_memstream(&text, &size);
+	celixMetrics_dump(out);
+	fclose(out);
+	POINTERS_EQUAL(NULL, strstr(text, "test_dump_total"));
+	free(text);
+}
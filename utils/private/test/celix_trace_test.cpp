@@ -0,0 +1,163 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+/*
+ * celix_trace_test.cpp
+ *
+ *  \author     <a href="mailto:dev@celix.apache.org">Apache Celix Project Team</a>
+ *  \copyright  Apache License, Version 2.0
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/TestHarness_c.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+extern "C"
+{
+#include "celix_trace.h"
+}
+
+int main(int argc, char** argv) {
+	return RUN_ALL_TESTS(argc, argv);
+}
+
+static char *dumpTrace(void) {
+	char *text = NULL;
+	size_t size = 0;
+
+	FILE *out = open_memstream(&text, &size);
+	LONGS_EQUAL(CELIX_SUCCESS, celixTrace_dump(out));
+	fclose(out);
+	return text;
+}
+
+static int countOccurrences(const char *text, const char *str) {
+	int count = 0;
+	for (const char *pos = strstr(text, str); pos != NULL; pos = strstr(pos + 1, str)) {
+		count++;
+	}
+	return count;
+}
+
+TEST_GROUP(celix_trace) {
+
+	void setup(void) {
+		LONGS_EQUAL(CELIX_SUCCESS, celixTrace_setSampleRate(1));
+	}
+
+	void teardown() {
+		celixTrace_setSampleRate(0);
+	}
+};
+
+TEST(celix_trace, disabled) {
+	celix_trace_span_t span;
+	celix_trace_context_t context;
+
+	celixTrace_setSampleRate(0);
+	celixTrace_beginSpan("test.disabled", NULL, &span);
+	celixTrace_currentContext(&context);
+	LONGS_EQUAL(0, context.traceId);
+	celixTrace_endSpan(&span);
+
+	char *text = dumpTrace();
+	POINTERS_EQUAL(NULL, strstr(text, "test.disabled"));
+	free(text);
+}
+
+TEST(celix_trace, nestedSpans) {
+	celix_trace_span_t root;
+	celix_trace_span_t child;
+	celix_trace_context_t rootContext;
+	celix_trace_context_t childContext;
+	celix_trace_context_t context;
+
+	celixTrace_beginSpan("test.root", "topic", &root);
+	celixTrace_currentContext(&rootContext);
+	CHECK(rootContext.traceId != 0);
+
+	celixTrace_beginSpan("test.child", NULL, &child);
+	celixTrace_currentContext(&childContext);
+	CHECK(rootContext.traceId == childContext.traceId);
+	CHECK(rootContext.spanId != childContext.spanId);
+	CHECK(child.parentId == rootContext.spanId);
+	celixTrace_endSpan(&child);
+
+	celixTrace_currentContext(&context);
+	CHECK(context.spanId == rootContext.spanId);
+	celixTrace_endSpan(&root);
+	celixTrace_currentContext(&context);
+	LONGS_EQUAL(0, context.traceId);
+}
+
+TEST(celix_trace, remoteSpan) {
+	celix_trace_span_t span;
+	celix_trace_context_t remote = { 0x1234, 0x5678 };
+	celix_trace_context_t context;
+
+	celixTrace_beginRemoteSpan("test.remote", NULL, &remote, &span);
+	celixTrace_currentContext(&context);
+	CHECK(context.traceId == 0x1234);
+	CHECK(span.parentId == 0x5678);
+	celixTrace_endSpan(&span);
+
+	char *text = dumpTrace();
+	CHECK(strstr(text, "\"name\":\"test.remote\"") != NULL);
+	CHECK(strstr(text, "\"trace\":\"0000000000001234\"") != NULL);
+	CHECK(strstr(text, "\"parent\":\"0000000000005678\"") != NULL);
+	free(text);
+}
+
+TEST(celix_trace, sampling) {
+	celix_trace_span_t root;
+	celix_trace_span_t child;
+	celix_trace_context_t context;
+	int sampled = 0;
+
+	celixTrace_setSampleRate(10);
+	for (int i = 0; i < 100; i++) {
+		celixTrace_beginSpan("test.sampled", NULL, &root);
+		celixTrace_beginSpan("test.sampled.child", NULL, &child);
+		celixTrace_currentContext(&context);
+		sampled += context.traceId != 0 ? 1 : 0;
+		celixTrace_endSpan(&child);
+		celixTrace_endSpan(&root);
+	}
+	LONGS_EQUAL(10, sampled);
+
+	char *text = dumpTrace();
+	LONGS_EQUAL(10, countOccurrences(text, "\"name\":\"test.sampled\""));
+	LONGS_EQUAL(10, countOccurrences(text, "\"name\":\"test.sampled.child\""));
+	free(text);
+}
+
+TEST(celix_trace, dump) {
+	celix_trace_span_t span;
+
+	celixTrace_beginSpan("test.dump", "quote\"d", &span);
+	celixTrace_endSpan(&span);
+
+	char *text = dumpTrace();
+	CHECK(strncmp(text, "{\"traceEvents\":[", 16) == 0);
+	CHECK(strstr(text, "\"name\":\"test.dump\",\"cat\":\"celix\",\"ph\":\"X\"") != NULL);
+	CHECK(strstr(text, "\"detail\":\"quote\\\"d\"") != NULL);
+	free(text);
+}
@@ -0,0 +1,91 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+/*
+ * celix_metrics.h
+ *
+ * Process wide registry of counters, gauges and latency histograms. Metrics are looked up by name once (this takes a
+ * lock) and updated on the hot path without locks: counters and histograms are sharded per thread and updated with
+ * atomic operations, histograms use logarithmic buckets with 8 linear sub buckets (at most 12.5% relative error).
+ * Metrics are disabled by default, updates then only test a flag.
+ *
+ *  \author    	<a href="mailto:dev@celix.apache.org">Apache Celix Project Team</a>
+ *  \copyright	Apache License, Version 2.0
+ */
+
+#ifndef CELIX_METRICS_H_
+#define CELIX_METRICS_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "celixbool.h"
+#include "celix_errno.h"
+#include "exports.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct celix_metric *celix_metric_pt;
+
+typedef enum celix_metric_type {
+    CELIX_METRIC_COUNTER,
+    CELIX_METRIC_GAUGE,
+    CELIX_METRIC_HISTOGRAM
+} celix_metric_type_e;
+
+UTILS_EXPORT void celixMetrics_setEnabled(bool enabled);
+UTILS_EXPORT bool celixMetrics_isEnabled(void);
+
+/*
+ * Returns the metric with the given name, the metric is created when it does not exist yet. Every get must be matched
+ * by a release. Fails with CELIX_ILLEGAL_ARGUMENT when a metric with the same name but another type exists.
+ */
+UTILS_EXPORT celix_status_t celixMetrics_get(const char *name, celix_metric_type_e type, celix_metric_pt *metric);
+UTILS_EXPORT void celixMetrics_release(celix_metric_pt metric);
+
+UTILS_EXPORT void celixMetrics_add(celix_metric_pt counter, uint64_t value);
+UTILS_EXPORT void celixMetrics_setGauge(celix_metric_pt gauge, int64_t value);
+UTILS_EXPORT void celixMetrics_addGauge(celix_metric_pt gauge, int64_t value);
+UTILS_EXPORT void celixMetrics_record(celix_metric_pt histogram, uint64_t value);
+
+/* Returns a monotonic timestamp in ns, or 0 when metrics are disabled */
+UTILS_EXPORT uint64_t celixMetrics_startTimer(void);
+/* Records the ns elapsed since start in the histogram, does nothing for a start of 0 */
+UTILS_EXPORT void celixMetrics_stopTimer(celix_metric_pt histogram, uint64_t start);
+
+/* Value of a counter or gauge, number of recorded values of a histogram */
+UTILS_EXPORT int64_t celixMetrics_value(celix_metric_pt metric);
+/* Upper bound of the bucket holding the given percentile (0-100) of a histogram, capped at the recorded maximum */
+UTILS_EXPORT uint64_t celixMetrics_percentile(celix_metric_pt histogram, double percentile);
+
+/* Clears all counters and histograms, gauges describe a current state and keep their value */
+UTILS_EXPORT void celixMetrics_reset(void);
+
+/*
+ * Writes all metrics in the Prometheus text format. Histograms are written as summaries with the 50, 90, 99, 99.9 and
+ * 100 percentiles.
+ */
+UTILS_EXPORT celix_status_t celixMetrics_dump(FILE *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CELIX_METRICS_H_ */
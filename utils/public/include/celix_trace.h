@@ -0,0 +1,95 @@
+/**
+ *Licensed to the Apache Software Foundation (ASF) under one
+ *or more contributor license agreements.  See the NOTICE file
+ *distributed with this work for additional information
+ *regarding copyright ownership.  The ASF licenses this file
+ *to you under the Apache License, Version 2.0 (the
+ *"License"); you may not use this file except in compliance
+ *with the License.  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *Unless required by applicable law or agreed to in writing,
+ *software distributed under the License is distributed on an
+ *"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *KIND, either express or implied.  See the License for the
+ *specific language governing permissions and limitations
+ *under the License.
+ */
+/*
+ * celix_trace.h
+ *
+ * Lightweight tracing of calls crossing pubsub and remote services. A span measures one step (send, receive, dispatch,
+ * invoke) and belongs to a trace, spans started while another span is open on the same thread become its children.
+ * The context of the open span (celixTrace_currentContext) is carried in outgoing messages so that the receiving side
+ * can continue the trace with celixTrace_beginRemoteSpan.
+ *
+ * Only 1 out of every sample rate root spans is recorded, together with all its (remote) children. Finished spans are
+ * written to an in-process ring buffer, which can be written in the Chrome trace event format (chrome://tracing or
+ * Perfetto). Tracing is disabled by default, beginning and ending a span then only tests a flag.
+ *
+ *  \author    	<a href="mailto:dev@celix.apache.org">Apache Celix Project Team</a>
+ *  \copyright	Apache License, Version 2.0
+ */
+
+#ifndef CELIX_TRACE_H_
+#define CELIX_TRACE_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "celixbool.h"
+#include "celix_errno.h"
+#include "exports.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct celix_trace_context {
+    uint64_t traceId; //0 if not traced
+    uint64_t spanId;
+} celix_trace_context_t;
+
+/* Span state, lives on the stack of the traced function. */
+typedef struct celix_trace_span {
+    const char *name;
+    const char *detail;
+    celix_trace_context_t context;
+    uint64_t parentId;
+    uint64_t start;
+    celix_trace_context_t previous;
+    unsigned char state;
+} celix_trace_span_t;
+
+/*
+ * Records 1 out of every rate root spans, 0 disables tracing. The ring buffer is allocated when tracing is enabled for
+ * the first time.
+ */
+UTILS_EXPORT celix_status_t celixTrace_setSampleRate(unsigned int rate);
+UTILS_EXPORT unsigned int celixTrace_getSampleRate(void);
+
+/*
+ * Starts a span on the calling thread. The name and the optional detail (e.g. a topic or method) are copied, and
+ * truncated, when the span ends and must stay valid until then. Every begin must be matched by an end on the same
+ * thread.
+ */
+UTILS_EXPORT void celixTrace_beginSpan(const char *name, const char *detail, celix_trace_span_t *span);
+/* Starts a span as child of a context received from another process or thread, a NULL or empty remote starts a root */
+UTILS_EXPORT void celixTrace_beginRemoteSpan(const char *name, const char *detail, const celix_trace_context_t *remote, celix_trace_span_t *span);
+UTILS_EXPORT void celixTrace_endSpan(celix_trace_span_t *span);
+
+/* Context of the innermost open span of the calling thread, the trace id is 0 if no sampled span is open or tracing is disabled */
+UTILS_EXPORT void celixTrace_currentContext(celix_trace_context_t *context);
+
+/* Writes the buffered spans as Chrome trace events, the buffer holds the most recent CELIX_TRACE_BUFFER_SIZE spans */
+UTILS_EXPORT celix_status_t celixTrace_dump(FILE *out);
+UTILS_EXPORT celix_status_t celixTrace_dumpToFile(const char *path);
+
+#define CELIX_TRACE_BUFFER_SIZE 32768
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CELIX_TRACE_H_ */